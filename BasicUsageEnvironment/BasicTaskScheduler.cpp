@@ -25,6 +25,14 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include <sys/select.h>
 #include <unix.h>
 #endif
+#if !defined(__WIN32__) && !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__) && !defined(NO_EVENTFD)
+#include <sys/eventfd.h>
+#define USE_EVENTFD 1
+#endif
+#endif
 
 ////////// BasicTaskScheduler //////////
 
@@ -33,7 +41,8 @@ BasicTaskScheduler* BasicTaskScheduler::createNew(unsigned maxSchedulerGranulari
 }
 
 BasicTaskScheduler::BasicTaskScheduler(unsigned maxSchedulerGranularity)
-  : fMaxSchedulerGranularity(maxSchedulerGranularity), fMaxNumSockets(0)
+  : fMaxSchedulerGranularity(maxSchedulerGranularity), fMaxNumSockets(0),
+    fWakeupReadFd(-1), fWakeupWriteFd(-1)
 #if defined(__WIN32__) || defined(_WIN32)
   , fDummySocketNum(-1)
 #endif
@@ -42,12 +51,54 @@ BasicTaskScheduler::BasicTaskScheduler(unsigned maxSchedulerGranularity)
   FD_ZERO(&fWriteSet);
   FD_ZERO(&fExceptionSet);
 
+  // Create a 'wakeup' descriptor, which "triggerEvent()" (perhaps called from another thread) uses to
+  // interrupt our "select()" immediately:
+#ifdef USE_EVENTFD
+  fWakeupReadFd = fWakeupWriteFd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+#elif !defined(__WIN32__) && !defined(_WIN32)
+  int pipeFds[2];
+  if (pipe(pipeFds) == 0) {
+    fWakeupReadFd = pipeFds[0];
+    fWakeupWriteFd = pipeFds[1];
+    fcntl(fWakeupReadFd, F_SETFL, fcntl(fWakeupReadFd, F_GETFL, 0)|O_NONBLOCK);
+    fcntl(fWakeupWriteFd, F_SETFL, fcntl(fWakeupWriteFd, F_GETFL, 0)|O_NONBLOCK);
+  }
+#else
+  // Windows has no "pipe()" that works with "select()", so use a (non-blocking) UDP socket that's 'connected' to itself
+  // on the loopback interface:
+  int wakeupSocketNum = socket(AF_INET, SOCK_DGRAM, 0);
+  if (wakeupSocketNum >= 0) {
+    struct sockaddr_in wakeupAddr;
+    memset(&wakeupAddr, 0, sizeof wakeupAddr);
+    wakeupAddr.sin_family = AF_INET;
+    wakeupAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    wakeupAddr.sin_port = 0; // let the OS choose
+    SOCKLEN_T addrLen = sizeof wakeupAddr;
+    u_long nonBlocking = 1;
+    if (bind(wakeupSocketNum, (struct sockaddr*)&wakeupAddr, sizeof wakeupAddr) == 0
+	&& getsockname(wakeupSocketNum, (struct sockaddr*)&wakeupAddr, &addrLen) == 0
+	&& connect(wakeupSocketNum, (struct sockaddr*)&wakeupAddr, sizeof wakeupAddr) == 0
+	&& ioctlsocket(wakeupSocketNum, FIONBIO, &nonBlocking) == 0) {
+      fWakeupReadFd = fWakeupWriteFd = wakeupSocketNum;
+    } else {
+      closeSocket(wakeupSocketNum);
+    }
+  }
+#endif
+  if (fWakeupReadFd >= 0) {
+    BasicTaskScheduler::setBackgroundHandling(fWakeupReadFd, SOCKET_READABLE, wakeupHandler, this);
+  }
+
   if (maxSchedulerGranularity > 0) schedulerTickTask(); // ensures that we handle events frequently
 }
 
 BasicTaskScheduler::~BasicTaskScheduler() {
 #if defined(__WIN32__) || defined(_WIN32)
   if (fDummySocketNum >= 0) closeSocket(fDummySocketNum);
+  if (fWakeupReadFd >= 0) closeSocket(fWakeupReadFd);
+#else
+  if (fWakeupReadFd >= 0) close(fWakeupReadFd);
+  if (fWakeupWriteFd >= 0 && fWakeupWriteFd != fWakeupReadFd) close(fWakeupWriteFd);
 #endif
 }
 
@@ -59,6 +110,28 @@ void BasicTaskScheduler::schedulerTickTask() {
   scheduleDelayedTask(fMaxSchedulerGranularity, schedulerTickTask, this);
 }
 
+void BasicTaskScheduler::wakeupHandler(void* clientData, int /*mask*/) {
+  // Drain the 'wakeup' descriptor.  (The triggered events themselves get handled later, in "SingleStep()".)
+  BasicTaskScheduler* scheduler = (BasicTaskScheduler*)clientData;
+  u_int64_t buf[16];
+#if defined(__WIN32__) || defined(_WIN32)
+  while (recv(scheduler->fWakeupReadFd, (char*)buf, sizeof buf, 0) > 0) {}
+#else
+  while (read(scheduler->fWakeupReadFd, buf, sizeof buf) > 0) {}
+#endif
+}
+
+void BasicTaskScheduler::wakeUpEventLoop() {
+  if (fWakeupWriteFd >= 0) {
+    u_int64_t one = 1; // (for a pipe or socket, any 8 bytes would do; for an "eventfd", it must be a non-zero count)
+#if defined(__WIN32__) || defined(_WIN32)
+    if (send(fWakeupWriteFd, (char const*)&one, sizeof one, 0) < 0) {} // if this fails, the socket is already readable
+#else
+    if (write(fWakeupWriteFd, &one, sizeof one) < 0) {} // if this fails, the descriptor is already readable
+#endif
+  }
+}
+
 #ifndef MILLION
 #define MILLION 1000000
 #endif
@@ -175,38 +248,9 @@ void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
     if (handler == NULL) fLastHandledSocketNum = -1;//because we didn't call a handler
   }
 
-  // Also handle any newly-triggered event (Note that we do this *after* calling a socket handler,
+  // Also handle any newly-triggered events (Note that we do this *after* calling a socket handler,
   // in case the triggered event handler modifies The set of readable sockets.)
-  if (fTriggersAwaitingHandling != 0) {
-    if (fTriggersAwaitingHandling == fLastUsedTriggerMask) {
-      // Common-case optimization for a single event trigger:
-      fTriggersAwaitingHandling &=~ fLastUsedTriggerMask;
-      if (fTriggeredEventHandlers[fLastUsedTriggerNum] != NULL) {
-	(*fTriggeredEventHandlers[fLastUsedTriggerNum])(fTriggeredEventClientDatas[fLastUsedTriggerNum]);
-      }
-    } else {
-      // Look for an event trigger that needs handling (making sure that we make forward progress through all possible triggers):
-      unsigned i = fLastUsedTriggerNum;
-      EventTriggerId mask = fLastUsedTriggerMask;
-
-      do {
-	i = (i+1)%MAX_NUM_EVENT_TRIGGERS;
-	mask >>= 1;
-	if (mask == 0) mask = 0x80000000;
-
-	if ((fTriggersAwaitingHandling&mask) != 0) {
-	  fTriggersAwaitingHandling &=~ mask;
-	  if (fTriggeredEventHandlers[i] != NULL) {
-	    (*fTriggeredEventHandlers[i])(fTriggeredEventClientDatas[i]);
-	  }
-
-	  fLastUsedTriggerMask = mask;
-	  fLastUsedTriggerNum = i;
-	  break;
-	}
-      } while (i != fLastUsedTriggerNum);
-    }
-  }
+  handleTriggeredEvents();
 
   // Also handle any delayed event that may have come due.
   fDelayQueue.handleAlarm();
@@ -41,19 +41,42 @@ private:
 };
 
 
+////////// A 'chunk' of event triggers,
+//////////     used to implement BasicTaskScheduler0::createEventTrigger() etc.
+
+class EventTriggerChunk {
+public:
+  EventTriggerChunk() {
+    for (unsigned i = 0; i < EVENT_TRIGGERS_PER_CHUNK; ++i) {
+      handlers[i] = NULL;
+      clientDatas[i].store(NULL, std::memory_order_relaxed);
+    }
+    for (unsigned i = 0; i < EVENT_TRIGGERS_PER_CHUNK/32; ++i) {
+      awaitingHandling[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  TaskFunc* handlers[EVENT_TRIGGERS_PER_CHUNK]; // used only from the event loop
+  std::atomic<void*> clientDatas[EVENT_TRIGGERS_PER_CHUNK];
+  std::atomic<u_int32_t> awaitingHandling[EVENT_TRIGGERS_PER_CHUNK/32]; // a bitmap
+};
+
+
 ////////// BasicTaskScheduler0 //////////
 
 BasicTaskScheduler0::BasicTaskScheduler0()
-  : fLastHandledSocketNum(-1), fTriggersAwaitingHandling(0), fLastUsedTriggerMask(1), fLastUsedTriggerNum(MAX_NUM_EVENT_TRIGGERS-1) {
+  : fLastHandledSocketNum(-1),
+    fNumTriggerChunks(0), fNumTriggersInUse(0), fLastCreatedTriggerNum(0),
+    fTriggersMayBeAwaitingHandling(false) {
   fHandlers = new HandlerSet;
-  for (unsigned i = 0; i < MAX_NUM_EVENT_TRIGGERS; ++i) {
-    fTriggeredEventHandlers[i] = NULL;
-    fTriggeredEventClientDatas[i] = NULL;
+  for (unsigned i = 0; i < MAX_NUM_EVENT_TRIGGERS/EVENT_TRIGGERS_PER_CHUNK; ++i) {
+    fTriggerChunks[i] = NULL;
   }
 }
 
 BasicTaskScheduler0::~BasicTaskScheduler0() {
   delete fHandlers;
+  for (unsigned i = 0; i < fNumTriggerChunks; ++i) delete fTriggerChunks[i];
 }
 
 TaskToken BasicTaskScheduler0::scheduleDelayedTask(int64_t microseconds,
@@ -82,64 +105,87 @@ void BasicTaskScheduler0::doEventLoop(char volatile* watchVariable) {
 }
 
 EventTriggerId BasicTaskScheduler0::createEventTrigger(TaskFunc* eventHandlerProc) {
-  unsigned i = fLastUsedTriggerNum;
-  EventTriggerId mask = fLastUsedTriggerMask;
-
-  do {
-    i = (i+1)%MAX_NUM_EVENT_TRIGGERS;
-    mask >>= 1;
-    if (mask == 0) mask = 0x80000000;
+  if (eventHandlerProc == NULL) return 0; // we use a NULL handler to denote a free trigger
+
+  unsigned triggerNum;
+  unsigned const numTriggers = fNumTriggerChunks*EVENT_TRIGGERS_PER_CHUNK;
+  if (fNumTriggersInUse < numTriggers) {
+    // There's a free trigger.  Look for it, beginning after the one that we created most recently
+    // (so that a recently-deleted trigger doesn't get reused immediately):
+    triggerNum = fLastCreatedTriggerNum;
+    do {
+      triggerNum = (triggerNum+1)%numTriggers;
+    } while (fTriggerChunks[triggerNum/EVENT_TRIGGERS_PER_CHUNK]->handlers[triggerNum%EVENT_TRIGGERS_PER_CHUNK] != NULL);
+  } else {
+    // All of our triggers are in use, so allocate a new chunk of them (if we can):
+    if (fNumTriggerChunks == MAX_NUM_EVENT_TRIGGERS/EVENT_TRIGGERS_PER_CHUNK) return 0;
+    fTriggerChunks[fNumTriggerChunks] = new EventTriggerChunk;
+    triggerNum = fNumTriggerChunks*EVENT_TRIGGERS_PER_CHUNK;
+    ++fNumTriggerChunks;
+  }
 
-    if (fTriggeredEventHandlers[i] == NULL) {
-      // This trigger number is free; use it:
-      fTriggeredEventHandlers[i] = eventHandlerProc;
-      fTriggeredEventClientDatas[i] = NULL; // sanity
+  EventTriggerChunk* chunk = fTriggerChunks[triggerNum/EVENT_TRIGGERS_PER_CHUNK];
+  chunk->handlers[triggerNum%EVENT_TRIGGERS_PER_CHUNK] = eventHandlerProc;
+  chunk->clientDatas[triggerNum%EVENT_TRIGGERS_PER_CHUNK].store(NULL, std::memory_order_relaxed); // sanity
+  ++fNumTriggersInUse;
+  fLastCreatedTriggerNum = triggerNum;
 
-      fLastUsedTriggerMask = mask;
-      fLastUsedTriggerNum = i;
+  return triggerNum + 1;
+}
 
-      return mask;
-    }
-  } while (i != fLastUsedTriggerNum);
+void BasicTaskScheduler0::deleteEventTrigger(EventTriggerId eventTriggerId) {
+  if (eventTriggerId == 0 || eventTriggerId > fNumTriggerChunks*EVENT_TRIGGERS_PER_CHUNK) return;
+  unsigned triggerNum = eventTriggerId - 1;
+  EventTriggerChunk* chunk = fTriggerChunks[triggerNum/EVENT_TRIGGERS_PER_CHUNK];
+  unsigned i = triggerNum%EVENT_TRIGGERS_PER_CHUNK;
+  if (chunk->handlers[i] == NULL) return; // the trigger wasn't in use
+
+  chunk->awaitingHandling[i/32].fetch_and(~(1u<<(i%32)));
+  chunk->handlers[i] = NULL;
+  chunk->clientDatas[i].store(NULL, std::memory_order_relaxed);
+  --fNumTriggersInUse;
+}
 
-  // All available event triggers are allocated; return 0 instead:
-  return 0;
+void BasicTaskScheduler0::triggerEvent(EventTriggerId eventTriggerId, void* clientData) {
+  // Note: This function (unlike others in the library) can be called from an external thread
+  // (and from several such threads at once).
+  if (eventTriggerId == 0 || eventTriggerId > MAX_NUM_EVENT_TRIGGERS) return;
+  unsigned triggerNum = eventTriggerId - 1;
+  EventTriggerChunk* chunk = fTriggerChunks[triggerNum/EVENT_TRIGGERS_PER_CHUNK];
+  if (chunk == NULL) return;
+  unsigned i = triggerNum%EVENT_TRIGGERS_PER_CHUNK;
+
+  // First, record the "clientData".  Then, note this event as being ready to be handled.
+  // (The 'release' ordering ensures that the event loop sees this "clientData" when it handles the event.)
+  chunk->clientDatas[i].store(clientData, std::memory_order_relaxed);
+  chunk->awaitingHandling[i/32].fetch_or(1u<<(i%32), std::memory_order_release);
+
+  // Finally, wake up the event loop - unless we've already done so (and it hasn't yet handled triggered events):
+  if (!fTriggersMayBeAwaitingHandling.exchange(true)) wakeUpEventLoop();
 }
 
-void BasicTaskScheduler0::deleteEventTrigger(EventTriggerId eventTriggerId) {
-  fTriggersAwaitingHandling &=~ eventTriggerId;
+void BasicTaskScheduler0::handleTriggeredEvents() {
+  if (!fTriggersMayBeAwaitingHandling.exchange(false)) return; // common case: nothing has been triggered
 
-  if (eventTriggerId == fLastUsedTriggerMask) { // common-case optimization:
-    fTriggeredEventHandlers[fLastUsedTriggerNum] = NULL;
-    fTriggeredEventClientDatas[fLastUsedTriggerNum] = NULL;
-  } else {
-    // "eventTriggerId" should have just one bit set.
-    // However, we do the reasonable thing if the user happened to 'or' together two or more "EventTriggerId"s:
-    EventTriggerId mask = 0x80000000;
-    for (unsigned i = 0; i < MAX_NUM_EVENT_TRIGGERS; ++i) {
-      if ((eventTriggerId&mask) != 0) {
-	fTriggeredEventHandlers[i] = NULL;
-	fTriggeredEventClientDatas[i] = NULL;
+  // Handle each triggered event.  (Note that a handler may create or delete triggers.)
+  for (unsigned c = 0; c < fNumTriggerChunks; ++c) {
+    EventTriggerChunk* chunk = fTriggerChunks[c];
+    for (unsigned w = 0; w < EVENT_TRIGGERS_PER_CHUNK/32; ++w) {
+      if (chunk->awaitingHandling[w].load(std::memory_order_relaxed) == 0) continue;
+      u_int32_t triggeredBits = chunk->awaitingHandling[w].exchange(0, std::memory_order_acquire);
+
+      for (unsigned b = 0; triggeredBits != 0; ++b, triggeredBits >>= 1) {
+	if ((triggeredBits&1) == 0) continue;
+
+	unsigned i = w*32 + b;
+	TaskFunc* handler = chunk->handlers[i];
+	if (handler != NULL) (*handler)(chunk->clientDatas[i].load(std::memory_order_relaxed));
       }
-      mask >>= 1;
     }
   }
 }
 
-void BasicTaskScheduler0::triggerEvent(EventTriggerId eventTriggerId, void* clientData) {
-  // First, record the "clientData".  (Note that we allow "eventTriggerId" to be a combination of bits for multiple events.)
-  EventTriggerId mask = 0x80000000;
-  for (unsigned i = 0; i < MAX_NUM_EVENT_TRIGGERS; ++i) {
-    if ((eventTriggerId&mask) != 0) {
-      fTriggeredEventClientDatas[i] = clientData;
-    }
-    mask >>= 1;
-  }
-
-  // Then, note this event as being ready to be handled.
-  // (Note that because this function (unlike others in the library) can be called from an external thread, we do this last, to
-  //  reduce the risk of a race condition.)
-  fTriggersAwaitingHandling |= eventTriggerId;
+void BasicTaskScheduler0::wakeUpEventLoop() {
 }
 
 
@@ -48,9 +48,10 @@ class BasicTaskScheduler: public BasicTaskScheduler0 {
 public:
   static BasicTaskScheduler* createNew(unsigned maxSchedulerGranularity = 10000/*microseconds*/);
     // "maxSchedulerGranularity" (default value: 10 ms) specifies the maximum time that we wait (in "select()") before
-    // returning to the event loop to handle non-socket or non-timer-based events, such as 'triggered events'.
+    // returning to the event loop to handle non-socket or non-timer-based events.
     // You can change this is you wish (but only if you know what you're doing!), or set it to 0, to specify no such maximum time.
-    // (You should set it to 0 only if you know that you will not be using 'event triggers'.)
+    // (Note that 'triggered events' interrupt "select()" immediately - using an internal 'wakeup' pipe (or, on Windows,
+    //  a loopback UDP socket) - so they don't depend on "maxSchedulerGranularity".)
   virtual ~BasicTaskScheduler();
 
 protected:
@@ -60,9 +61,12 @@ protected:
   static void schedulerTickTask(void* clientData);
   void schedulerTickTask();
 
+  static void wakeupHandler(void* clientData, int mask);
+
 protected:
   // Redefined virtual functions:
   virtual void SingleStep(unsigned maxDelayTime);
+  virtual void wakeUpEventLoop();
 
   virtual void setBackgroundHandling(int socketNum, int conditionSet, BackgroundHandlerProc* handlerProc, void* clientData);
   virtual void moveSocketHandling(int oldSocketNum, int newSocketNum);
@@ -76,6 +80,9 @@ protected:
   fd_set fWriteSet;
   fd_set fExceptionSet;
 
+  // To interrupt "select()" when an event is triggered (from another thread):
+  int fWakeupReadFd, fWakeupWriteFd; // -1 if not available
+
 private:
 #if defined(__WIN32__) || defined(_WIN32)
   // Hack to work around a bug in Windows' "select()" implementation:
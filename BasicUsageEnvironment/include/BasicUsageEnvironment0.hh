@@ -32,6 +32,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "DelayQueue.hh"
 #endif
 
+#include <atomic>
+
 #define RESULT_MSG_BUFFER_MAX 1000
 
 // An abstract base class, useful for subclassing
@@ -66,8 +68,11 @@ private:
 };
 
 class HandlerSet; // forward
+class EventTriggerChunk; // forward
 
-#define MAX_NUM_EVENT_TRIGGERS 32
+#define MAX_NUM_EVENT_TRIGGERS 65536
+#define EVENT_TRIGGERS_PER_CHUNK 256
+    // Event triggers are allocated (as needed) in 'chunks' of this size
 
 // An abstract base class, useful for subclassing
 // (e.g., to redefine the implementation of socket event handling)
@@ -95,6 +100,12 @@ public:
 protected:
   BasicTaskScheduler0();
 
+  void handleTriggeredEvents(); // called (from the event loop) by "SingleStep()" implementations
+  virtual void wakeUpEventLoop();
+      // Called - possibly from an external thread - when an event has been triggered, to interrupt a
+      // (possibly blocked) "SingleStep()".  The default implementation does nothing; the event then gets
+      // handled when "SingleStep()" next returns from waiting.
+
 protected:
   // To implement delayed operations:
   DelayQueue fDelayQueue;
@@ -104,11 +115,13 @@ protected:
   int fLastHandledSocketNum;
 
   // To implement event triggers:
-  EventTriggerId volatile fTriggersAwaitingHandling; // implemented as a 32-bit bitmap
-  EventTriggerId fLastUsedTriggerMask; // implemented as a 32-bit bitmap
-  TaskFunc* fTriggeredEventHandlers[MAX_NUM_EVENT_TRIGGERS];
-  void* fTriggeredEventClientDatas[MAX_NUM_EVENT_TRIGGERS];
-  unsigned fLastUsedTriggerNum; // in the range [0,MAX_NUM_EVENT_TRIGGERS)
+  // (Each "EventTriggerId" is 1 + the index of the trigger in a table of 'chunks'.  Chunks are never moved
+  //  or freed once allocated, so "triggerEvent()" can use them - from any thread - without locking.)
+  EventTriggerChunk* fTriggerChunks[MAX_NUM_EVENT_TRIGGERS/EVENT_TRIGGERS_PER_CHUNK];
+  unsigned fNumTriggerChunks;
+  unsigned fNumTriggersInUse;
+  unsigned fLastCreatedTriggerNum; // in the range [0,fNumTriggerChunks*EVENT_TRIGGERS_PER_CHUNK)
+  std::atomic<bool> fTriggersMayBeAwaitingHandling;
 };
 
 #endif
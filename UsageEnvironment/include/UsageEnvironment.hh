@@ -102,6 +102,9 @@ private:
 typedef void TaskFunc(void* clientData);
 typedef void* TaskToken;
 typedef u_int32_t EventTriggerId;
+  // Note: An "EventTriggerId" is an opaque, non-zero value that denotes exactly one trigger.  (Older versions of this
+  // library returned a one-bit mask, and let several ids be 'or'ed together in one "triggerEvent()" or
+  // "deleteEventTrigger()" call.  That is no longer supported; an 'or'ed value now names some other trigger, or none.)
 
 class TaskScheduler {
 public:
@@ -154,8 +157,9 @@ public:
       // Causes the (previously-registered) handler function for the specified event to be handled (from the event loop).
       // The handler function is called with "clientData" as parameter.
       // Note: This function (unlike other library functions) may be called from an external thread
-      // - to signal an external event.  (However, "triggerEvent()" should not be called with the
-      // same 'event trigger id' from different threads.)
+      // - to signal an external event.  (The "BasicTaskScheduler" implementation also allows "triggerEvent()"
+      // to be called with the same 'event trigger id' from different threads at once.)
+      // Each 'event trigger id' denotes a single trigger; they should not be 'or'ed together.
 
   // The following two functions are deprecated, and are provided for backwards-compatibility only:
   void turnOnBackgroundReadHandling(int socketNum, BackgroundHandlerProc* handlerProc, void* clientData) {
@@ -20,29 +20,30 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "GroupEId.hh"
 
 
-GroupEId::GroupEId(struct in_addr const& groupAddr,
+GroupEId::GroupEId(struct sockaddr_storage const& groupAddr,
 		   portNumBits portNum, u_int8_t ttl) {
-  struct in_addr sourceFilterAddr;
-  sourceFilterAddr.s_addr = ~0; // indicates no source filter
+  struct sockaddr_storage sourceFilterAddr;
+  memset(&sourceFilterAddr, 0, sizeof sourceFilterAddr); // AF_UNSPEC indicates no source filter
 
   init(groupAddr, sourceFilterAddr, portNum, ttl);
 }
 
-GroupEId::GroupEId(struct in_addr const& groupAddr,
-		   struct in_addr const& sourceFilterAddr,
+GroupEId::GroupEId(struct sockaddr_storage const& groupAddr,
+		   struct sockaddr_storage const& sourceFilterAddr,
 		   portNumBits portNum) {
   init(groupAddr, sourceFilterAddr, portNum, 255);
 }
 
 Boolean GroupEId::isSSM() const {
-  return fSourceFilterAddress.s_addr != netAddressBits(~0);
+  return fSourceFilterAddress.ss_family != AF_UNSPEC;
 }
 
-void GroupEId::init(struct in_addr const& groupAddr,
-		    struct in_addr const& sourceFilterAddr,
+void GroupEId::init(struct sockaddr_storage const& groupAddr,
+		    struct sockaddr_storage const& sourceFilterAddr,
 		    portNumBits portNum,
 		    u_int8_t ttl) {
   fGroupAddress = groupAddr;
+  setPortNum(fGroupAddress, portNum);
   fSourceFilterAddress = sourceFilterAddr;
   fPortNum = portNum;
   fTTL = ttl;
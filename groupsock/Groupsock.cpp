@@ -27,29 +27,57 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 #include <stdio.h>
 
+static struct sockaddr_storage ipv4Storage(struct in_addr const& addr) {
+  struct sockaddr_storage result;
+  setIPv4Address(result, addr.s_addr);
+  return result;
+}
+
 ///////// OutputSocket //////////
 
-OutputSocket::OutputSocket(UsageEnvironment& env)
-  : Socket(env, 0 /* let kernel choose port */),
-    fSourcePort(0), fLastSentTTL(256/*hack: a deliberately invalid value*/) {
+OutputSocket::OutputSocket(UsageEnvironment& env, int family)
+  : Socket(env, 0 /* let kernel choose port */, family),
+    fSourcePort(0), fLastSentTTL(256/*hack: a deliberately invalid value*/),
+    fTxTimeIsEnabled(False), fTxTimeNSecs(0) {
+}
+
+OutputSocket::OutputSocket(UsageEnvironment& env, Port port, int family)
+  : Socket(env, port, family),
+    fSourcePort(0), fLastSentTTL(256/*hack: a deliberately invalid value*/),
+    fTxTimeIsEnabled(False), fTxTimeNSecs(0) {
 }
 
-OutputSocket::OutputSocket(UsageEnvironment& env, Port port)
-  : Socket(env, port),
-    fSourcePort(0), fLastSentTTL(256/*hack: a deliberately invalid value*/) {
+Boolean OutputSocket::enableTxTime() {
+  if (!fTxTimeIsEnabled) fTxTimeIsEnabled = enableSocketTxTime(env(), socketNum());
+  return fTxTimeIsEnabled;
 }
 
 OutputSocket::~OutputSocket() {
 }
 
-Boolean OutputSocket::write(netAddressBits address, portNumBits portNum, u_int8_t ttl,
+Boolean OutputSocket::write(struct sockaddr_storage const& destAddressAndPort, u_int8_t ttl,
 			    unsigned char* buffer, unsigned bufferSize) {
-  struct in_addr destAddr; destAddr.s_addr = address;
-  if ((unsigned)ttl == fLastSentTTL) {
+  // An IPv4 destination of an IPv6 (i.e., "DualStack") socket gets sent to as an IPv4-mapped IPv6 address:
+  struct sockaddr_storage mappedAddressAndPort;
+  Boolean const mapAddress = family() == AF_INET6 && destAddressAndPort.ss_family == AF_INET;
+  if (mapAddress) {
+    struct sockaddr_in const& dest4 = (struct sockaddr_in const&)destAddressAndPort;
+    struct sockaddr_in6& dest6 = (struct sockaddr_in6&)mappedAddressAndPort;
+    memset(&mappedAddressAndPort, 0, sizeof mappedAddressAndPort);
+    dest6.sin6_family = AF_INET6;
+    dest6.sin6_port = dest4.sin_port;
+    dest6.sin6_addr.s6_addr[10] = dest6.sin6_addr.s6_addr[11] = 0xFF;
+    memcpy(&dest6.sin6_addr.s6_addr[12], &dest4.sin_addr, sizeof dest4.sin_addr);
+  }
+  struct sockaddr_storage const& addressAndPort = mapAddress ? mappedAddressAndPort : destAddressAndPort;
+
+  if ((unsigned)ttl == fLastSentTTL && fTxTimeIsEnabled && fTxTimeNSecs != 0) {
+    if (!writeSocketAtTime(env(), socketNum(), addressAndPort, buffer, bufferSize, fTxTimeNSecs)) return False;
+  } else if ((unsigned)ttl == fLastSentTTL) {
     // Optimization: Don't do a 'set TTL' system call again
-    if (!writeSocket(env(), socketNum(), destAddr, portNum, buffer, bufferSize)) return False;
+    if (!writeSocket(env(), socketNum(), addressAndPort, buffer, bufferSize)) return False;
   } else {
-    if (!writeSocket(env(), socketNum(), destAddr, portNum, ttl, buffer, bufferSize)) return False;
+    if (!writeSocket(env(), socketNum(), addressAndPort, ttl, buffer, bufferSize)) return False;
     fLastSentTTL = (unsigned)ttl;
   }
 
@@ -71,7 +99,7 @@ Boolean OutputSocket::write(netAddressBits address, portNumBits portNum, u_int8_
 // By default, we don't do reads:
 Boolean OutputSocket
 ::handleRead(unsigned char* /*buffer*/, unsigned /*bufferMaxSize*/,
-	     unsigned& /*bytesRead*/, struct sockaddr_in& /*fromAddressAndPort*/) {
+	     unsigned& /*bytesRead*/, struct sockaddr_storage& /*fromAddressAndPort*/) {
   return True;
 }
 
@@ -79,7 +107,7 @@ Boolean OutputSocket
 ///////// destRecord //////////
 
 destRecord
-::destRecord(struct in_addr const& addr, Port const& port, u_int8_t ttl, unsigned sessionId,
+::destRecord(struct sockaddr_storage const& addr, Port const& port, u_int8_t ttl, unsigned sessionId,
 	     destRecord* next)
   : fNext(next), fGroupEId(addr, port.num(), ttl), fSessionId(sessionId) {
 }
@@ -97,51 +125,74 @@ NetInterfaceTrafficStats Groupsock::statsRelayedIncoming;
 NetInterfaceTrafficStats Groupsock::statsRelayedOutgoing;
 
 // Constructor for a source-independent multicast group
-Groupsock::Groupsock(UsageEnvironment& env, struct in_addr const& groupAddr,
+Groupsock::Groupsock(UsageEnvironment& env, struct sockaddr_storage const& groupAddr,
 		     Port port, u_int8_t ttl)
-  : OutputSocket(env, port),
+  : OutputSocket(env, port, groupAddr.ss_family),
     deleteIfNoMembers(False), isSlave(False),
     fDests(new destRecord(groupAddr, port, ttl, 0, NULL)),
     fIncomingGroupEId(groupAddr, port.num(), ttl) {
+  joinGroup();
+}
 
-  if (!socketJoinGroup(env, socketNum(), groupAddr.s_addr)) {
-    if (DebugLevel >= 1) {
-      env << *this << ": failed to join group: "
-	  << env.getResultMsg() << "\n";
-    }
-  }
-
-  // Make sure we can get our source address:
-  if (ourIPAddress(env) == 0) {
-    if (DebugLevel >= 0) { // this is a fatal error
-      env << "Unable to determine our source address: "
-	  << env.getResultMsg() << "\n";
-    }
-  }
-
-  if (DebugLevel >= 2) env << *this << ": created\n";
+Groupsock::Groupsock(UsageEnvironment& env, struct in_addr const& groupAddr,
+		     Port port, u_int8_t ttl)
+  : OutputSocket(env, port, AF_INET),
+    deleteIfNoMembers(False), isSlave(False),
+    fDests(new destRecord(ipv4Storage(groupAddr), port, ttl, 0, NULL)),
+    fIncomingGroupEId(ipv4Storage(groupAddr), port.num(), ttl) {
+  joinGroup();
 }
 
 // Constructor for a source-specific multicast group
-Groupsock::Groupsock(UsageEnvironment& env, struct in_addr const& groupAddr,
-		     struct in_addr const& sourceFilterAddr,
+Groupsock::Groupsock(UsageEnvironment& env, struct sockaddr_storage const& groupAddr,
+		     struct sockaddr_storage const& sourceFilterAddr,
 		     Port port)
-  : OutputSocket(env, port),
+  : OutputSocket(env, port, groupAddr.ss_family),
     deleteIfNoMembers(False), isSlave(False),
     fDests(new destRecord(groupAddr, port, 255, 0, NULL)),
     fIncomingGroupEId(groupAddr, sourceFilterAddr, port.num()) {
-  // First try a SSM join.  If that fails, try a regular join:
-  if (!socketJoinGroupSSM(env, socketNum(), groupAddr.s_addr,
-			  sourceFilterAddr.s_addr)) {
+  joinGroup();
+}
+
+Groupsock::Groupsock(UsageEnvironment& env, struct in_addr const& groupAddr,
+		     struct in_addr const& sourceFilterAddr,
+		     Port port)
+  : OutputSocket(env, port, AF_INET),
+    deleteIfNoMembers(False), isSlave(False),
+    fDests(new destRecord(ipv4Storage(groupAddr), port, 255, 0, NULL)),
+    fIncomingGroupEId(ipv4Storage(groupAddr), ipv4Storage(sourceFilterAddr), port.num()) {
+  joinGroup();
+}
+
+void Groupsock::joinGroup() {
+  UsageEnvironment& env = this->env();
+
+  if (isSSM()) {
+    // First try a SSM join.  If that fails, try a regular join:
+    if (socketJoinGroupSSM(env, socketNum(), groupAddress(), sourceFilterAddress())) {
+      if (DebugLevel >= 2) env << *this << ": created\n";
+      return;
+    }
     if (DebugLevel >= 3) {
       env << *this << ": SSM join failed: "
 	  << env.getResultMsg();
       env << " - trying regular join instead\n";
     }
-    if (!socketJoinGroup(env, socketNum(), groupAddr.s_addr)) {
-      if (DebugLevel >= 1) {
-	env << *this << ": failed to join group: "
-	     << env.getResultMsg() << "\n";
+  }
+
+  if (!socketJoinGroup(env, socketNum(), groupAddress())) {
+    if (DebugLevel >= 1) {
+      env << *this << ": failed to join group: "
+	  << env.getResultMsg() << "\n";
+    }
+  }
+
+  if (!isSSM() && family() == AF_INET) {
+    // Make sure we can get our source address:
+    if (ourIPAddress(env) == 0) {
+      if (DebugLevel >= 0) { // this is a fatal error
+	env << "Unable to determine our source address: "
+	    << env.getResultMsg() << "\n";
       }
     }
   }
@@ -151,12 +202,12 @@ Groupsock::Groupsock(UsageEnvironment& env, struct in_addr const& groupAddr,
 
 Groupsock::~Groupsock() {
   if (isSSM()) {
-    if (!socketLeaveGroupSSM(env(), socketNum(), groupAddress().s_addr,
-			     sourceFilterAddress().s_addr)) {
-      socketLeaveGroup(env(), socketNum(), groupAddress().s_addr);
+    if (!socketLeaveGroupSSM(env(), socketNum(), groupAddress(),
+			     sourceFilterAddress())) {
+      socketLeaveGroup(env(), socketNum(), groupAddress());
     }
   } else {
-    socketLeaveGroup(env(), socketNum(), groupAddress().s_addr);
+    socketLeaveGroup(env(), socketNum(), groupAddress());
   }
 
   delete fDests;
@@ -165,14 +216,14 @@ Groupsock::~Groupsock() {
 }
 
 destRecord* Groupsock
-::createNewDestRecord(struct in_addr const& addr, Port const& port, u_int8_t ttl,
+::createNewDestRecord(struct sockaddr_storage const& addr, Port const& port, u_int8_t ttl,
 		      unsigned sessionId, destRecord* next) {
   // Default implementation:
   return new destRecord(addr, port, ttl, sessionId, next);
 }
 
 void
-Groupsock::changeDestinationParameters(struct in_addr const& newDestAddr,
+Groupsock::changeDestinationParameters(struct sockaddr_storage const& newDestAddr,
 				       Port newDestPort, int newDestTTL, unsigned sessionId) {
   destRecord* dest;
   for (dest = fDests; dest != NULL && dest->fSessionId != sessionId; dest = dest->fNext) {}
@@ -183,27 +234,27 @@ Groupsock::changeDestinationParameters(struct in_addr const& newDestAddr,
   }
 
   // "dest" is an existing 'destRecord' for this "sessionId"; change its values to the new ones:
-  struct in_addr destAddr = dest->fGroupEId.groupAddress();
-  if (newDestAddr.s_addr != 0) {
-    if (newDestAddr.s_addr != destAddr.s_addr
-	&& IsMulticastAddress(newDestAddr.s_addr)) {
+  struct sockaddr_storage destAddr = dest->fGroupEId.groupAddress();
+  if (!addressIsNull(newDestAddr)) {
+    if (newDestAddr != destAddr
+	&& IsMulticastAddress(newDestAddr)) {
       // If the new destination is a multicast address, then we assume that
       // we want to join it also.  (If this is not in fact the case, then
       // call "multicastSendOnly()" afterwards.)
-      socketLeaveGroup(env(), socketNum(), destAddr.s_addr);
-      socketJoinGroup(env(), socketNum(), newDestAddr.s_addr);
+      socketLeaveGroup(env(), socketNum(), destAddr);
+      socketJoinGroup(env(), socketNum(), newDestAddr);
     }
-    destAddr.s_addr = newDestAddr.s_addr;
+    destAddr = newDestAddr;
   }
 
   portNumBits destPortNum = dest->fGroupEId.portNum();
   if (newDestPort.num() != 0) {
     if (newDestPort.num() != destPortNum
-	&& IsMulticastAddress(destAddr.s_addr)) {
+	&& IsMulticastAddress(destAddr)) {
       // Also bind to the new port number:
       changePort(newDestPort);
       // And rejoin the multicast group:
-      socketJoinGroup(env(), socketNum(), destAddr.s_addr);
+      socketJoinGroup(env(), socketNum(), destAddr);
     }
     destPortNum = newDestPort.num();
   }
@@ -217,20 +268,32 @@ Groupsock::changeDestinationParameters(struct in_addr const& newDestAddr,
   removeDestinationFrom(dest->fNext, sessionId);
 }
 
+void
+Groupsock::changeDestinationParameters(struct in_addr const& newDestAddr,
+				       Port newDestPort, int newDestTTL, unsigned sessionId) {
+  struct sockaddr_storage newDestAddress;
+  if (newDestAddr.s_addr == 0) {
+    memset(&newDestAddress, 0, sizeof newDestAddress); // no change
+  } else {
+    setIPv4Address(newDestAddress, newDestAddr.s_addr);
+  }
+  changeDestinationParameters(newDestAddress, newDestPort, newDestTTL, sessionId);
+}
+
 unsigned Groupsock
-::lookupSessionIdFromDestination(struct sockaddr_in const& destAddrAndPort) const {
+::lookupSessionIdFromDestination(struct sockaddr_storage const& destAddrAndPort) const {
   destRecord* dest = lookupDestRecordFromDestination(destAddrAndPort);
   if (dest == NULL) return 0;
 
   return dest->fSessionId;
 }
 
-void Groupsock::addDestination(struct in_addr const& addr, Port const& port, unsigned sessionId) {
+void Groupsock::addDestination(struct sockaddr_storage const& addr, Port const& port, unsigned sessionId) {
   // Default implementation:
   // If there's no existing 'destRecord' with the same "addr", "port", and "sessionId", add a new one:
   for (destRecord* dest = fDests; dest != NULL; dest = dest->fNext) {
     if (sessionId == dest->fSessionId
-	&& addr.s_addr == dest->fGroupEId.groupAddress().s_addr
+	&& addr == dest->fGroupEId.groupAddress()
 	&& port.num() == dest->fGroupEId.portNum()) {
       return;
     }
@@ -239,6 +302,10 @@ void Groupsock::addDestination(struct in_addr const& addr, Port const& port, uns
   fDests = createNewDestRecord(addr, port, 255, sessionId, fDests);
 }
 
+void Groupsock::addDestination(struct in_addr const& addr, Port const& port, unsigned sessionId) {
+  addDestination(ipv4Storage(addr), port, sessionId);
+}
+
 void Groupsock::removeDestination(unsigned sessionId) {
   // Default implementation:
   removeDestinationFrom(fDests, sessionId);
@@ -252,9 +319,9 @@ void Groupsock::multicastSendOnly() {
   // We disable this code for now, because - on some systems - leaving the multicast group seems to cause sent packets
   // to not be received by other applications (at least, on the same host).
 #if 0
-  socketLeaveGroup(env(), socketNum(), fIncomingGroupEId.groupAddress().s_addr);
+  socketLeaveGroup(env(), socketNum(), fIncomingGroupEId.groupAddress());
   for (destRecord* dests = fDests; dests != NULL; dests = dests->fNext) {
-    socketLeaveGroup(env(), socketNum(), dests->fGroupEId.groupAddress().s_addr);
+    socketLeaveGroup(env(), socketNum(), dests->fGroupEId.groupAddress());
   }
 #endif
 }
@@ -265,7 +332,7 @@ Boolean Groupsock::output(UsageEnvironment& env, unsigned char* buffer, unsigned
     // First, do the datagram send, to each destination:
     Boolean writeSuccess = True;
     for (destRecord* dests = fDests; dests != NULL; dests = dests->fNext) {
-      if (!write(dests->fGroupEId.groupAddress().s_addr, dests->fGroupEId.portNum(), dests->fGroupEId.ttl(),
+      if (!write(dests->fGroupEId.groupAddress()/*includes the port number*/, dests->fGroupEId.ttl(),
 		 buffer, bufferSize)) {
 	writeSuccess = False;
 	break;
@@ -305,7 +372,7 @@ Boolean Groupsock::output(UsageEnvironment& env, unsigned char* buffer, unsigned
 
 Boolean Groupsock::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 			      unsigned& bytesRead,
-			      struct sockaddr_in& fromAddressAndPort) {
+			      struct sockaddr_storage& fromAddressAndPort) {
   // Read data from the socket, and relay it across any attached tunnels
   //##### later make this code more general - independent of tunnels
 
@@ -325,7 +392,7 @@ Boolean Groupsock::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 
   // If we're a SSM group, make sure the source address matches:
   if (isSSM()
-      && fromAddressAndPort.sin_addr.s_addr != sourceFilterAddress().s_addr) {
+      && fromAddressAndPort != sourceFilterAddress()) {
     return True;
   }
 
@@ -341,14 +408,14 @@ Boolean Groupsock::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
     numMembers =
       outputToAllMembersExcept(NULL, ttl(),
 			       buffer, bytesRead,
-			       fromAddressAndPort.sin_addr.s_addr);
+			       ipv4Address(fromAddressAndPort));
     if (numMembers > 0) {
       statsRelayedIncoming.countPacket(numBytes);
       statsGroupRelayedIncoming.countPacket(numBytes);
     }
   }
   if (DebugLevel >= 3) {
-    env() << *this << ": read " << bytesRead << " bytes from " << AddressString(fromAddressAndPort).val() << ", port " << ntohs(fromAddressAndPort.sin_port);
+    env() << *this << ": read " << bytesRead << " bytes from " << AddressString(fromAddressAndPort).val() << ", port " << ntohs(portNum(fromAddressAndPort));
     if (numMembers > 0) {
       env() << "; relayed to " << numMembers << " members";
     }
@@ -359,10 +426,17 @@ Boolean Groupsock::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 }
 
 Boolean Groupsock::wasLoopedBackFromUs(UsageEnvironment& env,
-				       struct sockaddr_in& fromAddressAndPort) {
-  if (fromAddressAndPort.sin_addr.s_addr == ourIPAddress(env) ||
-      fromAddressAndPort.sin_addr.s_addr == 0x7F000001/*127.0.0.1*/) {
-    if (fromAddressAndPort.sin_port == sourcePortNum()) {
+				       struct sockaddr_storage const& fromAddressAndPort) {
+  Boolean fromUs;
+  if (fromAddressAndPort.ss_family == AF_INET6) {
+    fromUs = fromAddressAndPort == ourIPv6Address(env)
+      || IN6_IS_ADDR_LOOPBACK(&((struct sockaddr_in6 const&)fromAddressAndPort).sin6_addr);
+  } else {
+    netAddressBits fromAddr = ipv4Address(fromAddressAndPort);
+    fromUs = fromAddr == ourIPAddress(env) || fromAddr == 0x7F000001/*127.0.0.1*/;
+  }
+  if (fromUs) {
+    if (portNum(fromAddressAndPort) == sourcePortNum()) {
 #ifdef DEBUG_LOOPBACK_CHECKING
       if (DebugLevel >= 3) {
 	env() << *this << ": got looped-back packet\n";
@@ -376,10 +450,10 @@ Boolean Groupsock::wasLoopedBackFromUs(UsageEnvironment& env,
 }
 
 destRecord* Groupsock
-::lookupDestRecordFromDestination(struct sockaddr_in const& destAddrAndPort) const {
+::lookupDestRecordFromDestination(struct sockaddr_storage const& destAddrAndPort) const {
   for (destRecord* dest = fDests; dest != NULL; dest = dest->fNext) {
-    if (destAddrAndPort.sin_addr.s_addr == dest->fGroupEId.groupAddress().s_addr
-	&& destAddrAndPort.sin_port == dest->fGroupEId.portNum()) {
+    if (destAddrAndPort == dest->fGroupEId.groupAddress()
+	&& portNum(destAddrAndPort) == dest->fGroupEId.portNum()) {
       return dest;
     }
   }
@@ -458,7 +532,7 @@ int Groupsock::outputToAllMembersExcept(DirectedNetInterface* exceptInterface,
       trailer += trailerOffset;
 
       if (fDests != NULL) {
-	trailer->address() = fDests->fGroupEId.groupAddress().s_addr;
+	trailer->address() = ipv4Address(fDests->fGroupEId.groupAddress()); // Note: Tunneling is IPv4-only
 	Port destPort(ntohs(fDests->fGroupEId.portNum()));
 	trailer->port() = destPort; // structure copy
       }
@@ -466,7 +540,7 @@ int Groupsock::outputToAllMembersExcept(DirectedNetInterface* exceptInterface,
       trailer->command() = tunnelCmd;
 
       if (isSSM()) {
-	trailer->auxAddress() = sourceFilterAddress().s_addr;
+	trailer->auxAddress() = ipv4Address(sourceFilterAddress());
       }
 
       if (misaligned) {
@@ -578,17 +652,22 @@ static Groupsock* getGroupsockBySocket(UsageEnvironment& env, int sock) {
   return NULL;
 }
 
+static struct sockaddr_storage const& noSourceFilterAddress() {
+  static struct sockaddr_storage noAddress; // all-zeros: family AF_UNSPEC
+  return noAddress;
+}
+
 Groupsock*
 GroupsockLookupTable::Fetch(UsageEnvironment& env,
-			    netAddressBits groupAddress,
+			    struct sockaddr_storage const& groupAddress,
 			    Port port, u_int8_t ttl,
 			    Boolean& isNew) {
   isNew = False;
   Groupsock* groupsock;
   do {
-    groupsock = (Groupsock*) fTable.Lookup(groupAddress, (~0), port);
+    groupsock = (Groupsock*) fTable.Lookup(groupAddress, noSourceFilterAddress(), port);
     if (groupsock == NULL) { // we need to create one:
-      groupsock = AddNew(env, groupAddress, (~0), port, ttl);
+      groupsock = AddNew(env, groupAddress, noSourceFilterAddress(), port, ttl);
       if (groupsock == NULL) break;
       isNew = True;
     }
@@ -599,8 +678,8 @@ GroupsockLookupTable::Fetch(UsageEnvironment& env,
 
 Groupsock*
 GroupsockLookupTable::Fetch(UsageEnvironment& env,
-			    netAddressBits groupAddress,
-			    netAddressBits sourceFilterAddr, Port port,
+			    struct sockaddr_storage const& groupAddress,
+			    struct sockaddr_storage const& sourceFilterAddr, Port port,
 			    Boolean& isNew) {
   isNew = False;
   Groupsock* groupsock;
@@ -618,13 +697,13 @@ GroupsockLookupTable::Fetch(UsageEnvironment& env,
 }
 
 Groupsock*
-GroupsockLookupTable::Lookup(netAddressBits groupAddress, Port port) {
-  return (Groupsock*) fTable.Lookup(groupAddress, (~0), port);
+GroupsockLookupTable::Lookup(struct sockaddr_storage const& groupAddress, Port port) {
+  return (Groupsock*) fTable.Lookup(groupAddress, noSourceFilterAddress(), port);
 }
 
 Groupsock*
-GroupsockLookupTable::Lookup(netAddressBits groupAddress,
-			     netAddressBits sourceFilterAddr, Port port) {
+GroupsockLookupTable::Lookup(struct sockaddr_storage const& groupAddress,
+			     struct sockaddr_storage const& sourceFilterAddr, Port port) {
   return (Groupsock*) fTable.Lookup(groupAddress, sourceFilterAddr, port);
 }
 
@@ -634,26 +713,23 @@ Groupsock* GroupsockLookupTable::Lookup(UsageEnvironment& env, int sock) {
 
 Boolean GroupsockLookupTable::Remove(Groupsock const* groupsock) {
   unsetGroupsockBySocket(groupsock);
-  return fTable.Remove(groupsock->groupAddress().s_addr,
-		       groupsock->sourceFilterAddress().s_addr,
+  return fTable.Remove(groupsock->groupAddress(),
+		       groupsock->sourceFilterAddress(),
 		       groupsock->port());
 }
 
 Groupsock* GroupsockLookupTable::AddNew(UsageEnvironment& env,
-					netAddressBits groupAddress,
-					netAddressBits sourceFilterAddress,
+					struct sockaddr_storage const& groupAddress,
+					struct sockaddr_storage const& sourceFilterAddress,
 					Port port, u_int8_t ttl) {
   Groupsock* groupsock;
   do {
-    struct in_addr groupAddr; groupAddr.s_addr = groupAddress;
-    if (sourceFilterAddress == netAddressBits(~0)) {
+    if (sourceFilterAddress.ss_family == AF_UNSPEC) {
       // regular, ISM groupsock
-      groupsock = new Groupsock(env, groupAddr, port, ttl);
+      groupsock = new Groupsock(env, groupAddress, port, ttl);
     } else {
       // SSM groupsock
-      struct in_addr sourceFilterAddr;
-      sourceFilterAddr.s_addr = sourceFilterAddress;
-      groupsock = new Groupsock(env, groupAddr, sourceFilterAddr, port);
+      groupsock = new Groupsock(env, groupAddress, sourceFilterAddress, port);
     }
 
     if (groupsock == NULL || groupsock->socketNum() < 0) break;
@@ -29,6 +29,9 @@ extern "C" int initializeWinsockIfNecessary();
 #include <sys/time.h>
 #if !defined(_WIN32)
 #include <netinet/tcp.h>
+#ifdef SO_TXTIME
+#include <linux/net_tstamp.h>
+#endif
 #ifdef __ANDROID_NDK__
 #include <android/ndk-version.h>
 #define ANDROID_OLD_NDK __NDK_MAJOR__ < 17
@@ -42,6 +45,10 @@ extern "C" int initializeWinsockIfNecessary();
 #include <signal.h>
 #define USE_SIGNALS 1
 #endif
+#if !defined(__WIN32__) && !defined(_WIN32) && !defined(VXWORKS) && !defined(__ANDROID_NDK__)
+#include <ifaddrs.h>
+#define USE_GETIFADDRS 1
+#endif
 #include <stdio.h>
 
 // By default, use INADDR_ANY for the sending and receiving interfaces:
@@ -63,11 +70,24 @@ NoReuse::~NoReuse() {
 }
 
 
+DualStack::DualStack(UsageEnvironment& env)
+  : fEnv(env) {
+  groupsockPriv(fEnv)->dualStackFlag = 1;
+}
+
+DualStack::~DualStack() {
+  groupsockPriv(fEnv)->dualStackFlag = 0;
+  reclaimGroupsockPriv(fEnv);
+}
+
+
 _groupsockPriv* groupsockPriv(UsageEnvironment& env) {
   if (env.groupsockPriv == NULL) { // We need to create it
     _groupsockPriv* result = new _groupsockPriv;
     result->socketTable = NULL;
     result->reuseFlag = 1; // default value => allow reuse of socket numbers
+    result->dualStackFlag = 0; // default value => IPv6 datagram sockets are IPv6-only
+    result->resolverState = NULL;
     env.groupsockPriv = result;
   }
   return (_groupsockPriv*)(env.groupsockPriv);
@@ -75,45 +95,77 @@ _groupsockPriv* groupsockPriv(UsageEnvironment& env) {
 
 void reclaimGroupsockPriv(UsageEnvironment& env) {
   _groupsockPriv* priv = (_groupsockPriv*)(env.groupsockPriv);
-  if (priv->socketTable == NULL && priv->reuseFlag == 1/*default value*/) {
+  if (priv->socketTable == NULL && priv->reuseFlag == 1/*default value*/ && priv->dualStackFlag == 0
+      && priv->resolverState == NULL) {
     // We can delete the structure (to save space); it will get created again, if needed:
     delete priv;
     env.groupsockPriv = NULL;
   }
 }
 
-static int createSocket(int type) {
-  // Call "socket()" to create a (IPv4) socket of the specified type.
+static int createSocket(int domain, int type) {
+  // Call "socket()" to create a (IPv4 or IPv6) socket of the specified type.
   // But also set it to have the 'close on exec' property (if we can)
   int sock;
 
 #ifdef SOCK_CLOEXEC
-  sock = socket(AF_INET, type|SOCK_CLOEXEC, 0);
+  sock = socket(domain, type|SOCK_CLOEXEC, 0);
   if (sock != -1 || errno != EINVAL) return sock;
   // An "errno" of EINVAL likely means that the system wasn't happy with the SOCK_CLOEXEC; fall through and try again without it:
 #endif
 
-  sock = socket(AF_INET, type, 0);
+  sock = socket(domain, type, 0);
 #ifdef FD_CLOEXEC
   if (sock != -1) fcntl(sock, F_SETFD, FD_CLOEXEC);
 #endif
   return sock;
 }
 
-int setupDatagramSocket(UsageEnvironment& env, Port port) {
+static Boolean setIPv6Only(UsageEnvironment& env, int socket, Boolean ipv6Only = True) {
+#ifdef IPV6_V6ONLY
+  int const v6Only = ipv6Only ? 1 : 0;
+  if (setsockopt(socket, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&v6Only, sizeof v6Only) < 0) {
+    socketErr(env, "setsockopt(IPV6_V6ONLY) error: ");
+    return False;
+  }
+#endif
+  return True;
+}
+
+static int bindSocket(int socket, int domain, netAddressBits ipv4Addr, Port port) {
+  if (domain == AF_INET6) {
+    struct sockaddr_in6 name;
+    memset(&name, 0, sizeof name);
+    name.sin6_family = AF_INET6;
+    name.sin6_addr = in6addr_any;
+    name.sin6_port = port.num();
+    return bind(socket, (struct sockaddr*)&name, sizeof name);
+  }
+
+  MAKE_SOCKADDR_IN(name, ipv4Addr, port.num());
+  return bind(socket, (struct sockaddr*)&name, sizeof name);
+}
+
+int setupDatagramSocket(UsageEnvironment& env, Port port, int domain) {
   if (!initializeWinsockIfNecessary()) {
     socketErr(env, "Failed to initialize 'winsock': ");
     return -1;
   }
 
-  int newSocket = createSocket(SOCK_DGRAM);
+  int newSocket = createSocket(domain, SOCK_DGRAM);
   if (newSocket < 0) {
     socketErr(env, "unable to create datagram socket: ");
     return newSocket;
   }
 
   int reuseFlag = groupsockPriv(env)->reuseFlag;
+  int dualStackFlag = groupsockPriv(env)->dualStackFlag;
   reclaimGroupsockPriv(env);
+  if (domain == AF_INET6 && !setIPv6Only(env, newSocket, !dualStackFlag)) {
+    closeSocket(newSocket);
+    return -1;
+  }
+
   if (setsockopt(newSocket, SOL_SOCKET, SO_REUSEADDR,
 		 (const char*)&reuseFlag, sizeof reuseFlag) < 0) {
     socketErr(env, "setsockopt(SO_REUSEADDR) error: ");
@@ -133,26 +185,37 @@ int setupDatagramSocket(UsageEnvironment& env, Port port) {
   }
 #endif
 
+  if (domain == AF_INET6) {
+#ifdef IPV6_MULTICAST_LOOP
+    const unsigned loop = 1;
+    if (setsockopt(newSocket, IPPROTO_IPV6, IPV6_MULTICAST_LOOP,
+		   (const char*)&loop, sizeof loop) < 0) {
+      socketErr(env, "setsockopt(IPV6_MULTICAST_LOOP) error: ");
+      closeSocket(newSocket);
+      return -1;
+    }
+#endif
+  } else {
 #ifdef IP_MULTICAST_LOOP
-  const u_int8_t loop = 1;
-  if (setsockopt(newSocket, IPPROTO_IP, IP_MULTICAST_LOOP,
-		 (const char*)&loop, sizeof loop) < 0) {
-    socketErr(env, "setsockopt(IP_MULTICAST_LOOP) error: ");
-    closeSocket(newSocket);
-    return -1;
-  }
+    const u_int8_t loop = 1;
+    if (setsockopt(newSocket, IPPROTO_IP, IP_MULTICAST_LOOP,
+		   (const char*)&loop, sizeof loop) < 0) {
+      socketErr(env, "setsockopt(IP_MULTICAST_LOOP) error: ");
+      closeSocket(newSocket);
+      return -1;
+    }
 #endif
+  }
 #endif
 
   // Note: Windoze requires binding, even if the port number is 0
   netAddressBits addr = INADDR_ANY;
 #if defined(__WIN32__) || defined(_WIN32)
 #else
-  if (port.num() != 0 || ReceivingInterfaceAddr != INADDR_ANY) {
+  if (port.num() != 0 || (domain == AF_INET && ReceivingInterfaceAddr != INADDR_ANY)) {
 #endif
     if (port.num() == 0) addr = ReceivingInterfaceAddr;
-    MAKE_SOCKADDR_IN(name, addr, port.num());
-    if (bind(newSocket, (struct sockaddr*)&name, sizeof name) != 0) {
+    if (bindSocket(newSocket, domain, addr, port) != 0) {
       char tmpBuffer[100];
       sprintf(tmpBuffer, "bind() error (port number: %d): ",
 	      ntohs(port.num()));
@@ -165,8 +228,8 @@ int setupDatagramSocket(UsageEnvironment& env, Port port) {
   }
 #endif
 
-  // Set the sending interface for multicasts, if it's not the default:
-  if (SendingInterfaceAddr != INADDR_ANY) {
+  // Set the sending interface for (IPv4) multicasts, if it's not the default:
+  if (domain == AF_INET && SendingInterfaceAddr != INADDR_ANY) {
     struct in_addr addr;
     addr.s_addr = SendingInterfaceAddr;
 
@@ -255,18 +318,24 @@ Boolean setSocketKeepAlive(int sock) {
 }
 
 int setupStreamSocket(UsageEnvironment& env,
-                      Port port, Boolean makeNonBlocking, Boolean setKeepAlive) {
+                      Port port, Boolean makeNonBlocking, Boolean setKeepAlive,
+		      int domain) {
   if (!initializeWinsockIfNecessary()) {
     socketErr(env, "Failed to initialize 'winsock': ");
     return -1;
   }
 
-  int newSocket = createSocket(SOCK_STREAM);
+  int newSocket = createSocket(domain, SOCK_STREAM);
   if (newSocket < 0) {
     socketErr(env, "unable to create stream socket: ");
     return newSocket;
   }
 
+  if (domain == AF_INET6 && !setIPv6Only(env, newSocket)) {
+    closeSocket(newSocket);
+    return -1;
+  }
+
   int reuseFlag = groupsockPriv(env)->reuseFlag;
   reclaimGroupsockPriv(env);
   if (setsockopt(newSocket, SOL_SOCKET, SO_REUSEADDR,
@@ -297,10 +366,9 @@ int setupStreamSocket(UsageEnvironment& env,
   // Note: Windoze requires binding, even if the port number is 0
 #if defined(__WIN32__) || defined(_WIN32)
 #else
-  if (port.num() != 0 || ReceivingInterfaceAddr != INADDR_ANY) {
+  if (port.num() != 0 || (domain == AF_INET && ReceivingInterfaceAddr != INADDR_ANY)) {
 #endif
-    MAKE_SOCKADDR_IN(name, ReceivingInterfaceAddr, port.num());
-    if (bind(newSocket, (struct sockaddr*)&name, sizeof name) != 0) {
+    if (bindSocket(newSocket, domain, ReceivingInterfaceAddr, port) != 0) {
       char tmpBuffer[100];
       sprintf(tmpBuffer, "bind() error (port number: %d): ",
 	      ntohs(port.num()));
@@ -336,7 +404,7 @@ int setupStreamSocket(UsageEnvironment& env,
 
 int readSocket(UsageEnvironment& env,
 	       int socket, unsigned char* buffer, unsigned bufferSize,
-	       struct sockaddr_in& fromAddress) {
+	       struct sockaddr_storage& fromAddress) {
   SOCKLEN_T addressSize = sizeof fromAddress;
   int bytesRead = recvfrom(socket, (char*)buffer, bufferSize, 0,
 			   (struct sockaddr*)&fromAddress,
@@ -357,7 +425,7 @@ int readSocket(UsageEnvironment& env,
 	|| err == EAGAIN
 #endif
 	|| err == 113 /*EHOSTUNREACH (Linux)*/) { // Why does Linux return this for datagram sock?
-      fromAddress.sin_addr.s_addr = 0;
+      fromAddress.ss_family = AF_UNSPEC; // i.e., no address
       return 0;
     }
     //##### END HACK
@@ -367,36 +435,55 @@ int readSocket(UsageEnvironment& env,
     return -1;
   }
 
+  if (fromAddress.ss_family == AF_INET6
+      && IN6_IS_ADDR_V4MAPPED(&((struct sockaddr_in6 const&)fromAddress).sin6_addr)) {
+    // The packet came (via a "DualStack" socket) from an IPv4 sender.  Report it by its IPv4 address:
+    struct sockaddr_in6 const from6 = (struct sockaddr_in6 const&)fromAddress;
+    netAddressBits fromAddr4;
+    memcpy(&fromAddr4, &from6.sin6_addr.s6_addr[12], sizeof fromAddr4);
+    MAKE_SOCKADDR_IN(from4, fromAddr4, from6.sin6_port);
+    memset(&fromAddress, 0, sizeof fromAddress);
+    memcpy(&fromAddress, &from4, sizeof from4);
+  }
+
   return bytesRead;
 }
 
 Boolean writeSocket(UsageEnvironment& env,
-		    int socket, struct in_addr address, portNumBits portNum,
+		    int socket, struct sockaddr_storage const& addressAndPort,
 		    u_int8_t ttlArg,
 		    unsigned char* buffer, unsigned bufferSize) {
-  // Before sending, set the socket's TTL:
+  // Before sending, set the socket's TTL (for IPv6: its 'hop limit'):
+  if (addressAndPort.ss_family == AF_INET6) {
+    int hops = (int)ttlArg;
+    if (setsockopt(socket, IPPROTO_IPV6, IPV6_MULTICAST_HOPS,
+		   (const char*)&hops, sizeof hops) < 0) {
+      socketErr(env, "setsockopt(IPV6_MULTICAST_HOPS) error: ");
+      return False;
+    }
+  } else {
 #if defined(__WIN32__) || defined(_WIN32)
 #define TTL_TYPE int
 #else
 #define TTL_TYPE u_int8_t
 #endif
-  TTL_TYPE ttl = (TTL_TYPE)ttlArg;
-  if (setsockopt(socket, IPPROTO_IP, IP_MULTICAST_TTL,
-		 (const char*)&ttl, sizeof ttl) < 0) {
-    socketErr(env, "setsockopt(IP_MULTICAST_TTL) error: ");
-    return False;
+    TTL_TYPE ttl = (TTL_TYPE)ttlArg;
+    if (setsockopt(socket, IPPROTO_IP, IP_MULTICAST_TTL,
+		   (const char*)&ttl, sizeof ttl) < 0) {
+      socketErr(env, "setsockopt(IP_MULTICAST_TTL) error: ");
+      return False;
+    }
   }
 
-  return writeSocket(env, socket, address, portNum, buffer, bufferSize);
+  return writeSocket(env, socket, addressAndPort, buffer, bufferSize);
 }
 
 Boolean writeSocket(UsageEnvironment& env,
-		    int socket, struct in_addr address, portNumBits portNum,
+		    int socket, struct sockaddr_storage const& addressAndPort,
 		    unsigned char* buffer, unsigned bufferSize) {
   do {
-    MAKE_SOCKADDR_IN(dest, address.s_addr, portNum);
     int bytesSent = sendto(socket, (char*)buffer, bufferSize, 0,
-			   (struct sockaddr*)&dest, sizeof dest);
+			   (struct sockaddr const*)&addressAndPort, addressSize(addressAndPort));
     if (bytesSent != (int)bufferSize) {
       char tmpBuf[100];
       sprintf(tmpBuf, "writeSocket(%d), sendTo() error: wrote %d bytes instead of %u: ", socket, bytesSent, bufferSize);
@@ -410,6 +497,77 @@ Boolean writeSocket(UsageEnvironment& env,
   return False;
 }
 
+Boolean enableSocketTxTime(UsageEnvironment& env, int socket) {
+#ifdef SO_TXTIME
+  struct sock_txtime txTimeConfig;
+  txTimeConfig.clockid = CLOCK_MONOTONIC;
+  txTimeConfig.flags = 0;
+  if (setsockopt(socket, SOL_SOCKET, SO_TXTIME, (const char*)&txTimeConfig, sizeof txTimeConfig) < 0) {
+    socketErr(env, "setsockopt(SO_TXTIME) error: ");
+    return False;
+  }
+  return True;
+#else
+  env.setResultMsg("SO_TXTIME is not supported on this system");
+  return False;
+#endif
+}
+
+Boolean writeSocketAtTime(UsageEnvironment& env,
+			  int socket, struct sockaddr_storage const& addressAndPort,
+			  unsigned char* buffer, unsigned bufferSize, u_int64_t txTimeNSecs) {
+#ifdef SO_TXTIME
+  do {
+    struct iovec iov;
+    iov.iov_base = buffer;
+    iov.iov_len = bufferSize;
+
+    char control[CMSG_SPACE(sizeof txTimeNSecs)];
+    memset(control, 0, sizeof control);
+    struct msghdr msg;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_name = (void*)&addressAndPort;
+    msg.msg_namelen = addressSize(addressAndPort);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof control;
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_TXTIME;
+    cmsg->cmsg_len = CMSG_LEN(sizeof txTimeNSecs);
+    memcpy(CMSG_DATA(cmsg), &txTimeNSecs, sizeof txTimeNSecs);
+
+    int bytesSent = sendmsg(socket, &msg, 0);
+    if (bytesSent != (int)bufferSize) {
+      char tmpBuf[100];
+      sprintf(tmpBuf, "writeSocketAtTime(%d), sendmsg() error: wrote %d bytes instead of %u: ", socket, bytesSent, bufferSize);
+      socketErr(env, tmpBuf);
+      break;
+    }
+
+    return True;
+  } while (0);
+
+  return False;
+#else
+  return writeSocket(env, socket, addressAndPort, buffer, bufferSize);
+#endif
+}
+
+u_int64_t monotonicTimeNSecs() {
+#if defined(CLOCK_MONOTONIC) && !defined(_WIN32)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u_int64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (u_int64_t)tv.tv_sec*1000000000 + tv.tv_usec*1000;
+#endif
+}
+
 void ignoreSigPipeOnSocket(int socketNum) {
   #ifdef USE_SIGNALS
   #ifdef SO_NOSIGPIPE
@@ -498,11 +656,24 @@ static void clearMulticastAllSocketOption(int socket) {
 }
 
 Boolean socketJoinGroup(UsageEnvironment& env, int socket,
-			netAddressBits groupAddress){
+			struct sockaddr_storage const& groupAddress){
   if (!IsMulticastAddress(groupAddress)) return True; // ignore this case
 
+  if (groupAddress.ss_family == AF_INET6) {
+    struct ipv6_mreq imr6;
+    imr6.ipv6mr_multiaddr = ((struct sockaddr_in6 const&)groupAddress).sin6_addr;
+    imr6.ipv6mr_interface = 0; // the default interface
+    if (setsockopt(socket, IPPROTO_IPV6, IPV6_JOIN_GROUP,
+		   (const char*)&imr6, sizeof imr6) < 0) {
+      socketErr(env, "setsockopt(IPV6_JOIN_GROUP) error: ");
+      return False;
+    }
+
+    return True;
+  }
+
   struct ip_mreq imr;
-  imr.imr_multiaddr.s_addr = groupAddress;
+  imr.imr_multiaddr.s_addr = ipv4Address(groupAddress);
   imr.imr_interface.s_addr = ReceivingInterfaceAddr;
   if (setsockopt(socket, IPPROTO_IP, IP_ADD_MEMBERSHIP,
 		 (const char*)&imr, sizeof (struct ip_mreq)) < 0) {
@@ -524,11 +695,19 @@ Boolean socketJoinGroup(UsageEnvironment& env, int socket,
 }
 
 Boolean socketLeaveGroup(UsageEnvironment&, int socket,
-			 netAddressBits groupAddress) {
+			 struct sockaddr_storage const& groupAddress) {
   if (!IsMulticastAddress(groupAddress)) return True; // ignore this case
 
+  if (groupAddress.ss_family == AF_INET6) {
+    struct ipv6_mreq imr6;
+    imr6.ipv6mr_multiaddr = ((struct sockaddr_in6 const&)groupAddress).sin6_addr;
+    imr6.ipv6mr_interface = 0;
+    return setsockopt(socket, IPPROTO_IPV6, IPV6_LEAVE_GROUP,
+		      (const char*)&imr6, sizeof imr6) == 0;
+  }
+
   struct ip_mreq imr;
-  imr.imr_multiaddr.s_addr = groupAddress;
+  imr.imr_multiaddr.s_addr = ipv4Address(groupAddress);
   imr.imr_interface.s_addr = ReceivingInterfaceAddr;
   if (setsockopt(socket, IPPROTO_IP, IP_DROP_MEMBERSHIP,
 		 (const char*)&imr, sizeof (struct ip_mreq)) < 0) {
@@ -561,19 +740,48 @@ struct ip_mreq_source {
 
 #endif
 
+// For IPv6, the source-specific join/leave operations use the protocol-independent "MCAST_JOIN_SOURCE_GROUP" and
+// "MCAST_LEAVE_SOURCE_GROUP" commands (RFC 3678), where available:
+static Boolean socketJoinOrLeaveGroupSSM6(int socket, Boolean join,
+					  struct sockaddr_storage const& groupAddress,
+					  struct sockaddr_storage const& sourceFilterAddr) {
+#ifdef MCAST_JOIN_SOURCE_GROUP
+  struct group_source_req gsr;
+  memset(&gsr, 0, sizeof gsr);
+  gsr.gsr_interface = 0; // the default interface
+  memcpy(&gsr.gsr_group, &groupAddress, sizeof (struct sockaddr_in6));
+  memcpy(&gsr.gsr_source, &sourceFilterAddr, sizeof (struct sockaddr_in6));
+  ((struct sockaddr_in6&)gsr.gsr_group).sin6_port = ((struct sockaddr_in6&)gsr.gsr_source).sin6_port = 0;
+  return setsockopt(socket, IPPROTO_IPV6, join ? MCAST_JOIN_SOURCE_GROUP : MCAST_LEAVE_SOURCE_GROUP,
+		    (const char*)&gsr, sizeof gsr) == 0;
+#else
+  return False;
+#endif
+}
+
 Boolean socketJoinGroupSSM(UsageEnvironment& env, int socket,
-			   netAddressBits groupAddress,
-			   netAddressBits sourceFilterAddr) {
+			   struct sockaddr_storage const& groupAddress,
+			   struct sockaddr_storage const& sourceFilterAddr) {
   if (!IsMulticastAddress(groupAddress)) return True; // ignore this case
 
+  if (groupAddress.ss_family == AF_INET6) {
+    if (sourceFilterAddr.ss_family != AF_INET6
+	|| !socketJoinOrLeaveGroupSSM6(socket, True, groupAddress, sourceFilterAddr)) {
+      socketErr(env, "setsockopt(MCAST_JOIN_SOURCE_GROUP) error: ");
+      return False;
+    }
+
+    return True;
+  }
+
   struct ip_mreq_source imr;
 #if ANDROID_OLD_NDK
-    imr.imr_multiaddr = groupAddress;
-    imr.imr_sourceaddr = sourceFilterAddr;
+    imr.imr_multiaddr = ipv4Address(groupAddress);
+    imr.imr_sourceaddr = ipv4Address(sourceFilterAddr);
     imr.imr_interface = ReceivingInterfaceAddr;
 #else
-    imr.imr_multiaddr.s_addr = groupAddress;
-    imr.imr_sourceaddr.s_addr = sourceFilterAddr;
+    imr.imr_multiaddr.s_addr = ipv4Address(groupAddress);
+    imr.imr_sourceaddr.s_addr = ipv4Address(sourceFilterAddr);
     imr.imr_interface.s_addr = ReceivingInterfaceAddr;
 #endif
   if (setsockopt(socket, IPPROTO_IP, IP_ADD_SOURCE_MEMBERSHIP,
@@ -588,18 +796,23 @@ Boolean socketJoinGroupSSM(UsageEnvironment& env, int socket,
 }
 
 Boolean socketLeaveGroupSSM(UsageEnvironment& /*env*/, int socket,
-			    netAddressBits groupAddress,
-			    netAddressBits sourceFilterAddr) {
+			    struct sockaddr_storage const& groupAddress,
+			    struct sockaddr_storage const& sourceFilterAddr) {
   if (!IsMulticastAddress(groupAddress)) return True; // ignore this case
 
+  if (groupAddress.ss_family == AF_INET6) {
+    return sourceFilterAddr.ss_family == AF_INET6
+      && socketJoinOrLeaveGroupSSM6(socket, False, groupAddress, sourceFilterAddr);
+  }
+
   struct ip_mreq_source imr;
 #if ANDROID_OLD_NDK
-    imr.imr_multiaddr = groupAddress;
-    imr.imr_sourceaddr = sourceFilterAddr;
+    imr.imr_multiaddr = ipv4Address(groupAddress);
+    imr.imr_sourceaddr = ipv4Address(sourceFilterAddr);
     imr.imr_interface = ReceivingInterfaceAddr;
 #else
-    imr.imr_multiaddr.s_addr = groupAddress;
-    imr.imr_sourceaddr.s_addr = sourceFilterAddr;
+    imr.imr_multiaddr.s_addr = ipv4Address(groupAddress);
+    imr.imr_sourceaddr.s_addr = ipv4Address(sourceFilterAddr);
     imr.imr_interface.s_addr = ReceivingInterfaceAddr;
 #endif
   if (setsockopt(socket, IPPROTO_IP, IP_DROP_SOURCE_MEMBERSHIP,
@@ -611,23 +824,25 @@ Boolean socketLeaveGroupSSM(UsageEnvironment& /*env*/, int socket,
 }
 
 
-static Boolean getSourcePort0(int socket, portNumBits& resultPortNum/*host order*/) {
-  sockaddr_in test; test.sin_port = 0;
+static Boolean getSourcePort0(int socket, portNumBits& resultPortNum/*host order*/, int& family) {
+  struct sockaddr_storage test;
+  memset(&test, 0, sizeof test);
   SOCKLEN_T len = sizeof test;
   if (getsockname(socket, (struct sockaddr*)&test, &len) < 0) return False;
 
-  resultPortNum = ntohs(test.sin_port);
+  family = test.ss_family;
+  resultPortNum = ntohs(portNum(test));
   return True;
 }
 //假如传入的端口号为0，该函数可以获取内核分配的端口
 Boolean getSourcePort(UsageEnvironment& env, int socket, Port& port) {
   portNumBits portNum = 0;
-  if (!getSourcePort0(socket, portNum) || portNum == 0) {
+  int family = AF_INET;
+  if (!getSourcePort0(socket, portNum, family) || portNum == 0) {
     // Hack - call bind(), then try again:
-    MAKE_SOCKADDR_IN(name, INADDR_ANY, 0);
-    bind(socket, (struct sockaddr*)&name, sizeof name);
+    bindSocket(socket, family, INADDR_ANY, 0);
 
-    if (!getSourcePort0(socket, portNum) || portNum == 0) {
+    if (!getSourcePort0(socket, portNum, family) || portNum == 0) {
       socketErr(env, "getsockname() error: ");
       return False;
     }
@@ -650,7 +865,7 @@ Boolean loopbackWorks = 1;
 netAddressBits ourIPAddress(UsageEnvironment& env) {
   static netAddressBits ourAddress = 0;
   int sock = -1;
-  struct in_addr testAddr;
+  struct sockaddr_storage testAddr;
 
   if (ReceivingInterfaceAddr != INADDR_ANY) {
     // Hack: If we were told to receive on a specific interface address, then 
@@ -660,8 +875,8 @@ netAddressBits ourIPAddress(UsageEnvironment& env) {
 
   if (ourAddress == 0) {
     // We need to find our source address
-    struct sockaddr_in fromAddr;
-    fromAddr.sin_addr.s_addr = 0;
+    struct sockaddr_storage fromAddr;
+    setIPv4Address(fromAddr, 0);
 
     // Get our address by sending a (0-TTL) multicast packet,
     // receiving it, and looking at the source address used.
@@ -671,18 +886,18 @@ netAddressBits ourIPAddress(UsageEnvironment& env) {
       loopbackWorks = 0; // until we learn otherwise
 
 #ifndef DISABLE_LOOPBACK_IP_ADDRESS_CHECK
-      testAddr.s_addr = our_inet_addr("228.67.43.91"); // arbitrary
-      Port testPort(15947); // ditto
+      Port testPort(15947); // arbitrary
+      setIPv4Address(testAddr, our_inet_addr("228.67.43.91"), testPort.num()); // ditto
 
       sock = setupDatagramSocket(env, testPort);
       if (sock < 0) break;
 
-      if (!socketJoinGroup(env, sock, testAddr.s_addr)) break;
+      if (!socketJoinGroup(env, sock, testAddr)) break;
 
       unsigned char testString[] = "hostIdTest";
       unsigned testStringLength = sizeof testString;
 
-      if (!writeSocket(env, sock, testAddr, testPort.num(), 0,
+      if (!writeSocket(env, sock, testAddr, 0,
 		       testString, testStringLength)) break;
 
       // Block until the socket is readable (with a 5-second timeout):
@@ -706,12 +921,12 @@ netAddressBits ourIPAddress(UsageEnvironment& env) {
       }
 
       // We use this packet's source address, if it's good:
-      loopbackWorks = !badAddressForUs(fromAddr.sin_addr.s_addr);
+      loopbackWorks = !badAddressForUs(ipv4Address(fromAddr));
 #endif
     } while (0);
 
     if (sock >= 0) {
-      socketLeaveGroup(env, sock, testAddr.s_addr);
+      socketLeaveGroup(env, sock, testAddr);
       closeSocket(sock);
     }
 
@@ -727,7 +942,7 @@ netAddressBits ourIPAddress(UsageEnvironment& env) {
       }
 
       // Try to resolve "hostname" to an IP address:
-      NetAddressList addresses(hostname);
+      NetAddressList addresses(hostname, AF_INET);
       NetAddressList::Iterator iter(addresses);
       NetAddress const* address;
 
@@ -742,11 +957,11 @@ netAddressBits ourIPAddress(UsageEnvironment& env) {
       }
 
       // Assign the address that we found to "fromAddr" (as if the 'loopback' method had worked), to simplify the code below: 
-      fromAddr.sin_addr.s_addr = addr;
+      setIPv4Address(fromAddr, addr);
     } while (0);
 
     // Make sure we have a good address:
-    netAddressBits from = fromAddr.sin_addr.s_addr;
+    netAddressBits from = ipv4Address(fromAddr);
     if (badAddressForUs(from)) {
       char tmp[100];
       sprintf(tmp, "This computer has an invalid IP address: %s", AddressString(from).val());
@@ -766,6 +981,65 @@ netAddressBits ourIPAddress(UsageEnvironment& env) {
   return ourAddress;
 }
 
+static Boolean isGoodIPv6AddressForUs(struct in6_addr const& addr) {
+  // We want a global (or unique-local) unicast address:
+  return !(IN6_IS_ADDR_UNSPECIFIED(&addr) || IN6_IS_ADDR_LOOPBACK(&addr) || IN6_IS_ADDR_LINKLOCAL(&addr)
+	   || IN6_IS_ADDR_MULTICAST(&addr) || IN6_IS_ADDR_V4MAPPED(&addr));
+}
+
+struct sockaddr_storage const& ourIPv6Address(UsageEnvironment& /*env*/) {
+  static struct sockaddr_storage ourAddress6;
+  static Boolean haveLookedForOurAddress6 = False;
+
+  if (!haveLookedForOurAddress6) {
+    haveLookedForOurAddress6 = True;
+    memset(&ourAddress6, 0, sizeof ourAddress6);
+    ourAddress6.ss_family = AF_INET6;
+    struct in6_addr& ourAddr6 = ((struct sockaddr_in6&)ourAddress6).sin6_addr;
+
+    // First, find the source address that we'd use to reach a (global) IPv6 address.  (As with "ourIPAddress()", this
+    // is the address that other nodes are most likely to see.)  Note that "connect()"ing a datagram socket sends nothing.
+    int sock = initializeWinsockIfNecessary() ? createSocket(AF_INET6, SOCK_DGRAM) : -1;
+    if (sock >= 0) {
+      struct sockaddr_in6 dest;
+      memset(&dest, 0, sizeof dest);
+      dest.sin6_family = AF_INET6;
+      dest.sin6_port = htons(9); // arbitrary
+      inet_pton(AF_INET6, "2001:db8::1", &dest.sin6_addr); // ditto (a 'documentation' address)
+
+      struct sockaddr_in6 src;
+      SOCKLEN_T len = sizeof src;
+      if (connect(sock, (struct sockaddr*)&dest, sizeof dest) == 0
+	  && getsockname(sock, (struct sockaddr*)&src, &len) == 0
+	  && isGoodIPv6AddressForUs(src.sin6_addr)) {
+	ourAddr6 = src.sin6_addr;
+      }
+      closeSocket(sock);
+    }
+
+#ifdef USE_GETIFADDRS
+    if (addressIsNull(ourAddress6)) {
+      // We have no route to global IPv6 addresses.  Instead, use the first good address of any of our interfaces:
+      struct ifaddrs* ifaddrList;
+      if (getifaddrs(&ifaddrList) == 0) {
+	for (struct ifaddrs* ifa = ifaddrList; ifa != NULL; ifa = ifa->ifa_next) {
+	  if (ifa->ifa_addr == NULL || ifa->ifa_addr->sa_family != AF_INET6) continue;
+
+	  struct in6_addr const& addr6 = ((struct sockaddr_in6*)ifa->ifa_addr)->sin6_addr;
+	  if (isGoodIPv6AddressForUs(addr6)) {
+	    ourAddr6 = addr6;
+	    break;
+	  }
+	}
+	freeifaddrs(ifaddrList);
+      }
+    }
+#endif
+  }
+
+  return ourAddress6;
+}
+
 netAddressBits chooseRandomIPv4SSMAddress(UsageEnvironment& env) {
   // First, a hack to ensure that our random number generator is seeded:
   (void) ourIPAddress(env);
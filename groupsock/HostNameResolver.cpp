@@ -0,0 +1,395 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "mTunnel" multicast access service
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// Non-blocking host name lookup, with a cache that's shared by all environments in the process
+// Implementation
+
+#include "HostNameResolver.hh"
+#include "GroupsockHelper.hh"
+
+#include <stdio.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#ifndef INADDR_NONE
+#define INADDR_NONE 0xFFFFFFFF
+#endif
+
+unsigned HostNameResolver::maxNumThreads = 4;
+unsigned HostNameResolver::positiveTTLSeconds = 60;
+unsigned HostNameResolver::negativeTTLSeconds = 5;
+
+typedef std::chrono::steady_clock ResolverClock;
+
+// Every so many new cache entries, we remove those that have expired (so that the cache doesn't grow forever):
+#define CACHE_PRUNING_INTERVAL 256
+
+class ResolverQuery;
+class ResolverEnvState;
+
+// A single "lookup()" (by one environment), waiting for its result:
+class ResolverWaiter {
+public:
+  ResolverWaiter(unsigned id, ResolverEnvState* envState,
+		 HostNameResolver::ResultHandler* resultHandler, void* clientData)
+    : fId(id), fEnvState(envState), fResultHandler(resultHandler), fClientData(clientData),
+      fQuery(NULL), fResult(NULL), fNext(NULL) {
+  }
+  virtual ~ResolverWaiter() { delete fResult; }
+
+  unsigned fId;
+  ResolverEnvState* fEnvState;
+  HostNameResolver::ResultHandler* fResultHandler;
+  void* fClientData;
+  ResolverQuery* fQuery; // non-NULL while the query is in progress
+  NetAddressList* fResult; // non-NULL once the lookup has completed
+  ResolverWaiter* fNext; // in the query's, or the environment's, list
+};
+
+// A cache entry: the (most recent) result of looking up a (host name, address family) pair, or a query in progress:
+class ResolverQuery {
+public:
+  ResolverQuery(char const* hostName, int addressFamily)
+    : fHostName(strDup(hostName)), fAddressFamily(addressFamily), fResult(NULL), fIsInProgress(False),
+      fWaiters(NULL), fNextQueued(NULL) {
+  }
+  virtual ~ResolverQuery() { delete[] fHostName; delete fResult; }
+
+  Boolean isFresh() const { return !fIsInProgress && fResult != NULL && ResolverClock::now() < fExpirationTime; }
+
+  char* fHostName;
+  int fAddressFamily;
+  NetAddressList* fResult; // the most recent result (if any)
+  ResolverClock::time_point fExpirationTime;
+  Boolean fIsInProgress; // if True, then we're in the queue, or a thread is calling "getaddrinfo()" for us
+  ResolverWaiter* fWaiters;
+  ResolverQuery* fNextQueued;
+};
+
+// The state (within "groupsockPriv()") of an environment that has lookups outstanding, or results waiting to be handled:
+class ResolverEnvState {
+public:
+  ResolverEnvState(UsageEnvironment& env);
+  virtual ~ResolverEnvState();
+
+  UsageEnvironment& fEnv;
+  EventTriggerId fTrigger; // signals that "fCompletedHead" is non-empty
+  ResolverWaiter* fCompletedHead;
+  ResolverWaiter* fCompletedTail;
+  unsigned fNumWaiters; // in progress or completed (but not yet handled)
+  Boolean fIsDeliveringResults;
+};
+
+// The process-wide state: created on first use, and never deleted (because threads may still be using it at exit).
+// All of its fields - and those of the objects above, except where noted - are guarded by "fMutex".
+class ResolverState {
+public:
+  static ResolverState& instance();
+
+  NetAddressList* lookupIfKnown(char const* hostName, int addressFamily);
+  ResolverQuery* startQuery(char const* hostName, int addressFamily);
+  void completeQuery(ResolverQuery* query, NetAddressList* result);
+  void removeFromCache(Boolean expiredEntriesOnly);
+
+  void addCompleted(ResolverWaiter* waiter);
+  void reclaimEnvStateIfUnused(ResolverEnvState* envState);
+
+  static void deliverResults(void* clientData); // called from an environment's event loop
+  void runThread();
+
+  std::mutex fMutex;
+  std::condition_variable fQueueIsNonEmpty;
+  HashTable* fCache; // maps "<address-family>/<host-name>" to "ResolverQuery*"
+  HashTable* fWaiters; // maps lookup ids to "ResolverWaiter*"
+  unsigned fNumNewCacheEntries;
+  ResolverQuery* fQueueHead;
+  ResolverQuery* fQueueTail;
+  unsigned fQueueSize;
+  unsigned fNumThreads, fNumIdleThreads;
+  unsigned fLastLookupId;
+
+private:
+  ResolverState();
+};
+
+static char* cacheKey(char const* hostName, int addressFamily) {
+  char* key = new char[strlen(hostName) + 20];
+  sprintf(key, "%d/%s", addressFamily, hostName);
+  return key;
+}
+
+static Boolean isAddressString(char const* hostName) {
+  if (our_inet_addr(hostName) != INADDR_NONE) return True;
+#if !defined(VXWORKS)
+  ipv6AddressBits addr6;
+  if (inet_pton(AF_INET6, hostName, addr6) == 1) return True;
+#endif
+  return False;
+}
+
+
+////////// ResolverEnvState implementation //////////
+
+ResolverEnvState::ResolverEnvState(UsageEnvironment& env)
+  : fEnv(env), fCompletedHead(NULL), fCompletedTail(NULL), fNumWaiters(0), fIsDeliveringResults(False) {
+  fTrigger = env.taskScheduler().createEventTrigger(ResolverState::deliverResults);
+}
+
+ResolverEnvState::~ResolverEnvState() {
+  fEnv.taskScheduler().deleteEventTrigger(fTrigger);
+}
+
+
+////////// ResolverState implementation //////////
+
+ResolverState& ResolverState::instance() {
+  static ResolverState* state = new ResolverState; // (C++11 makes this initialization thread-safe)
+  return *state;
+}
+
+ResolverState::ResolverState()
+  : fCache(HashTable::create(STRING_HASH_KEYS)), fWaiters(HashTable::create(ONE_WORD_HASH_KEYS)),
+    fNumNewCacheEntries(0), fQueueHead(NULL), fQueueTail(NULL), fQueueSize(0),
+    fNumThreads(0), fNumIdleThreads(0), fLastLookupId(0) {
+}
+
+NetAddressList* ResolverState::lookupIfKnown(char const* hostName, int addressFamily) {
+  // An address string needs no lookup (and isn't cached):
+  if (isAddressString(hostName)) return new NetAddressList(hostName, addressFamily);
+
+  char* key = cacheKey(hostName, addressFamily);
+  ResolverQuery* query = (ResolverQuery*)(fCache->Lookup(key));
+  delete[] key;
+
+  return query != NULL && query->isFresh() ? new NetAddressList(*query->fResult) : NULL;
+}
+
+ResolverQuery* ResolverState::startQuery(char const* hostName, int addressFamily) {
+  char* key = cacheKey(hostName, addressFamily);
+  ResolverQuery* query = (ResolverQuery*)(fCache->Lookup(key));
+  if (query == NULL) {
+    if (++fNumNewCacheEntries%CACHE_PRUNING_INTERVAL == 0) removeFromCache(True);
+
+    query = new ResolverQuery(hostName, addressFamily);
+    fCache->Add(key, query);
+  }
+  delete[] key;
+  if (query->fIsInProgress) return query; // the new lookup shares the existing query
+
+  // Queue the query, and make sure that a thread will handle it:
+  query->fIsInProgress = True;
+  query->fNextQueued = NULL;
+  if (fQueueTail == NULL) fQueueHead = query; else fQueueTail->fNextQueued = query;
+  fQueueTail = query;
+  ++fQueueSize;
+
+  if (fQueueSize > fNumIdleThreads && fNumThreads < HostNameResolver::maxNumThreads) {
+    ++fNumThreads;
+    std::thread(&ResolverState::runThread, this).detach();
+  } else {
+    fQueueIsNonEmpty.notify_one();
+  }
+
+  return query;
+}
+
+void ResolverState::completeQuery(ResolverQuery* query, NetAddressList* result) {
+  delete query->fResult; query->fResult = result;
+  query->fIsInProgress = False;
+  unsigned ttl = result->numAddresses() > 0 ? HostNameResolver::positiveTTLSeconds : HostNameResolver::negativeTTLSeconds;
+  query->fExpirationTime = ResolverClock::now() + std::chrono::seconds(ttl);
+
+  // Hand each waiter its own copy of the result:
+  ResolverWaiter* waiter = query->fWaiters;
+  query->fWaiters = NULL;
+  while (waiter != NULL) {
+    ResolverWaiter* nextWaiter = waiter->fNext;
+    waiter->fQuery = NULL;
+    waiter->fResult = new NetAddressList(*result);
+    addCompleted(waiter);
+    waiter = nextWaiter;
+  }
+}
+
+void ResolverState::removeFromCache(Boolean expiredEntriesOnly) {
+  // Move the entries that we're keeping (including all those that are in progress) into a new table:
+  HashTable* newCache = HashTable::create(STRING_HASH_KEYS);
+  HashTable::Iterator* iter = HashTable::Iterator::create(*fCache);
+  char const* key;
+  ResolverQuery* query;
+  while ((query = (ResolverQuery*)(iter->next(key))) != NULL) {
+    if (query->fIsInProgress || (expiredEntriesOnly && query->isFresh())) {
+      newCache->Add(key, query);
+    } else {
+      delete query;
+    }
+  }
+  delete iter;
+
+  delete fCache; fCache = newCache;
+}
+
+void ResolverState::addCompleted(ResolverWaiter* waiter) {
+  ResolverEnvState* envState = waiter->fEnvState;
+
+  waiter->fNext = NULL;
+  if (envState->fCompletedTail == NULL) envState->fCompletedHead = waiter; else envState->fCompletedTail->fNext = waiter;
+  envState->fCompletedTail = waiter;
+
+  // (We do this while holding "fMutex", so that it can't race with the deletion of the trigger.)
+  envState->fEnv.taskScheduler().triggerEvent(envState->fTrigger, envState);
+}
+
+void ResolverState::reclaimEnvStateIfUnused(ResolverEnvState* envState) {
+  // Note: This is called only from "envState"'s event loop.
+  if (envState->fNumWaiters > 0 || envState->fIsDeliveringResults) return;
+
+  UsageEnvironment& env = envState->fEnv;
+  delete envState;
+  groupsockPriv(env)->resolverState = NULL;
+  reclaimGroupsockPriv(env);
+}
+
+void ResolverState::deliverResults(void* clientData) {
+  ResolverEnvState* envState = (ResolverEnvState*)clientData;
+  if (envState == NULL) return;
+  ResolverState& state = instance();
+
+  envState->fIsDeliveringResults = True; // so that a "cancel()" from a result handler won't delete "envState"
+  while (1) {
+    ResolverWaiter* waiter;
+    {
+      std::lock_guard<std::mutex> lock(state.fMutex);
+      waiter = envState->fCompletedHead;
+      if (waiter == NULL) {
+	envState->fIsDeliveringResults = False;
+	state.reclaimEnvStateIfUnused(envState);
+	return;
+      }
+
+      envState->fCompletedHead = waiter->fNext;
+      if (envState->fCompletedHead == NULL) envState->fCompletedTail = NULL;
+      state.fWaiters->Remove((char const*)(uintptr_t)(waiter->fId));
+      --envState->fNumWaiters;
+    }
+
+    // Call the result handler without holding the lock (because it will likely do another "lookup()"):
+    (*waiter->fResultHandler)(waiter->fClientData, *waiter->fResult);
+    delete waiter;
+  }
+}
+
+void ResolverState::runThread() {
+  std::unique_lock<std::mutex> lock(fMutex);
+  while (1) {
+    while (fQueueHead == NULL) {
+      ++fNumIdleThreads;
+      fQueueIsNonEmpty.wait(lock);
+      --fNumIdleThreads;
+    }
+
+    ResolverQuery* query = fQueueHead;
+    fQueueHead = query->fNextQueued;
+    if (fQueueHead == NULL) fQueueTail = NULL;
+    --fQueueSize;
+
+    // Do the (blocking) lookup without holding the lock.  (The query can't be deleted meanwhile, because it's in progress.)
+    lock.unlock();
+    NetAddressList* result = new NetAddressList(query->fHostName, query->fAddressFamily);
+    lock.lock();
+
+    completeQuery(query, result);
+  }
+}
+
+
+////////// HostNameResolver implementation //////////
+
+unsigned HostNameResolver::lookup(UsageEnvironment& env, char const* hostName, int addressFamily,
+				  ResultHandler* resultHandler, void* clientData) {
+  ResolverState& state = ResolverState::instance();
+  _groupsockPriv* priv = groupsockPriv(env);
+  std::lock_guard<std::mutex> lock(state.fMutex);
+
+  ResolverEnvState* envState = (ResolverEnvState*)(priv->resolverState);
+  if (envState == NULL) {
+    envState = new ResolverEnvState(env);
+    priv->resolverState = envState;
+  }
+
+  unsigned id = ++state.fLastLookupId;
+  if (id == 0) id = ++state.fLastLookupId; // 0 is never a valid id
+  ResolverWaiter* waiter = new ResolverWaiter(id, envState, resultHandler, clientData);
+  state.fWaiters->Add((char const*)(uintptr_t)id, waiter);
+  ++envState->fNumWaiters;
+
+  NetAddressList* result = state.lookupIfKnown(hostName, addressFamily);
+  if (result != NULL) {
+    // We already know the result, but deliver it from the event loop, as usual:
+    waiter->fResult = result;
+    state.addCompleted(waiter);
+  } else {
+    ResolverQuery* query = state.startQuery(hostName, addressFamily);
+    waiter->fQuery = query;
+    ResolverWaiter** ptr = &query->fWaiters;
+    while (*ptr != NULL) ptr = &(*ptr)->fNext;
+    *ptr = waiter; // (so that results get delivered in the order in which they were asked for)
+  }
+
+  return id;
+}
+
+void HostNameResolver::cancel(unsigned lookupId) {
+  if (lookupId == 0) return;
+  ResolverState& state = ResolverState::instance();
+  std::lock_guard<std::mutex> lock(state.fMutex);
+
+  ResolverWaiter* waiter = (ResolverWaiter*)(state.fWaiters->Lookup((char const*)(uintptr_t)lookupId));
+  if (waiter == NULL) return; // the lookup has already been handled (or cancelled)
+  state.fWaiters->Remove((char const*)(uintptr_t)lookupId);
+
+  // Unlink the waiter from its query's list (the query itself continues, and its result will get cached),
+  // or from the list of completed lookups:
+  ResolverEnvState* envState = waiter->fEnvState;
+  ResolverWaiter** ptr = waiter->fQuery != NULL ? &waiter->fQuery->fWaiters : &envState->fCompletedHead;
+  ResolverWaiter* prev = NULL;
+  while (*ptr != NULL && *ptr != waiter) {
+    prev = *ptr;
+    ptr = &prev->fNext;
+  }
+  if (*ptr == waiter) *ptr = waiter->fNext;
+  if (waiter->fQuery == NULL && envState->fCompletedTail == waiter) envState->fCompletedTail = prev;
+
+  delete waiter;
+  --envState->fNumWaiters;
+  state.reclaimEnvStateIfUnused(envState);
+}
+
+NetAddressList* HostNameResolver::lookupIfKnown(char const* hostName, int addressFamily) {
+  ResolverState& state = ResolverState::instance();
+  std::lock_guard<std::mutex> lock(state.fMutex);
+
+  return state.lookupIfKnown(hostName, addressFamily);
+}
+
+void HostNameResolver::flushCache() {
+  ResolverState& state = ResolverState::instance();
+  std::lock_guard<std::mutex> lock(state.fMutex);
+
+  state.removeFromCache(False);
+}
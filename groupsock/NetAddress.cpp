@@ -83,12 +83,22 @@ void NetAddress::clean() {
 
 ////////// NetAddressList //////////
 
-NetAddressList::NetAddressList(char const* hostname)
+#if !defined(USE_GETHOSTBYNAME) && !defined(VXWORKS)
+static Boolean isUsableAddrinfo(struct addrinfo const* p) {
+  if (p->ai_addr == NULL) return False;
+  if (p->ai_family == AF_INET) return p->ai_addrlen >= sizeof (struct sockaddr_in);
+  if (p->ai_family == AF_INET6) return p->ai_addrlen >= sizeof (struct sockaddr_in6);
+  return False;
+}
+#endif
+
+NetAddressList::NetAddressList(char const* hostname, int addressFamily)
   : fNumAddresses(0), fAddressArray(NULL) {
-  // First, check whether "hostname" is an IP address string:
+  // First, check whether "hostname" is an IPv4 address string:
   netAddressBits addr = our_inet_addr((char*)hostname);
   if (addr != INADDR_NONE) {
-    // Yes, it was an IP address string.  Return a 1-element list with this address:
+    // Yes, it was an IPv4 address string.  Return a 1-element list with this address:
+    if (addressFamily == AF_INET6) return; // but we want IPv6 addresses only
     fNumAddresses = 1;
     fAddressArray = new NetAddress*[fNumAddresses];
     if (fAddressArray == NULL) return;
@@ -96,9 +106,26 @@ NetAddressList::NetAddressList(char const* hostname)
     fAddressArray[0] = new NetAddress((u_int8_t*)&addr, sizeof (netAddressBits));
     return;
   }
+
+#if !defined(VXWORKS)
+  // Then, check whether "hostname" is an IPv6 address string:
+  ipv6AddressBits addr6;
+  if (inet_pton(AF_INET6, hostname, addr6) == 1) {
+    // Yes, it was an IPv6 address string.  Return a 1-element list with this address:
+    if (addressFamily == AF_INET) return; // but we want IPv4 addresses only
+    fNumAddresses = 1;
+    fAddressArray = new NetAddress*[fNumAddresses];
+    if (fAddressArray == NULL) return;
+
+    fAddressArray[0] = new NetAddress(addr6, sizeof addr6);
+    return;
+  }
+#endif
     
   // "hostname" is not an IP address string; try resolving it as a real host name instead:
 #if defined(USE_GETHOSTBYNAME) || defined(VXWORKS)
+  if (addressFamily == AF_INET6) return; // "gethostbyname()" returns IPv4 addresses only
+
   struct hostent* host;
 #if defined(VXWORKS)
   char hostentBuf[512];
@@ -128,17 +155,16 @@ NetAddressList::NetAddressList(char const* hostname)
   // Use "getaddrinfo()" (rather than the older, deprecated "gethostbyname()"):
   struct addrinfo addrinfoHints;
   memset(&addrinfoHints, 0, sizeof addrinfoHints);
-  addrinfoHints.ai_family = AF_INET; // For now, we're interested in IPv4 addresses only
+  addrinfoHints.ai_family = addressFamily == AF_INET || addressFamily == AF_INET6 ? addressFamily : AF_UNSPEC;
   struct addrinfo* addrinfoResultPtr = NULL;
   int result = getaddrinfo(hostname, NULL, &addrinfoHints, &addrinfoResultPtr);
   if (result != 0 || addrinfoResultPtr == NULL) return; // no luck
 
   // First, count the number of addresses:
-  const struct addrinfo* p = addrinfoResultPtr;
-  while (p != NULL) {
-    if (p->ai_addrlen < 4) continue; // sanity check: skip over addresses that are too small
+  const struct addrinfo* p;
+  for (p = addrinfoResultPtr; p != NULL; p = p->ai_next) {
+    if (!isUsableAddrinfo(p)) continue; // skip over addresses of an unknown family, or that are too small
     ++fNumAddresses;
-    p = p->ai_next;
   }
 
   // Next, set up the list:
@@ -146,11 +172,13 @@ NetAddressList::NetAddressList(char const* hostname)
   if (fAddressArray == NULL) return;
 
   unsigned i = 0;
-  p = addrinfoResultPtr;
-  while (p != NULL) {
-    if (p->ai_addrlen < 4) continue;
-    fAddressArray[i++] = new NetAddress((u_int8_t const*)&(((struct sockaddr_in*)p->ai_addr)->sin_addr.s_addr), 4);
-    p = p->ai_next;
+  for (p = addrinfoResultPtr; p != NULL; p = p->ai_next) {
+    if (!isUsableAddrinfo(p)) continue;
+    if (p->ai_family == AF_INET) {
+      fAddressArray[i++] = new NetAddress((u_int8_t const*)&(((struct sockaddr_in*)p->ai_addr)->sin_addr.s_addr), 4);
+    } else {
+      fAddressArray[i++] = new NetAddress((u_int8_t const*)&(((struct sockaddr_in6*)p->ai_addr)->sin6_addr), 16);
+    }
   }
 
   // Finally, free the data that we had allocated by calling "getaddrinfo()":
@@ -223,41 +251,55 @@ UsageEnvironment& operator<<(UsageEnvironment& s, const Port& p) {
 
 ////////// AddressPortLookupTable //////////
 
+// Our keys are ten words: the two address families, the two (IPv4 or IPv6) addresses, and the port number:
+#define ADDRESS_PORT_KEY_SIZE 10
+
 AddressPortLookupTable::AddressPortLookupTable()
-  : fTable(HashTable::create(3)) { // three-word keys are used
+  : fTable(HashTable::create(ADDRESS_PORT_KEY_SIZE)) {
 }
 
 AddressPortLookupTable::~AddressPortLookupTable() {
   delete fTable;
 }
 
-void* AddressPortLookupTable::Add(netAddressBits address1,
-				  netAddressBits address2,
+static void setAddressWords(int* words, struct sockaddr_storage const& address) {
+  words[0] = words[1] = words[2] = words[3] = 0;
+  if (address.ss_family == AF_INET) {
+    words[0] = (int)((struct sockaddr_in const&)address).sin_addr.s_addr;
+  } else if (address.ss_family == AF_INET6) {
+    memcpy(words, &((struct sockaddr_in6 const&)address).sin6_addr, 16);
+  }
+}
+
+static void setKey(int* key, struct sockaddr_storage const& address1, struct sockaddr_storage const& address2,
+		   Port port) {
+  key[0] = (address1.ss_family<<16)|address2.ss_family;
+  setAddressWords(&key[1], address1);
+  setAddressWords(&key[5], address2);
+  key[9] = (int)port.num();
+}
+
+void* AddressPortLookupTable::Add(struct sockaddr_storage const& address1,
+				  struct sockaddr_storage const& address2,
 				  Port port, void* value) {
-  int key[3];
-  key[0] = (int)address1;
-  key[1] = (int)address2;
-  key[2] = (int)port.num();
+  int key[ADDRESS_PORT_KEY_SIZE];
+  setKey(key, address1, address2, port);
   return fTable->Add((char*)key, value);
 }
 
-void* AddressPortLookupTable::Lookup(netAddressBits address1,
-				     netAddressBits address2,
+void* AddressPortLookupTable::Lookup(struct sockaddr_storage const& address1,
+				     struct sockaddr_storage const& address2,
 				     Port port) {
-  int key[3];
-  key[0] = (int)address1;
-  key[1] = (int)address2;
-  key[2] = (int)port.num();
+  int key[ADDRESS_PORT_KEY_SIZE];
+  setKey(key, address1, address2, port);
   return fTable->Lookup((char*)key);
 }
 
-Boolean AddressPortLookupTable::Remove(netAddressBits address1,
-				       netAddressBits address2,
+Boolean AddressPortLookupTable::Remove(struct sockaddr_storage const& address1,
+				       struct sockaddr_storage const& address2,
 				       Port port) {
-  int key[3];
-  key[0] = (int)address1;
-  key[1] = (int)address2;
-  key[2] = (int)port.num();
+  int key[ADDRESS_PORT_KEY_SIZE];
+  setKey(key, address1, address2, port);
   return fTable->Remove((char*)key);
 }
 
@@ -286,6 +328,101 @@ Boolean IsMulticastAddress(netAddressBits address) {
          addressInNetworkOrder <= 0xEFFFFFFF;
 }
 
+Boolean IsMulticastAddress(struct sockaddr_storage const& address) {
+  if (address.ss_family == AF_INET) {
+    return IsMulticastAddress(((struct sockaddr_in const&)address).sin_addr.s_addr);
+  } else if (address.ss_family == AF_INET6) {
+    // An IPv6 multicast address is ff<flags><scope>::/8.  We exclude the interface-local (1) and link-local (2) scopes:
+    u_int8_t const* addr6 = (u_int8_t const*)&((struct sockaddr_in6 const&)address).sin6_addr;
+    return addr6[0] == 0xFF && (addr6[1]&0x0F) > 2;
+  }
+
+  return False;
+}
+
+
+////////// "struct sockaddr_storage" functions //////////
+
+void copyAddress(struct sockaddr_storage& to, NetAddress const* from) {
+  memset(&to, 0, sizeof to);
+  if (from == NULL) return;
+
+  if (from->length() == 16) {
+    struct sockaddr_in6& to6 = (struct sockaddr_in6&)to;
+    to6.sin6_family = AF_INET6;
+    memcpy(&to6.sin6_addr, from->data(), 16);
+  } else if (from->length() == 4) {
+    to.ss_family = AF_INET;
+    memcpy(&((struct sockaddr_in&)to).sin_addr.s_addr, from->data(), 4);
+  }
+}
+
+void setIPv4Address(struct sockaddr_storage& to, ipv4AddressBits address, portNumBits portNum) {
+  memset(&to, 0, sizeof to);
+  struct sockaddr_in& to4 = (struct sockaddr_in&)to;
+  to4.sin_family = AF_INET;
+  to4.sin_addr.s_addr = address;
+  to4.sin_port = portNum;
+}
+
+ipv4AddressBits ipv4Address(struct sockaddr_storage const& address) {
+  return address.ss_family == AF_INET ? ((struct sockaddr_in const&)address).sin_addr.s_addr : 0;
+}
+
+struct sockaddr_storage const& nullAddress(int addressFamily) {
+  static struct sockaddr_storage nullIPv4Address, nullIPv6Address; // all-zeros, except for the family
+  if (addressFamily == AF_INET6) {
+    nullIPv6Address.ss_family = AF_INET6;
+    return nullIPv6Address;
+  }
+
+  nullIPv4Address.ss_family = AF_INET;
+  return nullIPv4Address;
+}
+
+Boolean addressIsNull(struct sockaddr_storage const& address) {
+  if (address.ss_family == AF_INET) {
+    return ((struct sockaddr_in const&)address).sin_addr.s_addr == 0;
+  } else if (address.ss_family == AF_INET6) {
+    u_int8_t const* addr6 = (u_int8_t const*)&((struct sockaddr_in6 const&)address).sin6_addr;
+    for (unsigned i = 0; i < 16; ++i) if (addr6[i] != 0) return False;
+  }
+
+  return True;
+}
+
+SOCKLEN_T addressSize(struct sockaddr_storage const& address) {
+  if (address.ss_family == AF_INET) return sizeof (struct sockaddr_in);
+  if (address.ss_family == AF_INET6) return sizeof (struct sockaddr_in6);
+  return sizeof (struct sockaddr_storage);
+}
+
+portNumBits portNum(struct sockaddr_storage const& address) {
+  if (address.ss_family == AF_INET) return ((struct sockaddr_in const&)address).sin_port;
+  if (address.ss_family == AF_INET6) return ((struct sockaddr_in6 const&)address).sin6_port;
+  return 0;
+}
+
+void setPortNum(struct sockaddr_storage& address, portNumBits portNum) {
+  if (address.ss_family == AF_INET) {
+    ((struct sockaddr_in&)address).sin_port = portNum;
+  } else if (address.ss_family == AF_INET6) {
+    ((struct sockaddr_in6&)address).sin6_port = portNum;
+  }
+}
+
+Boolean operator==(struct sockaddr_storage const& left, struct sockaddr_storage const& right) {
+  if (left.ss_family != right.ss_family) return False;
+
+  if (left.ss_family == AF_INET) {
+    return ((struct sockaddr_in const&)left).sin_addr.s_addr == ((struct sockaddr_in const&)right).sin_addr.s_addr;
+  } else if (left.ss_family == AF_INET6) {
+    return memcmp(&((struct sockaddr_in6 const&)left).sin6_addr, &((struct sockaddr_in6 const&)right).sin6_addr, 16) == 0;
+  }
+
+  return True; // two unknown (or 'null') addresses
+}
+
 
 ////////// AddressString implementation //////////
 
@@ -301,12 +438,33 @@ AddressString::AddressString(netAddressBits addr) {
   init(addr);
 }
 
+AddressString::AddressString(struct sockaddr_storage const& addr) {
+  if (addr.ss_family == AF_INET6) {
+    init(((struct sockaddr_in6 const&)addr).sin6_addr);
+  } else {
+    init(ipv4Address(addr));
+  }
+}
+
+AddressString::AddressString(struct sockaddr_in6 const& addr) {
+  init(addr.sin6_addr);
+}
+
+AddressString::AddressString(struct in6_addr const& addr) {
+  init(addr);
+}
+
 void AddressString::init(netAddressBits addr) {
   fVal = new char[16]; // large enough for "abc.def.ghi.jkl"
   netAddressBits addrNBO = htonl(addr); // make sure we have a value in a known byte order: big endian
   sprintf(fVal, "%u.%u.%u.%u", (addrNBO>>24)&0xFF, (addrNBO>>16)&0xFF, (addrNBO>>8)&0xFF, addrNBO&0xFF);
 }
 
+void AddressString::init(struct in6_addr const& addr) {
+  fVal = new char[INET6_ADDRSTRLEN];
+  if (inet_ntop(AF_INET6, (void*)&addr, fVal, INET6_ADDRSTRLEN) == NULL) fVal[0] = '\0';
+}
+
 AddressString::~AddressString() {
   delete[] fVal;
 }
@@ -31,16 +31,17 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 class GroupEId {
 public:
-  GroupEId(struct in_addr const& groupAddr,
+  GroupEId(struct sockaddr_storage const& groupAddr,
 	   portNumBits portNum, u_int8_t ttl);
       // used for a 'source-independent multicast' group
-  GroupEId(struct in_addr const& groupAddr,
-	   struct in_addr const& sourceFilterAddr,
+  GroupEId(struct sockaddr_storage const& groupAddr,
+	   struct sockaddr_storage const& sourceFilterAddr,
 	   portNumBits portNum);
       // used for a 'source-specific multicast' group
 
-  struct in_addr const& groupAddress() const { return fGroupAddress; }
-  struct in_addr const& sourceFilterAddress() const { return fSourceFilterAddress; }
+  struct sockaddr_storage const& groupAddress() const { return fGroupAddress; }
+      // Note: This also contains our port number (so it can be used as-is as a destination)
+  struct sockaddr_storage const& sourceFilterAddress() const { return fSourceFilterAddress; }
 
   Boolean isSSM() const;
 
@@ -49,14 +50,14 @@ public:
   u_int8_t ttl() const { return fTTL; }
 
 private:
-  void init(struct in_addr const& groupAddr,
-	    struct in_addr const& sourceFilterAddr,
+  void init(struct sockaddr_storage const& groupAddr,
+	    struct sockaddr_storage const& sourceFilterAddr,
 	    portNumBits portNum,
 	    u_int8_t ttl);
 
 private:
-  struct in_addr fGroupAddress;
-  struct in_addr fSourceFilterAddress;
+  struct sockaddr_storage fGroupAddress;
+  struct sockaddr_storage fSourceFilterAddress; // family AF_UNSPEC if there's no source filter
   portNumBits fPortNum; // in network byte order
   u_int8_t fTTL;
 };
@@ -38,34 +38,38 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 class OutputSocket: public Socket {
 public:
-  OutputSocket(UsageEnvironment& env);
+  OutputSocket(UsageEnvironment& env, int family = AF_INET);
   virtual ~OutputSocket();
 
-  virtual Boolean write(netAddressBits address, portNumBits portNum/*in network order*/, u_int8_t ttl,
+  virtual Boolean write(struct sockaddr_storage const& addressAndPort, u_int8_t ttl,
 			unsigned char* buffer, unsigned bufferSize);
-  Boolean write(struct sockaddr_in& addressAndPort, u_int8_t ttl,
-		unsigned char* buffer, unsigned bufferSize) {
-    return write(addressAndPort.sin_addr.s_addr, addressAndPort.sin_port, ttl, buffer, bufferSize);
-  }
+      // "addressAndPort" must be of our family (or IPv4, if we're a "DualStack" IPv6 socket)
+
+  Boolean enableTxTime(); // returns False if transmit times (see below) are not supported
+  void setTxTime(u_int64_t txTimeNSecs) { fTxTimeNSecs = txTimeNSecs; }
+      // If "enableTxTime()" succeeded, then subsequent packets are not transmitted (by the kernel) until this time
+      // (in nanoseconds, on the "CLOCK_MONOTONIC" clock - see "monotonicTimeNSecs()").  0 means: transmit now.
 
 protected:
-  OutputSocket(UsageEnvironment& env, Port port);
+  OutputSocket(UsageEnvironment& env, Port port, int family = AF_INET);
 
   portNumBits sourcePortNum() const {return fSourcePort.num();}
 
 private: // redefined virtual function
   virtual Boolean handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 			     unsigned& bytesRead,
-			     struct sockaddr_in& fromAddressAndPort);
+			     struct sockaddr_storage& fromAddressAndPort);
 
 private:
   Port fSourcePort;
   unsigned fLastSentTTL;
+  Boolean fTxTimeIsEnabled;
+  u_int64_t fTxTimeNSecs;
 };
 
 class destRecord {
 public:
-  destRecord(struct in_addr const& addr, Port const& port, u_int8_t ttl, unsigned sessionId,
+  destRecord(struct sockaddr_storage const& addr, Port const& port, u_int8_t ttl, unsigned sessionId,
 	     destRecord* next);
   virtual ~destRecord();
 
@@ -78,22 +82,31 @@ public:
 // A "Groupsock" is used to both send and receive packets.
 // As the name suggests, it was originally designed to send/receive
 // multicast, but it can send/receive unicast as well.
+// A "Groupsock" is either IPv4 or IPv6 (the family of its group address); its destinations must be of the same family.
+// (The exception: An IPv6 "Groupsock" that was created as "DualStack" (see "GroupsockHelper.hh") may also have IPv4
+// destinations.)
 
 class Groupsock: public OutputSocket {
 public:
-  Groupsock(UsageEnvironment& env, struct in_addr const& groupAddr,
+  Groupsock(UsageEnvironment& env, struct sockaddr_storage const& groupAddr,
 	    Port port, u_int8_t ttl);
       // used for a 'source-independent multicast' group
+  Groupsock(UsageEnvironment& env, struct sockaddr_storage const& groupAddr,
+	    struct sockaddr_storage const& sourceFilterAddr,
+	    Port port);
+      // used for a 'source-specific multicast' group
+  // Versions of the above for IPv4 groups:
+  Groupsock(UsageEnvironment& env, struct in_addr const& groupAddr,
+	    Port port, u_int8_t ttl);
   Groupsock(UsageEnvironment& env, struct in_addr const& groupAddr,
 	    struct in_addr const& sourceFilterAddr,
 	    Port port);
-      // used for a 'source-specific multicast' group
   virtual ~Groupsock();
 
-  virtual destRecord* createNewDestRecord(struct in_addr const& addr, Port const& port, u_int8_t ttl, unsigned sessionId, destRecord* next);
+  virtual destRecord* createNewDestRecord(struct sockaddr_storage const& addr, Port const& port, u_int8_t ttl, unsigned sessionId, destRecord* next);
       // Can be redefined by subclasses that also subclass "destRecord"
 
-  void changeDestinationParameters(struct in_addr const& newDestAddr,
+  void changeDestinationParameters(struct sockaddr_storage const& newDestAddr,
 				   Port newDestPort, int newDestTTL,
 				   unsigned sessionId = 0);
       // By default, the destination address, port and ttl for
@@ -101,22 +114,26 @@ public:
       // the constructor.  This works OK for multicast sockets,
       // but for unicast we usually want the destination port
       // number, at least, to be different from the source port.
-      // (If a parameter is 0 (or ~0 for ttl), then no change is made to that parameter.)
+      // (If a parameter is 0 - or a 'null' address (or ~0 for ttl), then no change is made to that parameter.)
       // (If no existing "destRecord" exists with this "sessionId", then we add a new "destRecord".)
-  unsigned lookupSessionIdFromDestination(struct sockaddr_in const& destAddrAndPort) const;
+  void changeDestinationParameters(struct in_addr const& newDestAddr,
+				   Port newDestPort, int newDestTTL,
+				   unsigned sessionId = 0); // IPv4 version
+  unsigned lookupSessionIdFromDestination(struct sockaddr_storage const& destAddrAndPort) const;
       // returns 0 if not found
 
   // As a special case, we also allow multiple destinations (addresses & ports)
   // (This can be used to implement multi-unicast.)
-  virtual void addDestination(struct in_addr const& addr, Port const& port, unsigned sessionId);
+  virtual void addDestination(struct sockaddr_storage const& addr, Port const& port, unsigned sessionId);
+  void addDestination(struct in_addr const& addr, Port const& port, unsigned sessionId); // IPv4 version
   virtual void removeDestination(unsigned sessionId);
   void removeAllDestinations();
   Boolean hasMultipleDestinations() const { return fDests != NULL && fDests->fNext != NULL; }
 
-  struct in_addr const& groupAddress() const {
+  struct sockaddr_storage const& groupAddress() const {
     return fIncomingGroupEId.groupAddress();
   }
-  struct in_addr const& sourceFilterAddress() const {
+  struct sockaddr_storage const& sourceFilterAddress() const {
     return fIncomingGroupEId.sourceFilterAddress();
   }
 
@@ -145,17 +162,18 @@ public:
   NetInterfaceTrafficStats statsGroupRelayedIncoming; // *not* static
   NetInterfaceTrafficStats statsGroupRelayedOutgoing; // *not* static
 
-  Boolean wasLoopedBackFromUs(UsageEnvironment& env, struct sockaddr_in& fromAddressAndPort);
+  Boolean wasLoopedBackFromUs(UsageEnvironment& env, struct sockaddr_storage const& fromAddressAndPort);
 
 public: // redefined virtual functions
   virtual Boolean handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 			     unsigned& bytesRead,
-			     struct sockaddr_in& fromAddressAndPort);
+			     struct sockaddr_storage& fromAddressAndPort);
 
 protected:
-  destRecord* lookupDestRecordFromDestination(struct sockaddr_in const& destAddrAndPort) const;
+  destRecord* lookupDestRecordFromDestination(struct sockaddr_storage const& destAddrAndPort) const;
 
 private:
+  void joinGroup(); // used to implement the constructors
   void removeDestinationFrom(destRecord*& dests, unsigned sessionId);
     // used to implement (the public) "removeDestination()", and "changeDestinationParameters()"
   int outputToAllMembersExcept(DirectedNetInterface* exceptInterface,
@@ -176,17 +194,17 @@ UsageEnvironment& operator<<(UsageEnvironment& s, const Groupsock& g);
 // by (multicast address, port), or by socket number
 class GroupsockLookupTable {
 public:
-  Groupsock* Fetch(UsageEnvironment& env, netAddressBits groupAddress,
+  Groupsock* Fetch(UsageEnvironment& env, struct sockaddr_storage const& groupAddress,
 		   Port port, u_int8_t ttl, Boolean& isNew);
       // Creates a new Groupsock if none already exists
-  Groupsock* Fetch(UsageEnvironment& env, netAddressBits groupAddress,
-		   netAddressBits sourceFilterAddr,
+  Groupsock* Fetch(UsageEnvironment& env, struct sockaddr_storage const& groupAddress,
+		   struct sockaddr_storage const& sourceFilterAddr,
 		   Port port, Boolean& isNew);
       // Creates a new Groupsock if none already exists
-  Groupsock* Lookup(netAddressBits groupAddress, Port port);
+  Groupsock* Lookup(struct sockaddr_storage const& groupAddress, Port port);
       // Returns NULL if none already exists
-  Groupsock* Lookup(netAddressBits groupAddress,
-		    netAddressBits sourceFilterAddr,
+  Groupsock* Lookup(struct sockaddr_storage const& groupAddress,
+		    struct sockaddr_storage const& sourceFilterAddr,
 		    Port port);
       // Returns NULL if none already exists
   Groupsock* Lookup(UsageEnvironment& env, int sock);
@@ -206,8 +224,8 @@ public:
 
 private:
   Groupsock* AddNew(UsageEnvironment& env,
-		    netAddressBits groupAddress,
-		    netAddressBits sourceFilterAddress,
+		    struct sockaddr_storage const& groupAddress,
+		    struct sockaddr_storage const& sourceFilterAddress,
 		    Port port, u_int8_t ttl);
 
 private:
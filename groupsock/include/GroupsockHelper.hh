@@ -25,24 +25,39 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "NetAddress.hh"
 #endif
 
-int setupDatagramSocket(UsageEnvironment& env, Port port);
+// "domain" is AF_INET or AF_INET6.  (IPv6 sockets are 'IPv6-only' (IPV6_V6ONLY), so that an IPv4 and an IPv6 socket can
+// be bound to the same port.)
+int setupDatagramSocket(UsageEnvironment& env, Port port, int domain = AF_INET);
 int setupStreamSocket(UsageEnvironment& env,
-		      Port port, Boolean makeNonBlocking = True, Boolean setKeepAlive = False);
+		      Port port, Boolean makeNonBlocking = True, Boolean setKeepAlive = False,
+		      int domain = AF_INET);
 
 int readSocket(UsageEnvironment& env,
 	       int socket, unsigned char* buffer, unsigned bufferSize,
-	       struct sockaddr_in& fromAddress);
+	       struct sockaddr_storage& fromAddress);
 
+// In the following, "addressAndPort" (IPv4 or IPv6) includes the destination port number:
 Boolean writeSocket(UsageEnvironment& env,
-		    int socket, struct in_addr address, portNumBits portNum/*network byte order*/,
+		    int socket, struct sockaddr_storage const& addressAndPort,
 		    u_int8_t ttlArg,
 		    unsigned char* buffer, unsigned bufferSize);
 
 Boolean writeSocket(UsageEnvironment& env,
-		    int socket, struct in_addr address, portNumBits portNum/*network byte order*/,
+		    int socket, struct sockaddr_storage const& addressAndPort,
 		    unsigned char* buffer, unsigned bufferSize);
     // An optimized version of "writeSocket" that omits the "setsockopt()" call to set the TTL.
 
+Boolean enableSocketTxTime(UsageEnvironment& env, int socket);
+    // Lets "writeSocketAtTime()" be used on the socket (using the "SO_TXTIME" socket option, where available).
+    // Returns False if this is not supported.
+Boolean writeSocketAtTime(UsageEnvironment& env,
+			  int socket, struct sockaddr_storage const& addressAndPort,
+			  unsigned char* buffer, unsigned bufferSize, u_int64_t txTimeNSecs);
+    // Like "writeSocket()" (without setting the TTL), except that the kernel will not transmit the packet until
+    // time "txTimeNSecs" (in nanoseconds, on the "CLOCK_MONOTONIC" clock).  (This works only if the outgoing
+    // interface uses a queueing discipline - e.g., "fq" - that supports this.)
+u_int64_t monotonicTimeNSecs(); // the current "CLOCK_MONOTONIC" time, in nanoseconds
+
 void ignoreSigPipeOnSocket(int socketNum);
 
 unsigned getSendBufferSize(UsageEnvironment& env, int socket);
@@ -61,25 +76,29 @@ Boolean makeSocketBlocking(int sock, unsigned writeTimeoutInMilliseconds = 0);
   // A "writeTimeoutInMilliseconds" value of 0 means: Don't timeout
 Boolean setSocketKeepAlive(int sock);
 
+// (IPv4 or IPv6) multicast join/leave.  (These do nothing if "groupAddress" is not a multicast address.)
 Boolean socketJoinGroup(UsageEnvironment& env, int socket,
-			netAddressBits groupAddress);
+			struct sockaddr_storage const& groupAddress);
 Boolean socketLeaveGroup(UsageEnvironment&, int socket,
-			 netAddressBits groupAddress);
+			 struct sockaddr_storage const& groupAddress);
 
 // source-specific multicast join/leave
 Boolean socketJoinGroupSSM(UsageEnvironment& env, int socket,
-			   netAddressBits groupAddress,
-			   netAddressBits sourceFilterAddr);
+			   struct sockaddr_storage const& groupAddress,
+			   struct sockaddr_storage const& sourceFilterAddr);
 Boolean socketLeaveGroupSSM(UsageEnvironment&, int socket,
-			    netAddressBits groupAddress,
-			    netAddressBits sourceFilterAddr);
+			    struct sockaddr_storage const& groupAddress,
+			    struct sockaddr_storage const& sourceFilterAddr);
 
 Boolean getSourcePort(UsageEnvironment& env, int socket, Port& port);
 
 netAddressBits ourIPAddress(UsageEnvironment& env); // in network order
+struct sockaddr_storage const& ourIPv6Address(UsageEnvironment& env);
+    // Our (global or unique-local) IPv6 address; "::" if we don't have one
 
 // IP addresses of our sending and receiving interfaces.  (By default, these
 // are INADDR_ANY (i.e., 0), specifying the default interface.)
+// (These are IPv4 addresses, and so are used for IPv4 sockets only.  IPv6 sockets always use the default interface.)
 extern netAddressBits SendingInterfaceAddr;
 extern netAddressBits ReceivingInterfaceAddr;
 
@@ -121,11 +140,30 @@ private:
 };
 
 
+// By default, IPv6 datagram sockets are IPv6-only.  If, instead, you want IPv6 datagram sockets that can also be used
+// with IPv4 peers (which the kernel then sees as IPv4-mapped IPv6 addresses), enclose their creation code with:
+//          {
+//            DualStack dummy(env);
+//            ...
+//          }
+// A "Groupsock" with such a socket accepts IPv4 destinations, and reports IPv4 senders by their IPv4 address.
+class DualStack {
+public:
+  DualStack(UsageEnvironment& env);
+  ~DualStack();
+
+private:
+  UsageEnvironment& fEnv;
+};
+
+
 // Define the "UsageEnvironment"-specific "groupsockPriv" structure:
 
 struct _groupsockPriv { // There should be only one of these allocated
   HashTable* socketTable;
   int reuseFlag;
+  int dualStackFlag;
+  void* resolverState; // used by "HostNameResolver"
 };
 _groupsockPriv* groupsockPriv(UsageEnvironment& env); // allocates it if necessary
 void reclaimGroupsockPriv(UsageEnvironment& env);
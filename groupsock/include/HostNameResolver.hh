@@ -0,0 +1,58 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "mTunnel" multicast access service
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// Non-blocking host name lookup, with a cache that's shared by all environments in the process
+// C++ header
+
+#ifndef _HOST_NAME_RESOLVER_HH
+#define _HOST_NAME_RESOLVER_HH
+
+#ifndef _NET_ADDRESS_HH
+#include "NetAddress.hh"
+#endif
+
+// Constructing a "NetAddressList" from a host name blocks (in "getaddrinfo()") until the name has been resolved.
+// This class instead does the lookup in a (small) pool of background threads, and delivers the result - via an event
+// trigger - to the event loop of the environment that asked for it.  Results (including failures) are cached for a
+// while, and concurrent lookups of the same name share a single query.
+class HostNameResolver {
+public:
+  typedef void (ResultHandler)(void* clientData, NetAddressList const& addresses);
+      // "addresses" is empty if the lookup failed
+
+  static unsigned lookup(UsageEnvironment& env, char const* hostName, int addressFamily,
+			 ResultHandler* resultHandler, void* clientData);
+      // Looks up "hostName" (which may also be an IPv4 or IPv6 address string); "addressFamily" is as for
+      // "NetAddressList".  "resultHandler" is called later from "env"'s event loop (never from within this function).
+      // Returns a (nonzero) id that can be passed to "cancel()".
+  static void cancel(unsigned lookupId);
+      // Ensures that the lookup's "resultHandler" won't get called.  (It's OK to cancel a lookup that has completed.)
+      // Like "lookup()", this must be called from the environment's own thread.
+
+  static NetAddressList* lookupIfKnown(char const* hostName, int addressFamily = AF_UNSPEC);
+      // Returns the result at once - as a new "NetAddressList" that the caller must delete - if "hostName" is an address
+      // string, or its result is cached.  Otherwise returns NULL (and a "lookup()" is needed).
+
+  static void flushCache(); // forgets all (completed) cached results
+
+  // Parameters that may be changed (before the first lookup):
+  static unsigned maxNumThreads; // the maximum number of concurrent "getaddrinfo()" calls (default: 4)
+  static unsigned positiveTTLSeconds; // how long a successful lookup is cached (default: 60)
+  static unsigned negativeTTLSeconds; // how long a failed lookup is cached (default: 5)
+};
+
+#endif
@@ -33,10 +33,12 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "UsageEnvironment.hh"
 #endif
 
-// Definition of a type representing a low-level network address.
-// At present, this is 32-bits, for IPv4.  Later, generalize it,
-// to allow for IPv6.
-typedef u_int32_t netAddressBits;
+// Definitions of types representing low-level network addresses.
+// "netAddressBits" (an IPv4 address) is kept for existing (IPv4-only) code; code that works with both IPv4 and IPv6
+// addresses uses a "struct sockaddr_storage" instead (see the functions declared at the end of this file).
+typedef u_int32_t ipv4AddressBits;
+typedef ipv4AddressBits netAddressBits;
+typedef u_int8_t ipv6AddressBits[16];
 
 class NetAddress {
 public:
@@ -61,7 +63,9 @@ private:
 
 class NetAddressList {
 public:
-  NetAddressList(char const* hostname);
+  NetAddressList(char const* hostname, int addressFamily = AF_UNSPEC);
+      // "addressFamily" may be AF_INET or AF_INET6, to return only IPv4 or IPv6 addresses.  (If "hostname" is an
+      // address string, the list contains just that address, provided that its family is acceptable.)
   NetAddressList(NetAddressList const& orig);
   NetAddressList& operator=(NetAddressList const& rightSide);
   virtual ~NetAddressList();
@@ -113,11 +117,12 @@ public:
   AddressPortLookupTable();
   virtual ~AddressPortLookupTable();
   
-  void* Add(netAddressBits address1, netAddressBits address2, Port port, void* value);
+  void* Add(struct sockaddr_storage const& address1, struct sockaddr_storage const& address2, Port port, void* value);
       // Returns the old value if different, otherwise 0
-  Boolean Remove(netAddressBits address1, netAddressBits address2, Port port);
-  void* Lookup(netAddressBits address1, netAddressBits address2, Port port);
+  Boolean Remove(struct sockaddr_storage const& address1, struct sockaddr_storage const& address2, Port port);
+  void* Lookup(struct sockaddr_storage const& address1, struct sockaddr_storage const& address2, Port port);
       // Returns 0 if not found
+  // (Only the families and addresses - not the port numbers - of "address1" and "address2" are used.)
   void* RemoveNext() { return fTable->RemoveNext(); }
 
   // Used to iterate through the entries in the table
@@ -139,14 +144,47 @@ private:
 
 
 Boolean IsMulticastAddress(netAddressBits address);
+Boolean IsMulticastAddress(struct sockaddr_storage const& address);
+    // For IPv6, we return False for node-local and link-local multicast addresses (as we do for IPv4's 224.0.0.x)
 
 
-// A mechanism for displaying an IPv4 address in ASCII.  This is intended to replace "inet_ntoa()", which is not thread-safe.
+////////// Functions for working with (IPv4 or IPv6) addresses that are stored in a "struct sockaddr_storage" //////////
+// (The address family is "ss_family"; AF_UNSPEC (i.e., all-zeros) denotes 'no address'.)
+
+void copyAddress(struct sockaddr_storage& to, NetAddress const* from);
+    // Sets "to" (with port number 0) from a (4-byte or 16-byte) "NetAddress"
+
+void setIPv4Address(struct sockaddr_storage& to, ipv4AddressBits address, portNumBits portNum = 0);
+    // "address" and "portNum" are in network byte order
+ipv4AddressBits ipv4Address(struct sockaddr_storage const& address);
+    // Returns the IPv4 address (in network byte order), or 0 if "address" is not an IPv4 address
+
+struct sockaddr_storage const& nullAddress(int addressFamily = AF_INET);
+    // The 'wildcard' (all-zeros) address of "addressFamily": 0.0.0.0 or ::
+Boolean addressIsNull(struct sockaddr_storage const& address);
+SOCKLEN_T addressSize(struct sockaddr_storage const& address);
+    // The size of the family-specific structure (e.g., for passing to "sendto()")
+
+portNumBits portNum(struct sockaddr_storage const& address); // in network byte order
+void setPortNum(struct sockaddr_storage& address, portNumBits portNum/*in network byte order*/);
+
+Boolean operator==(struct sockaddr_storage const& left, struct sockaddr_storage const& right);
+    // Compares the addresses only (not the port numbers)
+inline Boolean operator!=(struct sockaddr_storage const& left, struct sockaddr_storage const& right) {
+  return !(left == right);
+}
+
+
+// A mechanism for displaying an IPv4 or IPv6 address in ASCII.  This is intended to replace "inet_ntoa()", which is not
+// thread-safe.
 class AddressString {
 public:
   AddressString(struct sockaddr_in const& addr);
   AddressString(struct in_addr const& addr);
   AddressString(netAddressBits addr); // "addr" is assumed to be in host byte order here
+  AddressString(struct sockaddr_storage const& addr); // IPv4 or IPv6
+  AddressString(struct sockaddr_in6 const& addr);
+  AddressString(struct in6_addr const& addr);
 
   virtual ~AddressString();
 
@@ -154,6 +192,7 @@ public:
 
 private:
   void init(netAddressBits addr); // used to implement each of the constructors
+  void init(struct in6_addr const& addr);
 
 private:
   char* fVal; // The result ASCII string: allocated by the constructor; deleted by the destructor
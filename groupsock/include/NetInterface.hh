@@ -84,7 +84,7 @@ public:
 
   virtual Boolean handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 			     unsigned& bytesRead,
-			     struct sockaddr_in& fromAddress) = 0;
+			     struct sockaddr_storage& fromAddress) = 0;
       // Returns False on error; resultData == NULL if data ignored
 
   int socketNum() const { return fSocketNum; }
@@ -93,12 +93,14 @@ public:
     return fPort;
   }
 
+  int family() const { return fFamily; } // AF_INET or AF_INET6
+
   UsageEnvironment& env() const { return fEnv; }
 
   static int DebugLevel;
 
 protected:
-  Socket(UsageEnvironment& env, Port port); // virtual base class
+  Socket(UsageEnvironment& env, Port port, int family = AF_INET); // virtual base class
 
   Boolean changePort(Port newPort); // will also cause socketNum() to change
 
@@ -106,6 +108,7 @@ private:
   int fSocketNum;
   UsageEnvironment& fEnv;
   Port fPort;
+  int fFamily;
 };
 
 UsageEnvironment& operator<<(UsageEnvironment& s, const Socket& sock);
@@ -226,12 +226,28 @@ static long* end_ptr = &randtbl[DEG_3 + 1];
  * introduced by the L.C.R.N.G.  Note that the initialization of randtbl[]
  * for default usage relies on values produced by this routine.
  */
-long our_random(void); /*forward*/
+/*
+ * "our_random()" and "our_srandom()" share the state above, and may be called from several threads at once
+ * (e.g., by the worker threads of a "RTSPServerWithWorkerThreads"), so we serialize them with a lock:
+ */
+#if defined(__WIN32__) || defined(_WIN32)
+static LONG volatile randomStateLock = 0;
+#define LOCK_RANDOM_STATE() while (InterlockedCompareExchange(&randomStateLock, 1, 0) != 0) Sleep(0)
+#define UNLOCK_RANDOM_STATE() InterlockedExchange(&randomStateLock, 0)
+#else
+#include <pthread.h>
+static pthread_mutex_t randomStateLock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_RANDOM_STATE() pthread_mutex_lock(&randomStateLock)
+#define UNLOCK_RANDOM_STATE() pthread_mutex_unlock(&randomStateLock)
+#endif
+
+static long our_random_locked(void); /*forward*/
 void
 our_srandom(unsigned int x)
 {
 	register int i;
 
+	LOCK_RANDOM_STATE();
 	if (rand_type == TYPE_0)
 		state[0] = x;
 	else {
@@ -241,8 +257,9 @@ our_srandom(unsigned int x)
 		fptr = &state[rand_sep];
 		rptr = &state[0];
 		for (i = 0; i < 10 * rand_deg; i++)
-			(void)our_random();
+			(void)our_random_locked();
 	}
+	UNLOCK_RANDOM_STATE();
 }
 
 /*
@@ -388,6 +405,17 @@ our_setstate(arg_state)
 long our_random() {
   long i;
 
+  LOCK_RANDOM_STATE();
+  i = our_random_locked();
+  UNLOCK_RANDOM_STATE();
+
+  return i;
+}
+
+/* Does the work of "our_random()"; called only with "randomStateLock" held: */
+static long our_random_locked() {
+  long i;
+
   if (rand_type == TYPE_0) {
     i = state[0] = (state[0] * 1103515245 + 12345) & 0x7fffffff;
   } else {
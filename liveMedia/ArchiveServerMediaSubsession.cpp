@@ -0,0 +1,773 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A 'ServerMediaSubsession' object that creates new, unicast, "RTPSink"s on demand, to play back a
+// H.264 or H.265 video archive that was recorded (as a sequence of segment files) by "RollingRecordingSink".
+// Clients can seek by wall-clock time ("Range: clock=..."), and can use "Scale:" for fast (or reverse) review.
+// Implementation
+
+#include "ArchiveServerMediaSubsession.hh"
+#include "H264VideoRTPSink.hh"
+#include "H265VideoRTPSink.hh"
+#include "H264VideoStreamDiscreteFramer.hh"
+#include "H265VideoStreamDiscreteFramer.hh"
+#include "InputFile.hh"
+#include "GroupsockHelper.hh"
+#include <time.h>
+#include <sys/stat.h>
+#if !defined(__WIN32__) && !defined(_WIN32)
+#include <fcntl.h> // for "posix_fadvise()"
+#endif
+
+#if defined(__WIN32__) || defined(_WIN32)
+#define timegm _mkgmtime
+#endif
+
+// When playing forward, the next segment is opened (and the OS is asked to start reading it) once we're
+// within this long of the end of the current segment:
+#define ARCHIVE_PREFETCH_TIME_US 5000000
+#define ARCHIVE_PREFETCH_SIZE (4*1024*1024)
+
+// During 'trick play' (when only key frames are sent), we send at most this many frames per second:
+#define ARCHIVE_TRICK_PLAY_MAX_FRAME_RATE 10
+
+// We never send a frame for longer than this (e.g., if there's a gap in the recording):
+#define ARCHIVE_MAX_FRAME_DURATION_US 1000000
+
+#define ARCHIVE_DEFAULT_FRAME_DURATION_US 40000
+
+static Boolean parseAbsoluteTime(char const* str, u_int64_t& result) {
+  // "str" is of the form "YYYYMMDDTHHMMSSZ" or "YYYYMMDDTHHMMSS.<frac>Z":
+  unsigned year, month, day, hour, minute, second;
+  int numCharsUsed = 0;
+  if (sscanf(str, "%4u%2u%2uT%2u%2u%2u%n", &year, &month, &day, &hour, &minute, &second, &numCharsUsed) != 6) {
+    return False;
+  }
+
+  struct tm tm;
+  memset(&tm, 0, sizeof tm);
+  tm.tm_year = year - 1900; tm.tm_mon = month - 1; tm.tm_mday = day;
+  tm.tm_hour = hour; tm.tm_min = minute; tm.tm_sec = second;
+  time_t t = timegm(&tm);
+  if (t == (time_t)-1) return False;
+
+  unsigned usecs = 0;
+  char const* frac = &str[numCharsUsed];
+  if (*frac == '.') {
+    unsigned scale = 100000;
+    while (*++frac >= '0' && *frac <= '9') {
+      usecs += (*frac - '0')*scale;
+      scale /= 10;
+    }
+  }
+
+  result = (u_int64_t)t*1000000 + usecs;
+  return True;
+}
+
+static void formatAbsoluteTime(u_int64_t time, char* buf/*at least 30 bytes*/) {
+  time_t tt = (time_t)(time/1000000);
+  unsigned msecs = (unsigned)((time%1000000)/1000);
+  unsigned len = (unsigned)strftime(buf, 30, "%Y%m%dT%H%M%S", gmtime(&tt));
+  if (msecs > 0) {
+    sprintf(&buf[len], ".%03uZ", msecs);
+  } else {
+    sprintf(&buf[len], "Z");
+  }
+}
+
+static RecordingSegment* copySegment(RecordingSegment const* segment) {
+  RecordingSegment* result = new RecordingSegment(segment->fFileName, segment->fStartTime);
+  result->fEndTime = segment->fEndTime;
+  result->fSize = segment->fSize;
+  return result;
+}
+
+static Boolean isVCL(int hNumber, u_int8_t const* nal, unsigned nalSize, Boolean& isFirstSliceInPicture) {
+  if (hNumber == 264) {
+    u_int8_t nal_unit_type = nal[0]&0x1F;
+    if (nal_unit_type < 1 || nal_unit_type > 5 || nalSize < 2) return False;
+    isFirstSliceInPicture = (nal[1]&0x80) != 0; // "first_mb_in_slice" == 0
+  } else {
+    u_int8_t nal_unit_type = (nal[0]&0x7E)>>1;
+    if (nal_unit_type > 31 || nalSize < 3) return False;
+    isFirstSliceInPicture = (nal[2]&0x80) != 0; // "first_slice_segment_in_pic_flag"
+  }
+  return True;
+}
+
+////////// ArchiveStreamSource //////////
+
+// Reads the NAL units from an archive, one at a time, starting from a key frame, and following the segments
+// from one file to the next.  Each NAL unit is delivered with its (recorded) time, so that it can be fed to
+// a "H264or5VideoStreamDiscreteFramer".
+
+class ArchiveStreamSource: public FramedSource {
+public:
+  static ArchiveStreamSource* createNew(UsageEnvironment& env, ArchiveServerMediaSubsession& archive);
+
+  Boolean seekTo(u_int64_t time, u_int64_t& resultTime);
+      // Positions us at the last key frame at (or before) "time" (or the first key frame, if there's none)
+  void setScale(float scale);
+  void setStreamDuration(double streamDuration, u_int64_t fromTime = 0);
+      // <= 0 means: play until the end of the archive.  "fromTime" 0 means: from our current position
+  void setEndTime(u_int64_t endTime) { fEndTime = endTime; } // 0 means: play until the end of the archive
+  u_int64_t currentTime() const;
+
+protected:
+  ArchiveStreamSource(UsageEnvironment& env, ArchiveServerMediaSubsession& archive);
+  virtual ~ArchiveStreamSource();
+
+private: // redefined virtual functions
+  virtual void doGetNextFrame();
+
+private:
+  Boolean loadNextGOP();
+  Boolean readNALUnits(u_int64_t startOffset, u_int64_t endOffset);
+  unsigned assignNALUnitTimes(u_int64_t startTime, u_int64_t frameDuration, unsigned maxNumPictures);
+  Boolean locate(u_int64_t time, Boolean forward);
+  Boolean useSegment(int segmentNum);
+  Boolean openSegment(RecordingSegment const* segment,
+		      FILE*& fid, SegmentKeyFrameIndex*& index, u_int64_t& fileSize);
+  Boolean moveToAdjacentSegment(Boolean forward);
+  void prefetchNextSegment();
+  void closeSegments();
+
+private:
+  ArchiveServerMediaSubsession& fArchive;
+  int fHNumber;
+  float fScale;
+  u_int64_t fEndTime;
+
+  // The current segment:
+  RecordingSegment* fSegment;
+  SegmentKeyFrameIndex* fIndex;
+  FILE* fFid;
+  u_int64_t fFileSize;
+  int fEntry; // the next key frame (in "fIndex") to read, if "fHaveEntry"
+  Boolean fHaveEntry;
+
+  // The next segment, if we've already opened it (to prefetch it):
+  RecordingSegment* fNextSegment;
+  SegmentKeyFrameIndex* fNextIndex;
+  FILE* fNextFid;
+  u_int64_t fNextFileSize;
+  Boolean fHavePrefetched;
+
+  // The NAL units that we're currently delivering:
+  unsigned char* fData;
+  unsigned fDataMaxSize;
+  unsigned* fNALOffsets;
+  unsigned* fNALSizes;
+  u_int64_t* fNALTimes;
+  unsigned* fNALDurations;
+  unsigned fNumNALs, fMaxNumNALs, fNextNAL;
+
+  // Used to convert recorded times to presentation times:
+  Boolean fNeedTimeBase;
+  u_int64_t fTimeBase;
+  struct timeval fPresentationTimeBase;
+  struct timeval fNextPresentationTime;
+  u_int64_t fFrameDuration; // our current estimate
+};
+
+ArchiveStreamSource*
+ArchiveStreamSource::createNew(UsageEnvironment& env, ArchiveServerMediaSubsession& archive) {
+  ArchiveStreamSource* source = new ArchiveStreamSource(env, archive);
+
+  u_int64_t startTime;
+  if (!source->seekTo(0, startTime)) {
+    env.setResultMsg("The archive has no (complete) segments");
+    Medium::close(source);
+    return NULL;
+  }
+  return source;
+}
+
+ArchiveStreamSource::ArchiveStreamSource(UsageEnvironment& env, ArchiveServerMediaSubsession& archive)
+  : FramedSource(env), fArchive(archive), fHNumber(archive.hNumber()), fScale(1.0f), fEndTime(0),
+    fSegment(NULL), fIndex(NULL), fFid(NULL), fFileSize(0), fEntry(0), fHaveEntry(False),
+    fNextSegment(NULL), fNextIndex(NULL), fNextFid(NULL), fNextFileSize(0), fHavePrefetched(False),
+    fData(NULL), fDataMaxSize(0),
+    fNALOffsets(NULL), fNALSizes(NULL), fNALTimes(NULL), fNALDurations(NULL),
+    fNumNALs(0), fMaxNumNALs(0), fNextNAL(0),
+    fNeedTimeBase(True), fTimeBase(0), fFrameDuration(ARCHIVE_DEFAULT_FRAME_DURATION_US) {
+  fPresentationTimeBase.tv_sec = fPresentationTimeBase.tv_usec = 0;
+  fNextPresentationTime = fPresentationTimeBase;
+}
+
+ArchiveStreamSource::~ArchiveStreamSource() {
+  closeSegments();
+  delete[] fNALDurations; delete[] fNALTimes; delete[] fNALSizes; delete[] fNALOffsets;
+  delete[] fData;
+}
+
+Boolean ArchiveStreamSource::seekTo(u_int64_t time, u_int64_t& resultTime) {
+  fArchive.reloadSegmentList();
+  if (!locate(time, False) && !locate(time, True)) return False;
+
+  resultTime = fIndex->time(fEntry);
+  fNumNALs = fNextNAL = 0;
+  fNeedTimeBase = True;
+  return True;
+}
+
+void ArchiveStreamSource::setScale(float scale) {
+  if (scale == fScale) return;
+
+  // Continue from the next NAL unit that we would have delivered (or from the current key frame):
+  u_int64_t resultTime;
+  u_int64_t time = currentTime();
+  fScale = scale;
+  if (fNextNAL < fNumNALs) seekTo(time, resultTime);
+  fNeedTimeBase = True;
+}
+
+void ArchiveStreamSource::setStreamDuration(double streamDuration, u_int64_t fromTime) {
+  if (streamDuration <= 0.0) {
+    fEndTime = 0;
+  } else {
+    u_int64_t durationUS = (u_int64_t)(streamDuration*1000000);
+    u_int64_t time = fromTime != 0 ? fromTime : currentTime();
+    fEndTime = fScale >= 0.0f ? time + durationUS : (time > durationUS ? time - durationUS : 1);
+  }
+}
+
+u_int64_t ArchiveStreamSource::currentTime() const {
+  if (fNextNAL < fNumNALs) return fNALTimes[fNextNAL];
+  if (fIndex != NULL && fHaveEntry) return fIndex->time(fEntry);
+  return fSegment != NULL ? timevalToMicroseconds(fSegment->fEndTime) : 0;
+}
+
+void ArchiveStreamSource::doGetNextFrame() {
+  if (fNextNAL >= fNumNALs && !loadNextGOP()) {
+    handleClosure();
+    return;
+  }
+
+  unsigned i = fNextNAL++;
+  if (fNeedTimeBase) {
+    // Continue our presentation times from the current time (but never going backwards):
+    struct timeval timeNow;
+    gettimeofday(&timeNow, NULL);
+    fPresentationTimeBase = timeNow;
+    if (fNextPresentationTime.tv_sec > timeNow.tv_sec
+	|| (fNextPresentationTime.tv_sec == timeNow.tv_sec && fNextPresentationTime.tv_usec > timeNow.tv_usec)) {
+      fPresentationTimeBase = fNextPresentationTime;
+    }
+    fTimeBase = fNALTimes[i];
+    fNeedTimeBase = False;
+  }
+
+  // The presentation time advances with the recorded time (in either direction):
+  u_int64_t offset = fNALTimes[i] >= fTimeBase ? fNALTimes[i] - fTimeBase : fTimeBase - fNALTimes[i];
+  fPresentationTime = microsecondsToTimeval(timevalToMicroseconds(fPresentationTimeBase) + offset);
+  fDurationInMicroseconds = fNALDurations[i];
+  if (fDurationInMicroseconds > 0) {
+    float const absScale = fScale < 0.0f ? -fScale : fScale;
+    u_int64_t recordedDuration = (u_int64_t)(fDurationInMicroseconds*absScale);
+    fNextPresentationTime = microsecondsToTimeval(timevalToMicroseconds(fPresentationTime) + recordedDuration);
+  }
+
+  unsigned nalSize = fNALSizes[i];
+  if (nalSize > fMaxSize) {
+    fNumTruncatedBytes = nalSize - fMaxSize;
+    nalSize = fMaxSize;
+  }
+  memmove(fTo, &fData[fNALOffsets[i]], nalSize);
+  fFrameSize = nalSize;
+
+  // Because we read files synchronously, we can deliver the data immediately:
+  FramedSource::afterGetting(this);
+}
+
+Boolean ArchiveStreamSource::loadNextGOP() {
+  Boolean const forward = fScale > 0.0f;
+  Boolean const keyFramesOnly = fScale < 0.0f || fScale > 1.0f;
+
+  if (!fHaveEntry) {
+    // We've reached the end of the current segment:
+    if (!forward || !moveToAdjacentSegment(True)) return False;
+  }
+
+  u_int64_t const time = fIndex->time(fEntry);
+  if (fEndTime != 0 && (forward ? time >= fEndTime : time <= fEndTime)) return False;
+
+  unsigned const numEntries = fIndex->numEntries();
+  u_int64_t const endOffset = (unsigned)fEntry + 1 < numEntries ? fIndex->offset(fEntry+1) : fFileSize;
+  if (!readNALUnits(fIndex->offset(fEntry), endOffset)) return False;
+
+  if (!keyFramesOnly) {
+    // Send every frame of this GOP.  Their recorded times aren't known, so assume that they're evenly spaced
+    // until the next key frame:
+    u_int64_t nextTime = (unsigned)fEntry + 1 < numEntries ? fIndex->time(fEntry+1)
+      : timevalToMicroseconds(fSegment->fEndTime) + fFrameDuration;
+    unsigned numPictures = assignNALUnitTimes(time, 0, ~0);
+    if (numPictures > 0 && nextTime > time) {
+      fFrameDuration = (nextTime - time)/numPictures;
+      if (fFrameDuration > ARCHIVE_MAX_FRAME_DURATION_US) fFrameDuration = ARCHIVE_MAX_FRAME_DURATION_US;
+    }
+    assignNALUnitTimes(time, fFrameDuration, ~0);
+    if (fScale != 1.0f) {
+      for (unsigned i = 0; i < fNumNALs; ++i) fNALDurations[i] = (unsigned)(fNALDurations[i]/fScale);
+    }
+
+    if ((unsigned)++fEntry >= numEntries) fHaveEntry = False;
+    prefetchNextSegment();
+  } else {
+    // 'Trick play': Send just this key frame, then move on (in either direction) to the key frame that's at
+    // least 1/ARCHIVE_TRICK_PLAY_MAX_FRAME_RATE seconds away (in playing time):
+    float const absScale = forward ? fScale : -fScale;
+    u_int64_t const step = (u_int64_t)(absScale*1000000/ARCHIVE_TRICK_PLAY_MAX_FRAME_RATE);
+    Boolean haveNext = forward ? locate(time + step, True) : time > step && locate(time - step, False);
+    u_int64_t nextTime = haveNext ? fIndex->time(fEntry) : time;
+    if (haveNext && nextTime == time) {
+      // We didn't move (e.g., because we're at the start of the archive):
+      haveNext = False;
+    }
+    if (!haveNext) fHaveEntry = False;
+
+    u_int64_t const recordedGap = nextTime > time ? nextTime - time : time - nextTime;
+    u_int64_t frameDuration = haveNext ? (u_int64_t)(recordedGap/absScale) : fFrameDuration;
+    if (frameDuration > ARCHIVE_MAX_FRAME_DURATION_US) frameDuration = ARCHIVE_MAX_FRAME_DURATION_US;
+    assignNALUnitTimes(time, 0, 1); // truncates the NAL units to those of the key frame
+    fNALDurations[fNumNALs-1] = (unsigned)frameDuration;
+    for (unsigned i = 0; i < fNumNALs; ++i) fNALTimes[i] = time;
+    if (forward) prefetchNextSegment();
+  }
+
+  return fNumNALs > 0;
+}
+
+Boolean ArchiveStreamSource::readNALUnits(u_int64_t startOffset, u_int64_t endOffset) {
+  fNumNALs = fNextNAL = 0;
+  if (endOffset <= startOffset) return False;
+
+  unsigned const size = (unsigned)(endOffset - startOffset);
+  if (size > fDataMaxSize) {
+    delete[] fData;
+    fDataMaxSize = size;
+    fData = new unsigned char[fDataMaxSize];
+  }
+  if (SeekFile64(fFid, (int64_t)startOffset, SEEK_SET) < 0 || fread(fData, 1, size, fFid) != size) {
+    envir().setResultMsg("Failed to read archive segment file \"", fSegment->fFileName, "\"");
+    return False;
+  }
+
+  // Find the NAL units (each of which follows a 0x000001 'start code'):
+  unsigned i = 0;
+  while (i + 3 <= size) {
+    if (fData[i] != 0 || fData[i+1] != 0 || fData[i+2] != 1) { ++i; continue; }
+
+    unsigned nalStart = i + 3;
+    unsigned j = nalStart;
+    while (j + 3 <= size && !(fData[j] == 0 && fData[j+1] == 0 && fData[j+2] == 1)) ++j;
+    unsigned nalEnd = j + 3 <= size ? j : size;
+    while (nalEnd > nalStart && fData[nalEnd-1] == 0) --nalEnd; // part of the next 'start code'
+
+    if (nalEnd > nalStart) {
+      if (fNumNALs == fMaxNumNALs) {
+	unsigned newMaxNumNALs = fMaxNumNALs == 0 ? 256 : 2*fMaxNumNALs;
+	unsigned* newOffsets = new unsigned[newMaxNumNALs];
+	unsigned* newSizes = new unsigned[newMaxNumNALs];
+	u_int64_t* newTimes = new u_int64_t[newMaxNumNALs];
+	unsigned* newDurations = new unsigned[newMaxNumNALs];
+	for (unsigned k = 0; k < fNumNALs; ++k) {
+	  newOffsets[k] = fNALOffsets[k]; newSizes[k] = fNALSizes[k];
+	  newTimes[k] = fNALTimes[k]; newDurations[k] = fNALDurations[k];
+	}
+	delete[] fNALOffsets; fNALOffsets = newOffsets;
+	delete[] fNALSizes; fNALSizes = newSizes;
+	delete[] fNALTimes; fNALTimes = newTimes;
+	delete[] fNALDurations; fNALDurations = newDurations;
+	fMaxNumNALs = newMaxNumNALs;
+      }
+      fNALOffsets[fNumNALs] = nalStart;
+      fNALSizes[fNumNALs] = nalEnd - nalStart;
+      ++fNumNALs;
+    }
+    i = j;
+  }
+
+  return True;
+}
+
+unsigned ArchiveStreamSource
+::assignNALUnitTimes(u_int64_t startTime, u_int64_t frameDuration, unsigned maxNumPictures) {
+  // Group our NAL units into pictures (with each non-VCL NAL unit belonging to the picture that follows it), and
+  // give each NAL unit its picture's time.  The last NAL unit of each picture gets "frameDuration"; the others
+  // get 0.  NAL units beyond the first "maxNumPictures" pictures are discarded.  Returns the number of pictures.
+  int pictureNum = -1;
+  Boolean pictureHasVCL = False;
+  for (unsigned i = 0; i < fNumNALs; ++i) {
+    Boolean isFirstSliceInPicture = False;
+    Boolean nalIsVCL = isVCL(fHNumber, &fData[fNALOffsets[i]], fNALSizes[i], isFirstSliceInPicture);
+    Boolean startsNewPicture = pictureNum < 0 || (pictureHasVCL && (!nalIsVCL || isFirstSliceInPicture));
+    if (startsNewPicture) {
+      if ((unsigned)(pictureNum + 1) >= maxNumPictures) {
+	fNumNALs = i;
+	break;
+      }
+      ++pictureNum;
+      pictureHasVCL = False;
+    }
+    if (nalIsVCL) pictureHasVCL = True;
+
+    fNALTimes[i] = startTime + (u_int64_t)pictureNum*frameDuration;
+    fNALDurations[i] = (unsigned)pictureNum; // for now
+  }
+
+  for (unsigned i = 0; i < fNumNALs; ++i) {
+    Boolean endsPicture = i + 1 == fNumNALs || fNALDurations[i+1] != fNALDurations[i];
+    fNALDurations[i] = endsPicture ? (unsigned)frameDuration : 0;
+  }
+
+  return (unsigned)(pictureNum + 1);
+}
+
+Boolean ArchiveStreamSource::locate(u_int64_t time, Boolean forward) {
+  // Find the last key frame at (or before) "time".  If "forward" is True, and this key frame is before "time",
+  // then use the following key frame instead.
+  int segmentNum = fArchive.segments().lookup(time);
+  if (segmentNum < 0) return False;
+
+  // If this segment can't be used (because it has no index - e.g., because it's still being recorded), then try
+  // an earlier one:
+  while (!useSegment(segmentNum)) {
+    if (--segmentNum < 0) return False;
+  }
+
+  fEntry = fIndex->lookup(time);
+  fHaveEntry = True;
+  u_int64_t const entryTime = fIndex->time(fEntry);
+  if (forward && entryTime < time) {
+    if ((unsigned)++fEntry >= fIndex->numEntries()) {
+      fHaveEntry = False;
+      return moveToAdjacentSegment(True);
+    }
+  } else if (!forward && entryTime > time) {
+    // "time" is before this segment's first key frame, so use the last key frame of the previous segment (if any):
+    moveToAdjacentSegment(False);
+  }
+  return True;
+}
+
+Boolean ArchiveStreamSource::useSegment(int segmentNum) {
+  RecordingSegment const* segment = fArchive.segments().segment(segmentNum);
+  if (fSegment != NULL && timevalToMicroseconds(fSegment->fStartTime) == timevalToMicroseconds(segment->fStartTime)) {
+    return True; // we're already using it
+  }
+
+  FILE* fid; SegmentKeyFrameIndex* index; u_int64_t fileSize;
+  if (fNextSegment != NULL
+      && timevalToMicroseconds(fNextSegment->fStartTime) == timevalToMicroseconds(segment->fStartTime)) {
+    // We've already opened this segment:
+    fid = fNextFid; index = fNextIndex; fileSize = fNextFileSize;
+    fNextFid = NULL; fNextIndex = NULL;
+    delete fNextSegment; fNextSegment = NULL;
+  } else if (!openSegment(segment, fid, index, fileSize)) {
+    return False;
+  }
+
+  if (fFid != NULL) CloseInputFile(fFid);
+  delete fIndex; delete fSegment;
+  fSegment = copySegment(segment);
+  fIndex = index;
+  fFid = fid;
+  fFileSize = fileSize;
+  fHavePrefetched = False;
+  return True;
+}
+
+Boolean ArchiveStreamSource::openSegment(RecordingSegment const* segment,
+					 FILE*& fid, SegmentKeyFrameIndex*& index, u_int64_t& fileSize) {
+  char* indexFileName = segment->indexFileName();
+  index = SegmentKeyFrameIndex::createFromFile(indexFileName);
+  delete[] indexFileName;
+  if (index == NULL || index->numEntries() == 0) {
+    delete index;
+    return False;
+  }
+
+  fid = OpenInputFile(envir(), segment->fFileName);
+  if (fid == NULL) {
+    delete index;
+    return False;
+  }
+  fileSize = GetFileSize(segment->fFileName, fid);
+#if defined(POSIX_FADV_SEQUENTIAL)
+  posix_fadvise(fileno(fid), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  return True;
+}
+
+Boolean ArchiveStreamSource::moveToAdjacentSegment(Boolean forward) {
+  // Note: The current segment might since have been removed from the list (by the recorder's retention policy),
+  // so we look for the adjacent segment by start time:
+  RecordingSegmentList const& segments = fArchive.segments();
+  u_int64_t const currentStartTime = fSegment == NULL ? 0 : timevalToMicroseconds(fSegment->fStartTime);
+
+  if (forward) {
+    for (unsigned pass = 0; pass < 2; ++pass) {
+      int i = segments.lookup(currentStartTime);
+      if (i >= 0 && timevalToMicroseconds(segments.segment(i)->fStartTime) <= currentStartTime) ++i;
+      for (; i >= 0 && (unsigned)i < segments.numSegments(); ++i) {
+	if (useSegment(i)) {
+	  fEntry = 0; fHaveEntry = True;
+	  return True;
+	}
+      }
+
+      // There may be new segments (if the archive is still being recorded), so reload the list, and try again:
+      if (pass == 0) fArchive.reloadSegmentList();
+    }
+  } else {
+    int i = segments.lookup(currentStartTime);
+    if (i >= 0 && timevalToMicroseconds(segments.segment(i)->fStartTime) >= currentStartTime) --i;
+    for (; i >= 0; --i) {
+      if (useSegment(i)) {
+	fEntry = fIndex->numEntries() - 1; fHaveEntry = True;
+	return True;
+      }
+    }
+  }
+  return False;
+}
+
+void ArchiveStreamSource::prefetchNextSegment() {
+  if (fHavePrefetched || fNextSegment != NULL || !fHaveEntry) return;
+  if (fIndex->time(fEntry) + ARCHIVE_PREFETCH_TIME_US < timevalToMicroseconds(fSegment->fEndTime)) return;
+  fHavePrefetched = True;
+
+  // Open the next segment (and read its index) now, and have the OS start reading its data, so that moving to it
+  // (when we reach the end of the current segment) doesn't stall:
+  fArchive.reloadSegmentList();
+  RecordingSegmentList const& segments = fArchive.segments();
+  int segmentNum = segments.lookupByStartTime(timevalToMicroseconds(fSegment->fStartTime));
+  if (segmentNum < 0 || (unsigned)segmentNum + 1 >= segments.numSegments()) return;
+
+  RecordingSegment const* segment = segments.segment(segmentNum + 1);
+  if (!openSegment(segment, fNextFid, fNextIndex, fNextFileSize)) return;
+  fNextSegment = copySegment(segment);
+#if defined(POSIX_FADV_WILLNEED)
+  posix_fadvise(fileno(fNextFid), (off_t)fNextIndex->offset(0), ARCHIVE_PREFETCH_SIZE, POSIX_FADV_WILLNEED);
+#endif
+}
+
+void ArchiveStreamSource::closeSegments() {
+  if (fFid != NULL) CloseInputFile(fFid);
+  delete fIndex; delete fSegment;
+  fFid = NULL; fIndex = NULL; fSegment = NULL;
+
+  if (fNextFid != NULL) CloseInputFile(fNextFid);
+  delete fNextIndex; delete fNextSegment;
+  fNextFid = NULL; fNextIndex = NULL; fNextSegment = NULL;
+}
+
+////////// ArchiveServerMediaSubsession //////////
+
+ArchiveServerMediaSubsession*
+ArchiveServerMediaSubsession::createNew(UsageEnvironment& env, char const* fileNamePrefix, int hNumber) {
+  if (hNumber != 264 && hNumber != 265) {
+    env.setResultMsg("ArchiveServerMediaSubsession::createNew(): \"hNumber\" must be 264 or 265");
+    return NULL;
+  }
+
+  return new ArchiveServerMediaSubsession(env, fileNamePrefix == NULL ? "" : fileNamePrefix, hNumber);
+}
+
+ArchiveServerMediaSubsession
+::ArchiveServerMediaSubsession(UsageEnvironment& env, char const* fileNamePrefix, int hNumber)
+  : OnDemandServerMediaSubsession(env, False/*each client gets its own source*/),
+    fHNumber(hNumber), fSegmentListInode(0), fSegmentListModificationTime(0), fSegmentListSize(0) {
+  fSegmentListFileName = new char[strlen(fileNamePrefix) + 5 + 1];
+  sprintf(fSegmentListFileName, "%sindex", fileNamePrefix);
+  fAbsStartTime[0] = '\0';
+
+  reloadSegmentList();
+}
+
+ArchiveServerMediaSubsession::~ArchiveServerMediaSubsession() {
+  delete[] fSegmentListFileName;
+}
+
+void ArchiveServerMediaSubsession::reloadSegmentList() {
+  struct stat sb;
+  if (stat(fSegmentListFileName, &sb) != 0) return;
+  if ((unsigned long)sb.st_ino == fSegmentListInode && (long)sb.st_mtime == fSegmentListModificationTime
+      && (u_int64_t)sb.st_size == fSegmentListSize) return;
+
+  if (!fSegments.readFromFile(fSegmentListFileName)) return;
+  fSegmentListInode = (unsigned long)sb.st_ino;
+  fSegmentListModificationTime = (long)sb.st_mtime;
+  fSegmentListSize = (u_int64_t)sb.st_size;
+
+  if (fSegments.numSegments() > 0) {
+    formatAbsoluteTime(timevalToMicroseconds(fSegments.segment(0)->fStartTime), fAbsStartTime);
+  } else {
+    fAbsStartTime[0] = '\0';
+  }
+}
+
+void ArchiveServerMediaSubsession
+::seekStreamSource(FramedSource* inputSource, double& seekNPT, double streamDuration, u_int64_t& numBytes) {
+  numBytes = 0; // unknown
+  ArchiveStreamSource* source = (ArchiveStreamSource*)(((FramedFilter*)inputSource)->inputSource());
+
+  // 'NPT' is measured from the start of the archive:
+  reloadSegmentList();
+  if (fSegments.numSegments() == 0) return;
+  u_int64_t archiveStartTime = timevalToMicroseconds(fSegments.segment(0)->fStartTime);
+
+  u_int64_t const requestedTime = archiveStartTime + (u_int64_t)(seekNPT*1000000);
+  u_int64_t resultTime;
+  if (!source->seekTo(requestedTime, resultTime)) return;
+  seekNPT = resultTime > archiveStartTime ? (resultTime - archiveStartTime)/1000000.0 : 0.0;
+  // The requested range ends "streamDuration" after its (requested) start - not after the key frame that we start from:
+  source->setStreamDuration(streamDuration, requestedTime);
+}
+
+void ArchiveServerMediaSubsession::seekStreamSource(FramedSource* inputSource, char*& absStart, char*& absEnd) {
+  ArchiveStreamSource* source = (ArchiveStreamSource*)(((FramedFilter*)inputSource)->inputSource());
+
+  u_int64_t startTime, resultTime;
+  if (absStart == NULL || !parseAbsoluteTime(absStart, startTime) || !source->seekTo(startTime, resultTime)) {
+    // We can't seek to this time, so show that we didn't handle it:
+    delete[] absStart; absStart = NULL;
+    delete[] absEnd; absEnd = NULL;
+    return;
+  }
+
+  // Report the time that we actually seeked to (the time of a key frame):
+  char buf[40];
+  formatAbsoluteTime(resultTime, buf);
+  delete[] absStart; absStart = strDup(buf);
+
+  u_int64_t endTime;
+  if (absEnd != NULL && parseAbsoluteTime(absEnd, endTime)) {
+    source->setEndTime(endTime);
+  } else {
+    source->setEndTime(0);
+  }
+}
+
+void ArchiveServerMediaSubsession::setStreamSourceScale(FramedSource* inputSource, float scale) {
+  ArchiveStreamSource* source = (ArchiveStreamSource*)(((FramedFilter*)inputSource)->inputSource());
+  source->setScale(scale);
+}
+
+void ArchiveServerMediaSubsession
+::setStreamSourceDuration(FramedSource* inputSource, double streamDuration, u_int64_t& numBytes) {
+  numBytes = 0; // unknown
+  ArchiveStreamSource* source = (ArchiveStreamSource*)(((FramedFilter*)inputSource)->inputSource());
+  source->setStreamDuration(streamDuration);
+}
+
+FramedSource* ArchiveServerMediaSubsession::createNewStreamSource(unsigned /*clientSessionId*/, unsigned& estBitrate) {
+  reloadSegmentList();
+
+  estBitrate = 500; // kbps, unless we can estimate it from the archive:
+  float archiveDuration = duration();
+  if (archiveDuration > 0.0) estBitrate = (unsigned)(fSegments.totalSize()*8/archiveDuration/1000);
+
+  ArchiveStreamSource* source = ArchiveStreamSource::createNew(envir(), *this);
+  if (source == NULL) return NULL;
+
+  if (fHNumber == 264) {
+    return H264VideoStreamDiscreteFramer::createNew(envir(), source);
+  } else {
+    return H265VideoStreamDiscreteFramer::createNew(envir(), source);
+  }
+}
+
+RTPSink* ArchiveServerMediaSubsession
+::createNewRTPSink(Groupsock* rtpGroupsock, unsigned char rtpPayloadTypeIfDynamic, FramedSource* /*inputSource*/) {
+  // Each segment begins with the stream's parameter sets, so get these (for our SDP description) from the start
+  // of the most recent segment:
+  u_int8_t const* parameterSets[3] = { NULL, NULL, NULL }; // VPS, SPS, PPS
+  unsigned parameterSetSizes[3] = { 0, 0, 0 };
+  unsigned char* buf = NULL;
+  unsigned bufSize = 0;
+
+  for (int i = (int)fSegments.numSegments() - 1; i >= 0 && bufSize == 0; --i) {
+    FILE* fid = OpenInputFile(envir(), fSegments.segment(i)->fFileName);
+    if (fid == NULL) continue;
+
+    delete[] buf; buf = new unsigned char[64*1024];
+    bufSize = (unsigned)fread(buf, 1, 64*1024, fid);
+    CloseInputFile(fid);
+  }
+
+  for (unsigned j = 0; j + 3 < bufSize; ++j) {
+    if (buf[j] != 0 || buf[j+1] != 0 || buf[j+2] != 1) continue;
+
+    unsigned nalStart = j + 3, nalEnd = nalStart;
+    while (nalEnd + 3 <= bufSize && !(buf[nalEnd] == 0 && buf[nalEnd+1] == 0 && buf[nalEnd+2] == 1)) ++nalEnd;
+    if (nalEnd + 3 > bufSize) break; // this NAL unit might not be complete
+    unsigned nalSize = nalEnd - nalStart;
+    while (nalSize > 0 && buf[nalStart + nalSize - 1] == 0) --nalSize;
+    if (nalSize == 0) continue;
+
+    int k = -1;
+    if (fHNumber == 264) {
+      u_int8_t nal_unit_type = buf[nalStart]&0x1F;
+      k = nal_unit_type == 7 ? 1 : nal_unit_type == 8 ? 2 : -1;
+    } else {
+      u_int8_t nal_unit_type = (buf[nalStart]&0x7E)>>1;
+      k = nal_unit_type == 32 ? 0 : nal_unit_type == 33 ? 1 : nal_unit_type == 34 ? 2 : -1;
+    }
+    if (k >= 0 && parameterSets[k] == NULL) {
+      parameterSets[k] = &buf[nalStart];
+      parameterSetSizes[k] = nalSize;
+    }
+    j = nalEnd - 1;
+  }
+
+  RTPSink* rtpSink;
+  if (fHNumber == 264) {
+    rtpSink = H264VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic,
+					  parameterSets[1], parameterSetSizes[1],
+					  parameterSets[2], parameterSetSizes[2]);
+  } else {
+    rtpSink = H265VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic,
+					  parameterSets[0], parameterSetSizes[0],
+					  parameterSets[1], parameterSetSizes[1],
+					  parameterSets[2], parameterSetSizes[2]);
+  }
+  delete[] buf;
+  return rtpSink;
+}
+
+void ArchiveServerMediaSubsession::testScaleFactor(float& scale) {
+  // We support any scale (but, other than for scales between 0 and 1, we send only key frames):
+  if (scale == 0.0f) scale = 1.0f;
+}
+
+float ArchiveServerMediaSubsession::duration() const {
+  unsigned numSegments = fSegments.numSegments();
+  if (numSegments == 0) return 0.0;
+
+  u_int64_t startTime = timevalToMicroseconds(fSegments.segment(0)->fStartTime);
+  u_int64_t endTime = timevalToMicroseconds(fSegments.segment(numSegments-1)->fEndTime);
+  return endTime > startTime ? (endTime - startTime)/1000000.0f : 0.0f;
+}
+
+void ArchiveServerMediaSubsession::getAbsoluteTimeRange(char*& absStartTime, char*& absEndTime) const {
+  // Because the archive may still be being recorded, we report no end time:
+  absStartTime = fAbsStartTime[0] == '\0' ? NULL : (char*)fAbsStartTime;
+  absEndTime = NULL;
+}
@@ -65,7 +65,7 @@ void BasicUDPSource::incomingPacketHandler1() {
   if (!isCurrentlyAwaitingData()) return; // we're not ready for the data yet
 
   // Read the packet into our desired destination:
-  struct sockaddr_in fromAddress;
+  struct sockaddr_storage fromAddress;
   if (!fInputGS->handleRead(fTo, fMaxSize, fFrameSize, fromAddress)) return;
 
   // Tell our client that we have new data:
@@ -32,6 +32,7 @@ FileSink::FileSink(UsageEnvironment& env, FILE* fid, unsigned bufferSize,
 		   char const* perFrameFileNamePrefix)
   : MediaSink(env), fOutFid(fid), fBufferSize(bufferSize), fSamePresentationTimeCounter(0) {
   fBuffer = new unsigned char[bufferSize];
+  fWriter = RecordingWriter::createNew(env, fid);
   if (perFrameFileNamePrefix != NULL) {
     fPerFrameFileNamePrefix = strDup(perFrameFileNamePrefix);
     fPerFrameFileNameBuffer = new char[strlen(perFrameFileNamePrefix) + 100];
@@ -46,6 +47,7 @@ FileSink::~FileSink() {
   delete[] fPerFrameFileNameBuffer;
   delete[] fPerFrameFileNamePrefix;
   delete[] fBuffer;
+  Medium::close(fWriter); // writes any remaining data
   if (fOutFid != NULL) fclose(fOutFid);
 }
 
@@ -71,9 +73,23 @@ FileSink* FileSink::createNew(UsageEnvironment& env, char const* fileName,
   return NULL;
 }
 
+void FileSink::setWriteParameters(RecordingWriterParameters const& params) {
+  if (fWriter == NULL) return;
+
+  // Replace our current writer (after it has written all of its data) with a new one:
+  Medium::close(fWriter);
+  fWriter = RecordingWriter::createNew(envir(), fOutFid, params);
+}
+
 Boolean FileSink::continuePlaying() {
   if (fSource == NULL) return False;
 
+  if (fWriter != NULL && !fWriter->hasFreeBuffer()) {
+    // The disk isn't keeping up with us.  Rather than block (or drop data), don't ask for the next frame until it has:
+    fWriter->notifyWhenBufferIsFree(writerHasFreeBuffer, this);
+    return True;
+  }
+
   fSource->getNextFrame(fBuffer, fBufferSize,
 			afterGettingFrame, this,
 			onSourceClosure, this);
@@ -81,6 +97,11 @@ Boolean FileSink::continuePlaying() {
   return True;
 }
 
+void FileSink::writerHasFreeBuffer(void* clientData) {
+  FileSink* sink = (FileSink*)clientData;
+  if (sink->fSource != NULL && !sink->fSource->isCurrentlyAwaitingData()) sink->continuePlaying();
+}
+
 void FileSink::afterGettingFrame(void* clientData, unsigned frameSize,
 				 unsigned numTruncatedBytes,
 				 struct timeval presentationTime,
@@ -120,7 +141,11 @@ void FileSink::addData(unsigned char const* data, unsigned dataSize,
   if (!packetIsLost)
 #endif
   if (fOutFid != NULL && data != NULL) {
-    fwrite(data, 1, dataSize, fOutFid);
+    if (fWriter != NULL) {
+      fWriter->addData(data, dataSize); // a failure will be noticed by "afterGettingFrame()"
+    } else {
+      fwrite(data, 1, dataSize, fOutFid);
+    }
   }
 }
 
@@ -135,7 +160,8 @@ void FileSink::afterGettingFrame(unsigned frameSize,
   }
   addData(fBuffer, frameSize, presentationTime);
 
-  if (fOutFid == NULL || fflush(fOutFid) == EOF) {
+  if (fOutFid == NULL
+      || (fWriter != NULL ? !fWriter->endOfFrame() : fflush(fOutFid) == EOF)) {
     // The output file has closed.  Handle this the same way as if the input source had closed:
     if (fSource != NULL) fSource->stopGettingFrames();
     onSourceClosure();
@@ -57,3 +57,7 @@ void FramedFilter::doStopGettingFrames() {
   FramedSource::doStopGettingFrames();
   if (fInputSource != NULL) fInputSource->stopGettingFrames();
 }
+
+void FramedFilter::setTargetBitrate(unsigned targetBitrate) {
+  if (fInputSource != NULL) fInputSource->setTargetBitrate(targetBitrate);
+}
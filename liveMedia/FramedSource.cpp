@@ -124,3 +124,7 @@ unsigned FramedSource::maxFrameSize() const {
   // By default, this source has no maximum frame size.
   return 0;
 }
+
+void FramedSource::setTargetBitrate(unsigned /*targetBitrate*/) {
+  // By default, this source can't change its bitrate, so we ignore the request.
+}
@@ -20,7 +20,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "GenericMediaServer.hh"
+#include "PoolAllocator.hh"
 #include <GroupsockHelper.hh>
+#include <stdarg.h>
 #if defined(__WIN32__) || defined(_WIN32) || defined(_QNX4)
 #define snprintf _snprintf
 #endif
@@ -92,22 +94,82 @@ GenericMediaServer
 ::GenericMediaServer(UsageEnvironment& env, int ourSocket, Port ourPort,
 		     unsigned reclamationSeconds)
   : Medium(env),
-    fServerSocket(ourSocket), fServerPort(ourPort), fReclamationSeconds(reclamationSeconds),
+    fServerSocket(ourSocket), fServerSocketIPv6(-1), fServerPort(ourPort),
+    fTLSServerSocket(-1), fTLSServerSocketIPv6(-1), fTLSServerPort(0), fTLSServerContext(NULL),
+    fReclamationSeconds(reclamationSeconds),
     fServerMediaSessions(HashTable::create(STRING_HASH_KEYS)),
     fClientConnections(HashTable::create(ONE_WORD_HASH_KEYS)),
     fClientSessions(HashTable::create(STRING_HASH_KEYS)),
-    fPreviousClientSessionId(0)
+    fPreviousClientSessionId(0), fNumConnectionBufferBytes(0)
 {
   ignoreSigPipeOnSocket(fServerSocket); // so that clients on the same host that are killed don't also kill us
   
   // Arrange to handle connections from others:
   env.taskScheduler().turnOnBackgroundReadHandling(fServerSocket, incomingConnectionHandler, this);
+
+  // Also accept connections from IPv6 clients, on the same port.  (If this fails - e.g., because this host doesn't
+  // support IPv6 - then we accept IPv4 connections only.)  We do this only if we have our own (IPv4) socket; a server
+  // that's created without one (e.g., one that's handed its connections by another server) mustn't listen at all.
+  if (fServerSocket >= 0) {
+    char* savedResultMsg = strDup(env.getResultMsg()); // (a failure here isn't an error of ours)
+    Port ourPortIPv6 = fServerPort;
+    fServerSocketIPv6 = setUpOurSocket(env, ourPortIPv6, AF_INET6);
+    if (fServerSocketIPv6 >= 0) {
+      env.taskScheduler().turnOnBackgroundReadHandling(fServerSocketIPv6, incomingConnectionHandlerIPv6, this);
+    } else {
+      env.setResultMsg(savedResultMsg);
+    }
+    delete[] savedResultMsg;
+  }
 }
 
 GenericMediaServer::~GenericMediaServer() {
   // Turn off background read handling:
   envir().taskScheduler().turnOffBackgroundReadHandling(fServerSocket);
   ::closeSocket(fServerSocket);
+
+  if (fServerSocketIPv6 >= 0) {
+    envir().taskScheduler().turnOffBackgroundReadHandling(fServerSocketIPv6);
+    ::closeSocket(fServerSocketIPv6);
+  }
+
+  if (fTLSServerSocket >= 0) {
+    envir().taskScheduler().turnOffBackgroundReadHandling(fTLSServerSocket);
+    ::closeSocket(fTLSServerSocket);
+  }
+  if (fTLSServerSocketIPv6 >= 0) {
+    envir().taskScheduler().turnOffBackgroundReadHandling(fTLSServerSocketIPv6);
+    ::closeSocket(fTLSServerSocketIPv6);
+  }
+  delete fTLSServerContext;
+}
+
+Boolean GenericMediaServer
+::setUpTLS(char const* certFileName, char const* privateKeyFileName, Port tlsPort) {
+  if (fTLSServerContext != NULL) return False; // we've already been set up for TLS
+
+  fTLSServerContext = TLSServerContext::createNew(envir(), certFileName, privateKeyFileName);
+  if (fTLSServerContext == NULL) return False;
+
+  fTLSServerSocket = setUpOurSocket(envir(), tlsPort);
+  if (fTLSServerSocket < 0) {
+    delete fTLSServerContext; fTLSServerContext = NULL;
+    return False;
+  }
+
+  fTLSServerPort = tlsPort;
+  envir().taskScheduler().turnOnBackgroundReadHandling(fTLSServerSocket, incomingConnectionHandlerTLS, this);
+
+  // Also accept TLS connections from IPv6 clients (if we can):
+  fTLSServerSocketIPv6 = setUpOurSocket(envir(), tlsPort, AF_INET6);
+  if (fTLSServerSocketIPv6 >= 0) {
+    envir().taskScheduler().turnOnBackgroundReadHandling(fTLSServerSocketIPv6, incomingConnectionHandlerTLSIPv6, this);
+  }
+  return True;
+}
+
+portNumBits GenericMediaServer::tlsServerPortNum() const {
+  return ntohs(fTLSServerPort.num());
 }
 
 void GenericMediaServer::cleanup() {
@@ -141,7 +203,7 @@ void GenericMediaServer::cleanup() {
 
 #define LISTEN_BACKLOG_SIZE 20
 
-int GenericMediaServer::setUpOurSocket(UsageEnvironment& env, Port& ourPort) {
+int GenericMediaServer::setUpOurSocket(UsageEnvironment& env, Port& ourPort, int domain) {
   int ourSocket = -1;
   
   do {
@@ -152,7 +214,7 @@ int GenericMediaServer::setUpOurSocket(UsageEnvironment& env, Port& ourPort) {
     NoReuse dummy(env); // Don't use this socket if there's already a local server using it
 #endif
     
-    ourSocket = setupStreamSocket(env, ourPort, True, True);
+    ourSocket = setupStreamSocket(env, ourPort, True, True, domain);
     if (ourSocket < 0) break;
     
     // Make sure we have a big send buffer:
@@ -184,8 +246,26 @@ void GenericMediaServer::incomingConnectionHandler() {
   incomingConnectionHandlerOnSocket(fServerSocket);
 }
 
-void GenericMediaServer::incomingConnectionHandlerOnSocket(int serverSocket) {
-  struct sockaddr_in clientAddr;
+void GenericMediaServer::incomingConnectionHandlerTLS(void* instance, int /*mask*/) {
+  GenericMediaServer* server = (GenericMediaServer*)instance;
+  server->incomingConnectionHandlerTLS();
+}
+void GenericMediaServer::incomingConnectionHandlerTLS() {
+  incomingConnectionHandlerOnSocket(fTLSServerSocket, fTLSServerContext);
+}
+
+void GenericMediaServer::incomingConnectionHandlerIPv6(void* instance, int /*mask*/) {
+  GenericMediaServer* server = (GenericMediaServer*)instance;
+  server->incomingConnectionHandlerOnSocket(server->fServerSocketIPv6);
+}
+
+void GenericMediaServer::incomingConnectionHandlerTLSIPv6(void* instance, int /*mask*/) {
+  GenericMediaServer* server = (GenericMediaServer*)instance;
+  server->incomingConnectionHandlerOnSocket(server->fTLSServerSocketIPv6, server->fTLSServerContext);
+}
+
+void GenericMediaServer::incomingConnectionHandlerOnSocket(int serverSocket, TLSServerContext* tlsContext) {
+  struct sockaddr_storage clientAddr;
   SOCKLEN_T clientAddrLen = sizeof clientAddr;
   int clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
   if (clientSocket < 0) {
@@ -204,15 +284,17 @@ void GenericMediaServer::incomingConnectionHandlerOnSocket(int serverSocket) {
 #endif
   
   // Create a new object for handling this connection:
-  (void)createNewClientConnection(clientSocket, clientAddr);
+  ClientConnection* connection = createNewClientConnection(clientSocket, clientAddr);
+  if (connection != NULL && tlsContext != NULL) connection->startTLS(*tlsContext);
 }
 
 
 ////////// GenericMediaServer::ClientConnection implementation //////////
 
 GenericMediaServer::ClientConnection
-::ClientConnection(GenericMediaServer& ourServer, int clientSocket, struct sockaddr_in clientAddr)
-  : fOurServer(ourServer), fOurSocket(clientSocket), fClientAddr(clientAddr) {
+::ClientConnection(GenericMediaServer& ourServer, int clientSocket, struct sockaddr_storage const& clientAddr)
+  : fOurServer(ourServer), fOurSocket(clientSocket), fClientAddr(clientAddr), fTLSState(NULL),
+    fRequestBuffer(NULL), fRequestBufferSize(0), fResponseBuffer(NULL), fResponseBufferSize(0) {
   // Add ourself to our 'client connections' table:
   fOurServer.fClientConnections->Add((char const*)this, this);
   
@@ -227,9 +309,13 @@ GenericMediaServer::ClientConnection::~ClientConnection() {
   fOurServer.fClientConnections->Remove((char const*)this);
   
   closeSockets();
+  releaseBuffers();
 }
 
 void GenericMediaServer::ClientConnection::closeSockets() {
+  // Our TLS state (if any) can't outlive our socket:
+  delete fTLSState; fTLSState = NULL;
+
   // Turn off background handling on our socket:
   envir().taskScheduler().disableBackgroundHandling(fOurSocket);
   if (fOurSocket>= 0) ::closeSocket(fOurSocket);
@@ -243,15 +329,158 @@ void GenericMediaServer::ClientConnection::incomingRequestHandler(void* instance
 }
 
 void GenericMediaServer::ClientConnection::incomingRequestHandler() {
-  struct sockaddr_in dummy; // 'from' address, meaningless in this case
+  struct sockaddr_storage dummy; // 'from' address, meaningless in this case
   
-  int bytesRead = readSocket(envir(), fOurSocket, &fRequestBuffer[fRequestBytesAlreadySeen], fRequestBufferBytesLeft, dummy);
+  if (!ensureRequestBufferSpace()) {
+    handleRequestBytes(-1);
+    return;
+  }
+
+  // If our buffer can still grow, then don't let this read fill it completely, because "handleRequestBytes()" would then
+  // treat the request as being too large:
+  unsigned maxBytesToRead = fRequestBufferBytesLeft;
+  if (fRequestBufferSize < REQUEST_BUFFER_SIZE && maxBytesToRead > 1) --maxBytesToRead;
+
+  int bytesRead;
+  if (fTLSState != NULL) {
+    bytesRead = fTLSState->read(&fRequestBuffer[fRequestBytesAlreadySeen], maxBytesToRead);
+    if (bytesRead == 0) return; // the socket had only (part of) a TLS record, with no request data yet
+    fTLSState->continueReadingIfBuffered(incomingRequestHandler, this); // in case we didn't read everything
+  } else {
+    bytesRead = readSocket(envir(), fOurSocket, &fRequestBuffer[fRequestBytesAlreadySeen], maxBytesToRead, dummy);
+  }
   handleRequestBytes(bytesRead);
 }
 
+void GenericMediaServer::ClientConnection::startTLS(TLSServerContext& tlsContext) {
+  fTLSState = TLSState::createNewForServer(envir(), fOurSocket, tlsContext);
+  if (fTLSState == NULL) {
+    delete this;
+    return;
+  }
+
+  // Don't read any requests until the handshake is done:
+  envir().taskScheduler().disableBackgroundHandling(fOurSocket);
+  fTLSState->startHandshake(tlsHandshakeCompletionHandler, this);
+}
+
+void GenericMediaServer::ClientConnection::tlsHandshakeCompletionHandler(void* instance, Boolean success) {
+  ClientConnection* connection = (ClientConnection*)instance;
+  connection->tlsHandshakeCompletionHandler(success);
+}
+
+void GenericMediaServer::ClientConnection::tlsHandshakeCompletionHandler(Boolean success) {
+  if (!success) {
+#ifdef DEBUG
+    fprintf(stderr, "TLS handshake with %s failed: %s\n", AddressString(fClientAddr).val(), envir().getResultMsg());
+#endif
+    delete this;
+    return;
+  }
+
+  envir().taskScheduler()
+    .setBackgroundHandling(fOurSocket, SOCKET_READABLE|SOCKET_EXCEPTION, incomingRequestHandler, this);
+  fTLSState->continueReadingIfBuffered(incomingRequestHandler, this); // in case a request arrived with the handshake
+}
+
 void GenericMediaServer::ClientConnection::resetRequestBuffer() {
   fRequestBytesAlreadySeen = 0;
-  fRequestBufferBytesLeft = sizeof fRequestBuffer;
+  fRequestBufferBytesLeft = fRequestBufferSize;
+}
+
+static unsigned maxPoolBufferSize(unsigned maxSize) {
+  // Returns the smallest power of 2 that's at least "maxSize".  (A buffer of "maxSize" bytes would take a
+  // "PoolAllocator" block of this size anyway, so we let the buffer use all of it.)
+  unsigned result = 1;
+  while (result < maxSize) result *= 2;
+  return result;
+}
+
+Boolean GenericMediaServer::ClientConnection::ensureRequestBufferSpace(unsigned numBytesToAdd) {
+  if (fRequestBuffer == NULL) {
+    // We've been idle, so we don't yet have a request buffer.  Allocate a small one:
+    fRequestBuffer = (unsigned char*)PoolAllocator::forEnvironment(envir()).allocate(INITIAL_REQUEST_BUFFER_SIZE);
+    if (fRequestBuffer == NULL) return False;
+    fRequestBufferSize = INITIAL_REQUEST_BUFFER_SIZE;
+    fOurServer.fNumConnectionBufferBytes += fRequestBufferSize;
+    resetRequestBuffer();
+    requestBufferWasReallocated(NULL);
+  }
+
+  unsigned const maxSize = maxPoolBufferSize(REQUEST_BUFFER_SIZE);
+  while (fRequestBufferBytesLeft <= numBytesToAdd && fRequestBufferSize < maxSize
+	 && requestBufferMayBeReallocated()) {
+    // Grow our request buffer (e.g., for a request with a large body):
+    unsigned newSize = 2*fRequestBufferSize;
+    if (newSize > maxSize) newSize = maxSize;
+    unsigned char* newBuffer = (unsigned char*)PoolAllocator::forEnvironment(envir()).allocate(newSize);
+    if (newBuffer == NULL) break;
+    memmove(newBuffer, fRequestBuffer, fRequestBytesAlreadySeen);
+
+    unsigned char* oldBuffer = fRequestBuffer;
+    fRequestBuffer = newBuffer;
+    fRequestBufferBytesLeft += newSize - fRequestBufferSize;
+    fOurServer.fNumConnectionBufferBytes += newSize - fRequestBufferSize;
+    fRequestBufferSize = newSize;
+    requestBufferWasReallocated(oldBuffer);
+    PoolAllocator::deallocate(oldBuffer);
+  }
+
+  return fRequestBufferBytesLeft > 0;
+}
+
+Boolean GenericMediaServer::ClientConnection::requestBufferMayBeReallocated() const {
+  return True; // by default
+}
+
+void GenericMediaServer::ClientConnection::requestBufferWasReallocated(unsigned char* /*oldBuffer*/) {
+  // By default, do nothing
+}
+
+void GenericMediaServer::ClientConnection::ensureResponseBuffer() {
+  if (fResponseBuffer == NULL) {
+    // Allocate a small buffer; it will grow if a response needs more:
+    fResponseBuffer = (unsigned char*)PoolAllocator::forEnvironment(envir()).allocate(INITIAL_RESPONSE_BUFFER_SIZE);
+    fResponseBufferSize = INITIAL_RESPONSE_BUFFER_SIZE;
+    fOurServer.fNumConnectionBufferBytes += fResponseBufferSize;
+    fResponseBuffer[0] = '\0';
+  }
+}
+
+void GenericMediaServer::ClientConnection::formatResponse(char const* format, ...) {
+  ensureResponseBuffer();
+
+  unsigned const maxSize = maxPoolBufferSize(RESPONSE_BUFFER_SIZE);
+  while (1) {
+    va_list args;
+    va_start(args, format);
+    int responseSize = vsnprintf((char*)fResponseBuffer, fResponseBufferSize, format, args);
+    va_end(args);
+    if (responseSize < 0 || (unsigned)responseSize < fResponseBufferSize || fResponseBufferSize >= maxSize) return;
+
+    // The response didn't fit.  Replace our buffer with a larger one, and try again:
+    unsigned newSize = fResponseBufferSize;
+    while (newSize <= (unsigned)responseSize && newSize < maxSize) newSize *= 2;
+    if (newSize > maxSize) newSize = maxSize;
+    unsigned char* newBuffer = (unsigned char*)PoolAllocator::forEnvironment(envir()).allocate(newSize);
+    if (newBuffer == NULL) return; // keep the truncated response
+
+    PoolAllocator::deallocate(fResponseBuffer);
+    fResponseBuffer = newBuffer;
+    fOurServer.fNumConnectionBufferBytes += newSize - fResponseBufferSize;
+    fResponseBufferSize = newSize;
+  }
+}
+
+void GenericMediaServer::ClientConnection::releaseBuffers() {
+  fOurServer.fNumConnectionBufferBytes -= fRequestBufferSize + fResponseBufferSize;
+
+  PoolAllocator::deallocate(fRequestBuffer); fRequestBuffer = NULL;
+  fRequestBufferSize = 0;
+  resetRequestBuffer();
+
+  PoolAllocator::deallocate(fResponseBuffer); fResponseBuffer = NULL;
+  fResponseBufferSize = 0;
 }
 
 
@@ -0,0 +1,159 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A filter that reduces the bitrate of a H.264 or H.265 video stream by dropping (temporal) layers
+// Implementation
+
+#include "H264or5VideoLayerDropper.hh"
+#include "GroupsockHelper.hh"
+
+// How often we update our measurements of each layer's bitrate:
+#define MEASUREMENT_INTERVAL_USECS 1000000
+
+H264or5VideoLayerDropper*
+H264or5VideoLayerDropper::createNew(UsageEnvironment& env, FramedSource* inputSource, int hNumber) {
+  if (hNumber != 264 && hNumber != 265) {
+    env.setResultMsg("H264or5VideoLayerDropper::createNew(): \"hNumber\" must be 264 or 265");
+    return NULL;
+  }
+
+  return new H264or5VideoLayerDropper(env, inputSource, hNumber);
+}
+
+H264or5VideoLayerDropper
+::H264or5VideoLayerDropper(UsageEnvironment& env, FramedSource* inputSource, int hNumber)
+  : FramedFilter(env, inputSource),
+    fHNumber(hNumber), fTargetBitrate(0), fMaxLayer(MAX_LAYERS-1), fDesiredMaxLayer(MAX_LAYERS-1),
+    fNumNALUnitsDropped(0), fHaveMeasurements(False) {
+  for (unsigned i = 0; i < MAX_LAYERS; ++i) {
+    fLayerBytes[i] = 0;
+    fLayerBitrates[i] = 0.0;
+  }
+  gettimeofday(&fMeasurementStartTime, NULL);
+}
+
+H264or5VideoLayerDropper::~H264or5VideoLayerDropper() {
+}
+
+void H264or5VideoLayerDropper::doGetNextFrame() {
+  fInputSource->getNextFrame(fTo, fMaxSize,
+			     afterGettingFrame, this,
+			     FramedSource::handleClosure, this);
+}
+
+void H264or5VideoLayerDropper::setTargetBitrate(unsigned targetBitrate) {
+  fTargetBitrate = targetBitrate;
+  chooseDesiredMaxLayer();
+
+  // Also pass the request on to our input source, in case it can adapt its bitrate itself:
+  FramedFilter::setTargetBitrate(targetBitrate);
+}
+
+void H264or5VideoLayerDropper
+::afterGettingFrame(void* clientData, unsigned frameSize, unsigned numTruncatedBytes,
+		    struct timeval presentationTime, unsigned durationInMicroseconds) {
+  H264or5VideoLayerDropper* dropper = (H264or5VideoLayerDropper*)clientData;
+  dropper->afterGettingFrame1(frameSize, numTruncatedBytes, presentationTime, durationInMicroseconds);
+}
+
+void H264or5VideoLayerDropper
+::afterGettingFrame1(unsigned frameSize, unsigned numTruncatedBytes,
+		     struct timeval presentationTime, unsigned durationInMicroseconds) {
+  // Figure out which layer this NAL unit belongs to, and whether it's a point at which we can switch up to more layers:
+  unsigned layer = 0;
+  Boolean canSwitchUp = False;
+  if (fHNumber == 264) {
+    if (frameSize >= 1) {
+      u_int8_t nal_ref_idc = (fTo[0]&0x60)>>5;
+      u_int8_t nal_unit_type = fTo[0]&0x1F;
+      if (nal_unit_type >= 1 && nal_unit_type <= 5 && nal_ref_idc == 0) layer = 1; // a non-reference picture
+      canSwitchUp = True; // because nothing depends on non-reference pictures
+    }
+  } else { // 265
+    if (frameSize >= 2) {
+      u_int8_t nal_unit_type = (fTo[0]&0x7E)>>1;
+      u_int8_t nuh_temporal_id_plus1 = fTo[1]&0x07;
+      if (nal_unit_type <= 31 && nuh_temporal_id_plus1 > 0) { // a VCL NAL unit
+	layer = nuh_temporal_id_plus1 - 1;
+	if (layer >= MAX_LAYERS) layer = MAX_LAYERS-1;
+      }
+      if (nal_unit_type >= 16 && nal_unit_type <= 23) {
+	canSwitchUp = True; // an IRAP picture: Nothing after it depends on anything before it
+      } else if ((nal_unit_type == 2 || nal_unit_type == 3) && layer > fMaxLayer) {
+	canSwitchUp = True; // a TSA picture: We can switch up to its layer (or above)
+      } else if ((nal_unit_type == 4 || nal_unit_type == 5) && layer == fMaxLayer + 1 && layer <= fDesiredMaxLayer) {
+	fMaxLayer = layer; // a STSA picture: We can switch up to its layer (only)
+      }
+    }
+  }
+
+  // Update our measurement of each layer's bitrate:
+  fLayerBytes[layer] += frameSize;
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  int64_t uSecondsElapsed = (int64_t)(timeNow.tv_sec - fMeasurementStartTime.tv_sec)*1000000
+    + (timeNow.tv_usec - fMeasurementStartTime.tv_usec);
+  if (uSecondsElapsed >= MEASUREMENT_INTERVAL_USECS) {
+    for (unsigned i = 0; i < MAX_LAYERS; ++i) {
+      double bitrate = (fLayerBytes[i]*8000.0)/uSecondsElapsed; // kbps
+      fLayerBitrates[i] = fHaveMeasurements ? (fLayerBitrates[i] + bitrate)/2 : bitrate;
+      fLayerBytes[i] = 0;
+    }
+    fHaveMeasurements = True;
+    fMeasurementStartTime = timeNow;
+    chooseDesiredMaxLayer();
+  }
+
+  // Switch layers, if we want to (and can):
+  if (fDesiredMaxLayer < fMaxLayer) {
+    fMaxLayer = fDesiredMaxLayer; // we can always drop layers
+  } else if (fDesiredMaxLayer > fMaxLayer && canSwitchUp) {
+    fMaxLayer = fDesiredMaxLayer;
+  }
+
+  if (layer > fMaxLayer) {
+    // Drop this NAL unit, and get another one instead:
+    ++fNumNALUnitsDropped;
+    doGetNextFrame();
+    return;
+  }
+
+  fFrameSize = frameSize;
+  fNumTruncatedBytes = numTruncatedBytes;
+  fPresentationTime = presentationTime;
+  fDurationInMicroseconds = durationInMicroseconds;
+  afterGetting(this);
+}
+
+void H264or5VideoLayerDropper::chooseDesiredMaxLayer() {
+  if (fTargetBitrate == 0 || !fHaveMeasurements) {
+    fDesiredMaxLayer = MAX_LAYERS-1;
+    return;
+  }
+
+  // Use as many layers as fit within the target bitrate (but always layer 0).  To avoid switching back and forth,
+  // we drop our current layers only if they exceed the target by more than 15%:
+  double cumulativeBitrate = fLayerBitrates[0];
+  unsigned desiredMaxLayer = 0;
+  for (unsigned layer = 1; layer < MAX_LAYERS; ++layer) {
+    cumulativeBitrate += fLayerBitrates[layer];
+    double limit = layer <= fMaxLayer ? 1.15*fTargetBitrate : fTargetBitrate;
+    if (cumulativeBitrate > limit) break;
+    desiredMaxLayer = layer;
+  }
+  fDesiredMaxLayer = desiredMaxLayer;
+}
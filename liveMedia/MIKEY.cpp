@@ -0,0 +1,347 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A data structure that implements a MIKEY message (RFC 3830), used to deliver the keys (and crypto policy) for SRTP
+// Implementation
+
+#include "MIKEY.hh"
+#include "Base64.hh"
+#include <GroupsockHelper.hh> // for "our_random32()" and "gettimeofday()"
+#include <string.h>
+#include <stdio.h>
+#ifndef NO_OPENSSL
+#include <openssl/rand.h>
+#endif
+
+// MIKEY payload types (RFC 3830, section 6.1):
+#define PAYLOAD_LAST 0
+#define PAYLOAD_KEMAC 1
+#define PAYLOAD_T 5
+#define PAYLOAD_SP 10
+#define PAYLOAD_RAND 11
+
+// SRTP security policy parameter types (RFC 3830, section 6.10.1; RFC 7714, section 14.1):
+#define SP_ENCRYPTION_ALGORITHM 0
+#define SP_SESSION_ENCRYPTION_KEY_LENGTH 1
+#define SP_AUTHENTICATION_ALGORITHM 2
+#define SP_SESSION_AUTHENTICATION_KEY_LENGTH 3
+#define SP_SESSION_SALT_KEY_LENGTH 4
+#define SP_SRTP_PRF 5
+#define SP_SRTP_ENCRYPTION 7
+#define SP_SRTCP_ENCRYPTION 8
+#define SP_SRTP_AUTHENTICATION 10
+#define SP_AUTHENTICATION_TAG_LENGTH 11
+#define SP_AEAD_AUTHENTICATION_TAG_LENGTH 20
+
+#define ENCRYPTION_ALGORITHM_AES_CM 1
+#define ENCRYPTION_ALGORITHM_AES_GCM 6
+#define AUTHENTICATION_ALGORITHM_HMAC_SHA1 1
+
+#define KEY_DATA_TYPE_TEK 2
+#define KEY_DATA_TYPE_TEK_SALT 3
+
+static void randomBytes(u_int8_t* to, unsigned numBytes) {
+#ifndef NO_OPENSSL
+  if (RAND_bytes(to, numBytes) == 1) return;
+#endif
+  // (Not cryptographically secure, but this happens only if we don't have OpenSSL - in which case we can't do SRTP
+  // anyway.)
+  for (unsigned i = 0; i < numBytes; ++i) to[i] = (u_int8_t)our_random32();
+}
+
+static u_int32_t get4Bytes(u_int8_t const* p) {
+  return (p[0]<<24)|(p[1]<<16)|(p[2]<<8)|p[3];
+}
+
+static void put4Bytes(u_int8_t* p, u_int32_t value) {
+  p[0] = value>>24; p[1] = value>>16; p[2] = value>>8; p[3] = (u_int8_t)value;
+}
+
+////////// MIKEYState implementation //////////
+
+MIKEYState* MIKEYState::createNew(SRTPProfile profile, Boolean encryptSRTP, Boolean encryptSRTCP) {
+  MIKEYState* newState = new MIKEYState(profile, encryptSRTP, encryptSRTCP);
+  randomBytes(newState->fMasterKey, sizeof newState->fMasterKey);
+  randomBytes(newState->fMasterSalt, newState->masterSaltSize());
+  randomBytes(newState->fRand, sizeof newState->fRand);
+  randomBytes((u_int8_t*)&newState->fCSBId, sizeof newState->fCSBId);
+  return newState;
+}
+
+MIKEYState* MIKEYState::createNew(u_int8_t const* message, unsigned messageSize) {
+  MIKEYState* newState = new MIKEYState(AES_CM_128_HMAC_SHA1_80, True, True);
+  if (!newState->parseMessage(message, messageSize)) {
+    delete newState;
+    return NULL;
+  }
+  return newState;
+}
+
+MIKEYState* MIKEYState::createNewFromKeyMgmtAttribute(char const* attributeValue) {
+  if (attributeValue == NULL || strncmp(attributeValue, "mikey", 5) != 0) return NULL;
+  char const* base64Message = &attributeValue[5];
+  while (*base64Message == ' ') ++base64Message;
+
+  unsigned base64MessageSize = 0;
+  while (base64Message[base64MessageSize] != '\0' && base64Message[base64MessageSize] != '\r'
+	 && base64Message[base64MessageSize] != '\n' && base64Message[base64MessageSize] != ' ') {
+    ++base64MessageSize;
+  }
+
+  unsigned messageSize;
+  u_int8_t* message = base64Decode(base64Message, base64MessageSize, messageSize);
+  MIKEYState* result = createNew(message, messageSize);
+  delete[] message;
+  return result;
+}
+
+MIKEYState::MIKEYState(SRTPProfile profile, Boolean encryptSRTP, Boolean encryptSRTCP)
+  : fProfile(profile), fEncryptSRTP(encryptSRTP), fEncryptSRTCP(encryptSRTCP), fCSBId(0), fSSRC(0), fROC(0) {
+  memset(fMasterKey, 0, sizeof fMasterKey);
+  memset(fMasterSalt, 0, sizeof fMasterSalt);
+  memset(fRand, 0, sizeof fRand);
+}
+
+MIKEYState::~MIKEYState() {
+  // Don't leave the keys lying around in (freed) memory:
+  memset(fMasterKey, 0, sizeof fMasterKey);
+  memset(fMasterSalt, 0, sizeof fMasterSalt);
+}
+
+u_int8_t* MIKEYState::generateMessage(unsigned& messageSize, u_int32_t ssrc, u_int32_t roc) const {
+  // The security policy parameters:
+  u_int8_t params[40];
+  unsigned paramsSize = 0;
+#define ADD_PARAM(type, value) do { params[paramsSize++] = (type); params[paramsSize++] = 1; params[paramsSize++] = (value); } while (0)
+  if (fProfile == AEAD_AES_128_GCM) {
+    ADD_PARAM(SP_ENCRYPTION_ALGORITHM, ENCRYPTION_ALGORITHM_AES_GCM);
+    ADD_PARAM(SP_SESSION_ENCRYPTION_KEY_LENGTH, 16);
+    ADD_PARAM(SP_SESSION_SALT_KEY_LENGTH, 12);
+    ADD_PARAM(SP_SRTP_PRF, 0);
+    ADD_PARAM(SP_SRTP_ENCRYPTION, fEncryptSRTP ? 1 : 0);
+    ADD_PARAM(SP_SRTCP_ENCRYPTION, fEncryptSRTCP ? 1 : 0);
+    ADD_PARAM(SP_AEAD_AUTHENTICATION_TAG_LENGTH, 16);
+  } else {
+    ADD_PARAM(SP_ENCRYPTION_ALGORITHM, ENCRYPTION_ALGORITHM_AES_CM);
+    ADD_PARAM(SP_SESSION_ENCRYPTION_KEY_LENGTH, 16);
+    ADD_PARAM(SP_AUTHENTICATION_ALGORITHM, AUTHENTICATION_ALGORITHM_HMAC_SHA1);
+    ADD_PARAM(SP_SESSION_AUTHENTICATION_KEY_LENGTH, 20);
+    ADD_PARAM(SP_SESSION_SALT_KEY_LENGTH, 14);
+    ADD_PARAM(SP_SRTP_PRF, 0);
+    ADD_PARAM(SP_SRTP_ENCRYPTION, fEncryptSRTP ? 1 : 0);
+    ADD_PARAM(SP_SRTCP_ENCRYPTION, fEncryptSRTCP ? 1 : 0);
+    ADD_PARAM(SP_SRTP_AUTHENTICATION, 1);
+    ADD_PARAM(SP_AUTHENTICATION_TAG_LENGTH, 10);
+  }
+#undef ADD_PARAM
+
+  unsigned const saltSize = masterSaltSize();
+  unsigned const keyDataSize = 4 + MIKEY_SRTP_MASTER_KEY_SIZE + 2 + saltSize;
+  unsigned const hdrSize = 19, tSize = 10, randSize = 2 + sizeof fRand, spSize = 5 + paramsSize;
+  unsigned const kemacSize = 4 + keyDataSize + 1;
+  messageSize = hdrSize + tSize + randSize + spSize + kemacSize;
+  u_int8_t* message = new u_int8_t[messageSize];
+  u_int8_t* p = message;
+
+  // HDR (the 'common header'), with a single 'crypto session':
+  *p++ = 1; // version
+  *p++ = 0; // data type: 'pre-shared key' init
+  *p++ = PAYLOAD_T; // next payload
+  *p++ = 0; // V: no verification message wanted; PRF: MIKEY-1
+  put4Bytes(p, fCSBId); p += 4;
+  *p++ = 1; // #CS
+  *p++ = 0; // CS ID map type: SRTP-ID
+  *p++ = 0; // policy number
+  put4Bytes(p, ssrc); p += 4;
+  put4Bytes(p, roc); p += 4;
+
+  // T (the timestamp), as NTP-UTC:
+  *p++ = PAYLOAD_RAND;
+  *p++ = 0; // TS type: NTP-UTC
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  put4Bytes(p, timeNow.tv_sec + 0x83AA7E80); p += 4; // NTP time starts in 1900
+  put4Bytes(p, (u_int32_t)((timeNow.tv_usec*4294.967296))); p += 4;
+
+  // RAND:
+  *p++ = PAYLOAD_SP;
+  *p++ = sizeof fRand;
+  memcpy(p, fRand, sizeof fRand); p += sizeof fRand;
+
+  // SP (the security policy):
+  *p++ = PAYLOAD_KEMAC;
+  *p++ = 0; // policy number
+  *p++ = 0; // protocol type: SRTP
+  *p++ = paramsSize>>8; *p++ = (u_int8_t)paramsSize;
+  memcpy(p, params, paramsSize); p += paramsSize;
+
+  // KEMAC, containing (unencrypted) a single 'key data' sub-payload:
+  *p++ = PAYLOAD_LAST;
+  *p++ = 0; // encryption algorithm: NULL
+  *p++ = keyDataSize>>8; *p++ = (u_int8_t)keyDataSize;
+  *p++ = PAYLOAD_LAST;
+  *p++ = KEY_DATA_TYPE_TEK_SALT<<4; // KV: NULL (i.e., the key is valid for all SSRCs and all packet indices)
+  *p++ = 0; *p++ = MIKEY_SRTP_MASTER_KEY_SIZE;
+  memcpy(p, fMasterKey, MIKEY_SRTP_MASTER_KEY_SIZE); p += MIKEY_SRTP_MASTER_KEY_SIZE;
+  *p++ = 0; *p++ = saltSize;
+  memcpy(p, fMasterSalt, saltSize); p += saltSize;
+  *p++ = 0; // MAC algorithm: NULL
+
+  return message;
+}
+
+char* MIKEYState::keyMgmtSDPLine() const {
+  unsigned messageSize;
+  u_int8_t* message = generateMessage(messageSize);
+  char* base64Message = base64Encode((char const*)message, messageSize);
+  delete[] message;
+
+  char const* const keyMgmtFmt = "a=key-mgmt:mikey %s\r\n";
+  char* result = new char[strlen(keyMgmtFmt) + strlen(base64Message)];
+  sprintf(result, keyMgmtFmt, base64Message);
+  delete[] base64Message;
+  return result;
+}
+
+Boolean MIKEYState::parseMessage(u_int8_t const* message, unsigned messageSize) {
+  // The common header:
+  if (message == NULL || messageSize < 10) return False;
+  if (message[0] != 1 || message[1] != 0) return False; // we handle only version 1 'pre-shared key' messages
+  u_int8_t nextPayload = message[2];
+  fCSBId = get4Bytes(&message[4]);
+  unsigned numCS = message[8];
+  if (message[9] != 0) return False; // we handle only the SRTP-ID map type
+  unsigned hdrSize = 10 + 9*numCS;
+  if (hdrSize > messageSize) return False;
+  if (numCS > 0) {
+    // Note the SSRC and rollover counter of the first 'crypto session' (policy number, SSRC, ROC):
+    fSSRC = get4Bytes(&message[11]);
+    fROC = get4Bytes(&message[15]);
+  }
+  u_int8_t const* p = &message[hdrSize];
+  u_int8_t const* const end = &message[messageSize];
+
+  u_int8_t const* keyData = NULL; // parsed last, because the salt size depends on the security policy
+  unsigned keyDataSize = 0;
+  while (nextPayload != PAYLOAD_LAST) {
+    if (p + 2 > end) return False;
+    u_int8_t payloadType = nextPayload;
+    nextPayload = p[0];
+    unsigned payloadSize;
+    switch (payloadType) {
+      case PAYLOAD_T: {
+	payloadSize = p[1] == 2/*COUNTER*/ ? 2 + 4 : 2 + 8;
+	break;
+      }
+      case PAYLOAD_RAND: {
+	payloadSize = 2 + p[1];
+	if (p + payloadSize <= end && p[1] <= sizeof fRand) memcpy(fRand, &p[2], p[1]);
+	break;
+      }
+      case PAYLOAD_SP: {
+	if (p + 5 > end) return False;
+	unsigned paramsSize = (p[3]<<8)|p[4];
+	payloadSize = 5 + paramsSize;
+	if (p + payloadSize > end) return False;
+	if (p[2] != 0) break; // not a SRTP policy; ignore it
+	if (!parseSecurityPolicy(&p[5], paramsSize)) return False;
+	break;
+      }
+      case PAYLOAD_KEMAC: {
+	if (p + 4 > end) return False;
+	if (p[1] != 0) return False; // we handle only unencrypted key data
+	unsigned encrDataSize = (p[2]<<8)|p[3];
+	if (p + 4 + encrDataSize + 1 > end) return False;
+	u_int8_t macAlgorithm = p[4 + encrDataSize];
+	if (macAlgorithm != 0) return False; // we have no pre-shared key with which to check a MAC
+	payloadSize = 4 + encrDataSize + 1;
+	keyData = &p[4];
+	keyDataSize = encrDataSize;
+	break;
+      }
+      default: {
+	return False; // a payload type that we don't handle
+      }
+    }
+    if (p + payloadSize > end) return False;
+    p += payloadSize;
+  }
+
+  // (If there was no security policy payload, the default - AES_CM_128_HMAC_SHA1_80 - policy is used.)
+  return keyData != NULL && parseKeyData(keyData, keyDataSize);
+}
+
+Boolean MIKEYState::parseSecurityPolicy(u_int8_t const* params, unsigned paramsSize) {
+  // Start with the default values (RFC 3830, section 6.10.1):
+  unsigned encryptionAlgorithm = ENCRYPTION_ALGORITHM_AES_CM, authenticationAlgorithm = AUTHENTICATION_ALGORITHM_HMAC_SHA1;
+  unsigned encryptionKeyLength = 16, saltKeyLength = 14, tagLength = 10, aeadTagLength = 16;
+  Boolean authenticate = True;
+  fEncryptSRTP = fEncryptSRTCP = True;
+
+  for (unsigned i = 0; i + 2 <= paramsSize; ) {
+    u_int8_t type = params[i], length = params[i+1];
+    if (i + 2 + length > paramsSize) return False;
+    unsigned value = length == 1 ? params[i+2] : 0xFFFFFFFF;
+    switch (type) {
+      case SP_ENCRYPTION_ALGORITHM: encryptionAlgorithm = value; break;
+      case SP_SESSION_ENCRYPTION_KEY_LENGTH: encryptionKeyLength = value; break;
+      case SP_AUTHENTICATION_ALGORITHM: authenticationAlgorithm = value; break;
+      case SP_SESSION_SALT_KEY_LENGTH: saltKeyLength = value; break;
+      case SP_SRTP_PRF: if (value != 0) return False; break;
+      case SP_SRTP_ENCRYPTION: fEncryptSRTP = value != 0; break;
+      case SP_SRTCP_ENCRYPTION: fEncryptSRTCP = value != 0; break;
+      case SP_SRTP_AUTHENTICATION: authenticate = value != 0; break;
+      case SP_AUTHENTICATION_TAG_LENGTH: tagLength = value; break;
+      case SP_AEAD_AUTHENTICATION_TAG_LENGTH: aeadTagLength = value; break;
+      default: break; // e.g., the key derivation rate (which must be 0), FEC order, or prefix length; ignore
+    }
+    i += 2 + length;
+  }
+
+  if (encryptionKeyLength != 16) return False;
+  if (encryptionAlgorithm == ENCRYPTION_ALGORITHM_AES_GCM) {
+    if (saltKeyLength != 12 || aeadTagLength != 16) return False;
+    fProfile = AEAD_AES_128_GCM;
+  } else if (encryptionAlgorithm == ENCRYPTION_ALGORITHM_AES_CM) {
+    if (saltKeyLength != 14 || !authenticate || authenticationAlgorithm != AUTHENTICATION_ALGORITHM_HMAC_SHA1
+	|| tagLength != 10) return False;
+    fProfile = AES_CM_128_HMAC_SHA1_80;
+  } else {
+    return False;
+  }
+  return True;
+}
+
+Boolean MIKEYState::parseKeyData(u_int8_t const* data, unsigned dataSize) {
+  // We expect a single 'key data' sub-payload, containing a TEK (and, optionally, a salt):
+  if (dataSize < 4) return False;
+  u_int8_t keyType = data[1]>>4;
+  if (keyType != KEY_DATA_TYPE_TEK && keyType != KEY_DATA_TYPE_TEK_SALT) return False;
+  unsigned keySize = (data[2]<<8)|data[3];
+  if (keySize != MIKEY_SRTP_MASTER_KEY_SIZE || 4 + keySize > dataSize) return False;
+  memcpy(fMasterKey, &data[4], keySize);
+
+  if (keyType == KEY_DATA_TYPE_TEK_SALT) {
+    unsigned i = 4 + keySize;
+    if (i + 2 > dataSize) return False;
+    unsigned saltSize = (data[i]<<8)|data[i+1];
+    if (saltSize != masterSaltSize() || i + 2 + saltSize > dataSize) return False;
+    memcpy(fMasterSalt, &data[i+2], saltSize);
+  } // otherwise, the master salt is zero
+
+  return True;
+}
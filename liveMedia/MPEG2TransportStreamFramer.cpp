@@ -75,13 +75,14 @@ MPEG2TransportStreamFramer
   : FramedFilter(env, inputSource),
     fTSPacketCount(0), fTSPacketDurationEstimate(0.0), fTSPCRCount(0),
     fLimitNumTSPacketsToStream(False), fNumTSPacketsToStream(0),
-    fLimitTSPacketsToStreamByPCR(False), fPCRLimit(0.0) {
+    fLimitTSPacketsToStreamByPCR(False), fPCRLimit(0.0), fPIDFilter(NULL) {
   fPIDStatusTable = HashTable::create(ONE_WORD_HASH_KEYS);
 }
 
 MPEG2TransportStreamFramer::~MPEG2TransportStreamFramer() {
   clearPIDStatusTable();
   delete fPIDStatusTable;
+  delete[] fPIDFilter;
 }
 
 void MPEG2TransportStreamFramer::clearPIDStatusTable() {
@@ -101,6 +102,27 @@ void MPEG2TransportStreamFramer::setPCRLimit(float pcrLimit) {
   fLimitTSPacketsToStreamByPCR = pcrLimit != 0.0;
 }
 
+#define NUM_PIDS 0x2000
+
+void MPEG2TransportStreamFramer::addPIDToFilter(u_int16_t pid) {
+  pid &= NUM_PIDS-1;
+  if (fPIDFilter == NULL) {
+    fPIDFilter = new u_int8_t[NUM_PIDS/8];
+    memset(fPIDFilter, 0, NUM_PIDS/8);
+  }
+  fPIDFilter[pid>>3] |= 1<<(pid&7);
+}
+
+void MPEG2TransportStreamFramer::removePIDFromFilter(u_int16_t pid) {
+  if (fPIDFilter == NULL) return;
+  pid &= NUM_PIDS-1;
+  fPIDFilter[pid>>3] &=~ (1<<(pid&7));
+}
+
+void MPEG2TransportStreamFramer::clearPIDFilter() {
+  delete[] fPIDFilter; fPIDFilter = NULL;
+}
+
 void MPEG2TransportStreamFramer::doGetNextFrame() {
   if (fLimitNumTSPacketsToStream) {
     if (fNumTSPacketsToStream == 0) {
@@ -177,21 +199,68 @@ void MPEG2TransportStreamFramer::afterGettingFrame1(unsigned frameSize,
   struct timeval tvNow;
   gettimeofday(&tvNow, NULL);
   double timeNow = tvNow.tv_sec + tvNow.tv_usec/1000000.0;
-  for (unsigned i = 0; i < numTSPackets; ++i) {
-    if (!updateTSPacketDurationEstimate(&fTo[i*TRANSPORT_PACKET_SIZE], timeNow)) {
+  unsigned char* pkt = fTo;
+  for (unsigned i = 0; i < numTSPackets; ++i, pkt += TRANSPORT_PACKET_SIZE) {
+    // Most packets don't contain a PCR.  Check for this (and for a valid sync byte) quickly,
+    // without a function call:
+    if (pkt[0] == TRANSPORT_SYNC_BYTE
+	&& ((pkt[3]&0x20) == 0/*no adaptation_field*/ || pkt[4] == 0 || (pkt[5]&0x10) == 0/*no PCR*/)) {
+      ++fTSPacketCount;
+      continue;
+    }
+
+    if (!updateTSPacketDurationEstimate(pkt, timeNow)) {
       // We hit a preset limit (based on PCR) within the stream.  Handle this as if the input source has closed:
       handleClosure();
       return;
     }
   }
 
+  // Note that the duration is based on all of the TS packets that we read, even if some of them
+  // are about to be filtered out (because they reflect the time taken by the input stream):
   fDurationInMicroseconds
     = numTSPackets * (unsigned)(fTSPacketDurationEstimate*1000000);
 
+  if (fPIDFilter != NULL) {
+    fFrameSize = filterTSPackets(numTSPackets)*TRANSPORT_PACKET_SIZE;
+    if (fFrameSize == 0) {
+      // None of the TS packets passed our filter, so read some more:
+      doGetNextFrame();
+      return;
+    }
+  }
+
   // Complete the delivery to our client:
   afterGetting(this);
 }
 
+unsigned MPEG2TransportStreamFramer::filterTSPackets(unsigned numTSPackets) {
+  // Move each run of TS packets that pass our PID filter down to the end of the previous run
+  // (so that each run is moved - at most - once):
+  unsigned numTSPacketsKept = 0;
+  unsigned i = 0;
+  while (i < numTSPackets) {
+    unsigned runStart = i;
+    while (i < numTSPackets) {
+      unsigned char* pkt = &fTo[i*TRANSPORT_PACKET_SIZE];
+      unsigned pid = ((pkt[1]&0x1F)<<8) | pkt[2];
+      if ((fPIDFilter[pid>>3]&(1<<(pid&7))) == 0) break;
+      ++i;
+    }
+
+    unsigned runLength = i - runStart;
+    if (runLength > 0 && runStart != numTSPacketsKept) {
+      memmove(&fTo[numTSPacketsKept*TRANSPORT_PACKET_SIZE], &fTo[runStart*TRANSPORT_PACKET_SIZE],
+	      runLength*TRANSPORT_PACKET_SIZE);
+    }
+    numTSPacketsKept += runLength;
+
+    ++i; // skip over the packet that didn't pass our filter
+  }
+
+  return numTSPacketsKept;
+}
+
 Boolean MPEG2TransportStreamFramer::updateTSPacketDurationEstimate(unsigned char* pkt, double timeNow) {
   // Sanity check: Make sure we start with the sync byte:
   if (pkt[0] != TRANSPORT_SYNC_BYTE) {
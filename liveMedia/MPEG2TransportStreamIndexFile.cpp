@@ -24,11 +24,25 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MPEG2TransportStreamIndexFile.hh"
 #include "InputFile.hh"
 
+class TSPacketBlock {
+public:
+  TSPacketBlock(): blockNum(0), blockSize(0), lastUse(0) {}
+
+  unsigned long blockNum;
+  unsigned blockSize; // 0 means 'unused'
+  unsigned lastUse; // used to choose the least-recently-used block, when replacing
+  unsigned char data[TS_PACKETS_PER_CACHED_BLOCK*TRANSPORT_PACKET_SIZE];
+};
+
 MPEG2TransportStreamIndexFile
 ::MPEG2TransportStreamIndexFile(UsageEnvironment& env, char const* indexFileName)
   : Medium(env),
     fFileName(strDup(indexFileName)), fFid(NULL), fMPEGVersion(0), fCurrentIndexRecordNum(0),
-    fCachedPCR(0.0f), fCachedTSPacketNumber(0), fNumIndexRecords(0) {
+    fCachedPCR(0.0f), fCachedTSPacketNumber(0), fNumIndexRecords(0),
+    fFirstCachedRecordNum(0), fNumCachedRecords(0),
+    fTSPacketBlocks(NULL), fTSPacketBlockUseCount(0) {
+  fRecordCache = new unsigned char[INDEX_RECORD_CACHE_SIZE*INDEX_RECORD_SIZE];
+
   // Get the file size, to determine how many index records it contains:
   u_int64_t indexFileSize = GetFileSize(indexFileName, NULL);
   if (indexFileSize % INDEX_RECORD_SIZE != 0) {
@@ -58,6 +72,8 @@ MPEG2TransportStreamIndexFile* MPEG2TransportStreamIndexFile
 MPEG2TransportStreamIndexFile::~MPEG2TransportStreamIndexFile() {
   closeFid();
   delete[] fFileName;
+  delete[] fRecordCache;
+  delete[] fTSPacketBlocks;
 }
 
 void MPEG2TransportStreamIndexFile
@@ -215,6 +231,55 @@ float MPEG2TransportStreamIndexFile::getPlayingDuration() {
   return pcrFromBuf();
 }
 
+unsigned char const* MPEG2TransportStreamIndexFile
+::lookupTSPacketBlock(unsigned long blockNum, unsigned& blockSize) {
+  if (fTSPacketBlocks == NULL) return NULL;
+
+  for (unsigned i = 0; i < TS_PACKET_CACHE_NUM_BLOCKS; ++i) {
+    TSPacketBlock& block = fTSPacketBlocks[i];
+    if (block.blockSize > 0 && block.blockNum == blockNum) {
+      block.lastUse = ++fTSPacketBlockUseCount;
+      blockSize = block.blockSize;
+      return block.data;
+    }
+  }
+
+  return NULL;
+}
+
+void MPEG2TransportStreamIndexFile
+::cacheTSPacketBlock(unsigned long blockNum, unsigned char const* data, unsigned blockSize) {
+  if (blockSize < TS_PACKETS_PER_CACHED_BLOCK*TRANSPORT_PACKET_SIZE) {
+    // This is a partial block, at the (current) end of the file.  Don't cache it, because the file
+    // might still be growing (e.g., if it's being recorded); instead, it will be re-read each time.
+    // Also forget any old copy of this block, so that we never return data that's inconsistent:
+    if (fTSPacketBlocks != NULL) {
+      for (unsigned i = 0; i < TS_PACKET_CACHE_NUM_BLOCKS; ++i) {
+	if (fTSPacketBlocks[i].blockNum == blockNum) fTSPacketBlocks[i].blockSize = 0;
+      }
+    }
+    return;
+  }
+  blockSize = TS_PACKETS_PER_CACHED_BLOCK*TRANSPORT_PACKET_SIZE;
+  if (fTSPacketBlocks == NULL) fTSPacketBlocks = new TSPacketBlock[TS_PACKET_CACHE_NUM_BLOCKS];
+
+  // Replace the existing copy of this block (if any), or else the least-recently-used block:
+  TSPacketBlock* victim = &fTSPacketBlocks[0];
+  for (unsigned i = 0; i < TS_PACKET_CACHE_NUM_BLOCKS; ++i) {
+    TSPacketBlock& block = fTSPacketBlocks[i];
+    if (block.blockSize > 0 && block.blockNum == blockNum) {
+      victim = &block;
+      break;
+    }
+    if (block.lastUse < victim->lastUse) victim = &block;
+  }
+
+  victim->blockNum = blockNum;
+  victim->blockSize = blockSize;
+  victim->lastUse = ++fTSPacketBlockUseCount;
+  memmove(victim->data, data, blockSize);
+}
+
 int MPEG2TransportStreamIndexFile::mpegVersion() {
   if (fMPEGVersion != 0) return fMPEGVersion; // we already know it
 
@@ -247,10 +312,22 @@ Boolean MPEG2TransportStreamIndexFile::seekToIndexRecord(unsigned long indexReco
 
 Boolean MPEG2TransportStreamIndexFile::readIndexRecord(unsigned long indexRecordNum) {
   do {
-    if (!seekToIndexRecord(indexRecordNum)) break;
-    if (fread(fBuf, INDEX_RECORD_SIZE, 1, fFid) != 1) break;
-    ++fCurrentIndexRecordNum;
+    if (indexRecordNum < fFirstCachedRecordNum
+	|| indexRecordNum >= fFirstCachedRecordNum + fNumCachedRecords) {
+      // The record isn't in our cache, so read (from the file) the (aligned) block of records
+      // that contains it.  This lets sequential (forward or reverse) 'trick play' scanning - perhaps
+      // by several clients at once - read the file in large chunks, rather than one record at a time:
+      fFirstCachedRecordNum = indexRecordNum - indexRecordNum%INDEX_RECORD_CACHE_SIZE;
+      fNumCachedRecords = 0;
+      if (!seekToIndexRecord(fFirstCachedRecordNum)) break;
+      fNumCachedRecords
+	= fread(fRecordCache, INDEX_RECORD_SIZE, INDEX_RECORD_CACHE_SIZE, fFid);
+      fCurrentIndexRecordNum += fNumCachedRecords;
+      if (indexRecordNum >= fFirstCachedRecordNum + fNumCachedRecords) break;
+    }
 
+    memmove(fBuf, &fRecordCache[(indexRecordNum - fFirstCachedRecordNum)*INDEX_RECORD_SIZE],
+	    INDEX_RECORD_SIZE);
     return True;
   } while (0);
 
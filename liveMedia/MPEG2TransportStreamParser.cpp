@@ -128,6 +128,16 @@ Boolean MPEG2TransportStreamParser::parse() {
 	      pusi, PID);
 #endif
 
+      if (fPIDState[PID] == NULL) {
+	// We're not interested in this PID (usually the case for most packets of a multi-program
+	// Transport Stream), so skip the rest of the packet - without parsing its adaptation field:
+#ifdef DEBUG_CONTENTS
+	fprintf(stderr, "\tUnknown PID\n");
+#endif
+	skipBytes(TRANSPORT_PACKET_SIZE-3);
+	continue;
+      }
+
       u_int8_t controlPlusContinuity_counter = get1Byte();
       // Reject any packets where the "transport_scrambling_control" field is not zero:
       if ((controlPlusContinuity_counter&0xC0) != 0) {
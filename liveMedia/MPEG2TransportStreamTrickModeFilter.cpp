@@ -45,7 +45,9 @@ MPEG2TransportStreamTrickModeFilter
     fHaveStarted(False), fIndexFile(indexFile), fScale(scale), fDirection(1),
     fState(SKIPPING_FRAME), fFrameCount(0),
     fNextIndexRecordNum(0), fNextTSPacketNum(0),
-    fCurrentTSPacketNum((unsigned long)(-1)), fUseSavedFrameNextTime(False) {
+    fCurrentBlockNum((unsigned long)(-1)), fCurrentBlockSize(0),
+    fIsReadingBlock(False), fReadingBlockNum(0), fNumBlockBytesRead(0), fNumDeliveries(0),
+    fUseSavedFrameNextTime(False) {
   if (fScale < 0) { // reverse play
     fScale = -fScale;
     fDirection = -1;
@@ -191,27 +193,60 @@ void MPEG2TransportStreamTrickModeFilter::doGetNextFrame() {
 }
 
 void MPEG2TransportStreamTrickModeFilter::doStopGettingFrames() {
+  envir().taskScheduler().unscheduleDelayedTask(nextTask());
+  fIsReadingBlock = False;
   FramedFilter::doStopGettingFrames();
   fIndexFile->stopReading();
 }
 
-void MPEG2TransportStreamTrickModeFilter::attemptDeliveryToClient() {
-  if (fCurrentTSPacketNum == fDesiredTSPacketNum) {
-    //    fprintf(stderr, "\t\tdelivering ts %d:%d, %d bytes, PCR %f\n", fCurrentTSPacketNum, fDesiredDataOffset, fDesiredDataSize, fDesiredDataPCR);//#####
-    // We already have the Transport Packet that we want.  Deliver its data:
-    memmove(fTo, &fInputBuffer[fDesiredDataOffset], fDesiredDataSize);
-    fFrameSize = fDesiredDataSize;
-    float deliveryPCR = fDirection*(fDesiredDataPCR - fFirstPCR)/fScale;
-    if (deliveryPCR < 0.0) deliveryPCR = 0.0;
-    fPresentationTime.tv_sec = (unsigned long)deliveryPCR;
-    fPresentationTime.tv_usec
-      = (unsigned long)((deliveryPCR - fPresentationTime.tv_sec)*1000000.0f);
-    //    fprintf(stderr, "#####DGNF9\n");
+void MPEG2TransportStreamTrickModeFilter::attemptDeliveryToClient(Boolean blockWasJustRead) {
+  unsigned long desiredBlockNum = fDesiredTSPacketNum/TS_PACKETS_PER_CACHED_BLOCK;
+  if (desiredBlockNum != fCurrentBlockNum) {
+    // We don't already have the block of Transport Packets that we want.  See whether we (or
+    // another client of the same file) have read it recently:
+    unsigned blockSize;
+    unsigned char const* cachedBlock = fIndexFile->lookupTSPacketBlock(desiredBlockNum, blockSize);
+    if (cachedBlock == NULL) {
+      // Arrange to read the block that we want:
+      readTransportPacketBlock(desiredBlockNum);
+      return;
+    }
 
-    afterGetting(this);
+    memmove(fInputBuffer, cachedBlock, blockSize);
+    fCurrentBlockNum = desiredBlockNum;
+    fCurrentBlockSize = blockSize;
+  }
+
+  unsigned packetOffset = (fDesiredTSPacketNum%TS_PACKETS_PER_CACHED_BLOCK)*TRANSPORT_PACKET_SIZE;
+  if (packetOffset + TRANSPORT_PACKET_SIZE > fCurrentBlockSize) {
+    if (!blockWasJustRead) {
+      // We read this (partial) block earlier, but the file might have grown since then, so re-read it:
+      readTransportPacketBlock(desiredBlockNum);
+      return;
+    }
+
+    // The block ended (at the end of the file) before the Transport Packet that we want:
+    onSourceClosure1();
+    return;
+  }
+
+  //    fprintf(stderr, "\t\tdelivering ts %d:%d, %d bytes, PCR %f\n", fDesiredTSPacketNum, fDesiredDataOffset, fDesiredDataSize, fDesiredDataPCR);//#####
+  // We have the Transport Packet that we want.  Deliver its data:
+  memmove(fTo, &fInputBuffer[packetOffset + fDesiredDataOffset], fDesiredDataSize);
+  fFrameSize = fDesiredDataSize;
+  float deliveryPCR = fDirection*(fDesiredDataPCR - fFirstPCR)/fScale;
+  if (deliveryPCR < 0.0) deliveryPCR = 0.0;
+  fPresentationTime.tv_sec = (unsigned long)deliveryPCR;
+  fPresentationTime.tv_usec
+    = (unsigned long)((deliveryPCR - fPresentationTime.tv_sec)*1000000.0f);
+  //    fprintf(stderr, "#####DGNF9\n");
+
+  // Because most deliveries are now made from already-read data (rather than after a file read),
+  // occasionally return to the event loop to complete the delivery, to avoid excessive recursion:
+  if ((++fNumDeliveries%10) == 0) {
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)FramedSource::afterGetting, this);
   } else {
-    // Arrange to read the Transport Packet that we want:
-    readTransportPacket(fDesiredTSPacketNum);
+    afterGetting(this);
   }
 }
 
@@ -225,13 +260,45 @@ void MPEG2TransportStreamTrickModeFilter::seekToTransportPacket(unsigned long ts
   fNextTSPacketNum = tsPacketNum;
 }
 
-void MPEG2TransportStreamTrickModeFilter::readTransportPacket(unsigned long tsPacketNum) {
-  seekToTransportPacket(tsPacketNum);
-  fInputSource->getNextFrame(fInputBuffer, TRANSPORT_PACKET_SIZE,
+void MPEG2TransportStreamTrickModeFilter::readTransportPacketBlock(unsigned long blockNum) {
+  // Read an entire (aligned) block of Transport Packets - rather than just the packet that we
+  // want - because the rest of the frame's data (usually) follows it in the file:
+  seekToTransportPacket(blockNum*TS_PACKETS_PER_CACHED_BLOCK);
+  fCurrentBlockNum = (unsigned long)(-1); // because the buffer is about to be overwritten
+  fIsReadingBlock = True;
+  fReadingBlockNum = blockNum;
+  fNumBlockBytesRead = 0;
+  readMoreOfTransportPacketBlock();
+}
+
+void MPEG2TransportStreamTrickModeFilter::readMoreOfTransportPacketBlock() {
+  fInputSource->getNextFrame(&fInputBuffer[fNumBlockBytesRead],
+			     sizeof fInputBuffer - fNumBlockBytesRead,
 			     afterGettingFrame, this,
 			     onSourceClosure, this);
 }
 
+void MPEG2TransportStreamTrickModeFilter::finishReadingTransportPacketBlock() {
+  fIsReadingBlock = False;
+
+  unsigned numPacketsRead = fNumBlockBytesRead/TRANSPORT_PACKET_SIZE;
+  if (numPacketsRead == 0) {
+    // Treat this as if the input source ended:
+    onSourceClosure1();
+    return;
+  }
+
+  fCurrentBlockNum = fReadingBlockNum;
+  fCurrentBlockSize = numPacketsRead*TRANSPORT_PACKET_SIZE;
+  fNextTSPacketNum = fNumBlockBytesRead == fCurrentBlockSize
+    ? fReadingBlockNum*TS_PACKETS_PER_CACHED_BLOCK + numPacketsRead
+    : (unsigned long)(-1); // we read a partial packet, so we'll need to seek next time
+  fIndexFile->cacheTSPacketBlock(fCurrentBlockNum, fInputBuffer, fCurrentBlockSize);
+
+  // Attempt delivery again:
+  attemptDeliveryToClient(True);
+}
+
 void MPEG2TransportStreamTrickModeFilter
 ::afterGettingFrame(void* clientData, unsigned frameSize,
 		    unsigned /*numTruncatedBytes*/,
@@ -242,17 +309,15 @@ void MPEG2TransportStreamTrickModeFilter
 }
 
 void MPEG2TransportStreamTrickModeFilter::afterGettingFrame1(unsigned frameSize) {
-  if (frameSize != TRANSPORT_PACKET_SIZE) {
-    // Treat this as if the input source ended:
-    onSourceClosure1();
-    return;
-  }
+  fNumBlockBytesRead += frameSize;
 
-  fCurrentTSPacketNum = fNextTSPacketNum; // i.e., the one that we just read
-  ++fNextTSPacketNum;
-
-  // Attempt deliver again:
-  attemptDeliveryToClient();
+  if (frameSize > 0 && fNumBlockBytesRead < sizeof fInputBuffer) {
+    // The input source delivered less than a whole block (it's usually limited to its
+    // 'preferred frame size'), so keep reading:
+    readMoreOfTransportPacketBlock();
+  } else {
+    finishReadingTransportPacketBlock();
+  }
 }
 
 void MPEG2TransportStreamTrickModeFilter::onSourceClosure(void* clientData) {
@@ -261,6 +326,13 @@ void MPEG2TransportStreamTrickModeFilter::onSourceClosure(void* clientData) {
 }
 
 void MPEG2TransportStreamTrickModeFilter::onSourceClosure1() {
+  if (fIsReadingBlock) {
+    // The input source ended part-way through a block (i.e., at the end of the file).
+    // Use whatever we managed to read:
+    finishReadingTransportPacketBlock();
+    return;
+  }
+
   fIndexFile->stopReading();
   handleClosure();
 }
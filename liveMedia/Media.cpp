@@ -20,6 +20,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "Media.hh"
 #include "HashTable.hh"
+#include "PoolAllocator.hh"
 
 ////////// Medium //////////
 
@@ -99,14 +100,16 @@ _Tables* _Tables::getOurTables(UsageEnvironment& env, Boolean createIfNotPresent
 }
 
 void _Tables::reclaimIfPossible() {
-  if (mediaTable == NULL && socketTable == NULL) {
+  if (mediaTable == NULL && socketTable == NULL && tlsTable == NULL
+      && (poolAllocator == NULL || poolAllocator->numBlocksInUse() == 0)) {
     fEnv.liveMediaPriv = NULL;
+    delete poolAllocator;
     delete this;
   }
 }
 
 _Tables::_Tables(UsageEnvironment& env)
-  : mediaTable(NULL), socketTable(NULL), fEnv(env) {
+  : mediaTable(NULL), socketTable(NULL), tlsTable(NULL), poolAllocator(NULL), fEnv(env) {
 }
 
 _Tables::~_Tables() {
@@ -62,8 +62,9 @@ MediaSession::MediaSession(UsageEnvironment& env)
     fConnectionEndpointName(NULL),
     fMaxPlayStartTime(0.0f), fMaxPlayEndTime(0.0f), fAbsStartTime(NULL), fAbsEndTime(NULL),
     fScale(1.0f), fSpeed(1.0f),
-    fMediaSessionType(NULL), fSessionName(NULL), fSessionDescription(NULL), fControlPath(NULL) {
-  fSourceFilterAddr.s_addr = 0;
+    fMediaSessionType(NULL), fSessionName(NULL), fSessionDescription(NULL), fControlPath(NULL),
+    fMIKEYState(NULL) {
+  fSourceFilterAddr = nullAddress();
 
   // Get our host name, and use this for the RTCP CNAME:
   const unsigned maxCNAMElen = 100;
@@ -87,6 +88,7 @@ MediaSession::~MediaSession() {
   delete[] fSessionName;
   delete[] fSessionDescription;
   delete[] fControlPath;
+  delete fMIKEYState;
 }
 
 Boolean MediaSession::isMediaSession() const {
@@ -119,6 +121,7 @@ Boolean MediaSession::initializeWithSDP(char const* sdpDescription) {
     if (parseSDPAttribute_range(sdpLine)) continue;
     if (parseSDPAttribute_type(sdpLine)) continue;
     if (parseSDPAttribute_source_filter(sdpLine)) continue;
+    if (parseSDPAttribute_key_mgmt(sdpLine)) continue;
   }
 
   while (sdpLine != NULL) {
@@ -131,6 +134,7 @@ Boolean MediaSession::initializeWithSDP(char const* sdpDescription) {
 
     // Parse the line as "m=<medium_name> <client_portNum> RTP/AVP <fmt>"
     // or "m=<medium_name> <client_portNum>/<num_ports> RTP/AVP <fmt>"
+    // (or the same, with "RTP/SAVP" - i.e., SRTP - instead of "RTP/AVP")
     // (Should we be checking for >1 payload format number here?)#####
     char* mediumName = strDupSize(sdpLine); // ensures we have enough space
     char const* protocolName = NULL;
@@ -141,6 +145,13 @@ Boolean MediaSession::initializeWithSDP(char const* sdpDescription) {
 		mediumName, &subsession->fClientPortNum, &payloadFormat) == 3)
 	&& payloadFormat <= 127) {
       protocolName = "RTP";
+    } else if ((sscanf(sdpLine, "m=%s %hu RTP/SAVP %u",
+		       mediumName, &subsession->fClientPortNum, &payloadFormat) == 3 ||
+		sscanf(sdpLine, "m=%s %hu/%*u RTP/SAVP %u",
+		       mediumName, &subsession->fClientPortNum, &payloadFormat) == 3)
+	       && payloadFormat <= 127) {
+      protocolName = "RTP";
+      subsession->fUsesSRTP = True;
     } else if ((sscanf(sdpLine, "m=%s %hu UDP %u",
 		       mediumName, &subsession->fClientPortNum, &payloadFormat) == 3 ||
 		sscanf(sdpLine, "m=%s %hu udp %u",
@@ -213,6 +224,7 @@ Boolean MediaSession::initializeWithSDP(char const* sdpDescription) {
       if (subsession->parseSDPAttribute_source_filter(sdpLine)) continue;
       if (subsession->parseSDPAttribute_x_dimensions(sdpLine)) continue;
       if (subsession->parseSDPAttribute_framerate(sdpLine)) continue;
+      if (subsession->parseSDPAttribute_key_mgmt(sdpLine)) continue;
 
       // (Later, check for malformed lines, and other valid SDP lines#####)
     }
@@ -278,7 +290,7 @@ Boolean MediaSession::parseSDPLine(char const* inputLine,
 static char* parseCLine(char const* sdpLine) {
   char* resultStr = NULL;
   char* buffer = strDupSize(sdpLine); // ensures we have enough space
-  if (sscanf(sdpLine, "c=IN IP4 %[^/\r\n]", buffer) == 1) {
+  if (sscanf(sdpLine, "c=IN IP4 %[^/\r\n]", buffer) == 1 || sscanf(sdpLine, "c=IN IP6 %[^/\r\n]", buffer) == 1) {
     // Later, handle the optional /<ttl> and /<numAddresses> #####
     resultStr = strDup(buffer);
   }
@@ -318,6 +330,7 @@ Boolean MediaSession::parseSDPLine_i(char const* sdpLine) {
 Boolean MediaSession::parseSDPLine_c(char const* sdpLine) {
   // Check for "c=IN IP4 <connection-endpoint>"
   // or "c=IN IP4 <connection-endpoint>/<ttl+numAddresses>"
+  // (or the same with "IP6")
   // (Later, do something with <ttl+numAddresses> also #####)
   char* connectionEndpointName = parseCLine(sdpLine);
   if (connectionEndpointName != NULL) {
@@ -404,26 +417,32 @@ Boolean MediaSession::parseSDPAttribute_range(char const* sdpLine) {
 }
 
 static Boolean parseSourceFilterAttribute(char const* sdpLine,
-					  struct in_addr& sourceAddr) {
-  // Check for a "a=source-filter:incl IN IP4 <something> <source>" line.
+					  struct sockaddr_storage& sourceAddr) {
+  // Check for a "a=source-filter:incl IN IP4 <something> <source>" (or "IN IP6") line.
   // Note: At present, we don't check that <something> really matches
   // one of our multicast addresses.  We also don't support more than
   // one <source> #####
   Boolean result = False; // until we succeed
   char* sourceName = strDupSize(sdpLine); // ensures we have enough space
   do {
-    if (sscanf(sdpLine, "a=source-filter: incl IN IP4 %*s %s",
-	       sourceName) != 1) break;
+    int addressFamily;
+    if (sscanf(sdpLine, "a=source-filter: incl IN IP4 %*s %s", sourceName) == 1) {
+      addressFamily = AF_INET;
+    } else if (sscanf(sdpLine, "a=source-filter: incl IN IP6 %*s %s", sourceName) == 1) {
+      addressFamily = AF_INET6;
+    } else {
+      break;
+    }
 
     // Now, convert this name to an address, if we can:
-    NetAddressList addresses(sourceName);
+    NetAddressList addresses(sourceName, addressFamily);
     if (addresses.numAddresses() == 0) break;
 
-    netAddressBits sourceAddrBits
-      = *(netAddressBits*)(addresses.firstAddress()->data());
-    if (sourceAddrBits == 0) break;
+    struct sockaddr_storage addr;
+    copyAddress(addr, addresses.firstAddress());
+    if (addressIsNull(addr)) break;
 
-    sourceAddr.s_addr = sourceAddrBits;
+    sourceAddr = addr;
     result = True;
   } while (0);
 
@@ -436,6 +455,23 @@ Boolean MediaSession
   return parseSourceFilterAttribute(sdpLine, fSourceFilterAddr);
 }
 
+static Boolean parseKeyMgmtAttribute(char const* sdpLine, MIKEYState*& mikeyState) {
+  // Check for a "a=key-mgmt:mikey <base64-encoded MIKEY message>" line (RFC 4567):
+  if (strncmp(sdpLine, "a=key-mgmt:", 11) != 0) return False;
+
+  // (We recognize - and consume - the line even if its MIKEY message is one that we can't use.)
+  MIKEYState* newState = MIKEYState::createNewFromKeyMgmtAttribute(&sdpLine[11]);
+  if (newState != NULL) {
+    delete mikeyState;
+    mikeyState = newState;
+  }
+  return True;
+}
+
+Boolean MediaSession::parseSDPAttribute_key_mgmt(char const* sdpLine) {
+  return parseKeyMgmtAttribute(sdpLine, fMIKEYState);
+}
+
 char* MediaSession::lookupPayloadFormat(unsigned char rtpPayloadType,
 					unsigned& freq, unsigned& nCh) {
   // Look up the codec name and timestamp frequency for known (static)
@@ -597,15 +633,15 @@ MediaSubsession::MediaSubsession(MediaSession& parent)
   : serverPortNum(0), sink(NULL), miscPtr(NULL),
     fParent(parent), fNext(NULL),
     fConnectionEndpointName(NULL),
-    fClientPortNum(0), fRTPPayloadFormat(0xFF),
+    fClientPortNum(0), fRTPPayloadFormat(0xFF), fFECPayloadFormat(0),
     fSavedSDPLines(NULL), fMediumName(NULL), fCodecName(NULL), fProtocolName(NULL),
     fRTPTimestampFrequency(0), fMultiplexRTCPWithRTP(False), fControlPath(NULL),
     fSourceFilterAddr(parent.sourceFilterAddr()), fBandwidth(0),
     fPlayStartTime(0.0), fPlayEndTime(0.0), fAbsStartTime(NULL), fAbsEndTime(NULL),
     fVideoWidth(0), fVideoHeight(0), fVideoFPS(0), fNumChannels(1), fScale(1.0f), fNPT_PTS_Offset(0.0f),
-    fAttributeTable(HashTable::create(STRING_HASH_KEYS)),
+    fAttributeTable(HashTable::create(STRING_HASH_KEYS)), fUsesSRTP(False), fMIKEYState(NULL),
     fRTPSocket(NULL), fRTCPSocket(NULL),
-    fRTPSource(NULL), fRTCPInstance(NULL), fReadSource(NULL),
+    fRTPSource(NULL), fRTCPInstance(NULL), fReadSource(NULL), fSRTPContext(NULL),
     fReceiveRawMP3ADUs(False), fReceiveRawJPEGFrames(False),
     fSessionId(NULL) {
   rtpInfo.seqNum = 0; rtpInfo.timestamp = 0; rtpInfo.infoIsNew = False;
@@ -628,6 +664,7 @@ MediaSubsession::~MediaSubsession() {
   delete[] fControlPath;
   delete[] fAbsStartTime; delete[] fAbsEndTime;
   delete[] fSessionId;
+  delete fMIKEYState;
 
   // Empty and delete our 'attributes table':
   SDPAttribute* attr;
@@ -685,11 +722,12 @@ Boolean MediaSubsession::initiate(int useSpecialRTPoffset) {
 
     // Create RTP and RTCP 'Groupsocks' on which to receive incoming data.
     // (Groupsocks will work even for unicast addresses)
-    struct in_addr tempAddr;
-    tempAddr.s_addr = connectionEndpointAddress();
+    // (Their address family - IPv4 or IPv6 - is that of our connection endpoint address, if known.)
+    struct sockaddr_storage tempAddr;
+    getConnectionEndpointAddress(tempAddr);
         // This could get changed later, as a result of a RTSP "SETUP"
 
-    if (fClientPortNum != 0 && (honorSDPPortChoice || IsMulticastAddress(tempAddr.s_addr))) {
+    if (fClientPortNum != 0 && (honorSDPPortChoice || IsMulticastAddress(tempAddr))) {
       // The sockets' port numbers were specified for us.  Use these:
       Boolean const protocolIsRTP = strcmp(fProtocolName, "RTP") == 0;
       if (protocolIsRTP && !fMultiplexRTCPWithRTP) {
@@ -821,6 +859,26 @@ Boolean MediaSubsession::initiate(int useSpecialRTPoffset) {
       break;
     }
 
+    // If the server sends FEC packets, use them to recover lost packets:
+    if (fRTPSource != NULL && fFECPayloadFormat != 0) {
+      fRTPSource->enableFECRecovery(fFECPayloadFormat);
+    }
+
+    // If the stream uses SRTP, create the cryptographic context that our RTP source (and RTCP instance) will use:
+    if (fUsesSRTP && fRTPSource != NULL) {
+      MIKEYState const* mikeyState = fMIKEYState != NULL ? fMIKEYState : fParent.mikeyState();
+      if (mikeyState == NULL) {
+	env().setResultMsg("The stream uses SRTP, but its SDP description has no (usable) \"a=key-mgmt:\" line");
+	break;
+      }
+      fSRTPContext = SRTPCryptographicContext::createNew(*mikeyState);
+      if (fSRTPContext == NULL) {
+	env().setResultMsg("SRTP is not supported by this build");
+	break;
+      }
+      fRTPSource->setSRTPContext(fSRTPContext);
+    }
+
     // Finally, create our RTCP instance. (It starts running automatically)
     if (fRTPSource != NULL && fRTCPSocket != NULL) {
       // If bandwidth is specified, use it and add 5% for RTCP overhead.
@@ -837,6 +895,7 @@ Boolean MediaSubsession::initiate(int useSpecialRTPoffset) {
 	env().setResultMsg("Failed to create RTCP instance");
 	break;
       }
+      if (fSRTPContext != NULL) fRTCPInstance->setSRTPContext(fSRTPContext);
     }
 
     return True;
@@ -853,6 +912,8 @@ void MediaSubsession::deInitiate() {
   Medium::close(fReadSource); // this is assumed to also close fRTPSource
   fReadSource = NULL; fRTPSource = NULL;
 
+  delete fSRTPContext; fSRTPContext = NULL; // after the objects that used it
+
   delete fRTPSocket;
   if (fRTCPSocket != fRTPSocket) delete fRTCPSocket;
   fRTPSocket = NULL; fRTCPSocket = NULL;
@@ -896,7 +957,7 @@ char const* MediaSubsession::fmtp_config() const {
   return result;
 }
 
-netAddressBits MediaSubsession::connectionEndpointAddress() const {
+void MediaSubsession::getConnectionEndpointAddress(struct sockaddr_storage& addr) const {
   do {
     // Get the endpoint name from with us, or our parent session:
     char const* endpointString = connectionEndpointName();
@@ -909,19 +970,34 @@ netAddressBits MediaSubsession::connectionEndpointAddress() const {
     NetAddressList addresses(endpointString);
     if (addresses.numAddresses() == 0) break;
 
-    return *(netAddressBits*)(addresses.firstAddress()->data());
+    copyAddress(addr, addresses.firstAddress());
+    return;
   } while (0);
 
   // No address known:
-  return 0;
+  addr = nullAddress();
+}
+
+netAddressBits MediaSubsession::connectionEndpointAddress() const {
+  struct sockaddr_storage addr;
+  getConnectionEndpointAddress(addr);
+
+  return addr.ss_family == AF_INET ? ipv4Address(addr) : 0;
 }
 
 void MediaSubsession::setDestinations(netAddressBits defaultDestAddress) {
+  struct sockaddr_storage defaultDestAddr;
+  setIPv4Address(defaultDestAddr, defaultDestAddress);
+
+  setDestinations(defaultDestAddr);
+}
+
+void MediaSubsession::setDestinations(struct sockaddr_storage const& defaultDestAddress) {
   // Get the destination address from the connection endpoint name
-  // (This will be 0 if it's not known, in which case we use the default)
-  netAddressBits destAddress = connectionEndpointAddress();
-  if (destAddress == 0) destAddress = defaultDestAddress;
-  struct in_addr destAddr; destAddr.s_addr = destAddress;
+  // (This will be null if it's not known, in which case we use the default)
+  struct sockaddr_storage destAddr;
+  getConnectionEndpointAddress(destAddr);
+  if (addressIsNull(destAddr)) destAddr = defaultDestAddress;
 
   // The destination TTL remains unchanged:
   int destTTL = ~0; // means: don't change
@@ -996,6 +1072,7 @@ void MediaSubsession
 Boolean MediaSubsession::parseSDPLine_c(char const* sdpLine) {
   // Check for "c=IN IP4 <connection-endpoint>"
   // or "c=IN IP4 <connection-endpoint>/<ttl+numAddresses>"
+  // (or the same with "IP6")
   // (Later, do something with <ttl+numAddresses> also #####)
   char* connectionEndpointName = parseCLine(sdpLine);
   if (connectionEndpointName != NULL) {
@@ -1031,17 +1108,20 @@ Boolean MediaSubsession::parseSDPAttribute_rtpmap(char const* sdpLine) {
       || sscanf(sdpLine, "a=rtpmap: %u %s",
 		&rtpmapPayloadFormat, codecName) == 2) {
     parseSuccess = True;
+    // (First, make sure the codec name is upper case)
+    {
+      Locale l("POSIX");
+      for (char* p = codecName; *p != '\0'; ++p) *p = toupper(*p);
+    }
     if (rtpmapPayloadFormat == fRTPPayloadFormat) {
       // This "rtpmap" matches our payload format, so set our
       // codec name and timestamp frequency:
-      // (First, make sure the codec name is upper case)
-      {
-	Locale l("POSIX");
-	for (char* p = codecName; *p != '\0'; ++p) *p = toupper(*p);
-      }
       delete[] fCodecName; fCodecName = strDup(codecName);
       fRTPTimestampFrequency = rtpTimestampFrequency;
       fNumChannels = numChannels;
+    } else if (strcmp(codecName, "ULPFEC") == 0) {
+      // This "rtpmap" describes the RFC 5109 FEC packets that protect our stream:
+      fFECPayloadFormat = (unsigned char)rtpmapPayloadFormat;
     }
   }
   delete[] codecName;
@@ -1180,6 +1260,10 @@ Boolean MediaSubsession::parseSDPAttribute_framerate(char const* sdpLine) {
   return parseSuccess;
 }
 
+Boolean MediaSubsession::parseSDPAttribute_key_mgmt(char const* sdpLine) {
+  return parseKeyMgmtAttribute(sdpLine, fMIKEYState);
+}
+
 Boolean MediaSubsession::createSourceObjects(int useSpecialRTPoffset) {
   do {
     // First, check "fProtocolName"
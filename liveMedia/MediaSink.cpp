@@ -20,6 +20,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "MediaSink.hh"
 #include "GroupsockHelper.hh"
+#include "RTPInterface.hh" // for "SRTP_MAX_TRAILER_SIZE" and "RTP_TCP_FRAMING_HEADER_SIZE"
 #include <string.h>
 
 ////////// MediaSink //////////
@@ -119,14 +120,16 @@ OutPacketBuffer
   if (maxBufferSize == 0) maxBufferSize = maxSize;
   unsigned maxNumPackets = (maxBufferSize + (maxPacketSize-1))/maxPacketSize;
   fLimit = maxNumPackets*maxPacketSize;
-  fBuf = new unsigned char[fLimit];
+  fBuf = new unsigned char[RTP_TCP_FRAMING_HEADER_SIZE + fLimit + SRTP_MAX_TRAILER_SIZE] + RTP_TCP_FRAMING_HEADER_SIZE;
+      // Leave room after the last possible packet, so that a packet can be protected (by SRTP) in place when it's sent,
+      // and before the first, so that a packet can be sent over TCP with its framing header
   resetPacketStart();
   resetOffset();
   resetOverflowData();
 }
 
 OutPacketBuffer::~OutPacketBuffer() {
-  delete[] fBuf;
+  delete[] (fBuf - RTP_TCP_FRAMING_HEADER_SIZE);
 }
 
 void OutPacketBuffer::enqueue(unsigned char const* from, unsigned numBytes) {
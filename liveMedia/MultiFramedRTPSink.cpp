@@ -21,6 +21,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "MultiFramedRTPSink.hh"
 #include "GroupsockHelper.hh"
+#include "RTPRateController.hh"
+#include "ULPFEC.hh"
 
 ////////// MultiFramedRTPSink //////////
 
@@ -30,12 +32,29 @@ void MultiFramedRTPSink::setPacketSizes(unsigned preferredPacketSize,
   if (preferredPacketSize > maxPacketSize || preferredPacketSize == 0)
     return;
   // sanity check
+  fRequestedPreferredPacketSize = preferredPacketSize;
+  fRequestedMaxPacketSize = maxPacketSize;
+
+  // Leave room for whatever gets added to our packets after they're built (the FEC packets' extra headers, and the
+  // SRTP authentication tag), so that the packets that we actually send are no bigger than the requested size:
+  unsigned overheadSize = 0;
+  if (fFECEncoder != NULL)
+    overheadSize += ULPFECEncoder::maxOverheadSize;
+  if (fRTPInterface.srtpContext() != NULL)
+    overheadSize += fRTPInterface.srtpContext()->srtpTrailerSize();
+  if (maxPacketSize <= overheadSize)
+    return;
+  maxPacketSize -= overheadSize;
+  if (preferredPacketSize > maxPacketSize)
+    preferredPacketSize = maxPacketSize;
 
   delete fOutBuf;
   fOutBuf = new OutPacketBuffer(preferredPacketSize, maxPacketSize);
   fOurMaxPacketSize = maxPacketSize; // save value, in case subclasses need it
 }
 
+unsigned MultiFramedRTPSink::maxPacketsSentPerIteration = 32;
+
 #ifndef RTP_PAYLOAD_MAX_SIZE
 #define RTP_PAYLOAD_MAX_SIZE 1456
 // Default max packet size (1500, minus allowance for IP, UDP, UMTP headers)
@@ -53,8 +72,9 @@ MultiFramedRTPSink::MultiFramedRTPSink(UsageEnvironment &env,
                                        unsigned numChannels)
     : RTPSink(env, rtpGS, rtpPayloadType, rtpTimestampFrequency,
               rtpPayloadFormatName, numChannels),
-      fOutBuf(NULL), fCurFragmentationOffset(0), fPreviousFrameEndedFragmentation(False),
-      fOnSendErrorFunc(NULL), fOnSendErrorData(NULL)
+      fOutBuf(NULL), fCurFragmentationOffset(0), fPreviousFrameEndedFragmentation(False), fHeaderExtensionSize(0),
+      fSendLoopState(NULL), fOnSendErrorFunc(NULL), fOnSendErrorData(NULL),
+      fPacingPercentage(0), fPacingMaxBurstSize(0), fPacingUsesKernel(False)
 {
   setPacketSizes((RTP_PAYLOAD_PREFERRED_SIZE), (RTP_PAYLOAD_MAX_SIZE));
 }
@@ -189,6 +209,113 @@ void MultiFramedRTPSink::setFramePadding(unsigned numPaddingBytes)
   }
 }
 
+Boolean MultiFramedRTPSink::enableFEC(unsigned char fecPayloadType, unsigned numColumns, unsigned numRows, Boolean rowFEC)
+{
+  if (fSource != NULL)
+  {
+    envir().setResultMsg("MultiFramedRTPSink::enableFEC(): The sink is already playing");
+    return False;
+  }
+  if (!RTPSink::enableFEC(fecPayloadType, numColumns, numRows, rowFEC))
+    return False;
+
+  // Re-size our packets, now that we know that FEC packets will be sent:
+  setPacketSizes(fRequestedPreferredPacketSize, fRequestedMaxPacketSize);
+  return True;
+}
+
+Boolean MultiFramedRTPSink::setSRTPContext(SRTPCryptographicContext *srtpContext)
+{
+  if (fSource != NULL)
+  {
+    envir().setResultMsg("MultiFramedRTPSink::setSRTPContext(): The sink is already playing");
+    return False;
+  }
+  if (!RTPSink::setSRTPContext(srtpContext))
+    return False;
+
+  // Re-size our packets, to leave room for the SRTP authentication tag:
+  setPacketSizes(fRequestedPreferredPacketSize, fRequestedMaxPacketSize);
+  return True;
+}
+
+void MultiFramedRTPSink::setPacing(unsigned frameIntervalPercentage, unsigned maxBurstSize, Boolean useKernelPacing)
+{
+  if (frameIntervalPercentage > 100)
+    frameIntervalPercentage = 100;
+  fPacingPercentage = frameIntervalPercentage;
+  fPacingMaxBurstSize = maxBurstSize > 0 ? maxBurstSize : 4 * fOurMaxPacketSize;
+
+  fPacingUsesKernel = False;
+  if (useKernelPacing && fPacingPercentage > 0 && fRTPInterface.gs() != NULL)
+  {
+    fPacingUsesKernel = fRTPInterface.gs()->enableTxTime();
+  }
+
+  // We don't know the rate yet; it gets computed once we've seen a frame:
+  fPacingRate = 0.0;
+  fPacingTAT = 0;
+  fPacingPeakFrameSize = fPacingCurFrameSize = 0;
+  fPacingFrameInterval = 0;
+  fPacingCurFramePresentationTime.tv_sec = fPacingCurFramePresentationTime.tv_usec = 0;
+}
+
+void MultiFramedRTPSink::notePacingFrame(struct timeval presentationTime)
+{
+  if (presentationTime.tv_sec == fPacingCurFramePresentationTime.tv_sec && presentationTime.tv_usec == fPacingCurFramePresentationTime.tv_usec)
+    return; // this is a further piece (e.g., NAL unit) of the current frame
+
+  // A new frame is starting, so we now know the size of the previous one - and the interval between them:
+  int64_t interval = (int64_t)(presentationTime.tv_sec - fPacingCurFramePresentationTime.tv_sec) * 1000000 + (presentationTime.tv_usec - fPacingCurFramePresentationTime.tv_usec);
+  if (fPacingCurFramePresentationTime.tv_sec != 0 && interval > 0 && interval < 1000000)
+  {
+    fPacingFrameInterval = fPacingFrameInterval == 0 ? (unsigned)interval : (7 * fPacingFrameInterval + (unsigned)interval) / 8;
+
+    // The peak frame size decays slowly, so that the rate stays high enough for the next key frame:
+    fPacingPeakFrameSize -= fPacingPeakFrameSize / 256;
+    if (fPacingCurFrameSize > fPacingPeakFrameSize)
+      fPacingPeakFrameSize = fPacingCurFrameSize;
+
+    fPacingRate = (100.0 * fPacingPeakFrameSize) / (fPacingPercentage * (double)fPacingFrameInterval);
+  }
+  fPacingCurFramePresentationTime = presentationTime;
+  fPacingCurFrameSize = 0;
+}
+
+int64_t MultiFramedRTPSink::pacingDelay(int64_t timeNow)
+{
+  if (fPacingRate <= 0.0)
+    return 0;
+
+  // A packet may be sent if the bucket has any tokens left.  If it doesn't, we wait until it's full again,
+  // so that we then send a whole burst (rather than waking up for each packet):
+  int64_t burstTolerance = (int64_t)(fPacingMaxBurstSize / fPacingRate);
+  if (fPacingTAT - burstTolerance <= timeNow)
+    return 0;
+  return fPacingTAT - timeNow;
+}
+
+void MultiFramedRTPSink::notePacketToBePaced(unsigned packetSize, int64_t timeNow)
+{
+  fPacingCurFrameSize += packetSize;
+  if (fPacingRate <= 0.0)
+    return;
+
+  if (fPacingUsesKernel)
+  {
+    // Tell the kernel when to transmit this packet: when the bucket would next allow it.
+    // (But don't let packets fall more than 1 second behind; if the rate was too low, catch up.)
+    if (fPacingTAT - timeNow > 1000000)
+      fPacingTAT = timeNow;
+    int64_t txTime = fPacingTAT - (int64_t)(fPacingMaxBurstSize / fPacingRate);
+    fRTPInterface.gs()->setTxTime(txTime > timeNow ? monotonicTimeNSecs() + (u_int64_t)(txTime - timeNow) * 1000 : 0);
+  }
+
+  if (fPacingTAT < timeNow)
+    fPacingTAT = timeNow;
+  fPacingTAT += (int64_t)(packetSize / fPacingRate);
+}
+
 Boolean MultiFramedRTPSink::continuePlaying()
 {
   // Send the first packet.
@@ -216,6 +343,9 @@ void MultiFramedRTPSink::buildAndSendPacket(Boolean isFirstPacket)
   unsigned rtpHdr = 0x80000000; // RTP version 2; marker ('M') bit not set (by default; it can be set later)
   rtpHdr |= (fRTPPayloadType << 16);
   rtpHdr |= fSeqNo; // sequence number
+  fHeaderExtensionSize = headerExtensionSize();
+  if (fHeaderExtensionSize > 0)
+    rtpHdr |= 0x10000000; // extension ('X') bit
   fOutBuf->enqueueWord(rtpHdr);
 
   // Note where the RTP timestamp will go.
@@ -225,6 +355,13 @@ void MultiFramedRTPSink::buildAndSendPacket(Boolean isFirstPacket)
 
   fOutBuf->enqueueWord(SSRC());
 
+  if (fHeaderExtensionSize > 0)
+  {
+    // A RFC 8285 'one-byte' header extension, containing the transport-wide sequence number:
+    fOutBuf->enqueueWord(0xBEDE0001); // 'one-byte' header extensions; length 1 (32-bit word)
+    fOutBuf->enqueueWord((fTransportCCExtensionId << 28) | (1 << 24) | (fTransportCCSeqNo << 8)); // id; length-1; seq num
+  }
+
   // Allow for a special, payload-format-specific header following the
   // RTP header:
   fSpecialHeaderPosition = fOutBuf->curPacketSize();
@@ -297,6 +434,10 @@ void MultiFramedRTPSink ::afterGettingFrame1(unsigned frameSize, unsigned numTru
   {
     fInitialPresentationTime = presentationTime;
   }
+  if (fPacingPercentage > 0)
+  {
+    notePacingFrame(presentationTime);
+  }
   // 如果帧的数据超出了输出缓冲区的大小，它会输出警告信息
   if (numTruncatedBytes > 0)
   {
@@ -424,29 +565,55 @@ Boolean MultiFramedRTPSink::isTooBigForAPacket(unsigned numBytes) const
   // Check whether a 'numBytes'-byte frame - together with a RTP header and
   // (possible) special headers - would be too big for an output packet:
   // (Later allow for RTP extension header!) #####
-  numBytes += rtpHeaderSize + specialHeaderSize() + frameSpecificHeaderSize();
+  numBytes += rtpHeaderSize + fHeaderExtensionSize + specialHeaderSize() + frameSpecificHeaderSize();
   return fOutBuf->isTooBigForAPacket(numBytes);
 }
 
 void MultiFramedRTPSink::sendPacketIfNecessary()
 {
+  // If we were called (indirectly) from the send loop in "sendNext()", we'll tell it what to do next:
+  SendLoopState *sendLoopState = fSendLoopState;
+  fSendLoopState = NULL;
+
   if (fNumFramesUsedSoFar > 0)
   {
+    if (fPacingPercentage > 0)
+    {
+      struct timeval timeNow;
+      gettimeofday(&timeNow, NULL);
+      notePacketToBePaced(fOutBuf->curPacketSize(), (int64_t)timeNow.tv_sec * 1000000 + timeNow.tv_usec);
+    }
+
+    // If we're sending FEC, it must protect the packet as it is now (before "sendPacketInPlace()" might encrypt it in place):
+    if (fFECEncoder != NULL)
+      fFECEncoder->noteMediaPacket(fOutBuf->packet(), fOutBuf->curPacketSize());
+
     // Send the packet:
 #ifdef TEST_LOSS
     if ((our_random() % 10) != 0) // simulate 10% packet loss #####
 #endif
-      if (!fRTPInterface.sendPacket(fOutBuf->packet(), fOutBuf->curPacketSize()))
+      if (!fRTPInterface.sendPacketInPlace(fOutBuf->packet(), fOutBuf->curPacketSize()))
       {
         // if failure handler has been specified, call it
         if (fOnSendErrorFunc != NULL)
           (*fOnSendErrorFunc)(fOnSendErrorData);
       }
+    if (fRateController != NULL)
+    {
+      struct timeval timeNow;
+      gettimeofday(&timeNow, NULL);
+      fRateController->notePacketSent(fTransportCCSeqNo, fOutBuf->curPacketSize(),
+                                      (int64_t)timeNow.tv_sec * 1000000 + timeNow.tv_usec);
+    }
+    if (fFECEncoder != NULL)
+      sendFECPackets();
     ++fPacketCount;
     fTotalOctetCount += fOutBuf->curPacketSize();
-    fOctetCount += fOutBuf->curPacketSize() - rtpHeaderSize - fSpecialHeaderSize - fTotalFrameSpecificHeaderSizes;
+    fOctetCount += fOutBuf->curPacketSize() - rtpHeaderSize - fHeaderExtensionSize - fSpecialHeaderSize - fTotalFrameSpecificHeaderSizes;
 
     ++fSeqNo; // for next time
+    if (fHeaderExtensionSize > 0)
+      ++fTransportCCSeqNo;
   }
   // 如果输出缓冲区fOutBuf中有溢出数据（overflowData），并且溢出数据量超过了缓冲区总大小的一半，则进行一个效率优化操作：
   // 将输出缓冲区的packetStart指针重新设置到溢出数据的位置，这样在构建下一个数据包时就无需执行memmove()操作将溢出数据移动到正确的位置。
@@ -456,7 +623,7 @@ void MultiFramedRTPSink::sendPacketIfNecessary()
     // the overflow data (allowing for the RTP header and special headers),
     // so that we probably don't have to "memmove()" the overflow data
     // into place when building the next packet:
-    unsigned newPacketStart = fOutBuf->curPacketSize() - (rtpHeaderSize + fSpecialHeaderSize + frameSpecificHeaderSize());
+    unsigned newPacketStart = fOutBuf->curPacketSize() - (rtpHeaderSize + fHeaderExtensionSize + fSpecialHeaderSize + frameSpecificHeaderSize());
     fOutBuf->adjustPacketStart(newPacketStart);
   }
   else
@@ -470,7 +637,9 @@ void MultiFramedRTPSink::sendPacketIfNecessary()
   if (fNoFramesLeft)
   {
     // We're done:
-    onSourceClosure();
+    if (sendLoopState != NULL)
+      *sendLoopState = SEND_LOOP_DONE;
+    onSourceClosure(); // Note: This might delete us
   }
   else
   {
@@ -485,17 +654,75 @@ void MultiFramedRTPSink::sendPacketIfNecessary()
     { // sanity check: Make sure that the time-to-delay is non-negative:
       uSecondsToGo = 0;
     }
+    if (fPacingPercentage > 0 && !fPacingUsesKernel)
+    {
+      // Also, don't send the next packet until the pacing token bucket allows it:
+      int64_t pacingDelayNow = pacingDelay((int64_t)timeNow.tv_sec * 1000000 + timeNow.tv_usec);
+      if (pacingDelayNow > uSecondsToGo)
+        uSecondsToGo = pacingDelayNow;
+    }
     // 如果还有帧数据需要发送，则计算出下一帧数据的播放时间fNextSendTime，
     // 并根据播放时间进行延时，等待相应时间后再次调用sendNext()函数发送下一个数据包
-    // Delay this amount of time:
-    nextTask() = envir().taskScheduler().scheduleDelayedTask(uSecondsToGo, (TaskFunc *)sendNext, this);
+    if (uSecondsToGo == 0 && sendLoopState != NULL)
+    {
+      // The next packet is due now, so let the send loop build it:
+      *sendLoopState = SEND_LOOP_PACKET_DUE;
+    }
+    else
+    {
+      // Delay this amount of time:
+      if (sendLoopState != NULL)
+        *sendLoopState = SEND_LOOP_DONE;
+      nextTask() = envir().taskScheduler().scheduleDelayedTask(uSecondsToGo, (TaskFunc *)sendNext, this);
+    }
   }
 }
 
 // The following is called after each delay between packet sends:
+void MultiFramedRTPSink::sendFECPackets()
+{
+  unsigned fecPacketSize;
+  u_int8_t const *fecPacket;
+  while ((fecPacket = fFECEncoder->nextFECPacket(fecPacketSize)) != NULL)
+  {
+    if (fPacingPercentage > 0)
+    {
+      struct timeval timeNow;
+      gettimeofday(&timeNow, NULL);
+      notePacketToBePaced(fecPacketSize, (int64_t)timeNow.tv_sec * 1000000 + timeNow.tv_usec);
+    }
+    if (!fRTPInterface.sendPacketInPlace((unsigned char *)fecPacket, fecPacketSize))
+    {
+      if (fOnSendErrorFunc != NULL)
+        (*fOnSendErrorFunc)(fOnSendErrorData);
+    }
+  }
+}
+
 void MultiFramedRTPSink::sendNext(void *firstArg)
 {
   MultiFramedRTPSink *sink = (MultiFramedRTPSink *)firstArg;
+
+  // Build and send packets for as long as each next one is due immediately (up to our limit), rather than
+  // scheduling a (zero-delay) task for each:
+  unsigned numPacketsLeft = maxPacketsSentPerIteration;
+  while (numPacketsLeft-- > 1)
+  {
+    SendLoopState sendLoopState = SEND_LOOP_PACKET_PENDING;
+    sink->fSendLoopState = &sendLoopState;
+    sink->buildAndSendPacket(False);
+
+    if (sendLoopState == SEND_LOOP_PACKET_PENDING)
+    {
+      // The packet is still waiting for data from our source (which will call back later):
+      sink->fSendLoopState = NULL;
+      return;
+    }
+    if (sendLoopState == SEND_LOOP_DONE)
+      return; // the next packet has been scheduled - or there are no more ("sink" might then have been deleted)
+  }
+
+  // Build and send the last packet for this iteration normally (so that the next one gets scheduled):
   sink->buildAndSendPacket(False);
 }
 
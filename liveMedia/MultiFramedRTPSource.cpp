@@ -21,11 +21,14 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "MultiFramedRTPSource.hh"
 #include "RTCP.hh"
+#include "ULPFEC.hh"
 #include "GroupsockHelper.hh"
 #include <string.h>
 
 ////////// ReorderingPacketBuffer definition //////////
 
+#define MAX_NUM_FREE_PACKETS 16
+
 class ReorderingPacketBuffer {
 public:
   ReorderingPacketBuffer(BufferedPacketFactory* packetFactory);
@@ -37,10 +40,15 @@ public:
   BufferedPacket* getNextCompletedPacket(Boolean& packetLossPreceded);
   void releaseUsedPacket(BufferedPacket* packet);
   void freePacket(BufferedPacket* packet) {
-    if (packet != fSavedPacket) {
-      delete packet;
-    } else {
+    if (packet == fSavedPacket) {
       fSavedPacketFree = True;
+    } else if (fNumFreePackets < MAX_NUM_FREE_PACKETS) {
+      // Keep this packet, so that it can be reused (rather than deleted and reallocated) next time:
+      packet->nextPacket() = fFreePackets;
+      fFreePackets = packet;
+      ++fNumFreePackets;
+    } else {
+      delete packet;
     }
   }
   Boolean isEmpty() const { return fHeadPacket == NULL; }
@@ -58,6 +66,9 @@ private:
   BufferedPacket* fSavedPacket;
       // to avoid calling new/free in the common case
   Boolean fSavedPacketFree;
+  BufferedPacket* fFreePackets;
+      // previously used packets (other than "fSavedPacket"), kept to avoid calling new/free when packets get reordered
+  unsigned fNumFreePackets;
 };
 
 
@@ -236,7 +247,7 @@ void MultiFramedRTPSource::networkReadHandler1() {
   // Read the network packet, and perform sanity checks on the RTP header:
   Boolean readSuccess = False;
   do {
-    struct sockaddr_in fromAddress;
+    struct sockaddr_storage fromAddress;
     Boolean packetReadWasIncomplete = fPacketReadInProgress != NULL;
     if (!bPacket->fillInData(fRTPInterface, fromAddress, packetReadWasIncomplete)) {
       if (bPacket->bytesAvailable() == 0) { // should not happen??
@@ -252,91 +263,122 @@ void MultiFramedRTPSource::networkReadHandler1() {
     } else {
       fPacketReadInProgress = NULL;
     }
+    if (!bPacket->unprotectData(fRTPInterface)) break; // the packet failed SRTP authentication
 #ifdef TEST_LOSS
     setPacketReorderingThresholdTime(0);
        // don't wait for 'lost' packets to arrive out-of-order later
     if ((our_random()%10) == 0) break; // simulate 10% packet loss
 #endif
 
-    // Check for the 12-byte RTP header:
-    if (bPacket->dataSize() < 12) break;
-    unsigned rtpHdr = ntohl(*(u_int32_t*)(bPacket->data())); ADVANCE(4);
-    Boolean rtpMarkerBit = (rtpHdr&0x00800000) != 0;
-    unsigned rtpTimestamp = ntohl(*(u_int32_t*)(bPacket->data()));ADVANCE(4);
-    unsigned rtpSSRC = ntohl(*(u_int32_t*)(bPacket->data())); ADVANCE(4);
-
-    // Check the RTP version number (it should be 2):
-    if ((rtpHdr&0xC0000000) != 0x80000000) break;
-
-    // Check the Payload Type.
-    unsigned char rtpPayloadType = (unsigned char)((rtpHdr&0x007F0000)>>16);
-    if (rtpPayloadType != rtpPayloadFormat()) {
-      if (fRTCPInstanceForMultiplexedRTCPPackets != NULL
-	  && rtpPayloadType >= 64 && rtpPayloadType <= 95) {
-	// This is a multiplexed RTCP packet, and we've been asked to deliver such packets.
-	// Do so now:
-	fRTCPInstanceForMultiplexedRTCPPackets
-	  ->injectReport(bPacket->data()-12, bPacket->dataSize()+12, fromAddress);
+    if (!processIncomingPacket(bPacket, fromAddress, False)) break;
+    readSuccess = True;
+  } while (0);
+  if (!readSuccess) fReorderingBuffer->freePacket(bPacket);
+
+  if (fFECDecoder != NULL) {
+    // Store any packets that can now be recovered (using FEC):
+    unsigned recoveredPacketSize;
+    u_int8_t const* recoveredPacket;
+    while ((recoveredPacket = fFECDecoder->nextRecoveredPacket(recoveredPacketSize)) != NULL) {
+      BufferedPacket* rPacket = fReorderingBuffer->getFreePacket(this);
+      struct sockaddr_storage fromAddress;
+      memset(&fromAddress, 0, sizeof fromAddress);
+      if (!rPacket->fillInData(recoveredPacket, recoveredPacketSize)
+	  || !processIncomingPacket(rPacket, fromAddress, True)) {
+	fReorderingBuffer->freePacket(rPacket);
       }
-      break;
     }
+  }
 
-    // Skip over any CSRC identifiers in the header:
-    unsigned cc = (rtpHdr>>24)&0x0F;
-    if (bPacket->dataSize() < cc*4) break;
-    ADVANCE(cc*4);
-
-    // Check for (& ignore) any RTP header extension
-    if (rtpHdr&0x10000000) {
-      if (bPacket->dataSize() < 4) break;
-      unsigned extHdr = ntohl(*(u_int32_t*)(bPacket->data())); ADVANCE(4);
-      unsigned remExtSize = 4*(extHdr&0xFFFF);
-      if (bPacket->dataSize() < remExtSize) break;
-      ADVANCE(remExtSize);
-    }
+  doGetNextFrame1();
+  // If we didn't get proper data this time, we'll get another chance
+}
 
-    // Discard any padding bytes:
-    if (rtpHdr&0x20000000) {
-      if (bPacket->dataSize() == 0) break;
-      unsigned numPaddingBytes
-	= (unsigned)(bPacket->data())[bPacket->dataSize()-1];
-      if (bPacket->dataSize() < numPaddingBytes) break;
-      bPacket->removePadding(numPaddingBytes);
+Boolean MultiFramedRTPSource
+::processIncomingPacket(BufferedPacket* bPacket, struct sockaddr_storage const& fromAddress, Boolean wasRecovered) {
+  // Remember the complete packet, in case we need to give it to our FEC decoder:
+  u_int8_t const* packetStart = bPacket->data();
+  unsigned packetSize = bPacket->dataSize();
+
+  // Check for the 12-byte RTP header:
+  if (bPacket->dataSize() < 12) return False;
+  unsigned rtpHdr = ntohl(*(u_int32_t*)(bPacket->data())); ADVANCE(4);
+  Boolean rtpMarkerBit = (rtpHdr&0x00800000) != 0;
+  unsigned rtpTimestamp = ntohl(*(u_int32_t*)(bPacket->data()));ADVANCE(4);
+  unsigned rtpSSRC = ntohl(*(u_int32_t*)(bPacket->data())); ADVANCE(4);
+
+  // Check the RTP version number (it should be 2):
+  if ((rtpHdr&0xC0000000) != 0x80000000) return False;
+
+  // Check the Payload Type.
+  unsigned char rtpPayloadType = (unsigned char)((rtpHdr&0x007F0000)>>16);
+  if (rtpPayloadType != rtpPayloadFormat()) {
+    if (fRTCPInstanceForMultiplexedRTCPPackets != NULL
+	&& rtpPayloadType >= 64 && rtpPayloadType <= 95) {
+      // This is a multiplexed RTCP packet, and we've been asked to deliver such packets.
+      // Do so now:
+      fRTCPInstanceForMultiplexedRTCPPackets
+	->injectReport(bPacket->data()-12, bPacket->dataSize()+12, fromAddress);
+    } else if (fFECDecoder != NULL && rtpPayloadType == fFECDecoder->fecPayloadType()) {
+      // This is a FEC packet.  It's used only to recover lost media packets:
+      fFECDecoder->noteFECPacket(packetStart, packetSize);
     }
+    return False;
+  }
 
-    // The rest of the packet is the usable data.  Record and save it:
-    if (rtpSSRC != fLastReceivedSSRC) {
-      // The SSRC of incoming packets has changed.  Unfortunately we don't yet handle streams that contain multiple SSRCs,
-      // but we can handle a single-SSRC stream where the SSRC changes occasionally:
-      fLastReceivedSSRC = rtpSSRC;
-      fReorderingBuffer->resetHaveSeenFirstPacket();
-    }
-    unsigned short rtpSeqNo = (unsigned short)(rtpHdr&0xFFFF);
-    Boolean usableInJitterCalculation
-      = packetIsUsableInJitterCalculation((bPacket->data()),
-						  bPacket->dataSize());
-    struct timeval presentationTime; // computed by:
-    Boolean hasBeenSyncedUsingRTCP; // computed by:
-    receptionStatsDB()
-      .noteIncomingPacket(rtpSSRC, rtpSeqNo, rtpTimestamp,
-			  timestampFrequency(),
-			  usableInJitterCalculation, presentationTime,
-			  hasBeenSyncedUsingRTCP, bPacket->dataSize());
-
-    // Fill in the rest of the packet descriptor, and store it:
-    struct timeval timeNow;
-    gettimeofday(&timeNow, NULL);
-    bPacket->assignMiscParams(rtpSeqNo, rtpTimestamp, presentationTime,
-			      hasBeenSyncedUsingRTCP, rtpMarkerBit,
-			      timeNow);
-    if (!fReorderingBuffer->storePacket(bPacket)) break;
+  // Skip over any CSRC identifiers in the header:
+  unsigned cc = (rtpHdr>>24)&0x0F;
+  if (bPacket->dataSize() < cc*4) return False;
+  ADVANCE(cc*4);
+
+  // Check for (& ignore) any RTP header extension
+  if (rtpHdr&0x10000000) {
+    if (bPacket->dataSize() < 4) return False;
+    unsigned extHdr = ntohl(*(u_int32_t*)(bPacket->data())); ADVANCE(4);
+    unsigned remExtSize = 4*(extHdr&0xFFFF);
+    if (bPacket->dataSize() < remExtSize) return False;
+    ADVANCE(remExtSize);
+  }
 
-    readSuccess = True;
-  } while (0);
-  if (!readSuccess) fReorderingBuffer->freePacket(bPacket);
+  // Discard any padding bytes:
+  if (rtpHdr&0x20000000) {
+    if (bPacket->dataSize() == 0) return False;
+    unsigned numPaddingBytes
+      = (unsigned)(bPacket->data())[bPacket->dataSize()-1];
+    if (bPacket->dataSize() < numPaddingBytes) return False;
+    bPacket->removePadding(numPaddingBytes);
+  }
 
-  doGetNextFrame1();
-  // If we didn't get proper data this time, we'll get another chance
+  // The packet is valid, so our FEC decoder (if any) may use it to recover other packets:
+  if (fFECDecoder != NULL && !wasRecovered) fFECDecoder->noteMediaPacket(packetStart, packetSize);
+
+  // The rest of the packet is the usable data.  Record and save it:
+  if (rtpSSRC != fLastReceivedSSRC) {
+    // The SSRC of incoming packets has changed.  Unfortunately we don't yet handle streams that contain multiple SSRCs,
+    // but we can handle a single-SSRC stream where the SSRC changes occasionally:
+    fLastReceivedSSRC = rtpSSRC;
+    fReorderingBuffer->resetHaveSeenFirstPacket();
+  }
+  unsigned short rtpSeqNo = (unsigned short)(rtpHdr&0xFFFF);
+  Boolean usableInJitterCalculation
+    = !wasRecovered // a recovered packet's 'arrival' time says nothing about network jitter
+    && packetIsUsableInJitterCalculation((bPacket->data()),
+					 bPacket->dataSize());
+  struct timeval presentationTime; // computed by:
+  Boolean hasBeenSyncedUsingRTCP; // computed by:
+  receptionStatsDB()
+    .noteIncomingPacket(rtpSSRC, rtpSeqNo, rtpTimestamp,
+			timestampFrequency(),
+			usableInJitterCalculation, presentationTime,
+			hasBeenSyncedUsingRTCP, bPacket->dataSize());
+
+  // Fill in the rest of the packet descriptor, and store it:
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  bPacket->assignMiscParams(rtpSeqNo, rtpTimestamp, presentationTime,
+			    hasBeenSyncedUsingRTCP, rtpMarkerBit,
+			    timeNow);
+  return fReorderingBuffer->storePacket(bPacket);
 }
 
 
@@ -385,7 +427,24 @@ void BufferedPacket
   frameDurationInMicroseconds = 0; // by default.  Subclasses should correct this.
 }
 
-Boolean BufferedPacket::fillInData(RTPInterface& rtpInterface, struct sockaddr_in& fromAddress,
+Boolean BufferedPacket::fillInData(unsigned char const* packet, unsigned packetSize) {
+  reset();
+  if (packetSize > fPacketSize) return False;
+
+  memmove(fBuf, packet, packetSize);
+  fTail = packetSize;
+  return True;
+}
+
+Boolean BufferedPacket::unprotectData(RTPInterface& rtpInterface) {
+  unsigned packetSize = fTail - fHead;
+  if (!rtpInterface.unprotectIncomingPacket(&fBuf[fHead], packetSize)) return False;
+
+  fTail = fHead + packetSize;
+  return True;
+}
+
+Boolean BufferedPacket::fillInData(RTPInterface& rtpInterface, struct sockaddr_storage& fromAddress,
 				   Boolean& packetReadWasIncomplete) {
   if (!packetReadWasIncomplete) reset();
 
@@ -488,7 +547,8 @@ BufferedPacket* BufferedPacketFactory
 ReorderingPacketBuffer
 ::ReorderingPacketBuffer(BufferedPacketFactory* packetFactory)
   : fThresholdTime(100000) /* default reordering threshold: 100 ms */,
-    fHaveSeenFirstPacket(False), fHeadPacket(NULL), fTailPacket(NULL), fSavedPacket(NULL), fSavedPacketFree(True) {
+    fHaveSeenFirstPacket(False), fHeadPacket(NULL), fTailPacket(NULL), fSavedPacket(NULL), fSavedPacketFree(True),
+    fFreePackets(NULL), fNumFreePackets(0) {
   fPacketFactory = (packetFactory == NULL)
     ? (new BufferedPacketFactory)
     : packetFactory;
@@ -502,8 +562,10 @@ ReorderingPacketBuffer::~ReorderingPacketBuffer() {
 void ReorderingPacketBuffer::reset() {
   if (fSavedPacketFree) delete fSavedPacket; // because fSavedPacket is not in the list
   delete fHeadPacket; // will also delete fSavedPacket if it's in the list
+  delete fFreePackets;
   resetHaveSeenFirstPacket();
-  fHeadPacket = fTailPacket = fSavedPacket = NULL;
+  fHeadPacket = fTailPacket = fSavedPacket = fFreePackets = NULL;
+  fNumFreePackets = 0;
 }
 
 BufferedPacket* ReorderingPacketBuffer::getFreePacket(MultiFramedRTPSource* ourSource) {
@@ -515,6 +577,12 @@ BufferedPacket* ReorderingPacketBuffer::getFreePacket(MultiFramedRTPSource* ourS
   if (fSavedPacketFree == True) {
     fSavedPacketFree = False;
     return fSavedPacket;
+  } else if (fFreePackets != NULL) {
+    BufferedPacket* packet = fFreePackets;
+    fFreePackets = packet->nextPacket();
+    packet->nextPacket() = NULL;
+    --fNumFreePackets;
+    return packet;
   } else {
     return fPacketFactory->createNewPacket(ourSource);
   }
@@ -20,16 +20,22 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "OnDemandServerMediaSubsession.hh"
+#include "ServerPortAllocator.hh"
+#include "RTPRateController.hh"
+#include "ULPFEC.hh"
 #include <GroupsockHelper.hh>
+#include <atomic>
 
 OnDemandServerMediaSubsession ::OnDemandServerMediaSubsession(UsageEnvironment &env,
                                                               Boolean reuseFirstSource,
                                                               portNumBits initialPortNum,
                                                               Boolean multiplexRTCPWithRTP)
     : ServerMediaSubsession(env),
-      fSDPLines(NULL), fReuseFirstSource(reuseFirstSource),
+      fSDPLines(NULL), fSDPLinesIPv6(NULL), fReuseFirstSource(reuseFirstSource),
       fMultiplexRTCPWithRTP(multiplexRTCPWithRTP), fLastStreamToken(NULL),
-      fAppHandlerTask(NULL), fAppHandlerClientData(NULL)
+      fAppHandlerTask(NULL), fAppHandlerClientData(NULL),
+      fRateControlMinBitrate(0), fRateControlMaxBitrate(0), fTransportCCExtensionId(0),
+      fFECNumColumns(0), fFECNumRows(0), fFECPayloadType(0), fMIKEYState(NULL)
 {
   fDestinationsHashTable = HashTable::create(ONE_WORD_HASH_KEYS);
   if (fMultiplexRTCPWithRTP)
@@ -57,6 +63,8 @@ OnDemandServerMediaSubsession ::OnDemandServerMediaSubsession(UsageEnvironment &
 OnDemandServerMediaSubsession::~OnDemandServerMediaSubsession()
 {
   delete[] fSDPLines;
+  delete[] fSDPLinesIPv6;
+  delete fMIKEYState;
 
   // Clean out the destinations hash table:
   while (1)
@@ -70,7 +78,7 @@ OnDemandServerMediaSubsession::~OnDemandServerMediaSubsession()
 }
 
 char const *
-OnDemandServerMediaSubsession::sdpLines()
+OnDemandServerMediaSubsession::sdpLines(int addressFamily)
 {
   if (fSDPLines == NULL)
   {
@@ -95,11 +103,11 @@ OnDemandServerMediaSubsession::sdpLines()
     if (inputSource == NULL)
       return NULL; // file not found
 
-    struct in_addr dummyAddr;
-    dummyAddr.s_addr = 0;
-    Groupsock *dummyGroupsock = createGroupsock(dummyAddr, 0);
+    Groupsock *dummyGroupsock = createGroupsock(nullAddress(), 0);
     unsigned char rtpPayloadType = 96 + trackNumber() - 1; // if dynamic
     RTPSink *dummyRTPSink = createNewRTPSink(dummyGroupsock, rtpPayloadType, inputSource);
+    if (dummyRTPSink != NULL && fFECNumColumns > 0)
+      dummyRTPSink->enableFEC(fFECPayloadType, fFECNumColumns, fFECNumRows);
     if (dummyRTPSink != NULL && dummyRTPSink->estimatedBitrate() > 0)
       estBitrate = dummyRTPSink->estimatedBitrate();
 
@@ -109,17 +117,36 @@ OnDemandServerMediaSubsession::sdpLines()
     closeStreamSource(inputSource);
   }
 
-  return fSDPLines;
+  return addressFamily == AF_INET6 ? fSDPLinesIPv6 : fSDPLines;
+}
+
+static Boolean dualStackSocketsAreSupported(UsageEnvironment &env)
+{
+  // Checks (once) whether we can create IPv6 sockets that can also be used with IPv4 peers.
+  // (This may be called from several threads at once - e.g., by the worker threads of a "RTSPServerWithWorkerThreads" -
+  // so the result is atomic.  If two threads both do the check, they get the same result, so that's harmless.)
+  static std::atomic<int> isSupported(-1); // not yet known
+  int result = isSupported.load(std::memory_order_relaxed);
+  if (result < 0)
+  {
+    DualStack dualStack(env);
+    int testSocket = setupDatagramSocket(env, 0, AF_INET6);
+    result = testSocket >= 0;
+    if (testSocket >= 0)
+      closeSocket(testSocket);
+    isSupported.store(result, std::memory_order_relaxed);
+  }
+  return result != 0;
 }
 
 void OnDemandServerMediaSubsession ::getStreamParameters(unsigned clientSessionId,
-                                                         netAddressBits clientAddress,
+                                                         struct sockaddr_storage const &clientAddress,
                                                          Port const &clientRTPPort,
                                                          Port const &clientRTCPPort,
                                                          int tcpSocketNum,
                                                          unsigned char rtpChannelId,
                                                          unsigned char rtcpChannelId,
-                                                         netAddressBits &destinationAddress,
+                                                         struct sockaddr_storage &destinationAddress,
                                                          u_int8_t & /*destinationTTL*/,
                                                          Boolean &isMulticast,
                                                          Port &serverRTPPort,
@@ -127,13 +154,26 @@ void OnDemandServerMediaSubsession ::getStreamParameters(unsigned clientSessionI
                                                          void *&streamToken)
 {
   // 如果目标地址为空，则将目标地址设置为客户端地址
-  if (destinationAddress == 0)
+  if (addressIsNull(destinationAddress))
     destinationAddress = clientAddress;
-  struct in_addr destinationAddr;
-  destinationAddr.s_addr = destinationAddress;
   isMulticast = False;
 
-  if (fLastStreamToken != NULL && fReuseFirstSource)
+  // A shared stream's UDP sockets are 'dual-stack' IPv6 sockets (if the system supports them; see below), which can be used
+  // with clients of either address family.  Otherwise they can be used only with UDP clients of their own family:
+  StreamState *lastStreamState = (StreamState *)fLastStreamToken;
+  Groupsock *sharedGroupsock = lastStreamState == NULL ? NULL : lastStreamState->rtpGroupsock();
+  if (fReuseFirstSource && sharedGroupsock != NULL && tcpSocketNum < 0 &&
+      sharedGroupsock->family() != destinationAddress.ss_family &&
+      !(sharedGroupsock->family() == AF_INET6 && dualStackSocketsAreSupported(envir())))
+  {
+    // We can't stream to this client.  (We mustn't create a second stream from the same source, either.)
+    // Returning no stream (and no server ports) makes the "SETUP" fail:
+    serverRTPPort = serverRTCPPort = 0;
+    streamToken = NULL;
+    return;
+  }
+
+  if (lastStreamState != NULL && fReuseFirstSource)
   {
     // Special case: Rather than creating a new 'StreamState',
     // we reuse the one that we've already created:
@@ -153,71 +193,60 @@ void OnDemandServerMediaSubsession ::getStreamParameters(unsigned clientSessionI
     RTPSink *rtpSink = NULL;
     BasicUDPSink *udpSink = NULL;
     Groupsock *rtpGroupsock = NULL;
+    SRTPCryptographicContext *srtpContext = NULL;
     Groupsock *rtcpGroupsock = NULL;
+    Boolean serverPortsArePooled = False;
+
+    // A shared stream might later get UDP clients of the other address family, so we give it IPv6 sockets, if they
+    // can also be used with IPv4 clients:
+    int groupsockFamily = destinationAddress.ss_family;
+    if (fReuseFirstSource && dualStackSocketsAreSupported(envir()))
+      groupsockFamily = AF_INET6;
 
     if (clientRTPPort.num() != 0 || tcpSocketNum >= 0)
     { // Normal case: Create destinations
-      portNumBits serverPortNum;
       if (clientRTCPPort.num() == 0)
       {
         // We're streaming raw UDP (not RTP). Create a single groupsock:
-        NoReuse dummy(envir()); // ensures that we skip over ports that are already in use
-        for (serverPortNum = fInitialPortNum;; ++serverPortNum)
-        {
-          struct in_addr dummyAddr;
-          dummyAddr.s_addr = 0;
-
-          serverRTPPort = serverPortNum;
-          rtpGroupsock = createGroupsock(dummyAddr, serverRTPPort);
-          if (rtpGroupsock->socketNum() >= 0)
-            break; // success
-        }
+        serverPortsArePooled = createServerGroupsocks(groupsockFamily, False, serverRTPPort, serverRTCPPort,
+                                                      rtpGroupsock, rtcpGroupsock);
 
         udpSink = BasicUDPSink::createNew(envir(), rtpGroupsock);
       }
+      else if (tcpSocketNum >= 0 && !fReuseFirstSource)
+      {
+        // We're streaming RTP-over-TCP, to just this client, so we don't need any UDP sockets (or server ports)
+        // at all.  The 'RTP sink' (and, later, the 'RTCP instance') are created without 'groupsocks':
+        serverRTPPort = serverRTCPPort = 0;
+      }
       else
       {
-        // Normal case: We're streaming RTP (over UDP or TCP).  Create a pair of
-        // groupsocks (RTP and RTCP), with adjacent port numbers (RTP port number even).
-        // (If we're multiplexing RTCP and RTP over the same port number, it can be odd or even.)
-        NoReuse dummy(envir()); // ensures that we skip over ports that are already in use
-        for (portNumBits serverPortNum = fInitialPortNum;; ++serverPortNum)
+        // Normal case: We're streaming RTP over UDP (or over TCP, to a stream that other clients might later
+        // share).  Create a pair of groupsocks (RTP and RTCP), with adjacent port numbers (RTP port number even).
+        // (If we're multiplexing RTCP and RTP over the same port number, we use the RTP 'groupsock' for both.)
+        serverPortsArePooled = createServerGroupsocks(groupsockFamily, !fMultiplexRTCPWithRTP, serverRTPPort, serverRTCPPort,
+                                                      rtpGroupsock, rtcpGroupsock);
+        if (fMultiplexRTCPWithRTP)
         {
-          struct in_addr dummyAddr;
-          dummyAddr.s_addr = 0;
-
-          serverRTPPort = serverPortNum;
-          rtpGroupsock = createGroupsock(dummyAddr, serverRTPPort);
-          if (rtpGroupsock->socketNum() < 0)
-          {
-            delete rtpGroupsock;
-            continue; // try again
-          }
-
-          if (fMultiplexRTCPWithRTP)
-          {
-            // Use the RTP 'groupsock' object for RTCP as well:
-            serverRTCPPort = serverRTPPort;
-            rtcpGroupsock = rtpGroupsock;
-          }
-          else
-          {
-            // Create a separate 'groupsock' object (with the next (odd) port number) for RTCP:
-            serverRTCPPort = ++serverPortNum;
-            rtcpGroupsock = createGroupsock(dummyAddr, serverRTCPPort);
-            if (rtcpGroupsock->socketNum() < 0)
-            {
-              delete rtpGroupsock;
-              delete rtcpGroupsock;
-              continue; // try again
-            }
-          }
-
-          break; // success
+          serverRTCPPort = serverRTPPort;
+          rtcpGroupsock = rtpGroupsock;
         }
+      }
 
+      if (clientRTCPPort.num() != 0)
+      {
+        // We're streaming RTP (rather than raw UDP), so create a 'RTP sink':
         unsigned char rtpPayloadType = 96 + trackNumber() - 1; // if dynamic
         rtpSink = createNewRTPSink(rtpGroupsock, rtpPayloadType, mediaSource);
+        if (rtpSink != NULL && fFECNumColumns > 0)
+          rtpSink->enableFEC(fFECPayloadType, fFECNumColumns, fFECNumRows);
+        if (rtpSink != NULL && fMIKEYState != NULL)
+        {
+          // Each stream gets its own SRTP cryptographic context (but they all use the master key from our SDP):
+          srtpContext = SRTPCryptographicContext::createNew(*fMIKEYState);
+          if (srtpContext != NULL)
+            rtpSink->setSRTPContext(srtpContext);
+        }
         if (rtpSink != NULL && rtpSink->estimatedBitrate() > 0)
           streamBitrate = rtpSink->estimatedBitrate();
       }
@@ -241,20 +270,21 @@ void OnDemandServerMediaSubsession ::getStreamParameters(unsigned clientSessionI
     }
 
     // Set up the state of the stream.  The stream will get started later:
-    streamToken = fLastStreamToken = new StreamState(*this, serverRTPPort, serverRTCPPort, rtpSink, udpSink,
+    streamToken = fLastStreamToken = new (envir()) StreamState(*this, serverRTPPort, serverRTCPPort, rtpSink, udpSink,
                                                      streamBitrate, mediaSource,
-                                                     rtpGroupsock, rtcpGroupsock);
+                                                     rtpGroupsock, rtcpGroupsock, serverPortsArePooled,
+                                                     srtpContext);
   }
 
   // Record these destinations as being for this client session id:
   Destinations *destinations;
   if (tcpSocketNum < 0)
   { // UDP
-    destinations = new Destinations(destinationAddr, clientRTPPort, clientRTCPPort);
+    destinations = new (envir()) Destinations(destinationAddress, clientRTPPort, clientRTCPPort);
   }
   else
   { // TCP
-    destinations = new Destinations(tcpSocketNum, rtpChannelId, rtcpChannelId);
+    destinations = new (envir()) Destinations(tcpSocketNum, rtpChannelId, rtcpChannelId);
   }
   fDestinationsHashTable->Add((char const *)clientSessionId, destinations);
 }
@@ -396,6 +426,26 @@ FramedSource *OnDemandServerMediaSubsession::getStreamSource(void *streamToken)
   return streamState->mediaSource();
 }
 
+Boolean OnDemandServerMediaSubsession::usesSRTP() const
+{
+  return fMIKEYState != NULL;
+}
+
+u_int8_t *OnDemandServerMediaSubsession::getMIKEYMessage(void *streamToken, unsigned &messageSize)
+{
+  messageSize = 0;
+  StreamState *streamState = (StreamState *)streamToken;
+  if (fMIKEYState == NULL || streamState == NULL || streamState->rtpSink() == NULL ||
+      streamState->srtpContext() == NULL)
+    return NULL;
+
+  // Describe the stream's SSRC, and the rollover counter of its next packet.  (If the stream is shared, its sequence
+  // number may already have wrapped around.)
+  RTPSink *rtpSink = streamState->rtpSink(); // alias
+  u_int32_t roc = streamState->srtpContext()->outgoingROC(rtpSink->SSRC(), rtpSink->currentSeqNo());
+  return fMIKEYState->generateMessage(messageSize, rtpSink->SSRC(), roc);
+}
+
 void OnDemandServerMediaSubsession ::getRTPSinkandRTCP(void *streamToken,
                                                        RTPSink const *&rtpSink, RTCPInstance const *&rtcp)
 {
@@ -482,7 +532,87 @@ void OnDemandServerMediaSubsession::closeStreamSource(FramedSource *inputSource)
   Medium::close(inputSource);
 }
 
-Groupsock *OnDemandServerMediaSubsession ::createGroupsock(struct in_addr const &addr, Port port)
+Boolean OnDemandServerMediaSubsession ::createServerGroupsocks(int addressFamily, Boolean separateRTCPPort,
+                                                              Port &serverRTPPort, Port &serverRTCPPort,
+                                                              Groupsock *&rtpGroupsock, Groupsock *&rtcpGroupsock)
+{
+  NoReuse dummy(envir()); // ensures that we skip over ports that are already in use
+
+  // Normally, we take a port pair from the (process-wide) pool.  Its ports might be in use by some other program,
+  // though; if so, we put the pair back (at the end of the pool's queue), and try another.
+  // (But if our "initialPortNum" is outside the pool's range, we don't use the pool at all.)
+  portNumBits serverPortNum;
+  unsigned numTries = 0;
+  Boolean const usePool = ServerPortAllocator::isInPortRange(fInitialPortNum);
+  while (usePool && ServerPortAllocator::allocatePortPair(serverPortNum))
+  {
+    if (createServerGroupsocks1(addressFamily, serverPortNum, separateRTCPPort, serverRTPPort, serverRTCPPort,
+                                rtpGroupsock, rtcpGroupsock))
+      return True;
+    ServerPortAllocator::releasePortPair(serverPortNum);
+    if (++numTries >= ServerPortAllocator::numFreePortPairs())
+      break; // we've tried every free pair
+  }
+
+  // The pool is exhausted (or not for us), so fall back to trying successive port numbers.  If we use the pool, we
+  // begin just above its range, so that we don't take ports that belong to (free) pairs in the pool.  (But if the
+  // pool's range extends to the top of the port space - as the default range does - we begin with "initialPortNum";
+  // any pool pair whose port we take here then fails to bind, so "allocatePortPair()" callers skip it, as above.)
+  serverPortNum = fInitialPortNum;
+  if (usePool)
+  {
+    portNumBits poolFirstPortNum, poolLastPortNum;
+    ServerPortAllocator::getPortRange(poolFirstPortNum, poolLastPortNum);
+    unsigned firstPortNumAbovePool = poolLastPortNum + 1;
+    if (separateRTCPPort)
+      firstPortNumAbovePool = (firstPortNumAbovePool + 1) & ~1; // RTP port numbers are even
+    if (firstPortNumAbovePool < 65535)
+      serverPortNum = (portNumBits)firstPortNumAbovePool;
+  }
+  for (;; serverPortNum += separateRTCPPort ? 2 : 1)
+  {
+    if (createServerGroupsocks1(addressFamily, serverPortNum, separateRTCPPort, serverRTPPort, serverRTCPPort,
+                                rtpGroupsock, rtcpGroupsock))
+      return False;
+  }
+}
+
+Boolean OnDemandServerMediaSubsession ::createServerGroupsocks1(int addressFamily, portNumBits serverPortNum,
+                                                               Boolean separateRTCPPort,
+                                                               Port &serverRTPPort, Port &serverRTCPPort,
+                                                               Groupsock *&rtpGroupsock, Groupsock *&rtcpGroupsock)
+{
+  struct sockaddr_storage const &dummyAddr = nullAddress(addressFamily);
+  DualStack dualStack(envir()); // our IPv6 sockets can also be used with IPv4 clients (see "getStreamParameters()")
+
+  serverRTPPort = serverPortNum;
+  rtpGroupsock = createGroupsock(dummyAddr, serverRTPPort);
+  if (rtpGroupsock->socketNum() < 0)
+  {
+    delete rtpGroupsock;
+    rtpGroupsock = NULL;
+    return False;
+  }
+
+  if (separateRTCPPort)
+  {
+    // Create a separate 'groupsock' object (with the next (odd) port number) for RTCP:
+    serverRTCPPort = serverPortNum + 1;
+    rtcpGroupsock = createGroupsock(dummyAddr, serverRTCPPort);
+    if (rtcpGroupsock->socketNum() < 0)
+    {
+      delete rtpGroupsock;
+      rtpGroupsock = NULL;
+      delete rtcpGroupsock;
+      rtcpGroupsock = NULL;
+      return False;
+    }
+  }
+
+  return True;
+}
+
+Groupsock *OnDemandServerMediaSubsession ::createGroupsock(struct sockaddr_storage const &addr, Port port)
 {
   // Default implementation; may be redefined by subclasses:
   return new Groupsock(envir(), addr, port, 255);
@@ -495,6 +625,41 @@ RTCPInstance *OnDemandServerMediaSubsession ::createRTCP(Groupsock *RTCPgs, unsi
   return RTCPInstance::createNew(envir(), RTCPgs, totSessionBW, cname, sink, NULL /*we're a server*/);
 }
 
+void OnDemandServerMediaSubsession ::enableRateControl(unsigned minBitrate, unsigned maxBitrate,
+                                                       u_int8_t transportCCExtensionId)
+{
+  fRateControlMinBitrate = minBitrate;
+  fRateControlMaxBitrate = maxBitrate;
+  fTransportCCExtensionId = transportCCExtensionId <= 14 ? transportCCExtensionId : 0;
+}
+
+Boolean OnDemandServerMediaSubsession ::enableFEC(unsigned numColumns, unsigned numRows, unsigned char fecPayloadType)
+{
+  if (fecPayloadType < 96 || fecPayloadType > 127 || !ULPFECEncoder::parametersAreValid(numColumns, numRows, True))
+  {
+    envir().setResultMsg("OnDemandServerMediaSubsession::enableFEC(): Bad parameters");
+    return False;
+  }
+
+  fFECNumColumns = numColumns;
+  fFECNumRows = numRows;
+  fFECPayloadType = fecPayloadType;
+  return True;
+}
+
+Boolean OnDemandServerMediaSubsession ::enableSRTP(MIKEYState::SRTPProfile profile, Boolean encrypt)
+{
+  if (!SRTPCryptographicContext::isSupported())
+  {
+    envir().setResultMsg("OnDemandServerMediaSubsession::enableSRTP(): SRTP is not supported by this build");
+    return False;
+  }
+
+  delete fMIKEYState;
+  fMIKEYState = MIKEYState::createNew(profile, encrypt, encrypt);
+  return True;
+}
+
 void OnDemandServerMediaSubsession ::setRTCPAppPacketHandler(RTCPAppHandlerFunc *handler, void *clientData)
 {
   fAppHandlerTask = handler;
@@ -521,40 +686,79 @@ void OnDemandServerMediaSubsession ::setSDPLinesFromRTPSink(RTPSink *rtpSink, Fr
   AddressString ipAddressStr(fServerAddressForSDP);
   char *rtpmapLine = rtpSink->rtpmapLine();
   char const *rtcpmuxLine = fMultiplexRTCPWithRTP ? "a=rtcp-mux\r\n" : "";
+  char const *rtpProfile = fMIKEYState != NULL ? "RTP/SAVP" : "RTP/AVP";
+  char *keyMgmtLine = fMIKEYState != NULL ? fMIKEYState->keyMgmtSDPLine() : strDup("");
+  char fecFmt[5];
+  if (rtpSink->fecPayloadType() != 0)
+    sprintf(fecFmt, " %d", rtpSink->fecPayloadType());
+  else
+    fecFmt[0] = '\0';
+  char *fecLines = rtpSink->fecSDPLines();
+  char transportCCLines[200];
+  if (fRateControlMaxBitrate > 0 && fTransportCCExtensionId != 0)
+  {
+    sprintf(transportCCLines,
+            "a=extmap:%u http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01\r\n"
+            "a=rtcp-fb:%d transport-cc\r\n",
+            fTransportCCExtensionId, rtpPayloadType);
+  }
+  else
+  {
+    transportCCLines[0] = '\0';
+  }
   char const *rangeLine = rangeSDPLine();
   char const *auxSDPLine = getAuxSDPLine(rtpSink, inputSource);
   if (auxSDPLine == NULL)
     auxSDPLine = "";
 
+  // We generate two versions of the SDP lines: one for IPv4 clients, and one for IPv6 clients.  They differ only in
+  // their "c=" line:
+  AddressString ipv6AddressStr(nullAddress(AF_INET6));
   char const *const sdpFmt =
-      "m=%s %u RTP/AVP %d\r\n"
-      "c=IN IP4 %s\r\n"
+      "m=%s %u %s %d%s\r\n"
+      "c=IN %s %s\r\n"
       "b=AS:%u\r\n"
       "%s"
       "%s"
       "%s"
       "%s"
+      "%s"
+      "%s"
+      "%s"
       "a=control:%s\r\n";
-  unsigned sdpFmtSize = strlen(sdpFmt) + strlen(mediaType) + 5 /* max short len */ + 3 /* max char len */
-                        + strlen(ipAddressStr.val()) + 20                              /* max int len */
-                        + strlen(rtpmapLine) + strlen(rtcpmuxLine) + strlen(rangeLine) + strlen(auxSDPLine) + strlen(trackId());
+  unsigned sdpFmtSize = strlen(sdpFmt) + strlen(mediaType) + 5 /* max short len */ + strlen(rtpProfile) + 3 /* max char len */
+                        + 3 + strlen(ipAddressStr.val()) + strlen(ipv6AddressStr.val()) + 20 /* max int len */
+                        + strlen(fecFmt) + strlen(rtpmapLine) + strlen(fecLines) + strlen(rtcpmuxLine) + strlen(transportCCLines)
+                        + strlen(keyMgmtLine) + strlen(rangeLine) + strlen(auxSDPLine) + strlen(trackId());
   char *sdpLines = new char[sdpFmtSize];
-  sprintf(sdpLines, sdpFmt,
-          mediaType,          // m= <media>
-          fPortNumForSDP,     // m= <port>
-          rtpPayloadType,     // m= <fmt list>
-          ipAddressStr.val(), // c= address
-          estBitrate,         // b=AS:<bandwidth>
-          rtpmapLine,         // a=rtpmap:... (if present)
-          rtcpmuxLine,        // a=rtcp-mux:... (if present)
-          rangeLine,          // a=range:... (if present)
-          auxSDPLine,         // optional extra SDP line
-          trackId());         // a=control:<track-id>
+  for (int i = 0; i < 2; ++i)
+  {
+    Boolean isIPv6 = i == 1;
+    sprintf(sdpLines, sdpFmt,
+            mediaType,                                               // m= <media>
+            fPortNumForSDP,                                          // m= <port>
+            rtpProfile,                                              // m= <proto>
+            rtpPayloadType,                                          // m= <fmt list>
+            fecFmt,                                                  // m= <fmt list> (continued)
+            isIPv6 ? "IP6" : "IP4",                                  // c= address type
+            isIPv6 ? ipv6AddressStr.val() : ipAddressStr.val(),      // c= address
+            estBitrate,                                              // b=AS:<bandwidth>
+            rtpmapLine,                                              // a=rtpmap:... (if present)
+            fecLines,                                                // a=rtpmap:... for FEC packets (if present)
+            rtcpmuxLine,                                             // a=rtcp-mux:... (if present)
+            transportCCLines,                                        // a=extmap:... and a=rtcp-fb:... (if present)
+            keyMgmtLine,                                             // a=key-mgmt:... (if present)
+            rangeLine,                                               // a=range:... (if present)
+            auxSDPLine,                                              // optional extra SDP line
+            trackId());                                              // a=control:<track-id>
+    char *&result = isIPv6 ? fSDPLinesIPv6 : fSDPLines;
+    delete[] result;
+    result = strDup(sdpLines);
+  }
   delete[] (char *)rangeLine;
   delete[] rtpmapLine;
-
-  delete[] fSDPLines;
-  fSDPLines = strDup(sdpLines);
+  delete[] fecLines;
+  delete[] keyMgmtLine;
   delete[] sdpLines;
 }
 
@@ -580,12 +784,13 @@ StreamState::StreamState(OnDemandServerMediaSubsession &master,
                          Port const &serverRTPPort, Port const &serverRTCPPort,
                          RTPSink *rtpSink, BasicUDPSink *udpSink,
                          unsigned totalBW, FramedSource *mediaSource,
-                         Groupsock *rtpGS, Groupsock *rtcpGS)
+                         Groupsock *rtpGS, Groupsock *rtcpGS, Boolean serverPortsArePooled,
+                         SRTPCryptographicContext *srtpContext)
     : fMaster(master), fAreCurrentlyPlaying(False), fReferenceCount(1),
-      fServerRTPPort(serverRTPPort), fServerRTCPPort(serverRTCPPort),
+      fServerRTPPort(serverRTPPort), fServerRTCPPort(serverRTCPPort), fServerPortsArePooled(serverPortsArePooled),
       fRTPSink(rtpSink), fUDPSink(udpSink), fStreamDuration(master.duration()),
       fTotalBW(totalBW), fRTCPInstance(NULL) /* created later */,
-      fMediaSource(mediaSource), fStartNPT(0.0), fRTPgs(rtpGS), fRTCPgs(rtcpGS)
+      fMediaSource(mediaSource), fStartNPT(0.0), fRTPgs(rtpGS), fRTCPgs(rtcpGS), fSRTPContext(srtpContext)
 {
 }
 
@@ -608,6 +813,15 @@ void StreamState ::startPlaying(Destinations *dests, unsigned clientSessionId,
     fRTCPInstance = fMaster.createRTCP(fRTCPgs, fTotalBW, (unsigned char *)fMaster.fCNAME, fRTPSink);
     // Note: This starts RTCP running automatically
     fRTCPInstance->setAppHandler(fMaster.fAppHandlerTask, fMaster.fAppHandlerClientData);
+    if (fSRTPContext != NULL)
+      fRTCPInstance->setSRTPContext(fSRTPContext);
+
+    if (fMaster.fRateControlMaxBitrate > 0)
+    {
+      // Also give the sink a congestion controller (which the sink will close, when it's closed):
+      RTPRateController::createNew(fRTPSink->envir(), fRTPSink, fMaster.fRateControlMinBitrate, fTotalBW,
+                                   fMaster.fRateControlMaxBitrate, fMaster.fTransportCCExtensionId);
+    }
   }
 
   if (dests->isTCP)
@@ -639,7 +853,7 @@ void StreamState ::startPlaying(Destinations *dests, unsigned clientSessionId,
     }
     if (fRTCPInstance != NULL)
     {
-      fRTCPInstance->setSpecificRRHandler(dests->addr.s_addr, dests->rtcpPort,
+      fRTCPInstance->setSpecificRRHandler(dests->addr, dests->rtcpPort,
                                           rtcpRRHandler, rtcpRRHandlerClientData);
     }
   }
@@ -712,7 +926,7 @@ void StreamState::endPlaying(Destinations *dests, unsigned clientSessionId)
       fRTCPgs->removeDestination(clientSessionId);
     if (fRTCPInstance != NULL)
     {
-      fRTCPInstance->unsetSpecificRRHandler(dests->addr.s_addr, dests->rtcpPort);
+      fRTCPInstance->unsetSpecificRRHandler(dests->addr, dests->rtcpPort);
     }
   }
 }
@@ -735,6 +949,8 @@ void StreamState::reclaim()
   fRTPSink = NULL;
   Medium::close(fUDPSink);
   fUDPSink = NULL;
+  delete fSRTPContext; // after the objects that used it
+  fSRTPContext = NULL;
 
   fMaster.closeStreamSource(fMediaSource);
   fMediaSource = NULL;
@@ -746,4 +962,11 @@ void StreamState::reclaim()
     delete fRTCPgs;
   fRTPgs = NULL;
   fRTCPgs = NULL;
+
+  if (fServerPortsArePooled)
+  {
+    // Now that its sockets are closed, the port pair can be used again:
+    ServerPortAllocator::releasePortPair(ntohs(fServerRTPPort.num()));
+    fServerPortsArePooled = False;
+  }
 }
@@ -39,11 +39,11 @@ PassiveServerMediaSubsession
 
 class RTCPSourceRecord {
 public:
-  RTCPSourceRecord(netAddressBits addr, Port const& port)
+  RTCPSourceRecord(struct sockaddr_storage const& addr, Port const& port)
     : addr(addr), port(port) {
   }
 
-  netAddressBits addr;
+  struct sockaddr_storage addr;
   Port port;
 };
 
@@ -68,7 +68,8 @@ Boolean PassiveServerMediaSubsession::rtcpIsMuxed() {
 }
 
 char const*
-PassiveServerMediaSubsession::sdpLines() {
+PassiveServerMediaSubsession::sdpLines(int /*addressFamily*/) {
+  // Note: Our SDP lines describe our (IPv4 or IPv6) multicast group, regardless of the client's address family.
   if (fSDPLines == NULL ) {
     // Construct a set of SDP lines that describe this subsession:
     // Use the components from "rtpSink":
@@ -81,25 +82,43 @@ PassiveServerMediaSubsession::sdpLines() {
     unsigned estBitrate
       = fRTCPInstance == NULL ? 50 : fRTCPInstance->totSessionBW();
     char* rtpmapLine = fRTPSink.rtpmapLine();
+    char fecFmt[5];
+    if (fRTPSink.fecPayloadType() != 0) {
+      sprintf(fecFmt, " %d", fRTPSink.fecPayloadType());
+    } else {
+      fecFmt[0] = '\0';
+    }
+    char* fecLines = fRTPSink.fecSDPLines();
     char const* rtcpmuxLine = rtcpIsMuxed() ? "a=rtcp-mux\r\n" : "";
     char const* rangeLine = rangeSDPLine();
     char const* auxSDPLine = fRTPSink.auxSDPLine();
     if (auxSDPLine == NULL) auxSDPLine = "";
 
+    // An IPv6 "c=" line has no TTL:
+    char ttlStr[5];
+    if (gs.groupAddress().ss_family == AF_INET6) {
+      ttlStr[0] = '\0';
+    } else {
+      sprintf(ttlStr, "/%d", ttl);
+    }
+
     char const* const sdpFmt =
-      "m=%s %d RTP/AVP %d\r\n"
-      "c=IN IP4 %s/%d\r\n"
+      "m=%s %d RTP/AVP %d%s\r\n"
+      "c=IN %s %s%s\r\n"
       "b=AS:%u\r\n"
       "%s"
       "%s"
       "%s"
       "%s"
+      "%s"
       "a=control:%s\r\n";
     unsigned sdpFmtSize = strlen(sdpFmt)
       + strlen(mediaType) + 5 /* max short len */ + 3 /* max char len */
-      + strlen(groupAddressStr.val()) + 3 /* max char len */
+      + 3 + strlen(groupAddressStr.val()) + strlen(ttlStr)
       + 20 /* max int len */
+      + strlen(fecFmt)
       + strlen(rtpmapLine)
+      + strlen(fecLines)
       + strlen(rtcpmuxLine)
       + strlen(rangeLine)
       + strlen(auxSDPLine)
@@ -109,15 +128,18 @@ PassiveServerMediaSubsession::sdpLines() {
 	    mediaType, // m= <media>
 	    portNum, // m= <port>
 	    rtpPayloadType, // m= <fmt list>
+	    fecFmt, // m= <fmt list> (continued)
+	    gs.groupAddress().ss_family == AF_INET6 ? "IP6" : "IP4", // c= <address type>
 	    groupAddressStr.val(), // c= <connection address>
-	    ttl, // c= TTL
+	    ttlStr, // c= TTL (if IPv4)
 	    estBitrate, // b=AS:<bandwidth>
 	    rtpmapLine, // a=rtpmap:... (if present)
+	    fecLines, // a=rtpmap:... for FEC packets (if present)
 	    rtcpmuxLine, // a=rtcp-mux:... (if present)
 	    rangeLine, // a=range:... (if present)
 	    auxSDPLine, // optional extra SDP line
 	    trackId()); // a=control:<track-id>
-    delete[] (char*)rangeLine; delete[] rtpmapLine;
+    delete[] (char*)rangeLine; delete[] rtpmapLine; delete[] fecLines;
 
     fSDPLines = strDup(sdpLines);
     delete[] sdpLines;
@@ -128,13 +150,13 @@ PassiveServerMediaSubsession::sdpLines() {
 
 void PassiveServerMediaSubsession
 ::getStreamParameters(unsigned clientSessionId,
-		      netAddressBits clientAddress,
+		      struct sockaddr_storage const& clientAddress,
 		      Port const& /*clientRTPPort*/,
 		      Port const& clientRTCPPort,
 		      int /*tcpSocketNum*/,
 		      unsigned char /*rtpChannelId*/,
 		      unsigned char /*rtcpChannelId*/,
-		      netAddressBits& destinationAddress,
+		      struct sockaddr_storage& destinationAddress,
 		      u_int8_t& destinationTTL,
 		      Boolean& isMulticast,
 		      Port& serverRTPPort,
@@ -143,14 +165,13 @@ void PassiveServerMediaSubsession
   isMulticast = True;
   Groupsock& gs = fRTPSink.groupsockBeingUsed();
   if (destinationTTL == 255) destinationTTL = gs.ttl();
-  if (destinationAddress == 0) { // normal case
-    destinationAddress = gs.groupAddress().s_addr;
+  if (addressIsNull(destinationAddress)) { // normal case
+    destinationAddress = gs.groupAddress();
   } else { // use the client-specified destination address instead:
-    struct in_addr destinationAddr; destinationAddr.s_addr = destinationAddress;
-    gs.changeDestinationParameters(destinationAddr, 0, destinationTTL);
+    gs.changeDestinationParameters(destinationAddress, 0, destinationTTL);
     if (fRTCPInstance != NULL) {
       Groupsock* rtcpGS = fRTCPInstance->RTCPgs();
-      rtcpGS->changeDestinationParameters(destinationAddr, 0, destinationTTL);
+      rtcpGS->changeDestinationParameters(destinationAddress, 0, destinationTTL);
     }
   }
   serverRTPPort = gs.port();
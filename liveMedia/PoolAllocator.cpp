@@ -0,0 +1,158 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A per-environment, size-class memory pool, used for small objects that get created and deleted often
+// Implementation
+
+#include "PoolAllocator.hh"
+#include "Media.hh"
+#include <stdlib.h>
+
+// Each block begins with a header.  While the block is in use, the header identifies the pool (and size class)
+// that the block belongs to.  While the block is on a free list, the header links it to the next free block.
+union PoolBlockHeader {
+  struct {
+    PoolAllocator* pool; // NULL for a block from "allocateFromHeap()"
+    unsigned sizeClass; // POOL_ALLOCATOR_NUM_SIZE_CLASSES for a large (unpooled) block
+    unsigned size; // the number of usable bytes that follow the header
+  } inUse;
+  PoolBlockHeader* nextFree;
+  long double alignment; // ensures that the usable bytes that follow the header are suitably aligned
+};
+
+static unsigned sizeClassFor(size_t size) {
+  unsigned sizeClass = 0;
+  while (sizeClass < POOL_ALLOCATOR_NUM_SIZE_CLASSES
+	 && size > ((size_t)1<<(sizeClass + POOL_ALLOCATOR_MIN_SIZE_SHIFT))) {
+    ++sizeClass;
+  }
+  return sizeClass;
+}
+
+PoolAllocator& PoolAllocator::forEnvironment(UsageEnvironment& env) {
+  _Tables* ourTables = _Tables::getOurTables(env);
+  if (ourTables->poolAllocator == NULL) {
+    ourTables->poolAllocator = new PoolAllocator(env);
+  }
+  return *ourTables->poolAllocator;
+}
+
+void* PoolAllocator::allocate(size_t size) {
+  unsigned const sizeClass = sizeClassFor(size);
+  PoolBlockHeader* block;
+  unsigned blockSize;
+
+  if (sizeClass < POOL_ALLOCATOR_NUM_SIZE_CLASSES) {
+    blockSize = 1<<(sizeClass + POOL_ALLOCATOR_MIN_SIZE_SHIFT);
+    block = fFreeBlocks[sizeClass];
+    if (block != NULL) {
+      // Common case: Reuse a free block:
+      fFreeBlocks[sizeClass] = block->nextFree;
+      --fNumFreeBlocks[sizeClass];
+      fNumBytesInFreeBlocks -= blockSize;
+      ++fNumAllocationsFromPool;
+    } else {
+      block = (PoolBlockHeader*)malloc(sizeof (PoolBlockHeader) + blockSize);
+    }
+  } else {
+    blockSize = (unsigned)size;
+    block = (PoolBlockHeader*)malloc(sizeof (PoolBlockHeader) + blockSize);
+  }
+  if (block == NULL) return NULL;
+
+  block->inUse.pool = this;
+  block->inUse.sizeClass = sizeClass;
+  block->inUse.size = blockSize;
+  ++fNumAllocations;
+  fNumBytesInUse += blockSize;
+
+  return (void*)(block + 1);
+}
+
+void* PoolAllocator::allocateFromHeap(size_t size) {
+  PoolBlockHeader* block = (PoolBlockHeader*)malloc(sizeof (PoolBlockHeader) + size);
+  if (block == NULL) return NULL;
+
+  block->inUse.pool = NULL;
+  block->inUse.sizeClass = POOL_ALLOCATOR_NUM_SIZE_CLASSES;
+  block->inUse.size = (unsigned)size;
+
+  return (void*)(block + 1);
+}
+
+void PoolAllocator::deallocate(void* ptr) {
+  if (ptr == NULL) return;
+
+  PoolBlockHeader* block = (PoolBlockHeader*)ptr - 1;
+  if (block->inUse.pool == NULL) {
+    free(block); // it came from "allocateFromHeap()"
+  } else {
+    block->inUse.pool->deallocate1(block);
+  }
+}
+
+void PoolAllocator::deallocate1(PoolBlockHeader* block) {
+  unsigned const sizeClass = block->inUse.sizeClass;
+  unsigned const blockSize = block->inUse.size;
+
+  ++fNumDeallocations;
+  fNumBytesInUse -= blockSize;
+
+  if (sizeClass < POOL_ALLOCATOR_NUM_SIZE_CLASSES
+      && (fNumFreeBlocks[sizeClass] + 1)*blockSize <= POOL_ALLOCATOR_MAX_FREE_BYTES_PER_CLASS) {
+    block->nextFree = fFreeBlocks[sizeClass];
+    fFreeBlocks[sizeClass] = block;
+    ++fNumFreeBlocks[sizeClass];
+    fNumBytesInFreeBlocks += blockSize;
+  } else {
+    free(block);
+  }
+
+  if (numBlocksInUse() == 0) {
+    // We may have been the last thing keeping our environment's "_Tables" alive.  If so, this will delete us
+    // (so we must not access any member variables after this):
+    _Tables* ourTables = _Tables::getOurTables(fEnv, False);
+    if (ourTables != NULL) ourTables->reclaimIfPossible();
+  }
+}
+
+void PoolAllocator::releaseFreeBlocks() {
+  for (unsigned i = 0; i < POOL_ALLOCATOR_NUM_SIZE_CLASSES; ++i) {
+    while (fFreeBlocks[i] != NULL) {
+      PoolBlockHeader* next = fFreeBlocks[i]->nextFree;
+      free(fFreeBlocks[i]);
+      fFreeBlocks[i] = next;
+    }
+    fNumFreeBlocks[i] = 0;
+  }
+  fNumBytesInFreeBlocks = 0;
+}
+
+PoolAllocator::PoolAllocator(UsageEnvironment& env)
+  : fEnv(env),
+    fNumAllocations(0), fNumDeallocations(0), fNumAllocationsFromPool(0),
+    fNumBytesInUse(0), fNumBytesInFreeBlocks(0) {
+  for (unsigned i = 0; i < POOL_ALLOCATOR_NUM_SIZE_CLASSES; ++i) {
+    fFreeBlocks[i] = NULL;
+    fNumFreeBlocks[i] = 0;
+  }
+}
+
+PoolAllocator::~PoolAllocator() {
+  // ASSERT: numBlocksInUse() == 0
+  releaseFreeBlocks();
+}
@@ -39,13 +39,14 @@ public:
   char const* url() const { return ((ProxyServerMediaSession*)fParentSession)->url(); }
 
 private: // redefined virtual functions
+  virtual char const* sdpLines(int addressFamily);
   virtual FramedSource* createNewStreamSource(unsigned clientSessionId,
                                               unsigned& estBitrate);
   virtual void closeStreamSource(FramedSource *inputSource);
   virtual RTPSink* createNewRTPSink(Groupsock* rtpGroupsock,
                                     unsigned char rtpPayloadTypeIfDynamic,
                                     FramedSource* inputSource);
-  virtual Groupsock* createGroupsock(struct in_addr const& addr, Port port);
+  virtual Groupsock* createGroupsock(struct sockaddr_storage const& addr, Port port);
   virtual RTCPInstance* createRTCP(Groupsock* RTCPgs, unsigned totSessionBW, /* in kbps */
 				   unsigned char const* cname, RTPSink* sink);
 
@@ -55,12 +56,15 @@ private:
 
   int verbosityLevel() const { return ((ProxyServerMediaSession*)fParentSession)->fVerbosityLevel; }
 
+  void closeBackEndSource(); // used when our "ProxyRTSPClient" goes idle
+
 private:
   friend class ProxyRTSPClient;
   MediaSubsession& fClientMediaSubsession; // the 'client' media subsession object that corresponds to this 'server' media subsession
   char const* fCodecName;  // copied from "fClientMediaSubsession" once it's been set up
   ProxyServerMediaSubsession* fNext; // used when we're part of a queue
   Boolean fHaveSetupStream;
+  unsigned short fSDPClientPortNum; // the client port number (if any) that was specified in the SDP description
 };
 
 
@@ -85,10 +89,11 @@ ProxyServerMediaSession* ProxyServerMediaSession
 	    char const* inputStreamURL, char const* streamName,
 	    char const* username, char const* password,
 	    portNumBits tunnelOverHTTPPortNum, int verbosityLevel, int socketNumToServer,
-	    MediaTranscodingTable* transcodingTable) {
+	    MediaTranscodingTable* transcodingTable, unsigned backEndIdleTimeoutSeconds) {
   return new ProxyServerMediaSession(env, ourMediaServer, inputStreamURL, streamName, username, password,
 				     tunnelOverHTTPPortNum, verbosityLevel, socketNumToServer,
-				     transcodingTable);
+				     transcodingTable, defaultCreateNewProxyRTSPClientFunc,
+				     6970, False, backEndIdleTimeoutSeconds);
 }
 
 
@@ -100,14 +105,16 @@ ProxyServerMediaSession
 			  int socketNumToServer,
 			  MediaTranscodingTable* transcodingTable,
 			  createNewProxyRTSPClientFunc* ourCreateNewProxyRTSPClientFunc,
-			  portNumBits initialPortNum, Boolean multiplexRTCPWithRTP)
+			  portNumBits initialPortNum, Boolean multiplexRTCPWithRTP,
+			  unsigned backEndIdleTimeoutSeconds)
   : ServerMediaSession(env, streamName, NULL, NULL, False, NULL),
     describeCompletedFlag(0), fOurMediaServer(ourMediaServer), fClientMediaSession(NULL),
     fVerbosityLevel(verbosityLevel),
     fPresentationTimeSessionNormalizer(new PresentationTimeSessionNormalizer(envir())),
     fCreateNewProxyRTSPClientFunc(ourCreateNewProxyRTSPClientFunc),
     fTranscodingTable(transcodingTable),
-    fInitialPortNum(initialPortNum), fMultiplexRTCPWithRTP(multiplexRTCPWithRTP) {
+    fInitialPortNum(initialPortNum), fMultiplexRTCPWithRTP(multiplexRTCPWithRTP),
+    fBackEndIdleTimeoutSeconds(socketNumToServer >= 0 ? 0 : backEndIdleTimeoutSeconds) {
   // Open a RTSP connection to the input stream, and send a "DESCRIBE" command.
   // We'll use the SDP description in the response to set ourselves up.
   fProxyRTSPClient
@@ -124,7 +131,8 @@ ProxyServerMediaSession::~ProxyServerMediaSession() {
   }
 
   // Begin by sending a "TEARDOWN" command (without checking for a response):
-  if (fProxyRTSPClient != NULL && fClientMediaSession != NULL) {
+  // (If our connection to the back-end server is idle, then there's no back-end session to tear down.)
+  if (fProxyRTSPClient != NULL && fClientMediaSession != NULL && !fProxyRTSPClient->fBackEndIsIdle) {
     fProxyRTSPClient->sendTeardownCommand(*fClientMediaSession, NULL, fProxyRTSPClient->auth());
   }
 
@@ -138,7 +146,7 @@ char const* ProxyServerMediaSession::url() const {
   return fProxyRTSPClient == NULL ? NULL : fProxyRTSPClient->url();
 }
 
-Groupsock* ProxyServerMediaSession::createGroupsock(struct in_addr const& addr, Port port) {
+Groupsock* ProxyServerMediaSession::createGroupsock(struct sockaddr_storage const& addr, Port port) {
   // Default implementation; may be redefined by subclasses:
   return new Groupsock(envir(), addr, port, 255);
 }
@@ -248,8 +256,9 @@ ProxyRTSPClient::ProxyRTSPClient(ProxyServerMediaSession& ourServerMediaSession,
 	       tunnelOverHTTPPortNum == (portNumBits)(~0) ? 0 : tunnelOverHTTPPortNum, socketNumToServer),
     fOurServerMediaSession(ourServerMediaSession), fOurURL(strDup(rtspURL)), fStreamRTPOverTCP(tunnelOverHTTPPortNum != 0),
     fSetupQueueHead(NULL), fSetupQueueTail(NULL), fNumSetupsDone(0), fNextDESCRIBEDelay(1),
-    fServerSupportsGetParameter(False), fLastCommandWasPLAY(False), fDoneDESCRIBE(False),
-    fLivenessCommandTask(NULL), fDESCRIBECommandTask(NULL), fSubsessionTimerTask(NULL), fResetTask(NULL) {
+    fServerSupportsGetParameter(False), fLastCommandWasPLAY(False), fDoneDESCRIBE(False), fBackEndIsIdle(False),
+    fLivenessCommandTask(NULL), fDESCRIBECommandTask(NULL), fSubsessionTimerTask(NULL), fResetTask(NULL),
+    fIdleTeardownTask(NULL) {
   if (username != NULL && password != NULL) {
     fOurAuthenticator = new Authenticator(username, password);
   } else {
@@ -262,12 +271,14 @@ void ProxyRTSPClient::reset() {
   envir().taskScheduler().unscheduleDelayedTask(fDESCRIBECommandTask); fDESCRIBECommandTask = NULL;
   envir().taskScheduler().unscheduleDelayedTask(fSubsessionTimerTask); fSubsessionTimerTask = NULL;
   envir().taskScheduler().unscheduleDelayedTask(fResetTask); fResetTask = NULL;
+  envir().taskScheduler().unscheduleDelayedTask(fIdleTeardownTask); fIdleTeardownTask = NULL;
 
   fSetupQueueHead = fSetupQueueTail = NULL;
   fNumSetupsDone = 0;
   fNextDESCRIBEDelay = 1;
   fLastCommandWasPLAY = False;
   fDoneDESCRIBE = False;
+  fBackEndIsIdle = False;
 
   RTSPClient::reset();
 }
@@ -282,8 +293,12 @@ ProxyRTSPClient::~ProxyRTSPClient() {
 int ProxyRTSPClient::connectToServer(int socketNum, portNumBits remotePortNum) {
   int res;
   res = RTSPClient::connectToServer(socketNum, remotePortNum);
-  
-  if (res == 0 && fDoneDESCRIBE && fStreamRTPOverTCP) {
+
+  if (res >= 0 && fBackEndIsIdle) {
+    // We're reconnecting 'on demand', after closing an idle connection.  There's no back-end session state to lose,
+    // so we don't need to reset:
+    fBackEndIsIdle = False;
+  } else if (res == 0 && fDoneDESCRIBE && fStreamRTPOverTCP) {
     if (fVerbosityLevel > 0) {
       envir() << "ProxyRTSPClient::connectToServer calling scheduleReset()\n";
     }
@@ -303,6 +318,10 @@ void ProxyRTSPClient::continueAfterDESCRIBE(char const* sdpDescription) {
     // ("OPTIONS" or "GET_PARAMETER") commands.  (The usual RTCP liveness mechanism wouldn't work here, because RTCP packets
     // don't get sent until after the "PLAY" command.)
     scheduleLivenessCommand();
+
+    // However, if we're connecting to the back-end server 'on demand', then we'll close this connection (but keep its
+    // SDP description) if no front-end client asks for the stream soon:
+    scheduleIdleTeardown();
   } else {
     // The "DESCRIBE" command failed, most likely because the server or the stream is not yet running.
     // Reschedule another "DESCRIBE" command to take place later:
@@ -481,6 +500,82 @@ void ProxyRTSPClient::sendDESCRIBE(void* clientData) {
   if (rtspClient != NULL) rtspClient->sendDescribeCommand(::continueAfterDESCRIBE, rtspClient->auth());
 }
 
+void ProxyRTSPClient::noteFrontEndDESCRIBE() {
+  if (fOurServerMediaSession.fBackEndIdleTimeoutSeconds == 0) return; // we're always connected
+
+  if (fBackEndIsIdle) {
+    // A front-end client is likely to want the stream soon.  We've already answered its "DESCRIBE" (from our cached SDP
+    // description), but reopen our connection to the back-end server now - by sending it a 'liveness' command - so that it
+    // will be ready for the "SETUP":
+    if (fVerbosityLevel > 0) {
+      envir() << *this << ": reconnecting to the back-end server, after a front-end \"DESCRIBE\"\n";
+    }
+    sendLivenessCommand(this);
+  }
+
+  // If this client doesn't go on to "SETUP" the stream, then go idle again later.  (Don't check "referenceCount()" here:
+  // "RTSPServer" holds a reference while it handles the "DESCRIBE".  "doIdleTeardown()" checks it later, and a "SETUP"
+  // unschedules us.)
+  scheduleIdleTeardown();
+}
+
+void ProxyRTSPClient::noteFrontEndSETUP() {
+  if (fOurServerMediaSession.fBackEndIdleTimeoutSeconds == 0) return; // we're always connected
+
+  envir().taskScheduler().unscheduleDelayedTask(fIdleTeardownTask); fIdleTeardownTask = NULL;
+  if (fBackEndIsIdle) {
+    // Reopen our connection to the back-end server.  (The "SETUP" that our caller is about to send will also do this,
+    // but we also need to restart our periodic 'liveness' commands.)
+    if (fVerbosityLevel > 0) {
+      envir() << *this << ": reconnecting to the back-end server, after a front-end \"SETUP\"\n";
+    }
+    sendLivenessCommand(this);
+  }
+}
+
+void ProxyRTSPClient::scheduleIdleTeardown() {
+  unsigned const idleTimeoutSeconds = fOurServerMediaSession.fBackEndIdleTimeoutSeconds;
+  if (idleTimeoutSeconds == 0 || fBackEndIsIdle) return;
+
+  envir().taskScheduler().rescheduleDelayedTask(fIdleTeardownTask, (int64_t)idleTimeoutSeconds*MILLION,
+						 doIdleTeardown, this);
+}
+
+void ProxyRTSPClient::doIdleTeardown(void* clientData) {
+  ((ProxyRTSPClient*)clientData)->doIdleTeardown();
+}
+
+void ProxyRTSPClient::doIdleTeardown() {
+  fIdleTeardownTask = NULL;
+  if (fOurServerMediaSession.referenceCount() > 0) return; // a front-end client arrived; we'll be rescheduled after it leaves
+
+  if (fVerbosityLevel > 0) {
+    envir() << *this << ": no front-end clients for " << fOurServerMediaSession.fBackEndIdleTimeoutSeconds
+	    << " seconds; closing our connection to the back-end server\n";
+  }
+
+  // Tear down the back-end session (if we had set one up), without waiting for a response:
+  MediaSession* sess = fOurServerMediaSession.fClientMediaSession;
+  if (sess != NULL && fNumSetupsDone > 0) sendTeardownCommand(*sess, NULL, fOurAuthenticator);
+
+  // Then close the connection, and forget the back-end session, but keep the base URL (from the "DESCRIBE" response),
+  // against which our cached track URLs will be resolved when we next send "SETUP":
+  char* baseURL = strDup(url());
+  reset();
+  setBaseURL(baseURL);
+  delete[] baseURL;
+  fDoneDESCRIBE = True;
+  fBackEndIsIdle = True;
+
+  // Finally, close each track's receiving sockets and data sources.  (They'll get re-created - by "initiate()" - at the next
+  // front-end "SETUP".)
+  ServerMediaSubsessionIterator iter(fOurServerMediaSession);
+  ProxyServerMediaSubsession* psmss;
+  while ((psmss = (ProxyServerMediaSubsession*)(iter.next())) != NULL) {
+    psmss->closeBackEndSource();
+  }
+}
+
 void ProxyRTSPClient::subsessionTimeout(void* clientData) {
   ((ProxyRTSPClient*)clientData)->handleSubsessionTimeout();
 }
@@ -501,7 +596,7 @@ ProxyServerMediaSubsession
   : OnDemandServerMediaSubsession(mediaSubsession.parentSession().envir(), True/*reuseFirstSource*/,
 				  initialPortNum, multiplexRTCPWithRTP),
     fClientMediaSubsession(mediaSubsession), fCodecName(strDup(mediaSubsession.codecName())),
-    fNext(NULL), fHaveSetupStream(False) {
+    fNext(NULL), fHaveSetupStream(False), fSDPClientPortNum(mediaSubsession.clientPortNum()) {
 }
 
 UsageEnvironment& operator<<(UsageEnvironment& env, const ProxyServerMediaSubsession& psmss) { // used for debugging
@@ -516,6 +611,24 @@ ProxyServerMediaSubsession::~ProxyServerMediaSubsession() {
   delete[] (char*)fCodecName;
 }
 
+char const* ProxyServerMediaSubsession::sdpLines(int addressFamily) {
+  // We're being called as a result of implementing a RTSP "DESCRIBE".  Our (cached) SDP lines don't depend upon whether we're
+  // currently connected to the back-end server, but this tells the "ProxyRTSPClient" that it's likely to be needed soon:
+  ((ProxyServerMediaSession*)fParentSession)->fProxyRTSPClient->noteFrontEndDESCRIBE();
+
+  return OnDemandServerMediaSubsession::sdpLines(addressFamily);
+}
+
+void ProxyServerMediaSubsession::closeBackEndSource() {
+  // Note: This is called only when we have no front-end clients, so there's nothing currently reading from our data source.
+  fHaveSetupStream = False;
+  fNext = NULL;
+  fClientMediaSubsession.deInitiate();
+
+  // The next "initiate()" will choose a new client port number (unless the SDP description specified one):
+  fClientMediaSubsession.setClientPortNum(fSDPClientPortNum);
+}
+
 FramedSource* ProxyServerMediaSubsession::createNewStreamSource(unsigned clientSessionId, unsigned& estBitrate) {
   ProxyServerMediaSession* const sms = (ProxyServerMediaSession*)fParentSession;
 
@@ -583,6 +696,7 @@ FramedSource* ProxyServerMediaSubsession::createNewStreamSource(unsigned clientS
   ProxyRTSPClient* const proxyRTSPClient = sms->fProxyRTSPClient;
   if (clientSessionId != 0) {
     // We're being called as a result of implementing a RTSP "SETUP".
+    proxyRTSPClient->noteFrontEndSETUP();
     if (!fHaveSetupStream) {
       // This is our first "SETUP".  Send RTSP "SETUP" and later "PLAY" commands to the proxied server, to start streaming:
       // (Before sending "SETUP", enqueue ourselves on the "RTSPClient"s 'SETUP queue', so we'll be able to get the correct
@@ -649,6 +763,9 @@ void ProxyServerMediaSubsession::closeStreamSource(FramedSource* inputSource) {
 	// Send a "PAUSE" for the whole stream.
 	proxyRTSPClient->sendPauseCommand(fClientMediaSubsession.parentSession(), NULL, proxyRTSPClient->auth());
 	proxyRTSPClient->fLastCommandWasPLAY = False;
+
+	// If we connect to the back-end server 'on demand', then we'll also close the connection if no new client arrives soon:
+	proxyRTSPClient->scheduleIdleTeardown();
       }
     }
   }
@@ -780,7 +897,7 @@ RTPSink* ProxyServerMediaSubsession
   return newSink;
 }
 
-Groupsock* ProxyServerMediaSubsession::createGroupsock(struct in_addr const& addr, Port port) {
+Groupsock* ProxyServerMediaSubsession::createGroupsock(struct sockaddr_storage const& addr, Port port) {
   ProxyServerMediaSession* parentSession = (ProxyServerMediaSession*)fParentSession;
   return parentSession->createGroupsock(addr, port);
 }
@@ -879,6 +996,8 @@ void PresentationTimeSessionNormalizer
 void PresentationTimeSessionNormalizer
 ::removePresentationTimeSubsessionNormalizer(PresentationTimeSubsessionNormalizer* ssNormalizer) {
   // Unlink "ssNormalizer" from the linked list (starting with "fSubsessionNormalizers"):
+  if (fMasterSSNormalizer == ssNormalizer) fMasterSSNormalizer = NULL;
+
   if (fSubsessionNormalizers == ssNormalizer) {
     fSubsessionNormalizers = fSubsessionNormalizers->fNext;
   } else {
@@ -34,6 +34,12 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #define H264_IDR_FRAME 0x65  //bit 8 == 0, bits 7-6 (ref) == 3, bits 5-0 (type) == 5
 
+// When generating a fragmented MP4 file, a fragment is normally ended just before a 'sync sample' in the
+// fragment 'clock' track, once the fragment has become at least "fragmentDurationMS" long.  However, a fragment
+// is also ended if any track's part of it becomes much longer (or larger) than this:
+#define MAX_FRAGMENT_DURATION_MULTIPLE 4
+#define MAX_FRAGMENT_DATA_SIZE_PER_TRACK (8*1024*1024)
+
 ////////// SubsessionIOState, ChunkDescriptor ///////////
 // A structure used to represent the I/O state of each input 'subsession':
 
@@ -126,6 +132,11 @@ public:
   Boolean isHintTrack() const { return fTrackHintedByUs != NULL; }
   Boolean hasHintTrack() const { return fHintTrackForUs != NULL; }
 
+  // Used only when generating a fragmented MP4 file:
+  Boolean isSyncSample(unsigned char const* frameSource, unsigned frameSize) const;
+  unsigned fragmentDurationMS() const;
+  void resetFragment(); // after the current fragment has been written
+
   UsageEnvironment& envir() const { return fOurSink.envir(); }
 
 public:
@@ -169,6 +180,24 @@ public:
   unsigned fNumChunks;
   SyncFrame *fHeadSyncFrame, *fTailSyncFrame;
 
+  // The samples (and their data) in the current fragment (used only when generating a fragmented MP4 file):
+  struct FragmentSample {
+    unsigned size;
+    unsigned duration; // in track time units
+    Boolean isSync;
+  };
+  FragmentSample* fFragmentSamples;
+  unsigned fNumFragmentSamples, fMaxNumFragmentSamples;
+  unsigned char* fFragmentData;
+  unsigned fFragmentDataSize, fFragmentDataMaxSize;
+  unsigned fNumFragmentSampleBytes;
+      // the number of bytes (at the start of "fFragmentData") that belong to "fFragmentSamples".  (There may be
+      // more data - for a frame whose sample has not yet been recorded.)
+  u_int64_t fFragmentDurationT; // in track time units
+  u_int64_t fBaseMediaDecodeTime; // of the current fragment, in track time units
+  Boolean fHaveBaseMediaDecodeTime;
+  struct timeval fFirstFragmentSampleTime; // used to set "fBaseMediaDecodeTime" initially
+
   // Counters to be used in the hint track's 'udta'/'hinf' atom;
   struct hinf {
     Count64 trpy;
@@ -192,15 +221,21 @@ private:
   // used by the above two routines:
   unsigned useFrame1(unsigned sourceDataSize,
 		     struct timeval presentationTime,
-		     unsigned frameDuration, int64_t destFileOffset);
+		     unsigned frameDuration, int64_t destFileOffset,
+		     Boolean isSyncSample = True);
       // returns the number of samples in this data
 
+  // Used only when generating a fragmented MP4 file:
+  void addFragmentSample(unsigned size, unsigned duration, Boolean isSync, struct timeval presentationTime);
+  void addFragmentData(unsigned char const* data, unsigned dataSize);
+
 private:
   // A structure used for temporarily storing frame state:
   struct {
     unsigned frameSize;
     struct timeval presentationTime;
     int64_t destFileOffset; // used for non-hint tracks only
+    Boolean isSyncSample; // ditto
 
     // The remaining fields are used for hint tracks only:
     unsigned startSampleNumber;
@@ -226,7 +261,8 @@ QuickTimeFileSink::QuickTimeFileSink(UsageEnvironment& env,
 				     Boolean packetLossCompensate,
 				     Boolean syncStreams,
 				     Boolean generateHintTracks,
-				     Boolean generateMP4Format)
+				     Boolean generateMP4Format,
+				     unsigned fragmentDurationMS)
   : Medium(env), fInputSession(inputSession),
     fBufferSize(bufferSize), fPacketLossCompensate(packetLossCompensate),
     fSyncStreams(syncStreams), fGenerateMP4Format(generateMP4Format),
@@ -234,11 +270,21 @@ QuickTimeFileSink::QuickTimeFileSink(UsageEnvironment& env,
     fLargestRTPtimestampFrequency(0),
     fNumSubsessions(0), fNumSyncedSubsessions(0),
     fHaveCompletedOutputFile(False),
+    fFragmentDurationMS(fragmentDurationMS), fHaveWrittenFragmentedFileHeader(False),
+    fFragmentSequenceNumber(0), fHaveFragmentEpoch(False), fFragmentClockTrack(NULL),
     fMovieWidth(movieWidth), fMovieHeight(movieHeight),
     fMovieFPS(movieFPS), fMaxTrackDurationM(0) {
   fOutFid = OpenOutputFile(env, outputFileName);
   if (fOutFid == NULL) return;
 
+  if (fFragmentDurationMS > 0) {
+    fGenerateMP4Format = True; // fragmented files are always MP4 format
+    if (generateHintTracks) {
+      envir() << "Warning: QuickTimeFileSink can't generate hint tracks in a fragmented MP4 file, so none will be generated\n";
+      generateHintTracks = False;
+    }
+  }
+
   fNewestSyncTime.tv_sec = fNewestSyncTime.tv_usec = 0;
   fFirstDataTime.tv_sec = fFirstDataTime.tv_usec = (unsigned)(~0);
 
@@ -272,6 +318,13 @@ QuickTimeFileSink::QuickTimeFileSink(UsageEnvironment& env,
     }
     subsession->miscPtr = (void*)ioState;
 
+    // The first video track (or, if there's none, the first track) determines where fragments begin:
+    if (fFragmentClockTrack == NULL
+	|| (strcmp(subsession->mediumName(), "video") == 0
+	    && strcmp(fFragmentClockTrack->fOurSubsession.mediumName(), "video") != 0)) {
+      fFragmentClockTrack = ioState;
+    }
+
     if (generateHintTracks) {
       // Also create a hint track for this track:
       SubsessionIOState* hintTrack
@@ -302,6 +355,9 @@ QuickTimeFileSink::QuickTimeFileSink(UsageEnvironment& env,
   gettimeofday(&fStartTime, NULL);
   fAppleCreationTime = fStartTime.tv_sec - 0x83da4f80;
 
+  // For a fragmented MP4 file, we write nothing until the first fragment is ready (see "writeFragment()"):
+  if (fFragmentDurationMS > 0) return;
+
   // Begin by writing a "mdat" atom at the start of the file.
   // (Later, when we've finished copying data to the file, we'll come
   // back and fill in its size.)
@@ -343,10 +399,12 @@ QuickTimeFileSink::createNew(UsageEnvironment& env,
 			     Boolean packetLossCompensate,
 			     Boolean syncStreams,
 			     Boolean generateHintTracks,
-			     Boolean generateMP4Format) {
+			     Boolean generateMP4Format,
+			     unsigned fragmentDurationMS) {
   QuickTimeFileSink* newSink = 
     new QuickTimeFileSink(env, inputSession, outputFileName, bufferSize, movieWidth, movieHeight, movieFPS,
-			  packetLossCompensate, syncStreams, generateHintTracks, generateMP4Format);
+			  packetLossCompensate, syncStreams, generateHintTracks, generateMP4Format,
+			  fragmentDurationMS);
   if (newSink == NULL || newSink->fOutFid == NULL) {
     Medium::close(newSink);
     return NULL;
@@ -481,6 +539,13 @@ static Boolean timevalGE(struct timeval const& tv1,
 void QuickTimeFileSink::completeOutputFile() {
   if (fHaveCompletedOutputFile || fOutFid == NULL) return;
 
+  if (fFragmentDurationMS > 0) {
+    // Write any remaining samples as a final fragment.  Nothing that we've already written needs to change:
+    writeFragment();
+    fHaveCompletedOutputFile = True;
+    return;
+  }
+
   // Begin by filling in the initial "mdat" atom with the current
   // file size:
   int64_t curFileSize = TellFile64(fOutFid);
@@ -527,6 +592,129 @@ void QuickTimeFileSink::completeOutputFile() {
   fHaveCompletedOutputFile = True;
 }
 
+Boolean QuickTimeFileSink::shouldStartNewFragment(SubsessionIOState& track, Boolean isSyncSample) {
+  unsigned const trackFragmentDurationMS = track.fragmentDurationMS();
+  if (&track == fFragmentClockTrack && isSyncSample && trackFragmentDurationMS >= fFragmentDurationMS) {
+    return True;
+  }
+
+  // Don't let any track's part of the fragment get too long (e.g., if sync samples are rare, or if
+  // the 'clock' track has stopped), or too large:
+  return trackFragmentDurationMS >= MAX_FRAGMENT_DURATION_MULTIPLE*fFragmentDurationMS
+    || track.fFragmentDataSize >= MAX_FRAGMENT_DATA_SIZE_PER_TRACK;
+}
+
+void QuickTimeFileSink::writeFragment() {
+  if (!fHaveWrittenFragmentedFileHeader) writeFragmentedFileHeader();
+
+  // If this is the first fragment, then the earliest sample in it defines the start of the movie:
+  MediaSubsessionIterator iter(fInputSession);
+  MediaSubsession* subsession;
+  SubsessionIOState* ioState;
+  if (!fHaveFragmentEpoch) {
+    while ((subsession = iter.next()) != NULL) {
+      ioState = (SubsessionIOState*)(subsession->miscPtr);
+      if (ioState == NULL || ioState->fNumFragmentSamples == 0) continue;
+
+      if (!fHaveFragmentEpoch || timevalGE(fFragmentEpoch, ioState->fFirstFragmentSampleTime)) {
+	fFragmentEpoch = ioState->fFirstFragmentSampleTime;
+	fHaveFragmentEpoch = True;
+      }
+    }
+    if (!fHaveFragmentEpoch) return; // there's nothing to write
+    iter.reset();
+  }
+
+  // Figure out the size of the "moof" atom, and each track's starting media time:
+  unsigned moofSize = 8 + 16; // "moof" header + "mfhd"
+  unsigned mdatDataSize = 0;
+  while ((subsession = iter.next()) != NULL) {
+    ioState = (SubsessionIOState*)(subsession->miscPtr);
+    if (ioState == NULL || ioState->fNumFragmentSamples == 0) continue;
+
+    if (!ioState->fHaveBaseMediaDecodeTime) {
+      // This is the track's first fragment.  Start its media time at the time of its first sample, so that
+      // the tracks remain in sync:
+      struct timeval const& t = ioState->fFirstFragmentSampleTime; // abbrev
+      double offset = (t.tv_sec - fFragmentEpoch.tv_sec) + (t.tv_usec - fFragmentEpoch.tv_usec)/1000000.0;
+      if (offset < 0.0) offset = 0.0;
+      ioState->fBaseMediaDecodeTime = (u_int64_t)(offset*ioState->fQTTimeScale + 0.5);
+      ioState->fHaveBaseMediaDecodeTime = True;
+    }
+
+    moofSize += 8 + 16 + 20 + 20 + 12*ioState->fNumFragmentSamples; // "traf" header + "tfhd" + "tfdt" + "trun"
+    mdatDataSize += ioState->fNumFragmentSampleBytes;
+  }
+
+  // Write the "moof" atom.  (Because we know its size in advance, we don't need to seek back to fill it in.)
+  addWord(moofSize); add4ByteString("moof");
+  addWord(16); add4ByteString("mfhd");
+  addWord(0x00000000); // Version+flags
+  addWord(++fFragmentSequenceNumber); // Sequence number
+
+  unsigned dataOffset = moofSize + 8; // the offset of each track's data, from the start of the "moof" atom
+  iter.reset();
+  while ((subsession = iter.next()) != NULL) {
+    ioState = (SubsessionIOState*)(subsession->miscPtr);
+    if (ioState == NULL || ioState->fNumFragmentSamples == 0) continue;
+
+    unsigned const numSamples = ioState->fNumFragmentSamples;
+    addWord(8 + 16 + 20 + 20 + 12*numSamples); add4ByteString("traf");
+
+    addWord(16); add4ByteString("tfhd");
+    addWord(0x00020000); // Version+flags ("default-base-is-moof")
+    addWord(ioState->fTrackID); // Track ID
+
+    addWord(20); add4ByteString("tfdt");
+    addWord(0x01000000); // Version (1)+flags
+    addWord64(ioState->fBaseMediaDecodeTime); // Base media decode time
+
+    addWord(20 + 12*numSamples); add4ByteString("trun");
+    addWord(0x00000701); // Version+flags (data offset, and sample duration, size and flags present)
+    addWord(numSamples); // Sample count
+    addWord(dataOffset); // Data offset
+    for (unsigned i = 0; i < numSamples; ++i) {
+      SubsessionIOState::FragmentSample const& sample = ioState->fFragmentSamples[i];
+      addWord(sample.duration); // Sample duration
+      addWord(sample.size); // Sample size
+      addWord(sample.isSync ? 0x02000000 : 0x01010000); // Sample flags ('depends on others'; 'is non-sync')
+    }
+
+    dataOffset += ioState->fNumFragmentSampleBytes;
+  }
+
+  // Then write the "mdat" atom - containing each track's data, in the same order:
+  addWord(8 + mdatDataSize); add4ByteString("mdat");
+  iter.reset();
+  while ((subsession = iter.next()) != NULL) {
+    ioState = (SubsessionIOState*)(subsession->miscPtr);
+    if (ioState == NULL || ioState->fNumFragmentSamples == 0) continue;
+
+    fwrite(ioState->fFragmentData, 1, ioState->fNumFragmentSampleBytes, fOutFid);
+    ioState->resetFragment();
+  }
+
+  // Make sure that the complete fragment reaches the file, so that it remains playable if we don't exit cleanly:
+  fflush(fOutFid);
+}
+
+void QuickTimeFileSink::writeFragmentedFileHeader() {
+  // The tracks' durations are unknown, so are left as 0:
+  MediaSubsessionIterator iter(fInputSession);
+  MediaSubsession* subsession;
+  while ((subsession = iter.next()) != NULL) {
+    SubsessionIOState* ioState
+      = (SubsessionIOState*)(subsession->miscPtr);
+    if (ioState == NULL) continue;
+
+    ioState->setFinalQTstate();
+  }
+
+  addAtom_ftyp();
+  addAtom_moov();
+  fHaveWrittenFragmentedFileHeader = True;
+}
+
 
 ////////// SubsessionIOState, ChunkDescriptor implementation ///////////
 
@@ -538,7 +726,10 @@ SubsessionIOState::SubsessionIOState(QuickTimeFileSink& sink,
     fOurSink(sink), fOurSubsession(subsession),
     fLastPacketRTPSeqNum(0), fHaveBeenSynced(False), fQTTotNumSamples(0), 
     fHeadChunk(NULL), fTailChunk(NULL), fNumChunks(0),
-    fHeadSyncFrame(NULL), fTailSyncFrame(NULL) {
+    fHeadSyncFrame(NULL), fTailSyncFrame(NULL),
+    fFragmentSamples(NULL), fNumFragmentSamples(0), fMaxNumFragmentSamples(0),
+    fFragmentData(NULL), fFragmentDataSize(0), fFragmentDataMaxSize(0), fNumFragmentSampleBytes(0),
+    fFragmentDurationT(0), fBaseMediaDecodeTime(0), fHaveBaseMediaDecodeTime(False) {
   fTrackID = ++fCurrentTrackNumber;
 
   fBuffer = new SubsessionBuffer(fOurSink.fBufferSize);
@@ -555,6 +746,7 @@ SubsessionIOState::SubsessionIOState(QuickTimeFileSink& sink,
 
 SubsessionIOState::~SubsessionIOState() {
   delete fBuffer; delete fPrevBuffer;
+  delete[] fFragmentSamples; delete[] fFragmentData;
 
   // Delete the list of chunk descriptors:
   ChunkDescriptor* chunk = fHeadChunk;
@@ -802,6 +994,7 @@ void SubsessionIOState::useFrame(SubsessionBuffer& buffer) {
   int64_t const destFileOffset = TellFile64(fOurSink.fOutFid);
   unsigned sampleNumberOfFrameStart = fQTTotNumSamples + 1;
   Boolean avcHack = fQTMediaDataAtomCreator == &QuickTimeFileSink::addAtom_avc1;
+  Boolean const isSync = isSyncSample(frameSource, frameSize);
 
   // If we're not syncing streams, or this subsession is not video, then
   // just give this frame a fixed duration:
@@ -811,7 +1004,7 @@ void SubsessionIOState::useFrame(SubsessionBuffer& buffer) {
     unsigned frameSizeToUse = frameSize;
     if (avcHack) frameSizeToUse += 4; // H.264/AVC gets the frame size prefix
 
-    fQTTotNumSamples += useFrame1(frameSizeToUse, presentationTime, frameDuration, destFileOffset);
+    fQTTotNumSamples += useFrame1(frameSizeToUse, presentationTime, frameDuration, destFileOffset, isSync);
   } else {
     // For synced video streams, we use the difference between successive
     // frames' presentation times as the 'frame duration'.  So, record
@@ -828,7 +1021,8 @@ void SubsessionIOState::useFrame(SubsessionBuffer& buffer) {
       if (avcHack) frameSizeToUse += 4; // H.264/AVC gets the frame size prefix
 
       unsigned numSamples
-	= useFrame1(frameSizeToUse, ppt, frameDuration, fPrevFrameState.destFileOffset);
+	= useFrame1(frameSizeToUse, ppt, frameDuration, fPrevFrameState.destFileOffset,
+		    fPrevFrameState.isSyncSample);
       fQTTotNumSamples += numSamples;
       sampleNumberOfFrameStart = fQTTotNumSamples + 1;
     }
@@ -847,12 +1041,24 @@ void SubsessionIOState::useFrame(SubsessionBuffer& buffer) {
     fPrevFrameState.frameSize = frameSize;
     fPrevFrameState.presentationTime = presentationTime;
     fPrevFrameState.destFileOffset = destFileOffset;
+    fPrevFrameState.isSyncSample = isSync;
   }
 
-  if (avcHack) fOurSink.addWord(frameSize);
+  if (fOurSink.fFragmentDurationMS > 0) {
+    // Save the data, to be written as part of a fragment:
+    if (avcHack) {
+      unsigned char const sizePrefix[4]
+	= { (unsigned char)(frameSize>>24), (unsigned char)(frameSize>>16),
+	    (unsigned char)(frameSize>>8), (unsigned char)frameSize };
+      addFragmentData(sizePrefix, 4);
+    }
+    addFragmentData(frameSource, frameSize);
+  } else {
+    if (avcHack) fOurSink.addWord(frameSize);
 
-  // Write the data into the file:
-  fwrite(frameSource, 1, frameSize, fOurSink.fOutFid);
+    // Write the data into the file:
+    fwrite(frameSource, 1, frameSize, fOurSink.fOutFid);
+  }
 
   // If we have a hint track, then write to it also (only if we have a RTP stream):
   if (hasHintTrack() && fOurSubsession.rtpSource() != NULL) {
@@ -1067,7 +1273,8 @@ void SubsessionIOState::useFrameForHinting(unsigned frameSize,
 unsigned SubsessionIOState::useFrame1(unsigned sourceDataSize,
 				      struct timeval presentationTime,
 				      unsigned frameDuration,
-				      int64_t destFileOffset) {
+				      int64_t destFileOffset,
+				      Boolean isSyncSample) {
   // Figure out the actual frame size for this data:
   unsigned frameSize = fQTBytesPerFrame;
   if (frameSize == 0) {
@@ -1077,6 +1284,14 @@ unsigned SubsessionIOState::useFrame1(unsigned sourceDataSize,
   unsigned const numFrames = sourceDataSize/frameSize;
   unsigned const numSamples = numFrames*fQTSamplesPerFrame;
 
+  if (fOurSink.fFragmentDurationMS > 0) {
+    // Record this data as a single sample in the current fragment (first ending the fragment, if it's time):
+    if (fOurSink.shouldStartNewFragment(*this, isSyncSample)) fOurSink.writeFragment();
+    addFragmentSample(sourceDataSize, numFrames*frameDuration, isSyncSample, presentationTime);
+
+    return numSamples;
+  }
+
   // Record the information about which 'chunk' this data belongs to:
   ChunkDescriptor* newTailChunk;
   if (fTailChunk == NULL) {
@@ -1097,6 +1312,72 @@ unsigned SubsessionIOState::useFrame1(unsigned sourceDataSize,
   return numSamples;
 }
 
+void SubsessionIOState::addFragmentSample(unsigned size, unsigned duration, Boolean isSync,
+					  struct timeval presentationTime) {
+  if (fNumFragmentSamples == fMaxNumFragmentSamples) {
+    // Grow our array of samples.  (It's reused for each fragment, so its size depends only on the fragment duration.)
+    fMaxNumFragmentSamples = fMaxNumFragmentSamples == 0 ? 64 : 2*fMaxNumFragmentSamples;
+    FragmentSample* newSamples = new FragmentSample[fMaxNumFragmentSamples];
+    for (unsigned i = 0; i < fNumFragmentSamples; ++i) newSamples[i] = fFragmentSamples[i];
+    delete[] fFragmentSamples; fFragmentSamples = newSamples;
+  }
+
+  if (fNumFragmentSamples == 0 && !fHaveBaseMediaDecodeTime) fFirstFragmentSampleTime = presentationTime;
+
+  FragmentSample& sample = fFragmentSamples[fNumFragmentSamples++];
+  sample.size = size;
+  sample.duration = duration;
+  sample.isSync = isSync;
+
+  fNumFragmentSampleBytes += size;
+  fFragmentDurationT += duration;
+}
+
+void SubsessionIOState::addFragmentData(unsigned char const* data, unsigned dataSize) {
+  if (fFragmentDataSize + dataSize > fFragmentDataMaxSize) {
+    // Grow our data buffer (which, like our array of samples, is reused for each fragment):
+    unsigned newMaxSize = fFragmentDataMaxSize == 0 ? fOurSink.fBufferSize : 2*fFragmentDataMaxSize;
+    if (newMaxSize < fFragmentDataSize + dataSize) newMaxSize = fFragmentDataSize + dataSize;
+    unsigned char* newData = new unsigned char[newMaxSize];
+    memcpy(newData, fFragmentData, fFragmentDataSize);
+    delete[] fFragmentData; fFragmentData = newData;
+    fFragmentDataMaxSize = newMaxSize;
+  }
+
+  memcpy(&fFragmentData[fFragmentDataSize], data, dataSize);
+  fFragmentDataSize += dataSize;
+}
+
+void SubsessionIOState::resetFragment() {
+  // Keep any data that's not yet part of a sample, for the next fragment:
+  fFragmentDataSize -= fNumFragmentSampleBytes;
+  memmove(fFragmentData, &fFragmentData[fNumFragmentSampleBytes], fFragmentDataSize);
+  fNumFragmentSampleBytes = 0;
+
+  fNumFragmentSamples = 0;
+  fBaseMediaDecodeTime += fFragmentDurationT;
+  fFragmentDurationT = 0;
+}
+
+Boolean SubsessionIOState::isSyncSample(unsigned char const* frameSource, unsigned frameSize) const {
+  if (fQTcomponentSubtype != fourChar('v','i','d','e')) return True; // all audio samples are sync samples
+
+  if (fQTMediaDataAtomCreator == &QuickTimeFileSink::addAtom_avc1 && frameSize > 0) {
+    // Each H.264 NAL unit is a separate sample.  Treat IDR frames - and the SPS and PPS NAL units that
+    // (usually) precede them - as sync samples, so that fragments can begin with them:
+    u_int8_t const nal_unit_type = frameSource[0]&0x1F;
+    return nal_unit_type == 5 || nal_unit_type == 7 || nal_unit_type == 8;
+  }
+
+  return True; // we can't tell, so assume that every sample can be decoded independently
+}
+
+unsigned SubsessionIOState::fragmentDurationMS() const {
+  if (fQTTimeScale == 0) return 0;
+
+  return (unsigned)((fFragmentDurationT*1000)/fQTTimeScale);
+}
+
 void SubsessionIOState::onSourceClosure() {
   fOurSourceIsActive = False;
   fOurSink.onSourceClosure1();
@@ -1317,10 +1598,18 @@ void QuickTimeFileSink::setWord64(int64_t filePosn, u_int64_t size) {
 }
 
 addAtom(ftyp);
-  size += add4ByteString("mp42");
-  size += addWord(0x00000000);
-  size += add4ByteString("mp42");
-  size += add4ByteString("isom");
+  if (fFragmentDurationMS > 0) {
+    size += add4ByteString("iso5");
+    size += addWord(0x00000200);
+    size += add4ByteString("iso5");
+    size += add4ByteString("iso6");
+    size += add4ByteString("mp42");
+  } else {
+    size += add4ByteString("mp42");
+    size += addWord(0x00000000);
+    size += add4ByteString("mp42");
+    size += add4ByteString("isom");
+  }
 addAtomEnd;
 
 addAtom(moov);
@@ -1363,6 +1652,30 @@ addAtom(moov);
       size += addAtom_trak();
     }
   }
+
+  if (fFragmentDurationMS > 0) {
+    // Signal that the movie's samples will follow in fragments:
+    size += addAtom_mvex();
+  }
+addAtomEnd;
+
+addAtom(mvex);
+  // Add a 'trex' atom for each track:
+  MediaSubsessionIterator iter(fInputSession);
+  MediaSubsession* subsession;
+  while ((subsession = iter.next()) != NULL) {
+    fCurrentIOState = (SubsessionIOState*)(subsession->miscPtr);
+    if (fCurrentIOState == NULL) continue;
+
+    size += addAtom_trex();
+  }
+addAtomEnd;
+
+addAtom(trex);
+  size += addWord(0x00000000); // Version+flags
+  size += addWord(fCurrentIOState->fTrackID); // Track ID
+  size += addWord(0x00000001); // Default sample description index
+  size += addZeroWords(3); // Default sample duration+size+flags (each fragment specifies these)
 addAtomEnd;
 
 addAtom(mvhd);
@@ -1653,13 +1966,21 @@ addAtomEnd;
 
 addAtom(stbl);
   size += addAtom_stsd();
-  size += addAtom_stts();
-  if (fCurrentIOState->fQTcomponentSubtype == fourChar('v','i','d','e')) {
-    size += addAtom_stss(); // only for video streams
+  if (fFragmentDurationMS > 0) {
+    // The sample tables are empty; instead, each fragment describes its own samples:
+    size += addEmptySampleTableAtom("stts");
+    size += addEmptySampleTableAtom("stsc");
+    size += addEmptySampleTableAtom("stsz");
+    size += addEmptySampleTableAtom("stco");
+  } else {
+    size += addAtom_stts();
+    if (fCurrentIOState->fQTcomponentSubtype == fourChar('v','i','d','e')) {
+      size += addAtom_stss(); // only for video streams
+    }
+    size += addAtom_stsc();
+    size += addAtom_stsz();
+    size += addAtom_co64();
   }
-  size += addAtom_stsc();
-  size += addAtom_stsz();
-  size += addAtom_co64();
 addAtomEnd;
 
 addAtom(stsd);
@@ -2174,6 +2495,14 @@ addAtom(co64); // Chunk Offset
   }
 addAtomEnd;
 
+unsigned QuickTimeFileSink::addEmptySampleTableAtom(char const* atomName) {
+  int64_t initFilePosn = TellFile64(fOutFid);
+  unsigned size = addAtomHeader(atomName);
+  size += addWord(0x00000000); // Version+flags
+  if (strcmp(atomName, "stsz") == 0) size += addWord(0x00000000); // Sample size
+  size += addWord(0x00000000); // Number of entries
+addAtomEnd;
+
 addAtom(udta);
   size += addAtom_name();
   size += addAtom_hnti();
@@ -19,6 +19,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "RTCP.hh"
+#include "RTPRateController.hh"
 #include "GroupsockHelper.hh"
 #include "rtcp_from_spec.h"
 #if defined(__WIN32__) || defined(_WIN32) || defined(_QNX4)
@@ -119,6 +120,8 @@ static double dTimeNow() {
 static unsigned const maxRTCPPacketSize = 1456;
 	// bytes (1500, minus some allowance for IP, UDP, UMTP headers)
 static unsigned const preferredRTCPPacketSize = 1000; // bytes
+static unsigned const maxIncomingRTCPPacketSize = maxRTCPPacketSize + SRTP_MAX_TRAILER_SIZE;
+	// allows for the SRTCP trailer, if SRTP is used
 
 RTCPInstance::RTCPInstance(UsageEnvironment& env, Groupsock* RTCPgs,
 			   unsigned totSessionBW,
@@ -145,20 +148,20 @@ RTCPInstance::RTCPInstance(UsageEnvironment& env, Groupsock* RTCPgs,
     fTotSessionBW = 1;
   }
 
-  if (isSSMSource) RTCPgs->multicastSendOnly(); // don't receive multicast
+  if (isSSMSource && RTCPgs != NULL) RTCPgs->multicastSendOnly(); // don't receive multicast
 
   double timeNow = dTimeNow();
   fPrevReportTime = fNextReportTime = timeNow;
 
   fKnownMembers = new RTCPMemberDatabase(*this);
-  fInBuf = new unsigned char[maxRTCPPacketSize];
-  if (fKnownMembers == NULL || fInBuf == NULL) return;
+  fInBuf = new unsigned char[maxIncomingRTCPPacketSize];
+  if (fKnownMembers == NULL) return;
   fNumBytesAlreadyRead = 0;
 
   fOutBuf = new OutPacketBuffer(preferredRTCPPacketSize, maxRTCPPacketSize, maxRTCPPacketSize);
   if (fOutBuf == NULL) return;
 
-  if (fSource != NULL && fSource->RTPgs() == RTCPgs) {
+  if (fSource != NULL && RTCPgs != NULL && fSource->RTPgs() == RTCPgs) {
     // We're receiving RTCP reports that are multiplexed with RTP, so ask the RTP source
     // to give them to us:
     fSource->registerForMultiplexedRTCPPackets(this);
@@ -188,7 +191,7 @@ RTCPInstance::~RTCPInstance() {
   fTypeOfEvent = EVENT_BYE; // not used, but...
   sendBYE();
 
-  if (fSource != NULL && fSource->RTPgs() == fRTCPInterface.gs()) {
+  if (fSource != NULL && fRTCPInterface.gs() != NULL && fSource->RTPgs() == fRTCPInterface.gs()) {
     // We were receiving RTCP reports that were multiplexed with RTP, so tell the RTP source
     // to stop giving them to us:
     fSource->deregisterForMultiplexedRTCPPackets();
@@ -210,27 +213,32 @@ RTCPInstance::~RTCPInstance() {
   delete[] fInBuf;
 }
 
-void RTCPInstance::noteArrivingRR(struct sockaddr_in const& fromAddressAndPort,
+static struct sockaddr_storage const& noAddress() {
+  static struct sockaddr_storage result; // all-zeros: family AF_UNSPEC
+  return result;
+}
+
+void RTCPInstance::noteArrivingRR(struct sockaddr_storage const& fromAddressAndPort,
 				  int tcpSocketNum, unsigned char tcpStreamChannelId) {
   // If a 'RR handler' was set, call it now:
 
   // Specific RR handler:
   if (fSpecificRRHandlerTable != NULL) {
-    netAddressBits fromAddr;
+    struct sockaddr_storage fromAddr;
     portNumBits fromPortNum;
     if (tcpSocketNum < 0) {
       // Normal case: We read the RTCP packet over UDP
-      fromAddr = fromAddressAndPort.sin_addr.s_addr;
-      fromPortNum = ntohs(fromAddressAndPort.sin_port);
+      fromAddr = fromAddressAndPort;
+      fromPortNum = ntohs(portNum(fromAddressAndPort));
     } else {
       // Special case: We read the RTCP packet over TCP (interleaved)
       // Hack: Use the TCP socket and channel id to look up the handler
-      fromAddr = tcpSocketNum;
+      setIPv4Address(fromAddr, tcpSocketNum);
       fromPortNum = tcpStreamChannelId;
     }
     Port fromPort(fromPortNum);
     RRHandlerRecord* rrHandler
-      = (RRHandlerRecord*)(fSpecificRRHandlerTable->Lookup(fromAddr, (~0), fromPort));
+      = (RRHandlerRecord*)(fSpecificRRHandlerTable->Lookup(fromAddr, noAddress(), fromPort));
     if (rrHandler != NULL) {
       if (rrHandler->rrHandlerTask != NULL) {
 	(*(rrHandler->rrHandlerTask))(rrHandler->rrHandlerClientData);
@@ -305,7 +313,7 @@ void RTCPInstance::setRRHandler(TaskFunc* handlerTask, void* clientData) {
 }
 
 void RTCPInstance
-::setSpecificRRHandler(netAddressBits fromAddress, Port fromPort,
+::setSpecificRRHandler(struct sockaddr_storage const& fromAddress, Port fromPort,
 		       TaskFunc* handlerTask, void* clientData) {
   if (handlerTask == NULL && clientData == NULL) {
     unsetSpecificRRHandler(fromAddress, fromPort);
@@ -318,23 +326,38 @@ void RTCPInstance
   if (fSpecificRRHandlerTable == NULL) {
     fSpecificRRHandlerTable = new AddressPortLookupTable;
   }
-  RRHandlerRecord* existingRecord = (RRHandlerRecord*)fSpecificRRHandlerTable->Add(fromAddress, (~0), fromPort, rrHandler);
+  RRHandlerRecord* existingRecord = (RRHandlerRecord*)fSpecificRRHandlerTable->Add(fromAddress, noAddress(), fromPort, rrHandler);
   delete existingRecord; // if any
 
 }
 
 void RTCPInstance
-::unsetSpecificRRHandler(netAddressBits fromAddress, Port fromPort) {
+::unsetSpecificRRHandler(struct sockaddr_storage const& fromAddress, Port fromPort) {
   if (fSpecificRRHandlerTable == NULL) return;
 
   RRHandlerRecord* rrHandler
-    = (RRHandlerRecord*)(fSpecificRRHandlerTable->Lookup(fromAddress, (~0), fromPort));
+    = (RRHandlerRecord*)(fSpecificRRHandlerTable->Lookup(fromAddress, noAddress(), fromPort));
   if (rrHandler != NULL) {
-    fSpecificRRHandlerTable->Remove(fromAddress, (~0), fromPort);
+    fSpecificRRHandlerTable->Remove(fromAddress, noAddress(), fromPort);
     delete rrHandler;
   }
 }
 
+void RTCPInstance
+::setSpecificRRHandler(netAddressBits fromAddress, Port fromPort,
+		       TaskFunc* handlerTask, void* clientData) {
+  struct sockaddr_storage fromAddr;
+  setIPv4Address(fromAddr, fromAddress);
+  setSpecificRRHandler(fromAddr, fromPort, handlerTask, clientData);
+}
+
+void RTCPInstance
+::unsetSpecificRRHandler(netAddressBits fromAddress, Port fromPort) {
+  struct sockaddr_storage fromAddr;
+  setIPv4Address(fromAddr, fromAddress);
+  unsetSpecificRRHandler(fromAddr, fromPort);
+}
+
 void RTCPInstance::setAppHandler(RTCPAppHandlerFunc* handlerTask, void* clientData) {
   fAppHandlerTask = handlerTask;
   fAppHandlerClientData = clientData;
@@ -391,8 +414,10 @@ void RTCPInstance::setStreamSocket(int sockNum,
 
 void RTCPInstance::addStreamSocket(int sockNum,
 				   unsigned char streamChannelId) {
-  // First, turn off background read handling for the default (UDP) socket:
-  envir().taskScheduler().turnOffBackgroundReadHandling(fRTCPInterface.gs()->socketNum());
+  // First, turn off background read handling for the default (UDP) socket (if any):
+  if (fRTCPInterface.gs() != NULL) {
+    envir().taskScheduler().turnOffBackgroundReadHandling(fRTCPInterface.gs()->socketNum());
+  }
 
   // Add the RTCP-over-TCP interface:
   fRTCPInterface.addStreamSocket(sockNum, streamChannelId);
@@ -404,7 +429,7 @@ void RTCPInstance::addStreamSocket(int sockNum,
 }
 
 void RTCPInstance
-::injectReport(u_int8_t const* packet, unsigned packetSize, struct sockaddr_in const& fromAddress) {
+::injectReport(u_int8_t const* packet, unsigned packetSize, struct sockaddr_storage const& fromAddress) {
   if (packetSize > maxRTCPPacketSize) packetSize = maxRTCPPacketSize;
   memmove(fInBuf, packet, packetSize);
 
@@ -423,20 +448,20 @@ void RTCPInstance::incomingReportHandler(RTCPInstance* instance,
 
 void RTCPInstance::incomingReportHandler1() {
   do {
-    if (fNumBytesAlreadyRead >= maxRTCPPacketSize) {
+    if (fNumBytesAlreadyRead >= maxIncomingRTCPPacketSize) {
       envir() << "RTCPInstance error: Hit limit when reading incoming packet over TCP. (fNumBytesAlreadyRead ("
-	      << fNumBytesAlreadyRead << ") >= maxRTCPPacketSize (" << maxRTCPPacketSize
+	      << fNumBytesAlreadyRead << ") >= maxIncomingRTCPPacketSize (" << maxIncomingRTCPPacketSize
 	      << ")).  The remote endpoint is using a buggy implementation of RTP/RTCP-over-TCP.  Please upgrade it!\n";
       break;
     }
 
     unsigned numBytesRead;
-    struct sockaddr_in fromAddress;
+    struct sockaddr_storage fromAddress;
     int tcpSocketNum;
     unsigned char tcpStreamChannelId;
     Boolean packetReadWasIncomplete;
     Boolean readResult
-      = fRTCPInterface.handleRead(&fInBuf[fNumBytesAlreadyRead], maxRTCPPacketSize - fNumBytesAlreadyRead,
+      = fRTCPInterface.handleRead(&fInBuf[fNumBytesAlreadyRead], maxIncomingRTCPPacketSize - fNumBytesAlreadyRead,
 				  numBytesRead, fromAddress,
 				  tcpSocketNum, tcpStreamChannelId,
 				  packetReadWasIncomplete);
@@ -451,9 +476,12 @@ void RTCPInstance::incomingReportHandler1() {
     }
     if (!readResult) break;
 
+    // If we're using SRTP, authenticate and decrypt the packet (in place):
+    if (!fRTCPInterface.unprotectIncomingPacket(fInBuf, packetSize)) break;
+
     // Ignore the packet if it was looped-back from ourself:
     Boolean packetWasFromOurHost = False;
-    if (RTCPgs()->wasLoopedBackFromUs(envir(), fromAddress)) {
+    if (RTCPgs() != NULL && RTCPgs()->wasLoopedBackFromUs(envir(), fromAddress)) {
       packetWasFromOurHost = True;
       // However, we still want to handle incoming RTCP packets from
       // *other processes* on the same machine.  To distinguish this
@@ -486,7 +514,7 @@ void RTCPInstance::incomingReportHandler1() {
       // RTCP packets that we know for sure originated elsewhere.
       // (Note, though, that if we ever re-enable the code in "Groupsock::multicastSendOnly()",
       // then we could remove the test for "!packetWasFromOurHost".)
-      fRTCPInterface.sendPacket(fInBuf, packetSize);
+      fRTCPInterface.sendPacket(fInBuf, packetSize); // (this doesn't modify "fInBuf", which we still need to process)
       fHaveJustSentPacket = True;
       fLastPacketSentSize = packetSize;
     }
@@ -496,7 +524,7 @@ void RTCPInstance::incomingReportHandler1() {
 }
 
 void RTCPInstance
-::processIncomingReport(unsigned packetSize, struct sockaddr_in const& fromAddressAndPort,
+::processIncomingReport(unsigned packetSize, struct sockaddr_storage const& fromAddressAndPort,
 			int tcpSocketNum, unsigned char tcpStreamChannelId) {
   do {
     Boolean callByeHandler = False;
@@ -507,7 +535,7 @@ void RTCPInstance
     fprintf(stderr, "[%p]saw incoming RTCP packet (from ", this);
     if (tcpSocketNum < 0) {
       // Note that "fromAddressAndPort" is valid only if we're receiving over UDP (not over TCP):
-      fprintf(stderr, "address %s, port %d", AddressString(fromAddressAndPort).val(), ntohs(fromAddressAndPort.sin_port));
+      fprintf(stderr, "address %s, port %d", AddressString(fromAddressAndPort).val(), ntohs(portNum(fromAddressAndPort)));
     } else {
       fprintf(stderr, "TCP socket #%d, stream channel id %d", tcpSocketNum, tcpStreamChannelId);
     }
@@ -523,11 +551,13 @@ void RTCPInstance
     // Check the RTCP packet for validity:
     // It must at least contain a header (4 bytes), and this header
     // must be version=2, with no padding bit, and a payload type of
-    // SR (200), RR (201), or APP (204):
+    // SR (200), RR (201), or APP (204) - or (for 'reduced-size' RTCP; RFC 5506) RTPFB (205) or PSFB (206):
     if (packetSize < 4) break;
     unsigned rtcpHdr = ntohl(*(u_int32_t*)pkt);
-    if ((rtcpHdr & 0xE0FE0000) != (0x80000000 | (RTCP_PT_SR<<16)) &&
-	(rtcpHdr & 0xE0FF0000) != (0x80000000 | (RTCP_PT_APP<<16))) {
+    u_int8_t firstPT = (rtcpHdr>>16)&0xFF;
+    if ((rtcpHdr & 0xE0000000) != 0x80000000 ||
+	(firstPT != RTCP_PT_SR && firstPT != RTCP_PT_RR && firstPT != RTCP_PT_APP &&
+	 firstPT != RTCP_PT_RTPFB && firstPT != RTCP_PT_PSFB)) {
 #ifdef DEBUG
       fprintf(stderr, "rejected bad RTCP packet: header 0x%08x\n", rtcpHdr);
 #endif
@@ -554,8 +584,16 @@ void RTCPInstance
 	// Chrome (and Opera) WebRTC receivers have a bug that causes them to always send
 	// SSRC 1 in their "RR"s.  To work around this (to help us distinguish between different
 	// receivers), we use a fake SSRC in this case consisting of the IP address, XORed with
-	// the port number:
-	reportSenderSSRC = fromAddressAndPort.sin_addr.s_addr^fromAddressAndPort.sin_port;
+	// the port number.  (For an IPv6 address, we use the XOR of its four 32-bit words.)
+	u_int32_t fromAddressBits;
+	if (fromAddressAndPort.ss_family == AF_INET6) {
+	  u_int32_t addr6Words[4];
+	  memcpy(addr6Words, &((struct sockaddr_in6 const&)fromAddressAndPort).sin6_addr, sizeof addr6Words);
+	  fromAddressBits = addr6Words[0]^addr6Words[1]^addr6Words[2]^addr6Words[3];
+	} else {
+	  fromAddressBits = ipv4Address(fromAddressAndPort);
+	}
+	reportSenderSSRC = fromAddressBits^portNum(fromAddressAndPort);
       }
 #endif
 
@@ -750,9 +788,16 @@ void RTCPInstance
 	  break;
 	}
         case RTCP_PT_RTPFB: {
+	  u_int8_t& fmt = rc; // In "RTPFB" packets, the "rc" field gets used as "FMT"
 #ifdef DEBUG
-	  fprintf(stderr, "RTPFB(unhandled)\n");
+	  fprintf(stderr, "RTPFB (FMT %d)\n", fmt);
 #endif
+	  if (fmt == 15/*'transport-wide congestion control' feedback*/ && length >= 4
+	      && fSink != NULL && fSink->rateController() != NULL) {
+	    // The 'FCI' follows the 'media source' SSRC (which we don't check, because the feedback is about all
+	    // packets that carried our transport-wide sequence numbers):
+	    fSink->rateController()->noteTransportCCFeedback(pkt + 4, length - 4);
+	  }
 	  subPacketOK = True;
 	  break;
 	}
@@ -943,7 +988,7 @@ void RTCPInstance::sendBuiltPacket() {
   fprintf(stderr, "\n");
 #endif
   unsigned reportSize = fOutBuf->curPacketSize();
-  fRTCPInterface.sendPacket(fOutBuf->packet(), reportSize);
+  fRTCPInterface.sendPacketInPlace(fOutBuf->packet(), reportSize);
   fOutBuf->resetOffset();
 
   fLastSentSize = IP_UDP_HDR_SIZE + reportSize;
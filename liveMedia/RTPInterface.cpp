@@ -23,6 +23,10 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "RTPInterface.hh"
 #include <GroupsockHelper.hh>
 #include <stdio.h>
+#include <string.h>
+#if !defined(__WIN32__) && !defined(_WIN32) && !defined(_WIN32_WCE)
+#include <sys/uio.h>
+#endif
 
 ////////// Helper Functions - Definition //////////
 
@@ -49,6 +53,15 @@ static HashTable *socketHashTable(UsageEnvironment &env, Boolean createIfNotPres
   return (HashTable *)(ourTables->socketTable);
 }
 
+// Reads from a TCP socket - using TLS, if the socket's connection uses it:
+static int readStreamSocket(UsageEnvironment &env, int socketNum, u_int8_t *buffer, unsigned bufferSize,
+                            struct sockaddr_storage &fromAddress)
+{
+  TLSState *tlsState = TLSState::lookup(env, socketNum);
+  return tlsState != NULL ? tlsState->read(buffer, bufferSize)
+                          : readSocket(env, socketNum, buffer, bufferSize, fromAddress);
+}
+
 /**
  * RTPInterface类中保存了组播地址，和tcp流的地址和通道id，然后每一个tcp套接字有多个通道，这个通道管理就是由对应的SocketDescriptor
  * 类来完成的，这个类的管理定义在Media.hh下，是一个hashTable，以套接字描述符作为key，然后这个SocketDescriptor下有一个管理对应套接字
@@ -82,13 +95,25 @@ public:
     fServerRequestAlternativeByteHandlerClientData = clientData;
   }
 
+  // Used by "RTPInterface::handleRead()" to read RTP/RTCP packet data - first from our buffer, then from the socket.
+  // Returns the number of bytes read (0 if none are available yet), or -1 on error:
+  int readPacketData(u_int8_t *to, unsigned numBytes, struct sockaddr_storage &fromAddress);
+
 private:
+  unsigned numBufferedBytes() const { return fReadBufferTail - fReadBufferHead; }
+  Boolean haveUnreadData() const; // whether we (or our socket's TLS state) have data that "select()" won't tell us about
+  int fillReadBuffer(); // returns the number of bytes read (0 if none are available yet), or -1 on error
+  void deliverBufferedRequestBytes(Boolean stopAtDollar);
+
+  static void continueReading(void *clientData);
+
 
   /**
    * 这两个函数用于处理TCP读取事件的回调函数
   */
   static void tcpReadHandler(SocketDescriptor *, int mask);
   Boolean tcpReadHandler1(int mask);
+  Boolean readNextByte(u_int8_t &c); // from our buffer, refilling it if necessary
 
 private:
   UsageEnvironment &fEnv;                                                    // UsageEnvironment对象的引用，用于提供运行环境和相关功能
@@ -108,8 +133,20 @@ private:
     AWAITING_SIZE2,
     AWAITING_PACKET_DATA
   } fTCPReadingState;   //TCP读取状态的枚举值，用于指示当前TCP读取的阶段
+
+  // Data is read from the TCP socket in large chunks, into the following buffer.  The '$' framing (and any RTSP
+  // request or response bytes) are then parsed from this buffer, rather than being read - one byte at a time - from
+  // the socket:
+  u_int8_t *fReadBuffer;
+  unsigned fReadBufferHead, fReadBufferTail; // the buffered bytes that we have not yet parsed or delivered
+  struct sockaddr_storage fFromAddress; // the source address of the buffered bytes
+  TaskToken fContinueReadingTask;
 };
 
+#ifndef TCP_READ_BUFFER_SIZE
+#define TCP_READ_BUFFER_SIZE 16384
+#endif
+
 static SocketDescriptor *lookupSocketDescriptor(UsageEnvironment &env, int sockNum, Boolean createIfNotFound = True)
 {
   HashTable *table = socketHashTable(env, createIfNotFound);
@@ -161,28 +198,36 @@ RTPInterface::RTPInterface(Medium *owner, Groupsock *gs)
       fTCPStreams(NULL),
       fNextTCPReadSize(0), fNextTCPReadStreamSocketNum(-1),
       fNextTCPReadStreamChannelId(0xFF), fReadHandlerProc(NULL),
-      fAuxReadHandlerFunc(NULL), fAuxReadHandlerClientData(NULL)
+      fAuxReadHandlerFunc(NULL), fAuxReadHandlerClientData(NULL), fSRTPContext(NULL),
+      fStagingBuffer(NULL), fStagingBufferSize(0)
 {
   // Make the socket non-blocking, even though it will be read from only asynchronously, when packets arrive.
   // The reason for this is that, in some OSs, reads on a blocking socket can (allegedly) sometimes block,
   // even if the socket was previously reported (e.g., by "select()") as having data available.
   // (This can supposedly happen if the UDP checksum fails, for example.)
-  makeSocketNonBlocking(fGS->socketNum());
-  increaseSendBufferTo(envir(), fGS->socketNum(), 50 * 1024);
+  if (fGS != NULL)
+  {
+    makeSocketNonBlocking(fGS->socketNum());
+    increaseSendBufferTo(envir(), fGS->socketNum(), 50 * 1024);
+  }
 }
 
 RTPInterface::~RTPInterface()
 {
   stopNetworkReading();
   delete fTCPStreams;
+  delete[] fStagingBuffer;
 }
 
 void RTPInterface::setStreamSocket(int sockNum,
                                    unsigned char streamChannelId)
 {
-  fGS->removeAllDestinations();
-  envir().taskScheduler().disableBackgroundHandling(fGS->socketNum()); // turn off any reading on our datagram socket
-  fGS->reset();                                                        // and close our datagram socket, because we won't be using it anymore
+  if (fGS != NULL)
+  {
+    fGS->removeAllDestinations();
+    envir().taskScheduler().disableBackgroundHandling(fGS->socketNum()); // turn off any reading on our datagram socket
+    fGS->reset();                                                        // and close our datagram socket, because we won't be using it anymore
+  }
 
   addStreamSocket(sockNum, streamChannelId);
 }
@@ -273,12 +318,52 @@ void RTPInterface::clearServerRequestAlternativeByteHandler(UsageEnvironment &en
   setServerRequestAlternativeByteHandler(env, socketNum, NULL, NULL);
 }
 
+// RTCP packet types are 192-223 (and RTP payload types that would collide with these aren't used); see RFC 5761:
+static Boolean isRTCPPacket(unsigned char const *packet, unsigned packetSize)
+{
+  return packetSize >= 2 && packet[1] >= 192 && packet[1] <= 223;
+}
+
 Boolean RTPInterface::sendPacket(unsigned char *packet, unsigned packetSize)
+{
+  if (fSRTPContext != NULL)
+  {
+    // SRTP protects the packet in place (and appends a trailer), so send a copy instead:
+    u_int8_t *packetCopy = stagingBuffer(packetSize);
+    memcpy(packetCopy, packet, packetSize);
+    return sendPacketInPlace(packetCopy, packetSize);
+  }
+
+  return sendPacket1(packet, packetSize, False);
+}
+
+Boolean RTPInterface::sendPacketInPlace(unsigned char *packet, unsigned packetSize)
+{
+  SRTPCryptographicContext *srtpContext = fSRTPContext; // alias
+  if (srtpContext == NULL)
+    return sendPacket1(packet, packetSize, True);
+
+  // Protect the packet in place.  This appends a trailer, so save the bytes that it overwrites (our caller might be
+  // using them), and restore them after sending:
+  u_int8_t savedTrailerBytes[SRTP_MAX_TRAILER_SIZE];
+  unsigned const unprotectedPacketSize = packetSize;
+  memcpy(savedTrailerBytes, &packet[unprotectedPacketSize], SRTP_MAX_TRAILER_SIZE);
+  Boolean success = isRTCPPacket(packet, unprotectedPacketSize)
+                        ? srtpContext->processOutgoingSRTCPPacket(packet, unprotectedPacketSize, packetSize)
+                        : srtpContext->processOutgoingSRTPPacket(packet, unprotectedPacketSize, packetSize);
+  if (success)
+    success = sendPacket1(packet, packetSize, True);
+
+  memcpy(&packet[unprotectedPacketSize], savedTrailerBytes, SRTP_MAX_TRAILER_SIZE);
+  return success;
+}
+
+Boolean RTPInterface::sendPacket1(unsigned char *packet, unsigned packetSize, Boolean packetHasRoom)
 {
   Boolean success = True; // we'll return False instead if any of the sends fail
 
   // Normal case: Send as a UDP packet:
-  if (!fGS->output(envir(), packet, packetSize))
+  if (fGS != NULL && !fGS->output(envir(), packet, packetSize))
     success = False;
 
   // Also, send over each of our TCP sockets:
@@ -286,7 +371,7 @@ Boolean RTPInterface::sendPacket(unsigned char *packet, unsigned packetSize)
   for (tcpStreamRecord *stream = fTCPStreams; stream != NULL; stream = nextStream)
   {
     nextStream = stream->fNext; // Set this now, in case the following deletes "stream":
-    if (!sendRTPorRTCPPacketOverTCP(packet, packetSize,
+    if (!sendRTPorRTCPPacketOverTCP(packet, packetSize, packetHasRoom,
                                     stream->fStreamSocketNum, stream->fStreamChannelId))
     {
       success = False;
@@ -296,10 +381,34 @@ Boolean RTPInterface::sendPacket(unsigned char *packet, unsigned packetSize)
   return success;
 }
 
+u_int8_t *RTPInterface::stagingBuffer(unsigned packetSize)
+{
+  unsigned const bufferSize = RTP_TCP_FRAMING_HEADER_SIZE + packetSize + SRTP_MAX_TRAILER_SIZE;
+  if (bufferSize > fStagingBufferSize)
+  {
+    delete[] fStagingBuffer;
+    fStagingBuffer = new u_int8_t[bufferSize];
+    fStagingBufferSize = bufferSize;
+  }
+
+  return &fStagingBuffer[RTP_TCP_FRAMING_HEADER_SIZE];
+}
+
+Boolean RTPInterface::unprotectIncomingPacket(unsigned char *packet, unsigned &packetSize)
+{
+  if (fSRTPContext == NULL)
+    return True; // normal case: no SRTP
+
+  return isRTCPPacket(packet, packetSize)
+             ? fSRTPContext->processIncomingSRTCPPacket(packet, packetSize, packetSize)
+             : fSRTPContext->processIncomingSRTPPacket(packet, packetSize, packetSize);
+}
+
 void RTPInterface ::startNetworkReading(TaskScheduler::BackgroundHandlerProc *handlerProc)
 {
   // Normal case: Arrange to read UDP packets:
-  envir().taskScheduler().turnOnBackgroundReadHandling(fGS->socketNum(), handlerProc, fOwner);
+  if (fGS != NULL)
+    envir().taskScheduler().turnOnBackgroundReadHandling(fGS->socketNum(), handlerProc, fOwner);
 
   // Also, receive RTP over TCP, on each of our TCP connections:
   fReadHandlerProc = handlerProc;
@@ -315,7 +424,7 @@ void RTPInterface ::startNetworkReading(TaskScheduler::BackgroundHandlerProc *ha
 }
 
 Boolean RTPInterface::handleRead(unsigned char *buffer, unsigned bufferMaxSize,
-                                 unsigned &bytesRead, struct sockaddr_in &fromAddress,
+                                 unsigned &bytesRead, struct sockaddr_storage &fromAddress,
                                  int &tcpSocketNum, unsigned char &tcpStreamChannelId,
                                  Boolean &packetReadWasIncomplete)
 {
@@ -325,7 +434,16 @@ Boolean RTPInterface::handleRead(unsigned char *buffer, unsigned bufferMaxSize,
   {
     // Normal case: read from the (datagram) 'groupsock':
     tcpSocketNum = -1;
-    readSuccess = fGS->handleRead(buffer, bufferMaxSize, bytesRead, fromAddress);
+    if (fGS != NULL)
+    {
+      readSuccess = fGS->handleRead(buffer, bufferMaxSize, bytesRead, fromAddress);
+    }
+    else
+    {
+      // We're TCP-only, so there's no datagram to read:
+      bytesRead = 0;
+      readSuccess = False;
+    }
   }
   else
   {
@@ -339,9 +457,13 @@ Boolean RTPInterface::handleRead(unsigned char *buffer, unsigned bufferMaxSize,
       totBytesToRead = bufferMaxSize;
     unsigned curBytesToRead = totBytesToRead;
     int curBytesRead;
-    while ((curBytesRead = readSocket(envir(), fNextTCPReadStreamSocketNum,
-                                      &buffer[bytesRead], curBytesToRead,
-                                      fromAddress)) > 0)
+    // The TCP socket's "SocketDescriptor" may already have read (some of) the packet data into its buffer:
+    SocketDescriptor *socketDescriptor = lookupSocketDescriptor(envir(), fNextTCPReadStreamSocketNum, False);
+    while ((curBytesRead = socketDescriptor != NULL
+                               ? socketDescriptor->readPacketData(&buffer[bytesRead], curBytesToRead, fromAddress)
+                               : readStreamSocket(envir(), fNextTCPReadStreamSocketNum,
+                                                  &buffer[bytesRead], curBytesToRead,
+                                                  fromAddress)) > 0)
     {
       bytesRead += curBytesRead;
       if (bytesRead >= totBytesToRead)
@@ -392,7 +514,14 @@ void RTPInterface::stopNetworkReading()
 
 ////////// Helper Functions - Implementation /////////
 
-Boolean RTPInterface::sendRTPorRTCPPacketOverTCP(u_int8_t *packet, unsigned packetSize,
+// Whether we can send the framing header and packet (from separate buffers) using a single "sendmsg()":
+#if defined(__WIN32__) || defined(_WIN32) || defined(_WIN32_WCE)
+#define RTPINTERFACE_CAN_GATHER_SENDS 0
+#else
+#define RTPINTERFACE_CAN_GATHER_SENDS 1
+#endif
+
+Boolean RTPInterface::sendRTPorRTCPPacketOverTCP(u_int8_t *packet, unsigned packetSize, Boolean packetHasRoom,
                                                  int socketNum, unsigned char streamChannelId)
 {
 #ifdef DEBUG_SEND
@@ -402,61 +531,114 @@ Boolean RTPInterface::sendRTPorRTCPPacketOverTCP(u_int8_t *packet, unsigned pack
 #endif
   // Send a RTP/RTCP packet over TCP, using the encoding defined in RFC 2326, section 10.12:
   //     $<streamChannelId><packetSize><packet>
-  // (If the initial "send()" of '$<streamChannelId><packetSize>' succeeds, then we force
-  // the subsequent "send()" for the <packet> data to succeed, even if we have to do so with
-  // a blocking "send()".)
-  do
-  {
-    u_int8_t framingHeader[4];
-    framingHeader[0] = '$';
-    framingHeader[1] = streamChannelId;
-    framingHeader[2] = (u_int8_t)((packetSize & 0xFF00) >> 8);
-    framingHeader[3] = (u_int8_t)(packetSize & 0xFF);
-    if (!sendDataOverTCP(socketNum, framingHeader, 4, False))
-      break;
+  // The header and packet are sent together - with a single "sendmsg()" - so that they don't end up in separate
+  // TCP segments.  With TLS, though, they must be encrypted (as a single TLS record) from one buffer, so the header is
+  // written into the room before the packet (whose contents we save, and restore afterwards), or - if the packet has
+  // no such room - into our staging buffer, along with a copy of the packet.
+  // (If the send sends anything, then we force the rest of it to succeed, even if we have to do so with a
+  // blocking send.)
+  u_int8_t framingHeader[RTP_TCP_FRAMING_HEADER_SIZE];
+  framingHeader[0] = '$';
+  framingHeader[1] = streamChannelId;
+  framingHeader[2] = (u_int8_t)((packetSize & 0xFF00) >> 8);
+  framingHeader[3] = (u_int8_t)(packetSize & 0xFF);
+
+  TLSState *tlsState = TLSState::lookup(envir(), socketNum);
+  Boolean sendSucceeded;
+  if (tlsState == NULL && RTPINTERFACE_CAN_GATHER_SENDS)
+  {
+    sendSucceeded = sendDataOverTCP(socketNum, NULL, framingHeader, RTP_TCP_FRAMING_HEADER_SIZE, packet, packetSize);
+  }
+  else
+  {
+    u_int8_t *framedPacket;
+    u_int8_t savedBytes[RTP_TCP_FRAMING_HEADER_SIZE];
+    if (packetHasRoom)
+    {
+      framedPacket = packet - RTP_TCP_FRAMING_HEADER_SIZE;
+      memcpy(savedBytes, framedPacket, RTP_TCP_FRAMING_HEADER_SIZE);
+    }
+    else
+    {
+      framedPacket = stagingBuffer(packetSize) - RTP_TCP_FRAMING_HEADER_SIZE;
+      memcpy(&framedPacket[RTP_TCP_FRAMING_HEADER_SIZE], packet, packetSize);
+    }
+    memcpy(framedPacket, framingHeader, RTP_TCP_FRAMING_HEADER_SIZE);
+    sendSucceeded = sendDataOverTCP(socketNum, tlsState, NULL, 0, framedPacket, RTP_TCP_FRAMING_HEADER_SIZE + packetSize);
+    if (packetHasRoom)
+      memcpy(framedPacket, savedBytes, RTP_TCP_FRAMING_HEADER_SIZE);
+  }
 
-    if (!sendDataOverTCP(socketNum, packet, packetSize, True))
-      break;
 #ifdef DEBUG_SEND
+  if (sendSucceeded)
     fprintf(stderr, "sendRTPorRTCPPacketOverTCP: completed\n");
-    fflush(stderr);
+  else
+    fprintf(stderr, "sendRTPorRTCPPacketOverTCP: failed! (errno %d)\n", envir().getErrno());
+  fflush(stderr);
 #endif
+  return sendSucceeded;
+}
 
-    return True;
-  } while (0);
-
-#ifdef DEBUG_SEND
-  fprintf(stderr, "sendRTPorRTCPPacketOverTCP: failed! (errno %d)\n", envir().getErrno());
-  fflush(stderr);
+// Sends (using TLS, if "tlsState" is non-NULL) "header" followed by "data", starting "offset" bytes in.
+// ("headerSize" must be 0 if "tlsState" is non-NULL, or if we can't gather sends.)
+static int sendOverTCP(int socketNum, TLSState *tlsState, u_int8_t const *header, unsigned headerSize,
+                       u_int8_t const *data, unsigned dataSize, unsigned offset)
+{
+  if (tlsState != NULL)
+    return tlsState->write(&data[offset], dataSize - offset);
+#if RTPINTERFACE_CAN_GATHER_SENDS
+  if (offset < headerSize)
+  {
+    struct iovec iov[2];
+    iov[0].iov_base = (void *)&header[offset];
+    iov[0].iov_len = headerSize - offset;
+    iov[1].iov_base = (void *)data;
+    iov[1].iov_len = dataSize;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    return sendmsg(socketNum, &msg, 0 /*flags*/);
+  }
 #endif
-  return False;
+  offset -= headerSize;
+  return send(socketNum, (char const *)(&data[offset]), dataSize - offset, 0 /*flags*/);
 }
 
 #ifndef RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS
 #define RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS 500
 #endif
 
-Boolean RTPInterface::sendDataOverTCP(int socketNum, u_int8_t const *data, unsigned dataSize, Boolean forceSendToSucceed)
+Boolean RTPInterface::sendDataOverTCP(int socketNum, TLSState *tlsState,
+                                      u_int8_t const *header, unsigned headerSize, u_int8_t const *data, unsigned dataSize)
 {
-  int sendResult = send(socketNum, (char const *)data, dataSize, 0 /*flags*/);
-  if (sendResult < (int)dataSize)
+  unsigned const totSize = headerSize + dataSize;
+  int sendResult = sendOverTCP(socketNum, tlsState, header, headerSize, data, dataSize, 0);
+  if (sendResult < (int)totSize)
   {
     // The TCP send() failed - at least partially.
 
     unsigned numBytesSentSoFar = sendResult < 0 ? 0 : (unsigned)sendResult;
-    if (numBytesSentSoFar > 0 || (forceSendToSucceed && envir().getErrno() == EAGAIN))
+    if (numBytesSentSoFar > 0 || (tlsState != NULL && sendResult == 0))
     {
       // The OS's TCP send buffer has filled up (because the stream's bitrate has exceeded
-      // the capacity of the TCP connection!).
+      // the capacity of the TCP connection!).  (With TLS, even a write that sent nothing has already encrypted - and
+      // committed to sending - the data.)
       // Force this data write to succeed, by blocking if necessary until it does:
-      unsigned numBytesRemainingToSend = dataSize - numBytesSentSoFar;
 #ifdef DEBUG_SEND
-      fprintf(stderr, "sendDataOverTCP: resending %d-byte send (blocking)\n", numBytesRemainingToSend);
+      fprintf(stderr, "sendDataOverTCP: resending %d-byte send (blocking)\n", totSize - numBytesSentSoFar);
       fflush(stderr);
 #endif
       makeSocketBlocking(socketNum, RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS);
-      sendResult = send(socketNum, (char const *)(&data[numBytesSentSoFar]), numBytesRemainingToSend, 0 /*flags*/);
-      if ((unsigned)sendResult != numBytesRemainingToSend)
+      do
+      {
+        sendResult = sendOverTCP(socketNum, tlsState, header, headerSize, data, dataSize, numBytesSentSoFar);
+        if (sendResult <= 0)
+          break;
+        numBytesSentSoFar += sendResult;
+      } while (numBytesSentSoFar < totSize);
+      if (numBytesSentSoFar < totSize)
       {
         // The blocking "send()" failed, or timed out.  In either case, we assume that the
         // TCP connection has failed (or is 'hanging' indefinitely), and we stop using it
@@ -464,7 +646,7 @@ Boolean RTPInterface::sendDataOverTCP(int socketNum, u_int8_t const *data, unsig
         // (If we kept using the socket here, the RTP or RTCP packet write would be in an
         //  incomplete, inconsistent state.)
 #ifdef DEBUG_SEND
-        fprintf(stderr, "sendDataOverTCP: blocking send() failed (delivering %d bytes out of %d); closing socket %d\n", sendResult, numBytesRemainingToSend, socketNum);
+        fprintf(stderr, "sendDataOverTCP: blocking send() failed (delivering %d bytes out of %d); closing socket %d\n", numBytesSentSoFar, totSize, socketNum);
         fflush(stderr);
 #endif
         removeStreamSocket(socketNum, 0xFF);
@@ -474,7 +656,7 @@ Boolean RTPInterface::sendDataOverTCP(int socketNum, u_int8_t const *data, unsig
 
       return True;
     }
-    else if (sendResult < 0 && envir().getErrno() != EAGAIN)
+    else if (sendResult < 0 && (tlsState != NULL || envir().getErrno() != EAGAIN))
     {
       // Because the "send()" call failed, assume that the socket is now unusable, so stop
       // using it (for both RTP and RTCP):
@@ -491,13 +673,16 @@ SocketDescriptor::SocketDescriptor(UsageEnvironment &env, int socketNum)
     : fEnv(env), fOurSocketNum(socketNum),
       fSubChannelHashTable(HashTable::create(ONE_WORD_HASH_KEYS)),
       fServerRequestAlternativeByteHandler(NULL), fServerRequestAlternativeByteHandlerClientData(NULL),
-      fReadErrorOccurred(False), fDeleteMyselfNext(False), fAreInReadHandlerLoop(False), fTCPReadingState(AWAITING_DOLLAR)
+      fReadErrorOccurred(False), fDeleteMyselfNext(False), fAreInReadHandlerLoop(False), fTCPReadingState(AWAITING_DOLLAR),
+      fReadBuffer(NULL), fReadBufferHead(0), fReadBufferTail(0), fContinueReadingTask(NULL)
 {
+  memset(&fFromAddress, 0, sizeof fFromAddress);
 }
 
 SocketDescriptor::~SocketDescriptor()
 {
   fEnv.taskScheduler().turnOffBackgroundReadHandling(fOurSocketNum);
+  fEnv.taskScheduler().unscheduleDelayedTask(fContinueReadingTask);
   removeSocketDescription(fEnv, fOurSocketNum);
 
   if (fSubChannelHashTable != NULL)
@@ -529,6 +714,14 @@ SocketDescriptor::~SocketDescriptor()
     // Hack: Pass a special character to our alternative byte handler, to tell it that either
     // - an error occurred when reading the TCP socket, or
     // - no error occurred, but it needs to take over control of the TCP socket once again.
+    // But first, if we had already read (from the socket) any RTSP bytes that follow the last packet, hand them over too,
+    // so that they don't get lost:
+    if (!fReadErrorOccurred)
+    {
+      fDeleteMyselfNext = False; // so that "deliverBufferedRequestBytes()" doesn't stop early
+      deliverBufferedRequestBytes(False);
+    }
+
     u_int8_t specialChar = fReadErrorOccurred ? 0xFF : 0xFE;
     /**
      * 0xFF：这是一种特殊的信令字符，通常用于表示发生了错误或异常情况。在上述代码中，
@@ -538,6 +731,7 @@ SocketDescriptor::~SocketDescriptor()
     */
     (*fServerRequestAlternativeByteHandler)(fServerRequestAlternativeByteHandlerClientData, specialChar);
   }
+  delete[] fReadBuffer;
 }
 
 void SocketDescriptor::registerRTPInterface(unsigned char streamChannelId,
@@ -555,6 +749,10 @@ void SocketDescriptor::registerRTPInterface(unsigned char streamChannelId,
     // Arrange to handle reads on this TCP socket:
     TaskScheduler::BackgroundHandlerProc *handler = (TaskScheduler::BackgroundHandlerProc *)&tcpReadHandler;
     fEnv.taskScheduler().setBackgroundHandling(fOurSocketNum, SOCKET_READABLE | SOCKET_EXCEPTION, handler, this);
+
+    // If the socket's TLS state has already read (and decrypted) more data, then "select()" won't tell us about it:
+    if (haveUnreadData() && fContinueReadingTask == NULL)
+      fContinueReadingTask = fEnv.taskScheduler().scheduleDelayedTask(0, continueReading, this);
   }
 }
 
@@ -595,32 +793,58 @@ void SocketDescriptor::tcpReadHandler(SocketDescriptor *socketDescriptor, int ma
   }
   socketDescriptor->fAreInReadHandlerLoop = False;
   if (socketDescriptor->fDeleteMyselfNext)
+  {
     delete socketDescriptor;
+  }
+  else if (socketDescriptor->haveUnreadData() && socketDescriptor->fContinueReadingTask == NULL)
+  {
+    // We stopped before handling all of the data that we've already read from the socket.  Because "select()" won't
+    // tell us about this data, arrange to handle it (after handling other events) ourself:
+    socketDescriptor->fContinueReadingTask
+      = socketDescriptor->fEnv.taskScheduler().scheduleDelayedTask(0, continueReading, socketDescriptor);
+  }
 }
 
-Boolean SocketDescriptor::tcpReadHandler1(int mask)
+void SocketDescriptor::continueReading(void *clientData)
 {
-  // We expect the following data over the TCP channel:
-  //   optional RTSP command or response bytes (before the first '$' character)
-  //   a '$' character
-  //   a 1-byte channel id
-  //   a 2-byte packet size (in network byte order)
-  //   the packet data.
-  // However, because the socket is being read asynchronously, this data might arrive in pieces.
+  SocketDescriptor *socketDescriptor = (SocketDescriptor *)clientData;
+  socketDescriptor->fContinueReadingTask = NULL;
+  tcpReadHandler(socketDescriptor, SOCKET_READABLE);
+}
 
-  u_int8_t c;
-  struct sockaddr_in fromAddress;
-  if (fTCPReadingState != AWAITING_PACKET_DATA)
+Boolean SocketDescriptor::haveUnreadData() const
+{
+  if (numBufferedBytes() > 0)
+    return True;
+
+  TLSState *tlsState = TLSState::lookup(fEnv, fOurSocketNum);
+  return tlsState != NULL && tlsState->hasBufferedData();
+}
+
+int SocketDescriptor::fillReadBuffer()
+{
+  if (fReadBuffer == NULL)
+    fReadBuffer = new u_int8_t[TCP_READ_BUFFER_SIZE];
+
+  int result = readStreamSocket(fEnv, fOurSocketNum, fReadBuffer, TCP_READ_BUFFER_SIZE, fFromAddress);
+  fReadBufferHead = 0;
+  fReadBufferTail = result > 0 ? (unsigned)result : 0;
+  return result;
+}
+
+Boolean SocketDescriptor::readNextByte(u_int8_t &c)
+{
+  if (numBufferedBytes() == 0)
   {
-    int result = readSocket(fEnv, fOurSocketNum, &c, 1, fromAddress);
+    int result = fillReadBuffer();
     if (result == 0)
     { // There was no more data to read
       return False;
     }
-    else if (result != 1)
+    else if (result < 0)
     { // error reading TCP socket, so we will no longer handle it
 #ifdef DEBUG_RECEIVE
-      fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): readSocket(1 byte) returned %d (error)\n", fOurSocketNum, result);
+      fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): readSocket() returned %d (error)\n", fOurSocketNum, result);
 #endif
       fReadErrorOccurred = True;
       fDeleteMyselfNext = True;
@@ -628,6 +852,73 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask)
     }
   }
 
+  c = fReadBuffer[fReadBufferHead++];
+  return True;
+}
+
+void SocketDescriptor::deliverBufferedRequestBytes(Boolean stopAtDollar)
+{
+  // Hand each buffered byte (up to the next '$', if "stopAtDollar") to our alternative byte handler (if any).
+  // We stop early if the handler causes us to be deleted (e.g., because the byte completed a "TEARDOWN" command).
+  while (fReadBufferHead < fReadBufferTail && !fDeleteMyselfNext)
+  {
+    u_int8_t c = fReadBuffer[fReadBufferHead];
+    if (c == '$' && stopAtDollar)
+      break;
+    ++fReadBufferHead;
+
+    if (fServerRequestAlternativeByteHandler != NULL && c != 0xFF && c != 0xFE)
+    {
+      // Hack: 0xFF and 0xFE are used as special signaling characters, so don't send them
+      (*fServerRequestAlternativeByteHandler)(fServerRequestAlternativeByteHandlerClientData, c);
+    }
+  }
+}
+
+int SocketDescriptor::readPacketData(u_int8_t *to, unsigned numBytes, struct sockaddr_storage &fromAddress)
+{
+  if (numBufferedBytes() == 0)
+  {
+    if (numBytes >= TCP_READ_BUFFER_SIZE)
+    {
+      // Read large amounts of data directly, rather than copying it through our buffer:
+      return readStreamSocket(fEnv, fOurSocketNum, to, numBytes, fromAddress);
+    }
+
+    // Otherwise, refill our buffer.  (This will usually also read the framing header of the next packet(s).)
+    int result = fillReadBuffer();
+    if (result <= 0)
+      return result;
+  }
+
+  unsigned numBytesToCopy = numBufferedBytes();
+  if (numBytesToCopy > numBytes)
+    numBytesToCopy = numBytes;
+  memmove(to, &fReadBuffer[fReadBufferHead], numBytesToCopy);
+  fReadBufferHead += numBytesToCopy;
+  fromAddress = fFromAddress;
+
+  return (int)numBytesToCopy;
+}
+
+Boolean SocketDescriptor::tcpReadHandler1(int mask)
+{
+  // We expect the following data over the TCP channel:
+  //   optional RTSP command or response bytes (before the first '$' character)
+  //   a '$' character
+  //   a 1-byte channel id
+  //   a 2-byte packet size (in network byte order)
+  //   the packet data.
+  // However, because the socket is being read asynchronously, this data might arrive in pieces.
+  // (Everything except large packet data is read into - and parsed from - "fReadBuffer".)
+
+  u_int8_t c;
+  if (fTCPReadingState != AWAITING_PACKET_DATA)
+  {
+    if (!readNextByte(c))
+      return False;
+  }
+
   Boolean callAgain = True;
   switch (fTCPReadingState)
   {
@@ -659,6 +950,8 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask)
         // Hack: 0xFF and 0xFE are used as special signaling characters, so don't send them
         (*fServerRequestAlternativeByteHandler)(fServerRequestAlternativeByteHandlerClientData, c);
       }
+      // Also handle any following RTSP bytes that we've already buffered (up to the next '$'), all at once:
+      deliverBufferedRequestBytes(True);
     }
     break;
   }
@@ -729,25 +1022,28 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask)
 #ifdef DEBUG_RECEIVE
         fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): No handler proc for \"rtpInterface\" for channel %d; need to skip %d remaining bytes\n", fOurSocketNum, fStreamChannelId, rtpInterface->fNextTCPReadSize);
 #endif
-        int result = readSocket(fEnv, fOurSocketNum, &c, 1, fromAddress);
-        if (result < 0)
-        { // error reading TCP socket, so we will no longer handle it
+        fTCPReadingState = AWAITING_PACKET_DATA;
+        if (numBufferedBytes() == 0)
+        {
+          int result = fillReadBuffer();
+          if (result < 0)
+          { // error reading TCP socket, so we will no longer handle it
 #ifdef DEBUG_RECEIVE
-          fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): readSocket(1 byte) returned %d (error)\n", fOurSocketNum, result);
+            fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): readSocket() returned %d (error)\n", fOurSocketNum, result);
 #endif
-          fReadErrorOccurred = True;
-          fDeleteMyselfNext = True;
-          return False;
-        }
-        else
-        {
-          fTCPReadingState = AWAITING_PACKET_DATA;
-          if (result == 1)
-          {
-            --rtpInterface->fNextTCPReadSize;
-            callAgain = True;
+            fReadErrorOccurred = True;
+            fDeleteMyselfNext = True;
+            return False;
           }
         }
+
+        // Skip over as much of the packet data as we have:
+        unsigned numBytesToSkip = numBufferedBytes();
+        if (numBytesToSkip > rtpInterface->fNextTCPReadSize)
+          numBytesToSkip = rtpInterface->fNextTCPReadSize;
+        fReadBufferHead += numBytesToSkip;
+        rtpInterface->fNextTCPReadSize -= numBytesToSkip;
+        callAgain = numBytesToSkip > 0;
       }
     }
 #ifdef DEBUG_RECEIVE
@@ -757,6 +1053,11 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask)
   }
   }
 
+  // If we've already buffered more data (e.g., the next packet), then we need to keep going, because "select()"
+  // won't tell us about it:
+  if (fTCPReadingState != AWAITING_PACKET_DATA && numBufferedBytes() > 0)
+    callAgain = True;
+
   return callAgain;
 }
 
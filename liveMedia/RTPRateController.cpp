@@ -0,0 +1,419 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// Congestion control for a "RTPSink"
+// Implementation
+
+#include "RTPRateController.hh"
+#include "GroupsockHelper.hh"
+#include <math.h>
+
+// The number of sent packets that we remember, for matching with 'transport-wide congestion control' feedback.
+// (This must divide 65536.)
+#define SENT_PACKETS_HISTORY_SIZE 4096
+
+// Packets that are sent within this time of the first packet of a 'packet group' belong to the same group:
+#define PACKET_GROUP_DURATION_USECS 5000
+
+// RTCP "RR"s that are older than this are ignored:
+#define MAX_RR_AGE_USECS 10000000
+
+enum { BW_NORMAL, BW_UNDERUSING, BW_OVERUSING }; // signals from the over-use detector
+
+static int64_t timeNowUSecs() {
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  return (int64_t)timeNow.tv_sec*1000000 + timeNow.tv_usec;
+}
+
+RTPRateController* RTPRateController
+::createNew(UsageEnvironment& env, RTPSink* sink,
+	    unsigned minBitrate, unsigned startBitrate, unsigned maxBitrate, u_int8_t transportCCExtensionId) {
+  if (sink == NULL) {
+    env.setResultMsg("RTPRateController::createNew(): no sink");
+    return NULL;
+  }
+  if (maxBitrate == 0) {
+    env.setResultMsg("RTPRateController::createNew(): \"maxBitrate\" must be nonzero");
+    return NULL;
+  }
+  if (transportCCExtensionId > 14) {
+    env.setResultMsg("RTPRateController::createNew(): \"transportCCExtensionId\" must be in the range [1,14]");
+    return NULL;
+  }
+
+  return new RTPRateController(env, sink, minBitrate, startBitrate, maxBitrate, transportCCExtensionId);
+}
+
+RTPRateController::RTPRateController(UsageEnvironment& env, RTPSink* sink,
+				     unsigned minBitrate, unsigned startBitrate, unsigned maxBitrate,
+				     u_int8_t transportCCExtensionId)
+  : Medium(env), fSink(sink),
+    fMinBitrate(minBitrate == 0 ? 1 : minBitrate), fMaxBitrate(maxBitrate < fMinBitrate ? fMinBitrate : maxBitrate),
+    fLossBasedBitrate(0), fDelayBasedBitrate(0), fTargetBitrate(0), fLastNotifiedBitrate(0),
+    fLastLossBasedUpdateTime(0), fRTTMSecs(0), fMinRTTMSecs(0),
+    fBytesSentSinceLastReport(0), fLastReportTime(0), fSendingBitrate(0),
+    fTransportCCExtensionId(transportCCExtensionId), fSentPackets(NULL),
+    fGroupFirstSendTime(0), fGroupLastSendTime(0), fGroupLastArrivalTime(0),
+    fPrevGroupLastSendTime(0), fPrevGroupLastArrivalTime(0), fHaveGroup(False), fHavePrevGroup(False),
+    fAccumulatedDelay(0.0), fSmoothedDelay(0.0), fFirstArrivalTimeMSecs(0.0),
+    fTrendlineNumSamples(0), fNumDeltas(0),
+    fPrevTrend(0.0), fThreshold(12.5), fTimeOverUsing(-1.0), fOverUseCounter(0), fLastThresholdUpdateMSecs(0.0),
+    fBandwidthUsage(BW_NORMAL),
+    fArrivedBytes(0), fArrivedBytesStartTime(0), fHaveArrivedBytesStartTime(False), fArrivalBitrate(0.0),
+    fLastDelayBasedUpdateTime(0), fLastDelayBasedDecreaseTime(0),
+    fNumPacketsReceivedSinceLossUpdate(0), fNumPacketsLostSinceLossUpdate(0) {
+  if (startBitrate < fMinBitrate) startBitrate = fMinBitrate;
+  if (startBitrate > fMaxBitrate) startBitrate = fMaxBitrate;
+  fLossBasedBitrateD = fDelayBasedBitrateD = startBitrate;
+  fLossBasedBitrate = fTargetBitrate = startBitrate;
+
+  if (fTransportCCExtensionId != 0) {
+    fSentPackets = new SentPacket[SENT_PACKETS_HISTORY_SIZE];
+    for (unsigned i = 0; i < SENT_PACKETS_HISTORY_SIZE; ++i) fSentPackets[i].sendTime = -1;
+  }
+
+  // Attach ourself to the sink (replacing any existing controller):
+  Medium::close(fSink->fRateController);
+  fSink->fRateController = this;
+  fSink->fTransportCCExtensionId = fTransportCCExtensionId;
+}
+
+RTPRateController::~RTPRateController() {
+  if (fSink != NULL && fSink->fRateController == this) {
+    fSink->fRateController = NULL;
+    fSink->fTransportCCExtensionId = 0;
+  }
+  delete[] fSentPackets;
+}
+
+void RTPRateController::notePacketSent(u_int16_t transportSeqNum, unsigned packetSize, int64_t sendTimeUSecs) {
+  if (fLastReportTime == 0) fLastReportTime = sendTimeUSecs;
+  fBytesSentSinceLastReport += packetSize;
+
+  if (fSentPackets != NULL) {
+    SentPacket& sentPacket = fSentPackets[transportSeqNum%SENT_PACKETS_HISTORY_SIZE];
+    sentPacket.seqNum = transportSeqNum;
+    sentPacket.size = packetSize > 0xFFFF ? 0xFFFF : packetSize;
+    sentPacket.sendTime = sendTimeUSecs;
+  }
+
+  // Make sure that our source learns the (initial) target bitrate, once it's streaming:
+  if (fLastNotifiedBitrate == 0) updateTargetBitrate();
+}
+
+void RTPRateController::noteReceiverReport() {
+  int64_t timeNow = timeNowUSecs();
+
+  // Find the worst loss, and the longest round-trip time, reported (recently) by any of our receivers:
+  unsigned maxLossRatio = 0; // as an 8-bit fixed-point fraction
+  unsigned maxRTTMSecs = 0;
+  Boolean haveRTT = False;
+  RTPTransmissionStatsDB::Iterator iter(fSink->transmissionStatsDB());
+  RTPTransmissionStats* stats;
+  while ((stats = iter.next()) != NULL) {
+    struct timeval const& timeReceived = stats->lastTimeReceived();
+    if (timeNow - ((int64_t)timeReceived.tv_sec*1000000 + timeReceived.tv_usec) > MAX_RR_AGE_USECS) continue;
+
+    if (stats->packetLossRatio() > maxLossRatio) maxLossRatio = stats->packetLossRatio();
+    if (stats->lastSRTime() != 0) {
+      unsigned rttMSecs = (unsigned)((stats->roundTripDelay()*1000.0)/65536);
+      if (rttMSecs > maxRTTMSecs) maxRTTMSecs = rttMSecs;
+      haveRTT = True;
+    }
+  }
+  if (haveRTT) {
+    fRTTMSecs = maxRTTMSecs;
+    if (fMinRTTMSecs == 0 || fRTTMSecs < fMinRTTMSecs) fMinRTTMSecs = fRTTMSecs;
+  }
+
+  updateLossBasedBitrate(maxLossRatio/256.0, timeNow);
+  updateTargetBitrate();
+}
+
+void RTPRateController::updateLossBasedBitrate(double lossFraction, int64_t timeNow) {
+  // Update our estimate of the bitrate that we're actually sending:
+  if (fLastReportTime != 0 && timeNow - fLastReportTime >= 500000) {
+    fSendingBitrate = (unsigned)((fBytesSentSinceLastReport*8000.0)/(timeNow - fLastReportTime));
+    fBytesSentSinceLastReport = 0;
+    fLastReportTime = timeNow;
+  }
+
+  double secondsSinceLastUpdate
+    = fLastLossBasedUpdateTime == 0 ? 1.0 : (timeNow - fLastLossBasedUpdateTime)/1000000.0;
+  fLastLossBasedUpdateTime = timeNow;
+  double newBitrate = fLossBasedBitrateD;
+  if (lossFraction > 0.10) {
+    newBitrate *= 1.0 - 0.5*lossFraction;
+  } else if (lossFraction < 0.02) {
+    // Increase (by 8% per second), unless the round-trip time has grown enough to show that a queue is building up:
+    Boolean queueIsBuilding = fRTTMSecs > 0 && fRTTMSecs > fMinRTTMSecs + 100;
+    if (!queueIsBuilding) {
+      if (secondsSinceLastUpdate > 5.0) secondsSinceLastUpdate = 5.0;
+      newBitrate *= 1.0 + 0.08*secondsSinceLastUpdate;
+
+      // If our source isn't using all of its target bitrate, don't let the estimate run far ahead of it:
+      if (fSendingBitrate > 0) {
+	double maxBitrate = 1.5*fSendingBitrate + 10;
+	if (maxBitrate < fLossBasedBitrateD) maxBitrate = fLossBasedBitrateD;
+	if (newBitrate > maxBitrate) newBitrate = maxBitrate;
+      }
+    }
+  } // otherwise, keep the same estimate
+  if (newBitrate < fMinBitrate) newBitrate = fMinBitrate;
+  if (newBitrate > fMaxBitrate) newBitrate = fMaxBitrate;
+  fLossBasedBitrateD = newBitrate;
+  fLossBasedBitrate = (unsigned)newBitrate;
+}
+
+void RTPRateController::noteTransportCCFeedback(u_int8_t const* fci, unsigned fciSize) {
+  // The format of the feedback is described in draft-holmer-rmcat-transport-wide-cc-extensions-01, section 3.1
+  if (fSentPackets == NULL || fciSize < 8) return;
+
+  u_int16_t baseSeqNum = (fci[0]<<8)|fci[1];
+  unsigned packetStatusCount = (fci[2]<<8)|fci[3];
+  int32_t referenceTime = (fci[4]<<16)|(fci[5]<<8)|fci[6]; // a signed 24-bit number, in units of 64 ms
+  if (referenceTime&0x800000) referenceTime -= 0x1000000;
+  unsigned offset = 8;
+
+  // First, get the status of each packet from the 'packet chunks':
+  u_int8_t* statuses = new u_int8_t[packetStatusCount];
+  unsigned numStatuses = 0;
+  while (numStatuses < packetStatusCount) {
+    if (offset + 2 > fciSize) break;
+    u_int16_t chunk = (fci[offset]<<8)|fci[offset+1];
+    offset += 2;
+
+    if ((chunk&0x8000) == 0) { // a 'run length' chunk
+      u_int8_t status = (chunk>>13)&0x3;
+      unsigned runLength = chunk&0x1FFF;
+      while (runLength-- > 0 && numStatuses < packetStatusCount) statuses[numStatuses++] = status;
+    } else if ((chunk&0x4000) == 0) { // a 'status vector' chunk, with 14 1-bit symbols
+      for (int i = 13; i >= 0 && numStatuses < packetStatusCount; --i) statuses[numStatuses++] = (chunk>>i)&0x1;
+    } else { // a 'status vector' chunk, with 7 2-bit symbols
+      for (int i = 12; i >= 0 && numStatuses < packetStatusCount; i -= 2) statuses[numStatuses++] = (chunk>>i)&0x3;
+    }
+  }
+
+  // Then, get the arrival time of each received packet from the 'receive deltas' (in units of 250 us):
+  int64_t arrivalTime = (int64_t)referenceTime*64000;
+  for (unsigned i = 0; i < numStatuses; ++i) {
+    if (statuses[i] == 1) { // 'packet received, small delta'
+      if (offset + 1 > fciSize) break;
+      arrivalTime += fci[offset]*250;
+      offset += 1;
+    } else if (statuses[i] == 2) { // 'packet received, large or negative delta'
+      if (offset + 2 > fciSize) break;
+      arrivalTime += (int16_t)((fci[offset]<<8)|fci[offset+1])*250;
+      offset += 2;
+    } else { // 'packet not received' (or reserved)
+      ++fNumPacketsLostSinceLossUpdate;
+      continue;
+    }
+    ++fNumPacketsReceivedSinceLossUpdate;
+
+    u_int16_t seqNum = (u_int16_t)(baseSeqNum + i);
+    SentPacket& sentPacket = fSentPackets[seqNum%SENT_PACKETS_HISTORY_SIZE];
+    if (sentPacket.seqNum == seqNum && sentPacket.sendTime >= 0) {
+      processArrivedPacket(sentPacket.sendTime, arrivalTime, sentPacket.size);
+      sentPacket.sendTime = -1; // so that we don't process it again, if the feedback is repeated
+    }
+  }
+  delete[] statuses;
+
+  int64_t timeNow = timeNowUSecs();
+  updateDelayBasedBitrate(fBandwidthUsage, timeNow);
+
+  // The feedback also tells us about loss, so - about once per second - update the loss-based estimate from it:
+  if (timeNow - fLastLossBasedUpdateTime >= 1000000) {
+    unsigned numPackets = fNumPacketsReceivedSinceLossUpdate + fNumPacketsLostSinceLossUpdate;
+    if (numPackets > 0) updateLossBasedBitrate((double)fNumPacketsLostSinceLossUpdate/numPackets, timeNow);
+    fNumPacketsReceivedSinceLossUpdate = fNumPacketsLostSinceLossUpdate = 0;
+  }
+  updateTargetBitrate();
+}
+
+void RTPRateController::processArrivedPacket(int64_t sendTimeUSecs, int64_t arrivalTimeUSecs, unsigned packetSize) {
+  // Update our estimate of the rate at which packets are arriving:
+  if (!fHaveArrivedBytesStartTime) {
+    fArrivedBytesStartTime = arrivalTimeUSecs;
+    fHaveArrivedBytesStartTime = True;
+  }
+  fArrivedBytes += packetSize;
+  if (arrivalTimeUSecs - fArrivedBytesStartTime >= 500000) {
+    double bitrate = (fArrivedBytes*8000.0)/(arrivalTimeUSecs - fArrivedBytesStartTime); // kbps
+    fArrivalBitrate = fArrivalBitrate == 0.0 ? bitrate : (fArrivalBitrate + bitrate)/2;
+    fArrivedBytes = 0;
+    fArrivedBytesStartTime = arrivalTimeUSecs;
+  }
+
+  // Group packets into 'packet groups' (bursts), and measure the change in one-way delay from each group to the next:
+  if (!fHaveGroup) {
+    fGroupFirstSendTime = fGroupLastSendTime = sendTimeUSecs;
+    fGroupLastArrivalTime = arrivalTimeUSecs;
+    fHaveGroup = True;
+    return;
+  }
+  if (sendTimeUSecs < fGroupFirstSendTime) return; // this packet was sent before the current group; ignore it
+
+  if (sendTimeUSecs - fGroupFirstSendTime <= PACKET_GROUP_DURATION_USECS) {
+    // This packet belongs to the current group:
+    if (sendTimeUSecs > fGroupLastSendTime) fGroupLastSendTime = sendTimeUSecs;
+    if (arrivalTimeUSecs > fGroupLastArrivalTime) fGroupLastArrivalTime = arrivalTimeUSecs;
+    return;
+  }
+
+  // This packet begins a new group, so the current group is complete:
+  if (fHavePrevGroup) {
+    double interDepartureMSecs = (fGroupLastSendTime - fPrevGroupLastSendTime)/1000.0;
+    double interArrivalMSecs = (fGroupLastArrivalTime - fPrevGroupLastArrivalTime)/1000.0;
+    noteDelayGradient(interArrivalMSecs - interDepartureMSecs, fGroupLastArrivalTime/1000.0, interDepartureMSecs);
+  }
+  fPrevGroupLastSendTime = fGroupLastSendTime;
+  fPrevGroupLastArrivalTime = fGroupLastArrivalTime;
+  fHavePrevGroup = True;
+
+  fGroupFirstSendTime = fGroupLastSendTime = sendTimeUSecs;
+  fGroupLastArrivalTime = arrivalTimeUSecs;
+}
+
+void RTPRateController::noteDelayGradient(double deltaMSecs, double arrivalTimeMSecs, double interDepartureMSecs) {
+  if (fNumDeltas < 1000) ++fNumDeltas;
+  if (fNumDeltas == 1) fFirstArrivalTimeMSecs = fLastThresholdUpdateMSecs = arrivalTimeMSecs;
+
+  // The 'trendline' filter: Fit a line to the (smoothed) accumulated delay, over the last few groups:
+  fAccumulatedDelay += deltaMSecs;
+  fSmoothedDelay = 0.9*fSmoothedDelay + 0.1*fAccumulatedDelay;
+  if (fTrendlineNumSamples == TRENDLINE_WINDOW_SIZE) {
+    for (unsigned i = 1; i < TRENDLINE_WINDOW_SIZE; ++i) {
+      fTrendlineX[i-1] = fTrendlineX[i];
+      fTrendlineY[i-1] = fTrendlineY[i];
+    }
+  } else {
+    ++fTrendlineNumSamples;
+  }
+  fTrendlineX[fTrendlineNumSamples-1] = arrivalTimeMSecs - fFirstArrivalTimeMSecs;
+  fTrendlineY[fTrendlineNumSamples-1] = fSmoothedDelay;
+
+  double trend = fPrevTrend;
+  if (fTrendlineNumSamples == TRENDLINE_WINDOW_SIZE) {
+    double xAvg = 0.0, yAvg = 0.0;
+    for (unsigned i = 0; i < TRENDLINE_WINDOW_SIZE; ++i) { xAvg += fTrendlineX[i]; yAvg += fTrendlineY[i]; }
+    xAvg /= TRENDLINE_WINDOW_SIZE; yAvg /= TRENDLINE_WINDOW_SIZE;
+    double numerator = 0.0, denominator = 0.0;
+    for (unsigned i = 0; i < TRENDLINE_WINDOW_SIZE; ++i) {
+      numerator += (fTrendlineX[i] - xAvg)*(fTrendlineY[i] - yAvg);
+      denominator += (fTrendlineX[i] - xAvg)*(fTrendlineX[i] - xAvg);
+    }
+    if (denominator != 0.0) trend = numerator/denominator;
+  }
+
+  // The over-use detector: Compare the (scaled) trend against an adaptive threshold:
+  double modifiedTrend = (fNumDeltas < 60 ? fNumDeltas : 60)*trend*4.0;
+  if (modifiedTrend > fThreshold) {
+    if (fTimeOverUsing < 0.0) {
+      fTimeOverUsing = interDepartureMSecs/2;
+    } else {
+      fTimeOverUsing += interDepartureMSecs;
+    }
+    ++fOverUseCounter;
+    if (fTimeOverUsing > 10.0 && fOverUseCounter > 1 && trend >= fPrevTrend) {
+      fTimeOverUsing = 0.0;
+      fOverUseCounter = 0;
+      fBandwidthUsage = BW_OVERUSING;
+    }
+  } else if (modifiedTrend < -fThreshold) {
+    fTimeOverUsing = -1.0;
+    fOverUseCounter = 0;
+    fBandwidthUsage = BW_UNDERUSING;
+  } else {
+    fTimeOverUsing = -1.0;
+    fOverUseCounter = 0;
+    fBandwidthUsage = BW_NORMAL;
+  }
+  fPrevTrend = trend;
+
+  // Adapt the threshold, so that we compete fairly with other (e.g., loss-based) flows:
+  double absModifiedTrend = fabs(modifiedTrend);
+  if (absModifiedTrend <= fThreshold + 15.0) {
+    double k = absModifiedTrend < fThreshold ? 0.039 : 0.0087;
+    double timeDeltaMSecs = arrivalTimeMSecs - fLastThresholdUpdateMSecs;
+    if (timeDeltaMSecs > 100.0) timeDeltaMSecs = 100.0;
+    fThreshold += k*(absModifiedTrend - fThreshold)*timeDeltaMSecs;
+    if (fThreshold < 6.0) fThreshold = 6.0;
+    if (fThreshold > 600.0) fThreshold = 600.0;
+  }
+  fLastThresholdUpdateMSecs = arrivalTimeMSecs;
+}
+
+void RTPRateController::updateDelayBasedBitrate(int bandwidthUsage, int64_t timeNow) {
+  double secondsSinceLastUpdate
+    = fLastDelayBasedUpdateTime == 0 ? 0.0 : (timeNow - fLastDelayBasedUpdateTime)/1000000.0;
+  if (secondsSinceLastUpdate > 1.0) secondsSinceLastUpdate = 1.0;
+  fLastDelayBasedUpdateTime = timeNow;
+
+  double newBitrate = fDelayBasedBitrateD;
+  switch (bandwidthUsage) {
+    case BW_OVERUSING: {
+      // Decrease to a little less than the rate at which packets are actually getting through - but no more than
+      // once per round-trip time, to give the decrease time to take effect:
+      int64_t minTimeBetweenDecreases = (fRTTMSecs > 0 ? fRTTMSecs : 300)*1000;
+      if (timeNow - fLastDelayBasedDecreaseTime >= minTimeBetweenDecreases) {
+	double decreasedBitrate = 0.85*(fArrivalBitrate > 0.0 ? fArrivalBitrate : fDelayBasedBitrateD);
+	if (decreasedBitrate < newBitrate) newBitrate = decreasedBitrate;
+	fLastDelayBasedDecreaseTime = timeNow;
+      }
+      break;
+    }
+    case BW_UNDERUSING: {
+      // Queues are draining; keep the same rate until they're empty
+      break;
+    }
+    default: {
+      // Increase (by 8% per second), but not far beyond the rate at which packets are getting through:
+      newBitrate *= pow(1.08, secondsSinceLastUpdate);
+      if (fArrivalBitrate > 0.0) {
+	double maxBitrate = 1.5*fArrivalBitrate + 10;
+	if (maxBitrate < fDelayBasedBitrateD) maxBitrate = fDelayBasedBitrateD;
+	if (newBitrate > maxBitrate) newBitrate = maxBitrate;
+      }
+      break;
+    }
+  }
+  if (newBitrate < fMinBitrate) newBitrate = fMinBitrate;
+  if (newBitrate > fMaxBitrate) newBitrate = fMaxBitrate;
+  fDelayBasedBitrateD = newBitrate;
+  fDelayBasedBitrate = (unsigned)newBitrate;
+}
+
+void RTPRateController::updateTargetBitrate() {
+  unsigned targetBitrate = fLossBasedBitrate;
+  if (fDelayBasedBitrate > 0 && fDelayBasedBitrate < targetBitrate) targetBitrate = fDelayBasedBitrate;
+  if (targetBitrate < fMinBitrate) targetBitrate = fMinBitrate;
+  if (targetBitrate > fMaxBitrate) targetBitrate = fMaxBitrate;
+  fTargetBitrate = targetBitrate;
+
+  // Tell our sink's source, if the target has changed significantly (by 5% or more) since we last did:
+  FramedSource* source = fSink->source();
+  if (source == NULL) return;
+  unsigned change = fTargetBitrate > fLastNotifiedBitrate
+    ? fTargetBitrate - fLastNotifiedBitrate : fLastNotifiedBitrate - fTargetBitrate;
+  if (fLastNotifiedBitrate == 0 || change*20 >= fLastNotifiedBitrate) {
+    fLastNotifiedBitrate = fTargetBitrate;
+    source->setTargetBitrate(fTargetBitrate);
+  }
+}
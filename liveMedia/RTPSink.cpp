@@ -19,6 +19,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "RTPSink.hh"
+#include "RTPRateController.hh"
+#include "ULPFEC.hh"
 #include "GroupsockHelper.hh"
 
 ////////// RTPSink //////////
@@ -51,6 +53,7 @@ RTPSink::RTPSink(UsageEnvironment& env,
   : MediaSink(env), fRTPInterface(this, rtpGS),
     fRTPPayloadType(rtpPayloadType),
     fPacketCount(0), fOctetCount(0), fTotalOctetCount(0),
+    fRateController(NULL), fTransportCCExtensionId(0), fTransportCCSeqNo(0), fFECEncoder(NULL),
     fTimestampFrequency(rtpTimestampFrequency), fNextTimestampHasBeenPreset(False), fEnableRTCPReports(True),
     fNumChannels(numChannels), fEstimatedBitrate(0) {
   fRTPPayloadFormatName
@@ -67,6 +70,8 @@ RTPSink::RTPSink(UsageEnvironment& env,
 }
 
 RTPSink::~RTPSink() {
+  Medium::close(fRateController);
+  delete fFECEncoder;
   delete fTransmissionStatsDB;
   delete[] (char*)fRTPPayloadFormatName;
   fRTPInterface.forgetOurGroupsock();
@@ -106,7 +111,8 @@ u_int32_t RTPSink::presetNextTimestamp() {
   // 但是，如果只有一个目的地，即只有单播传输，就会将当前时间戳设为fTimestampBase，
   // 并将fNextTimestampHasBeenPreset标记设置为True，表示下一个时间戳已经预设好了。这样做的目的是为了在单播传输中维护一个连续的时间戳流，
   // 确保数据包的时间戳是递增的。
-  if (!groupsockBeingUsed().hasMultipleDestinations()) {
+  Groupsock const* gs = fRTPInterface.gs();
+  if (gs == NULL || !gs->hasMultipleDestinations()) {
     // Don't adjust the timestamp stream if we already have another destination ongoing
     fTimestampBase = tsNow;
     fNextTimestampHasBeenPreset = True;
@@ -178,6 +184,39 @@ char const* RTPSink::auxSDPLine() {
   return NULL; // by default
 }
 
+Boolean RTPSink::enableFEC(unsigned char fecPayloadType, unsigned numColumns, unsigned numRows, Boolean rowFEC) {
+  if (fecPayloadType < 96 || fecPayloadType > 127 || fecPayloadType == rtpPayloadType()) {
+    envir().setResultMsg("RTPSink::enableFEC(): The FEC payload type must be an unused dynamic payload type (96-127)");
+    return False;
+  }
+  if (!ULPFECEncoder::parametersAreValid(numColumns, numRows, rowFEC)) {
+    envir().setResultMsg("RTPSink::enableFEC(): Bad FEC matrix size (need numColumns <= 48, and (numRows-1)*numColumns < 48)");
+    return False;
+  }
+
+  delete fFECEncoder;
+  fFECEncoder = new ULPFECEncoder(fecPayloadType, numColumns, numRows, rowFEC);
+  return True;
+}
+
+Boolean RTPSink::setSRTPContext(SRTPCryptographicContext* srtpContext) {
+  fRTPInterface.setSRTPContext(srtpContext);
+  return True;
+}
+
+unsigned char RTPSink::fecPayloadType() const {
+  return fFECEncoder == NULL ? 0 : fFECEncoder->fecPayloadType();
+}
+
+char* RTPSink::fecSDPLines() const {
+  if (fFECEncoder == NULL) return strDup("");
+
+  char const* const fecSDPFmt = "a=rtpmap:%d ulpfec/%d\r\n";
+  char* result = new char[strlen(fecSDPFmt) + 3 /* max char len */ + 20 /* max int len */];
+  sprintf(result, fecSDPFmt, fecPayloadType(), rtpTimestampFrequency());
+  return result;
+}
+
 
 ////////// RTPTransmissionStatsDB //////////
 
@@ -199,7 +238,7 @@ RTPTransmissionStatsDB::~RTPTransmissionStatsDB() {
 }
 
 void RTPTransmissionStatsDB
-::noteIncomingRR(u_int32_t SSRC, struct sockaddr_in const& lastFromAddress,
+::noteIncomingRR(u_int32_t SSRC, struct sockaddr_storage const& lastFromAddress,
                  unsigned lossStats, unsigned lastPacketNumReceived,
                  unsigned jitter, unsigned lastSRTime, unsigned diffSR_RRTime) {
   RTPTransmissionStats* stats = lookup(SSRC);
@@ -217,6 +256,9 @@ void RTPTransmissionStatsDB
   stats->noteIncomingRR(lastFromAddress,
 			lossStats, lastPacketNumReceived, jitter,
                         lastSRTime, diffSR_RRTime);
+
+  // If our sink is congestion-controlled, tell its controller about this report:
+  if (fOurRTPSink.rateController() != NULL) fOurRTPSink.rateController()->noteReceiverReport();
 }
 
 void RTPTransmissionStatsDB::removeRecord(u_int32_t SSRC) {
@@ -274,7 +316,7 @@ RTPTransmissionStats::RTPTransmissionStats(RTPSink& rtpSink, u_int32_t SSRC)
 RTPTransmissionStats::~RTPTransmissionStats() {}
 
 void RTPTransmissionStats
-::noteIncomingRR(struct sockaddr_in const& lastFromAddress,
+::noteIncomingRR(struct sockaddr_storage const& lastFromAddress,
 		 unsigned lossStats, unsigned lastPacketNumReceived,
 		 unsigned jitter, unsigned lastSRTime,
 		 unsigned diffSR_RRTime) {
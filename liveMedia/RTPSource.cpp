@@ -20,6 +20,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "RTPSource.hh"
 #include "GroupsockHelper.hh"
+#include "ULPFEC.hh"
 
 ////////// RTPSource //////////
 
@@ -54,16 +55,25 @@ RTPSource::RTPSource(UsageEnvironment& env, Groupsock* RTPgs,
   : FramedSource(env),
     fRTPInterface(this, RTPgs),
     fCurPacketHasBeenSynchronizedUsingRTCP(False), fLastReceivedSSRC(0),
-    fRTCPInstanceForMultiplexedRTCPPackets(NULL),
+    fRTCPInstanceForMultiplexedRTCPPackets(NULL), fFECDecoder(NULL),
     fRTPPayloadFormat(rtpPayloadFormat), fTimestampFrequency(rtpTimestampFrequency),
     fSSRC(our_random32()), fEnableRTCPReports(True) {
   fReceptionStatsDB = new RTPReceptionStatsDB();
 }
 
 RTPSource::~RTPSource() {
+  delete fFECDecoder;
   delete fReceptionStatsDB;
 }
 
+Boolean RTPSource::enableFECRecovery(unsigned char fecPayloadType) {
+  if (fecPayloadType < 96 || fecPayloadType > 127 || fecPayloadType == fRTPPayloadFormat) return False;
+
+  delete fFECDecoder;
+  fFECDecoder = new ULPFECDecoder(fecPayloadType);
+  return True;
+}
+
 void RTPSource::getAttributes() const {
   envir().setResultMsg(""); // Fix later to get attributes from  header #####
 }
@@ -222,6 +232,8 @@ void RTPReceptionStats::initSeqNum(u_int16_t initialSeqNum) {
     fBaseExtSeqNumReceived = 0x10000 | initialSeqNum;
     fHighestExtSeqNumReceived = 0x10000 | initialSeqNum;
     fHaveSeenInitialSequenceNumber = True;
+    // Also count this first packet as 'expected' in our next "RR" (our "reset()" was done before we knew its seq num):
+    fLastResetExtSeqNumReceived = fHighestExtSeqNumReceived - 1;
 }
 
 #ifndef MILLION
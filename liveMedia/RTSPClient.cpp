@@ -243,16 +243,47 @@ static void copyUsernameOrPasswordStringFromURL(char* dest, char const* src, uns
   *dest = '\0';
 }
 
+Boolean RTSPClient::isRTSPSURL(char const* url) {
+  return url != NULL && _strncasecmp(url, "rtsps://", 8) == 0;
+}
+
 Boolean RTSPClient::parseRTSPURL(UsageEnvironment& env, char const* url,
 				 char*& username, char*& password,
 				 NetAddress& address,
 				 portNumBits& portNum,
 				 char const** urlSuffix) {
+  char* hostName;
+  if (!parseRTSPURL(env, url, username, password, hostName, portNum, urlSuffix)) return False;
+
+  NetAddressList addresses(hostName);
+  if (addresses.numAddresses() == 0) {
+    env.setResultMsg("Failed to find network address for \"", hostName, "\"");
+    delete[] hostName;
+    delete[] username; username = NULL;
+    delete[] password; password = NULL;
+    return False;
+  }
+  address = *(addresses.firstAddress());
+  delete[] hostName;
+
+  return True;
+}
+
+Boolean RTSPClient::parseRTSPURL(UsageEnvironment& env, char const* url,
+				 char*& username, char*& password,
+				 char*& hostName,
+				 portNumBits& portNum,
+				 char const** urlSuffix) {
+  username = password = hostName = NULL; // default return values
   do {
     // Parse the URL as "rtsp://[<username>[:<password>]@]<server-address-or-name>[:<port>][/<stream-name>]"
+    // (or the same, beginning with "rtsps://", for RTSP-over-TLS)
     char const* prefix = "rtsp://";
-    unsigned const prefixLength = 7;
-    if (_strncasecmp(url, prefix, prefixLength) != 0) {
+    unsigned prefixLength = 7;
+    Boolean useTLS = isRTSPSURL(url);
+    if (useTLS) {
+      prefixLength = 8;
+    } else if (_strncasecmp(url, prefix, prefixLength) != 0) {
       env.setResultMsg("URL is not of the form \"", prefix, "\"");
       break;
     }
@@ -263,7 +294,6 @@ Boolean RTSPClient::parseRTSPURL(UsageEnvironment& env, char const* url,
 
     // Check whether "<username>[:<password>]@" occurs next.
     // We do this by checking whether '@' appears before the end of the URL, or before the first '/'.
-    username = password = NULL; // default return values
     char const* colonPasswordStart = NULL;
     char const* lastAtPtr = NULL;
     for (char const* p = from; *p != '\0' && *p != '/'; ++p) {
@@ -292,10 +322,13 @@ Boolean RTSPClient::parseRTSPURL(UsageEnvironment& env, char const* url,
     }
 
     // Next, parse <server-address-or-name>
+    // (An IPv6 address is enclosed in brackets: "[<ipv6-address>]")
+    Boolean const isBracketed = *from == '[';
+    if (isBracketed) ++from;
     char* to = &parseBuffer[0];
     unsigned i;
     for (i = 0; i < parseBufferSize; ++i) {
-      if (*from == '\0' || *from == ':' || *from == '/') {
+      if (isBracketed ? (*from == '\0' || *from == ']') : (*from == '\0' || *from == ':' || *from == '/')) {
 	// We've completed parsing the address
 	*to = '\0';
 	break;
@@ -306,16 +339,20 @@ Boolean RTSPClient::parseRTSPURL(UsageEnvironment& env, char const* url,
       env.setResultMsg("URL is too long");
       break;
     }
+    if (isBracketed) {
+      if (*from != ']') {
+	env.setResultMsg("URL has no ']' after the IPv6 address");
+	break;
+      }
+      ++from;
+    }
 
-    NetAddressList addresses(parseBuffer);
-    if (addresses.numAddresses() == 0) {
-      env.setResultMsg("Failed to find network address for \"",
-		       parseBuffer, "\"");
+    if (parseBuffer[0] == '\0') {
+      env.setResultMsg("URL has no server address or name");
       break;
     }
-    address = *(addresses.firstAddress());
 
-    portNum = 554; // default value
+    portNum = useTLS ? RTSPS_DEFAULT_PORT_NUM : 554; // default value
     char nextChar = *from;
     if (nextChar == ':') {
       int portNumInt;
@@ -334,9 +371,12 @@ Boolean RTSPClient::parseRTSPURL(UsageEnvironment& env, char const* url,
     // The remainder of the URL is the suffix:
     if (urlSuffix != NULL) *urlSuffix = from;
 
+    hostName = strDup(parseBuffer);
     return True;
   } while (0);
 
+  delete[] username; username = NULL;
+  delete[] password; password = NULL;
   return False;
 }
 
@@ -359,11 +399,12 @@ RTSPClient::RTSPClient(UsageEnvironment& env, char const* rtspURL,
 		       portNumBits tunnelOverHTTPPortNum, int socketNumToServer)
   : Medium(env),
     desiredMaxIncomingPacketSize(0), fVerbosityLevel(verbosityLevel), fCSeq(1),
-    fAllowBasicAuthentication(True), fServerAddress(0),
+    fAllowBasicAuthentication(True), fServerAddress(nullAddress()),
     fTunnelOverHTTPPortNum(tunnelOverHTTPPortNum),
     fUserAgentHeaderStr(NULL), fUserAgentHeaderStrLen(0),
     fInputSocketNum(-1), fOutputSocketNum(-1), fBaseURL(NULL), fTCPStreamIdCount(0),
-    fLastSessionId(NULL), fSessionTimeoutParameter(0), fSessionCookieCounter(0), fHTTPTunnelingConnectionIsPending(False) {
+    fLastSessionId(NULL), fSessionTimeoutParameter(0), fSessionCookieCounter(0), fHTTPTunnelingConnectionIsPending(False),
+    fServerPortNum(0), fTLSState(NULL), fVerifyTLSServer(True), fHostNameLookupId(0) {
   setBaseURL(rtspURL);
 
   fResponseBuffer = new char[responseBufferSize+1];
@@ -408,7 +449,7 @@ void RTSPClient::reset() {
   fRequestsAwaitingConnection.reset();
   fRequestsAwaitingHTTPTunneling.reset();
   fRequestsAwaitingResponse.reset();
-  fServerAddress = 0;
+  fServerAddress = nullAddress();
 
   setBaseURL(NULL);
 
@@ -535,7 +576,7 @@ unsigned RTSPClient::sendRequest(RequestRecord* request) {
       delete[] origCmd;
     }
 
-    if (send(fOutputSocketNum, cmd, strlen(cmd), 0) < 0) {
+    if (sendToServer(cmd, strlen(cmd)) < 0) {
       char const* errFmt = "%s send() failed: ";
       unsigned const errLength = strlen(errFmt) + strlen(request->commandName());
       char* err = new char[errLength];
@@ -665,6 +706,8 @@ Boolean RTSPClient::setRequestFields(RequestRecord* request,
     if (strcmp(subsession.protocolName(), "UDP") == 0) {
       suffix = "";
       transportFmt = "Transport: RAW/RAW/UDP%s%s%s=%d-%d\r\n";
+    } else if (subsession.usesSRTP()) {
+      transportFmt = "Transport: RTP/SAVP%s%s%s=%d-%d\r\n";
     } else {
       transportFmt = "Transport: RTP/AVP%s%s%s=%d-%d\r\n";
     }
@@ -685,9 +728,10 @@ Boolean RTSPClient::setRequestFields(RequestRecord* request,
       rtpNumber = fTCPStreamIdCount++;
       rtcpNumber = fTCPStreamIdCount++;
     } else { // normal RTP streaming
-      unsigned connectionAddress = subsession.connectionEndpointAddress();
+      struct sockaddr_storage connectionAddress;
+      subsession.getConnectionEndpointAddress(connectionAddress);
       Boolean requestMulticastStreaming
-	= IsMulticastAddress(connectionAddress) || (connectionAddress == 0 && forceMulticastOnUnspecified);
+	= IsMulticastAddress(connectionAddress) || (addressIsNull(connectionAddress) && forceMulticastOnUnspecified);
       transportTypeStr = requestMulticastStreaming ? ";multicast" : ";unicast";
       portTypeStr = requestMulticastStreaming ? ";port" : ";client_port";
       rtpNumber = subsession.clientPortNum();
@@ -722,14 +766,14 @@ Boolean RTSPClient::setRequestFields(RequestRecord* request,
     // in the subsequent request), and the server address (which we'll use in a "Host:" header):
     char* username;
     char* password;
-    NetAddress destAddress;
+    char* hostName;
     portNumBits urlPortNum;
-    if (!parseRTSPURL(envir(), fBaseURL, username, password, destAddress, urlPortNum, (char const**)&cmdURL)) return False;
+    if (!parseRTSPURL(envir(), fBaseURL, username, password, hostName, urlPortNum, (char const**)&cmdURL)) return False;
     if (cmdURL[0] == '\0') cmdURL = (char*)"/";
     delete[] username;
     delete[] password;
-    netAddressBits serverAddress = *(netAddressBits*)(destAddress.data());
-    AddressString serverAddressString(serverAddress);
+    delete[] hostName;
+    AddressString serverAddressString(fServerAddress); // (we've already looked up the server's address, to connect to it)
     
     protocolStr = "HTTP/1.1";
     
@@ -831,6 +875,8 @@ Boolean RTSPClient::isRTSPClient() const {
 }
 
 void RTSPClient::resetTCPSockets() {
+  HostNameResolver::cancel(fHostNameLookupId); fHostNameLookupId = 0;
+  delete fTLSState; fTLSState = NULL; // before we close its socket
   if (fInputSocketNum >= 0) {
     RTPInterface::clearServerRequestAlternativeByteHandler(envir(), fInputSocketNum); // in case we were receiving RTP-over-TCP
     envir().taskScheduler().disableBackgroundHandling(fInputSocketNum);
@@ -854,29 +900,70 @@ int RTSPClient::openConnection() {
     
     char* username;
     char* password;
-    NetAddress destAddress;
+    char* hostName;
     portNumBits urlPortNum;
     char const* urlSuffix;
-    if (!parseRTSPURL(envir(), fBaseURL, username, password, destAddress, urlPortNum, &urlSuffix)) break;
-    portNumBits destPortNum = fTunnelOverHTTPPortNum == 0 ? urlPortNum : fTunnelOverHTTPPortNum;
+    if (!parseRTSPURL(envir(), fBaseURL, username, password, hostName, urlPortNum, &urlSuffix)) break;
+    if (isRTSPSURL(fBaseURL) && fTunnelOverHTTPPortNum != 0) {
+      envir().setResultMsg("RTSP-over-HTTP tunneling is not supported for \"rtsps://\" URLs");
+      delete[] username;
+      delete[] password;
+      delete[] hostName;
+      break;
+    }
     if (username != NULL || password != NULL) {
       fCurrentAuthenticator.setUsernameAndPassword(username, password);
       delete[] username;
       delete[] password;
     }
-    
+    fServerPortNum = fTunnelOverHTTPPortNum == 0 ? urlPortNum : fTunnelOverHTTPPortNum;
+
+    // Next, find the server's address.  Unless "hostName" is an address string (or we've looked it up recently),
+    // this needs a host name lookup, which we do without blocking; the connection remains pending until it completes:
+    NetAddressList* addresses = HostNameResolver::lookupIfKnown(hostName);
+    if (addresses == NULL) {
+      if (fVerbosityLevel >= 1) envir() << "Looking up the address of \"" << hostName << "\"...\n";
+      fHostNameLookupId = HostNameResolver::lookup(envir(), hostName, AF_UNSPEC, hostNameLookupHandler, this);
+      delete[] hostName;
+      return 0;
+    }
+    if (addresses->numAddresses() == 0) {
+      envir().setResultMsg("Failed to find network address for \"", hostName, "\"");
+      delete addresses;
+      delete[] hostName;
+      break;
+    }
+    copyAddress(fServerAddress, addresses->firstAddress());
+    delete addresses;
+    delete[] hostName;
+
+    return openConnection1();
+  } while (0);
+  
+  resetTCPSockets();
+  return -1;
+}
+
+int RTSPClient::openConnection1() {
+  do {
     // We don't yet have a TCP socket (or we used to have one, but it got closed).  Set it up now.
-    fInputSocketNum = setupStreamSocket(envir(), 0);
+    // (Its address family - IPv4 or IPv6 - is that of the server's address.)
+    fInputSocketNum = setupStreamSocket(envir(), 0, True, False, fServerAddress.ss_family);
     if (fInputSocketNum < 0) break;
     ignoreSigPipeOnSocket(fInputSocketNum); // so that servers on the same host that get killed don't also kill us
     if (fOutputSocketNum < 0) fOutputSocketNum = fInputSocketNum;
     envir() << "Created new TCP socket " << fInputSocketNum << " for connection\n";
       
     // Connect to the remote endpoint:
-    fServerAddress = *(netAddressBits*)(destAddress.data());
-    int connectResult = connectToServer(fInputSocketNum, destPortNum);
+    int connectResult = connectToServer(fInputSocketNum, fServerPortNum);
     if (connectResult < 0) break;
     else if (connectResult > 0) {
+      if (isRTSPSURL(fBaseURL)) {
+	// We still need to do the TLS handshake, so the connection is still pending:
+	if (!startTLS()) break;
+	return 0;
+      }
+
       // The connection succeeded.  Arrange to handle responses to requests sent on it:
       envir().taskScheduler().setBackgroundHandling(fInputSocketNum, SOCKET_READABLE|SOCKET_EXCEPTION,
 						    (TaskScheduler::BackgroundHandlerProc*)&incomingDataHandler, this);
@@ -888,12 +975,54 @@ int RTSPClient::openConnection() {
   return -1;
 }
 
+void RTSPClient::hostNameLookupHandler(void* clientData, NetAddressList const& addresses) {
+  RTSPClient* client = (RTSPClient*)clientData;
+  client->hostNameLookupHandler1(addresses);
+}
+
+void RTSPClient::hostNameLookupHandler1(NetAddressList const& addresses) {
+  fHostNameLookupId = 0;
+
+  // Move all requests awaiting connection into a new, temporary queue (as in "connectionHandler1()"):
+  RequestQueue tmpRequestQueue(fRequestsAwaitingConnection);
+  RequestRecord* request;
+
+  if (addresses.numAddresses() > 0) {
+    copyAddress(fServerAddress, addresses.firstAddress());
+    int connectResult = openConnection1();
+    if (connectResult == 0) {
+      // The connection is still pending, so the requests remain pending also:
+      while ((request = tmpRequestQueue.dequeue()) != NULL) {
+	fRequestsAwaitingConnection.enqueue(request);
+      }
+      return;
+    } else if (connectResult > 0) {
+      // The connection succeeded.  Send all pending requests:
+      while ((request = tmpRequestQueue.dequeue()) != NULL) {
+	sendRequest(request);
+      }
+      return;
+    }
+  } else {
+    envir().setResultMsg("Failed to find network address for the server in \"", fBaseURL, "\"");
+  }
+
+  // An error occurred.  Tell all pending requests about the error:
+  if (fVerbosityLevel >= 1) envir() << "..." << envir().getResultMsg() << "\n";
+  resetTCPSockets(); // do this now, in case an error handler deletes "this"
+  while ((request = tmpRequestQueue.dequeue()) != NULL) {
+    handleRequestError(request);
+    delete request;
+  }
+}
+
 int RTSPClient::connectToServer(int socketNum, portNumBits remotePortNum) {
-  MAKE_SOCKADDR_IN(remoteName, fServerAddress, htons(remotePortNum));
+  struct sockaddr_storage remoteName = fServerAddress;
+  setPortNum(remoteName, htons(remotePortNum));
   if (fVerbosityLevel >= 1) {
     envir() << "Connecting to " << AddressString(remoteName).val() << ", port " << remotePortNum << " on socket " << socketNum << "...\n";
   }
-  if (connect(socketNum, (struct sockaddr*) &remoteName, sizeof remoteName) != 0) {
+  if (connect(socketNum, (struct sockaddr*) &remoteName, addressSize(remoteName)) != 0) {
     int const err = envir().getErrno();
     if (err == EINPROGRESS || err == EWOULDBLOCK) {
       // The connection is pending; we'll need to handle it later.  Wait for our socket to be 'writable', or have an exception.
@@ -1022,7 +1151,7 @@ void RTSPClient::handleIncomingRequest() {
     char tmpBuf[2*RTSP_PARAM_STRING_MAX];
     snprintf((char*)tmpBuf, sizeof tmpBuf,
              "RTSP/1.0 405 Method Not Allowed\r\nCSeq: %s\r\n\r\n", cseq);
-    send(fOutputSocketNum, tmpBuf, strlen(tmpBuf), 0);
+    sendToServer(tmpBuf, strlen(tmpBuf));
   }
 }
 
@@ -1153,8 +1282,29 @@ Boolean RTSPClient::parseRTPInfoParams(char const*& paramsStr, u_int16_t& seqNum
   return sawSeq && sawRtptime;
 }
 
+static void parseKeyMgmtHeader(char const* paramsStr, MediaSubsession& subsession) {
+  // Parse a "KeyMgmt: prot=mikey; uri=\"...\"; data=\"<base64-encoded MIKEY message>\"" header (RFC 4567, section 6).
+  // We use only its SSRC and rollover counter (which tell us how to decrypt a stream that we're joining late);
+  // our keys come from the SDP description:
+  if (paramsStr == NULL || subsession.srtpContext() == NULL || strstr(paramsStr, "prot=mikey") == NULL) return;
+  char const* data = strstr(paramsStr, "data=\"");
+  if (data == NULL) return;
+  data += 6;
+  char const* dataEnd = strchr(data, '"');
+  if (dataEnd == NULL) return;
+
+  unsigned messageSize;
+  u_int8_t* message = base64Decode(data, dataEnd - data, messageSize);
+  MIKEYState* mikeyState = MIKEYState::createNew(message, messageSize);
+  delete[] message;
+  if (mikeyState == NULL) return;
+
+  if (mikeyState->ssrc() != 0) subsession.srtpContext()->setIncomingROC(mikeyState->ssrc(), mikeyState->roc());
+  delete mikeyState;
+}
+
 Boolean RTSPClient::handleSETUPResponse(MediaSubsession& subsession, char const* sessionParamsStr, char const* transportParamsStr,
-                                        Boolean streamUsingTCP) {
+                                        char const* keyMgmtParamsStr, Boolean streamUsingTCP) {
   char* sessionId = new char[responseBufferSize]; // ensures we have enough space
   Boolean success = False;
   do {
@@ -1186,6 +1336,7 @@ Boolean RTSPClient::handleSETUPResponse(MediaSubsession& subsession, char const*
     subsession.serverPortNum = serverPortNum;
     subsession.rtpChannelId = rtpChannelId;
     subsession.rtcpChannelId = rtcpChannelId;
+    parseKeyMgmtHeader(keyMgmtParamsStr, subsession);
 
     if (streamUsingTCP) {
       // Tell the subsession to receive RTP (and send/receive RTCP) over the RTSP stream:
@@ -1201,9 +1352,7 @@ Boolean RTSPClient::handleSETUPResponse(MediaSubsession& subsession, char const*
     } else {
       // Normal case.
       // Set the RTP and RTCP sockets' destination address and port from the information in the SETUP response (if present):
-      netAddressBits destAddress = subsession.connectionEndpointAddress();
-      if (destAddress == 0) destAddress = fServerAddress;
-      subsession.setDestinations(destAddress);
+      subsession.setDestinations(fServerAddress);
     }
 
     success = True;
@@ -1393,6 +1542,7 @@ void RTSPClient::handleAlternativeRequestByte1(u_int8_t requestByte) {
     // Another hack: The new handler of the input TCP socket no longer needs it, so take back control:
     envir().taskScheduler().setBackgroundHandling(fInputSocketNum, SOCKET_READABLE|SOCKET_EXCEPTION,
 						  (TaskScheduler::BackgroundHandlerProc*)&incomingDataHandler, this);
+    if (fTLSState != NULL) fTLSState->continueReadingIfBuffered((TaskScheduler::BackgroundHandlerProc*)&incomingDataHandler, this);
   } else {
     // Normal case:
     fResponseBuffer[fResponseBytesAlreadySeen] = requestByte;
@@ -1464,7 +1614,7 @@ void RTSPClient::responseHandlerForHTTP_GET1(int responseCode, char* responseStr
 
     // Having successfully set up (using the HTTP "GET" command) the server->client link, set up a second TCP connection
     // (to the same server & port as before) for the client->server link.  All future output will be to this new socket.
-    fOutputSocketNum = setupStreamSocket(envir(), 0);
+    fOutputSocketNum = setupStreamSocket(envir(), 0, True, False, fServerAddress.ss_family);
     if (fOutputSocketNum < 0) break;
     ignoreSigPipeOnSocket(fOutputSocketNum); // so that servers on the same host that killed don't also kill us
 
@@ -1537,6 +1687,15 @@ void RTSPClient::connectionHandler1() {
     if (fVerbosityLevel >= 1) envir() << "...remote connection opened\n";
     if (fHTTPTunnelingConnectionIsPending && !setupHTTPTunneling2()) break;
 
+    if (isRTSPSURL(fBaseURL) && fTLSState == NULL) {
+      // Do the TLS handshake before sending the pending requests; they stay pending until it completes:
+      if (!startTLS()) break;
+      while ((request = tmpRequestQueue.dequeue()) != NULL) {
+	fRequestsAwaitingConnection.enqueue(request);
+      }
+      return;
+    }
+
     // Resume sending all pending requests:
     while ((request = tmpRequestQueue.dequeue()) != NULL) {
       sendRequest(request);
@@ -1558,12 +1717,95 @@ void RTSPClient::incomingDataHandler(void* instance, int /*mask*/) {
 }
 
 void RTSPClient::incomingDataHandler1() {
-  struct sockaddr_in dummy; // 'from' address - not used
-
-  int bytesRead = readSocket(envir(), fInputSocketNum, (unsigned char*)&fResponseBuffer[fResponseBytesAlreadySeen], fResponseBufferBytesLeft, dummy);
+  struct sockaddr_storage dummy; // 'from' address - not used
+
+  int bytesRead;
+  if (fTLSState != NULL) {
+    bytesRead = fTLSState->read((u_int8_t*)&fResponseBuffer[fResponseBytesAlreadySeen], fResponseBufferBytesLeft);
+    if (bytesRead == 0) return; // we read only (part of) a TLS record; wait for more
+    // Handle any more data that we've already decrypted - after we handle this - because "select()" won't tell us about it:
+    fTLSState->continueReadingIfBuffered((TaskScheduler::BackgroundHandlerProc*)&incomingDataHandler, this);
+  } else {
+    bytesRead = readSocket(envir(), fInputSocketNum, (unsigned char*)&fResponseBuffer[fResponseBytesAlreadySeen], fResponseBufferBytesLeft, dummy);
+  }
   handleResponseBytes(bytesRead);
 }
 
+Boolean RTSPClient::startTLS() {
+  // The server's certificate is checked against the host name (or address) in our URL:
+  char* username;
+  char* password;
+  char* hostName;
+  portNumBits urlPortNum;
+  if (!parseRTSPURL(envir(), fBaseURL, username, password, hostName, urlPortNum)) return False;
+  delete[] username; delete[] password;
+
+  fTLSState = TLSState::createNewForClient(envir(), fInputSocketNum, hostName, fServerPortNum, fVerifyTLSServer);
+  delete[] hostName;
+  if (fTLSState == NULL) return False;
+
+  if (fVerbosityLevel >= 1) envir() << "Starting TLS handshake...\n";
+  fTLSState->startHandshake(tlsHandshakeCompletionHandler, this);
+  return True;
+}
+
+void RTSPClient::tlsHandshakeCompletionHandler(void* instance, Boolean success) {
+  RTSPClient* client = (RTSPClient*)instance;
+  client->tlsHandshakeCompletionHandler1(success);
+}
+
+void RTSPClient::tlsHandshakeCompletionHandler1(Boolean success) {
+  // Move all requests awaiting connection into a new, temporary queue (as in "connectionHandler1()"):
+  RequestQueue tmpRequestQueue(fRequestsAwaitingConnection);
+  RequestRecord* request;
+
+  if (success) {
+    if (fVerbosityLevel >= 1) {
+      envir() << "...TLS handshake completed" << (fTLSState->sessionWasResumed() ? " (resumed a previous session)" : "") << "\n";
+    }
+    envir().taskScheduler().setBackgroundHandling(fInputSocketNum, SOCKET_READABLE|SOCKET_EXCEPTION,
+						  (TaskScheduler::BackgroundHandlerProc*)&incomingDataHandler, this);
+
+    // Resume sending all pending requests:
+    while ((request = tmpRequestQueue.dequeue()) != NULL) {
+      sendRequest(request);
+    }
+    return;
+  }
+
+  // An error occurred.  Tell all pending requests about the error:
+  if (fVerbosityLevel >= 1) envir() << "...TLS handshake failed: " << envir().getResultMsg() << "\n";
+  resetTCPSockets(); // do this now, in case an error handler deletes "this"
+  while ((request = tmpRequestQueue.dequeue()) != NULL) {
+    handleRequestError(request);
+    delete request;
+  }
+}
+
+int RTSPClient::sendToServer(char const* data, unsigned dataSize) {
+  if (fTLSState == NULL) return send(fOutputSocketNum, data, dataSize, 0);
+
+  // Our requests are small, so if the TLS write would block (which is rare), block until it's done:
+  unsigned numBytesSent = 0;
+  Boolean isBlocking = False;
+  while (numBytesSent < dataSize) {
+    int result = fTLSState->write((u_int8_t const*)&data[numBytesSent], dataSize - numBytesSent);
+    if (result < 0) break;
+    if (result == 0) {
+      if (isBlocking) {
+	envir().setResultMsg("TLS write timed out");
+	break;
+      }
+      makeSocketBlocking(fOutputSocketNum, 500/*ms*/);
+      isBlocking = True;
+    }
+    numBytesSent += result;
+  }
+  if (isBlocking) makeSocketNonBlocking(fOutputSocketNum);
+
+  return numBytesSent == dataSize ? (int)numBytesSent : -1;
+}
+
 static char* getLine(char* startOfLine) {
   // returns the start of the next line, or NULL if none.  Note that this modifies the input string to add '\0' characters.
   for (char* ptr = startOfLine; *ptr != '\0'; ++ptr) {
@@ -1647,6 +1889,7 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
     RequestRecord* foundRequest = NULL;
     char const* sessionParamsStr = NULL;
     char const* transportParamsStr = NULL;
+    char const* keyMgmtParamsStr = NULL;
     char const* scaleParamsStr = NULL;
     char const* speedParamsStr = NULL;
     char const* rangeParamsStr = NULL;
@@ -1721,6 +1964,7 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
 	  setBaseURL(headerParamsStr);
 	} else if (checkForHeader(lineStart, "Session:", 8, sessionParamsStr)) {
 	} else if (checkForHeader(lineStart, "Transport:", 10, transportParamsStr)) {
+	} else if (checkForHeader(lineStart, "KeyMgmt:", 8, keyMgmtParamsStr)) {
 	} else if (checkForHeader(lineStart, "Scale:", 6, scaleParamsStr)) {
 	} else if (checkForHeader(lineStart, "Speed:",
 // NOTE: Should you feel the need to modify this code,
@@ -1820,7 +2064,8 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
 	if (responseCode == 200) {
 	  // Do special-case response handling for some commands:
 	  if (strcmp(foundRequest->commandName(), "SETUP") == 0) {
-        if (!handleSETUPResponse(*foundRequest->subsession(), sessionParamsStr, transportParamsStr, foundRequest->booleanFlags()&0x1)) break;
+        if (!handleSETUPResponse(*foundRequest->subsession(), sessionParamsStr, transportParamsStr, keyMgmtParamsStr,
+                                 foundRequest->booleanFlags()&0x1)) break;
 	  } else if (strcmp(foundRequest->commandName(), "PLAY") == 0) {
         if (!handlePLAYResponse(foundRequest->session(), foundRequest->subsession(), scaleParamsStr, speedParamsStr, rangeParamsStr, rtpInfoParamsStr)) break;
 	  } else if (strcmp(foundRequest->commandName(), "TEARDOWN") == 0) {
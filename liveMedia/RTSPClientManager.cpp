@@ -0,0 +1,713 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A manager for receiving a large number of RTSP streams (e.g., from cameras).  Each stream is given to one of
+// several 'worker' threads (each running its own event loop), which uses a "RTSPClient" to "DESCRIBE", "SETUP" and
+// "PLAY" it - pipelining its "SETUP"s and "PLAY" - and then feeds each of its tracks into a "MediaSink" supplied by the
+// application.  Streams that fail (or end, or stop delivering data) are restarted, with exponential backoff.
+// Implementation
+
+#include "RTSPClientManager.hh"
+#include "RTSPCommon.hh"
+#include <GroupsockHelper.hh>
+#include <condition_variable>
+#include <thread>
+
+#ifndef MILLION
+#define MILLION 1000000
+#endif
+
+// How long we wait - from starting to connect - for a stream's "PLAY" response, before giving up and trying again:
+#define CONNECT_TIMEOUT_SECONDS 20
+
+// The maximum delay (before we restart a failed stream) is 2^MAX_BACKOFF_SHIFT seconds:
+#define MAX_BACKOFF_SHIFT 6
+
+////////// RTSPClientManagerWorker //////////
+
+// A command for a worker, queued (from another thread) by "RTSPClientManager::addStream()"/"removeStream()":
+struct WorkerCommand {
+  enum { ADD_STREAM, REMOVE_STREAM } kind;
+  unsigned streamId;
+  char* rtspURL;
+  char* username;
+  char* password;
+  WorkerCommand* next;
+};
+
+class ManagedStream; // forward
+
+class RTSPClientManagerWorker {
+public:
+  RTSPClientManagerWorker(RTSPClientManager& ourManager, unsigned workerNum);
+  ~RTSPClientManagerWorker(); // stops the thread (if it's running), and closes our streams
+
+  void start(RTSPClientManager::WorkerEnvironmentCreationFunc* environmentCreationFunc); // in a new thread
+  Boolean startInEnvironment(UsageEnvironment& env); // without a new thread
+  Boolean waitForSetup(); // returns False iff the worker failed to start
+
+  void queueCommand(WorkerCommand* command); // may be called from any thread
+
+  // Used by our "ManagedStream"s:
+  UsageEnvironment& envir() const { return *fEnv; }
+  RTSPClientManager& manager() const { return fOurManager; }
+  void requestConnectSlot(ManagedStream* stream);
+  void releaseConnectSlot();
+
+private:
+  void run(RTSPClientManager::WorkerEnvironmentCreationFunc* environmentCreationFunc);
+  Boolean createTriggers();
+  static void commandsHandler(void* clientData);
+  void commandsHandler();
+  static void stopHandler(void* clientData);
+  void removeStream(ManagedStream* stream);
+  void closeAllStreams();
+
+private:
+  RTSPClientManager& fOurManager;
+  unsigned fWorkerNum;
+  std::thread fThread;
+
+  // Accessed only by the worker's thread (after setup):
+  UsageEnvironment* fEnv;
+  EventTriggerId fCommandsTrigger, fStopTrigger;
+  char volatile fStopRequested;
+  HashTable* fStreams; // maps stream ids to "ManagedStream"s
+  unsigned fNumConnecting; // the number of streams that hold a 'connect slot'
+  ManagedStream* fWaitingHead; // streams waiting for a 'connect slot'
+  ManagedStream* fWaitingTail;
+
+  std::mutex fLock;
+  std::condition_variable fSetupWasDone;
+  // Protected by "fLock":
+  Boolean fSetupIsDone, fSetupSucceeded;
+  WorkerCommand* fQueueHead;
+  WorkerCommand* fQueueTail;
+};
+
+////////// ManagedRTSPClient and ManagedStream //////////
+
+class ManagedRTSPClient: public RTSPClient {
+public:
+  static ManagedRTSPClient* createNew(UsageEnvironment& env, char const* rtspURL, int verbosityLevel,
+				      ManagedStream& stream) {
+    return new ManagedRTSPClient(env, rtspURL, verbosityLevel, stream);
+  }
+
+  ManagedStream& stream() const { return fStream; }
+
+protected:
+  ManagedRTSPClient(UsageEnvironment& env, char const* rtspURL, int verbosityLevel, ManagedStream& stream)
+    : RTSPClient(env, rtspURL, verbosityLevel, "RTSPClientManager", 0, -1),
+      fStream(stream) {
+  }
+
+private:
+  ManagedStream& fStream;
+};
+
+class ManagedStream {
+public:
+  ManagedStream(RTSPClientManagerWorker& worker, unsigned id,
+		char const* rtspURL, char const* username, char const* password);
+  ~ManagedStream(); // also stops the stream
+
+  unsigned id() const { return fId; }
+  void start(); // asks our worker for a 'connect slot', then connects
+  void beginConnect(); // called once we have a 'connect slot'
+
+  ManagedStream* fNextWaiting; // used by our worker's list of streams that are waiting for a 'connect slot'
+
+private:
+  enum State { IDLE, WAITING_TO_CONNECT, CONNECTING, PLAYING, FAILED };
+
+  UsageEnvironment& envir() const { return fWorker.envir(); }
+  RTSPClientManager& manager() const { return fWorker.manager(); }
+
+  void openClient();
+  void sendSetupCommand(MediaSubsession& subsession);
+  void attachSink(MediaSubsession& subsession);
+  void fail(char const* reason);
+  void stop(); // closes our sinks, "MediaSession" and "RTSPClient" (and releases our 'connect slot', if we hold one)
+
+  static void continueAfterDESCRIBE(RTSPClient* rtspClient, int resultCode, char* resultString);
+  void continueAfterDESCRIBE(int resultCode, char* resultString);
+  static void continueAfterSETUP(RTSPClient* rtspClient, int resultCode, char* resultString);
+  void continueAfterSETUP(int resultCode, char* resultString);
+  static void continueAfterPLAY(RTSPClient* rtspClient, int resultCode, char* resultString);
+  void continueAfterPLAY(int resultCode, char* resultString);
+
+  static void subsessionAfterPlaying(void* clientData);
+  static void subsessionByeHandler(void* clientData);
+  static void restartHandler(void* clientData);
+  void restart();
+  static void startHandler(void* clientData);
+  static void watchdogHandler(void* clientData);
+  void watchdogHandler();
+  unsigned totNumPacketsReceived() const;
+
+private:
+  RTSPClientManagerWorker& fWorker;
+  unsigned fId;
+  char* fURL;
+  Authenticator* fAuthenticator;
+  State fState;
+  Boolean fHoldsConnectSlot;
+  unsigned fNumFailures; // since we last got a successful "PLAY" response
+
+  ManagedRTSPClient* fClient;
+  MediaSession* fSession;
+  MediaSubsession** fSetupSubsessions; // the tracks that we "SETUP", in order
+  unsigned fNumSetupSubsessions, fNumSetupResponses;
+
+  TaskToken fStartTask, fWatchdogTask;
+  unsigned fLastNumPacketsReceived;
+};
+
+ManagedStream::ManagedStream(RTSPClientManagerWorker& worker, unsigned id,
+			     char const* rtspURL, char const* username, char const* password)
+  : fNextWaiting(NULL),
+    fWorker(worker), fId(id), fURL(strDup(rtspURL)),
+    fAuthenticator(username != NULL && password != NULL ? new Authenticator(username, password) : NULL),
+    fState(IDLE), fHoldsConnectSlot(False), fNumFailures(0),
+    fClient(NULL), fSession(NULL), fSetupSubsessions(NULL), fNumSetupSubsessions(0), fNumSetupResponses(0),
+    fStartTask(NULL), fWatchdogTask(NULL), fLastNumPacketsReceived(0) {
+  manager().fNumStreams.fetch_add(1, std::memory_order_relaxed);
+}
+
+ManagedStream::~ManagedStream() {
+  stop();
+  envir().taskScheduler().unscheduleDelayedTask(fStartTask);
+  manager().fNumStreams.fetch_sub(1, std::memory_order_relaxed);
+
+  delete fAuthenticator;
+  delete[] fURL;
+}
+
+void ManagedStream::start() {
+  fStartTask = NULL;
+  fState = WAITING_TO_CONNECT;
+  fWorker.requestConnectSlot(this);
+}
+
+void ManagedStream::startHandler(void* clientData) {
+  ((ManagedStream*)clientData)->start();
+}
+
+void ManagedStream::beginConnect() {
+  fHoldsConnectSlot = True;
+
+  // Give up if we don't get to "PLAY" in time:
+  fWatchdogTask = envir().taskScheduler().scheduleDelayedTask(CONNECT_TIMEOUT_SECONDS*MILLION, watchdogHandler, this);
+
+  // (If the URL contains a host name, the "RTSPClient" looks it up without blocking our event loop - using a cache that's
+  // shared by all workers.)
+  openClient();
+}
+
+void ManagedStream::openClient() {
+  fState = CONNECTING;
+  fClient = ManagedRTSPClient::createNew(envir(), fURL, manager().fVerbosityLevel, *this);
+  if (fClient == NULL) {
+    fail(envir().getResultMsg());
+    return;
+  }
+  fClient->sendDescribeCommand(continueAfterDESCRIBE, fAuthenticator);
+}
+
+void ManagedStream::continueAfterDESCRIBE(RTSPClient* rtspClient, int resultCode, char* resultString) {
+  ((ManagedRTSPClient*)rtspClient)->stream().continueAfterDESCRIBE(resultCode, resultString);
+}
+
+void ManagedStream::continueAfterDESCRIBE(int resultCode, char* resultString) {
+  do {
+    if (resultCode != 0) {
+      fail("\"DESCRIBE\" failed");
+      break;
+    }
+
+    fSession = MediaSession::createNew(envir(), resultString);
+    if (fSession == NULL || !fSession->hasSubsessions()) {
+      fail("bad SDP description");
+      break;
+    }
+
+    // Create a data source for each track:
+    unsigned numSubsessions = 0;
+    MediaSubsessionIterator iter(*fSession);
+    MediaSubsession* subsession;
+    while (iter.next() != NULL) ++numSubsessions;
+    fSetupSubsessions = new MediaSubsession*[numSubsessions];
+    iter.reset();
+    while ((subsession = iter.next()) != NULL) {
+      if (subsession->initiate()) fSetupSubsessions[fNumSetupSubsessions++] = subsession;
+    }
+    if (fNumSetupSubsessions == 0) {
+      fail("couldn't create a data source for any track");
+      break;
+    }
+
+    // "SETUP" the first track.  (We'll send the rest - along with the "PLAY" - once we know the session id.)
+    sendSetupCommand(*fSetupSubsessions[0]);
+  } while (0);
+
+  delete[] resultString;
+}
+
+void ManagedStream::sendSetupCommand(MediaSubsession& subsession) {
+  fClient->sendSetupCommand(subsession, continueAfterSETUP, False, manager().fStreamUsingTCP, False, fAuthenticator);
+}
+
+void ManagedStream::continueAfterSETUP(RTSPClient* rtspClient, int resultCode, char* resultString) {
+  ((ManagedRTSPClient*)rtspClient)->stream().continueAfterSETUP(resultCode, resultString);
+}
+
+void ManagedStream::continueAfterSETUP(int resultCode, char* resultString) {
+  delete[] resultString;
+  if (fState != CONNECTING) return;
+
+  // Responses come back in the same order as our "SETUP"s:
+  MediaSubsession& subsession = *fSetupSubsessions[fNumSetupResponses++];
+  if (fNumSetupResponses == 1) {
+    if (resultCode != 0) {
+      fail("\"SETUP\" failed");
+      return;
+    }
+    attachSink(subsession);
+
+    // Now that we have a session id, send the remaining "SETUP"s, and the "PLAY", without waiting for responses:
+    for (unsigned i = 1; i < fNumSetupSubsessions; ++i) sendSetupCommand(*fSetupSubsessions[i]);
+    fClient->sendPlayCommand(*fSession, continueAfterPLAY, 0.0f, -1.0f, 1.0f, fAuthenticator);
+  } else if (resultCode == 0) {
+    attachSink(subsession);
+  }
+  // (If a later track's "SETUP" fails, then we just play the other tracks.)
+}
+
+void ManagedStream::attachSink(MediaSubsession& subsession) {
+  subsession.sink = (*manager().fCreateSinkFunc)(envir(), fId, fURL, subsession, manager().fSinkClientData);
+  if (subsession.sink == NULL) return;
+
+  subsession.miscPtr = this;
+  subsession.sink->startPlaying(*subsession.readSource(), subsessionAfterPlaying, &subsession);
+  if (subsession.rtcpInstance() != NULL) {
+    subsession.rtcpInstance()->setByeHandler(subsessionByeHandler, &subsession);
+  }
+}
+
+void ManagedStream::continueAfterPLAY(RTSPClient* rtspClient, int resultCode, char* resultString) {
+  ((ManagedRTSPClient*)rtspClient)->stream().continueAfterPLAY(resultCode, resultString);
+}
+
+void ManagedStream::continueAfterPLAY(int resultCode, char* resultString) {
+  delete[] resultString;
+  if (fState != CONNECTING) return;
+  if (resultCode != 0) {
+    fail("\"PLAY\" failed");
+    return;
+  }
+
+  fState = PLAYING;
+  fNumFailures = 0;
+  manager().fNumStreamsPlaying.fetch_add(1, std::memory_order_relaxed);
+  if (fHoldsConnectSlot) {
+    fHoldsConnectSlot = False;
+    fWorker.releaseConnectSlot();
+  }
+
+  // From now on, our watchdog checks that we keep receiving data:
+  envir().taskScheduler().unscheduleDelayedTask(fWatchdogTask);
+  fLastNumPacketsReceived = totNumPacketsReceived();
+  if (manager().fDataTimeoutSeconds > 0) {
+    fWatchdogTask = envir().taskScheduler()
+      .scheduleDelayedTask((int64_t)manager().fDataTimeoutSeconds*MILLION, watchdogHandler, this);
+  }
+}
+
+void ManagedStream::subsessionAfterPlaying(void* clientData) {
+  MediaSubsession* subsession = (MediaSubsession*)clientData;
+  ((ManagedStream*)(subsession->miscPtr))->fail("a track ended");
+}
+
+void ManagedStream::subsessionByeHandler(void* clientData) {
+  MediaSubsession* subsession = (MediaSubsession*)clientData;
+  ((ManagedStream*)(subsession->miscPtr))->fail("received RTCP \"BYE\"");
+}
+
+void ManagedStream::watchdogHandler(void* clientData) {
+  ((ManagedStream*)clientData)->watchdogHandler();
+}
+
+void ManagedStream::watchdogHandler() {
+  fWatchdogTask = NULL;
+  if (fState != PLAYING) {
+    fail("timed out while connecting");
+    return;
+  }
+
+  unsigned numPacketsReceived = totNumPacketsReceived();
+  if (numPacketsReceived == fLastNumPacketsReceived) {
+    fail("stopped receiving data");
+    return;
+  }
+  fLastNumPacketsReceived = numPacketsReceived;
+  fWatchdogTask = envir().taskScheduler()
+    .scheduleDelayedTask((int64_t)manager().fDataTimeoutSeconds*MILLION, watchdogHandler, this);
+}
+
+unsigned ManagedStream::totNumPacketsReceived() const {
+  unsigned result = 0;
+  for (unsigned i = 0; i < fNumSetupSubsessions; ++i) {
+    RTPSource* rtpSource = fSetupSubsessions[i]->rtpSource();
+    if (rtpSource != NULL) result += rtpSource->receptionStatsDB().totNumPacketsReceived();
+  }
+  return result;
+}
+
+void ManagedStream::fail(char const* reason) {
+  if (fState == FAILED) return; // we've already noted a failure
+
+  if (manager().fVerbosityLevel > 0) {
+    envir() << "RTSPClientManager: stream " << fId << " (\"" << fURL << "\"): " << reason << "; restarting\n";
+  }
+  if (fState == PLAYING) manager().fNumStreamsPlaying.fetch_sub(1, std::memory_order_relaxed);
+  fState = FAILED;
+
+  // We might have been called from within one of our "RTSPClient"'s response handlers, so don't close it now:
+  envir().taskScheduler().unscheduleDelayedTask(fWatchdogTask);
+  envir().taskScheduler().rescheduleDelayedTask(fStartTask, 0, restartHandler, this);
+}
+
+void ManagedStream::restartHandler(void* clientData) {
+  ((ManagedStream*)clientData)->restart();
+}
+
+void ManagedStream::restart() {
+  fStartTask = NULL;
+  stop();
+  manager().fNumStreamRestarts.fetch_add(1, std::memory_order_relaxed);
+
+  // Wait 1, 2, 4, ... 2^MAX_BACKOFF_SHIFT seconds (plus a random fraction of a second, so that streams that failed
+  // together don't all come back together) before starting again:
+  unsigned shift = fNumFailures < MAX_BACKOFF_SHIFT ? fNumFailures : MAX_BACKOFF_SHIFT;
+  ++fNumFailures;
+  int64_t uSecondsToDelay = (int64_t)(1<<shift)*MILLION + our_random()%MILLION;
+  fStartTask = envir().taskScheduler().scheduleDelayedTask(uSecondsToDelay, startHandler, this);
+}
+
+void ManagedStream::stop() {
+  envir().taskScheduler().unscheduleDelayedTask(fWatchdogTask);
+  if (fState == PLAYING) manager().fNumStreamsPlaying.fetch_sub(1, std::memory_order_relaxed);
+  fState = IDLE;
+  if (fHoldsConnectSlot) {
+    fHoldsConnectSlot = False;
+    fWorker.releaseConnectSlot();
+  }
+
+  if (fSession != NULL) {
+    Boolean someSubsessionsWereActive = False;
+    MediaSubsessionIterator iter(*fSession);
+    MediaSubsession* subsession;
+    while ((subsession = iter.next()) != NULL) {
+      if (subsession->sink != NULL) {
+	Medium::close(subsession->sink);
+	subsession->sink = NULL;
+	if (subsession->rtcpInstance() != NULL) subsession->rtcpInstance()->setByeHandler(NULL, NULL);
+      }
+      if (subsession->sessionId() != NULL) someSubsessionsWereActive = True;
+    }
+
+    if (someSubsessionsWereActive && fClient != NULL) {
+      // Send a "TEARDOWN", without waiting for a response:
+      fClient->sendTeardownCommand(*fSession, NULL, fAuthenticator);
+    }
+  }
+
+  Medium::close(fClient); fClient = NULL;
+  Medium::close(fSession); fSession = NULL;
+  delete[] fSetupSubsessions; fSetupSubsessions = NULL;
+  fNumSetupSubsessions = fNumSetupResponses = 0;
+}
+
+////////// RTSPClientManagerWorker implementation //////////
+
+RTSPClientManagerWorker::RTSPClientManagerWorker(RTSPClientManager& ourManager, unsigned workerNum)
+  : fOurManager(ourManager), fWorkerNum(workerNum),
+    fEnv(NULL), fCommandsTrigger(0), fStopTrigger(0), fStopRequested(0),
+    fStreams(HashTable::create(ONE_WORD_HASH_KEYS)), fNumConnecting(0), fWaitingHead(NULL), fWaitingTail(NULL),
+    fSetupIsDone(False), fSetupSucceeded(False), fQueueHead(NULL), fQueueTail(NULL) {
+}
+
+static void deleteWorkerCommand(WorkerCommand* command) {
+  delete[] command->rtspURL; delete[] command->username; delete[] command->password;
+  delete command;
+}
+
+RTSPClientManagerWorker::~RTSPClientManagerWorker() {
+  if (fThread.joinable()) {
+    if (waitForSetup()) fEnv->taskScheduler().triggerEvent(fStopTrigger, this);
+    fThread.join(); // the thread closes its own streams, and environment
+  } else if (fEnv != NULL) {
+    // We've been running in our manager's environment:
+    closeAllStreams();
+    fEnv->taskScheduler().deleteEventTrigger(fCommandsTrigger);
+    fEnv->taskScheduler().deleteEventTrigger(fStopTrigger);
+  }
+  delete fStreams;
+
+  while (fQueueHead != NULL) {
+    WorkerCommand* command = fQueueHead;
+    fQueueHead = command->next;
+    deleteWorkerCommand(command);
+  }
+}
+
+void RTSPClientManagerWorker::start(RTSPClientManager::WorkerEnvironmentCreationFunc* environmentCreationFunc) {
+  fThread = std::thread(&RTSPClientManagerWorker::run, this, environmentCreationFunc);
+}
+
+Boolean RTSPClientManagerWorker::startInEnvironment(UsageEnvironment& env) {
+  fEnv = &env;
+  fSetupIsDone = True;
+  fSetupSucceeded = createTriggers();
+  return fSetupSucceeded;
+}
+
+Boolean RTSPClientManagerWorker::createTriggers() {
+  fCommandsTrigger = fEnv->taskScheduler().createEventTrigger(commandsHandler);
+  fStopTrigger = fEnv->taskScheduler().createEventTrigger(stopHandler);
+  return fCommandsTrigger != 0 && fStopTrigger != 0;
+}
+
+Boolean RTSPClientManagerWorker::waitForSetup() {
+  std::unique_lock<std::mutex> lock(fLock);
+  while (!fSetupIsDone) fSetupWasDone.wait(lock);
+  return fSetupSucceeded;
+}
+
+void RTSPClientManagerWorker::run(RTSPClientManager::WorkerEnvironmentCreationFunc* environmentCreationFunc) {
+  // Everything in our environment is created (and later, deleted) by this thread:
+  fEnv = (*environmentCreationFunc)();
+  Boolean success = fEnv != NULL && createTriggers();
+
+  {
+    std::lock_guard<std::mutex> guard(fLock);
+    fSetupIsDone = True;
+    fSetupSucceeded = success;
+  }
+  fSetupWasDone.notify_all();
+
+  if (success) fEnv->taskScheduler().doEventLoop(&fStopRequested);
+
+  if (fEnv != NULL) {
+    closeAllStreams();
+    fEnv->taskScheduler().deleteEventTrigger(fCommandsTrigger);
+    fEnv->taskScheduler().deleteEventTrigger(fStopTrigger);
+
+    TaskScheduler* scheduler = &fEnv->taskScheduler();
+    fEnv->reclaim(); fEnv = NULL;
+    delete scheduler;
+  }
+}
+
+void RTSPClientManagerWorker::queueCommand(WorkerCommand* command) {
+  command->next = NULL;
+  {
+    std::lock_guard<std::mutex> guard(fLock);
+    if (fQueueTail == NULL) fQueueHead = command; else fQueueTail->next = command;
+    fQueueTail = command;
+  }
+  fEnv->taskScheduler().triggerEvent(fCommandsTrigger, this);
+}
+
+void RTSPClientManagerWorker::commandsHandler(void* clientData) {
+  ((RTSPClientManagerWorker*)clientData)->commandsHandler();
+}
+
+void RTSPClientManagerWorker::commandsHandler() {
+  WorkerCommand* command;
+  {
+    std::lock_guard<std::mutex> guard(fLock);
+    command = fQueueHead;
+    fQueueHead = fQueueTail = NULL;
+  }
+
+  while (command != NULL) {
+    WorkerCommand* next = command->next;
+    char const* key = (char const*)(uintptr_t)command->streamId;
+    ManagedStream* stream = (ManagedStream*)(fStreams->Lookup(key));
+
+    switch (command->kind) {
+      case WorkerCommand::ADD_STREAM: {
+	if (stream == NULL) {
+	  stream = new ManagedStream(*this, command->streamId, command->rtspURL, command->username, command->password);
+	  fStreams->Add(key, stream);
+	  stream->start();
+	}
+	break;
+      }
+      case WorkerCommand::REMOVE_STREAM: {
+	if (stream != NULL) removeStream(stream);
+	break;
+      }
+    }
+
+    deleteWorkerCommand(command);
+    command = next;
+  }
+}
+
+void RTSPClientManagerWorker::stopHandler(void* clientData) {
+  ((RTSPClientManagerWorker*)clientData)->fStopRequested = 1;
+}
+
+void RTSPClientManagerWorker::requestConnectSlot(ManagedStream* stream) {
+  if (fNumConnecting < fOurManager.fMaxConnectingStreamsPerWorker) {
+    ++fNumConnecting;
+    stream->beginConnect();
+  } else {
+    // Wait our turn:
+    stream->fNextWaiting = NULL;
+    if (fWaitingTail == NULL) fWaitingHead = stream; else fWaitingTail->fNextWaiting = stream;
+    fWaitingTail = stream;
+  }
+}
+
+void RTSPClientManagerWorker::releaseConnectSlot() {
+  --fNumConnecting;
+
+  if (fWaitingHead != NULL) {
+    ManagedStream* stream = fWaitingHead;
+    fWaitingHead = stream->fNextWaiting;
+    if (fWaitingHead == NULL) fWaitingTail = NULL;
+
+    ++fNumConnecting;
+    stream->beginConnect();
+  }
+}
+
+void RTSPClientManagerWorker::removeStream(ManagedStream* stream) {
+  // If the stream is waiting for a 'connect slot', then remove it from the waiting list:
+  ManagedStream* prev = NULL;
+  for (ManagedStream* s = fWaitingHead; s != NULL; prev = s, s = s->fNextWaiting) {
+    if (s == stream) {
+      if (prev == NULL) fWaitingHead = s->fNextWaiting; else prev->fNextWaiting = s->fNextWaiting;
+      if (fWaitingTail == s) fWaitingTail = prev;
+      break;
+    }
+  }
+
+  fStreams->Remove((char const*)(uintptr_t)stream->id());
+  delete stream;
+}
+
+void RTSPClientManagerWorker::closeAllStreams() {
+  // Empty the waiting list first, so that closing a stream that holds a 'connect slot' doesn't start another:
+  fWaitingHead = fWaitingTail = NULL;
+
+  ManagedStream* stream;
+  while ((stream = (ManagedStream*)fStreams->RemoveNext()) != NULL) {
+    delete stream;
+  }
+}
+
+////////// RTSPClientManager implementation //////////
+
+RTSPClientManager*
+RTSPClientManager::createNew(UsageEnvironment& env, unsigned numWorkers,
+			     WorkerEnvironmentCreationFunc* environmentCreationFunc,
+			     CreateSinkFunc* createSinkFunc, void* sinkClientData,
+			     unsigned maxConnectingStreamsPerWorker, Boolean streamUsingTCP,
+			     unsigned dataTimeoutSeconds, int verbosityLevel) {
+  if ((numWorkers > 0 && environmentCreationFunc == NULL) || createSinkFunc == NULL
+      || maxConnectingStreamsPerWorker == 0) {
+    env.setResultMsg("RTSPClientManager::createNew(): bad parameters");
+    return NULL;
+  }
+
+  RTSPClientManager* manager
+    = new RTSPClientManager(env, numWorkers, createSinkFunc, sinkClientData, maxConnectingStreamsPerWorker,
+			    streamUsingTCP, dataTimeoutSeconds, verbosityLevel);
+  if (!manager->startWorkers(environmentCreationFunc)) {
+    env.setResultMsg("RTSPClientManager::createNew(): failed to start the workers");
+    Medium::close(manager);
+    return NULL;
+  }
+  return manager;
+}
+
+RTSPClientManager
+::RTSPClientManager(UsageEnvironment& env, unsigned numWorkers, CreateSinkFunc* createSinkFunc, void* sinkClientData,
+		    unsigned maxConnectingStreamsPerWorker, Boolean streamUsingTCP, unsigned dataTimeoutSeconds,
+		    int verbosityLevel)
+  : Medium(env),
+    fNumWorkers(numWorkers), fWorkers(new RTSPClientManagerWorker*[numWorkers > 0 ? numWorkers : 1]),
+    fCreateSinkFunc(createSinkFunc), fSinkClientData(sinkClientData),
+    fMaxConnectingStreamsPerWorker(maxConnectingStreamsPerWorker), fStreamUsingTCP(streamUsingTCP),
+    fDataTimeoutSeconds(dataTimeoutSeconds), fVerbosityLevel(verbosityLevel),
+    fNextStreamId(0), fNumStreams(0), fNumStreamsPlaying(0), fNumStreamRestarts(0) {
+  unsigned const numWorkerObjects = fNumWorkers > 0 ? fNumWorkers : 1;
+  for (unsigned i = 0; i < numWorkerObjects; ++i) fWorkers[i] = new RTSPClientManagerWorker(*this, i);
+}
+
+RTSPClientManager::~RTSPClientManager() {
+  unsigned const numWorkerObjects = fNumWorkers > 0 ? fNumWorkers : 1;
+  for (unsigned i = 0; i < numWorkerObjects; ++i) delete fWorkers[i];
+  delete[] fWorkers;
+}
+
+Boolean RTSPClientManager::startWorkers(WorkerEnvironmentCreationFunc* environmentCreationFunc) {
+  if (fNumWorkers == 0) return fWorkers[0]->startInEnvironment(envir());
+
+  // Start all of the threads, before waiting for them:
+  unsigned i;
+  for (i = 0; i < fNumWorkers; ++i) fWorkers[i]->start(environmentCreationFunc);
+
+  Boolean success = True;
+  for (i = 0; i < fNumWorkers; ++i) {
+    if (!fWorkers[i]->waitForSetup()) success = False;
+  }
+  return success;
+}
+
+unsigned RTSPClientManager::addStream(char const* rtspURL, char const* username, char const* password) {
+  if (rtspURL == NULL) return 0;
+
+  unsigned streamId = fNextStreamId.fetch_add(1, std::memory_order_relaxed) + 1;
+  WorkerCommand* command = new WorkerCommand;
+  command->kind = WorkerCommand::ADD_STREAM;
+  command->streamId = streamId;
+  command->rtspURL = strDup(rtspURL);
+  command->username = strDup(username);
+  command->password = strDup(password);
+
+  unsigned const numWorkerObjects = fNumWorkers > 0 ? fNumWorkers : 1;
+  fWorkers[(streamId - 1)%numWorkerObjects]->queueCommand(command);
+  return streamId;
+}
+
+void RTSPClientManager::removeStream(unsigned streamId) {
+  if (streamId == 0) return;
+
+  WorkerCommand* command = new WorkerCommand;
+  command->kind = WorkerCommand::REMOVE_STREAM;
+  command->streamId = streamId;
+  command->rtspURL = command->username = command->password = NULL;
+
+  unsigned const numWorkerObjects = fNumWorkers > 0 ? fNumWorkers : 1;
+  fWorkers[(streamId - 1)%numWorkerObjects]->queueCommand(command);
+}
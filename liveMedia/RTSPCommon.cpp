@@ -86,16 +86,18 @@ Boolean parseRTSPRequestString(char const* reqStr,
   resultCmdName[i1] = '\0';
   if (!parseSucceeded) return False;
 
-  // Skip over the prefix of any "rtsp://" or "rtsp:/" URL that follows:
+  // Skip over the prefix of any "rtsp://" or "rtsp:/" (or "rtsps://" or "rtsps:/") URL that follows:
   unsigned j = i+1;
   while (j < reqStrSize && (reqStr[j] == ' ' || reqStr[j] == '\t')) ++j; // skip over any additional white space
   for (; (int)j < (int)(reqStrSize-8); ++j) {
     if ((reqStr[j] == 'r' || reqStr[j] == 'R')
 	&& (reqStr[j+1] == 't' || reqStr[j+1] == 'T')
 	&& (reqStr[j+2] == 's' || reqStr[j+2] == 'S')
-	&& (reqStr[j+3] == 'p' || reqStr[j+3] == 'P')
-	&& reqStr[j+4] == ':' && reqStr[j+5] == '/') {
-      j += 6;
+	&& (reqStr[j+3] == 'p' || reqStr[j+3] == 'P')) {
+      unsigned k = j+4;
+      if (reqStr[k] == 's' || reqStr[k] == 'S') ++k;
+      if (reqStr[k] != ':' || reqStr[k+1] != '/') continue;
+      j = k+2;
       if (reqStr[j] == '/') {
 	// This is a "rtsp://" URL; skip over the host:port part that follows:
 	++j;
@@ -22,6 +22,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "RTSPCommon.hh"
 #include "RTSPRegisterSender.hh"
 #include "Base64.hh"
+#include "PoolAllocator.hh"
 #include <GroupsockHelper.hh>
 
 ////////// RTSPServer implementation //////////
@@ -72,13 +73,13 @@ char *RTSPServer ::rtspURL(ServerMediaSession const *serverMediaSession, int cli
 
 char *RTSPServer::rtspURLPrefix(int clientSocket) const
 {
-  struct sockaddr_in ourAddress;
+  struct sockaddr_storage ourAddress;
   if (clientSocket < 0)
   {
     // Use our default IP address in the URL:
-    ourAddress.sin_addr.s_addr = ReceivingInterfaceAddr != 0
-                                     ? ReceivingInterfaceAddr
-                                     : ourIPAddress(envir()); // hack
+    setIPv4Address(ourAddress, ReceivingInterfaceAddr != 0
+                                   ? ReceivingInterfaceAddr
+                                   : ourIPAddress(envir())); // hack
   }
   else
   {
@@ -86,17 +87,24 @@ char *RTSPServer::rtspURLPrefix(int clientSocket) const
     getsockname(clientSocket, (struct sockaddr *)&ourAddress, &namelen);
   }
 
-  char urlBuffer[100]; // more than big enough for "rtsp://<ip-address>:<port>/"
+  char urlBuffer[100]; // more than big enough for "rtsps://[<ipv6-address>]:<port>/"
 
-  portNumBits portNumHostOrder = ntohs(fServerPort.num());
-  if (portNumHostOrder == 554 /* the default port number */)
+  // An IPv6 address must be enclosed in brackets within a URL:
+  char const *addrFormat = ourAddress.ss_family == AF_INET6 ? "[%s]" : "%s";
+  char addrBuffer[INET6_ADDRSTRLEN + 2];
+  sprintf(addrBuffer, addrFormat, AddressString(ourAddress).val());
+
+  Boolean const usesTLS = clientSocket >= 0 && TLSState::lookup(envir(), clientSocket) != NULL;
+  char const *scheme = usesTLS ? "rtsps" : "rtsp";
+  portNumBits portNumHostOrder = usesTLS ? tlsServerPortNum() : ntohs(fServerPort.num());
+  if (portNumHostOrder == (usesTLS ? RTSPS_DEFAULT_PORT_NUM : 554) /* the default port number */)
   {
-    sprintf(urlBuffer, "rtsp://%s/", AddressString(ourAddress).val());
+    sprintf(urlBuffer, "%s://%s/", scheme, addrBuffer);
   }
   else
   {
-    sprintf(urlBuffer, "rtsp://%s:%hu/",
-            AddressString(ourAddress).val(), portNumHostOrder);
+    sprintf(urlBuffer, "%s://%s:%hu/",
+            scheme, addrBuffer, portNumHostOrder);
   }
 
   return strDup(urlBuffer);
@@ -140,13 +148,13 @@ UserAuthenticationDatabase *RTSPServer::getAuthenticationDatabaseForCommand(char
   return fAuthDB;
 }
 
-Boolean RTSPServer::specialClientAccessCheck(int /*clientSocket*/, struct sockaddr_in & /*clientAddr*/, char const * /*urlSuffix*/)
+Boolean RTSPServer::specialClientAccessCheck(int /*clientSocket*/, struct sockaddr_storage & /*clientAddr*/, char const * /*urlSuffix*/)
 {
   // default implementation
   return True;
 }
 
-Boolean RTSPServer::specialClientUserAccessCheck(int /*clientSocket*/, struct sockaddr_in & /*clientAddr*/,
+Boolean RTSPServer::specialClientUserAccessCheck(int /*clientSocket*/, struct sockaddr_storage & /*clientAddr*/,
                                                  char const * /*urlSuffix*/, char const * /*username*/)
 {
   // default implementation; no further access restrictions:
@@ -162,13 +170,14 @@ RTSPServer::RTSPServer(UsageEnvironment &env,
       fClientConnectionsForHTTPTunneling(NULL), // will get created if needed
       fTCPStreamingDatabase(HashTable::create(ONE_WORD_HASH_KEYS)),
       fPendingRegisterOrDeregisterRequests(HashTable::create(ONE_WORD_HASH_KEYS)),
-      fRegisterOrDeregisterRequestCounter(0), fAuthDB(authDatabase), fAllowStreamingRTPOverTCP(True)
+      fRegisterOrDeregisterRequestCounter(0), fAuthDB(authDatabase), fAllowStreamingRTPOverTCP(True),
+      fAllowSRTPKeysWithoutTLS(False)
 {
 }
 
 // A data structure that is used to implement "fTCPStreamingDatabase"
 // (and the "noteTCPStreamingOnSocket()" and "stopTCPStreamingOnSocket()" member functions):
-class streamingOverTCPRecord
+class streamingOverTCPRecord : public PoolAllocatedObject
 {
 public:
   streamingOverTCPRecord(u_int32_t sessionId, unsigned trackNum, streamingOverTCPRecord *next)
@@ -229,7 +238,7 @@ void RTSPServer::incomingConnectionHandlerHTTP()
 void RTSPServer ::noteTCPStreamingOnSocket(int socketNum, RTSPClientSession *clientSession, unsigned trackNum)
 {
   streamingOverTCPRecord *sotcpCur = (streamingOverTCPRecord *)fTCPStreamingDatabase->Lookup((char const *)socketNum);
-  streamingOverTCPRecord *sotcpNew = new streamingOverTCPRecord(clientSession->fOurSessionId, trackNum, sotcpCur);
+  streamingOverTCPRecord *sotcpNew = new (envir()) streamingOverTCPRecord(clientSession->fOurSessionId, trackNum, sotcpCur);
   fTCPStreamingDatabase->Add((char const *)socketNum, sotcpNew);
 }
 
@@ -306,10 +315,11 @@ void RTSPServer::stopTCPStreamingOnSocket(int socketNum)
 
 ////////// RTSPServer::RTSPClientConnection implementation //////////
 
-RTSPServer::RTSPClientConnection ::RTSPClientConnection(RTSPServer &ourServer, int clientSocket, struct sockaddr_in clientAddr)
+RTSPServer::RTSPClientConnection ::RTSPClientConnection(RTSPServer &ourServer, int clientSocket, struct sockaddr_storage const &clientAddr)
     : GenericMediaServer::ClientConnection(ourServer, clientSocket, clientAddr),
       fOurRTSPServer(ourServer), fClientInputSocket(fOurSocket), fClientOutputSocket(fOurSocket),
-      fIsActive(True), fRecursionCount(0), fOurSessionCookie(NULL)
+      fIsActive(True), fRecursionCount(0), fOurSessionCookie(NULL),
+      fOutputQueue(NULL), fOutputQueueSize(0), fOutputQueueHead(0), fOutputQueueTail(0)
 {
   resetRequestBuffer();
 }
@@ -324,14 +334,14 @@ RTSPServer::RTSPClientConnection::~RTSPClientConnection()
   }
 
   closeSocketsRTSP();
+  delete[] fOutputQueue;
 }
 
 // Handler routines for specific RTSP commands:
 
 void RTSPServer::RTSPClientConnection::handleCmd_OPTIONS()
 {
-  snprintf((char *)fResponseBuffer, sizeof fResponseBuffer,
-           "RTSP/1.0 200 OK\r\nCSeq: %s\r\n%sPublic: %s\r\n\r\n",
+  formatResponse("RTSP/1.0 200 OK\r\nCSeq: %s\r\n%sPublic: %s\r\n\r\n",
            fCurrentCSeq, dateHeader(), fOurRTSPServer.allowedCommandNames());
 }
 
@@ -351,6 +361,23 @@ void RTSPServer::RTSPClientConnection ::handleCmd_SET_PARAMETER(char const * /*f
   setRTSPResponse("200 OK");
 }
 
+static Boolean sessionUsesSRTP(ServerMediaSession *session)
+{
+  ServerMediaSubsessionIterator iter(*session);
+  ServerMediaSubsession *subsession;
+  while ((subsession = iter.next()) != NULL)
+  {
+    if (subsession->usesSRTP())
+      return True;
+  }
+  return False;
+}
+
+Boolean RTSPServer::RTSPClientConnection::maySendSRTPKeys() const
+{
+  return fTLSState != NULL || fOurRTSPServer.fAllowSRTPKeysWithoutTLS;
+}
+
 void RTSPServer::RTSPClientConnection ::handleCmd_DESCRIBE(char const *urlPreSuffix, char const *urlSuffix, char const *fullRequestStr)
 {
   ServerMediaSession *session = NULL;
@@ -386,8 +413,15 @@ void RTSPServer::RTSPClientConnection ::handleCmd_DESCRIBE(char const *urlPreSuf
     // while we're using it:
     session->incrementReferenceCount();
 
+    // Our SDP description would contain the session's SRTP master key (in the clear), so send it only if it's safe:
+    if (sessionUsesSRTP(session) && !maySendSRTPKeys())
+    {
+      setRTSPResponse("403 Forbidden");
+      break;
+    }
+
     // Then, assemble a SDP description for this session:
-    sdpDescription = session->generateSDPDescription();
+    sdpDescription = session->generateSDPDescription(fClientAddr.ss_family);
     if (sdpDescription == NULL)
     {
       // This usually means that a file name that was specified for a
@@ -401,8 +435,7 @@ void RTSPServer::RTSPClientConnection ::handleCmd_DESCRIBE(char const *urlPreSuf
     // (which is necessary to ensure that the correct URL gets used in subsequent "SETUP" requests).
     rtspURL = fOurRTSPServer.rtspURL(session, fClientInputSocket);
 
-    snprintf((char *)fResponseBuffer, sizeof fResponseBuffer,
-             "RTSP/1.0 200 OK\r\nCSeq: %s\r\n"
+    formatResponse("RTSP/1.0 200 OK\r\nCSeq: %s\r\n"
              "%s"
              "Content-Base: %s/\r\n"
              "Content-Type: application/sdp\r\n"
@@ -463,15 +496,13 @@ static void lookForHeader(char const *headerName, char const *source, unsigned s
 void RTSPServer::RTSPClientConnection::handleCmd_bad()
 {
   // Don't do anything with "fCurrentCSeq", because it might be nonsense
-  snprintf((char *)fResponseBuffer, sizeof fResponseBuffer,
-           "RTSP/1.0 400 Bad Request\r\n%sAllow: %s\r\n\r\n",
+  formatResponse("RTSP/1.0 400 Bad Request\r\n%sAllow: %s\r\n\r\n",
            dateHeader(), fOurRTSPServer.allowedCommandNames());
 }
 
 void RTSPServer::RTSPClientConnection::handleCmd_notSupported()
 {
-  snprintf((char *)fResponseBuffer, sizeof fResponseBuffer,
-           "RTSP/1.0 405 Method Not Allowed\r\nCSeq: %s\r\n%sAllow: %s\r\n\r\n",
+  formatResponse("RTSP/1.0 405 Method Not Allowed\r\nCSeq: %s\r\n%sAllow: %s\r\n\r\n",
            fCurrentCSeq, dateHeader(), fOurRTSPServer.allowedCommandNames());
 }
 
@@ -556,15 +587,13 @@ Boolean RTSPServer::RTSPClientConnection::parseHTTPRequestString(char *resultCmd
 
 void RTSPServer::RTSPClientConnection::handleHTTPCmd_notSupported()
 {
-  snprintf((char *)fResponseBuffer, sizeof fResponseBuffer,
-           "HTTP/1.1 405 Method Not Allowed\r\n%s\r\n\r\n",
+  formatResponse("HTTP/1.1 405 Method Not Allowed\r\n%s\r\n\r\n",
            dateHeader());
 }
 
 void RTSPServer::RTSPClientConnection::handleHTTPCmd_notFound()
 {
-  snprintf((char *)fResponseBuffer, sizeof fResponseBuffer,
-           "HTTP/1.1 404 Not Found\r\n%s\r\n\r\n",
+  formatResponse("HTTP/1.1 404 Not Found\r\n%s\r\n\r\n",
            dateHeader());
 }
 
@@ -574,8 +603,7 @@ void RTSPServer::RTSPClientConnection::handleHTTPCmd_OPTIONS()
   fprintf(stderr, "Handled HTTP \"OPTIONS\" request\n");
 #endif
   // Construct a response to the "OPTIONS" command that notes that our special headers (for RTSP-over-HTTP tunneling) are allowed:
-  snprintf((char *)fResponseBuffer, sizeof fResponseBuffer,
-           "HTTP/1.1 200 OK\r\n"
+  formatResponse("HTTP/1.1 200 OK\r\n"
            "%s"
            "Access-Control-Allow-Origin: *\r\n"
            "Access-Control-Allow-Methods: POST, GET, OPTIONS\r\n"
@@ -601,8 +629,7 @@ void RTSPServer::RTSPClientConnection::handleHTTPCmd_TunnelingGET(char const *se
 #endif
 
   // Construct our response:
-  snprintf((char *)fResponseBuffer, sizeof fResponseBuffer,
-           "HTTP/1.1 200 OK\r\n"
+  formatResponse("HTTP/1.1 200 OK\r\n"
            "%s"
            "Cache-Control: no-cache\r\n"
            "Pragma: no-cache\r\n"
@@ -651,11 +678,32 @@ void RTSPServer::RTSPClientConnection::resetRequestBuffer()
   fBase64RemainderCount = 0;
 }
 
+Boolean RTSPServer::RTSPClientConnection::requestBufferMayBeReallocated() const
+{
+  // While we're handling a request, our callers may hold pointers into "fRequestBuffer":
+  return fRecursionCount == 0;
+}
+
+void RTSPServer::RTSPClientConnection::requestBufferWasReallocated(unsigned char *oldBuffer)
+{
+  if (oldBuffer == NULL)
+  {
+    resetRequestBuffer(); // our buffer is new
+  }
+  else
+  {
+    fLastCRLF = &fRequestBuffer[fLastCRLF - oldBuffer];
+  }
+}
+
 void RTSPServer::RTSPClientConnection::closeSocketsRTSP()
 {
   // First, tell our server to stop any streaming that it might be doing over our output socket:
   fOurRTSPServer.stopTCPStreamingOnSocket(fClientOutputSocket);
 
+  // Any response data that we haven't yet sent can no longer be sent:
+  fOutputQueueHead = fOutputQueueTail = 0;
+
   // Turn off background handling on our input socket (and output socket, if different); then close it (or them):
   if (fClientOutputSocket != fClientInputSocket)
   {
@@ -667,6 +715,185 @@ void RTSPServer::RTSPClientConnection::closeSocketsRTSP()
   closeSockets(); // closes fClientInputSocket
 }
 
+#ifndef RTSP_MAX_OUTPUT_QUEUE_SIZE
+#define RTSP_MAX_OUTPUT_QUEUE_SIZE 1000000
+#endif
+#ifndef RTSP_RESPONSE_BLOCKING_WRITE_TIMEOUT_MS
+#define RTSP_RESPONSE_BLOCKING_WRITE_TIMEOUT_MS 500
+#endif
+
+void RTSPServer::RTSPClientConnection::sendResponse()
+{
+  unsigned const responseSize = strlen((char *)fResponseBuffer);
+  if (responseSize == 0)
+    return; // the response has already been sent (or there's no response)
+
+  Boolean const wereWaitingToSend = haveQueuedOutput();
+  unsigned numBytesSent = 0;
+  if (!wereWaitingToSend)
+  {
+    // Common case: Try to send the whole response now:
+    int sendResult = sendToClient(fResponseBuffer, responseSize);
+    if (sendResult == (int)responseSize)
+      return;
+    if (sendResult < 0)
+      return; // the connection has failed; we'll notice this when we next try to read from it
+    numBytesSent = (unsigned)sendResult;
+  }
+
+  // Queue the rest of the response, to be sent once the socket becomes writable:
+  if (!enqueueOutput(&fResponseBuffer[numBytesSent], responseSize - numBytesSent))
+  {
+    // The client isn't reading our responses.  Give up on it:
+    fIsActive = False;
+    return;
+  }
+
+  if (fOurRTSPServer.fTCPStreamingDatabase->Lookup((char const *)(long)fClientOutputSocket) != NULL)
+  {
+    // Our output socket is also being used to stream RTP/RTCP-over-TCP (whose packets are sent synchronously, and whose
+    // reads are handled elsewhere), so we can't wait for it to become writable.  Instead, send our queued data now:
+    finishSendingQueuedOutput();
+    if (wereWaitingToSend)
+      updateOutputSocketHandling(); // because we had changed our socket's handling while waiting
+  }
+  else
+  {
+    updateOutputSocketHandling();
+  }
+}
+
+int RTSPServer::RTSPClientConnection::sendToClient(u_int8_t const *data, unsigned dataSize)
+{
+  // (A connection that uses TLS is never used for RTSP-over-HTTP tunneling, so its output socket is its own socket.)
+  if (fTLSState != NULL)
+    return fTLSState->write(data, dataSize);
+
+  int sendResult = send(fClientOutputSocket, (char const *)data, dataSize, 0);
+  if (sendResult < 0)
+  {
+    // (On Windows, "EAGAIN" and "EWOULDBLOCK" are both defined - in "NetCommon.h" - as "WSAEWOULDBLOCK".)
+    int const err = envir().getErrno();
+    if (err == EAGAIN || err == EWOULDBLOCK || err == EINTR)
+      return 0; // try again later
+  }
+  return sendResult;
+}
+
+void RTSPServer::RTSPClientConnection::sendResponseNow()
+{
+  sendResponse();
+  if (haveQueuedOutput())
+  {
+    finishSendingQueuedOutput();
+    updateOutputSocketHandling(); // because "sendResponse()" had changed our socket's handling
+  }
+  fResponseBuffer[0] = '\0'; // tells our caller's caller not to send the response again
+}
+
+Boolean RTSPServer::RTSPClientConnection::enqueueOutput(u_int8_t const *data, unsigned dataSize)
+{
+  if (fOutputQueueTail + dataSize > fOutputQueueSize)
+  {
+    // Move the queued data to the start of the queue, and (if necessary) enlarge it:
+    unsigned const numQueuedBytes = fOutputQueueTail - fOutputQueueHead;
+    if (numQueuedBytes + dataSize > RTSP_MAX_OUTPUT_QUEUE_SIZE)
+      return False;
+
+    unsigned newSize = fOutputQueueSize;
+    if (numQueuedBytes + dataSize > newSize)
+    {
+      newSize = 2 * (numQueuedBytes + dataSize);
+      if (newSize > RTSP_MAX_OUTPUT_QUEUE_SIZE)
+        newSize = RTSP_MAX_OUTPUT_QUEUE_SIZE;
+    }
+    u_int8_t *newQueue = newSize == fOutputQueueSize ? fOutputQueue : new u_int8_t[newSize];
+    memmove(newQueue, &fOutputQueue[fOutputQueueHead], numQueuedBytes);
+    if (newQueue != fOutputQueue)
+    {
+      delete[] fOutputQueue;
+      fOutputQueue = newQueue;
+      fOutputQueueSize = newSize;
+    }
+    fOutputQueueHead = 0;
+    fOutputQueueTail = numQueuedBytes;
+  }
+
+  memmove(&fOutputQueue[fOutputQueueTail], data, dataSize);
+  fOutputQueueTail += dataSize;
+  return True;
+}
+
+void RTSPServer::RTSPClientConnection::outputSocketWritableHandler(void *instance, int /*mask*/)
+{
+  RTSPClientConnection *connection = (RTSPClientConnection *)instance;
+  connection->sendQueuedOutput();
+}
+
+void RTSPServer::RTSPClientConnection::sendQueuedOutput()
+{
+  while (haveQueuedOutput())
+  {
+    int sendResult = sendToClient(&fOutputQueue[fOutputQueueHead], fOutputQueueTail - fOutputQueueHead);
+    if (sendResult < 0)
+    {
+      // The connection has failed.  Treat this like a failed read, which terminates the connection:
+      fOutputQueueHead = fOutputQueueTail = 0;
+      handleRequestBytes(-1); // Note: This deletes "this"
+      return;
+    }
+    if (sendResult <= 0)
+      break; // the socket isn't writable after all; try again later
+
+    fOutputQueueHead += sendResult;
+  }
+
+  if (!haveQueuedOutput())
+    fOutputQueueHead = fOutputQueueTail = 0;
+  updateOutputSocketHandling();
+}
+
+void RTSPServer::RTSPClientConnection::finishSendingQueuedOutput()
+{
+  if (!haveQueuedOutput())
+    return;
+
+  makeSocketBlocking(fClientOutputSocket, RTSP_RESPONSE_BLOCKING_WRITE_TIMEOUT_MS);
+  while (haveQueuedOutput())
+  {
+    int sendResult = sendToClient(&fOutputQueue[fOutputQueueHead], fOutputQueueTail - fOutputQueueHead);
+    if (sendResult <= 0)
+      break; // the send failed, or timed out; give up on the remaining data
+    fOutputQueueHead += sendResult;
+  }
+  makeSocketNonBlocking(fClientOutputSocket);
+
+  fOutputQueueHead = fOutputQueueTail = 0;
+}
+
+void RTSPServer::RTSPClientConnection::updateOutputSocketHandling()
+{
+  if (fClientOutputSocket < 0)
+    return;
+
+  if (haveQueuedOutput())
+  {
+    // Wait until we can send more.  (If our input and output sockets are the same, this also stops us from reading
+    // - and responding to - further requests until our current response has been sent.)
+    envir().taskScheduler().setBackgroundHandling(fClientOutputSocket, SOCKET_WRITABLE,
+                                                  outputSocketWritableHandler, this);
+  }
+  else if (fClientOutputSocket == fClientInputSocket)
+  {
+    envir().taskScheduler().setBackgroundHandling(fClientInputSocket, SOCKET_READABLE | SOCKET_EXCEPTION,
+                                                  incomingRequestHandler, this);
+  }
+  else
+  {
+    envir().taskScheduler().disableBackgroundHandling(fClientOutputSocket);
+  }
+}
+
 void RTSPServer::RTSPClientConnection::handleAlternativeRequestByte(void *instance, u_int8_t requestByte)
 {
   RTSPClientConnection *connection = (RTSPClientConnection *)instance;
@@ -685,11 +912,15 @@ void RTSPServer::RTSPClientConnection::handleAlternativeRequestByte1(u_int8_t re
     // Another hack: The new handler of the input TCP socket no longer needs it, so take back control of it:
     envir().taskScheduler().setBackgroundHandling(fClientInputSocket, SOCKET_READABLE | SOCKET_EXCEPTION,
                                                   incomingRequestHandler, this);
+    if (haveQueuedOutput())
+      updateOutputSocketHandling(); // we're still waiting to send some response data
+    if (fTLSState != NULL)
+      fTLSState->continueReadingIfBuffered(incomingRequestHandler, this);
   }
   else
   {
     // Normal case: Add this character to our buffer; then try to handle the data that we have buffered so far:
-    if (fRequestBufferBytesLeft == 0 || fRequestBytesAlreadySeen >= REQUEST_BUFFER_SIZE)
+    if (!ensureRequestBufferSpace())
       return;
     fRequestBuffer[fRequestBytesAlreadySeen] = requestByte;
     handleRequestBytes(1);
@@ -799,6 +1030,8 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead)
     if (!endOfMsg)
       break; // subsequent reads will be needed to complete the request
 
+    ensureResponseBuffer();
+
     // Parse the request string into command name and 'CSeq', then handle the command:
     fRequestBuffer[fRequestBytesAlreadySeen] = '\0';
     char cmdName[RTSP_PARAM_STRING_MAX];
@@ -992,6 +1225,12 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead)
         {
           handleHTTPCmd_OPTIONS();
         }
+        else if (fTLSState != NULL)
+        {
+          // We don't support HTTP streaming, or RTSP-over-HTTP tunneling, over TLS: Each would use our socket directly
+          // (and tunneling would hand the "POST" connection's socket - without its TLS state - to the "GET" connection):
+          isValidHTTPCmd = False;
+        }
         else if (sessionCookie[0] == '\0')
         {
           // There was no "x-sessioncookie:" header.  If there was an "Accept: application/x-rtsp-tunnelled" header,
@@ -1043,7 +1282,7 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead)
 #ifdef DEBUG
     fprintf(stderr, "sending response: %s", fResponseBuffer);
 #endif
-    send(fClientOutputSocket, (char const *)fResponseBuffer, strlen((char *)fResponseBuffer), 0);
+    sendResponse();
 
     if (playAfterSetup)
     {
@@ -1066,6 +1305,11 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead)
   } while (numBytesRemaining > 0);
 
   --fRecursionCount;
+  if (fIsActive && fRecursionCount == 0 && fRequestBytesAlreadySeen == 0)
+  {
+    // We have no partial request buffered, so give back our buffers until the next request arrives:
+    releaseBuffers();
+  }
   if (!fIsActive)
   {
     if (fRecursionCount > 0)
@@ -1238,8 +1482,7 @@ Boolean RTSPServer::RTSPClientConnection ::authenticationOK(char const *cmdName,
   // If we get here, we failed to authenticate the user.
   // Send back a "401 Unauthorized" response, with a new random nonce:
   fCurrentAuthenticator.setRealmAndRandomNonce(authDB->realm());
-  snprintf((char *)fResponseBuffer, sizeof fResponseBuffer,
-           "RTSP/1.0 401 Unauthorized\r\n"
+  formatResponse("RTSP/1.0 401 Unauthorized\r\n"
            "CSeq: %s\r\n"
            "%s"
            "WWW-Authenticate: Digest realm=\"%s\", nonce=\"%s\"\r\n\r\n",
@@ -1251,8 +1494,7 @@ Boolean RTSPServer::RTSPClientConnection ::authenticationOK(char const *cmdName,
 
 void RTSPServer::RTSPClientConnection ::setRTSPResponse(char const *responseStr)
 {
-  snprintf((char *)fResponseBuffer, sizeof fResponseBuffer,
-           "RTSP/1.0 %s\r\n"
+  formatResponse("RTSP/1.0 %s\r\n"
            "CSeq: %s\r\n"
            "%s\r\n",
            responseStr,
@@ -1262,8 +1504,7 @@ void RTSPServer::RTSPClientConnection ::setRTSPResponse(char const *responseStr)
 
 void RTSPServer::RTSPClientConnection ::setRTSPResponse(char const *responseStr, u_int32_t sessionId)
 {
-  snprintf((char *)fResponseBuffer, sizeof fResponseBuffer,
-           "RTSP/1.0 %s\r\n"
+  formatResponse("RTSP/1.0 %s\r\n"
            "CSeq: %s\r\n"
            "%s"
            "Session: %08X\r\n\r\n",
@@ -1279,8 +1520,7 @@ void RTSPServer::RTSPClientConnection ::setRTSPResponse(char const *responseStr,
     contentStr = "";
   unsigned const contentLen = strlen(contentStr);
 
-  snprintf((char *)fResponseBuffer, sizeof fResponseBuffer,
-           "RTSP/1.0 %s\r\n"
+  formatResponse("RTSP/1.0 %s\r\n"
            "CSeq: %s\r\n"
            "%s"
            "Content-Length: %d\r\n\r\n"
@@ -1298,8 +1538,7 @@ void RTSPServer::RTSPClientConnection ::setRTSPResponse(char const *responseStr,
     contentStr = "";
   unsigned const contentLen = strlen(contentStr);
 
-  snprintf((char *)fResponseBuffer, sizeof fResponseBuffer,
-           "RTSP/1.0 %s\r\n"
+  formatResponse("RTSP/1.0 %s\r\n"
            "CSeq: %s\r\n"
            "%s"
            "Session: %08X\r\n"
@@ -1321,7 +1560,7 @@ void RTSPServer::RTSPClientConnection ::changeClientInputSocket(int newSocketNum
                                                 incomingRequestHandler, this);
 
   // Also write any extra data to our buffer, and handle it:
-  if (extraDataSize > 0 && extraDataSize <= fRequestBufferBytesLeft /*sanity check; should always be true*/)
+  if (extraDataSize > 0 && ensureRequestBufferSpace(extraDataSize) && extraDataSize <= fRequestBufferBytesLeft /*sanity check; should always be true*/)
   {
     unsigned char *ptr = &fRequestBuffer[fRequestBytesAlreadySeen];
     for (unsigned i = 0; i < extraDataSize; ++i)
@@ -1395,6 +1634,7 @@ typedef enum StreamingMode
 static void parseTransportHeader(char const *buf,
                                  StreamingMode &streamingMode,
                                  char *&streamingModeString,
+                                 Boolean &usesSRTP,
                                  char *&destinationAddressStr,
                                  u_int8_t &destinationTTL,
                                  portNumBits &clientRTPPortNum,  // if UDP
@@ -1406,6 +1646,7 @@ static void parseTransportHeader(char const *buf,
   // Initialize the result parameters to default values:
   streamingMode = RTP_UDP;
   streamingModeString = NULL;
+  usesSRTP = False;
   destinationAddressStr = NULL;
   destinationTTL = 255;
   clientRTPPortNum = 0;
@@ -1438,6 +1679,15 @@ static void parseTransportHeader(char const *buf,
     {
       streamingMode = RTP_TCP;
     }
+    else if (strcmp(field, "RTP/SAVP/TCP") == 0)
+    {
+      streamingMode = RTP_TCP;
+      usesSRTP = True;
+    }
+    else if (strcmp(field, "RTP/SAVP") == 0 || strcmp(field, "RTP/SAVP/UDP") == 0)
+    {
+      usesSRTP = True;
+    }
     else if (strcmp(field, "RAW/RAW/UDP") == 0 ||
              strcmp(field, "MP2T/H2221/UDP") == 0)
     {
@@ -1606,6 +1856,13 @@ void RTSPServer::RTSPClientSession ::handleCmd_SETUP(RTSPServer::RTSPClientConne
     }
     // ASSERT: subsession != NULL
 
+    // Our response would contain the stream's SRTP master key (in the clear), so send it only if it's safe:
+    if (subsession->usesSRTP() && !ourClientConnection->maySendSRTPKeys())
+    {
+      ourClientConnection->setRTSPResponse("403 Forbidden");
+      break;
+    }
+
     void *&token = fStreamStates[trackNum].streamToken; // alias
     if (token != NULL)
     {
@@ -1619,11 +1876,12 @@ void RTSPServer::RTSPClientSession ::handleCmd_SETUP(RTSPServer::RTSPClientConne
     // Look for a "Transport:" header in the request string, to extract client parameters:
     StreamingMode streamingMode;
     char *streamingModeString = NULL; // set when RAW_UDP streaming is specified
+    Boolean usesSRTP;                 // set when the client asked for "RTP/SAVP" (which we then echo back)
     char *clientsDestinationAddressStr;
     u_int8_t clientsDestinationTTL;
     portNumBits clientRTPPortNum, clientRTCPPortNum;
     unsigned char rtpChannelId, rtcpChannelId;
-    parseTransportHeader(fullRequestStr, streamingMode, streamingModeString,
+    parseTransportHeader(fullRequestStr, streamingMode, streamingModeString, usesSRTP,
                          clientsDestinationAddressStr, clientsDestinationTTL,
                          clientRTPPortNum, clientRTCPPortNum,
                          rtpChannelId, rtcpChannelId);
@@ -1672,7 +1930,7 @@ void RTSPServer::RTSPClientSession ::handleCmd_SETUP(RTSPServer::RTSPClientConne
       fStreamStates[trackNum].tcpSocketNum = ourClientConnection->fClientOutputSocket;
       fOurRTSPServer.noteTCPStreamingOnSocket(fStreamStates[trackNum].tcpSocketNum, this, trackNum);
     }
-    netAddressBits destinationAddress = 0;
+    struct sockaddr_storage destinationAddress = nullAddress(ourClientConnection->fClientAddr.ss_family);
     u_int8_t destinationTTL = 255;
 #ifdef RTSP_ALLOW_CLIENT_DESTINATION_SETTING
     if (clientsDestinationAddressStr != NULL)
@@ -1681,7 +1939,9 @@ void RTSPServer::RTSPClientSession ::handleCmd_SETUP(RTSPServer::RTSPClientConne
       // Note: This potentially allows the server to be used in denial-of-service
       // attacks, so don't enable this code unless you're sure that clients are
       // trusted.
-      destinationAddress = our_inet_addr(clientsDestinationAddressStr);
+      NetAddressList destinations(clientsDestinationAddressStr, ourClientConnection->fClientAddr.ss_family);
+      if (destinations.numAddresses() > 0)
+        copyAddress(destinationAddress, destinations.firstAddress());
     }
     // Also use the client-provided TTL.
     destinationTTL = clientsDestinationTTL;
@@ -1691,17 +1951,18 @@ void RTSPServer::RTSPClientSession ::handleCmd_SETUP(RTSPServer::RTSPClientConne
     Port serverRTCPPort(0);
 
     // Make sure that we transmit on the same interface that's used by the client (in case we're a multi-homed server):
-    struct sockaddr_in sourceAddr;
+    struct sockaddr_storage sourceAddr;
     SOCKLEN_T namelen = sizeof sourceAddr;
     getsockname(ourClientConnection->fClientInputSocket, (struct sockaddr *)&sourceAddr, &namelen);
     netAddressBits origSendingInterfaceAddr = SendingInterfaceAddr;
     netAddressBits origReceivingInterfaceAddr = ReceivingInterfaceAddr;
     // NOTE: The following might not work properly, so we ifdef it out for now:
 #ifdef HACK_FOR_MULTIHOMED_SERVERS
-    ReceivingInterfaceAddr = SendingInterfaceAddr = sourceAddr.sin_addr.s_addr;
+    if (sourceAddr.ss_family == AF_INET) // "SendingInterfaceAddr" and "ReceivingInterfaceAddr" are IPv4 only
+      ReceivingInterfaceAddr = SendingInterfaceAddr = ipv4Address(sourceAddr);
 #endif
 
-    subsession->getStreamParameters(fOurSessionId, ourClientConnection->fClientAddr.sin_addr.s_addr,
+    subsession->getStreamParameters(fOurSessionId, ourClientConnection->fClientAddr,
                                     clientRTPPort, clientRTCPPort,
                                     fStreamStates[trackNum].tcpSocketNum, rtpChannelId, rtcpChannelId,
                                     destinationAddress, destinationTTL, fIsMulticast,
@@ -1709,6 +1970,37 @@ void RTSPServer::RTSPClientSession ::handleCmd_SETUP(RTSPServer::RTSPClientConne
                                     fStreamStates[trackNum].streamToken);
     SendingInterfaceAddr = origSendingInterfaceAddr;
     ReceivingInterfaceAddr = origReceivingInterfaceAddr;
+    if (streamingMode != RTP_TCP && !fIsMulticast && fStreamStates[trackNum].streamToken == NULL &&
+        serverRTPPort.num() == 0)
+    {
+      // The subsession can't stream to this client over UDP (e.g., because its stream is shared, and its sockets are
+      // of the other address family):
+      ourClientConnection->handleCmd_unsupportedTransport();
+      break;
+    }
+
+    // If the stream uses SRTP, then also send a MIKEY message for it - in a "KeyMgmt:" header (RFC 4567, section 6) -
+    // because (e.g., if the stream is shared) its SSRC and rollover counter may differ from those in our SDP description:
+    char *keyMgmtURL = NULL;
+    char *keyMgmtHeader = NULL;
+    unsigned mikeyMessageSize;
+    u_int8_t *mikeyMessage = subsession->getMIKEYMessage(fStreamStates[trackNum].streamToken, mikeyMessageSize);
+    if (mikeyMessage != NULL)
+    {
+      keyMgmtURL = fOurRTSPServer.rtspURL(fOurServerMediaSession, ourClientConnection->fClientInputSocket);
+      char *base64Message = base64Encode((char const *)mikeyMessage, mikeyMessageSize);
+      char const *const keyMgmtFmt = "KeyMgmt: prot=mikey; uri=\"%s/%s\"; data=\"%s\"\r\n";
+      keyMgmtHeader = new char[strlen(keyMgmtFmt) + strlen(keyMgmtURL) + strlen(subsession->trackId()) +
+                               strlen(base64Message)];
+      sprintf(keyMgmtHeader, keyMgmtFmt, keyMgmtURL, subsession->trackId(), base64Message);
+      delete[] base64Message;
+      delete[] mikeyMessage;
+    }
+    char const *dateHdr = dateHeader();
+    char *extraHeaders = new char[strlen(dateHdr) + (keyMgmtHeader == NULL ? 0 : strlen(keyMgmtHeader)) + 1];
+    sprintf(extraHeaders, "%s%s", dateHdr, keyMgmtHeader == NULL ? "" : keyMgmtHeader);
+    delete[] keyMgmtHeader;
+    delete[] keyMgmtURL;
 
     AddressString destAddrStr(destinationAddress);
     AddressString sourceAddrStr(sourceAddr);
@@ -1721,21 +2013,21 @@ void RTSPServer::RTSPClientSession ::handleCmd_SETUP(RTSPServer::RTSPClientConne
     {
       timeoutParameterString[0] = '\0';
     }
+    char const *rtpProfileStr = usesSRTP ? "RTP/SAVP" : "RTP/AVP";
     if (fIsMulticast)
     {
       switch (streamingMode)
       {
       case RTP_UDP:
       {
-        snprintf((char *)ourClientConnection->fResponseBuffer, sizeof ourClientConnection->fResponseBuffer,
-                 "RTSP/1.0 200 OK\r\n"
+        ourClientConnection->formatResponse("RTSP/1.0 200 OK\r\n"
                  "CSeq: %s\r\n"
                  "%s"
-                 "Transport: RTP/AVP;multicast;destination=%s;source=%s;port=%d-%d;ttl=%d\r\n"
+                 "Transport: %s;multicast;destination=%s;source=%s;port=%d-%d;ttl=%d\r\n"
                  "Session: %08X%s\r\n\r\n",
                  ourClientConnection->fCurrentCSeq,
-                 dateHeader(),
-                 destAddrStr.val(), sourceAddrStr.val(), ntohs(serverRTPPort.num()), ntohs(serverRTCPPort.num()), destinationTTL,
+                 extraHeaders,
+                 rtpProfileStr, destAddrStr.val(), sourceAddrStr.val(), ntohs(serverRTPPort.num()), ntohs(serverRTCPPort.num()), destinationTTL,
                  fOurSessionId, timeoutParameterString);
         break;
       }
@@ -1747,14 +2039,13 @@ void RTSPServer::RTSPClientSession ::handleCmd_SETUP(RTSPServer::RTSPClientConne
       }
       case RAW_UDP:
       {
-        snprintf((char *)ourClientConnection->fResponseBuffer, sizeof ourClientConnection->fResponseBuffer,
-                 "RTSP/1.0 200 OK\r\n"
+        ourClientConnection->formatResponse("RTSP/1.0 200 OK\r\n"
                  "CSeq: %s\r\n"
                  "%s"
                  "Transport: %s;multicast;destination=%s;source=%s;port=%d;ttl=%d\r\n"
                  "Session: %08X%s\r\n\r\n",
                  ourClientConnection->fCurrentCSeq,
-                 dateHeader(),
+                 extraHeaders,
                  streamingModeString, destAddrStr.val(), sourceAddrStr.val(), ntohs(serverRTPPort.num()), destinationTTL,
                  fOurSessionId, timeoutParameterString);
         break;
@@ -1767,15 +2058,14 @@ void RTSPServer::RTSPClientSession ::handleCmd_SETUP(RTSPServer::RTSPClientConne
       {
       case RTP_UDP:
       {
-        snprintf((char *)ourClientConnection->fResponseBuffer, sizeof ourClientConnection->fResponseBuffer,
-                 "RTSP/1.0 200 OK\r\n"
+        ourClientConnection->formatResponse("RTSP/1.0 200 OK\r\n"
                  "CSeq: %s\r\n"
                  "%s"
-                 "Transport: RTP/AVP;unicast;destination=%s;source=%s;client_port=%d-%d;server_port=%d-%d\r\n"
+                 "Transport: %s;unicast;destination=%s;source=%s;client_port=%d-%d;server_port=%d-%d\r\n"
                  "Session: %08X%s\r\n\r\n",
                  ourClientConnection->fCurrentCSeq,
-                 dateHeader(),
-                 destAddrStr.val(), sourceAddrStr.val(), ntohs(clientRTPPort.num()), ntohs(clientRTCPPort.num()), ntohs(serverRTPPort.num()), ntohs(serverRTCPPort.num()),
+                 extraHeaders,
+                 rtpProfileStr, destAddrStr.val(), sourceAddrStr.val(), ntohs(clientRTPPort.num()), ntohs(clientRTCPPort.num()), ntohs(serverRTPPort.num()), ntohs(serverRTCPPort.num()),
                  fOurSessionId, timeoutParameterString);
         break;
       }
@@ -1787,29 +2077,27 @@ void RTSPServer::RTSPClientSession ::handleCmd_SETUP(RTSPServer::RTSPClientConne
         }
         else
         {
-          snprintf((char *)ourClientConnection->fResponseBuffer, sizeof ourClientConnection->fResponseBuffer,
-                   "RTSP/1.0 200 OK\r\n"
+          ourClientConnection->formatResponse("RTSP/1.0 200 OK\r\n"
                    "CSeq: %s\r\n"
                    "%s"
-                   "Transport: RTP/AVP/TCP;unicast;destination=%s;source=%s;interleaved=%d-%d\r\n"
+                   "Transport: %s/TCP;unicast;destination=%s;source=%s;interleaved=%d-%d\r\n"
                    "Session: %08X%s\r\n\r\n",
                    ourClientConnection->fCurrentCSeq,
-                   dateHeader(),
-                   destAddrStr.val(), sourceAddrStr.val(), rtpChannelId, rtcpChannelId,
+                   extraHeaders,
+                   rtpProfileStr, destAddrStr.val(), sourceAddrStr.val(), rtpChannelId, rtcpChannelId,
                    fOurSessionId, timeoutParameterString);
         }
         break;
       }
       case RAW_UDP:
       {
-        snprintf((char *)ourClientConnection->fResponseBuffer, sizeof ourClientConnection->fResponseBuffer,
-                 "RTSP/1.0 200 OK\r\n"
+        ourClientConnection->formatResponse("RTSP/1.0 200 OK\r\n"
                  "CSeq: %s\r\n"
                  "%s"
                  "Transport: %s;unicast;destination=%s;source=%s;client_port=%d;server_port=%d\r\n"
                  "Session: %08X%s\r\n\r\n",
                  ourClientConnection->fCurrentCSeq,
-                 dateHeader(),
+                 extraHeaders,
                  streamingModeString, destAddrStr.val(), sourceAddrStr.val(), ntohs(clientRTPPort.num()), ntohs(serverRTPPort.num()),
                  fOurSessionId, timeoutParameterString);
         break;
@@ -1817,6 +2105,7 @@ void RTSPServer::RTSPClientSession ::handleCmd_SETUP(RTSPServer::RTSPClientConne
       }
     }
     delete[] streamingModeString;
+    delete[] extraHeaders;
   } while (0);
 
   delete[] concatenatedStreamName;
@@ -2175,8 +2464,7 @@ void RTSPServer::RTSPClientSession ::handleCmd_PLAY(RTSPServer::RTSPClientConnec
   }
 
   // Fill in the response:
-  snprintf((char *)ourClientConnection->fResponseBuffer, sizeof ourClientConnection->fResponseBuffer,
-           "RTSP/1.0 200 OK\r\n"
+  ourClientConnection->formatResponse("RTSP/1.0 200 OK\r\n"
            "CSeq: %s\r\n"
            "%s"
            "%s"
@@ -2232,7 +2520,7 @@ void RTSPServer::RTSPClientSession ::handleCmd_SET_PARAMETER(RTSPServer::RTSPCli
 }
 
 GenericMediaServer::ClientConnection *
-RTSPServer::createNewClientConnection(int clientSocket, struct sockaddr_in clientAddr)
+RTSPServer::createNewClientConnection(int clientSocket, struct sockaddr_storage const &clientAddr)
 {
   return new RTSPClientConnection(*this, clientSocket, clientAddr);
 }
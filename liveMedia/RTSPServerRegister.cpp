@@ -58,7 +58,7 @@ public:
     if (resultCode == 0) {
       // The "REGISTER" request succeeded, so use the still-open RTSP socket to await incoming commands from the remote endpoint:
       int sock;
-      struct sockaddr_in remoteAddress;
+      struct sockaddr_storage remoteAddress;
 
       grabConnection(sock, remoteAddress);
       if (sock >= 0) {
@@ -300,6 +300,12 @@ void RTSPServer::RTSPClientConnection::continueHandlingREGISTER1(ParamsForREGIST
   RTSPServer* ourServer = &fOurRTSPServer; // copy the pointer now, in case we "delete this" below
   
   if (socketNumToBackEndServer >= 0) {
+    // Make sure that our response to the "REGISTER" has been sent, before our socket gets used for something else:
+    if (haveQueuedOutput()) {
+      finishSendingQueuedOutput();
+      envir().taskScheduler().disableBackgroundHandling(socketNumToBackEndServer);
+    }
+
     // Because our socket will no longer be used by the server to handle incoming requests, we can now delete this
     // "RTSPClientConnection" object.  We do this now, in case the "implementCmd_REGISTER()" call below would also end up
     // deleting this.
@@ -45,12 +45,12 @@ RTSPServerSupportingHTTPStreaming::~RTSPServerSupportingHTTPStreaming() {
 }
 
 GenericMediaServer::ClientConnection*
-RTSPServerSupportingHTTPStreaming::createNewClientConnection(int clientSocket, struct sockaddr_in clientAddr) {
+RTSPServerSupportingHTTPStreaming::createNewClientConnection(int clientSocket, struct sockaddr_storage const& clientAddr) {
   return new RTSPClientConnectionSupportingHTTPStreaming(*this, clientSocket, clientAddr);
 }
 
 RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming
-::RTSPClientConnectionSupportingHTTPStreaming(RTSPServer& ourServer, int clientSocket, struct sockaddr_in clientAddr)
+::RTSPClientConnectionSupportingHTTPStreaming(RTSPServer& ourServer, int clientSocket, struct sockaddr_storage const& clientAddr)
   : RTSPClientConnection(ourServer, clientSocket, clientAddr),
     fClientSessionId(0), fStreamSource(NULL), fPlaylistSource(NULL), fTCPSink(NULL) {
 }
@@ -110,11 +110,11 @@ void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStream
       // of the parameters to the call are dummy.)
       ++fClientSessionId;
       Port clientRTPPort(0), clientRTCPPort(0), serverRTPPort(0), serverRTCPPort(0);
-      netAddressBits destinationAddress = 0;
+      struct sockaddr_storage destinationAddress = nullAddress();
       u_int8_t destinationTTL = 0;
       Boolean isMulticast = False;
       void* streamToken;
-      subsession->getStreamParameters(fClientSessionId, 0, clientRTPPort,clientRTCPPort, -1,0,0, destinationAddress,destinationTTL, isMulticast, serverRTPPort,serverRTCPPort, streamToken);
+      subsession->getStreamParameters(fClientSessionId, nullAddress(), clientRTPPort,clientRTCPPort, -1,0,0, destinationAddress,destinationTTL, isMulticast, serverRTPPort,serverRTCPPort, streamToken);
       
       // Seek the stream source to the desired place, with the desired duration, and (as a side effect) get the number of bytes:
       double dOffsetInSeconds = (double)offsetInSeconds;
@@ -129,8 +129,7 @@ void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStream
       }
       
       // Construct our response:
-      snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
-	       "HTTP/1.1 200 OK\r\n"
+      formatResponse("HTTP/1.1 200 OK\r\n"
 	       "%s"
 	       "Server: LIVE555 Streaming Media v%s\r\n"
 	       "%s"
@@ -142,8 +141,7 @@ void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStream
 	       lastModifiedHeader(streamName),
 	       numTSBytesToStream);
       // Send the response now, because we're about to add more data (from the source):
-      send(fClientOutputSocket, (char const*)fResponseBuffer, strlen((char*)fResponseBuffer), 0);
-      fResponseBuffer[0] = '\0'; // We've already sent the response.  This tells the calling code not to send it again.
+      sendResponseNow(); // This also tells the calling code not to send the response again.
       
       // Ask the media source to deliver - to the TCP sink - the desired data:
       if (fStreamSource != NULL) { // sanity check
@@ -226,8 +224,7 @@ void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStream
   unsigned playlistLen = s - playlist;
 
   // Construct our response:
-  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
-	   "HTTP/1.1 200 OK\r\n"
+  formatResponse("HTTP/1.1 200 OK\r\n"
 	   "%s"
 	   "Server: LIVE555 Streaming Media v%s\r\n"
 	   "%s"
@@ -240,8 +237,7 @@ void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStream
 	   playlistLen);
 
   // Send the response header now, because we're about to add more data (the playlist):
-  send(fClientOutputSocket, (char const*)fResponseBuffer, strlen((char*)fResponseBuffer), 0);
-  fResponseBuffer[0] = '\0'; // We've already sent the response.  This tells the calling code not to send it again.
+  sendResponseNow(); // This also tells the calling code not to send the response again.
 
   // Then, send the playlist.  Because it's large, we don't do so using "send()", because that might not send it all at once.
   // Instead, we stream the playlist over the TCP socket:
@@ -0,0 +1,548 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A RTSP server whose streams are divided among several 'worker' threads, each running its own event loop
+// (with its own "UsageEnvironment", and its own - non-listening - "RTSPServer").  This server accepts each
+// incoming connection, looks at the URL in its first request, and hands the connection to the worker thread
+// that owns that stream.  From then on, the connection is handled entirely by that worker thread.
+// (If the first request is an "OPTIONS" that names no stream, this server answers it, and looks at the next request.)
+// Implementation
+
+#include "RTSPServerWithWorkerThreads.hh"
+#include "RTSPCommon.hh"
+#include <GroupsockHelper.hh>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+// The longest first request line that we look for (before handing the connection to a thread anyway).
+// (This is also the longest "OPTIONS" request that we'll answer ourself; see below.)
+#define MAX_REQUEST_LINE_SIZE 1000
+
+// If a connection's first request line is incomplete, we look again after this delay:
+#define PENDING_CONNECTION_RETRY_INTERVAL_US 10000
+// ... and we give up on the connection after this many tries (i.e., after 10 seconds):
+#define MAX_PENDING_CONNECTION_RETRIES 1000
+
+////////// WorkerRTSPServer //////////
+
+// The "RTSPServer" used by each worker thread.  It doesn't accept connections itself; instead, it's given
+// connections that were accepted by the "RTSPServerWithWorkerThreads".
+class WorkerRTSPServer: public RTSPServer {
+public:
+  static WorkerRTSPServer* createNew(UsageEnvironment& env, Port ourPort,
+				     UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds) {
+    return new WorkerRTSPServer(env, ourPort, authDatabase, reclamationSeconds);
+  }
+
+  void addClientConnection(int clientSocket, struct sockaddr_storage const& clientAddr) {
+    (void)createNewClientConnection(clientSocket, clientAddr);
+  }
+
+protected:
+  WorkerRTSPServer(UsageEnvironment& env, Port ourPort,
+		   UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds)
+    // "ourPort" (the port of the "RTSPServerWithWorkerThreads") is used only in the URLs that we generate:
+    : RTSPServer(env, -1, ourPort, authDatabase, reclamationSeconds) {
+  }
+};
+
+////////// RTSPServerWorkerThread //////////
+
+struct HandedOffConnection {
+  int clientSocket;
+  struct sockaddr_storage clientAddr;
+  HandedOffConnection* next;
+};
+
+class RTSPServerWorkerThread {
+public:
+  RTSPServerWorkerThread(RTSPServerWithWorkerThreads& ourServer, unsigned workerNum);
+  ~RTSPServerWorkerThread(); // stops the thread (if it's running)
+
+  void start(RTSPServerWithWorkerThreads::WorkerEnvironmentCreationFunc* environmentCreationFunc,
+	     RTSPServerWithWorkerThreads::WorkerSetupFunc* setupFunc, void* setupClientData,
+	     UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds);
+  Boolean waitForSetup(); // returns False iff the thread failed to start
+
+  // Called from the "RTSPServerWithWorkerThreads"'s thread:
+  void handOff(int clientSocket, struct sockaddr_storage const& clientAddr);
+  unsigned numConnectionsHandedOff() const { return fNumConnectionsHandedOff.load(std::memory_order_relaxed); }
+
+private:
+  void run();
+  static void newConnectionsHandler(void* clientData);
+  void newConnectionsHandler();
+  static void stopHandler(void* clientData);
+
+private:
+  RTSPServerWithWorkerThreads& fOurServer;
+  unsigned fWorkerNum;
+  std::thread fThread;
+
+  // Parameters for "run()":
+  RTSPServerWithWorkerThreads::WorkerEnvironmentCreationFunc* fEnvironmentCreationFunc;
+  RTSPServerWithWorkerThreads::WorkerSetupFunc* fSetupFunc;
+  void* fSetupClientData;
+  UserAuthenticationDatabase* fAuthDatabase;
+  unsigned fReclamationSeconds;
+
+  // Accessed only by the worker thread (after setup):
+  UsageEnvironment* fEnv;
+  WorkerRTSPServer* fServer;
+  EventTriggerId fNewConnectionsTrigger, fStopTrigger;
+  char volatile fStopRequested;
+
+  std::mutex fLock;
+  std::condition_variable fSetupWasDone;
+  // Protected by "fLock":
+  Boolean fSetupIsDone, fSetupSucceeded;
+  HandedOffConnection* fQueueHead;
+  HandedOffConnection* fQueueTail;
+
+  std::atomic<unsigned> fNumConnectionsHandedOff;
+};
+
+RTSPServerWorkerThread::RTSPServerWorkerThread(RTSPServerWithWorkerThreads& ourServer, unsigned workerNum)
+  : fOurServer(ourServer), fWorkerNum(workerNum),
+    fEnvironmentCreationFunc(NULL), fSetupFunc(NULL), fSetupClientData(NULL), fAuthDatabase(NULL),
+    fReclamationSeconds(0),
+    fEnv(NULL), fServer(NULL), fNewConnectionsTrigger(0), fStopTrigger(0), fStopRequested(0),
+    fSetupIsDone(False), fSetupSucceeded(False), fQueueHead(NULL), fQueueTail(NULL),
+    fNumConnectionsHandedOff(0) {
+}
+
+RTSPServerWorkerThread::~RTSPServerWorkerThread() {
+  if (fThread.joinable()) {
+    if (waitForSetup()) fEnv->taskScheduler().triggerEvent(fStopTrigger, this);
+    fThread.join();
+  }
+
+  // Close any connections that the thread didn't get to handle:
+  while (fQueueHead != NULL) {
+    HandedOffConnection* connection = fQueueHead;
+    fQueueHead = connection->next;
+    ::closeSocket(connection->clientSocket);
+    delete connection;
+  }
+}
+
+void RTSPServerWorkerThread
+::start(RTSPServerWithWorkerThreads::WorkerEnvironmentCreationFunc* environmentCreationFunc,
+	RTSPServerWithWorkerThreads::WorkerSetupFunc* setupFunc, void* setupClientData,
+	UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds) {
+  fEnvironmentCreationFunc = environmentCreationFunc;
+  fSetupFunc = setupFunc;
+  fSetupClientData = setupClientData;
+  fAuthDatabase = authDatabase;
+  fReclamationSeconds = reclamationSeconds;
+
+  fThread = std::thread(&RTSPServerWorkerThread::run, this);
+}
+
+Boolean RTSPServerWorkerThread::waitForSetup() {
+  std::unique_lock<std::mutex> lock(fLock);
+  while (!fSetupIsDone) fSetupWasDone.wait(lock);
+  return fSetupSucceeded;
+}
+
+void RTSPServerWorkerThread::handOff(int clientSocket, struct sockaddr_storage const& clientAddr) {
+  HandedOffConnection* connection = new HandedOffConnection;
+  connection->clientSocket = clientSocket;
+  connection->clientAddr = clientAddr;
+  connection->next = NULL;
+  {
+    std::lock_guard<std::mutex> guard(fLock);
+    if (fQueueTail == NULL) fQueueHead = connection; else fQueueTail->next = connection;
+    fQueueTail = connection;
+  }
+  fNumConnectionsHandedOff.fetch_add(1, std::memory_order_relaxed);
+
+  // Tell the worker thread about the new connection.  (This is the only "liveMedia" function that may be called
+  // from another thread.)
+  fEnv->taskScheduler().triggerEvent(fNewConnectionsTrigger, this);
+}
+
+void RTSPServerWorkerThread::run() {
+  // Everything in our environment is created (and later, deleted) by this thread:
+  fEnv = (*fEnvironmentCreationFunc)();
+  Boolean success = False;
+  if (fEnv != NULL) {
+    fServer = WorkerRTSPServer::createNew(*fEnv, fOurServer.fServerPort, fAuthDatabase, fReclamationSeconds);
+    fNewConnectionsTrigger = fEnv->taskScheduler().createEventTrigger(newConnectionsHandler);
+    fStopTrigger = fEnv->taskScheduler().createEventTrigger(stopHandler);
+    success = fNewConnectionsTrigger != 0 && fStopTrigger != 0;
+
+    if (success) (*fSetupFunc)(fOurServer, fWorkerNum, *fServer, fSetupClientData);
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(fLock);
+    fSetupIsDone = True;
+    fSetupSucceeded = success;
+  }
+  fSetupWasDone.notify_all();
+
+  if (success) fEnv->taskScheduler().doEventLoop(&fStopRequested);
+
+  if (fEnv != NULL) {
+    Medium::close(fServer); fServer = NULL;
+    fEnv->taskScheduler().deleteEventTrigger(fNewConnectionsTrigger);
+    fEnv->taskScheduler().deleteEventTrigger(fStopTrigger);
+
+    TaskScheduler* scheduler = &fEnv->taskScheduler();
+    fEnv->reclaim(); fEnv = NULL;
+    delete scheduler;
+  }
+}
+
+void RTSPServerWorkerThread::newConnectionsHandler(void* clientData) {
+  ((RTSPServerWorkerThread*)clientData)->newConnectionsHandler();
+}
+
+void RTSPServerWorkerThread::newConnectionsHandler() {
+  HandedOffConnection* connection;
+  {
+    std::lock_guard<std::mutex> guard(fLock);
+    connection = fQueueHead;
+    fQueueHead = fQueueTail = NULL;
+  }
+
+  while (connection != NULL) {
+    HandedOffConnection* next = connection->next;
+    fServer->addClientConnection(connection->clientSocket, connection->clientAddr);
+    delete connection;
+    connection = next;
+  }
+}
+
+void RTSPServerWorkerThread::stopHandler(void* clientData) {
+  ((RTSPServerWorkerThread*)clientData)->fStopRequested = 1;
+}
+
+////////// PendingConnection //////////
+
+// A connection that we've accepted, but whose first request line we haven't yet seen.  We look at this data
+// without reading it (using "MSG_PEEK"), so that the thread that's given the connection sees the whole request.
+class PendingConnection {
+public:
+  PendingConnection(RTSPServerWithWorkerThreads& ourServer, int clientSocket, struct sockaddr_storage const& clientAddr);
+  virtual ~PendingConnection(); // does not close "fClientSocket"
+
+  void close(); // closes "fClientSocket", and deletes us
+
+private:
+  static void incomingDataHandler(void* instance, int /*mask*/);
+  void incomingDataHandler();
+  Boolean lookAgainLater(); // returns False (after closing the connection) if we've already tried too often
+  static void retryHandler(void* instance);
+  Boolean answerOPTIONS(char const* request, unsigned requestSize);
+      // returns False (after closing the connection) if that failed
+
+private:
+  RTSPServerWithWorkerThreads& fOurServer;
+  int fClientSocket;
+  struct sockaddr_storage fClientAddr;
+  unsigned fNumRetries;
+  TaskToken fRetryTask;
+};
+
+PendingConnection::PendingConnection(RTSPServerWithWorkerThreads& ourServer,
+				     int clientSocket, struct sockaddr_storage const& clientAddr)
+  : fOurServer(ourServer), fClientSocket(clientSocket), fClientAddr(clientAddr),
+    fNumRetries(0), fRetryTask(NULL) {
+  fOurServer.fPendingConnections->Add((char const*)this, this);
+  fOurServer.envir().taskScheduler().turnOnBackgroundReadHandling(fClientSocket, incomingDataHandler, this);
+}
+
+PendingConnection::~PendingConnection() {
+  fOurServer.fPendingConnections->Remove((char const*)this);
+  fOurServer.envir().taskScheduler().turnOffBackgroundReadHandling(fClientSocket);
+  fOurServer.envir().taskScheduler().unscheduleDelayedTask(fRetryTask);
+}
+
+void PendingConnection::close() {
+  ::closeSocket(fClientSocket);
+  delete this;
+}
+
+void PendingConnection::incomingDataHandler(void* instance, int /*mask*/) {
+  ((PendingConnection*)instance)->incomingDataHandler();
+}
+
+void PendingConnection::incomingDataHandler() {
+  char buf[MAX_REQUEST_LINE_SIZE+1];
+  int bytesRead = recv(fClientSocket, buf, MAX_REQUEST_LINE_SIZE, MSG_PEEK);
+  if (bytesRead <= 0) {
+    if (bytesRead < 0 && fOurServer.envir().getErrno() == EWOULDBLOCK) return;
+    close(); // the client closed the connection (or there was an error)
+    return;
+  }
+  buf[bytesRead] = '\0';
+
+  char* lineEnd = strpbrk(buf, "\r\n");
+  if (lineEnd == NULL && bytesRead < MAX_REQUEST_LINE_SIZE) {
+    // The request line isn't complete yet:
+    (void)lookAgainLater();
+    return;
+  }
+
+  // Many clients begin with an "OPTIONS" request that names no stream (e.g., "OPTIONS * RTSP/1.0", or
+  // "OPTIONS rtsp://<host>:<port>/ RTSP/1.0").  That doesn't tell us which thread should get the connection,
+  // so we answer it ourself, and then look at the client's next request instead:
+  if (lineEnd != NULL && strncmp(buf, "OPTIONS ", 8) == 0 && RTSPServerWithWorkerThreads::namesNoStream(buf)) {
+    char const* requestEnd = strstr(buf, "\r\n\r\n");
+    if (requestEnd == NULL && bytesRead < MAX_REQUEST_LINE_SIZE) {
+      // The request isn't complete yet:
+      (void)lookAgainLater();
+      return;
+    }
+    if (requestEnd != NULL) {
+      // (A too-long "OPTIONS" request is handled by the thread that we give the connection to, as usual.)
+      if (answerOPTIONS(buf, (unsigned)(requestEnd + 4 - buf))) fNumRetries = 0;
+      return;
+    }
+  }
+  if (lineEnd != NULL) *lineEnd = '\0';
+
+  int clientSocket = fClientSocket;
+  struct sockaddr_storage clientAddr = fClientAddr;
+  RTSPServerWithWorkerThreads& ourServer = fOurServer;
+  delete this;
+  ourServer.dispatchConnection(clientSocket, clientAddr, buf);
+}
+
+Boolean PendingConnection::lookAgainLater() {
+  // (We can't wait for the socket to become readable, because it's still readable - we didn't read the data.)
+  if (++fNumRetries > MAX_PENDING_CONNECTION_RETRIES) {
+    close();
+    return False;
+  }
+  fOurServer.envir().taskScheduler().turnOffBackgroundReadHandling(fClientSocket);
+  fRetryTask = fOurServer.envir().taskScheduler()
+    .scheduleDelayedTask(PENDING_CONNECTION_RETRY_INTERVAL_US, retryHandler, this);
+  return True;
+}
+
+void PendingConnection::retryHandler(void* instance) {
+  PendingConnection* connection = (PendingConnection*)instance;
+  connection->fRetryTask = NULL;
+  connection->fOurServer.envir().taskScheduler()
+    .turnOnBackgroundReadHandling(connection->fClientSocket, incomingDataHandler, connection);
+  connection->incomingDataHandler();
+}
+
+Boolean PendingConnection::answerOPTIONS(char const* request, unsigned requestSize) {
+  char cmdName[RTSP_PARAM_STRING_MAX];
+  char urlPreSuffix[RTSP_PARAM_STRING_MAX];
+  char urlSuffix[RTSP_PARAM_STRING_MAX];
+  char cseq[RTSP_PARAM_STRING_MAX];
+  char sessionIdStr[RTSP_PARAM_STRING_MAX];
+  unsigned contentLength = 0;
+  if (!parseRTSPRequestString(request, requestSize, cmdName, sizeof cmdName, urlPreSuffix, sizeof urlPreSuffix,
+			      urlSuffix, sizeof urlSuffix, cseq, sizeof cseq, sessionIdStr, sizeof sessionIdStr,
+			      contentLength)
+      || contentLength > 0) {
+    close();
+    return False;
+  }
+
+  // Consume the request (which, until now, we've only 'peeked' at), then send our response - the same response
+  // that "RTSPServer::RTSPClientConnection::handleCmd_OPTIONS()" would send:
+  char buf[MAX_REQUEST_LINE_SIZE];
+  if (recv(fClientSocket, buf, requestSize, 0) != (int)requestSize) {
+    close();
+    return False;
+  }
+  char response[RTSP_PARAM_STRING_MAX + 400];
+  snprintf(response, sizeof response, "RTSP/1.0 200 OK\r\nCSeq: %s\r\n%sPublic: %s\r\n\r\n",
+	   cseq, dateHeader(), fOurServer.allowedCommandNames());
+  int const responseSize = (int)strlen(response);
+  if (send(fClientSocket, response, responseSize, 0) != responseSize) {
+    // (This is a small response on a new connection, so the socket buffer won't be full.)
+    close();
+    return False;
+  }
+  return True;
+}
+
+////////// RTSPServerWithWorkerThreads //////////
+
+RTSPServerWithWorkerThreads*
+RTSPServerWithWorkerThreads::createNew(UsageEnvironment& env, Port ourPort, unsigned numWorkers,
+				       WorkerEnvironmentCreationFunc* environmentCreationFunc,
+				       WorkerSetupFunc* setupFunc, void* setupClientData,
+				       UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds) {
+  if (numWorkers == 0 || environmentCreationFunc == NULL || setupFunc == NULL) {
+    env.setResultMsg("RTSPServerWithWorkerThreads::createNew(): bad parameters");
+    return NULL;
+  }
+
+  int ourSocket = setUpOurSocket(env, ourPort);
+  if (ourSocket == -1) return NULL;
+
+  // Look up our IP address now, so that the worker threads don't all do this (at once) later:
+  (void)ourIPAddress(env);
+
+  RTSPServerWithWorkerThreads* server
+    = new RTSPServerWithWorkerThreads(env, ourSocket, ourPort, numWorkers, authDatabase, reclamationSeconds);
+  if (!server->startWorkers(environmentCreationFunc, setupFunc, setupClientData, authDatabase, reclamationSeconds)) {
+    env.setResultMsg("RTSPServerWithWorkerThreads::createNew(): failed to start the worker threads");
+    Medium::close(server);
+    return NULL;
+  }
+  return server;
+}
+
+RTSPServerWithWorkerThreads
+::RTSPServerWithWorkerThreads(UsageEnvironment& env, int ourSocket, Port ourPort, unsigned numWorkers,
+			      UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds)
+  : RTSPServer(env, ourSocket, ourPort, authDatabase, reclamationSeconds),
+    fNumWorkers(numWorkers), fWorkers(new RTSPServerWorkerThread*[numWorkers]),
+    fPendingConnections(HashTable::create(ONE_WORD_HASH_KEYS)),
+    fStreamTable(HashTable::create(STRING_HASH_KEYS)) {
+  for (unsigned i = 0; i < fNumWorkers; ++i) fWorkers[i] = new RTSPServerWorkerThread(*this, i);
+}
+
+RTSPServerWithWorkerThreads::~RTSPServerWithWorkerThreads() {
+  // Stop the worker threads first, so that they no longer use us:
+  for (unsigned i = 0; i < fNumWorkers; ++i) delete fWorkers[i];
+  delete[] fWorkers;
+
+  PendingConnection* connection;
+  while ((connection = (PendingConnection*)fPendingConnections->getFirst()) != NULL) {
+    connection->close();
+  }
+  delete fPendingConnections;
+
+  delete fStreamTable; // its values are not pointers, so don't need to be deleted
+}
+
+Boolean RTSPServerWithWorkerThreads
+::startWorkers(WorkerEnvironmentCreationFunc* environmentCreationFunc,
+	       WorkerSetupFunc* setupFunc, void* setupClientData,
+	       UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds) {
+  // Start all of the threads, and let them set up their streams in parallel, before waiting for them:
+  unsigned i;
+  for (i = 0; i < fNumWorkers; ++i) {
+    fWorkers[i]->start(environmentCreationFunc, setupFunc, setupClientData, authDatabase, reclamationSeconds);
+  }
+
+  Boolean success = True;
+  for (i = 0; i < fNumWorkers; ++i) {
+    if (!fWorkers[i]->waitForSetup()) success = False;
+  }
+  return success;
+}
+
+void RTSPServerWithWorkerThreads::assignStream(char const* streamName, unsigned workerNum) {
+  if (streamName == NULL || workerNum >= fNumWorkers) return;
+
+  std::lock_guard<std::mutex> guard(fStreamTableLock);
+  fStreamTable->Add(streamName, (void*)(uintptr_t)(workerNum + 1));
+}
+
+void RTSPServerWithWorkerThreads::unassignStream(char const* streamName) {
+  if (streamName == NULL) return;
+
+  std::lock_guard<std::mutex> guard(fStreamTableLock);
+  fStreamTable->Remove(streamName);
+}
+
+unsigned RTSPServerWithWorkerThreads::numConnectionsHandedOff(unsigned workerNum) const {
+  return workerNum < fNumWorkers ? fWorkers[workerNum]->numConnectionsHandedOff() : 0;
+}
+
+GenericMediaServer::ClientConnection*
+RTSPServerWithWorkerThreads::createNewClientConnection(int clientSocket, struct sockaddr_storage const& clientAddr) {
+  // Don't handle the connection ourself (yet); instead, wait until we've seen its first request line:
+  (void)new PendingConnection(*this, clientSocket, clientAddr);
+  return NULL;
+}
+
+void RTSPServerWithWorkerThreads
+::dispatchConnection(int clientSocket, struct sockaddr_storage const& clientAddr, char const* requestLine) {
+  int workerNum = lookupWorker(requestLine);
+#ifdef DEBUG
+  envir() << "RTSPServerWithWorkerThreads: \"" << requestLine << "\" => worker " << workerNum << "\n";
+#endif
+  if (workerNum < 0) {
+    // No worker owns this stream, so handle the connection ourself:
+    (void)RTSPServer::createNewClientConnection(clientSocket, clientAddr);
+  } else {
+    fWorkers[workerNum]->handOff(clientSocket, clientAddr);
+  }
+}
+
+char* RTSPServerWithWorkerThreads::streamNameInRequestLine(char const* requestLine) {
+  // The request line is "<command> <url> <protocol>" (for either RTSP, or HTTP (when tunneling)).
+  // Find the stream name within the URL:
+  char const* url = strchr(requestLine, ' ');
+  if (url == NULL) return NULL;
+  while (*url == ' ') ++url;
+  char const* urlEnd = url;
+  while (*urlEnd != '\0' && *urlEnd != ' ' && *urlEnd != '?' && *urlEnd != '\r' && *urlEnd != '\n') ++urlEnd;
+
+  char const* path = url;
+  for (char const* p = url; p + 2 < urlEnd; ++p) {
+    if (p[0] == ':' && p[1] == '/' && p[2] == '/') {
+      // Skip over "<scheme>://<host>[:<port>]":
+      path = p + 3;
+      while (path < urlEnd && *path != '/') ++path;
+      break;
+    }
+  }
+  while (path < urlEnd && *path == '/') ++path;
+
+  unsigned nameLen = (unsigned)(urlEnd - path);
+  char* streamName = new char[nameLen + 1];
+  memcpy(streamName, path, nameLen);
+  streamName[nameLen] = '\0';
+  return streamName;
+}
+
+Boolean RTSPServerWithWorkerThreads::namesNoStream(char const* requestLine) {
+  char* streamName = streamNameInRequestLine(requestLine);
+  Boolean result = streamName == NULL || streamName[0] == '\0' || strcmp(streamName, "*") == 0;
+  delete[] streamName;
+  return result;
+}
+
+int RTSPServerWithWorkerThreads::lookupWorker(char const* requestLine) {
+  char* streamName = streamNameInRequestLine(requestLine);
+  if (streamName == NULL) return -1;
+
+  // The URL might also name a track (e.g., "<stream-name>/track1"), so try successively shorter names:
+  int result = -1;
+  {
+    std::lock_guard<std::mutex> guard(fStreamTableLock);
+    while (True) {
+      uintptr_t value = (uintptr_t)fStreamTable->Lookup(streamName);
+      if (value != 0) {
+	result = (int)(value - 1);
+	break;
+      }
+
+      char* lastSlash = strrchr(streamName, '/');
+      if (lastSlash == NULL) break;
+      *lastSlash = '\0';
+    }
+  }
+
+  delete[] streamName;
+  return result;
+}
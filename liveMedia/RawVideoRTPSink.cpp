@@ -136,7 +136,7 @@ unsigned RawVideoRTPSink::specialHeaderSize() const {
 
 unsigned RawVideoRTPSink::getNbLineInPacket(unsigned fragOffset, unsigned * &lengths, unsigned * &offsets) const
 {
-  unsigned rtpHeaderSize = 12;
+  unsigned rtpHeaderSize = 12 + headerExtensionSize();
   unsigned specialHeaderSize = 2; // Extended Sequence Nb
   unsigned packetMaxSize = ourMaxPacketSize();
   unsigned nbLines = 0;
@@ -0,0 +1,245 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// The files that describe a segmented recording (as written by "RollingRecordingSink"): the list of segments,
+// and each segment's key frame index.
+// Implementation
+
+#include "RecordingArchive.hh"
+#include "OutputFile.hh"
+#include <sys/stat.h>
+
+u_int64_t timevalToMicroseconds(struct timeval const& tv) {
+  return (u_int64_t)tv.tv_sec*1000000 + tv.tv_usec;
+}
+
+struct timeval microsecondsToTimeval(u_int64_t usecs) {
+  struct timeval result;
+  result.tv_sec = (long)(usecs/1000000);
+  result.tv_usec = (long)(usecs%1000000);
+  return result;
+}
+
+////////// RecordingSegment //////////
+
+RecordingSegment::RecordingSegment(char const* fileName, struct timeval const& startTime)
+  : fFileName(strDup(fileName)), fStartTime(startTime), fEndTime(startTime), fSize(0) {
+}
+
+RecordingSegment::~RecordingSegment() {
+  delete[] fFileName;
+}
+
+char* RecordingSegment::indexFileName() const {
+  char* result = new char[strlen(fFileName) + 4 + 1];
+  sprintf(result, "%s.idx", fFileName);
+  return result;
+}
+
+////////// SegmentKeyFrameIndex //////////
+
+#define KEY_FRAME_INDEX_RECORD_SIZE 16
+
+SegmentKeyFrameIndex::SegmentKeyFrameIndex()
+  : fTimes(NULL), fOffsets(NULL), fNumEntries(0), fMaxNumEntries(0) {
+}
+
+SegmentKeyFrameIndex::~SegmentKeyFrameIndex() {
+  delete[] fTimes; delete[] fOffsets;
+}
+
+SegmentKeyFrameIndex* SegmentKeyFrameIndex::createFromFile(char const* fileName) {
+  FILE* fid = fopen(fileName, "rb");
+  if (fid == NULL) return NULL;
+
+  SegmentKeyFrameIndex* index = new SegmentKeyFrameIndex;
+  unsigned char record[KEY_FRAME_INDEX_RECORD_SIZE];
+  while (fread(record, 1, sizeof record, fid) == sizeof record) {
+    u_int64_t time = 0, offset = 0;
+    for (unsigned j = 0; j < 8; ++j) {
+      time = (time<<8)|record[j];
+      offset = (offset<<8)|record[8+j];
+    }
+    index->addEntry(time, offset);
+  }
+  fclose(fid);
+  return index;
+}
+
+Boolean SegmentKeyFrameIndex::writeToFile(UsageEnvironment& env, char const* fileName) const {
+  // Write the index to a temporary file, then rename it (so that a reader never sees a partial index):
+  char* tmpFileName = new char[strlen(fileName) + 4 + 1];
+  sprintf(tmpFileName, "%s.tmp", fileName);
+
+  Boolean success = False;
+  FILE* fid = OpenOutputFile(env, tmpFileName);
+  if (fid != NULL) {
+    success = True;
+    for (unsigned i = 0; i < fNumEntries; ++i) {
+      unsigned char record[KEY_FRAME_INDEX_RECORD_SIZE];
+      for (unsigned j = 0; j < 8; ++j) {
+	record[j] = (unsigned char)(fTimes[i]>>(56 - 8*j));
+	record[8+j] = (unsigned char)(fOffsets[i]>>(56 - 8*j));
+      }
+      if (fwrite(record, 1, sizeof record, fid) != sizeof record) success = False;
+    }
+    success = fflush(fid) == 0 && success;
+    CloseOutputFile(fid);
+    success = success && rename(tmpFileName, fileName) == 0;
+  }
+  delete[] tmpFileName;
+  return success;
+}
+
+void SegmentKeyFrameIndex::addEntry(u_int64_t time, u_int64_t offset) {
+  if (fNumEntries == fMaxNumEntries) {
+    fMaxNumEntries = fMaxNumEntries == 0 ? 64 : 2*fMaxNumEntries;
+    u_int64_t* newTimes = new u_int64_t[fMaxNumEntries];
+    u_int64_t* newOffsets = new u_int64_t[fMaxNumEntries];
+    for (unsigned i = 0; i < fNumEntries; ++i) {
+      newTimes[i] = fTimes[i]; newOffsets[i] = fOffsets[i];
+    }
+    delete[] fTimes; fTimes = newTimes;
+    delete[] fOffsets; fOffsets = newOffsets;
+  }
+  fTimes[fNumEntries] = time; fOffsets[fNumEntries] = offset;
+  ++fNumEntries;
+}
+
+int SegmentKeyFrameIndex::lookup(u_int64_t time) const {
+  if (fNumEntries == 0) return -1;
+
+  unsigned lo = 0, hi = fNumEntries; // the result lies within [lo, hi)
+  while (hi - lo > 1) {
+    unsigned mid = (lo + hi)/2;
+    if (fTimes[mid] <= time) lo = mid; else hi = mid;
+  }
+  return (int)lo;
+}
+
+////////// RecordingSegmentList //////////
+
+RecordingSegmentList::RecordingSegmentList()
+  : fSegments(NULL), fNumSegments(0), fMaxNumSegments(0), fTotalSize(0) {
+}
+
+RecordingSegmentList::~RecordingSegmentList() {
+  removeAllSegments();
+  delete[] fSegments;
+}
+
+Boolean RecordingSegmentList::readFromFile(char const* fileName) {
+  FILE* fid = fopen(fileName, "r");
+  if (fid == NULL) return False;
+
+  removeAllSegments();
+  char line[1000];
+  while (fgets(line, sizeof line, fid) != NULL) {
+    unsigned long startSec, startUSec, endSec, endUSec;
+    unsigned long long size;
+    int fileNamePos;
+    if (sscanf(line, "%lu.%lu %lu.%lu %llu %n", &startSec, &startUSec, &endSec, &endUSec, &size, &fileNamePos) < 5) {
+      continue;
+    }
+    char* segmentFileName = &line[fileNamePos];
+    segmentFileName[strcspn(segmentFileName, "\r\n")] = '\0';
+
+    // Skip segments that have since been removed.  Otherwise, use the file's actual size (which is larger than
+    // the listed size, if the recorder stopped without ending the segment properly):
+    struct stat sb;
+    if (stat(segmentFileName, &sb) != 0) continue;
+
+    struct timeval startTime;
+    startTime.tv_sec = startSec; startTime.tv_usec = startUSec;
+    RecordingSegment* segment = new RecordingSegment(segmentFileName, startTime);
+    segment->fEndTime.tv_sec = endSec; segment->fEndTime.tv_usec = endUSec;
+    segment->fSize = (u_int64_t)sb.st_size;
+    addSegment(segment);
+  }
+  fclose(fid);
+  return True;
+}
+
+Boolean RecordingSegmentList
+::writeToFile(UsageEnvironment& env, char const* fileName, RecordingSegment const* extraSegment) const {
+  // Write a new version of the list, then replace the old one with it (so that the list is never incomplete):
+  char* tmpFileName = new char[strlen(fileName) + 4 + 1];
+  sprintf(tmpFileName, "%s.tmp", fileName);
+
+  Boolean success = False;
+  FILE* fid = OpenOutputFile(env, tmpFileName);
+  if (fid != NULL) {
+    for (unsigned i = 0; i <= fNumSegments; ++i) {
+      RecordingSegment const* segment = i < fNumSegments ? fSegments[i] : extraSegment;
+      if (segment == NULL) break;
+
+      fprintf(fid, "%lu.%06lu %lu.%06lu %llu %s\n",
+	      (unsigned long)segment->fStartTime.tv_sec, (unsigned long)segment->fStartTime.tv_usec,
+	      (unsigned long)segment->fEndTime.tv_sec, (unsigned long)segment->fEndTime.tv_usec,
+	      (unsigned long long)segment->fSize, segment->fFileName);
+    }
+    success = fflush(fid) == 0;
+    CloseOutputFile(fid);
+    success = success && rename(tmpFileName, fileName) == 0;
+  }
+  delete[] tmpFileName;
+  return success;
+}
+
+void RecordingSegmentList::addSegment(RecordingSegment* segment) {
+  if (fNumSegments == fMaxNumSegments) {
+    fMaxNumSegments = fMaxNumSegments == 0 ? 64 : 2*fMaxNumSegments;
+    RecordingSegment** newSegments = new RecordingSegment*[fMaxNumSegments];
+    for (unsigned i = 0; i < fNumSegments; ++i) newSegments[i] = fSegments[i];
+    delete[] fSegments; fSegments = newSegments;
+  }
+  fSegments[fNumSegments++] = segment;
+  fTotalSize += segment->fSize;
+}
+
+RecordingSegment* RecordingSegmentList::removeOldestSegment() {
+  if (fNumSegments == 0) return NULL;
+
+  RecordingSegment* segment = fSegments[0];
+  fTotalSize -= segment->fSize;
+  --fNumSegments;
+  for (unsigned i = 0; i < fNumSegments; ++i) fSegments[i] = fSegments[i+1];
+  return segment;
+}
+
+void RecordingSegmentList::removeAllSegments() {
+  for (unsigned i = 0; i < fNumSegments; ++i) delete fSegments[i];
+  fNumSegments = 0;
+  fTotalSize = 0;
+}
+
+int RecordingSegmentList::lookup(u_int64_t time) const {
+  if (fNumSegments == 0) return -1;
+
+  unsigned lo = 0, hi = fNumSegments; // the result lies within [lo, hi)
+  while (hi - lo > 1) {
+    unsigned mid = (lo + hi)/2;
+    if (timevalToMicroseconds(fSegments[mid]->fStartTime) <= time) lo = mid; else hi = mid;
+  }
+  return (int)lo;
+}
+
+int RecordingSegmentList::lookupByStartTime(u_int64_t startTime) const {
+  int i = lookup(startTime);
+  if (i < 0 || timevalToMicroseconds(fSegments[i]->fStartTime) != startTime) return -1;
+  return i;
+}
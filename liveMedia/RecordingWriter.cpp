@@ -0,0 +1,531 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A write-behind output engine for recording files: data is collected into large buffers, which are then
+// written - by a background thread - without blocking the event loop.
+// Implementation
+
+#include "RecordingWriter.hh"
+#include "GroupsockHelper.hh"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#if (defined(__WIN32__) || defined(_WIN32)) && !defined(_WIN32_WCE)
+#include <io.h>
+#define writeToFD _write
+#define syncFD _commit
+#define filenoOf _fileno
+#define seekFD _lseeki64
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#define writeToFD write
+#if defined(__linux__)
+#define syncFD fdatasync
+#else
+#define syncFD fsync
+#endif
+#define filenoOf fileno
+#define seekFD lseek
+#endif
+
+////////// RecordingWriterParameters //////////
+
+RecordingWriterParameters::RecordingWriterParameters()
+  : bufferSize(256*1024), maxNumBuffers(4), flushIntervalMS(1000), syncIntervalMS(0), syncOnClose(False),
+    useDirectIO(False), preallocationSize(0) {
+}
+
+////////// RecordingBuffer //////////
+
+struct RecordingBuffer {
+  RecordingWriter* writer;
+  RecordingBuffer* next;
+  unsigned char* data;
+  unsigned size; // the number of bytes (from the start of "data") that have been filled
+  Boolean isFinal; // the last buffer to be written by "writer"
+};
+
+////////// RecordingWriterThread //////////
+
+// A background thread that performs the writes for all "RecordingWriter"s (in all event loops) whose files are on
+// the same device.  Because it handles buffers strictly in order, each file's data is written in the order in which
+// it was added.
+class RecordingWriterThread {
+public:
+  static RecordingWriterThread* acquire(u_int64_t deviceId, Boolean isShareable);
+      // Returns the thread for "deviceId" - creating (and starting) it, if necessary.  If "isShareable" is False,
+      // then a new thread (that won't be shared) is always created.
+  void release(); // stops (and deletes) the thread after its last user has released it
+
+  void submit(RecordingBuffer* buffer);
+
+  std::mutex fLock; // also protects each "RecordingWriter"'s free buffer list and counters
+  std::condition_variable fBufferWasWritten;
+
+private:
+  RecordingWriterThread();
+  ~RecordingWriterThread();
+
+  void run();
+
+private:
+  std::thread fThread;
+  std::condition_variable fWorkIsAvailable;
+  RecordingBuffer* fQueueHead;
+  RecordingBuffer* fQueueTail;
+  Boolean fShouldExit;
+
+  // Protected by "registryLock":
+  RecordingWriterThread* fNext; // in "allWriterThreads"
+  u_int64_t fDeviceId;
+  Boolean fIsShareable;
+  unsigned fReferenceCount;
+};
+
+static std::mutex registryLock;
+static RecordingWriterThread* allWriterThreads = NULL;
+static RecordingWriter* allWriters = NULL; // also protected by "registryLock"
+static Boolean haveRegisteredAtExit = False; // ditto
+
+RecordingWriterThread* RecordingWriterThread::acquire(u_int64_t deviceId, Boolean isShareable) {
+  std::lock_guard<std::mutex> guard(registryLock);
+  RecordingWriterThread* writerThread = NULL;
+  if (isShareable) {
+    for (writerThread = allWriterThreads; writerThread != NULL; writerThread = writerThread->fNext) {
+      if (writerThread->fIsShareable && writerThread->fDeviceId == deviceId) break;
+    }
+  }
+  if (writerThread == NULL) {
+    writerThread = new RecordingWriterThread;
+    writerThread->fDeviceId = deviceId;
+    writerThread->fIsShareable = isShareable;
+    writerThread->fNext = allWriterThreads;
+    allWriterThreads = writerThread;
+  }
+  ++writerThread->fReferenceCount;
+
+  return writerThread;
+}
+
+void RecordingWriterThread::release() {
+  std::lock_guard<std::mutex> guard(registryLock);
+  if (--fReferenceCount > 0) return;
+
+  RecordingWriterThread** ptr = &allWriterThreads;
+  while (*ptr != this) ptr = &(*ptr)->fNext;
+  *ptr = fNext;
+  delete this;
+}
+
+RecordingWriterThread::RecordingWriterThread()
+  : fQueueHead(NULL), fQueueTail(NULL), fShouldExit(False),
+    fNext(NULL), fDeviceId(0), fIsShareable(False), fReferenceCount(0) {
+  fThread = std::thread(&RecordingWriterThread::run, this);
+}
+
+RecordingWriterThread::~RecordingWriterThread() {
+  {
+    std::lock_guard<std::mutex> guard(fLock);
+    fShouldExit = True;
+  }
+  fWorkIsAvailable.notify_one();
+  fThread.join();
+}
+
+void RecordingWriterThread::submit(RecordingBuffer* buffer) {
+  buffer->next = NULL;
+  {
+    std::lock_guard<std::mutex> guard(fLock);
+    if (fQueueTail == NULL) {
+      fQueueHead = buffer;
+    } else {
+      fQueueTail->next = buffer;
+    }
+    fQueueTail = buffer;
+    ++buffer->writer->fNumPendingBuffers;
+  }
+  fWorkIsAvailable.notify_one();
+}
+
+void RecordingWriterThread::run() {
+  std::unique_lock<std::mutex> lock(fLock);
+  while (1) {
+    while (fQueueHead == NULL && !fShouldExit) fWorkIsAvailable.wait(lock);
+    if (fQueueHead == NULL) break; // we were asked to exit, and there's nothing left to write
+
+    RecordingBuffer* buffer = fQueueHead;
+    fQueueHead = buffer->next;
+    if (fQueueHead == NULL) fQueueTail = NULL;
+
+    // Do the write without holding the lock, so that event loops can continue to submit buffers:
+    lock.unlock();
+    RecordingWriter* writer = buffer->writer;
+    writer->writeBuffer(buffer);
+    lock.lock();
+
+    // Return the buffer to its writer's free list (or free it, if it was an extra buffer):
+    if (writer->fNumBuffers > writer->fParams.maxNumBuffers) {
+      free(buffer->data);
+      delete buffer;
+      --writer->fNumBuffers;
+    } else {
+      buffer->next = writer->fFreeBuffers;
+      writer->fFreeBuffers = buffer;
+    }
+    --writer->fNumPendingBuffers;
+    fBufferWasWritten.notify_all();
+    if (writer->fWantsBufferIsFreeNotification) {
+      writer->fWantsBufferIsFreeNotification = False;
+      writer->envir().taskScheduler().triggerEvent(writer->fBufferIsFreeTrigger, writer);
+    }
+  }
+}
+
+////////// RecordingWriter //////////
+
+RecordingWriter* RecordingWriter::createNew(UsageEnvironment& env, FILE* fid,
+					    RecordingWriterParameters const& params) {
+  if (fid == NULL) return NULL;
+
+  // Any data that "fid" has buffered must be output before we start writing to its file descriptor directly:
+  if (fflush(fid) == EOF) {
+    env.setResultMsg("RecordingWriter::createNew(): failed to flush the output file");
+    return NULL;
+  }
+  int fd = filenoOf(fid);
+
+  struct stat sb;
+  Boolean isRegularFile = fstat(fd, &sb) == 0 && (sb.st_mode&S_IFMT) == S_IFREG;
+  u_int64_t deviceId = isRegularFile ? (u_int64_t)sb.st_dev : 0;
+  int64_t initialFileOffset = seekFD(fd, 0, SEEK_CUR);
+  if (initialFileOffset < 0) initialFileOffset = 0; // e.g., for a pipe
+
+  Boolean useDirectIO = False;
+#ifdef O_DIRECT
+  // 'Direct I/O' requires that all writes (except the last, which we make with "O_DIRECT" turned off) be aligned:
+  if (params.useDirectIO && isRegularFile
+      && initialFileOffset%RECORDING_WRITER_DIRECT_IO_ALIGNMENT == 0
+      && params.bufferSize%RECORDING_WRITER_DIRECT_IO_ALIGNMENT == 0) {
+    int flags = fcntl(fd, F_GETFL);
+    useDirectIO = flags >= 0 && fcntl(fd, F_SETFL, flags|O_DIRECT) == 0;
+  }
+#endif
+
+  return new RecordingWriter(env, fd, isRegularFile, deviceId, useDirectIO, (u_int64_t)initialFileOffset, params);
+}
+
+RecordingWriter::RecordingWriter(UsageEnvironment& env, int fd, Boolean isRegularFile, u_int64_t deviceId,
+				 Boolean useDirectIO, u_int64_t initialFileOffset, RecordingWriterParameters const& params)
+  : Medium(env), fFD(fd), fNextWriter(NULL), fWriterThread(RecordingWriterThread::acquire(deviceId, isRegularFile)),
+    fParams(params), fUseDirectIO(useDirectIO), fIsFinished(False),
+    fCurrentBuffer(NULL), fFlushTimerTask(NULL), fNumBytesAdded(0),
+    fBufferIsFreeTrigger(env.taskScheduler().createEventTrigger(bufferIsFreeHandler)),
+    fBufferIsFreeHandler(NULL), fBufferIsFreeClientData(NULL), fWantsBufferIsFreeNotification(False),
+    fFreeBuffers(NULL), fNumBuffers(0), fNumPendingBuffers(0),
+    fFileOffset(initialFileOffset), fPreallocatedEnd(initialFileOffset), fDirectIOIsActive(useDirectIO),
+    fNeedToSync(False), fErrorCode(0), fNumBytesWritten(0) {
+  if (fParams.bufferSize < RECORDING_WRITER_DIRECT_IO_ALIGNMENT) fParams.bufferSize = RECORDING_WRITER_DIRECT_IO_ALIGNMENT;
+  if (fParams.maxNumBuffers < 2) fParams.maxNumBuffers = 2;
+  if (!isRegularFile) {
+    // Someone may be reading our output as it arrives (e.g., through a pipe), so don't delay it:
+    fParams.flushIntervalMS = 0;
+    fParams.preallocationSize = 0;
+  }
+  gettimeofday(&fTimeOfLastSync, NULL);
+
+  // Programs often call "exit()" without first closing their sinks.  (That was OK when output was written with
+  // "fwrite()", because "exit()" flushes "FILE"s.)  Arrange for our buffered data to get written in that case also:
+  std::lock_guard<std::mutex> guard(registryLock);
+  if (!haveRegisteredAtExit) {
+    atexit(finishAllWriters);
+    haveRegisteredAtExit = True;
+  }
+  fNextWriter = allWriters;
+  allWriters = this;
+}
+
+RecordingWriter::~RecordingWriter() {
+  finish();
+
+  // All of our buffers are now free:
+  while (fFreeBuffers != NULL) {
+    RecordingBuffer* next = fFreeBuffers->next;
+    free(fFreeBuffers->data);
+    delete fFreeBuffers;
+    fFreeBuffers = next;
+  }
+
+  envir().taskScheduler().deleteEventTrigger(fBufferIsFreeTrigger);
+  fWriterThread->release();
+
+  std::lock_guard<std::mutex> guard(registryLock);
+  RecordingWriter** ptr = &allWriters;
+  while (*ptr != this) ptr = &(*ptr)->fNextWriter;
+  *ptr = fNextWriter;
+}
+
+Boolean RecordingWriter::addData(unsigned char const* data, unsigned dataSize) {
+  if (fIsFinished) return False;
+  if (hasFailed()) return checkForFailure(); // sets our result message (and returns False)
+
+  fNumBytesAdded += dataSize;
+  while (dataSize > 0) {
+    if (fCurrentBuffer == NULL) {
+      fCurrentBuffer = getFreeBuffer();
+      if (fParams.flushIntervalMS > 0 && fFlushTimerTask == NULL) {
+	fFlushTimerTask = envir().taskScheduler().scheduleDelayedTask(fParams.flushIntervalMS*1000,
+								      flushTimerHandler, this);
+      }
+    }
+
+    unsigned numBytesToCopy = fParams.bufferSize - fCurrentBuffer->size;
+    if (numBytesToCopy > dataSize) numBytesToCopy = dataSize;
+    memmove(&fCurrentBuffer->data[fCurrentBuffer->size], data, numBytesToCopy);
+    fCurrentBuffer->size += numBytesToCopy;
+    data += numBytesToCopy;
+    dataSize -= numBytesToCopy;
+
+    if (fCurrentBuffer->size == fParams.bufferSize) submitCurrentBuffer(False);
+  }
+
+  return True;
+}
+
+Boolean RecordingWriter::endOfFrame() {
+  if (fParams.flushIntervalMS == 0) return flush();
+
+  return checkForFailure();
+}
+
+Boolean RecordingWriter::flush() {
+  if (!fIsFinished) {
+    envir().taskScheduler().unscheduleDelayedTask(fFlushTimerTask);
+    submitCurrentBuffer(False);
+  }
+
+  return checkForFailure();
+}
+
+Boolean RecordingWriter::finish() {
+  if (!fIsFinished) {
+    envir().taskScheduler().unscheduleDelayedTask(fFlushTimerTask);
+    submitCurrentBuffer(True);
+    fIsFinished = True;
+
+    std::unique_lock<std::mutex> lock(fWriterThread->fLock);
+    while (fNumPendingBuffers > 0) fWriterThread->fBufferWasWritten.wait(lock);
+  }
+
+  return checkForFailure();
+}
+
+Boolean RecordingWriter::hasFreeBuffer() {
+  if (fCurrentBuffer != NULL) return True;
+
+  std::lock_guard<std::mutex> guard(fWriterThread->fLock);
+  return fFreeBuffers != NULL || fNumBuffers < fParams.maxNumBuffers;
+}
+
+void RecordingWriter::notifyWhenBufferIsFree(TaskFunc* handler, void* clientData) {
+  fBufferIsFreeHandler = handler;
+  fBufferIsFreeClientData = clientData;
+
+  Boolean haveFreeBuffer;
+  {
+    // Check - and, if necessary, ask to be notified - while holding the lock, so that a buffer can't be freed in between:
+    std::lock_guard<std::mutex> guard(fWriterThread->fLock);
+    haveFreeBuffer = fCurrentBuffer != NULL || fFreeBuffers != NULL || fNumBuffers < fParams.maxNumBuffers;
+    fWantsBufferIsFreeNotification = !haveFreeBuffer;
+  }
+  if (haveFreeBuffer) envir().taskScheduler().triggerEvent(fBufferIsFreeTrigger, this);
+}
+
+void RecordingWriter::bufferIsFreeHandler(void* clientData) {
+  RecordingWriter* writer = (RecordingWriter*)clientData;
+  TaskFunc* handler = writer->fBufferIsFreeHandler;
+  writer->fBufferIsFreeHandler = NULL;
+  if (handler != NULL) (*handler)(writer->fBufferIsFreeClientData);
+}
+
+RecordingBuffer* RecordingWriter::getFreeBuffer() {
+  RecordingBuffer* buffer;
+  {
+    std::lock_guard<std::mutex> guard(fWriterThread->fLock);
+    buffer = fFreeBuffers;
+    if (buffer != NULL) {
+      fFreeBuffers = buffer->next;
+    } else {
+      ++fNumBuffers;
+    }
+  }
+
+  if (buffer == NULL) {
+    buffer = new RecordingBuffer;
+    buffer->writer = this;
+#ifdef O_DIRECT
+    if (fUseDirectIO) {
+      void* data;
+      buffer->data = posix_memalign(&data, RECORDING_WRITER_DIRECT_IO_ALIGNMENT, fParams.bufferSize) == 0
+	? (unsigned char*)data : NULL;
+    } else
+#endif
+    buffer->data = (unsigned char*)malloc(fParams.bufferSize);
+    if (buffer->data == NULL) envir().internalError();
+  }
+  buffer->size = 0;
+  buffer->isFinal = False;
+
+  return buffer;
+}
+
+void RecordingWriter::submitCurrentBuffer(Boolean isFinal) {
+  RecordingBuffer* buffer = fCurrentBuffer;
+  fCurrentBuffer = NULL;
+  if (buffer == NULL) {
+    if (!isFinal) return;
+
+    // We still need to submit an (empty) buffer, so that any final actions get done:
+    buffer = getFreeBuffer();
+  }
+
+  if (fUseDirectIO && !isFinal) {
+    // Only a multiple of the alignment can be written now; keep any remaining bytes for later:
+    unsigned numAlignedBytes = buffer->size - buffer->size%RECORDING_WRITER_DIRECT_IO_ALIGNMENT;
+    if (numAlignedBytes == 0) {
+      fCurrentBuffer = buffer;
+      return;
+    }
+    if (numAlignedBytes < buffer->size) {
+      fCurrentBuffer = getFreeBuffer();
+      fCurrentBuffer->size = buffer->size - numAlignedBytes;
+      memcpy(fCurrentBuffer->data, &buffer->data[numAlignedBytes], fCurrentBuffer->size);
+      buffer->size = numAlignedBytes;
+    }
+  }
+
+  buffer->isFinal = isFinal;
+  fWriterThread->submit(buffer);
+}
+
+Boolean RecordingWriter::checkForFailure() {
+  int errorCode = fErrorCode.load(std::memory_order_acquire);
+  if (errorCode == 0) return True;
+
+  envir().setResultMsg("Failed to write recording file: ", strerror(errorCode));
+  return False;
+}
+
+void RecordingWriter::finishAllWriters() {
+  std::lock_guard<std::mutex> guard(registryLock);
+  for (RecordingWriter* writer = allWriters; writer != NULL; writer = writer->fNextWriter) {
+    writer->finish();
+  }
+}
+
+void RecordingWriter::flushTimerHandler(void* clientData) {
+  RecordingWriter* writer = (RecordingWriter*)clientData;
+  writer->fFlushTimerTask = NULL;
+  writer->flush();
+}
+
+void RecordingWriter::writeBuffer(RecordingBuffer* buffer) {
+  if (fErrorCode.load(std::memory_order_relaxed) != 0) return; // don't write anything after an error
+
+#ifdef O_DIRECT
+  if (buffer->isFinal && fDirectIOIsActive) {
+    // The final piece of data might not be aligned, so write it normally:
+    int flags = fcntl(fFD, F_GETFL);
+    if (flags >= 0) fcntl(fFD, F_SETFL, flags&~O_DIRECT);
+    fDirectIOIsActive = False;
+  }
+#endif
+
+  if (buffer->size > 0) {
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+    if (fParams.preallocationSize > 0) {
+      while (fFileOffset + buffer->size > fPreallocatedEnd) {
+	if (fallocate(fFD, FALLOC_FL_KEEP_SIZE, fPreallocatedEnd, fParams.preallocationSize) != 0) {
+	  fParams.preallocationSize = 0; // not supported by this file system; don't try again
+	  break;
+	}
+	fPreallocatedEnd += fParams.preallocationSize;
+      }
+    }
+#endif
+
+    if (!writeAll(buffer->data, buffer->size)) {
+      fErrorCode.store(errno != 0 ? errno : EIO, std::memory_order_release);
+      return;
+    }
+    fFileOffset += buffer->size;
+    fNumBytesWritten.fetch_add(buffer->size, std::memory_order_relaxed);
+    fNeedToSync = True;
+  }
+
+  if (fNeedToSync) {
+    struct timeval timeNow;
+    gettimeofday(&timeNow, NULL);
+    int64_t msSinceLastSync = (int64_t)(timeNow.tv_sec - fTimeOfLastSync.tv_sec)*1000
+      + (timeNow.tv_usec - fTimeOfLastSync.tv_usec)/1000;
+
+    if ((buffer->isFinal && fParams.syncOnClose)
+	|| (fParams.syncIntervalMS > 0 && msSinceLastSync >= (int64_t)fParams.syncIntervalMS)) {
+      if (syncFD(fFD) != 0) {
+	fErrorCode.store(errno, std::memory_order_release);
+	return;
+      }
+      fNeedToSync = False;
+      fTimeOfLastSync = timeNow;
+    }
+  }
+}
+
+Boolean RecordingWriter::writeAll(unsigned char const* data, unsigned dataSize) {
+  while (dataSize > 0) {
+    int numBytesWritten = writeToFD(fFD, data, dataSize);
+    if (numBytesWritten < 0) {
+      if (errno == EINTR) continue;
+#ifdef O_DIRECT
+      if (errno == EINVAL && fDirectIOIsActive) {
+	// This file system doesn't support 'direct I/O' after all, so continue without it:
+	int flags = fcntl(fFD, F_GETFL);
+	if (flags >= 0 && fcntl(fFD, F_SETFL, flags&~O_DIRECT) == 0) {
+	  fDirectIOIsActive = False;
+	  continue;
+	}
+      }
+#endif
+      return False;
+    }
+    if (numBytesWritten == 0) {
+      errno = EIO;
+      return False;
+    }
+
+    data += numBytesWritten;
+    dataSize -= numBytesWritten;
+  }
+
+  return True;
+}
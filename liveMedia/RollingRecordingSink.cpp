@@ -0,0 +1,359 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A sink that records a stream into a sequence of segment files - each starting at a key frame - with an
+// index (from wall-clock time to file+offset), and that deletes old segments according to a retention policy.
+// Implementation
+
+#include "RollingRecordingSink.hh"
+#include "H264VideoRTPSource.hh" // for "parseSPropParameterSets()"
+#include "OutputFile.hh"
+#include <time.h> // for "strftime()" and "gmtime()"
+
+static unsigned char const start_code[4] = {0x00, 0x00, 0x00, 0x01};
+
+////////// RollingRecordingParameters //////////
+
+RollingRecordingParameters::RollingRecordingParameters()
+  : segmentDurationSeconds(60), maxSegmentSize(0), retentionSeconds(0), maxTotalSize(0) {
+}
+
+////////// RollingRecordingSink //////////
+
+RollingRecordingSink*
+RollingRecordingSink::createNew(UsageEnvironment& env, char const* fileNamePrefix, char const* fileNameSuffix,
+				RollingRecordingParameters const& params, unsigned bufferSize, int hNumber,
+				char const* sPropParameterSetsStr1,
+				char const* sPropParameterSetsStr2,
+				char const* sPropParameterSetsStr3) {
+  if (fileNamePrefix == NULL) fileNamePrefix = "";
+  if (fileNameSuffix == NULL) fileNameSuffix = "";
+  if (hNumber != 0 && hNumber != 264 && hNumber != 265) {
+    env.setResultMsg("RollingRecordingSink::createNew(): \"hNumber\" must be 0, 264, or 265");
+    return NULL;
+  }
+
+  return new RollingRecordingSink(env, fileNamePrefix, fileNameSuffix, params, bufferSize, hNumber,
+				  sPropParameterSetsStr1, sPropParameterSetsStr2, sPropParameterSetsStr3);
+}
+
+RollingRecordingSink
+::RollingRecordingSink(UsageEnvironment& env, char const* fileNamePrefix, char const* fileNameSuffix,
+		       RollingRecordingParameters const& params, unsigned bufferSize, int hNumber,
+		       char const* sPropParameterSetsStr1,
+		       char const* sPropParameterSetsStr2,
+		       char const* sPropParameterSetsStr3)
+  : MediaSink(env),
+    fFileNamePrefix(strDup(fileNamePrefix)), fFileNameSuffix(strDup(fileNameSuffix)),
+    fParams(params), fHNumber(hNumber), fBufferSize(bufferSize),
+    fHeldData(NULL), fHeldDataSize(0), fHeldDataMaxSize(0),
+    fOutFid(NULL), fWriter(NULL), fCurrentSegment(NULL), fCurrentIndex(NULL) {
+  fSegmentListFileName = new char[strlen(fileNamePrefix) + 5 + 1];
+  sprintf(fSegmentListFileName, "%sindex", fileNamePrefix);
+  fSPropParameterSetsStr[0] = strDup(sPropParameterSetsStr1);
+  fSPropParameterSetsStr[1] = strDup(sPropParameterSetsStr2);
+  fSPropParameterSetsStr[2] = strDup(sPropParameterSetsStr3);
+  fBuffer = new unsigned char[bufferSize];
+  fHeldDataPresentationTime.tv_sec = fHeldDataPresentationTime.tv_usec = 0;
+  fLastKeyFramePresentationTime.tv_sec = fLastKeyFramePresentationTime.tv_usec = 0;
+
+  // Pick up any segments that were recorded earlier (so that our retention policy applies to them also):
+  fSegments.readFromFile(fSegmentListFileName);
+}
+
+RollingRecordingSink::~RollingRecordingSink() {
+  // Don't lose any NAL units that we were holding back:
+  if (fHeldDataSize > 0 && fCurrentSegment != NULL) writeData(fHeldData, fHeldDataSize);
+  endCurrentSegment();
+
+  delete[] fHeldData;
+  delete[] fBuffer;
+  for (unsigned j = 0; j < 3; ++j) delete[] fSPropParameterSetsStr[j];
+  delete[] fSegmentListFileName;
+  delete[] fFileNameSuffix;
+  delete[] fFileNamePrefix;
+}
+
+Boolean RollingRecordingSink
+::findKeyFrame(struct timeval const& wallClockTime,
+	       char*& resultFileName, u_int64_t& resultFileOffset,
+	       struct timeval& resultPresentationTime) {
+  resultFileName = NULL; // unless we succeed
+
+  RecordingSegment* segment = segmentContaining(wallClockTime);
+  if (segment == NULL) return False;
+
+  // Look up the key frame in the segment's index (which - unless it's the current segment - is in its ".idx" file):
+  SegmentKeyFrameIndex* index = fCurrentIndex;
+  if (segment != fCurrentSegment) {
+    char* indexFileName = segment->indexFileName();
+    index = SegmentKeyFrameIndex::createFromFile(indexFileName);
+    delete[] indexFileName;
+  }
+
+  int entry = index == NULL ? -1 : index->lookup(timevalToMicroseconds(wallClockTime));
+  if (entry >= 0) {
+    resultFileOffset = index->offset(entry);
+    resultPresentationTime = microsecondsToTimeval(index->time(entry));
+  } else {
+    // The segment has no (readable) index, so use its start:
+    resultFileOffset = 0;
+    resultPresentationTime = segment->fStartTime;
+  }
+  if (index != fCurrentIndex) delete index;
+  resultFileName = strDup(segment->fFileName);
+  return True;
+}
+
+unsigned RollingRecordingSink::numSegments() const {
+  return fSegments.numSegments() + (fCurrentSegment != NULL ? 1 : 0);
+}
+
+u_int64_t RollingRecordingSink::totalSize() const {
+  return fSegments.totalSize() + (fCurrentSegment != NULL ? fCurrentSegment->fSize : 0);
+}
+
+Boolean RollingRecordingSink::continuePlaying() {
+  if (fSource == NULL) return False;
+
+  if (fWriter != NULL && !fWriter->hasFreeBuffer()) {
+    // The disk isn't keeping up with us.  Rather than block (or drop data), don't ask for the next frame until it has:
+    fWriter->notifyWhenBufferIsFree(writerHasFreeBuffer, this);
+    return True;
+  }
+
+  fSource->getNextFrame(fBuffer, fBufferSize,
+			afterGettingFrame, this,
+			onSourceClosure, this);
+
+  return True;
+}
+
+void RollingRecordingSink::writerHasFreeBuffer(void* clientData) {
+  RollingRecordingSink* sink = (RollingRecordingSink*)clientData;
+  if (sink->fSource != NULL && !sink->fSource->isCurrentlyAwaitingData()) sink->continuePlaying();
+}
+
+void RollingRecordingSink::afterGettingFrame(void* clientData, unsigned frameSize,
+					     unsigned numTruncatedBytes,
+					     struct timeval presentationTime,
+					     unsigned /*durationInMicroseconds*/) {
+  RollingRecordingSink* sink = (RollingRecordingSink*)clientData;
+  sink->afterGettingFrame(frameSize, numTruncatedBytes, presentationTime);
+}
+
+void RollingRecordingSink::afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes,
+					     struct timeval presentationTime) {
+  if (numTruncatedBytes > 0) {
+    envir() << "RollingRecordingSink::afterGettingFrame(): The input frame data was too large for our buffer size ("
+	    << fBufferSize << ").  "
+            << numTruncatedBytes << " bytes of trailing data was dropped!  Correct this by increasing the \"bufferSize\" parameter in the \"createNew()\" call to at least "
+            << fBufferSize + numTruncatedBytes << "\n";
+  }
+
+  Boolean isKeyFrame, isKeyFramePrefix;
+  classifyFrame(frameSize, isKeyFrame, isKeyFramePrefix);
+
+  if (isKeyFramePrefix) {
+    // Hold this NAL unit back, until we see what follows it:
+    if (fHeldDataSize == 0) fHeldDataPresentationTime = presentationTime;
+    holdData(start_code, 4);
+    holdData(fBuffer, frameSize);
+  } else {
+    struct timeval const& frameStartTime = fHeldDataSize > 0 ? fHeldDataPresentationTime : presentationTime;
+    Boolean success = True;
+
+    if (isKeyFrame
+	&& (fCurrentSegment == NULL || fHeldDataSize > 0
+	    || presentationTime.tv_sec != fLastKeyFramePresentationTime.tv_sec
+	    || presentationTime.tv_usec != fLastKeyFramePresentationTime.tv_usec)) {
+      // This is the start of a new key frame (rather than another slice of the previous one).
+      // If the current segment is full, then end it here:
+      if (fCurrentSegment == NULL || segmentIsFull(frameStartTime)) success = startNewSegment(frameStartTime);
+      if (success) fCurrentIndex->addEntry(timevalToMicroseconds(frameStartTime), fCurrentSegment->fSize);
+      fLastKeyFramePresentationTime = presentationTime;
+    } else if (fCurrentSegment == NULL) {
+      // We haven't yet seen a key frame.  Record this data anyway:
+      success = startNewSegment(frameStartTime);
+    }
+
+    if (success && fHeldDataSize > 0) success = writeData(fHeldData, fHeldDataSize);
+    fHeldDataSize = 0;
+    if (success && fHNumber != 0) success = writeData(start_code, 4);
+    if (success) success = writeData(fBuffer, frameSize);
+    if (success) success = fWriter->endOfFrame();
+
+    if (!success) {
+      // We couldn't write our output.  Handle this the same way as if the input source had closed:
+      if (fSource != NULL) fSource->stopGettingFrames();
+      onSourceClosure();
+      return;
+    }
+    fCurrentSegment->fEndTime = presentationTime;
+  }
+
+  // Then try getting the next frame:
+  continuePlaying();
+}
+
+void RollingRecordingSink
+::classifyFrame(unsigned frameSize, Boolean& isKeyFrame, Boolean& isKeyFramePrefix) const {
+  isKeyFrame = isKeyFramePrefix = False; // by default
+
+  if (fHNumber == 264) {
+    if (frameSize < 1) return;
+    u_int8_t nal_unit_type = fBuffer[0]&0x1F;
+    isKeyFrame = nal_unit_type == 5; // IDR
+    isKeyFramePrefix = nal_unit_type >= 6 && nal_unit_type <= 9; // SEI, SPS, PPS, or access unit delimiter
+  } else if (fHNumber == 265) {
+    if (frameSize < 2) return;
+    u_int8_t nal_unit_type = (fBuffer[0]&0x7E)>>1;
+    isKeyFrame = nal_unit_type >= 16 && nal_unit_type <= 21; // IRAP
+    isKeyFramePrefix = (nal_unit_type >= 32 && nal_unit_type <= 35) || nal_unit_type == 39;
+        // VPS, SPS, PPS, access unit delimiter, or prefix SEI
+  } else {
+    isKeyFrame = True;
+  }
+}
+
+Boolean RollingRecordingSink::segmentIsFull(struct timeval const& presentationTime) const {
+  if (fParams.maxSegmentSize > 0 && fCurrentSegment->fSize >= fParams.maxSegmentSize) return True;
+
+  u_int64_t startTime = timevalToMicroseconds(fCurrentSegment->fStartTime);
+  u_int64_t now = timevalToMicroseconds(presentationTime);
+  return fParams.segmentDurationSeconds > 0
+    && now >= startTime + (u_int64_t)fParams.segmentDurationSeconds*1000000;
+}
+
+Boolean RollingRecordingSink::startNewSegment(struct timeval const& presentationTime) {
+  endCurrentSegment();
+
+  // Name the new segment file from its start time:
+  char timeString[100];
+  time_t tt = presentationTime.tv_sec;
+  strftime(timeString, sizeof timeString, "%Y%m%d-%H%M%S", gmtime(&tt));
+  char* fileName = new char[strlen(fFileNamePrefix) + strlen(timeString) + 4 + strlen(fFileNameSuffix) + 1];
+  sprintf(fileName, "%s%s-%03u%s", fFileNamePrefix, timeString,
+	  (unsigned)(presentationTime.tv_usec/1000), fFileNameSuffix);
+
+  fOutFid = OpenOutputFile(envir(), fileName);
+  if (fOutFid == NULL) {
+    delete[] fileName;
+    return False;
+  }
+  fWriter = RecordingWriter::createNew(envir(), fOutFid, fParams.writeParameters);
+  fCurrentSegment = new RecordingSegment(fileName, presentationTime);
+  fCurrentIndex = new SegmentKeyFrameIndex;
+  delete[] fileName;
+
+  writeSegmentList();
+
+  // If we have NAL units encoded in "sprop parameter strings", put these at the start of the segment:
+  for (unsigned j = 0; j < 3; ++j) {
+    unsigned numSPropRecords;
+    SPropRecord* sPropRecords = parseSPropParameterSets(fSPropParameterSetsStr[j], numSPropRecords);
+    for (unsigned i = 0; i < numSPropRecords; ++i) {
+      if (sPropRecords[i].sPropLength > 0) writeData(start_code, 4);
+      writeData(sPropRecords[i].sPropBytes, sPropRecords[i].sPropLength);
+    }
+    delete[] sPropRecords;
+  }
+
+  return !fWriter->hasFailed();
+}
+
+void RollingRecordingSink::endCurrentSegment() {
+  if (fCurrentSegment == NULL) return;
+
+  Medium::close(fWriter); fWriter = NULL; // writes any remaining data
+  CloseOutputFile(fOutFid); fOutFid = NULL;
+
+  char* indexFileName = fCurrentSegment->indexFileName();
+  fCurrentIndex->writeToFile(envir(), indexFileName);
+  delete[] indexFileName;
+  delete fCurrentIndex; fCurrentIndex = NULL;
+
+  RecordingSegment* segment = fCurrentSegment;
+  fCurrentSegment = NULL;
+  fSegments.addSegment(segment);
+
+  applyRetentionPolicy();
+  writeSegmentList();
+}
+
+Boolean RollingRecordingSink::writeData(unsigned char const* data, unsigned dataSize) {
+  fCurrentSegment->fSize += dataSize;
+  return fWriter->addData(data, dataSize);
+}
+
+void RollingRecordingSink::holdData(unsigned char const* data, unsigned dataSize) {
+  if (fHeldDataSize + dataSize > fHeldDataMaxSize) {
+    unsigned newMaxSize = 2*(fHeldDataSize + dataSize);
+    unsigned char* newHeldData = new unsigned char[newMaxSize];
+    memmove(newHeldData, fHeldData, fHeldDataSize);
+    delete[] fHeldData;
+    fHeldData = newHeldData; fHeldDataMaxSize = newMaxSize;
+  }
+  memmove(&fHeldData[fHeldDataSize], data, dataSize);
+  fHeldDataSize += dataSize;
+}
+
+void RollingRecordingSink::deleteOldestSegment() {
+  RecordingSegment* segment = fSegments.removeOldestSegment();
+
+  remove(segment->fFileName);
+  char* indexFileName = segment->indexFileName();
+  remove(indexFileName);
+  delete[] indexFileName;
+
+  delete segment;
+}
+
+void RollingRecordingSink::applyRetentionPolicy() {
+  unsigned numSegments = fSegments.numSegments();
+  if (numSegments == 0) return;
+
+  // Note that we never delete the most recent (complete) segment:
+  u_int64_t newestEndTime = timevalToMicroseconds(fSegments.segment(numSegments-1)->fEndTime);
+  while (fSegments.numSegments() > 1) {
+    RecordingSegment* oldest = fSegments.segment(0);
+    Boolean isTooOld = fParams.retentionSeconds > 0
+      && timevalToMicroseconds(oldest->fEndTime) + (u_int64_t)fParams.retentionSeconds*1000000 < newestEndTime;
+    Boolean isOverSizeLimit = fParams.maxTotalSize > 0 && fSegments.totalSize() > fParams.maxTotalSize;
+    if (!isTooOld && !isOverSizeLimit) break;
+
+    deleteOldestSegment();
+  }
+}
+
+void RollingRecordingSink::writeSegmentList() {
+  // (The current segment is listed also, so that - if we stop without ending it properly - it will still be found.)
+  fSegments.writeToFile(envir(), fSegmentListFileName, fCurrentSegment);
+}
+
+RecordingSegment* RollingRecordingSink::segmentContaining(struct timeval const& wallClockTime) const {
+  // Find the last segment (including the current one) that starts at (or before) "wallClockTime" - or
+  // the earliest segment, if there's none:
+  if (fCurrentSegment != NULL
+      && (fSegments.numSegments() == 0
+	  || timevalToMicroseconds(fCurrentSegment->fStartTime) <= timevalToMicroseconds(wallClockTime))) {
+    return fCurrentSegment;
+  }
+
+  int i = fSegments.lookup(timevalToMicroseconds(wallClockTime));
+  return i < 0 ? NULL : fSegments.segment(i);
+}
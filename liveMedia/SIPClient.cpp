@@ -588,7 +588,7 @@ unsigned SIPClient::getResponseCode() {
         while (numExtraBytesNeeded > 0) {
           char* ptr = &readBuf[bytesRead];
 	  unsigned bytesRead2;
-	  struct sockaddr_in fromAddr;
+	  struct sockaddr_storage fromAddr;
 	  Boolean readSuccess
 	    = fOurSocket->handleRead((unsigned char*)ptr,
 				     numExtraBytesNeeded,
@@ -793,7 +793,7 @@ Boolean SIPClient::parseSIPURL(UsageEnvironment& env, char const* url,
       break;
     }
 
-    NetAddressList addresses(parseBuffer);
+    NetAddressList addresses(parseBuffer, AF_INET); // we support IPv4 only
     if (addresses.numAddresses() == 0) {
       env.setResultMsg("Failed to find network address for \"",
 			   parseBuffer, "\"");
@@ -910,7 +910,7 @@ unsigned SIPClient::getResponse(char*& responseBuffer,
   int bytesRead = 0;
   while (bytesRead < (int)responseBufferSize) {
     unsigned bytesReadNow;
-    struct sockaddr_in fromAddr;
+    struct sockaddr_storage fromAddr;
     unsigned char* toPosn = (unsigned char*)(responseBuffer+bytesRead);
     Boolean readSuccess
       = fOurSocket->handleRead(toPosn, responseBufferSize-bytesRead,
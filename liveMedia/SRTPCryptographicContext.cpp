@@ -0,0 +1,522 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// The SRTP 'cryptographic context' (RFC 3711, RFC 7714)
+// Implementation
+
+#include "SRTPCryptographicContext.hh"
+#include <string.h>
+#ifndef NO_OPENSSL
+#include <openssl/evp.h>
+#include <openssl/crypto.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#define USE_EVP_MAC 1
+#else
+#include <openssl/hmac.h>
+#endif
+#endif
+
+// SRTP key derivation labels (RFC 3711, section 4.3.2):
+#define LABEL_SRTP_ENCRYPTION 0x00
+#define LABEL_SRTCP_ENCRYPTION 0x03
+// (The authentication and salting key labels are these plus 1 and 2, respectively.)
+
+#define HMAC_SHA1_SIZE 20
+#define AES_GCM_TAG_SIZE 16
+#define SRTCP_INDEX_SIZE 4
+
+static void put4Bytes(u_int8_t* p, u_int32_t value) {
+  p[0] = value>>24; p[1] = value>>16; p[2] = value>>8; p[3] = (u_int8_t)value;
+}
+
+#ifndef NO_OPENSSL
+static u_int32_t get4Bytes(u_int8_t const* p) {
+  return (p[0]<<24)|(p[1]<<16)|(p[2]<<8)|p[3];
+}
+
+// Returns the size of a RTP packet's header (including any CSRCs and header extension), or 0 if it's malformed:
+static unsigned rtpHeaderSize(u_int8_t const* packet, unsigned packetSize) {
+  if (packetSize < 12) return 0;
+  unsigned hdrSize = 12 + 4*(packet[0]&0x0F);
+  if ((packet[0]&0x10) != 0) { // there's a header extension
+    if (hdrSize + 4 > packetSize) return 0;
+    hdrSize += 4 + 4*((packet[hdrSize+2]<<8)|packet[hdrSize+3]);
+  }
+  return hdrSize > packetSize ? 0 : hdrSize;
+}
+#endif
+
+////////// SRTPCryptographicContext::SSRCState implementation //////////
+
+SRTPCryptographicContext::SSRCState::SSRCState()
+  : roc(0), lastSeqNum(0), haveSentSRTP(False), nextSRTCPIndex(0),
+    highestSRTPIndex(0), srtpReplayWindow(0), haveReceivedSRTP(False), initialROC(0),
+    highestSRTCPIndex(0), srtcpReplayWindow(0), haveReceivedSRTCP(False) {
+}
+
+SRTPCryptographicContext::SSRCState*
+SRTPCryptographicContext::lookupSSRCState(HashTable* table, u_int32_t ssrc, Boolean createIfNotFound) {
+  SSRCState* state = (SSRCState*)(table->Lookup((char const*)(long)ssrc));
+  if (state == NULL && createIfNotFound) {
+    state = new SSRCState;
+    table->Add((char const*)(long)ssrc, state);
+  }
+  return state;
+}
+
+Boolean SRTPCryptographicContext::isReplay(u_int64_t index, u_int64_t highestIndex, u_int64_t replayWindow) {
+  if (index > highestIndex) return False;
+  u_int64_t delta = highestIndex - index;
+  if (delta >= 64) return True; // too old to tell, so assume the worst
+  return ((replayWindow>>delta)&1) != 0;
+}
+
+void SRTPCryptographicContext::noteReceivedIndex(u_int64_t index, u_int64_t& highestIndex, u_int64_t& replayWindow) {
+  if (index > highestIndex) {
+    u_int64_t shift = index - highestIndex;
+    replayWindow = shift >= 64 ? 0 : replayWindow<<shift;
+    replayWindow |= 1;
+    highestIndex = index;
+  } else {
+    replayWindow |= ((u_int64_t)1)<<(highestIndex - index);
+  }
+}
+
+////////// SRTPCryptographicContext implementation //////////
+
+Boolean SRTPCryptographicContext::isSupported() {
+#ifndef NO_OPENSSL
+  return True;
+#else
+  return False;
+#endif
+}
+
+SRTPCryptographicContext* SRTPCryptographicContext::createNew(MIKEYState const& mikeyState) {
+  if (!isSupported()) return NULL;
+
+  SRTPCryptographicContext* newContext = new SRTPCryptographicContext(mikeyState);
+  if (!newContext->deriveKeys(mikeyState)) {
+    delete newContext;
+    return NULL;
+  }
+  return newContext;
+}
+
+SRTPCryptographicContext::SRTPCryptographicContext(MIKEYState const& mikeyState)
+  : fProfile(mikeyState.profile()), fEncryptSRTP(mikeyState.encryptSRTP()), fEncryptSRTCP(mikeyState.encryptSRTCP()),
+    fSRTPEncryptCtx(NULL), fSRTPDecryptCtx(NULL), fSRTCPEncryptCtx(NULL), fSRTCPDecryptCtx(NULL),
+    fSRTPAuthCtx(NULL), fSRTCPAuthCtx(NULL),
+    fOutgoingSSRCs(HashTable::create(ONE_WORD_HASH_KEYS)), fIncomingSSRCs(HashTable::create(ONE_WORD_HASH_KEYS)),
+    fNumAuthenticationFailures(0), fNumReplayedPackets(0) {
+  memset(fSRTPSessionSalt, 0, sizeof fSRTPSessionSalt);
+  memset(fSRTCPSessionSalt, 0, sizeof fSRTCPSessionSalt);
+}
+
+SRTPCryptographicContext::~SRTPCryptographicContext() {
+#ifndef NO_OPENSSL
+  EVP_CIPHER_CTX_free((EVP_CIPHER_CTX*)fSRTPEncryptCtx);
+  EVP_CIPHER_CTX_free((EVP_CIPHER_CTX*)fSRTPDecryptCtx);
+  EVP_CIPHER_CTX_free((EVP_CIPHER_CTX*)fSRTCPEncryptCtx);
+  EVP_CIPHER_CTX_free((EVP_CIPHER_CTX*)fSRTCPDecryptCtx);
+#ifdef USE_EVP_MAC
+  EVP_MAC_CTX_free((EVP_MAC_CTX*)fSRTPAuthCtx);
+  EVP_MAC_CTX_free((EVP_MAC_CTX*)fSRTCPAuthCtx);
+#else
+  HMAC_CTX_free((HMAC_CTX*)fSRTPAuthCtx);
+  HMAC_CTX_free((HMAC_CTX*)fSRTCPAuthCtx);
+#endif
+#endif
+
+  SSRCState* state;
+  while ((state = (SSRCState*)fOutgoingSSRCs->RemoveNext()) != NULL) delete state;
+  delete fOutgoingSSRCs;
+  while ((state = (SSRCState*)fIncomingSSRCs->RemoveNext()) != NULL) delete state;
+  delete fIncomingSSRCs;
+}
+
+Boolean SRTPCryptographicContext::deriveKeys(MIKEYState const& mikeyState) {
+#ifndef NO_OPENSSL
+  // The key derivation function (RFC 3711, section 4.3) is AES in counter mode, keyed with the master key, and with
+  // IV = (master salt XOR label<<48) * 2^16.  (For AES-GCM, the 12-byte master salt is padded with zeros - RFC 7714,
+  // section 11.)
+  EVP_CIPHER_CTX* kdf = EVP_CIPHER_CTX_new();
+  if (kdf == NULL) return False;
+  Boolean success = EVP_EncryptInit_ex(kdf, EVP_aes_128_ctr(), NULL, mikeyState.masterKey(), NULL) == 1;
+
+  Boolean const isGCM = fProfile == MIKEYState::AEAD_AES_128_GCM;
+  EVP_CIPHER const* cipher = isGCM ? EVP_aes_128_gcm() : EVP_aes_128_ctr();
+  u_int8_t keys[2][3][HMAC_SHA1_SIZE]; // [SRTP/SRTCP][encryption key/authentication key/salt]
+  unsigned const keySizes[3] = { 16, HMAC_SHA1_SIZE, 14 };
+  for (unsigned i = 0; i < 2 && success; ++i) {
+    for (unsigned j = 0; j < 3 && success; ++j) {
+      u_int8_t iv[16];
+      memset(iv, 0, sizeof iv);
+      memcpy(iv, mikeyState.masterSalt(), mikeyState.masterSaltSize());
+      iv[7] ^= (i == 0 ? LABEL_SRTP_ENCRYPTION : LABEL_SRTCP_ENCRYPTION) + j;
+
+      int len;
+      memset(keys[i][j], 0, sizeof keys[i][j]);
+      success = EVP_EncryptInit_ex(kdf, NULL, NULL, NULL, iv) == 1
+	&& EVP_EncryptUpdate(kdf, keys[i][j], &len, keys[i][j], keySizes[j]) == 1;
+    }
+  }
+  EVP_CIPHER_CTX_free(kdf);
+  if (!success) return False;
+  memcpy(fSRTPSessionSalt, keys[0][2], sizeof fSRTPSessionSalt);
+  memcpy(fSRTCPSessionSalt, keys[1][2], sizeof fSRTCPSessionSalt);
+
+  // Set up the cipher contexts (once; each packet then sets only its IV):
+  void** ctxs[4] = { &fSRTPEncryptCtx, &fSRTPDecryptCtx, &fSRTCPEncryptCtx, &fSRTCPDecryptCtx };
+  for (unsigned k = 0; k < 4 && success; ++k) {
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    *ctxs[k] = ctx;
+    success = ctx != NULL && EVP_CipherInit_ex(ctx, cipher, NULL, keys[k/2][0], NULL, (k%2) == 0) == 1;
+  }
+
+  // and (for AES-CM) the HMAC-SHA1 contexts:
+  if (!isGCM) {
+    void** authCtxs[2] = { &fSRTPAuthCtx, &fSRTCPAuthCtx };
+    for (unsigned k = 0; k < 2 && success; ++k) {
+#ifdef USE_EVP_MAC
+      EVP_MAC* mac = EVP_MAC_fetch(NULL, "HMAC", NULL);
+      EVP_MAC_CTX* ctx = mac == NULL ? NULL : EVP_MAC_CTX_new(mac);
+      EVP_MAC_free(mac);
+      *authCtxs[k] = ctx;
+      OSSL_PARAM params[2];
+      params[0] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, (char*)"SHA1", 0);
+      params[1] = OSSL_PARAM_construct_end();
+      success = ctx != NULL && EVP_MAC_init(ctx, keys[k][1], HMAC_SHA1_SIZE, params) == 1;
+#else
+      HMAC_CTX* ctx = HMAC_CTX_new();
+      *authCtxs[k] = ctx;
+      success = ctx != NULL && HMAC_Init_ex(ctx, keys[k][1], HMAC_SHA1_SIZE, EVP_sha1(), NULL) == 1;
+#endif
+    }
+  }
+
+  OPENSSL_cleanse(keys, sizeof keys);
+  return success;
+#else
+  return False;
+#endif
+}
+
+void SRTPCryptographicContext::computeIV(Boolean forSRTCP, u_int32_t ssrc, u_int64_t index, u_int8_t* iv) {
+  // AES-CM (RFC 3711, section 4.1.1): IV = (session salt * 2^16) XOR (SSRC * 2^64) XOR (index * 2^16)
+  // AES-GCM (RFC 7714, sections 8.1 and 9.1): IV = session salt XOR (0x0000 || SSRC || index), in 12 bytes
+  u_int8_t const* salt = forSRTCP ? fSRTCPSessionSalt : fSRTPSessionSalt;
+  unsigned const ssrcPosition = fProfile == MIKEYState::AEAD_AES_128_GCM ? 2 : 4;
+
+  memset(iv, 0, 16);
+  put4Bytes(&iv[ssrcPosition], ssrc);
+  u_int8_t* indexBytes = &iv[ssrcPosition + 4];
+  for (unsigned i = 0; i < 6; ++i) indexBytes[i] = (u_int8_t)(index>>(8*(5-i)));
+  for (unsigned i = 0; i < (fProfile == MIKEYState::AEAD_AES_128_GCM ? 12 : 14); ++i) iv[i] ^= salt[i];
+}
+
+Boolean SRTPCryptographicContext
+::computeAuthenticationTag(Boolean forSRTCP, u_int8_t const* data, unsigned dataSize,
+			   u_int8_t const* roc, u_int8_t* resultTag) {
+#ifndef NO_OPENSSL
+#ifdef USE_EVP_MAC
+  EVP_MAC_CTX* ctx = (EVP_MAC_CTX*)(forSRTCP ? fSRTCPAuthCtx : fSRTPAuthCtx);
+  size_t tagSize;
+  return EVP_MAC_init(ctx, NULL, 0, NULL) == 1 // re-initializes, using the same key
+    && EVP_MAC_update(ctx, data, dataSize) == 1
+    && (roc == NULL || EVP_MAC_update(ctx, roc, 4) == 1)
+    && EVP_MAC_final(ctx, resultTag, &tagSize, HMAC_SHA1_SIZE) == 1;
+#else
+  HMAC_CTX* ctx = (HMAC_CTX*)(forSRTCP ? fSRTCPAuthCtx : fSRTPAuthCtx);
+  unsigned tagSize;
+  return HMAC_Init_ex(ctx, NULL, 0, NULL, NULL) == 1 // re-initializes, using the same key
+    && HMAC_Update(ctx, data, dataSize) == 1
+    && (roc == NULL || HMAC_Update(ctx, roc, 4) == 1)
+    && HMAC_Final(ctx, resultTag, &tagSize) == 1;
+#endif
+#else
+  return False;
+#endif
+}
+
+Boolean SRTPCryptographicContext
+::aesGCM(Boolean forSRTCP, Boolean encrypt, u_int8_t const* iv, u_int8_t const* aad1, unsigned aad1Size,
+	 u_int8_t const* aad2, unsigned aad2Size, u_int8_t* data, unsigned dataSize, u_int8_t* tag) {
+#ifndef NO_OPENSSL
+  EVP_CIPHER_CTX* ctx
+    = (EVP_CIPHER_CTX*)(forSRTCP ? (encrypt ? fSRTCPEncryptCtx : fSRTCPDecryptCtx)
+			: (encrypt ? fSRTPEncryptCtx : fSRTPDecryptCtx));
+  int len;
+  u_int8_t finalBlock[16];
+  if (EVP_CipherInit_ex(ctx, NULL, NULL, NULL, iv, encrypt) != 1) return False;
+  if (aad1Size > 0 && EVP_CipherUpdate(ctx, NULL, &len, aad1, aad1Size) != 1) return False;
+  if (aad2Size > 0 && EVP_CipherUpdate(ctx, NULL, &len, aad2, aad2Size) != 1) return False;
+  if (dataSize > 0 && EVP_CipherUpdate(ctx, data, &len, data, dataSize) != 1) return False;
+  if (encrypt) {
+    return EVP_CipherFinal_ex(ctx, finalBlock, &len) == 1
+      && EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, AES_GCM_TAG_SIZE, tag) == 1;
+  } else {
+    return EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, AES_GCM_TAG_SIZE, tag) == 1
+      && EVP_CipherFinal_ex(ctx, finalBlock, &len) > 0; // checks the tag
+  }
+#else
+  return False;
+#endif
+}
+
+u_int32_t SRTPCryptographicContext::outgoingROC(u_int32_t ssrc, u_int16_t nextSeqNum) const {
+  SSRCState* state = lookupSSRCState(fOutgoingSSRCs, ssrc, False);
+  if (state == NULL || !state->haveSentSRTP) return 0;
+
+  // (As in "processOutgoingSRTPPacket()", the counter increments if the sequence number wraps around:)
+  u_int32_t roc = state->roc;
+  if (nextSeqNum < state->lastSeqNum && (u_int16_t)(nextSeqNum - state->lastSeqNum) < 0x8000) ++roc;
+  return roc;
+}
+
+void SRTPCryptographicContext::setIncomingROC(u_int32_t ssrc, u_int32_t roc) {
+  SSRCState* state = lookupSSRCState(fIncomingSSRCs, ssrc, True);
+  if (!state->haveReceivedSRTP) state->initialROC = roc;
+}
+
+Boolean SRTPCryptographicContext
+::processOutgoingSRTPPacket(u_int8_t* buffer, unsigned inPacketSize, unsigned& outPacketSize) {
+#ifndef NO_OPENSSL
+  unsigned hdrSize = rtpHeaderSize(buffer, inPacketSize);
+  if (hdrSize == 0) return False;
+  u_int16_t seqNum = (buffer[2]<<8)|buffer[3];
+  u_int32_t ssrc = get4Bytes(&buffer[8]);
+
+  // Update the SSRC's rollover counter, if its sequence number has wrapped around:
+  SSRCState* state = lookupSSRCState(fOutgoingSSRCs, ssrc, True);
+  if (state->haveSentSRTP && seqNum < state->lastSeqNum && (u_int16_t)(seqNum - state->lastSeqNum) < 0x8000) {
+    ++state->roc;
+  }
+  state->lastSeqNum = seqNum;
+  state->haveSentSRTP = True;
+  u_int64_t index = ((u_int64_t)state->roc<<16)|seqNum;
+
+  u_int8_t iv[16];
+  computeIV(False, ssrc, index, iv);
+  if (fProfile == MIKEYState::AEAD_AES_128_GCM) {
+    // The header (and, if we're not encrypting, the payload) is 'additional authenticated data':
+    unsigned aadSize = fEncryptSRTP ? hdrSize : inPacketSize;
+    if (!aesGCM(False, True, iv, buffer, aadSize, NULL, 0, &buffer[aadSize], inPacketSize - aadSize,
+		&buffer[inPacketSize])) return False;
+    outPacketSize = inPacketSize + AES_GCM_TAG_SIZE;
+  } else {
+    if (fEncryptSRTP) {
+      EVP_CIPHER_CTX* ctx = (EVP_CIPHER_CTX*)fSRTPEncryptCtx;
+      int len;
+      if (EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, iv) != 1
+	  || EVP_EncryptUpdate(ctx, &buffer[hdrSize], &len, &buffer[hdrSize], inPacketSize - hdrSize) != 1) {
+	return False;
+      }
+    }
+
+    // The authentication tag covers the packet, followed by the rollover counter (which isn't sent):
+    u_int8_t roc[4], tag[HMAC_SHA1_SIZE];
+    put4Bytes(roc, state->roc);
+    if (!computeAuthenticationTag(False, buffer, inPacketSize, roc, tag)) return False;
+    memcpy(&buffer[inPacketSize], tag, srtpTrailerSize());
+    outPacketSize = inPacketSize + srtpTrailerSize();
+  }
+  return True;
+#else
+  return False;
+#endif
+}
+
+Boolean SRTPCryptographicContext
+::processIncomingSRTPPacket(u_int8_t* buffer, unsigned inPacketSize, unsigned& outPacketSize) {
+#ifndef NO_OPENSSL
+  if (inPacketSize < srtpTrailerSize()) return False;
+  unsigned const packetSize = inPacketSize - srtpTrailerSize(); // without the trailer
+  unsigned hdrSize = rtpHeaderSize(buffer, packetSize);
+  if (hdrSize == 0) return False;
+  u_int16_t seqNum = (buffer[2]<<8)|buffer[3];
+  u_int32_t ssrc = get4Bytes(&buffer[8]);
+
+  // Estimate the packet's index (RFC 3711, appendix A), and check that it's not a replay:
+  SSRCState* state = lookupSSRCState(fIncomingSSRCs, ssrc, False);
+  u_int64_t index = state == NULL ? seqNum : ((u_int64_t)state->initialROC<<16)|seqNum;
+      // if this is the first packet from this SSRC
+  if (state != NULL && state->haveReceivedSRTP) {
+    u_int32_t roc = (u_int32_t)(state->highestSRTPIndex>>16);
+    u_int16_t highestSeqNum = (u_int16_t)state->highestSRTPIndex;
+    u_int32_t v = roc;
+    if (highestSeqNum < 0x8000) {
+      if (seqNum > highestSeqNum && seqNum - highestSeqNum > 0x8000 && roc > 0) v = roc - 1;
+    } else {
+      if (seqNum < highestSeqNum - 0x8000) v = roc + 1;
+    }
+    index = ((u_int64_t)v<<16)|seqNum;
+
+    if (isReplay(index, state->highestSRTPIndex, state->srtpReplayWindow)) {
+      ++fNumReplayedPackets;
+      return False;
+    }
+  }
+
+  // Authenticate, then decrypt:
+  u_int8_t iv[16];
+  computeIV(False, ssrc, index, iv);
+  Boolean success;
+  if (fProfile == MIKEYState::AEAD_AES_128_GCM) {
+    unsigned aadSize = fEncryptSRTP ? hdrSize : packetSize;
+    success = aesGCM(False, False, iv, buffer, aadSize, NULL, 0, &buffer[aadSize], packetSize - aadSize,
+		     &buffer[packetSize]);
+  } else {
+    u_int8_t roc[4], tag[HMAC_SHA1_SIZE];
+    put4Bytes(roc, (u_int32_t)(index>>16));
+    success = computeAuthenticationTag(False, buffer, packetSize, roc, tag)
+      && CRYPTO_memcmp(tag, &buffer[packetSize], srtpTrailerSize()) == 0;
+    if (success && fEncryptSRTP) {
+      EVP_CIPHER_CTX* ctx = (EVP_CIPHER_CTX*)fSRTPDecryptCtx;
+      int len;
+      success = EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, iv) == 1
+	&& EVP_DecryptUpdate(ctx, &buffer[hdrSize], &len, &buffer[hdrSize], packetSize - hdrSize) == 1;
+    }
+  }
+  if (!success) {
+    ++fNumAuthenticationFailures;
+    return False;
+  }
+
+  // The packet is authentic, so (only now) update the SSRC's state:
+  if (state == NULL) state = lookupSSRCState(fIncomingSSRCs, ssrc, True);
+  if (!state->haveReceivedSRTP) {
+    state->highestSRTPIndex = index;
+    state->srtpReplayWindow = 1;
+    state->haveReceivedSRTP = True;
+  } else {
+    noteReceivedIndex(index, state->highestSRTPIndex, state->srtpReplayWindow);
+  }
+  outPacketSize = packetSize;
+  return True;
+#else
+  return False;
+#endif
+}
+
+Boolean SRTPCryptographicContext
+::processOutgoingSRTCPPacket(u_int8_t* buffer, unsigned inPacketSize, unsigned& outPacketSize) {
+#ifndef NO_OPENSSL
+  if (inPacketSize < 8) return False;
+  u_int32_t ssrc = get4Bytes(&buffer[4]);
+  SSRCState* state = lookupSSRCState(fOutgoingSSRCs, ssrc, True);
+  u_int32_t index = state->nextSRTCPIndex;
+  state->nextSRTCPIndex = (index + 1)&0x7FFFFFFF;
+
+  // The 'E' flag, and the SRTCP index:
+  u_int8_t eIndex[SRTCP_INDEX_SIZE];
+  put4Bytes(eIndex, (fEncryptSRTCP ? 0x80000000 : 0)|index);
+
+  u_int8_t iv[16];
+  computeIV(True, ssrc, index, iv);
+  if (fProfile == MIKEYState::AEAD_AES_128_GCM) {
+    // The packet becomes: <header> <ciphertext> <tag> <E+index> (RFC 7714, section 9.1):
+    unsigned aadSize = fEncryptSRTCP ? 8 : inPacketSize;
+    if (!aesGCM(True, True, iv, buffer, aadSize, eIndex, SRTCP_INDEX_SIZE, &buffer[aadSize], inPacketSize - aadSize,
+		&buffer[inPacketSize])) return False;
+    memcpy(&buffer[inPacketSize + AES_GCM_TAG_SIZE], eIndex, SRTCP_INDEX_SIZE);
+    outPacketSize = inPacketSize + AES_GCM_TAG_SIZE + SRTCP_INDEX_SIZE;
+  } else {
+    // The packet becomes: <header> <ciphertext> <E+index> <tag> (RFC 3711, section 3.4):
+    if (fEncryptSRTCP) {
+      EVP_CIPHER_CTX* ctx = (EVP_CIPHER_CTX*)fSRTCPEncryptCtx;
+      int len;
+      if (EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, iv) != 1
+	  || EVP_EncryptUpdate(ctx, &buffer[8], &len, &buffer[8], inPacketSize - 8) != 1) {
+	return False;
+      }
+    }
+    memcpy(&buffer[inPacketSize], eIndex, SRTCP_INDEX_SIZE);
+    u_int8_t tag[HMAC_SHA1_SIZE];
+    if (!computeAuthenticationTag(True, buffer, inPacketSize + SRTCP_INDEX_SIZE, NULL, tag)) return False;
+    memcpy(&buffer[inPacketSize + SRTCP_INDEX_SIZE], tag, srtpTrailerSize());
+    outPacketSize = inPacketSize + SRTCP_INDEX_SIZE + srtpTrailerSize();
+  }
+  return True;
+#else
+  return False;
+#endif
+}
+
+Boolean SRTPCryptographicContext
+::processIncomingSRTCPPacket(u_int8_t* buffer, unsigned inPacketSize, unsigned& outPacketSize) {
+#ifndef NO_OPENSSL
+  unsigned const trailerSize = SRTCP_INDEX_SIZE + srtpTrailerSize();
+  if (inPacketSize < 8 + trailerSize) return False;
+  unsigned const packetSize = inPacketSize - trailerSize; // without the trailer
+  Boolean const isGCM = fProfile == MIKEYState::AEAD_AES_128_GCM;
+  u_int8_t* eIndex = isGCM ? &buffer[inPacketSize - SRTCP_INDEX_SIZE] : &buffer[packetSize];
+  u_int8_t* tag = isGCM ? &buffer[packetSize] : &buffer[packetSize + SRTCP_INDEX_SIZE];
+  Boolean isEncrypted = (eIndex[0]&0x80) != 0;
+  u_int32_t index = get4Bytes(eIndex)&0x7FFFFFFF;
+  u_int32_t ssrc = get4Bytes(&buffer[4]);
+
+  SSRCState* state = lookupSSRCState(fIncomingSSRCs, ssrc, False);
+  if (state != NULL && state->haveReceivedSRTCP) {
+    u_int64_t highestIndex = state->highestSRTCPIndex;
+    if (isReplay(index, highestIndex, state->srtcpReplayWindow)) {
+      ++fNumReplayedPackets;
+      return False;
+    }
+  }
+
+  // Authenticate, then decrypt:
+  u_int8_t iv[16];
+  computeIV(True, ssrc, index, iv);
+  Boolean success;
+  if (isGCM) {
+    unsigned aadSize = isEncrypted ? 8 : packetSize;
+    success = aesGCM(True, False, iv, buffer, aadSize, eIndex, SRTCP_INDEX_SIZE, &buffer[aadSize], packetSize - aadSize,
+		     tag);
+  } else {
+    u_int8_t computedTag[HMAC_SHA1_SIZE];
+    success = computeAuthenticationTag(True, buffer, packetSize + SRTCP_INDEX_SIZE, NULL, computedTag)
+      && CRYPTO_memcmp(computedTag, tag, srtpTrailerSize()) == 0;
+    if (success && isEncrypted) {
+      EVP_CIPHER_CTX* ctx = (EVP_CIPHER_CTX*)fSRTCPDecryptCtx;
+      int len;
+      success = EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, iv) == 1
+	&& EVP_DecryptUpdate(ctx, &buffer[8], &len, &buffer[8], packetSize - 8) == 1;
+    }
+  }
+  if (!success) {
+    ++fNumAuthenticationFailures;
+    return False;
+  }
+
+  if (state == NULL) state = lookupSSRCState(fIncomingSSRCs, ssrc, True);
+  u_int64_t highestIndex = state->highestSRTCPIndex;
+  if (!state->haveReceivedSRTCP) {
+    highestIndex = index;
+    state->srtcpReplayWindow = 1;
+    state->haveReceivedSRTCP = True;
+  } else {
+    noteReceivedIndex(index, highestIndex, state->srtcpReplayWindow);
+  }
+  state->highestSRTCPIndex = (u_int32_t)highestIndex;
+  outPacketSize = packetSize;
+  return True;
+#else
+  return False;
+#endif
+}
@@ -208,20 +208,27 @@ Boolean ServerMediaSession::isServerMediaSession() const {
   return True;
 }
 
-char* ServerMediaSession::generateSDPDescription() {
-  AddressString ipAddressStr(ourIPAddress(envir()));
+char* ServerMediaSession::generateSDPDescription(int addressFamily) {
+  struct sockaddr_storage ourAddress;
+  if (addressFamily == AF_INET6) {
+    ourAddress = ourIPv6Address(envir());
+  } else {
+    setIPv4Address(ourAddress, ourIPAddress(envir()));
+  }
+  char const* ipVersionStr = addressFamily == AF_INET6 ? "IP6" : "IP4";
+  AddressString ipAddressStr(ourAddress);
   unsigned ipAddressStrSize = strlen(ipAddressStr.val());
 
   // For a SSM sessions, we need a "a=source-filter: incl ..." line also:
   char* sourceFilterLine;
   if (fIsSSM) {
     char const* const sourceFilterFmt =
-      "a=source-filter: incl IN IP4 * %s\r\n"
+      "a=source-filter: incl IN %s * %s\r\n"
       "a=rtcp-unicast: reflection\r\n";
-    unsigned const sourceFilterFmtSize = strlen(sourceFilterFmt) + ipAddressStrSize + 1;
+    unsigned const sourceFilterFmtSize = strlen(sourceFilterFmt) + 3 + ipAddressStrSize + 1;
 
     sourceFilterLine = new char[sourceFilterFmtSize];
-    sprintf(sourceFilterLine, sourceFilterFmt, ipAddressStr.val());
+    sprintf(sourceFilterLine, sourceFilterFmt, ipVersionStr, ipAddressStr.val());
   } else {
     sourceFilterLine = strDup("");
   }
@@ -237,7 +244,7 @@ char* ServerMediaSession::generateSDPDescription() {
     ServerMediaSubsession* subsession;
     for (subsession = fSubsessionsHead; subsession != NULL;
 	 subsession = subsession->fNext) {
-      char const* sdpLines = subsession->sdpLines();
+      char const* sdpLines = subsession->sdpLines(addressFamily);
       if (sdpLines == NULL) continue; // the media's not available
       sdpLength += strlen(sdpLines);
     }
@@ -257,7 +264,7 @@ char* ServerMediaSession::generateSDPDescription() {
 
     char const* const sdpPrefixFmt =
       "v=0\r\n"
-      "o=- %ld%06ld %d IN IP4 %s\r\n"
+      "o=- %ld%06ld %d IN %s %s\r\n"
       "s=%s\r\n"
       "i=%s\r\n"
       "t=0 0\r\n"
@@ -270,7 +277,7 @@ char* ServerMediaSession::generateSDPDescription() {
       "a=x-qt-text-inf:%s\r\n"
       "%s";
     sdpLength += strlen(sdpPrefixFmt)
-      + 20 + 6 + 20 + ipAddressStrSize
+      + 20 + 6 + 20 + 3 + ipAddressStrSize
       + strlen(fDescriptionSDPString)
       + strlen(fInfoSDPString)
       + strlen(libNameStr) + strlen(libVersionStr)
@@ -287,6 +294,7 @@ char* ServerMediaSession::generateSDPDescription() {
     snprintf(sdp, sdpLength, sdpPrefixFmt,
 	     fCreationTime.tv_sec, fCreationTime.tv_usec, // o= <session id>
 	     1, // o= <version> // (needs to change if params are modified)
+	     ipVersionStr, // o= <address type>
 	     ipAddressStr.val(), // o= <address>
 	     fDescriptionSDPString, // s= <description>
 	     fInfoSDPString, // i= <info>
@@ -306,7 +314,7 @@ char* ServerMediaSession::generateSDPDescription() {
       sdpLength -= mediaSDPLength;
       if (sdpLength <= 1) break; // the SDP has somehow become too long
 
-      char const* sdpLines = subsession->sdpLines();
+      char const* sdpLines = subsession->sdpLines(addressFamily);
       if (sdpLines != NULL) snprintf(mediaSDP, sdpLength, "%s", sdpLines);
     }
   } while (0);
@@ -396,6 +404,15 @@ FramedSource* ServerMediaSubsession::getStreamSource(void* /*streamToken*/) {
   // default implementation: return NULL
   return NULL;
 }
+Boolean ServerMediaSubsession::usesSRTP() const {
+  // default implementation: no SRTP
+  return False;
+}
+u_int8_t* ServerMediaSubsession::getMIKEYMessage(void* /*streamToken*/, unsigned& messageSize) {
+  // default implementation: no SRTP
+  messageSize = 0;
+  return NULL;
+}
 void ServerMediaSubsession::deleteStream(unsigned /*clientSessionId*/,
 					 void*& /*streamToken*/) {
   // default implementation: do nothing
@@ -0,0 +1,127 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A process-wide pool of server (RTP,RTCP) port number pairs
+// Implementation
+
+#include "ServerPortAllocator.hh"
+#include <mutex>
+
+////////// The pool's state //////////
+
+// The pool is created (for the default range, unless "setPortRange()" was called first) when it's first used.  "portPoolFreePairs" is a circular FIFO queue of
+// the indices (within the range) of the free pairs; "portPoolIsAllocated" records - for each pair - whether it's allocated, so
+// that releasing a pair that's not allocated (e.g., twice) has no effect.
+
+static std::mutex portPoolMutex;
+static Boolean portPoolRangeIsSet = False;
+static portNumBits portPoolFirstPortNum = 0;
+static portNumBits portPoolLastPortNum = 0;
+static unsigned portPoolNumPairs = 0;
+static u_int16_t* portPoolFreePairs = NULL;
+static Boolean* portPoolIsAllocated = NULL;
+static unsigned portPoolHead = 0, portPoolNumFree = 0;
+
+// The following functions are called with "portPoolMutex" held:
+
+static void createPortPool(portNumBits firstPortNum, portNumBits lastPortNum) {
+  delete[] portPoolFreePairs; delete[] portPoolIsAllocated;
+
+  unsigned first = (firstPortNum + 1) & ~1; // make sure that RTP port numbers are even
+  if (first == 0) first = 2; // (port 0 can't be used)
+  portPoolNumPairs = lastPortNum > first ? (lastPortNum - first + 1)/2 : 0;
+  portPoolFirstPortNum = (portNumBits)first;
+  portPoolLastPortNum = lastPortNum;
+
+  portPoolFreePairs = new u_int16_t[portPoolNumPairs + 1];
+  portPoolIsAllocated = new Boolean[portPoolNumPairs + 1];
+  for (unsigned i = 0; i < portPoolNumPairs; ++i) {
+    portPoolFreePairs[i] = (u_int16_t)i;
+    portPoolIsAllocated[i] = False;
+  }
+  portPoolHead = 0;
+  portPoolNumFree = portPoolNumPairs;
+  portPoolRangeIsSet = True;
+}
+
+static void createPortPoolIfNeeded() {
+  if (!portPoolRangeIsSet) {
+    createPortPool(SERVER_PORT_ALLOCATOR_DEFAULT_FIRST_PORT_NUM, SERVER_PORT_ALLOCATOR_DEFAULT_LAST_PORT_NUM);
+  }
+}
+
+////////// ServerPortAllocator implementation //////////
+
+Boolean ServerPortAllocator::setPortRange(portNumBits firstPortNum, portNumBits lastPortNum) {
+  std::lock_guard<std::mutex> lock(portPoolMutex);
+
+  if (portPoolNumFree < portPoolNumPairs) return False; // some pairs are still allocated
+  createPortPool(firstPortNum, lastPortNum);
+  return True;
+}
+
+void ServerPortAllocator::getPortRange(portNumBits& firstPortNum, portNumBits& lastPortNum) {
+  std::lock_guard<std::mutex> lock(portPoolMutex);
+
+  createPortPoolIfNeeded();
+  firstPortNum = portPoolFirstPortNum;
+  lastPortNum = portPoolLastPortNum;
+}
+
+Boolean ServerPortAllocator::isInPortRange(portNumBits portNum) {
+  portNumBits firstPortNum, lastPortNum;
+  getPortRange(firstPortNum, lastPortNum);
+
+  return portNum >= firstPortNum && portNum <= lastPortNum;
+}
+
+Boolean ServerPortAllocator::allocatePortPair(portNumBits& rtpPortNum) {
+  std::lock_guard<std::mutex> lock(portPoolMutex);
+
+  createPortPoolIfNeeded();
+  if (portPoolNumFree == 0) return False;
+
+  unsigned index = portPoolFreePairs[portPoolHead];
+  portPoolHead = (portPoolHead + 1)%portPoolNumPairs;
+  --portPoolNumFree;
+
+  portPoolIsAllocated[index] = True;
+  rtpPortNum = (portNumBits)(portPoolFirstPortNum + 2*index);
+  return True;
+}
+
+void ServerPortAllocator::releasePortPair(portNumBits rtpPortNum) {
+  std::lock_guard<std::mutex> lock(portPoolMutex);
+
+  if (rtpPortNum < portPoolFirstPortNum || ((rtpPortNum - portPoolFirstPortNum)&1) != 0) return; // not one of ours
+  unsigned index = (rtpPortNum - portPoolFirstPortNum)/2;
+  if (index >= portPoolNumPairs || !portPoolIsAllocated[index]) return;
+
+  portPoolIsAllocated[index] = False;
+  portPoolFreePairs[(portPoolHead + portPoolNumFree)%portPoolNumPairs] = (u_int16_t)index; // at the tail
+  ++portPoolNumFree;
+}
+
+unsigned ServerPortAllocator::numFreePortPairs() {
+  std::lock_guard<std::mutex> lock(portPoolMutex);
+  return portPoolNumFree;
+}
+
+unsigned ServerPortAllocator::numAllocatedPortPairs() {
+  std::lock_guard<std::mutex> lock(portPoolMutex);
+  return portPoolNumPairs - portPoolNumFree;
+}
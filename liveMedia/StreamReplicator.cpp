@@ -31,6 +31,7 @@ protected:
 private: // redefined virtual functions:
   virtual void doGetNextFrame();
   virtual void doStopGettingFrames();
+  virtual void setTargetBitrate(unsigned targetBitrate);
 
 private:
   static void copyReceivedFrame(StreamReplica* toReplica, StreamReplica* fromReplica);
@@ -41,6 +42,10 @@ private:
 
   // Replicas that are currently awaiting data are kept in a (singly-linked) list:
   StreamReplica* fNext;
+
+  // All replicas are also kept in a (singly-linked) list, so that we can combine their target bitrates:
+  StreamReplica* fNextReplica;
+  unsigned fTargetBitrate; // kbps; 0 if none has been set
 };
 
 
@@ -54,7 +59,8 @@ StreamReplicator::StreamReplicator(UsageEnvironment& env, FramedSource* inputSou
   : Medium(env),
     fInputSource(inputSource), fDeleteWhenLastReplicaDies(deleteWhenLastReplicaDies), fInputSourceHasClosed(False),
     fNumReplicas(0), fNumActiveReplicas(0), fNumDeliveriesMadeSoFar(0),
-    fFrameIndex(0), fMasterReplica(NULL), fReplicasAwaitingCurrentFrame(NULL), fReplicasAwaitingNextFrame(NULL) {
+    fFrameIndex(0), fMasterReplica(NULL), fReplicasAwaitingCurrentFrame(NULL), fReplicasAwaitingNextFrame(NULL),
+    fAllReplicas(NULL), fTargetBitrate(0) {
 }
 
 StreamReplicator::~StreamReplicator() {
@@ -63,7 +69,10 @@ StreamReplicator::~StreamReplicator() {
 
 FramedSource* StreamReplicator::createStreamReplica() {
   ++fNumReplicas;
-  return new StreamReplica(*this);
+  StreamReplica* replica = new StreamReplica(*this);
+  replica->fNextReplica = fAllReplicas;
+  fAllReplicas = replica;
+  return replica;
 }
 
 void StreamReplicator::getNextFrame(StreamReplica* replica) {
@@ -198,6 +207,14 @@ void StreamReplicator::removeStreamReplica(StreamReplica* replicaBeingRemoved) {
   if (fNumReplicas == 0) fprintf(stderr, "StreamReplicator::removeStreamReplica() Internal Error!\n"); // should not happen
   --fNumReplicas;
 
+  for (StreamReplica** r = &fAllReplicas; *r != NULL; r = &(*r)->fNextReplica) {
+    if (*r == replicaBeingRemoved) {
+      *r = replicaBeingRemoved->fNextReplica;
+      break;
+    }
+  }
+  if (replicaBeingRemoved->fTargetBitrate > 0) noteTargetBitrates();
+
   // If this was the last replica, then delete ourselves (if we were set up to do so):
   if (fNumReplicas == 0 && fDeleteWhenLastReplicaDies) {
     Medium::close(this);
@@ -205,6 +222,20 @@ void StreamReplicator::removeStreamReplica(StreamReplica* replicaBeingRemoved) {
   }
 }
 
+void StreamReplicator::noteTargetBitrates() {
+  // Ask our input source for the highest bitrate that any replica wants.  (Replicas whose receivers can't handle this
+  // much must reduce it themselves - e.g., by dropping layers.)
+  unsigned maxTargetBitrate = 0;
+  for (StreamReplica* replica = fAllReplicas; replica != NULL; replica = replica->fNextReplica) {
+    if (replica->fTargetBitrate > maxTargetBitrate) maxTargetBitrate = replica->fTargetBitrate;
+  }
+
+  if (maxTargetBitrate != fTargetBitrate && maxTargetBitrate > 0) {
+    fTargetBitrate = maxTargetBitrate;
+    if (fInputSource != NULL) fInputSource->setTargetBitrate(fTargetBitrate);
+  }
+}
+
 void StreamReplicator::afterGettingFrame(void* clientData, unsigned frameSize, unsigned numTruncatedBytes,
 					 struct timeval presentationTime, unsigned durationInMicroseconds) {
   ((StreamReplicator*)clientData)->afterGettingFrame(frameSize, numTruncatedBytes, presentationTime, durationInMicroseconds);
@@ -305,7 +336,7 @@ void StreamReplicator::deliverReceivedFrame() {
 StreamReplica::StreamReplica(StreamReplicator& ourReplicator)
   : FramedSource(ourReplicator.envir()),
     fOurReplicator(ourReplicator),
-    fFrameIndex(-1/*we haven't started playing yet*/), fNext(NULL) {
+    fFrameIndex(-1/*we haven't started playing yet*/), fNext(NULL), fNextReplica(NULL), fTargetBitrate(0) {
 }
 
 StreamReplica::~StreamReplica() {
@@ -320,6 +351,11 @@ void StreamReplica::doStopGettingFrames() {
   fOurReplicator.deactivateStreamReplica(this);
 }
 
+void StreamReplica::setTargetBitrate(unsigned targetBitrate) {
+  fTargetBitrate = targetBitrate;
+  fOurReplicator.noteTargetBitrates();
+}
+
 void StreamReplica::copyReceivedFrame(StreamReplica* toReplica, StreamReplica* fromReplica) {
   // First, figure out how much data to copy.  ("toReplica" might have a smaller buffer than "fromReplica".)
   unsigned numNewBytesToTruncate
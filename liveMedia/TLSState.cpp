@@ -0,0 +1,474 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// The TLS state of a TCP connection, used to implement RTSP-over-TLS ("rtsps://")
+// Implementation
+
+#include "TLSState.hh"
+#include "Media.hh"
+#include <GroupsockHelper.hh>
+#include <string.h>
+#include <stdio.h>
+#ifndef NO_OPENSSL
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/x509v3.h>
+#endif
+
+#ifndef NO_OPENSSL
+static void setResultMsgFromOpenSSL(UsageEnvironment& env, char const* msg, char const* arg = "") {
+  char errorStr[200];
+  ERR_error_string_n(ERR_get_error(), errorStr, sizeof errorStr);
+  env.setResultMsg(msg, arg, ": ");
+  env.appendToResultMsg(errorStr);
+}
+
+static void setCommonContextOptions(SSL_CTX* ctx) {
+  SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+  // Let a write that would block return after each complete record, and be retried (with the same data) from a
+  // different address - e.g., after its data has been moved within an output queue:
+  SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE|SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#ifdef SSL_OP_NO_RENEGOTIATION
+  SSL_CTX_set_options(ctx, SSL_OP_NO_RENEGOTIATION);
+#endif
+}
+#endif
+
+////////// TLSTables //////////
+
+// The per-environment TLS state: The "TLSState" of each socket that's using TLS, and (for clients) the OpenSSL context,
+// and the sessions that we've saved for resumption (indexed by "<server-name>:<port>", with a suffix if the server
+// wasn't verified).
+// These are kept in the environment's "_Tables", so that each environment (and thread) has its own.
+
+class TLSTables {
+public:
+  static TLSTables* getOurTables(UsageEnvironment& env, Boolean createIfNotPresent = True);
+  void reclaimIfPossible(); // deletes us if we have no sockets and no saved sessions
+
+  void* clientSSLCtx(); // creates the client context, if necessary
+  void forgetClientSessions();
+
+#ifndef NO_OPENSSL
+  static int newClientSessionCallback(SSL* ssl, SSL_SESSION* session);
+#endif
+
+public:
+  HashTable* socketTable;
+  HashTable* clientSessions;
+
+private:
+  TLSTables(UsageEnvironment& env);
+  virtual ~TLSTables();
+
+private:
+  UsageEnvironment& fEnv;
+  void* fClientSSLCtx;
+};
+
+TLSTables* TLSTables::getOurTables(UsageEnvironment& env, Boolean createIfNotPresent) {
+  _Tables* ourTables = _Tables::getOurTables(env, createIfNotPresent);
+  if (ourTables == NULL) return NULL;
+
+  if (ourTables->tlsTable == NULL && createIfNotPresent) {
+    ourTables->tlsTable = new TLSTables(env);
+  }
+  return (TLSTables*)(ourTables->tlsTable);
+}
+
+void TLSTables::reclaimIfPossible() {
+  if (!socketTable->IsEmpty() || !clientSessions->IsEmpty()) return;
+
+  _Tables* ourTables = _Tables::getOurTables(fEnv, False);
+  delete this;
+  if (ourTables != NULL) {
+    ourTables->tlsTable = NULL;
+    ourTables->reclaimIfPossible();
+  }
+}
+
+void* TLSTables::clientSSLCtx() {
+#ifndef NO_OPENSSL
+  if (fClientSSLCtx == NULL) {
+    SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+    if (ctx == NULL) {
+      setResultMsgFromOpenSSL(fEnv, "Failed to create a TLS client context");
+      return NULL;
+    }
+    setCommonContextOptions(ctx);
+    // Trust the system's default CA certificates.  (Each connection sets its own verification mode.):
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, NULL);
+    if (SSL_CTX_set_default_verify_paths(ctx) != 1) ERR_clear_error(); // (then, no server can be verified)
+
+    // Save each new session (or session ticket) that a server gives us, so that we can resume it next time:
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT|SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx, newClientSessionCallback);
+    fClientSSLCtx = ctx;
+  }
+#endif
+  return fClientSSLCtx;
+}
+
+void TLSTables::forgetClientSessions() {
+  void* session;
+  while ((session = clientSessions->RemoveNext()) != NULL) {
+#ifndef NO_OPENSSL
+    SSL_SESSION_free((SSL_SESSION*)session);
+#endif
+  }
+}
+
+#ifndef NO_OPENSSL
+int TLSTables::newClientSessionCallback(SSL* ssl, SSL_SESSION* session) {
+  TLSState* tlsState = (TLSState*)SSL_get_app_data(ssl);
+  if (tlsState == NULL || tlsState->fSessionCacheKey == NULL || !SSL_SESSION_is_resumable(session)) return 0;
+
+  TLSTables* ourTables = getOurTables(tlsState->fEnv);
+  SSL_SESSION* oldSession = (SSL_SESSION*)(ourTables->clientSessions->Add(tlsState->fSessionCacheKey, session));
+  if (oldSession != NULL) SSL_SESSION_free(oldSession);
+
+  return 1; // we've kept the reference to "session"
+}
+#endif
+
+TLSTables::TLSTables(UsageEnvironment& env)
+  : socketTable(HashTable::create(ONE_WORD_HASH_KEYS)), clientSessions(HashTable::create(STRING_HASH_KEYS)),
+    fEnv(env), fClientSSLCtx(NULL) {
+}
+
+TLSTables::~TLSTables() {
+  forgetClientSessions();
+  delete clientSessions;
+  delete socketTable;
+#ifndef NO_OPENSSL
+  SSL_CTX_free((SSL_CTX*)fClientSSLCtx);
+#endif
+}
+
+////////// TLSServerContext implementation //////////
+
+TLSServerContext* TLSServerContext
+::createNew(UsageEnvironment& env, char const* certFileName, char const* privateKeyFileName) {
+#ifndef NO_OPENSSL
+  SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+  if (ctx == NULL) {
+    setResultMsgFromOpenSSL(env, "Failed to create a TLS server context");
+    return NULL;
+  }
+
+  do {
+    setCommonContextOptions(ctx);
+    SSL_CTX_set_options(ctx, SSL_OP_CIPHER_SERVER_PREFERENCE);
+
+    if (SSL_CTX_use_certificate_chain_file(ctx, certFileName) != 1) {
+      setResultMsgFromOpenSSL(env, "Failed to read the TLS certificate file ", certFileName);
+      break;
+    }
+    if (SSL_CTX_use_PrivateKey_file(ctx, privateKeyFileName, SSL_FILETYPE_PEM) != 1) {
+      setResultMsgFromOpenSSL(env, "Failed to read the TLS private key file ", privateKeyFileName);
+      break;
+    }
+    if (SSL_CTX_check_private_key(ctx) != 1) {
+      setResultMsgFromOpenSSL(env, "The TLS private key doesn't match the certificate in ", certFileName);
+      break;
+    }
+
+    // Let clients resume their sessions - skipping the expensive part of the handshake - using session tickets.  (These
+    // are encrypted with a key that's private to this context, so we don't need to store each client's session.)
+    // Sessions can also be resumed by id, for TLS 1.2 clients that don't support tickets:
+    SSL_CTX_set_session_id_context(ctx, (unsigned char const*)"liveMedia", 9);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+#ifdef TLS1_3_VERSION
+    SSL_CTX_set_num_tickets(ctx, 1); // (a client needs only one ticket, to resume its next connection)
+#endif
+
+    return new TLSServerContext(ctx);
+  } while (0);
+
+  SSL_CTX_free(ctx);
+#else
+  env.setResultMsg("TLS is not supported (this code was compiled with \"NO_OPENSSL\")");
+#endif
+  return NULL;
+}
+
+TLSServerContext::TLSServerContext(void* sslCtx)
+  : fSSLCtx(sslCtx) {
+}
+
+TLSServerContext::~TLSServerContext() {
+#ifndef NO_OPENSSL
+  SSL_CTX_free((SSL_CTX*)fSSLCtx);
+#endif
+}
+
+////////// TLSState implementation //////////
+
+Boolean TLSState::isSupported() {
+#ifndef NO_OPENSSL
+  return True;
+#else
+  return False;
+#endif
+}
+
+TLSState* TLSState::createNewForServer(UsageEnvironment& env, int socketNum, TLSServerContext& context) {
+#ifndef NO_OPENSSL
+  SSL* ssl = SSL_new((SSL_CTX*)context.fSSLCtx);
+  if (ssl == NULL || SSL_set_fd(ssl, socketNum) != 1) {
+    setResultMsgFromOpenSSL(env, "Failed to set up TLS on a connection");
+    SSL_free(ssl);
+    return NULL;
+  }
+  SSL_set_accept_state(ssl);
+
+  return new TLSState(env, socketNum, ssl, True);
+#else
+  env.setResultMsg("TLS is not supported (this code was compiled with \"NO_OPENSSL\")");
+  return NULL;
+#endif
+}
+
+TLSState* TLSState::createNewForClient(UsageEnvironment& env, int socketNum,
+				       char const* serverName, portNumBits serverPortNum, Boolean verifyServer) {
+#ifndef NO_OPENSSL
+  TLSTables* ourTables = TLSTables::getOurTables(env);
+  SSL_CTX* ctx = (SSL_CTX*)(ourTables->clientSSLCtx());
+  SSL* ssl = ctx == NULL ? NULL : SSL_new(ctx);
+  if (ssl == NULL || SSL_set_fd(ssl, socketNum) != 1) {
+    if (ctx != NULL) setResultMsgFromOpenSSL(env, "Failed to set up TLS on a connection");
+    SSL_free(ssl);
+    ourTables->reclaimIfPossible();
+    return NULL;
+  }
+  SSL_set_connect_state(ssl);
+
+  // Check that the server's certificate is for "serverName" (which may be an IP address string):
+  Boolean const serverNameIsAddress = X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(ssl), serverName) == 1;
+  if (!serverNameIsAddress) {
+    ERR_clear_error();
+    SSL_set_tlsext_host_name(ssl, serverName); // SNI (which is sent only for a host name)
+    SSL_set1_host(ssl, serverName);
+  }
+  SSL_set_verify(ssl, verifyServer ? SSL_VERIFY_PEER : SSL_VERIFY_NONE, NULL);
+
+  TLSState* tlsState = new TLSState(env, socketNum, ssl, False);
+
+  // If we've connected to this server before, then try to resume that session.  (A session with an unverified server
+  // is kept separately, so that it's never resumed by a connection that requires verification.)
+  char const* const keySuffix = verifyServer ? "" : " (unverified)";
+  tlsState->fSessionCacheKey = new char[strlen(serverName) + 7 + strlen(keySuffix)];
+  sprintf(tlsState->fSessionCacheKey, "%s:%u%s", serverName, serverPortNum, keySuffix);
+
+  SSL_SESSION* savedSession = (SSL_SESSION*)(ourTables->clientSessions->Lookup(tlsState->fSessionCacheKey));
+  if (savedSession != NULL) SSL_set_session(ssl, savedSession);
+
+  return tlsState;
+#else
+  env.setResultMsg("TLS is not supported (this code was compiled with \"NO_OPENSSL\")");
+  return NULL;
+#endif
+}
+
+TLSState::TLSState(UsageEnvironment& env, int socketNum, void* ssl, Boolean isServer)
+  : fEnv(env), fSocketNum(socketNum), fSSL(ssl), fIsServer(isServer), fSessionCacheKey(NULL),
+    fHandshakeCompletionFunc(NULL), fHandshakeCompletionClientData(NULL),
+    fPendingReadTask(NULL), fPendingReadHandlerProc(NULL), fPendingReadClientData(NULL) {
+#ifndef NO_OPENSSL
+  SSL_set_app_data((SSL*)fSSL, this);
+#endif
+  TLSTables::getOurTables(fEnv)->socketTable->Add((char const*)(long)fSocketNum, this);
+}
+
+TLSState::~TLSState() {
+  if (fHandshakeCompletionFunc != NULL) {
+    // Our handshake was still in progress, so we're still handling our socket:
+    fEnv.taskScheduler().disableBackgroundHandling(fSocketNum);
+  }
+  fEnv.taskScheduler().unscheduleDelayedTask(fPendingReadTask);
+
+#ifndef NO_OPENSSL
+  SSL* ssl = (SSL*)fSSL;
+  if (SSL_is_init_finished(ssl)) {
+    ERR_clear_error();
+    (void)SSL_shutdown(ssl); // tries to send a "close_notify" alert (but doesn't wait for a reply)
+  }
+  SSL_set_app_data(ssl, NULL);
+  SSL_free(ssl);
+#endif
+  delete[] fSessionCacheKey;
+
+  TLSTables* ourTables = TLSTables::getOurTables(fEnv, False);
+  if (ourTables != NULL) {
+    if (ourTables->socketTable->Lookup((char const*)(long)fSocketNum) == this) {
+      ourTables->socketTable->Remove((char const*)(long)fSocketNum);
+    }
+    ourTables->reclaimIfPossible();
+  }
+}
+
+TLSState* TLSState::lookup(UsageEnvironment& env, int socketNum) {
+  TLSTables* ourTables = TLSTables::getOurTables(env, False);
+  if (ourTables == NULL) return NULL; // common case: nothing is using TLS
+
+  return (TLSState*)(ourTables->socketTable->Lookup((char const*)(long)socketNum));
+}
+
+void TLSState::startHandshake(HandshakeCompletionFunc* completionFunc, void* clientData) {
+  fHandshakeCompletionFunc = completionFunc;
+  fHandshakeCompletionClientData = clientData;
+
+  // A server waits for the client's first handshake message; a client can send its first message as soon as our
+  // socket is writable:
+  fEnv.taskScheduler().setBackgroundHandling(fSocketNum, (fIsServer ? SOCKET_READABLE : SOCKET_WRITABLE)|SOCKET_EXCEPTION,
+					     handshakeHandler, this);
+}
+
+void TLSState::handshakeHandler(void* instance, int /*mask*/) {
+  TLSState* tlsState = (TLSState*)instance;
+  tlsState->continueHandshake();
+}
+
+void TLSState::continueHandshake() {
+#ifndef NO_OPENSSL
+  SSL* ssl = (SSL*)fSSL;
+  ERR_clear_error();
+  int result = SSL_do_handshake(ssl);
+  if (result == 1) {
+    completeHandshake(True);
+    return;
+  }
+
+  switch (SSL_get_error(ssl, result)) {
+    case SSL_ERROR_WANT_READ: {
+      fEnv.taskScheduler().setBackgroundHandling(fSocketNum, SOCKET_READABLE|SOCKET_EXCEPTION, handshakeHandler, this);
+      break;
+    }
+    case SSL_ERROR_WANT_WRITE: {
+      fEnv.taskScheduler().setBackgroundHandling(fSocketNum, SOCKET_WRITABLE|SOCKET_EXCEPTION, handshakeHandler, this);
+      break;
+    }
+    default: {
+      long verifyResult = fIsServer ? X509_V_OK : SSL_get_verify_result(ssl);
+      if (verifyResult != X509_V_OK) {
+	fEnv.setResultMsg("TLS handshake failed: The server's certificate was not accepted: ",
+			  X509_verify_cert_error_string(verifyResult));
+	ERR_clear_error();
+      } else {
+	setResultMsgFromOpenSSL(fEnv, "TLS handshake failed");
+      }
+      completeHandshake(False);
+      break;
+    }
+  }
+#else
+  completeHandshake(False);
+#endif
+}
+
+void TLSState::completeHandshake(Boolean success) {
+  fEnv.taskScheduler().disableBackgroundHandling(fSocketNum);
+
+  HandshakeCompletionFunc* completionFunc = fHandshakeCompletionFunc;
+  fHandshakeCompletionFunc = NULL;
+  if (completionFunc != NULL) (*completionFunc)(fHandshakeCompletionClientData, success); // this may delete us
+}
+
+int TLSState::read(u_int8_t* buffer, unsigned bufferSize) {
+#ifndef NO_OPENSSL
+  SSL* ssl = (SSL*)fSSL;
+
+  // Each "SSL_read()" returns (at most) one TLS record, so keep going until we've read all that's available:
+  unsigned totBytesRead = 0;
+  while (totBytesRead < bufferSize) {
+    ERR_clear_error();
+    int result = SSL_read(ssl, &buffer[totBytesRead], bufferSize - totBytesRead);
+    if (result > 0) {
+      totBytesRead += result;
+      continue;
+    }
+
+    int err = SSL_get_error(ssl, result);
+    if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) break; // nothing more is available now
+
+    // The connection was closed, or failed.  (We'll report this on the next call, if we've already read some data.)
+    if (totBytesRead == 0) return -1;
+    break;
+  }
+
+  return (int)totBytesRead;
+#else
+  return -1;
+#endif
+}
+
+int TLSState::write(u_int8_t const* data, unsigned dataSize) {
+#ifndef NO_OPENSSL
+  if (dataSize == 0) return 0;
+
+  SSL* ssl = (SSL*)fSSL;
+  ERR_clear_error();
+  int result = SSL_write(ssl, data, dataSize);
+  if (result > 0) return result;
+
+  int err = SSL_get_error(ssl, result);
+  if (err == SSL_ERROR_WANT_WRITE || err == SSL_ERROR_WANT_READ) return 0;
+#endif
+  return -1;
+}
+
+Boolean TLSState::hasBufferedData() const {
+#ifndef NO_OPENSSL
+  return SSL_pending((SSL const*)fSSL) > 0;
+#else
+  return False;
+#endif
+}
+
+void TLSState::continueReadingIfBuffered(TaskScheduler::BackgroundHandlerProc* handlerProc, void* clientData) {
+  if (!hasBufferedData()) return;
+
+  fPendingReadHandlerProc = handlerProc;
+  fPendingReadClientData = clientData;
+  if (fPendingReadTask == NULL) {
+    fPendingReadTask = fEnv.taskScheduler().scheduleDelayedTask(0, (TaskFunc*)pendingReadHandler, this);
+  }
+}
+
+void TLSState::pendingReadHandler(void* instance) {
+  TLSState* tlsState = (TLSState*)instance;
+  tlsState->fPendingReadTask = NULL;
+  if (tlsState->hasBufferedData()) {
+    (*tlsState->fPendingReadHandlerProc)(tlsState->fPendingReadClientData, SOCKET_READABLE);
+  }
+}
+
+Boolean TLSState::sessionWasResumed() const {
+#ifndef NO_OPENSSL
+  return SSL_session_reused((SSL*)fSSL) == 1;
+#else
+  return False;
+#endif
+}
+
+void TLSState::forgetClientSessions(UsageEnvironment& env) {
+  TLSTables* ourTables = TLSTables::getOurTables(env, False);
+  if (ourTables == NULL) return;
+
+  ourTables->forgetClientSessions();
+  ourTables->reclaimIfPossible();
+}
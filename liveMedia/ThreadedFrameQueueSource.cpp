@@ -0,0 +1,231 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A 'FramedSource' that delivers frames that are pushed into it - from one or more other threads (e.g., encoder
+// or capture threads) - through a bounded, lock-free queue.
+// Implementation
+
+#include "ThreadedFrameQueueSource.hh"
+#include <GroupsockHelper.hh> // for "gettimeofday()"
+
+////////// QueuedFrame //////////
+
+QueuedFrame* QueuedFrame::createNew(unsigned maxSize) {
+  return new QueuedFrame(maxSize);
+}
+
+QueuedFrame::QueuedFrame(unsigned maxSize)
+  : frameSize(0), durationInMicroseconds(0),
+    fReferenceCount(1), fData(new unsigned char[maxSize]), fMaxSize(maxSize) {
+  presentationTime.tv_sec = presentationTime.tv_usec = 0;
+  fTimeQueued.tv_sec = fTimeQueued.tv_usec = 0;
+}
+
+QueuedFrame::~QueuedFrame() {
+  delete[] fData;
+}
+
+void QueuedFrame::release() {
+  if (fReferenceCount.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+}
+
+
+////////// ThreadedFrameQueueSource //////////
+
+ThreadedFrameQueueSource*
+ThreadedFrameQueueSource::createNew(UsageEnvironment& env, unsigned queueSize,
+				    OverflowPolicy overflowPolicy) {
+  EventTriggerId eventTriggerId = env.taskScheduler().createEventTrigger(deliverFrame0);
+  if (eventTriggerId == 0) {
+    env.setResultMsg("Failed to create an event trigger for a \"ThreadedFrameQueueSource\"");
+    return NULL;
+  }
+
+  return new ThreadedFrameQueueSource(env, eventTriggerId, queueSize, overflowPolicy);
+}
+
+ThreadedFrameQueueSource
+::ThreadedFrameQueueSource(UsageEnvironment& env, EventTriggerId eventTriggerId,
+			   unsigned queueSize, OverflowPolicy overflowPolicy)
+  : FramedSource(env),
+    fEventTriggerId(eventTriggerId), fOverflowPolicy(overflowPolicy),
+    fEnqueuePosition(0), fDequeuePosition(0),
+    fHaveOverflowed(false), fWakeupIsPending(false),
+    fNumFramesQueued(0), fNumFramesDropped(0), fNumFramesDelivered(0),
+    fNumLatencyMeasurements(0), fTotalLatencyInMicroseconds(0), fMaxLatencyInMicroseconds(0) {
+  // Round "queueSize" up to a power of 2 (at least 2):
+  unsigned size = 2;
+  while (size < queueSize && size < 0x80000000) size <<= 1;
+  fQueueMask = size - 1;
+
+  fCells = new Cell[size];
+  for (unsigned i = 0; i < size; ++i) {
+    fCells[i].sequence.store(i, std::memory_order_relaxed);
+    fCells[i].frame = NULL;
+  }
+}
+
+ThreadedFrameQueueSource::~ThreadedFrameQueueSource() {
+  // Note: Our producer threads must have stopped pushing frames to us by now.
+  envir().taskScheduler().deleteEventTrigger(fEventTriggerId);
+
+  QueuedFrame* frame;
+  while ((frame = dequeue()) != NULL) frame->release();
+  delete[] fCells;
+}
+
+Boolean ThreadedFrameQueueSource::pushFrame(QueuedFrame* frame) {
+  if (frame == NULL) return False;
+
+  gettimeofday(&frame->fTimeQueued, NULL);
+  frame->addReference(); // for the queue
+  if (!enqueue(frame)) {
+    frame->release();
+    fNumFramesDropped.fetch_add(1, std::memory_order_relaxed);
+    fHaveOverflowed.store(true, std::memory_order_relaxed);
+    return False;
+  }
+  fNumFramesQueued.fetch_add(1, std::memory_order_relaxed);
+
+  // Wake up our event loop - unless a wakeup is already pending (in which case the new frame will
+  // be seen when that wakeup is handled):
+  if (!fWakeupIsPending.exchange(true)) {
+    envir().taskScheduler().triggerEvent(fEventTriggerId, this);
+  }
+  return True;
+}
+
+Boolean ThreadedFrameQueueSource
+::pushFrame(unsigned char const* data, unsigned frameSize,
+	    struct timeval presentationTime, unsigned durationInMicroseconds) {
+  QueuedFrame* frame = QueuedFrame::createNew(frameSize);
+  memmove(frame->data(), data, frameSize);
+  frame->frameSize = frameSize;
+  frame->presentationTime = presentationTime;
+  frame->durationInMicroseconds = durationInMicroseconds;
+
+  Boolean result = pushFrame(frame);
+  frame->release(); // the queue (if anyone) now owns it
+  return result;
+}
+
+unsigned ThreadedFrameQueueSource::averageLatencyInMicroseconds() const {
+  return fNumLatencyMeasurements == 0 ? 0 : (unsigned)(fTotalLatencyInMicroseconds/fNumLatencyMeasurements);
+}
+
+void ThreadedFrameQueueSource::resetLatencyStats() {
+  fNumLatencyMeasurements = 0;
+  fTotalLatencyInMicroseconds = 0;
+  fMaxLatencyInMicroseconds = 0;
+}
+
+void ThreadedFrameQueueSource::doGetNextFrame() {
+  // If a frame has already been queued, deliver it now.  Otherwise, our event trigger will be
+  // called (by a producer thread) when one becomes available:
+  deliverFrame();
+}
+
+// The queue is a bounded multi-producer, single-consumer queue, in which each cell's sequence number
+// tells us whether the cell is free (sequence == position) or holds a frame (sequence == position+1):
+
+Boolean ThreadedFrameQueueSource::enqueue(QueuedFrame* frame) {
+  unsigned position = fEnqueuePosition.load(std::memory_order_relaxed);
+  Cell* cell;
+  while (1) {
+    cell = &fCells[position&fQueueMask];
+    int diff = (int)(cell->sequence.load(std::memory_order_acquire) - position);
+    if (diff == 0) {
+      // The cell is free; try to claim it (but another producer might beat us to it):
+      if (fEnqueuePosition.compare_exchange_weak(position, position+1, std::memory_order_relaxed)) break;
+    } else if (diff < 0) {
+      return False; // the queue is full
+    } else {
+      position = fEnqueuePosition.load(std::memory_order_relaxed); // another producer claimed the cell
+    }
+  }
+
+  cell->frame = frame;
+  cell->sequence.store(position+1, std::memory_order_release);
+  return True;
+}
+
+QueuedFrame* ThreadedFrameQueueSource::dequeue() {
+  Cell* cell = &fCells[fDequeuePosition&fQueueMask];
+  if ((int)(cell->sequence.load(std::memory_order_acquire) - (fDequeuePosition+1)) < 0) return NULL; // empty
+
+  QueuedFrame* frame = cell->frame;
+  cell->frame = NULL;
+  cell->sequence.store(fDequeuePosition + fQueueMask + 1, std::memory_order_release);
+  ++fDequeuePosition;
+  return frame;
+}
+
+void ThreadedFrameQueueSource::deliverFrame0(void* clientData) {
+  ThreadedFrameQueueSource* source = (ThreadedFrameQueueSource*)clientData;
+  source->fWakeupIsPending.store(false);
+  source->deliverFrame();
+}
+
+void ThreadedFrameQueueSource::deliverFrame() {
+  if (!isCurrentlyAwaitingData()) return; // we're not ready for the data yet
+
+  QueuedFrame* frame = dequeue();
+  if (frame == NULL) return; // we'll get called again (via our event trigger) when a frame is queued
+
+  if (fOverflowPolicy == DROP_QUEUED_FRAMES && fHaveOverflowed.exchange(false, std::memory_order_relaxed)) {
+    // Catch up with our producer(s), by discarding all but the most recently queued frame:
+    QueuedFrame* nextFrame;
+    while ((nextFrame = dequeue()) != NULL) {
+      frame->release();
+      fNumFramesDropped.fetch_add(1, std::memory_order_relaxed);
+      frame = nextFrame;
+    }
+  }
+
+  // Deliver the frame's data:
+  if (frame->frameSize > fMaxSize) {
+    fFrameSize = fMaxSize;
+    fNumTruncatedBytes = frame->frameSize - fMaxSize;
+  } else {
+    fFrameSize = frame->frameSize;
+    fNumTruncatedBytes = 0;
+  }
+  memmove(fTo, frame->data(), fFrameSize);
+
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  if (frame->presentationTime.tv_sec == 0 && frame->presentationTime.tv_usec == 0) {
+    fPresentationTime = timeNow;
+  } else {
+    fPresentationTime = frame->presentationTime;
+  }
+  fDurationInMicroseconds = frame->durationInMicroseconds;
+
+  // Update our latency statistics:
+  int64_t latency = (timeNow.tv_sec - frame->fTimeQueued.tv_sec)*(int64_t)1000000
+    + (timeNow.tv_usec - frame->fTimeQueued.tv_usec);
+  if (latency < 0) latency = 0;
+  fTotalLatencyInMicroseconds += latency;
+  ++fNumLatencyMeasurements;
+  if ((unsigned)latency > fMaxLatencyInMicroseconds) fMaxLatencyInMicroseconds = (unsigned)latency;
+  ++fNumFramesDelivered;
+
+  frame->release();
+
+  // After delivering the data, inform the reader that it is now available:
+  FramedSource::afterGetting(this);
+}
@@ -0,0 +1,498 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// XOR-based forward error correction for RTP (RFC 5109 'ULP FEC'), with row/column protection
+// Implementation
+
+#include "ULPFEC.hh"
+#include "RTPInterface.hh" // for "SRTP_MAX_TRAILER_SIZE" and "RTP_TCP_FRAMING_HEADER_SIZE"
+#include "GroupsockHelper.hh"
+#include <string.h>
+
+// No standard configuration builds with "-mavx2", so (with GCC or Clang, on x86) we also compile an AVX2 version of
+// the XOR loop on its own, and use it only if the CPU that we're running on supports it:
+#if !defined(__AVX2__) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define ULPFEC_RUNTIME_AVX2 1
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(ULPFEC_RUNTIME_AVX2)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+////////// ulpfecXOR() //////////
+
+#if defined(__AVX2__) || defined(ULPFEC_RUNTIME_AVX2)
+// XORs 32 bytes at a time, then (for the remaining < 32 bytes) calls "ulpfecXOR()":
+#ifdef ULPFEC_RUNTIME_AVX2
+__attribute__((target("avx2")))
+#endif
+static void ulpfecXOR_AVX2(u_int8_t* to, u_int8_t const* from, unsigned numBytes) {
+  while (numBytes >= 32) {
+    __m256i a = _mm256_loadu_si256((__m256i const*)to);
+    __m256i b = _mm256_loadu_si256((__m256i const*)from);
+    _mm256_storeu_si256((__m256i*)to, _mm256_xor_si256(a, b));
+    to += 32; from += 32; numBytes -= 32;
+  }
+  if (numBytes > 0) ulpfecXOR(to, from, numBytes);
+}
+#endif
+
+#ifdef ULPFEC_RUNTIME_AVX2
+// (For shorter buffers - fewer than two AVX2 iterations - we just use the SSE2 loop below.)
+#define ULPFEC_AVX2_MIN_BYTES 64
+
+// (Checked once, at startup.  Until then - i.e., if "ulpfecXOR()" is called from another static initializer - it's
+// False, so we just don't use AVX2.)
+static Boolean const cpuSupportsAVX2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2") != 0);
+#endif
+
+void ulpfecXOR(u_int8_t* to, u_int8_t const* from, unsigned numBytes) {
+#if defined(__AVX2__)
+  if (numBytes >= 32) {
+    ulpfecXOR_AVX2(to, from, numBytes);
+    return;
+  }
+#elif defined(ULPFEC_RUNTIME_AVX2)
+  if (numBytes >= ULPFEC_AVX2_MIN_BYTES && cpuSupportsAVX2) {
+    ulpfecXOR_AVX2(to, from, numBytes);
+    return;
+  }
+#endif
+#if defined(__SSE2__)
+  while (numBytes >= 16) {
+    __m128i a = _mm_loadu_si128((__m128i const*)to);
+    __m128i b = _mm_loadu_si128((__m128i const*)from);
+    _mm_storeu_si128((__m128i*)to, _mm_xor_si128(a, b));
+    to += 16; from += 16; numBytes -= 16;
+  }
+#elif defined(__ARM_NEON)
+  while (numBytes >= 16) {
+    vst1q_u8(to, veorq_u8(vld1q_u8(to), vld1q_u8(from)));
+    to += 16; from += 16; numBytes -= 16;
+  }
+#endif
+  // Then (or if we don't have SIMD instructions), 8 bytes at a time.  ("memcpy()" avoids unaligned accesses.)
+  while (numBytes >= 8) {
+    u_int64_t a, b;
+    memcpy(&a, to, 8); memcpy(&b, from, 8);
+    a ^= b;
+    memcpy(to, &a, 8);
+    to += 8; from += 8; numBytes -= 8;
+  }
+  while (numBytes > 0) {
+    *to++ ^= *from++;
+    --numBytes;
+  }
+}
+
+static u_int16_t get2Bytes(u_int8_t const* p) { return (p[0]<<8)|p[1]; }
+static u_int32_t get4Bytes(u_int8_t const* p) { return (p[0]<<24)|(p[1]<<16)|(p[2]<<8)|p[3]; }
+static void put2Bytes(u_int8_t* p, u_int16_t v) { p[0] = v>>8; p[1] = (u_int8_t)v; }
+static void put4Bytes(u_int8_t* p, u_int32_t v) { p[0] = v>>24; p[1] = v>>16; p[2] = v>>8; p[3] = (u_int8_t)v; }
+
+#define MASK_BIT(i) (((u_int64_t)1)<<(ULPFEC_MAX_MASK_BITS-1-(i)))
+
+////////// ULPFECEncoder //////////
+
+Boolean ULPFECEncoder::parametersAreValid(unsigned numColumns, unsigned numRows, Boolean rowFEC) {
+  if (numColumns == 0 || numColumns > ULPFEC_MAX_MASK_BITS || numRows == 0 || numRows > 255) return False;
+  if (numRows == 1) return rowFEC; // otherwise, we'd generate no FEC packets at all
+  return (numRows-1)*numColumns < ULPFEC_MAX_MASK_BITS; // so that a column fits within a mask
+}
+
+ULPFECEncoder::ULPFECEncoder(unsigned char fecPayloadType, unsigned numColumns, unsigned numRows, Boolean rowFEC)
+  : fFECPayloadType(fecPayloadType), fNumColumns(numColumns), fNumRows(numRows), fRowFEC(rowFEC),
+    fSSRC(our_random32()), fSeqNo((u_int16_t)our_random()), fHaveNextMediaSeqNum(False), fNextMediaSeqNum(0),
+    fPositionInMatrix(0), fColumnAccumulators(NULL), fPacketBuf(NULL), fPacketBufSize(0), fNumFECPacketsGenerated(0) {
+  fRowAccumulator.payload = NULL;
+  fRowAccumulator.payloadCapacity = 0;
+  resetAccumulator(fRowAccumulator);
+  if (fNumRows > 1) {
+    fColumnAccumulators = new Accumulator[fNumColumns];
+    for (unsigned i = 0; i < fNumColumns; ++i) {
+      fColumnAccumulators[i].payload = NULL;
+      fColumnAccumulators[i].payloadCapacity = 0;
+      resetAccumulator(fColumnAccumulators[i]);
+    }
+  }
+}
+
+ULPFECEncoder::~ULPFECEncoder() {
+  delete[] fRowAccumulator.payload;
+  if (fColumnAccumulators != NULL) {
+    for (unsigned i = 0; i < fNumColumns; ++i) delete[] fColumnAccumulators[i].payload;
+    delete[] fColumnAccumulators;
+  }
+  if (fPacketBuf != NULL) delete[] (fPacketBuf - RTP_TCP_FRAMING_HEADER_SIZE);
+}
+
+void ULPFECEncoder::resetAccumulator(Accumulator& acc) {
+  memset(acc.bits, 0, sizeof acc.bits);
+  acc.payloadSize = 0;
+  acc.snBase = 0;
+  acc.mask = 0;
+  acc.timestamp = 0;
+  acc.isReady = False;
+}
+
+void ULPFECEncoder::addToAccumulator(Accumulator& acc, u_int8_t const* packet, unsigned packetSize) {
+  if (acc.isReady) resetAccumulator(acc); // its FEC packet was never asked for
+
+  u_int16_t seqNum = get2Bytes(&packet[2]);
+  if (acc.mask == 0) acc.snBase = seqNum;
+  acc.mask |= MASK_BIT((u_int16_t)(seqNum - acc.snBase));
+
+  // XOR in the RTP header's first byte (P, X, CC bits), second byte (M bit, PT), timestamp, and payload length:
+  acc.bits[0] ^= packet[0];
+  acc.bits[1] ^= packet[1];
+  for (unsigned i = 0; i < 4; ++i) acc.bits[2+i] ^= packet[4+i];
+  unsigned payloadSize = packetSize - 12;
+  acc.bits[6] ^= (u_int8_t)(payloadSize>>8);
+  acc.bits[7] ^= (u_int8_t)payloadSize;
+
+  // Then the payload (i.e., everything after the fixed RTP header), with shorter payloads treated as zero-padded:
+  if (payloadSize > acc.payloadCapacity) {
+    u_int8_t* newPayload = new u_int8_t[payloadSize];
+    memcpy(newPayload, acc.payload, acc.payloadSize);
+    delete[] acc.payload;
+    acc.payload = newPayload;
+    acc.payloadCapacity = payloadSize;
+  }
+  if (payloadSize > acc.payloadSize) {
+    memset(&acc.payload[acc.payloadSize], 0, payloadSize - acc.payloadSize);
+    acc.payloadSize = payloadSize;
+  }
+  ulpfecXOR(acc.payload, &packet[12], payloadSize);
+
+  acc.timestamp = get4Bytes(&packet[4]);
+}
+
+void ULPFECEncoder::startNewMatrix() {
+  fPositionInMatrix = 0;
+  resetAccumulator(fRowAccumulator);
+  if (fColumnAccumulators != NULL) {
+    for (unsigned i = 0; i < fNumColumns; ++i) resetAccumulator(fColumnAccumulators[i]);
+  }
+}
+
+void ULPFECEncoder::noteMediaPacket(u_int8_t const* packet, unsigned packetSize) {
+  if (packetSize < 12 || packetSize - 12 > 0xFFFF) return; // we can't protect this packet
+
+  u_int16_t seqNum = get2Bytes(&packet[2]);
+  if (!fHaveNextMediaSeqNum || seqNum != fNextMediaSeqNum) {
+    // This is the first packet, or some packets were skipped (so our masks would be wrong).  Start again:
+    startNewMatrix();
+  }
+  fHaveNextMediaSeqNum = True;
+  fNextMediaSeqNum = seqNum + 1;
+
+  unsigned row = fPositionInMatrix/fNumColumns;
+  unsigned column = fPositionInMatrix%fNumColumns;
+  if (fRowFEC) {
+    addToAccumulator(fRowAccumulator, packet, packetSize);
+    if (column == fNumColumns-1) fRowAccumulator.isReady = True;
+  }
+  if (fColumnAccumulators != NULL) {
+    addToAccumulator(fColumnAccumulators[column], packet, packetSize);
+    if (row == fNumRows-1) fColumnAccumulators[column].isReady = True;
+  }
+
+  if (++fPositionInMatrix == fNumColumns*fNumRows) fPositionInMatrix = 0;
+}
+
+u_int8_t const* ULPFECEncoder::nextFECPacket(unsigned& resultPacketSize) {
+  // Find an accumulator that's ready:
+  Accumulator* acc = NULL;
+  if (fRowAccumulator.isReady) {
+    acc = &fRowAccumulator;
+  } else if (fColumnAccumulators != NULL) {
+    for (unsigned i = 0; i < fNumColumns; ++i) {
+      if (fColumnAccumulators[i].isReady) {
+	acc = &fColumnAccumulators[i];
+	break;
+      }
+    }
+  }
+  if (acc == NULL) return NULL;
+
+  // Build a FEC packet from it (RFC 5109, sections 7.3 and 7.4):
+  Boolean longMask = (acc->mask & 0xFFFFFFFF) != 0; // i.e., it protects any packet beyond the 16th
+  unsigned packetSize = 12 + 10 + (longMask ? 8 : 4) + acc->payloadSize;
+  if (packetSize > fPacketBufSize) {
+    if (fPacketBuf != NULL) delete[] (fPacketBuf - RTP_TCP_FRAMING_HEADER_SIZE);
+    // Leave room so that the packet can be protected (by SRTP) in place, and sent over TCP with its framing header:
+    fPacketBuf = new u_int8_t[RTP_TCP_FRAMING_HEADER_SIZE + packetSize + SRTP_MAX_TRAILER_SIZE] + RTP_TCP_FRAMING_HEADER_SIZE;
+    fPacketBufSize = packetSize;
+  }
+  u_int8_t* p = fPacketBuf;
+
+  // RTP header:
+  p[0] = 0x80; // version 2; no padding, extension or CSRCs
+  p[1] = fFECPayloadType; // marker bit not set
+  put2Bytes(&p[2], fSeqNo++);
+  put4Bytes(&p[4], acc->timestamp);
+  put4Bytes(&p[8], fSSRC);
+  p += 12;
+
+  // FEC header:
+  p[0] = (longMask ? 0x40 : 0x00) | (acc->bits[0]&0x3F); // E=0; L; P, X, CC recovery
+  p[1] = acc->bits[1]; // M, PT recovery
+  put2Bytes(&p[2], acc->snBase);
+  memcpy(&p[4], &acc->bits[2], 4); // TS recovery
+  memcpy(&p[8], &acc->bits[6], 2); // length recovery
+  p += 10;
+
+  // Level 0 header:
+  put2Bytes(&p[0], acc->payloadSize); // protection length
+  put2Bytes(&p[2], (u_int16_t)(acc->mask>>32));
+  if (longMask) put4Bytes(&p[4], (u_int32_t)acc->mask);
+  p += longMask ? 8 : 4;
+
+  // Level 0 payload:
+  memcpy(p, acc->payload, acc->payloadSize);
+
+  resetAccumulator(*acc);
+  ++fNumFECPacketsGenerated;
+  resultPacketSize = packetSize;
+  return fPacketBuf;
+}
+
+////////// ULPFECDecoder //////////
+
+ULPFECDecoder::ULPFECDecoder(unsigned char fecPayloadType)
+  : fFECPayloadType(fecPayloadType), fNumPending(0), fHaveHighestSeqNum(False), fHighestSeqNum(0), fMediaSSRC(0),
+    fRecoveredQueueHead(0), fRecoveredQueueSize(0), fRecoveryBuf(NULL), fRecoveryBufSize(0),
+    fNumFECPacketsReceived(0), fNumPacketsRecovered(0) {
+  for (unsigned i = 0; i < HISTORY_SIZE; ++i) {
+    fHistory[i].data = NULL;
+    fHistory[i].size = fHistory[i].capacity = 0;
+    fHistory[i].seqNum = 0;
+    fHistory[i].isValid = False;
+  }
+  for (unsigned i = 0; i < MAX_PENDING_FEC_PACKETS; ++i) {
+    fPending[i].data = NULL;
+    fPending[i].size = fPending[i].capacity = 0;
+    fPending[i].snBase = 0;
+    fPending[i].mask = 0;
+    fPending[i].isValid = False;
+  }
+}
+
+ULPFECDecoder::~ULPFECDecoder() {
+  for (unsigned i = 0; i < HISTORY_SIZE; ++i) delete[] fHistory[i].data;
+  for (unsigned i = 0; i < MAX_PENDING_FEC_PACKETS; ++i) delete[] fPending[i].data;
+  delete[] fRecoveryBuf;
+}
+
+void ULPFECDecoder::storeInto(u_int8_t*& data, unsigned& size, unsigned& capacity,
+			      u_int8_t const* packet, unsigned packetSize) {
+  if (packetSize > capacity) {
+    delete[] data;
+    data = new u_int8_t[packetSize];
+    capacity = packetSize;
+  }
+  memcpy(data, packet, packetSize);
+  size = packetSize;
+}
+
+ULPFECDecoder::StoredPacket* ULPFECDecoder::lookupMediaPacket(u_int16_t seqNum) {
+  StoredPacket& stored = fHistory[seqNum%HISTORY_SIZE];
+  return stored.isValid && stored.seqNum == seqNum ? &stored : NULL;
+}
+
+void ULPFECDecoder::storeMediaPacket(u_int8_t const* packet, unsigned packetSize) {
+  u_int16_t seqNum = get2Bytes(&packet[2]);
+  StoredPacket& stored = fHistory[seqNum%HISTORY_SIZE];
+  storeInto(stored.data, stored.size, stored.capacity, packet, packetSize);
+  stored.seqNum = seqNum;
+  stored.isValid = True;
+}
+
+void ULPFECDecoder::noteMediaPacket(u_int8_t const* packet, unsigned packetSize) {
+  if (packetSize < 12) return;
+
+  u_int16_t seqNum = get2Bytes(&packet[2]);
+  u_int16_t seqNumDiff = seqNum - fHighestSeqNum;
+  if (!fHaveHighestSeqNum || (seqNumDiff > 0 && seqNumDiff < 0x8000)) {
+    fHighestSeqNum = seqNum;
+    fHaveHighestSeqNum = True;
+  }
+  fMediaSSRC = get4Bytes(&packet[8]);
+  storeMediaPacket(packet, packetSize);
+
+  // This packet might have been the one that a pending FEC packet was waiting for:
+  if (fNumPending > 0) tryRecovery();
+}
+
+void ULPFECDecoder::noteFECPacket(u_int8_t const* packet, unsigned packetSize) {
+  ++fNumFECPacketsReceived;
+
+  // Skip over the RTP header (including any CSRCs and header extension):
+  if (packetSize < 12) return;
+  unsigned offset = 12 + 4*(packet[0]&0x0F);
+  if ((packet[0]&0x10) != 0) { // header extension
+    if (packetSize < offset + 4) return;
+    offset += 4 + 4*get2Bytes(&packet[offset+2]);
+  }
+  if ((packet[0]&0x20) != 0) { // padding
+    if (packetSize <= offset || packet[packetSize-1] > packetSize - offset) return;
+    packetSize -= packet[packetSize-1];
+  }
+  if (packetSize < offset + 10 + 4) return;
+  u_int8_t const* fec = &packet[offset];
+  unsigned fecSize = packetSize - offset;
+
+  // Check the FEC header, and the level 0 header:
+  if ((fec[0]&0x80) != 0) return; // the 'E' bit is reserved, and must be 0
+  Boolean longMask = (fec[0]&0x40) != 0;
+  unsigned headersSize = 10 + (longMask ? 8 : 4);
+  if (fecSize < headersSize) return;
+  unsigned protectionLength = get2Bytes(&fec[10]);
+  if (fecSize < headersSize + protectionLength) return;
+  u_int64_t mask = ((u_int64_t)get2Bytes(&fec[12]))<<32;
+  if (longMask) mask |= get4Bytes(&fec[14]);
+  if (mask == 0) return;
+
+  // Store it (replacing the oldest pending FEC packet, if we have no room):
+  PendingFECPacket* pending = NULL;
+  u_int16_t maxAge = 0;
+  for (unsigned i = 0; i < MAX_PENDING_FEC_PACKETS; ++i) {
+    if (!fPending[i].isValid) {
+      pending = &fPending[i];
+      break;
+    }
+    u_int16_t age = fHighestSeqNum - fPending[i].snBase;
+    if (pending == NULL || age > maxAge) {
+      pending = &fPending[i];
+      maxAge = age;
+    }
+  }
+  if (!pending->isValid) ++fNumPending;
+  storeInto(pending->data, pending->size, pending->capacity, fec, headersSize + protectionLength);
+  pending->snBase = get2Bytes(&fec[2]);
+  pending->mask = mask;
+  pending->isValid = True;
+
+  tryRecovery();
+}
+
+void ULPFECDecoder::tryRecovery() {
+  // Repeatedly look for a pending FEC packet that's missing exactly one of the packets that it protects, and use it
+  // to recover that packet.  (Each recovered packet may, in turn, let another FEC packet recover another packet.)
+  Boolean madeProgress;
+  do {
+    madeProgress = False;
+    for (unsigned i = 0; i < MAX_PENDING_FEC_PACKETS && fNumPending > 0; ++i) {
+      PendingFECPacket& pending = fPending[i];
+      if (!pending.isValid) continue;
+
+      unsigned numMissing = 0;
+      u_int16_t missingSeqNum = 0;
+      u_int16_t age = fHighestSeqNum - pending.snBase;
+      if (age < 0x8000 && age >= HISTORY_SIZE - ULPFEC_MAX_MASK_BITS) {
+	numMissing = 0; // this FEC packet is too old to be useful (its packets would no longer be in our history)
+      } else {
+	for (unsigned j = 0; j < ULPFEC_MAX_MASK_BITS; ++j) {
+	  if ((pending.mask & MASK_BIT(j)) == 0) continue;
+	  u_int16_t seqNum = pending.snBase + j;
+	  if (lookupMediaPacket(seqNum) == NULL) {
+	    missingSeqNum = seqNum;
+	    if (++numMissing > 1) break;
+	  }
+	}
+      }
+      if (numMissing > 1) continue; // keep this FEC packet, in case other recoveries (or late packets) help it
+
+      if (numMissing == 1 && recover(pending, missingSeqNum)) madeProgress = True;
+      pending.isValid = False;
+      --fNumPending;
+    }
+  } while (madeProgress);
+}
+
+Boolean ULPFECDecoder::recover(PendingFECPacket& fecPacket, u_int16_t missingSeqNum) {
+  // (RFC 5109, section 8.2)
+  u_int8_t const* fec = fecPacket.data;
+  Boolean longMask = (fec[0]&0x40) != 0;
+  unsigned protectionLength = get2Bytes(&fec[10]);
+  u_int8_t const* fecPayload = &fec[10 + (longMask ? 8 : 4)];
+
+  if (12 + protectionLength > fRecoveryBufSize) {
+    delete[] fRecoveryBuf;
+    fRecoveryBuf = new u_int8_t[12 + protectionLength];
+    fRecoveryBufSize = 12 + protectionLength;
+  }
+  u_int8_t* payload = &fRecoveryBuf[12];
+  memcpy(payload, fecPayload, protectionLength);
+
+  // XOR the FEC packet's recovery fields, and payload, with those of each of the other protected packets:
+  u_int8_t bits[8];
+  bits[0] = fec[0]; bits[1] = fec[1];
+  memcpy(&bits[2], &fec[4], 4); // TS recovery
+  memcpy(&bits[6], &fec[8], 2); // length recovery
+  for (unsigned j = 0; j < ULPFEC_MAX_MASK_BITS; ++j) {
+    if ((fecPacket.mask & MASK_BIT(j)) == 0) continue;
+    u_int16_t seqNum = fecPacket.snBase + j;
+    if (seqNum == missingSeqNum) continue;
+
+    StoredPacket const* stored = lookupMediaPacket(seqNum);
+    if (stored == NULL) return False; // shouldn't happen
+    u_int8_t const* packet = stored->data;
+    bits[0] ^= packet[0];
+    bits[1] ^= packet[1];
+    for (unsigned i = 0; i < 4; ++i) bits[2+i] ^= packet[4+i];
+    unsigned payloadSize = stored->size - 12;
+    bits[6] ^= (u_int8_t)(payloadSize>>8);
+    bits[7] ^= (u_int8_t)payloadSize;
+    ulpfecXOR(payload, &packet[12], payloadSize < protectionLength ? payloadSize : protectionLength);
+  }
+  unsigned recoveredPayloadSize = get2Bytes(&bits[6]);
+  if (recoveredPayloadSize > protectionLength) return False; // the FEC packet didn't protect all of it
+
+  // Fill in the recovered packet's RTP header:
+  fRecoveryBuf[0] = 0x80 | (bits[0]&0x3F);
+  fRecoveryBuf[1] = bits[1];
+  put2Bytes(&fRecoveryBuf[2], missingSeqNum);
+  memcpy(&fRecoveryBuf[4], &bits[2], 4);
+  put4Bytes(&fRecoveryBuf[8], fMediaSSRC);
+
+  storeMediaPacket(fRecoveryBuf, 12 + recoveredPayloadSize);
+  ++fNumPacketsRecovered;
+  if (fRecoveredQueueSize == MAX_RECOVERED_QUEUE_SIZE) { // unlikely; drop the oldest
+    fRecoveredQueueHead = (fRecoveredQueueHead+1)%MAX_RECOVERED_QUEUE_SIZE;
+    --fRecoveredQueueSize;
+  }
+  fRecoveredQueue[(fRecoveredQueueHead + fRecoveredQueueSize++)%MAX_RECOVERED_QUEUE_SIZE] = missingSeqNum;
+  return True;
+}
+
+u_int8_t const* ULPFECDecoder::nextRecoveredPacket(unsigned& resultPacketSize) {
+  while (fRecoveredQueueSize > 0) {
+    u_int16_t seqNum = fRecoveredQueue[fRecoveredQueueHead];
+    fRecoveredQueueHead = (fRecoveredQueueHead+1)%MAX_RECOVERED_QUEUE_SIZE;
+    --fRecoveredQueueSize;
+
+    StoredPacket const* stored = lookupMediaPacket(seqNum);
+    if (stored != NULL) {
+      resultPacketSize = stored->size;
+      return stored->data;
+    }
+  }
+  return NULL;
+}
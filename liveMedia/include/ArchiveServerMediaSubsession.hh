@@ -0,0 +1,80 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A 'ServerMediaSubsession' object that creates new, unicast, "RTPSink"s on demand, to play back a
+// H.264 or H.265 video archive that was recorded (as a sequence of segment files) by "RollingRecordingSink".
+// Clients can seek by wall-clock time ("Range: clock=..."), and can use "Scale:" for fast (or reverse) review.
+// C++ header
+
+#ifndef _ARCHIVE_SERVER_MEDIA_SUBSESSION_HH
+#define _ARCHIVE_SERVER_MEDIA_SUBSESSION_HH
+
+#ifndef _ON_DEMAND_SERVER_MEDIA_SUBSESSION_HH
+#include "OnDemandServerMediaSubsession.hh"
+#endif
+#ifndef _RECORDING_ARCHIVE_HH
+#include "RecordingArchive.hh"
+#endif
+
+class ArchiveServerMediaSubsession: public OnDemandServerMediaSubsession {
+public:
+  static ArchiveServerMediaSubsession*
+  createNew(UsageEnvironment& env, char const* fileNamePrefix, int hNumber = 264);
+  // "fileNamePrefix" is the file name prefix that was given to the "RollingRecordingSink" that recorded the
+  //   archive (so the archive's segment list is the file "<fileNamePrefix>index").  The archive may still be
+  //   being recorded; the segment list is reread whenever it changes.
+  // "hNumber" is 264 (for H.264 video) or 265 (for H.265 video).
+  // Each client gets its own playback position; by default, playback starts at the beginning of the archive.
+  // For a "Scale:" greater than 1 - or less than 0 (i.e., reverse play) - only key frames are sent.
+
+  // Used by our stream sources:
+  void reloadSegmentList(); // rereads the segment list, if it has changed
+  RecordingSegmentList const& segments() const { return fSegments; }
+  int hNumber() const { return fHNumber; }
+
+protected:
+  ArchiveServerMediaSubsession(UsageEnvironment& env, char const* fileNamePrefix, int hNumber);
+      // called only by createNew();
+  virtual ~ArchiveServerMediaSubsession();
+
+private: // redefined virtual functions
+  virtual void seekStreamSource(FramedSource* inputSource, double& seekNPT, double streamDuration, u_int64_t& numBytes);
+  virtual void seekStreamSource(FramedSource* inputSource, char*& absStart, char*& absEnd);
+  virtual void setStreamSourceScale(FramedSource* inputSource, float scale);
+  virtual void setStreamSourceDuration(FramedSource* inputSource, double streamDuration, u_int64_t& numBytes);
+  virtual FramedSource* createNewStreamSource(unsigned clientSessionId,
+					      unsigned& estBitrate);
+  virtual RTPSink* createNewRTPSink(Groupsock* rtpGroupsock,
+                                    unsigned char rtpPayloadTypeIfDynamic,
+				    FramedSource* inputSource);
+  virtual void testScaleFactor(float& scale);
+  virtual float duration() const;
+  virtual void getAbsoluteTimeRange(char*& absStartTime, char*& absEndTime) const;
+
+private:
+  char* fSegmentListFileName;
+  int fHNumber;
+  RecordingSegmentList fSegments;
+  // These identify the version of the segment list that we last read.  (Because the list is always replaced
+  // - rather than rewritten - a new version usually has a new 'inode' number.)
+  unsigned long fSegmentListInode;
+  long fSegmentListModificationTime;
+  u_int64_t fSegmentListSize;
+  char fAbsStartTime[40]; // the start of the archive, as a "clock=" time
+};
+
+#endif
@@ -24,6 +24,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _MEDIA_SINK_HH
 #include "MediaSink.hh"
 #endif
+#ifndef _RECORDING_WRITER_HH
+#include "RecordingWriter.hh"
+#endif
 
 class FileSink: public MediaSink {
 public:
@@ -41,6 +44,12 @@ public:
 		       struct timeval presentationTime);
   // (Available in case a client wants to add extra data to the output file)
 
+  void setWriteParameters(RecordingWriterParameters const& params);
+  // Changes how our output file is buffered and written (see "RecordingWriter.hh").  By default, data is
+  // written by a background thread, in large pieces, at least once per second.
+  // (This has no effect if "oneFilePerFrame" is True.)
+  RecordingWriter* writer() const { return fWriter; } // NULL if "oneFilePerFrame" is True
+
 protected:
   FileSink(UsageEnvironment& env, FILE* fid, unsigned bufferSize,
 	   char const* perFrameFileNamePrefix);
@@ -51,6 +60,7 @@ protected: // redefined virtual functions:
   virtual Boolean continuePlaying();
 
 protected:
+  static void writerHasFreeBuffer(void* clientData);
   static void afterGettingFrame(void* clientData, unsigned frameSize,
 				unsigned numTruncatedBytes,
 				struct timeval presentationTime,
@@ -60,6 +70,7 @@ protected:
 				 struct timeval presentationTime);
 
   FILE* fOutFid;
+  RecordingWriter* fWriter; // used (to write to "fOutFid") if "oneFilePerFrame" is False
   unsigned char* fBuffer;
   unsigned fBufferSize;
   char* fPerFrameFileNamePrefix; // used if "oneFilePerFrame" is True
@@ -53,6 +53,7 @@ protected:
   virtual char const* MIMEtype() const;
   virtual void getAttributes() const;
   virtual void doStopGettingFrames();
+  virtual void setTargetBitrate(unsigned targetBitrate);
 
 protected:
   FramedSource* fInputSource;
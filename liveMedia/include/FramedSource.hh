@@ -77,6 +77,11 @@ public:
   // size of the largest possible frame that we may serve, or 0
   // if no such maximum is known (default)
 
+  virtual void setTargetBitrate(unsigned targetBitrate /* kbps */);
+  // Asks a live source (e.g., an encoder) to adapt its output to this bitrate.  This is called - e.g., by a
+  // "RTPRateController" - as the estimated available bandwidth changes.  The default implementation does nothing.
+  // ("FramedFilter"s pass the request on to their input source.)
+
   // 将相关标志和回调函数重置为初始状态，然后调用 doStopGettingFrames()，
   // 该函数执行停止获取帧数据的默认操作，包括取消任何挂起的传递任务。
   // 子类可以根据需要重新定义 doStopGettingFrames() 函数，以执行特定的停止获取帧数据的操作。
@@ -28,6 +28,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _SERVER_MEDIA_SESSION_HH
 #include "ServerMediaSession.hh"
 #endif
+#ifndef _TLS_STATE_HH
+#include "TLSState.hh"
+#endif
 
 #ifndef REQUEST_BUFFER_SIZE
 #define REQUEST_BUFFER_SIZE 20000 // request最大的buffersize
@@ -35,6 +38,18 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef RESPONSE_BUFFER_SIZE
 #define RESPONSE_BUFFER_SIZE 20000 // response最大的buffsize
 #endif
+#ifndef INITIAL_REQUEST_BUFFER_SIZE
+#define INITIAL_REQUEST_BUFFER_SIZE 1024
+  // Request buffers start at this size, and grow (by doubling) - up to REQUEST_BUFFER_SIZE - only for large requests
+#endif
+#ifndef INITIAL_RESPONSE_BUFFER_SIZE
+#define INITIAL_RESPONSE_BUFFER_SIZE 512
+  // Likewise, response buffers start at this size, and grow (by doubling) - up to RESPONSE_BUFFER_SIZE - only for
+  // large responses (e.g., "DESCRIBE" responses with a large SDP description)
+#endif
+// (These buffers are allocated from a "PoolAllocator", whose block sizes are powers of 2, so each buffer's size is a
+//  power of 2 - i.e., it fills its block.  The largest buffer is the block that REQUEST_BUFFER_SIZE or
+//  RESPONSE_BUFFER_SIZE bytes would need: 32768 bytes by default.)
 
 class GenericMediaServer : public Medium
 {
@@ -88,6 +103,21 @@ public:
   /// @return ClientSession的个数
   unsigned numClientSessions() const { return fClientSessions->numEntries(); }
 
+  unsigned numClientConnections() const { return fClientConnections->numEntries(); }
+  unsigned long numConnectionBufferBytes() const { return fNumConnectionBufferBytes; }
+      // the total size of the request and response buffers that our "ClientConnection"s currently have allocated
+
+  /// @brief 在另一个端口上接受TLS连接(例如"rtsps://")
+  /// @param certFileName 服务器证书(PEM)文件
+  /// @param privateKeyFileName 服务器私钥(PEM)文件
+  /// @param tlsPort TLS监听端口(为0时由内核分配)
+  /// @return success true，failed false
+  Boolean setUpTLS(char const *certFileName, char const *privateKeyFileName, Port tlsPort);
+  // Connections to "tlsPort" do a (non-blocking) TLS handshake before their first request is read.  Clients can resume
+  // their previous TLS sessions, using session tickets.  (Returns False, after setting "resultMsg", if TLS isn't
+  // supported, or if the certificate or key can't be used.)
+  portNumBits tlsServerPortNum() const; // 0 if we're not accepting TLS connections
+
 protected:
   // If "reclamationSeconds" > 0, then the "ClientSession" state for each client will get
   // reclaimed if no activity from the client is detected in at least "reclamationSeconds".
@@ -105,8 +135,9 @@ protected:
   /// @brief 根据传入的端口号生成对应的监听套接字(假如传入的port为0，内核将会为我们分配对应的端口，并且将端口号赋给fServerPort成员变量)
   /// @param env 用户基础环境变量
   /// @param ourPort 传入的端口号
+  /// @param domain AF_INET或AF_INET6
   /// @return 生产的监听套接字
-  static int setUpOurSocket(UsageEnvironment &env, Port &ourPort);
+  static int setUpOurSocket(UsageEnvironment &env, Port &ourPort, int domain = AF_INET);
 
   /// @brief 处理到来的连接的回调函数(一个封装，本质是调用incomingConnectionHandler)
   /// @param  函数参数，占位参数
@@ -120,7 +151,16 @@ protected:
 
   /// @brief 理到来的连接由incomingConnectionHandler函数调用，创建对应的clientConnection来保存TCP连接信息
   /// @param serverSocket Server对应的监听套接字
-  void incomingConnectionHandlerOnSocket(int serverSocket);
+  /// @param tlsContext 若非NULL，则该连接先进行TLS握手
+  void incomingConnectionHandlerOnSocket(int serverSocket, TLSServerContext *tlsContext = NULL);
+
+  /// @brief 处理到来的TLS连接的回调函数
+  static void incomingConnectionHandlerTLS(void *, int /*mask*/);
+  void incomingConnectionHandlerTLS();
+
+  /// @brief 处理IPv6监听套接字上到来的(普通及TLS)连接的回调函数
+  static void incomingConnectionHandlerIPv6(void *, int /*mask*/);
+  static void incomingConnectionHandlerTLSIPv6(void *, int /*mask*/);
 
 public: // should be protected, but some old compilers complain otherwise
   // The state of a TCP connection used by a client:
@@ -129,7 +169,7 @@ public: // should be protected, but some old compilers complain otherwise
   class ClientConnection
   {
   protected:
-    ClientConnection(GenericMediaServer &ourServer, int clientSocket, struct sockaddr_in clientAddr);
+    ClientConnection(GenericMediaServer &ourServer, int clientSocket, struct sockaddr_storage const &clientAddr);
     virtual ~ClientConnection();
 
     UsageEnvironment &envir() { return fOurServer.envir(); }
@@ -154,15 +194,40 @@ public: // should be protected, but some old compilers complain otherwise
     /// @brief 将fRequestBytesAlreadySeen(已经接收到的数据)归0，将fRequestBufferBytesLeft(接收buffer还剩多少空间)设成buffer的大小
     void resetRequestBuffer();
 
+    // Our request and response buffers are allocated (from our environment's "PoolAllocator") only when needed, so
+    // that idle connections use little memory:
+    Boolean ensureRequestBufferSpace(unsigned numBytesToAdd = 1);
+        // Allocates our request buffer (if necessary), and grows it (if possible) so that more than "numBytesToAdd" bytes
+        // are left.  Returns False iff no more request data can be added.
+    virtual Boolean requestBufferMayBeReallocated() const;
+        // Subclasses redefine this to return False while they're using pointers into "fRequestBuffer"
+    virtual void requestBufferWasReallocated(unsigned char *oldBuffer);
+        // Called after "fRequestBuffer" has been allocated ("oldBuffer" == NULL) or grown.  Subclasses that keep
+        // pointers into "fRequestBuffer" redefine this to update them
+    void ensureResponseBuffer();
+    void formatResponse(char const *format, ...);
+        // Sets our response (in "fResponseBuffer") using "snprintf()"-style formatting, growing the buffer if needed.
+        // (A response that's too large even for the largest buffer is truncated.)
+    void releaseBuffers(); // called when we're idle (i.e., have no partial request buffered)
+    unsigned numBufferBytes() const { return fRequestBufferSize + fResponseBufferSize; }
+
+    /// @brief 开始TLS握手，握手完成后才开始读取请求
+    void startTLS(TLSServerContext &tlsContext);
+    static void tlsHandshakeCompletionHandler(void *instance, Boolean success);
+    void tlsHandshakeCompletionHandler(Boolean success);
+
   protected:
     friend class GenericMediaServer;
     friend class ClientSession;
     friend class RTSPServer; // needed to make some broken Windows compilers work; remove this in the future when we end support for Windows
     GenericMediaServer &fOurServer; //保存GenericMediaServer
     int fOurSocket;                 //该连接的sockfd
-    struct sockaddr_in fClientAddr; //该连接的客户端地址
-    unsigned char fRequestBuffer[REQUEST_BUFFER_SIZE];  //接收buffer，大小为REQUEST_BUFFER_SIZE(20000)
-    unsigned char fResponseBuffer[RESPONSE_BUFFER_SIZE];//发送buffer，大小为RESPONSE_BUFFER_SIZE(20000)
+    struct sockaddr_storage fClientAddr; //该连接的客户端地址(IPv4或IPv6)
+    TLSState *fTLSState;            //若该连接使用TLS，则为其TLS状态，否则为NULL
+    unsigned char *fRequestBuffer;  //接收buffer，按需增长，最大约为REQUEST_BUFFER_SIZE
+    unsigned fRequestBufferSize;
+    unsigned char *fResponseBuffer; //发送buffer，按需增长，最大约为RESPONSE_BUFFER_SIZE
+    unsigned fResponseBufferSize;
 
     //fRequestBytesAlreadySeen(接收数据在缓冲区的起始位置)，fRequestBufferBytesLeft(接收buffer还剩多少空间)
     unsigned fRequestBytesAlreadySeen, fRequestBufferBytesLeft;
@@ -195,7 +260,7 @@ protected:
   /// @param clientSocket 客户套接字描述符
   /// @param clientAddr 客户端地址
   /// @return 返回ClientConnection *
-  virtual ClientConnection *createNewClientConnection(int clientSocket, struct sockaddr_in clientAddr) = 0;
+  virtual ClientConnection *createNewClientConnection(int clientSocket, struct sockaddr_storage const &clientAddr) = 0;
 
 
   /// @brief 纯虚函数，通过sessionId创建对应的ClientConnection，具体实现在RTSPServer类中
@@ -231,7 +296,12 @@ protected:
   friend class ClientSession;
   friend class ServerMediaSessionIterator;
   int fServerSocket;    //server的监听套接字
+  int fServerSocketIPv6; //server的IPv6监听套接字(与fServerSocket同一端口；不支持IPv6时为-1)
   Port fServerPort;     //server监听端口
+  int fTLSServerSocket; //TLS连接的监听套接字(未使用TLS时为-1)
+  int fTLSServerSocketIPv6; //TLS连接的IPv6监听套接字(未使用TLS或不支持IPv6时为-1)
+  Port fTLSServerPort;  //TLS监听端口
+  TLSServerContext *fTLSServerContext;
 
 
   /**
@@ -244,6 +314,7 @@ private:
   HashTable *fClientConnections;   // the "ClientConnection" objects that we're using
   HashTable *fClientSessions;      // maps 'session id' strings to "ClientSession" objects
   u_int32_t fPreviousClientSessionId; //上一个客户会话id
+  unsigned long fNumConnectionBufferBytes;
 };
 
 // A data structure used for optional user/password authentication:
@@ -0,0 +1,81 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A filter that reduces the bitrate of a H.264 or H.265 video stream - when asked to, using
+// "FramedSource::setTargetBitrate()" - by dropping (temporal) layers that no other pictures depend upon.
+// C++ header
+
+#ifndef _H264_OR_5_VIDEO_LAYER_DROPPER_HH
+#define _H264_OR_5_VIDEO_LAYER_DROPPER_HH
+
+#ifndef _FRAMED_FILTER_HH
+#include "FramedFilter.hh"
+#endif
+
+// The input must be discrete NAL units (without start codes), e.g. from a "H264or5VideoStreamFramer", or from a
+// "StreamReplicator" replica of one.  The output can be fed to a "H264or5VideoStreamDiscreteFramer".
+// For H.264, layer 0 is all reference pictures (and non-VCL NAL units), and layer 1 is the non-reference pictures.
+// For H.265, the layer of each picture is its "TemporalId"; switching up to a higher layer is done only where the
+// stream allows it (at a TSA, STSA, or IRAP picture).
+// The filter measures the bitrate of each layer, and passes on as many layers as fit within the target bitrate (but
+// always layer 0).  It also passes the target bitrate on to its input source - so that (e.g.) a shared encoder behind a
+// "StreamReplicator" can deliver the highest bitrate that any receiver can take, while receivers with less bandwidth get
+// fewer layers.
+
+class H264or5VideoLayerDropper: public FramedFilter {
+public:
+  static H264or5VideoLayerDropper* createNew(UsageEnvironment& env, FramedSource* inputSource,
+					     int hNumber /* 264 or 265 */);
+
+  unsigned maxLayer() const { return fMaxLayer; } // the highest layer that we're currently passing on
+  unsigned numNALUnitsDropped() const { return fNumNALUnitsDropped; }
+
+protected:
+  H264or5VideoLayerDropper(UsageEnvironment& env, FramedSource* inputSource, int hNumber);
+      // called only by createNew()
+  virtual ~H264or5VideoLayerDropper();
+
+protected:
+  // redefined virtual functions:
+  virtual void doGetNextFrame();
+  virtual void setTargetBitrate(unsigned targetBitrate);
+
+private:
+  static void afterGettingFrame(void* clientData, unsigned frameSize,
+                                unsigned numTruncatedBytes,
+                                struct timeval presentationTime,
+                                unsigned durationInMicroseconds);
+  void afterGettingFrame1(unsigned frameSize,
+                          unsigned numTruncatedBytes,
+                          struct timeval presentationTime,
+                          unsigned durationInMicroseconds);
+  void chooseDesiredMaxLayer();
+
+private:
+  enum { MAX_LAYERS = 7 };
+  int fHNumber;
+  unsigned fTargetBitrate; // kbps; 0 means 'pass on all layers'
+  unsigned fMaxLayer, fDesiredMaxLayer;
+  unsigned fNumNALUnitsDropped;
+  // Measurements of the bitrate of each layer:
+  unsigned fLayerBytes[MAX_LAYERS];
+  double fLayerBitrates[MAX_LAYERS]; // kbps
+  struct timeval fMeasurementStartTime;
+  Boolean fHaveMeasurements;
+};
+
+#endif
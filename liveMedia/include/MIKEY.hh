@@ -0,0 +1,90 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A data structure that implements a MIKEY message (RFC 3830), used to deliver the keys (and crypto policy) for SRTP
+// in a SDP "a=key-mgmt:" attribute (RFC 4567)
+// C++ header
+
+#ifndef _MIKEY_HH
+#define _MIKEY_HH
+
+#ifndef _BOOLEAN_HH
+#include "Boolean.hh"
+#endif
+#ifndef _NET_COMMON_H
+#include "NetCommon.h"
+#endif
+
+// We generate - and understand - only the simplest kind of MIKEY message: A 'pre-shared key' message whose key data is
+// not encrypted (and not MAC'd).  I.e., the SRTP master key and salt are sent in the clear, so they're secret only if
+// the SDP description (or RTSP response) itself is - e.g., if it's sent using RTSP-over-TLS.  (By default,
+// "RTSPServer" sends them only over TLS connections.)
+
+#define MIKEY_SRTP_MASTER_KEY_SIZE 16
+#define MIKEY_SRTP_MAX_MASTER_SALT_SIZE 14
+
+class MIKEYState {
+public:
+  enum SRTPProfile {
+    AES_CM_128_HMAC_SHA1_80, // RFC 3711: AES-128 counter mode encryption; 80-bit HMAC-SHA1 authentication tag
+    AEAD_AES_128_GCM         // RFC 7714: AES-128 Galois/counter mode; 128-bit authentication tag
+  };
+
+  static MIKEYState* createNew(SRTPProfile profile = AES_CM_128_HMAC_SHA1_80, Boolean encryptSRTP = True,
+			       Boolean encryptSRTCP = True);
+      // Generates a new (random) master key and salt
+  static MIKEYState* createNew(u_int8_t const* message, unsigned messageSize);
+      // Parses a MIKEY message; returns NULL (after setting "resultMsg") if it's invalid, or uses a policy that we
+      // don't support
+  static MIKEYState* createNewFromKeyMgmtAttribute(char const* attributeValue);
+      // Parses the value of a SDP "a=key-mgmt:" attribute: "mikey <base64-encoded MIKEY message>"
+  virtual ~MIKEYState();
+
+  u_int8_t* generateMessage(unsigned& messageSize, u_int32_t ssrc = 0, u_int32_t roc = 0) const;
+      // Returns a MIKEY message that describes our key and policy.  The result must be delete[]d by the caller.
+      // The message's (single) 'crypto session' is for "ssrc" (0 means 'any SSRC'), whose 'rollover counter' is "roc".
+  char* keyMgmtSDPLine() const;
+      // Returns a "a=key-mgmt:mikey ..." SDP line.  The result must be delete[]d by the caller.
+
+  SRTPProfile profile() const { return fProfile; }
+  Boolean encryptSRTP() const { return fEncryptSRTP; }
+  Boolean encryptSRTCP() const { return fEncryptSRTCP; }
+  u_int8_t const* masterKey() const { return fMasterKey; }
+  u_int8_t const* masterSalt() const { return fMasterSalt; }
+  u_int32_t ssrc() const { return fSSRC; } // of a parsed message's first 'crypto session' (0 means 'any SSRC')
+  u_int32_t roc() const { return fROC; } // the rollover counter of that 'crypto session'
+  unsigned masterSaltSize() const { return fProfile == AEAD_AES_128_GCM ? 12 : 14; }
+
+protected:
+  MIKEYState(SRTPProfile profile, Boolean encryptSRTP, Boolean encryptSRTCP); // called only by "createNew()"
+
+private:
+  Boolean parseMessage(u_int8_t const* message, unsigned messageSize);
+  Boolean parseSecurityPolicy(u_int8_t const* params, unsigned paramsSize);
+  Boolean parseKeyData(u_int8_t const* data, unsigned dataSize);
+
+private:
+  SRTPProfile fProfile;
+  Boolean fEncryptSRTP, fEncryptSRTCP;
+  u_int8_t fMasterKey[MIKEY_SRTP_MASTER_KEY_SIZE];
+  u_int8_t fMasterSalt[MIKEY_SRTP_MAX_MASTER_SALT_SIZE];
+  u_int32_t fCSBId; // 'crypto session bundle' id
+  u_int32_t fSSRC, fROC; // from a parsed message
+  u_int8_t fRand[16];
+};
+
+#endif
@@ -44,6 +44,13 @@ public:
   void setNumTSPacketsToStream(unsigned long numTSRecordsToStream);
   void setPCRLimit(float pcrLimit);
 
+  // Optionally, pass through only those Transport Stream packets that have specific PIDs
+  // (e.g., the packets of just one program within a multi-program Transport Stream).
+  // By default, packets with any PID are passed through.
+  void addPIDToFilter(u_int16_t pid);
+  void removePIDFromFilter(u_int16_t pid);
+  void clearPIDFilter(); // resets to the default: pass through packets with any PID
+
 protected:
   MPEG2TransportStreamFramer(UsageEnvironment& env, FramedSource* inputSource);
       // called only by createNew()
@@ -63,6 +70,7 @@ private:
 			  struct timeval presentationTime);
 
   Boolean updateTSPacketDurationEstimate(unsigned char* pkt, double timeNow);
+  unsigned filterTSPackets(unsigned numTSPackets); // returns the number of packets kept
 
 private:
   u_int64_t fTSPacketCount;
@@ -73,6 +81,7 @@ private:
   unsigned long fNumTSPacketsToStream; // used iff "fLimitNumTSPacketsToStream" is True
   Boolean fLimitTSPacketsToStreamByPCR;
   float fPCRLimit; // used iff "fLimitTSPacketsToStreamByPCR" is True
+  u_int8_t* fPIDFilter; // a bitmap, indexed by PID; NULL means 'pass through all PIDs'
 };
 
 #endif
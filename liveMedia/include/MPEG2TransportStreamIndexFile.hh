@@ -30,6 +30,20 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #define INDEX_RECORD_SIZE 11
 
+#ifndef TRANSPORT_PACKET_SIZE
+#define TRANSPORT_PACKET_SIZE 188
+#endif
+
+// Index records are read from the file (and cached) in blocks of this many records:
+#define INDEX_RECORD_CACHE_SIZE 256
+
+// Transport Stream data used for 'trick play' is read - and cached - in (aligned) blocks of this
+// many Transport Packets.  We keep up to "TS_PACKET_CACHE_NUM_BLOCKS" such blocks per file:
+#define TS_PACKETS_PER_CACHED_BLOCK 64
+#define TS_PACKET_CACHE_NUM_BLOCKS 32
+
+class TSPacketBlock; // forward
+
 class MPEG2TransportStreamIndexFile: public Medium {
 public:
   static MPEG2TransportStreamIndexFile* createNew(UsageEnvironment& env,
@@ -59,6 +73,13 @@ public:
   float getPlayingDuration();
   void stopReading() { closeFid(); }
 
+  // A cache - shared by all 'trick play' clients of this file - of recently-read (aligned) blocks of
+  // Transport Stream packets:
+  unsigned char const* lookupTSPacketBlock(unsigned long blockNum, unsigned& blockSize);
+      // returns NULL if block "blockNum" is not in the cache
+  void cacheTSPacketBlock(unsigned long blockNum, unsigned char const* data, unsigned blockSize);
+      // only complete blocks are cached; a partial block (at the end of the file) is not
+
   int mpegVersion();
       // returns the best guess for the version of MPEG being used for data within the underlying Transport Stream file.
       // (1,2,4, or 5 (representing H.264).  0 means 'don't know' (usually because the index file is empty))
@@ -68,7 +89,7 @@ private:
 
   Boolean openFid();
   Boolean seekToIndexRecord(unsigned long indexRecordNumber);
-  Boolean readIndexRecord(unsigned long indexRecordNum); // into "fBuf"
+  Boolean readIndexRecord(unsigned long indexRecordNum); // into "fBuf" (via "fRecordCache")
   Boolean readOneIndexRecord(unsigned long indexRecordNum); // closes "fFid" at end
   void closeFid();
 
@@ -91,6 +112,11 @@ private:
   unsigned long fCachedTSPacketNumber, fCachedIndexRecordNumber;
   unsigned long fNumIndexRecords;
   unsigned char fBuf[INDEX_RECORD_SIZE]; // used for reading index records from file
+  unsigned char* fRecordCache; // holds "fNumCachedRecords" records, starting at "fFirstCachedRecordNum"
+  unsigned long fFirstCachedRecordNum;
+  unsigned fNumCachedRecords;
+  TSPacketBlock* fTSPacketBlocks; // allocated only if 'trick play' is used
+  unsigned fTSPacketBlockUseCount;
 };
 
 #endif
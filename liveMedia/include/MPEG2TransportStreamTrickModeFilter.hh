@@ -60,9 +60,11 @@ private:
   virtual void doStopGettingFrames();
 
 private:
-  void attemptDeliveryToClient();
+  void attemptDeliveryToClient(Boolean blockWasJustRead = False);
   void seekToTransportPacket(unsigned long tsPacketNum);
-  void readTransportPacket(unsigned long tsPacketNum); // asynchronously
+  void readTransportPacketBlock(unsigned long blockNum); // asynchronously
+  void readMoreOfTransportPacketBlock();
+  void finishReadingTransportPacketBlock();
 
   static void afterGettingFrame(void* clientData, unsigned frameSize,
 				unsigned numTruncatedBytes,
@@ -86,8 +88,14 @@ private:
   unsigned fFrameCount;
   unsigned long fNextIndexRecordNum; // next to be read from the index file
   unsigned long fNextTSPacketNum; // next to be read from the transport stream file
-  unsigned char fInputBuffer[TRANSPORT_PACKET_SIZE];
-  unsigned long fCurrentTSPacketNum; // corresponding to data currently in the buffer
+  unsigned char fInputBuffer[TS_PACKETS_PER_CACHED_BLOCK*TRANSPORT_PACKET_SIZE];
+      // holds an (aligned) block of Transport Packets, read all at once
+  unsigned long fCurrentBlockNum; // corresponding to data currently in the buffer
+  unsigned fCurrentBlockSize; // in bytes
+  Boolean fIsReadingBlock;
+  unsigned long fReadingBlockNum;
+  unsigned fNumBlockBytesRead;
+  unsigned fNumDeliveries;
   unsigned long fDesiredTSPacketNum;
   u_int8_t fDesiredDataOffset, fDesiredDataSize;
   float fDesiredDataPCR, fFirstPCR;
@@ -148,6 +148,8 @@ public:
 
   MediaLookupTable *mediaTable;
   void *socketTable;
+  void *tlsTable;
+  class PoolAllocator *poolAllocator;
 
 protected:
   _Tables(UsageEnvironment &env);
@@ -69,13 +69,14 @@ public:
 
   char* connectionEndpointName() const { return fConnectionEndpointName; }
   char const* CNAME() const { return fCNAME; }
-  struct in_addr const& sourceFilterAddr() const { return fSourceFilterAddr; }
+  struct sockaddr_storage const& sourceFilterAddr() const { return fSourceFilterAddr; }
   float& scale() { return fScale; }
   float& speed() { return fSpeed; }
   char* mediaSessionType() const { return fMediaSessionType; }
   char* sessionName() const { return fSessionName; }
   char* sessionDescription() const { return fSessionDescription; }
   char const* controlPath() const { return fControlPath; }
+  MIKEYState const* mikeyState() const { return fMIKEYState; } // from a session-level "a=key-mgmt:" line (if any)
 
   double& playStartTime() { return fMaxPlayStartTime; }
   double& playEndTime() { return fMaxPlayEndTime; }
@@ -110,6 +111,7 @@ protected:
   Boolean parseSDPAttribute_control(char const* sdpLine);
   Boolean parseSDPAttribute_range(char const* sdpLine);
   Boolean parseSDPAttribute_source_filter(char const* sdpLine);
+  Boolean parseSDPAttribute_key_mgmt(char const* sdpLine);
 
   static char* lookupPayloadFormat(unsigned char rtpPayloadType,
 				   unsigned& rtpTimestampFrequency,
@@ -131,13 +133,14 @@ protected:
   double fMaxPlayEndTime;
   char* fAbsStartTime;
   char* fAbsEndTime;
-  struct in_addr fSourceFilterAddr; // used for SSM
+  struct sockaddr_storage fSourceFilterAddr; // used for SSM
   float fScale; // set from a RTSP "Scale:" header
   float fSpeed;
   char* fMediaSessionType; // holds a=type value
   char* fSessionName; // holds s=<session name> value
   char* fSessionDescription; // holds i=<session description> value
   char* fControlPath; // holds optional a=control: string
+  MIKEYState* fMIKEYState; // SRTP keys, from an optional "a=key-mgmt:mikey ..." line
 };
 
 
@@ -162,12 +165,15 @@ public:
 
   unsigned short clientPortNum() const { return fClientPortNum; }
   unsigned char rtpPayloadFormat() const { return fRTPPayloadFormat; }
+  unsigned char fecPayloadFormat() const { return fFECPayloadFormat; } // 0 if the stream isn't protected by FEC
   char const* savedSDPLines() const { return fSavedSDPLines; }
   char const* mediumName() const { return fMediumName; }
   char const* codecName() const { return fCodecName; }
   char const* protocolName() const { return fProtocolName; }
   char const* controlPath() const { return fControlPath; }
-  Boolean isSSM() const { return fSourceFilterAddr.s_addr != 0; }
+  Boolean isSSM() const { return !addressIsNull(fSourceFilterAddr); }
+  Boolean usesSRTP() const { return fUsesSRTP; } // True iff the "m=" line's protocol is "RTP/SAVP"
+  SRTPCryptographicContext* srtpContext() const { return fSRTPContext; } // non-NULL (after "initiate()") iff SRTP is used
 
   unsigned short videoWidth() const { return fVideoWidth; }
   unsigned short videoHeight() const { return fVideoHeight; }
@@ -235,9 +241,12 @@ public:
   char const* fmtp_spropsps() const { return attrVal_str("sprop-sps"); }
   char const* fmtp_sproppps() const { return attrVal_str("sprop-pps"); }
 
+  void getConnectionEndpointAddress(struct sockaddr_storage& addr) const;
+      // Converts "fConnectionEndpointName" to an (IPv4 or IPv6) address (or a null address if unknown)
   netAddressBits connectionEndpointAddress() const;
-      // Converts "fConnectionEndpointName" to an address (or 0 if unknown)
-  void setDestinations(netAddressBits defaultDestAddress);
+      // Like the above, but returns 0 unless the address is IPv4
+  void setDestinations(struct sockaddr_storage const& defaultDestAddress);
+  void setDestinations(netAddressBits defaultDestAddress); // IPv4 version
       // Uses "fConnectionEndpointName" and "serverPortNum" to set
       // the destination address and port of the RTP and RTCP objects.
       // This is typically called by RTSP clients after doing "SETUP".
@@ -289,6 +298,7 @@ protected:
   Boolean parseSDPAttribute_source_filter(char const* sdpLine);
   Boolean parseSDPAttribute_x_dimensions(char const* sdpLine);
   Boolean parseSDPAttribute_framerate(char const* sdpLine);
+  Boolean parseSDPAttribute_key_mgmt(char const* sdpLine);
 
   virtual Boolean createSourceObjects(int useSpecialRTPoffset);
     // create "fRTPSource" and "fReadSource" member objects, after we've been initialized via SDP
@@ -303,6 +313,7 @@ protected:
   unsigned short fClientPortNum; // in host byte order
       // This field is also set by initiate()
   unsigned char fRTPPayloadFormat;
+  unsigned char fFECPayloadFormat; // set by an optional "a=rtpmap:<fmt> ulpfec/<freq>" line
   char* fSavedSDPLines;
   char* fMediumName;
   char* fCodecName;
@@ -310,7 +321,7 @@ protected:
   unsigned fRTPTimestampFrequency;
   Boolean fMultiplexRTCPWithRTP;
   char* fControlPath; // holds optional a=control: string
-  struct in_addr fSourceFilterAddr; // used for SSM
+  struct sockaddr_storage fSourceFilterAddr; // used for SSM
   unsigned fBandwidth; // in kilobits-per-second, from b= line
 
   double fPlayStartTime;
@@ -327,11 +338,14 @@ protected:
   float fSpeed;
   double fNPT_PTS_Offset; // set by "getNormalPlayTime()"; add this to a PTS to get NPT
   HashTable* fAttributeTable; // for "a=fmtp:" attributes.  (Later an array by payload type #####)
+  Boolean fUsesSRTP;
+  MIKEYState* fMIKEYState; // from an optional media-level "a=key-mgmt:" line; if NULL, the session's is used
 
   // Fields set or used by initiate():
   Groupsock* fRTPSocket; Groupsock* fRTCPSocket; // works even for unicast
   RTPSource* fRTPSource; RTCPInstance* fRTCPInstance;
   FramedSource* fReadSource;
+  SRTPCryptographicContext* fSRTPContext; // used by both "fRTPSource" and "fRTCPInstance"
   Boolean fReceiveRawMP3ADUs, fReceiveRawJPEGFrames;
 
   // Other fields:
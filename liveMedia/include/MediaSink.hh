@@ -164,6 +164,9 @@ public:
   /// @brief 跳过指定字节数，并且将fCurOffset移动相应字节数
   void skipBytes(unsigned numBytes);
 
+  /// @brief 返回首选数据包大小
+  unsigned preferredPacketSize() const { return fPreferred; }
+
   /// @brief 检查当前已经写好的缓冲区是否达到了首选数据包大小
   Boolean isPreferredSize() const { return fCurOffset >= fPreferred; }
 
@@ -45,6 +45,22 @@ public:
     fOnSendErrorData = onSendErrorFuncData;
   }
 
+  /// @brief 设置发包节奏控制（pacing），把一帧的RTP包分散到帧间隔的一部分时间内发送，而不是一次性突发
+  void setPacing(unsigned frameIntervalPercentage, unsigned maxBurstSize = 0, Boolean useKernelPacing = False);
+  // Paces outgoing packets (using a token bucket), so that even the largest recent frame's packets are spread over
+  // "frameIntervalPercentage"% of the interval between frames, rather than being sent back-to-back.  (The bucket's
+  // rate is recomputed after each frame.)  A "frameIntervalPercentage" of 0 (the default) means: no pacing.
+  // "maxBurstSize" is the bucket's depth: the number of bytes that may be sent back-to-back (0 means: 4 packets).
+  // If "useKernelPacing" is True, and the OS supports it (Linux's "SO_TXTIME", with the "fq" queueing discipline),
+  // then each packet is given to the kernel immediately, along with the time at which it should be transmitted.
+  // (Otherwise - or for RTP-over-TCP - we pace packets ourself, waking up once for each burst.)
+
+  static unsigned maxPacketsSentPerIteration;
+  // Packets that are due to be sent immediately (e.g., the later packets of a large frame) are built and sent in a
+  // loop, rather than each via a (zero-delay) scheduled task.  At most this many packets (default: 32) are sent
+  // before we return to the event loop, so that other sinks (and sockets) get a turn.  A value of 1 sends each
+  // packet from its own scheduled task.
+
 protected:
   /// @brief 所有参数都是用来构造RTPSink类的，调用RTPsink构造函数之后就设置自身变量的初始值，然后调用setPacketSizes初始化发送缓冲区类
   MultiFramedRTPSink(UsageEnvironment &env,
@@ -137,10 +153,20 @@ protected:
   /// @brief 返回当前RTP包的最大大小，以字节为单位 
   unsigned ourMaxPacketSize() const { return fOurMaxPacketSize; }
 
+  /// @brief 返回每个RTP包中RTP头部扩展的大小，以字节为单位（启用transport-wide拥塞控制时为8，否则为0）
+  unsigned headerExtensionSize() const { return fTransportCCExtensionId != 0 ? 8 : 0; }
+
 public: // redefined virtual functions:
   /// @brief 停止发送RTP数据包
   virtual void stopPlaying();
 
+  /// @brief 启用FEC；同时把RTP包的大小减小，使FEC包（比它保护的RTP包稍大）也不超过原来的最大包大小
+  virtual Boolean enableFEC(unsigned char fecPayloadType, unsigned numColumns, unsigned numRows = 1,
+                            Boolean rowFEC = True);
+
+  /// @brief 启用SRTP；同时把RTP包的大小减小，为认证标签留出空间
+  virtual Boolean setSRTPContext(SRTPCryptographicContext *srtpContext);
+
 protected: // redefined virtual functions:
   /// @brief 继续发送数据包
   virtual Boolean continuePlaying();
@@ -156,6 +182,9 @@ private:
   /// @brief 发送RTP数据包
   void sendPacketIfNecessary();
 
+  /// @brief 发送（刚发送的RTP包使之就绪的）FEC包
+  void sendFECPackets();
+
   static void sendNext(void *firstArg);
 
   friend void sendNext(void *);
@@ -171,6 +200,11 @@ private:
 
   static void ourHandleClosure(void *clientData);
 
+  // used to implement pacing:
+  void notePacingFrame(struct timeval presentationTime);
+  int64_t pacingDelay(int64_t timeNow);
+  void notePacketToBePaced(unsigned packetSize, int64_t timeNow);
+
 private:
   OutPacketBuffer *fOutBuf; // 用于管理RTP包的发送缓冲区。
 
@@ -184,13 +218,29 @@ private:
   unsigned fTimestampPosition;              // 记录时间戳的位置。用于确定在RTP包中存储时间戳的位置。
   unsigned fSpecialHeaderPosition;          // 记录特殊头部的位置。特殊头部是指紧随RTP头部后的特定格式的头部。
   unsigned fSpecialHeaderSize;              // 特殊头部的大小，以字节为单位
+  unsigned fHeaderExtensionSize;            // RTP头部扩展的大小，以字节为单位（启用transport-wide拥塞控制时为8，否则为0）
   unsigned fCurFrameSpecificHeaderPosition; // 记录当前帧特定头部的位置。帧特定头部是指在RTP包中每个帧之前的特定格式的头部。
   unsigned fCurFrameSpecificHeaderSize;     // 当前帧特定头部的大小，以字节为单位
   unsigned fTotalFrameSpecificHeaderSizes;  // 所有帧特定头部的总大小，以字节为单位。
   unsigned fOurMaxPacketSize;               // 当前RTP包的最大大小，以字节为单位
+  unsigned fRequestedPreferredPacketSize, fRequestedMaxPacketSize; // 传给"setPacketSizes()"的大小（未扣除FEC和SRTP的开销）
+
+  enum SendLoopState { SEND_LOOP_PACKET_PENDING, SEND_LOOP_PACKET_DUE, SEND_LOOP_DONE };
+  SendLoopState *fSendLoopState; // 若非NULL，则由"sendNext()"循环驱动：下一个包已到期时不再调度任务，而是在这里通知循环
 
   onSendErrorFunc *fOnSendErrorFunc; // 指向发送错误回调函数的指针。如果在发送RTP包时发生错误，会调用此回调函数。
   void *fOnSendErrorData;            // 与发送错误回调函数相关的用户数据。可以在回调函数中使用该数据。
+
+  // Pacing (see "setPacing()"):
+  unsigned fPacingPercentage;                     // 0 表示不做pacing
+  unsigned fPacingMaxBurstSize;                   // 令牌桶深度（字节）
+  Boolean fPacingUsesKernel;                      // 是否由内核（SO_TXTIME）按发送时间发包
+  double fPacingRate;                             // 令牌桶速率（字节/微秒）；0表示还无法估计
+  int64_t fPacingTAT;                             // 令牌桶的'theoretical arrival time'（微秒）
+  unsigned fPacingPeakFrameSize;                  // 最近的最大帧大小（字节，缓慢衰减）
+  unsigned fPacingCurFrameSize;                   // 当前帧已发送的字节数
+  unsigned fPacingFrameInterval;                  // 平滑后的帧间隔（微秒）
+  struct timeval fPacingCurFramePresentationTime; // 当前帧的呈现时间
 };
 
 #endif
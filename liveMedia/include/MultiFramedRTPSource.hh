@@ -66,6 +66,8 @@ private:
 
   static void networkReadHandler(MultiFramedRTPSource* source, int /*mask*/);
   void networkReadHandler1();
+  Boolean processIncomingPacket(BufferedPacket* bPacket, struct sockaddr_storage const& fromAddress, Boolean wasRecovered);
+      // Checks a received (or recovered) packet's RTP header, and stores it.  Returns False if it's not to be used.
 
   Boolean fAreDoingNetworkReads;
   BufferedPacket* fPacketReadInProgress;
@@ -91,7 +93,9 @@ public:
   Boolean hasUsableData() const { return fTail > fHead; }
   unsigned useCount() const { return fUseCount; }
 
-  Boolean fillInData(RTPInterface& rtpInterface, struct sockaddr_in& fromAddress, Boolean& packetReadWasIncomplete);
+  Boolean fillInData(RTPInterface& rtpInterface, struct sockaddr_storage& fromAddress, Boolean& packetReadWasIncomplete);
+  Boolean fillInData(unsigned char const* packet, unsigned packetSize); // used for packets recovered using FEC
+  Boolean unprotectData(RTPInterface& rtpInterface); // if SRTP is used; called once the packet has been read completely
   void assignMiscParams(unsigned short rtpSeqNo, unsigned rtpTimestamp,
 			struct timeval presentationTime,
 			Boolean hasBeenSyncedUsingRTCP,
@@ -34,6 +34,12 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _RTCP_HH
 #include "RTCP.hh"
 #endif
+#ifndef _POOL_ALLOCATOR_HH
+#include "PoolAllocator.hh"
+#endif
+#ifndef _SRTP_CRYPTOGRAPHIC_CONTEXT_HH
+#include "SRTPCryptographicContext.hh"
+#endif
 
 /// @brief 用于实现基于点播的流媒体服务器功能。
 class OnDemandServerMediaSubsession : public ServerMediaSubsession
@@ -46,7 +52,8 @@ protected: // we're a virtual base class
 
 protected: // redefined virtual functions
   /// @brief 返回SDP描述中媒体子会话的所有行。子类可以通过重定义这个函数来提供特定的SDP描述。
-  virtual char const *sdpLines();
+  /// @param addressFamily 客户端的地址族，决定"c="行使用IP4还是IP6
+  virtual char const *sdpLines(int addressFamily);
 
   /// @brief 主要就是通过下面的参数获取一个StreamState通过streamToken返回
   /// @param clientSessionId 客户端会话ID
@@ -63,13 +70,13 @@ protected: // redefined virtual functions
   /// @param serverRTCPPort 服务器的RTCP监听端口
   /// @param streamToken 用于存储表示媒体流的令牌。该参数将在函数内部被设置为媒体流的令牌，并将用于后续流传输操作<StreamState *>
   virtual void getStreamParameters(unsigned clientSessionId,
-                                   netAddressBits clientAddress,
+                                   struct sockaddr_storage const &clientAddress,
                                    Port const &clientRTPPort,
                                    Port const &clientRTCPPort,
                                    int tcpSocketNum,
                                    unsigned char rtpChannelId,
                                    unsigned char rtcpChannelId,
-                                   netAddressBits &destinationAddress,
+                                   struct sockaddr_storage &destinationAddress,
                                    u_int8_t &destinationTTL,
                                    Boolean &isMulticast,
                                    Port &serverRTPPort,
@@ -150,6 +157,14 @@ protected: // redefined virtual functions
   /// @param streamToken 用于存储表示媒体流的令牌。该参数将在函数内部被设置为媒体流的令牌，并将用于后续流传输操作<StreamState *>
   virtual FramedSource *getStreamSource(void *streamToken);
 
+  /// @brief  是否使用SRTP（即是否调用过"enableSRTP()"）
+  virtual Boolean usesSRTP() const;
+
+  /// @brief  生成该流的MIKEY消息（含该流的SSRC和当前的"rollover counter"），调用者负责delete[]
+  /// @param streamToken 表示媒体流的令牌<StreamState *>
+  /// @param messageSize 用于接收消息的大小
+  virtual u_int8_t *getMIKEYMessage(void *streamToken, unsigned &messageSize);
+
   /// @brief  获取RTP发送器和RTCP实例
   /// @param streamToken 用于存储表示媒体流的令牌。该参数将在函数内部被设置为媒体流的令牌，并将用于后续流传输操作<StreamState *>
   /// @param rtpSink  用于接收结果
@@ -199,10 +214,12 @@ protected: // new virtual functions, defined by all subclasses
   virtual RTPSink *createNewRTPSink(Groupsock *rtpGroupsock,
                                     unsigned char rtpPayloadTypeIfDynamic,
                                     FramedSource *inputSource) = 0;
+      // Note: "rtpGroupsock" may be NULL - if the client asked for RTP-over-TCP, we create no UDP sockets at all.
+      // Subclasses must then just pass it on to the new "RTPSink" (which handles NULL), and must not dereference it.
 
 protected: // new virtual functions, may be redefined by a subclass:
-  // 创建组播地址
-  virtual Groupsock *createGroupsock(struct in_addr const &addr, Port port);
+  // 创建组播地址（"addr"的地址族决定了套接字是IPv4还是IPv6）
+  virtual Groupsock *createGroupsock(struct sockaddr_storage const &addr, Port port);
 
   // 创建RTCP发送器
   virtual RTCPInstance *createRTCP(Groupsock *RTCPgs, unsigned totSessionBW, /* in kbps */
@@ -220,6 +237,28 @@ public:
   // handled by whatever handler existed when the client sent its first RTSP "PLAY" command.)
   // (Call with (NULL, NULL) to remove an existing handler - for future clients only)
 
+  /// @brief 为之后的每个RTP发送器启用拥塞控制（见"RTPRateController"）
+  void enableRateControl(unsigned minBitrate, unsigned maxBitrate /* kbps */, u_int8_t transportCCExtensionId = 0);
+  // Gives each future stream's "RTPSink" a "RTPRateController", which asks the stream's source to adapt its bitrate
+  // (in [minBitrate, maxBitrate]) to the receiver's available bandwidth.  If "transportCCExtensionId" (1-14) is nonzero,
+  // 'transport-wide congestion control' is also used (and offered in SDP); this must then be called before the
+  // subsession's SDP description is first requested.
+
+  /// @brief 为之后的每个RTP发送器启用前向纠错（FEC，见"RTPSink::enableFEC()"）
+  Boolean enableFEC(unsigned numColumns, unsigned numRows = 1, unsigned char fecPayloadType = 127);
+  // Makes each future stream's "RTPSink" also send RFC 5109 FEC packets, that protect each row of "numColumns" packets
+  // (and - if "numRows" > 1 - each column of a "numColumns"x"numRows" matrix of packets).  The FEC packets' payload type
+  // is offered in SDP, so this must be called before the subsession's SDP description is first requested.
+
+  /// @brief 为之后的每个流启用SRTP/SRTCP（密钥通过SDP中的MIKEY "a=key-mgmt:"行下发）
+  Boolean enableSRTP(MIKEYState::SRTPProfile profile = MIKEYState::AES_CM_128_HMAC_SHA1_80, Boolean encrypt = True);
+  // Makes each future stream use SRTP and SRTCP (RFC 3711), with a (random) master key that's offered - using MIKEY
+  // (RFC 4567) - in the subsession's SDP description (whose "m=" line then uses "RTP/SAVP").  If "encrypt" is False,
+  // packets are authenticated only.  This must be called before the subsession's SDP description is first requested.
+  // Note that the key is sent in the clear, so is secret only if the RTSP connection itself is protected.  (By default,
+  // "RTSPServer" therefore sends it only over TLS; see "RTSPServer::allowSRTPKeysWithoutTLS()".)
+  // Returns False (after setting "resultMsg") if SRTP isn't supported.
+
   /// @brief 发送自定义的RTCP "APP"包给客户端。
   void sendRTCPAppPacket(u_int8_t subtype, char const *name,
                          u_int8_t *appDependentData, unsigned appDependentDataSize);
@@ -236,8 +275,17 @@ private:
   void setSDPLinesFromRTPSink(RTPSink *rtpSink, FramedSource *inputSource,
                               unsigned estBitrate);
 
+  // used to implement "getStreamParameters()"
+  Boolean createServerGroupsocks(int addressFamily, Boolean separateRTCPPort, Port &serverRTPPort, Port &serverRTCPPort,
+                                 Groupsock *&rtpGroupsock, Groupsock *&rtcpGroupsock);
+  // Returns True iff the port numbers were taken from the "ServerPortAllocator"s pool
+  Boolean createServerGroupsocks1(int addressFamily, portNumBits serverPortNum, Boolean separateRTCPPort,
+                                  Port &serverRTPPort, Port &serverRTCPPort,
+                                  Groupsock *&rtpGroupsock, Groupsock *&rtcpGroupsock);
+
 protected:
   char *fSDPLines;                   // 用于存储SDP（Session Description Protocol）行的指针，初始值为NULL
+  char *fSDPLinesIPv6;               // 同上，但"c="行为IPv6地址（用于IPv6客户端）
   HashTable *fDestinationsHashTable; // 用于存储客户端会话ID对应的目标地址。当客户端请求连接并接收媒体流时，服务器将使用该哈希表来跟踪每个客户端的地址信息
 
 private:
@@ -248,6 +296,11 @@ private:
   char fCNAME[100];                    // for RTCP
   RTCPAppHandlerFunc *fAppHandlerTask; // 用于处理应用程序特定的任务和客户端数据
   void *fAppHandlerClientData;         // RTCPAppHandlerFunc参数
+  unsigned fRateControlMinBitrate, fRateControlMaxBitrate; // kbps; fRateControlMaxBitrate == 0 means 'no rate control'
+  u_int8_t fTransportCCExtensionId;
+  unsigned fFECNumColumns, fFECNumRows; // fFECNumColumns == 0 means 'no FEC'
+  unsigned char fFECPayloadType;
+  MIKEYState *fMIKEYState; // NULL means 'no SRTP'
   friend class StreamState;
 };
 
@@ -255,10 +308,10 @@ private:
 // "OnDemandServerMediaSubsession", but we expose the definition here, in case subclasses of "OnDemandServerMediaSubsession"
 //  want to access it.
 // 它用于存储RTP/RTCP传输的目标地址和端口信息，以及TCP相关信息（如果使用TCP传输）。
-class Destinations
+class Destinations : public PoolAllocatedObject
 {
 public:
-  Destinations(struct in_addr const &destAddr,
+  Destinations(struct sockaddr_storage const &destAddr,
                Port const &rtpDestPort,
                Port const &rtcpDestPort)
       : isTCP(False), addr(destAddr), rtpPort(rtpDestPort), rtcpPort(rtcpDestPort)
@@ -272,7 +325,7 @@ public:
 
 public:
   Boolean isTCP;               // 用于指示目标地址的传输方式是TCP还是UDP
-  struct in_addr addr;         // 表示目标IP地址
+  struct sockaddr_storage addr; // 表示目标IP地址（IPv4或IPv6）
   Port rtpPort;                // RTP数据包的目标端口
   Port rtcpPort;               // RTCP数据包的目标端口
   int tcpSocketNum;            // TCP传输的套接字号
@@ -284,14 +337,18 @@ public:
 // StreamState 类的主要目的是管理特定流媒体会话的状态和参数，以支持流媒体服务器在多个会话中同时处理多个客户端请求。
 // 通过跟踪引用计数，可以确保在不再需要时及时释放资源，提高流媒体服务器的效率。
 // 同时，通过管理RTP和RTCP传输相关信息，可以确保媒体数据正确地传送给客户端，并实现RTCP协议的状态管理。
-class StreamState
+class StreamState : public PoolAllocatedObject
 {
 public:
   StreamState(OnDemandServerMediaSubsession &master,
               Port const &serverRTPPort, Port const &serverRTCPPort,
               RTPSink *rtpSink, BasicUDPSink *udpSink,
               unsigned totalBW, FramedSource *mediaSource,
-              Groupsock *rtpGS, Groupsock *rtcpGS);
+              Groupsock *rtpGS, Groupsock *rtcpGS, Boolean serverPortsArePooled = False,
+              SRTPCryptographicContext *srtpContext = NULL);
+  // "serverPortsArePooled" means that the port numbers came from the "ServerPortAllocator", and are returned to it
+  // when the stream is reclaimed.  "srtpContext" (if non-NULL) is used by the stream's RTP sink and RTCP instance, and
+  // is deleted when the stream is reclaimed
   virtual ~StreamState();
 
   /// @brief 用于开始播放流 called by OnDemandServerMediaSubsession::startStream
@@ -340,9 +397,15 @@ public:
   /// @brief 返回RTCP发送器(RTCPInstance)
   RTCPInstance *rtcpInstance() const { return fRTCPInstance; }
 
+  /// @brief 返回RTP传输的套接字(如果只通过TCP传输，则为NULL)
+  Groupsock *rtpGroupsock() const { return fRTPgs; }
+
   /// @brief 返回流的总时长
   float streamDuration() const { return fStreamDuration; }
 
+  /// @brief 返回RTP和RTCP共用的SRTP加密上下文（NULL表示不使用SRTP）
+  SRTPCryptographicContext *srtpContext() const { return fSRTPContext; }
+
   /// @brief 返回指向媒体源（FramedSource）的指针，用于提供媒体数据。
   FramedSource *mediaSource() const { return fMediaSource; }
 
@@ -356,6 +419,7 @@ private:
 
   Port fServerRTPPort;  // RTP传输的服务器端口号
   Port fServerRTCPPort; // RTCP传输的服务器端口号
+  Boolean fServerPortsArePooled; // 端口号是否来自"ServerPortAllocator"的端口池（回收时归还）
 
   RTPSink *fRTPSink;      // RTP媒体传输器
   BasicUDPSink *fUDPSink; // UDP媒体传输器
@@ -369,6 +433,8 @@ private:
 
   Groupsock *fRTPgs;  // RTP传输的组播套接字
   Groupsock *fRTCPgs; // RTCP传输的组播套接字
+
+  SRTPCryptographicContext *fSRTPContext; // RTP和RTCP共用的SRTP加密上下文（NULL表示不使用SRTP）
 };
 
 #endif
@@ -0,0 +1,97 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A per-environment, size-class memory pool, used for small objects that get created and deleted often
+// (e.g., for each RTSP session).
+// C++ header
+
+#ifndef _POOL_ALLOCATOR_HH
+#define _POOL_ALLOCATOR_HH
+
+#ifndef _BOOLEAN_HH
+#include "Boolean.hh"
+#endif
+#ifndef _USAGE_ENVIRONMENT_HH
+#include "UsageEnvironment.hh"
+#endif
+
+#include <stddef.h>
+
+// Block sizes are powers of 2, from 1<<POOL_ALLOCATOR_MIN_SIZE_SHIFT to 1<<POOL_ALLOCATOR_MAX_SIZE_SHIFT bytes.
+// Larger requests are passed straight through to the system allocator.
+#define POOL_ALLOCATOR_MIN_SIZE_SHIFT 5
+#define POOL_ALLOCATOR_MAX_SIZE_SHIFT 15
+#define POOL_ALLOCATOR_NUM_SIZE_CLASSES (POOL_ALLOCATOR_MAX_SIZE_SHIFT - POOL_ALLOCATOR_MIN_SIZE_SHIFT + 1)
+// Up to this many bytes of free blocks are kept (for reuse) in each size class; any more are freed:
+#define POOL_ALLOCATOR_MAX_FREE_BYTES_PER_CLASS (256*1024)
+
+union PoolBlockHeader; // forward
+
+// There is one pool per "UsageEnvironment" (and thus per event loop), so - like the rest of "liveMedia" - it
+// does no locking.  A block must be freed in the same thread (event loop) that allocated it.
+class PoolAllocator {
+public:
+  static PoolAllocator& forEnvironment(UsageEnvironment& env); // creates the pool if necessary
+
+  void* allocate(size_t size);
+  static void* allocateFromHeap(size_t size);
+      // Allocates a block that belongs to no pool, but that can still be freed by "deallocate()"
+  static void deallocate(void* ptr);
+      // "ptr" must have been returned by "allocate()" (in any pool) or by "allocateFromHeap()", or be NULL
+
+  void releaseFreeBlocks(); // returns all currently unused blocks to the system allocator
+
+  // Allocation counters:
+  unsigned long numAllocations() const { return fNumAllocations; }
+  unsigned long numDeallocations() const { return fNumDeallocations; }
+  unsigned long numAllocationsFromPool() const { return fNumAllocationsFromPool; }
+      // i.e., the number of allocations that reused a free block, rather than calling the system allocator
+  unsigned numBlocksInUse() const { return (unsigned)(fNumAllocations - fNumDeallocations); }
+  size_t numBytesInUse() const { return fNumBytesInUse; }
+  size_t numBytesInFreeBlocks() const { return fNumBytesInFreeBlocks; }
+
+private:
+  friend class _Tables;
+  PoolAllocator(UsageEnvironment& env);
+  virtual ~PoolAllocator();
+
+  void deallocate1(PoolBlockHeader* block);
+
+private:
+  UsageEnvironment& fEnv;
+  PoolBlockHeader* fFreeBlocks[POOL_ALLOCATOR_NUM_SIZE_CLASSES];
+  unsigned fNumFreeBlocks[POOL_ALLOCATOR_NUM_SIZE_CLASSES];
+  unsigned long fNumAllocations, fNumDeallocations, fNumAllocationsFromPool;
+  size_t fNumBytesInUse, fNumBytesInFreeBlocks;
+};
+
+// A base class for small internal objects that are created and deleted often.  Such objects are created using
+// "new (env) ClassName(...)", and are allocated from "env"'s "PoolAllocator".  They are deleted normally.
+// (A plain "new ClassName(...)" - e.g., in existing code that doesn't know about the pool - also works; the object is
+// then allocated from the heap.)
+class PoolAllocatedObject {
+public:
+  static void* operator new(size_t size, UsageEnvironment& env) {
+    return PoolAllocator::forEnvironment(env).allocate(size);
+  }
+  static void* operator new(size_t size) { return PoolAllocator::allocateFromHeap(size); }
+  static void operator delete(void* ptr, UsageEnvironment& /*env*/) { PoolAllocator::deallocate(ptr); }
+      // (called only if a constructor throws an exception)
+  static void operator delete(void* ptr) { PoolAllocator::deallocate(ptr); }
+};
+
+#endif
@@ -66,6 +66,13 @@ private:
   void scheduleDESCRIBECommand();
   static void sendDESCRIBE(void* clientData);
 
+  // Used only if our "ProxyServerMediaSession" connects to the back-end server 'on demand':
+  void noteFrontEndDESCRIBE();
+  void noteFrontEndSETUP();
+  void scheduleIdleTeardown();
+  static void doIdleTeardown(void* clientData);
+  void doIdleTeardown();
+
   static void subsessionTimeout(void* clientData);
   void handleSubsessionTimeout();
 
@@ -80,7 +87,8 @@ private:
   unsigned fNumSetupsDone;
   unsigned fNextDESCRIBEDelay; // in seconds
   Boolean fServerSupportsGetParameter, fLastCommandWasPLAY, fDoneDESCRIBE;
-  TaskToken fLivenessCommandTask, fDESCRIBECommandTask, fSubsessionTimerTask, fResetTask;
+  Boolean fBackEndIsIdle; // True iff we've closed our connection to the back-end server, because no front-end client needs it
+  TaskToken fLivenessCommandTask, fDESCRIBECommandTask, fSubsessionTimerTask, fResetTask, fIdleTeardownTask;
 };
 
 
@@ -108,11 +116,17 @@ public:
 					        // for streaming the *proxied* (i.e., back-end) stream
 					    int verbosityLevel = 0,
 					    int socketNumToServer = -1,
-					    MediaTranscodingTable* transcodingTable = NULL);
+					    MediaTranscodingTable* transcodingTable = NULL,
+					    unsigned backEndIdleTimeoutSeconds = 0);
       // Hack: "tunnelOverHTTPPortNum" == 0xFFFF (i.e., all-ones) means: Stream RTP/RTCP-over-TCP, but *not* using HTTP
       // "verbosityLevel" == 1 means display basic proxy setup info; "verbosityLevel" == 2 means display RTSP client protocol also.
       // If "socketNumToServer" is >= 0, then it is the socket number of an already-existing TCP connection to the server.
       //      (In this case, "inputStreamURL" must point to the socket's endpoint, so that it can be accessed via the socket.)
+      // If "backEndIdleTimeoutSeconds" is > 0, then we connect to the back-end server only 'on demand': After the initial
+      //      "DESCRIBE", we keep its SDP description (to answer front-end "DESCRIBE"s), and close our connection to the back-end
+      //      server once it has had no front-end clients for this many seconds.  A later front-end "DESCRIBE" or "SETUP"
+      //      reopens the connection, and goes straight to "SETUP" (using the cached track URLs and transport), without a new
+      //      "DESCRIBE".  (This is not done if "socketNumToServer" is >= 0, because we could not then reopen the connection.)
 
   virtual ~ProxyServerMediaSession();
 
@@ -134,7 +148,8 @@ protected:
 			  createNewProxyRTSPClientFunc* ourCreateNewProxyRTSPClientFunc
 			  = defaultCreateNewProxyRTSPClientFunc,
 			  portNumBits initialPortNum = 6970,
-			  Boolean multiplexRTCPWithRTP = False);
+			  Boolean multiplexRTCPWithRTP = False,
+			  unsigned backEndIdleTimeoutSeconds = 0);
 
   // If you subclass "ProxyRTSPClient", then you will also need to define your own function
   // - with signature "createNewProxyRTSPClientFunc" (see above) - that creates a new object
@@ -145,7 +160,7 @@ protected:
 
   // Subclasses may redefine the following functions, if they want "ProxyServerSubsession"s
   // to create subclassed "Groupsock" and/or "RTCPInstance" objects:
-  virtual Groupsock* createGroupsock(struct in_addr const& addr, Port port);
+  virtual Groupsock* createGroupsock(struct sockaddr_storage const& addr, Port port);
   virtual RTCPInstance* createRTCP(Groupsock* RTCPgs, unsigned totSessionBW, /* in kbps */
 				   unsigned char const* cname, RTPSink* sink);
 
@@ -172,6 +187,7 @@ private:
   MediaTranscodingTable* fTranscodingTable;
   portNumBits fInitialPortNum;
   Boolean fMultiplexRTCPWithRTP;
+  unsigned fBackEndIdleTimeoutSeconds; // 0 means: stay connected to the back-end server (i.e., not 'on demand')
 };
 
 
@@ -37,7 +37,13 @@ public:
 				      Boolean packetLossCompensate = False,
 				      Boolean syncStreams = False,
 				      Boolean generateHintTracks = False,
-				      Boolean generateMP4Format = False);
+				      Boolean generateMP4Format = False,
+				      unsigned fragmentDurationMS = 0);
+  // If "fragmentDurationMS" is non-zero, then a 'fragmented' MP4 file is generated: The file's metadata
+  // ("moov" atom) is written at the start, and the media data is then written in 'fragments' ("moof"+"mdat"
+  // atoms) of (approximately) this duration.  Memory usage therefore does not grow with the length of the
+  // recording, and the file remains playable (up to its last complete fragment) even if it's not closed
+  // properly.  (This implies "generateMP4Format", and is incompatible with "generateHintTracks".)
 
   typedef void (afterPlayingFunc)(void* clientData);
   Boolean startPlaying(afterPlayingFunc* afterFunc,
@@ -51,7 +57,7 @@ protected:
 		    unsigned short movieWidth, unsigned short movieHeight,
 		    unsigned movieFPS, Boolean packetLossCompensate,
 		    Boolean syncStreams, Boolean generateHintTracks,
-		    Boolean generateMP4Format);
+		    Boolean generateMP4Format, unsigned fragmentDurationMS);
       // called only by createNew()
   virtual ~QuickTimeFileSink();
 
@@ -69,6 +75,11 @@ private:
   static void onRTCPBye(void* clientData);
   void completeOutputFile();
 
+  // Used only when generating a fragmented MP4 file:
+  Boolean shouldStartNewFragment(class SubsessionIOState& track, Boolean isSyncSample);
+  void writeFragment();
+  void writeFragmentedFileHeader();
+
 private:
   friend class SubsessionIOState;
   MediaSession& fInputSession;
@@ -86,6 +97,14 @@ private:
   struct timeval fStartTime;
   Boolean fHaveCompletedOutputFile;
 
+  // Used only when generating a fragmented MP4 file:
+  unsigned fFragmentDurationMS; // 0 iff we're not generating a fragmented MP4 file
+  Boolean fHaveWrittenFragmentedFileHeader;
+  unsigned fFragmentSequenceNumber;
+  Boolean fHaveFragmentEpoch;
+  struct timeval fFragmentEpoch; // the presentation time that corresponds to media time 0 (in each track)
+  class SubsessionIOState* fFragmentClockTrack; // the track whose duration (and sync samples) determine fragments
+
 private:
   ///// Definitions specific to the QuickTime file format:
 
@@ -103,6 +122,7 @@ private:
   unsigned addAtomHeader(char const* atomName);
   unsigned addAtomHeader64(char const* atomName);
       // strlen(atomName) must be 4
+  unsigned addEmptySampleTableAtom(char const* atomName); // used for fragmented MP4 files
   void setWord(int64_t filePosn, unsigned size);
   void setWord64(int64_t filePosn, u_int64_t size);
 
@@ -113,6 +133,8 @@ private:
   _atom(ftyp); // for MP4 format files
   _atom(moov);
       _atom(mvhd);
+      _atom(mvex); // for fragmented MP4 files
+          _atom(trex);
   _atom(iods); // for MP4 format files
       _atom(trak);
           _atom(tkhd);
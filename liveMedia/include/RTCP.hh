@@ -87,12 +87,17 @@ public:
       // (respectively) arrives.  Unlike "setByeHandler()", the handler will
       // be called once for each incoming "SR" or "RR".  (To turn off handling,
       // call the function again with "handlerTask" (and "clientData") as NULL.)
-  void setSpecificRRHandler(netAddressBits fromAddress, Port fromPort,
+  void setSpecificRRHandler(struct sockaddr_storage const& fromAddress, Port fromPort,
 			    TaskFunc* handlerTask, void* clientData);
       // Like "setRRHandler()", but applies only to "RR" packets that come from
       // a specific source address and port.  (Note that if both a specific
       // and a general "RR" handler function is set, then both will be called.)
-  void unsetSpecificRRHandler(netAddressBits fromAddress, Port fromPort); // equivalent to setSpecificRRHandler(..., NULL, NULL);
+  void unsetSpecificRRHandler(struct sockaddr_storage const& fromAddress, Port fromPort); // equivalent to setSpecificRRHandler(..., NULL, NULL);
+  // Versions of the above for IPv4 addresses.  (These are also used - with the TCP socket number as "fromAddress", and
+  // the RTCP channel id as "fromPort" - for RTCP-over-TCP.)
+  void setSpecificRRHandler(netAddressBits fromAddress, Port fromPort,
+			    TaskFunc* handlerTask, void* clientData);
+  void unsetSpecificRRHandler(netAddressBits fromAddress, Port fromPort);
   void setAppHandler(RTCPAppHandlerFunc* handlerTask, void* clientData);
       // Assigns a handler routine to be called whenever an "APP" packet arrives.  (To turn off
       // handling, call the function again with "handlerTask" (and "clientData") as NULL.)
@@ -113,13 +118,18 @@ public:
   }
     // hacks to allow sending RTP over TCP (RFC 2236, section 10.12)
 
+  void setSRTPContext(SRTPCryptographicContext* srtpContext) {
+    fRTCPInterface.setSRTPContext(srtpContext);
+  }
+    // Protects our outgoing - and authenticates our incoming - RTCP packets using SRTCP.  ("srtpContext" is not owned by us.)
+
   void setAuxilliaryReadHandler(AuxHandlerFunc* handlerFunc,
                                 void* handlerClientData) {
     fRTCPInterface.setAuxilliaryReadHandler(handlerFunc,
 					    handlerClientData);
   }
 
-  void injectReport(u_int8_t const* packet, unsigned packetSize, struct sockaddr_in const& fromAddress);
+  void injectReport(u_int8_t const* packet, unsigned packetSize, struct sockaddr_storage const& fromAddress);
     // Allows an outside party to inject an RTCP report (from other than the network interface)
 
 protected:
@@ -130,7 +140,7 @@ protected:
       // called only by createNew()
   virtual ~RTCPInstance();
 
-  virtual void noteArrivingRR(struct sockaddr_in const& fromAddressAndPort,
+  virtual void noteArrivingRR(struct sockaddr_storage const& fromAddressAndPort,
 			      int tcpSocketNum, unsigned char tcpStreamChannelId);
 
   void incomingReportHandler1();
@@ -156,7 +166,7 @@ private:
   void onExpire1();
 
   static void incomingReportHandler(RTCPInstance* instance, int /*mask*/);
-  void processIncomingReport(unsigned packetSize, struct sockaddr_in const& fromAddressAndPort,
+  void processIncomingReport(unsigned packetSize, struct sockaddr_storage const& fromAddressAndPort,
 			     int tcpSocketNum, unsigned char tcpStreamChannelId);
   void onReceive(int typeOfPacket, int totPacketSize, u_int32_t ssrc);
 
@@ -29,6 +29,17 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _GROUPSOCK_HH
 #include "Groupsock.hh"
 #endif
+#ifndef _SRTP_CRYPTOGRAPHIC_CONTEXT_HH
+#include "SRTPCryptographicContext.hh"
+#endif
+#ifndef _TLS_STATE_HH
+#include "TLSState.hh"
+#endif
+
+// The size of the '$<streamChannelId><packetSize>' header that precedes each RTP or RTCP packet sent over TCP
+// (RFC 2326, section 10.12).  Our own sinks' buffers have this much room before each packet, so that - with TLS - the
+// header and packet can be encrypted together, without copying.  (See "RTPInterface::sendPacketInPlace()".)
+#define RTP_TCP_FRAMING_HEADER_SIZE 4
 
 // Typedef for an optional auxilliary handler function, to be called
 // when each new packet is read:
@@ -63,6 +74,8 @@ class RTPInterface
 {
 public:
   RTPInterface(Medium *owner, Groupsock *gs);
+  // "gs" may be NULL, for an interface that's used only over TCP (i.e., via "setStreamSocket()" or
+  // "addStreamSocket()"); it then uses no UDP socket at all.
   virtual ~RTPInterface();
 
   /// @brief 返回与该RTP接口关联的Groupsock对象
@@ -91,11 +104,24 @@ public:
   /// @brief  根据套接字 socketNum从SocketTable中查找到对应的SocketDescriptor，并且清除fServerRequestAlternativeByteHandler和fServerRequestAlternativeByteHandlerClientData
   static void clearServerRequestAlternativeByteHandler(UsageEnvironment &env, int socketNum);
 
+  /// @brief 设置SRTP加密上下文（不由本对象拥有）；NULL表示不使用SRTP
+  void setSRTPContext(SRTPCryptographicContext *srtpContext) { fSRTPContext = srtpContext; }
+  SRTPCryptographicContext *srtpContext() const { return fSRTPContext; }
+  // If set, each outgoing packet is protected (using SRTP or SRTCP, depending on its payload type; see RFC 5761) before
+  // it's sent.  Incoming packets are unprotected - once they've been read completely - by "unprotectIncomingPacket()".
+
   /// @brief 发送数据包给对应的组播成员以及发送数据包给tcp连接
   /// @param packet 需要发送的数据包
   /// @param packetSize 需要发送数据包的大小
   /// @return success true，failed false
   Boolean sendPacket(unsigned char *packet, unsigned packetSize);
+  // "packet" is not modified.  (If it has to be encrypted - by SRTP, or for a TCP connection that uses TLS (see
+  // "TLSState") - then a copy is.)
+
+  /// @brief 若设置了SRTP上下文，则对一个完整读取的包进行认证和解密（就地）；认证失败时返回False
+  Boolean unprotectIncomingPacket(unsigned char *packet, unsigned &packetSize);
+  // Called - by our owner - on each complete packet that "handleRead()" has read (perhaps in several parts, if over
+  // TCP).  Returns False if the packet should be discarded.
 
   /// @brief 将tcp连接，和udp组播成员均加入到select中，并设置读事件监听
   /// @param handlerProc udp读数据的回调函数
@@ -112,7 +138,7 @@ public:
   /// @param packetReadWasIncomplete  是否完全读取
   Boolean handleRead(unsigned char *buffer, unsigned bufferMaxSize,
                      // out parameters:
-                     unsigned &bytesRead, struct sockaddr_in &fromAddress,
+                     unsigned &bytesRead, struct sockaddr_storage &fromAddress,
                      int &tcpSocketNum, unsigned char &tcpStreamChannelId,
                      Boolean &packetReadWasIncomplete);
   // Note: If "tcpSocketNum" < 0, then the packet was received over UDP, and "tcpStreamChannelId"
@@ -140,10 +166,24 @@ public:
   void forgetOurGroupsock() { fGS = NULL; }
 
 private:
+  // Used (instead of "sendPacket()") by our own sinks, whose buffers have room around each packet:
+  friend class MultiFramedRTPSink;
+  friend class RTCPInstance;
+  /// @brief 同sendPacket()，但（若有SRTP上下文）就地加密数据包，以避免复制
+  Boolean sendPacketInPlace(unsigned char *packet, unsigned packetSize);
+  // If we have a SRTP context, the packet is encrypted in place, so its contents are undefined afterwards, and
+  // "packet" must have "SRTP_MAX_TRAILER_SIZE" bytes of room after it.  "packet" must also have
+  // "RTP_TCP_FRAMING_HEADER_SIZE" bytes of room before it.  (The bytes before and after the packet are left unchanged.)
+
+  Boolean sendPacket1(unsigned char *packet, unsigned packetSize, Boolean packetHasRoom);
+  u_int8_t *stagingBuffer(unsigned packetSize);
+      // returns a buffer for a copy of a "packetSize"-byte packet, with the room that "sendPacketInPlace()" needs
+
   // Helper functions for sending a RTP or RTCP packet over a TCP connection:
-  Boolean sendRTPorRTCPPacketOverTCP(unsigned char *packet, unsigned packetSize,
+  Boolean sendRTPorRTCPPacketOverTCP(unsigned char *packet, unsigned packetSize, Boolean packetHasRoom,
                                      int socketNum, unsigned char streamChannelId);
-  Boolean sendDataOverTCP(int socketNum, u_int8_t const *data, unsigned dataSize, Boolean forceSendToSucceed);
+  Boolean sendDataOverTCP(int socketNum, TLSState *tlsState,
+                          u_int8_t const *header, unsigned headerSize, u_int8_t const *data, unsigned dataSize);
 
 private:
   friend class SocketDescriptor;
@@ -159,6 +199,11 @@ private:
 
   AuxHandlerFunc *fAuxReadHandlerFunc; // 指向辅助读取处理器函数（AuxHandlerFunc）的指针。用于设置辅助读取数据时的回调函数
   void *fAuxReadHandlerClientData;     // 指向辅助读取处理器函数的客户数据（client data）的指针。用于传递给辅助读取处理器函数的附加数据。
+
+  SRTPCryptographicContext *fSRTPContext; // 若非NULL，则用SRTP/SRTCP保护收发的包（不由本对象拥有）
+
+  u_int8_t *fStagingBuffer; // 需要加密（或与TCP帧头连续发送）的数据包副本所用的缓冲区；按需分配
+  unsigned fStagingBufferSize;
 };
 
 #endif
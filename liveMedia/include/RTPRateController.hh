@@ -0,0 +1,121 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// Congestion control for a "RTPSink": Estimates the bandwidth that's available to the sink's receivers - from the
+// loss and round-trip time reported in RTCP "RR"s, and (optionally) from 'transport-wide congestion control' feedback -
+// and asks the sink's source to adapt its bitrate to this.
+// C++ header
+
+#ifndef _RTP_RATE_CONTROLLER_HH
+#define _RTP_RATE_CONTROLLER_HH
+
+#ifndef _RTP_SINK_HH
+#include "RTPSink.hh"
+#endif
+
+// The estimate is made the same way as in 'Google Congestion Control' (draft-ietf-rmcat-gcc):
+// - A loss-based estimate is decreased when a receiver reports more than 10% loss, and is increased when all
+//   receivers report less than 2% loss (unless the round-trip time shows that a queue is building up).
+// - If 'transport-wide congestion control' is enabled, each RTP packet also carries a transport-wide sequence number
+//   (in a RTP header extension), and the receiver reports the arrival time of each packet (in RTCP "RTPFB" packets).
+//   From this, a delay-based estimate is made: It's decreased as soon as the packets' one-way delay starts to grow
+//   (before any loss occurs), and otherwise is increased.
+//   The loss-based estimate is then also updated (about once per second) from the loss that this feedback shows.
+// The target bitrate is the smaller of these estimates, within [minBitrate, maxBitrate].  Whenever it changes
+// significantly, it's passed to the sink's source, using "FramedSource::setTargetBitrate()".
+//
+// Note that RTCP "RR"s are typically sent only every few seconds, so the loss-based estimate reacts slowly.
+// For quick reaction to congestion, the receiver should support 'transport-wide congestion control'.
+
+class RTPRateController: public Medium {
+public:
+  static RTPRateController* createNew(UsageEnvironment& env, RTPSink* sink,
+				      unsigned minBitrate, unsigned startBitrate, unsigned maxBitrate, /* all in kbps */
+				      u_int8_t transportCCExtensionId = 0);
+      // If "transportCCExtensionId" (1-14) is nonzero, the sink's RTP packets will carry a transport-wide sequence
+      // number, in a RTP header extension with this id.  (The receiver must be told about this - e.g., in SDP.)
+      // The "RTPRateController" is closed automatically when "sink" is.  It should be created before "sink" starts
+      // playing, because some sinks size their packets' payload (once) when they start.
+
+  unsigned targetBitrate() const { return fTargetBitrate; } // kbps
+  unsigned lossBasedBitrate() const { return fLossBasedBitrate; } // kbps
+  unsigned delayBasedBitrate() const { return fDelayBasedBitrate; } // kbps; 0 if no transport-wide feedback yet
+  unsigned roundTripTime() const { return fRTTMSecs; } // milliseconds; 0 if not yet known
+
+protected:
+  RTPRateController(UsageEnvironment& env, RTPSink* sink,
+		    unsigned minBitrate, unsigned startBitrate, unsigned maxBitrate,
+		    u_int8_t transportCCExtensionId);
+      // called only by createNew()
+  virtual ~RTPRateController();
+
+private:
+  // called by our sink, and by "RTCPInstance":
+  friend class MultiFramedRTPSink;
+  friend class RTPTransmissionStatsDB;
+  friend class RTCPInstance;
+  void notePacketSent(u_int16_t transportSeqNum, unsigned packetSize, int64_t sendTimeUSecs);
+  void noteReceiverReport();
+  void noteTransportCCFeedback(u_int8_t const* fci, unsigned fciSize);
+
+private:
+  void processArrivedPacket(int64_t sendTimeUSecs, int64_t arrivalTimeUSecs, unsigned packetSize);
+  void noteDelayGradient(double deltaMSecs, double arrivalTimeMSecs, double interDepartureMSecs);
+  void updateLossBasedBitrate(double lossFraction, int64_t timeNow);
+  void updateDelayBasedBitrate(int bandwidthUsage, int64_t timeNow);
+  void updateTargetBitrate();
+
+private:
+  RTPSink* fSink;
+  unsigned fMinBitrate, fMaxBitrate; // kbps
+  double fLossBasedBitrateD, fDelayBasedBitrateD; // kbps
+  unsigned fLossBasedBitrate, fDelayBasedBitrate, fTargetBitrate, fLastNotifiedBitrate; // kbps
+  int64_t fLastLossBasedUpdateTime;
+  unsigned fRTTMSecs, fMinRTTMSecs;
+
+  // The rate at which we're sending (used to cap increases, if our source isn't using all of its target bitrate):
+  unsigned fBytesSentSinceLastReport;
+  int64_t fLastReportTime;
+  unsigned fSendingBitrate; // kbps; 0 if not yet known
+
+  // Transport-wide congestion control:
+  u_int8_t fTransportCCExtensionId;
+  struct SentPacket { u_int16_t seqNum; u_int16_t size; int64_t sendTime; };
+  SentPacket* fSentPackets; // a ring buffer, indexed by (transport-wide) sequence number
+  // The current and previous 'packet groups' (packets sent within a 5 ms burst):
+  int64_t fGroupFirstSendTime, fGroupLastSendTime, fGroupLastArrivalTime;
+  int64_t fPrevGroupLastSendTime, fPrevGroupLastArrivalTime;
+  Boolean fHaveGroup, fHavePrevGroup;
+  // The 'trendline' filter, and over-use detector:
+  double fAccumulatedDelay, fSmoothedDelay, fFirstArrivalTimeMSecs;
+  enum { TRENDLINE_WINDOW_SIZE = 20 };
+  double fTrendlineX[TRENDLINE_WINDOW_SIZE], fTrendlineY[TRENDLINE_WINDOW_SIZE];
+  unsigned fTrendlineNumSamples, fNumDeltas;
+  double fPrevTrend, fThreshold, fTimeOverUsing;
+  unsigned fOverUseCounter;
+  double fLastThresholdUpdateMSecs;
+  int fBandwidthUsage; // the most recent signal from the over-use detector
+  // The rate at which feedback shows that packets are arriving:
+  unsigned fArrivedBytes;
+  int64_t fArrivedBytesStartTime;
+  Boolean fHaveArrivedBytesStartTime;
+  double fArrivalBitrate; // kbps; 0 if not yet known
+  int64_t fLastDelayBasedUpdateTime, fLastDelayBasedDecreaseTime;
+  unsigned fNumPacketsReceivedSinceLossUpdate, fNumPacketsLostSinceLossUpdate;
+};
+
+#endif
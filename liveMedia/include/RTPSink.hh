@@ -29,6 +29,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 
 class RTPTransmissionStatsDB; // forward
+class RTPRateController; // forward
+class ULPFECEncoder; // forward
 
 /**
  * 该类提供了一种用于发送RTP数据的接收器，用于将媒体数据通过RTP协议发送到网络中。它具有管理RTP参数、呈现时间、
@@ -47,6 +49,11 @@ public:
 
   /// @brief 返回组播地址类非const函数可修改
   Groupsock &groupsockBeingUsed() { return *(fRTPInterface.gs()); }
+  // (Note: These must not be called for a sink that was created without a 'groupsock' - i.e., one that's used
+  // only for RTP-over-TCP.  Use "groupsockIfAny()" instead if that's possible.)
+
+  /// @brief 返回组播地址类指针；若该发送器仅用于RTP-over-TCP（没有'groupsock'），则返回NULL
+  Groupsock *groupsockIfAny() const { return fRTPInterface.gs(); }
 
   /// @brief 返回RTP payloadType
   unsigned char rtpPayloadType() const { return fRTPPayloadType; }
@@ -135,6 +142,30 @@ public:
   /// @brief 返回估计的比特率（以千位/秒为单位），在创建RTP接收器时可以设置，如果未知则为0。
   unsigned &estimatedBitrate() { return fEstimatedBitrate; } // kbps; usually 0 (i.e., unset)
 
+  RTPRateController *rateController() const { return fRateController; }
+  // the congestion controller attached to this sink (by "RTPRateController::createNew()"), or NULL if none
+
+  /// @brief 启用前向纠错（FEC）：按行/列对发送的RTP包做异或，并以fecPayloadType发送RFC 5109 FEC包
+  virtual Boolean enableFEC(unsigned char fecPayloadType, unsigned numColumns, unsigned numRows = 1,
+                            Boolean rowFEC = True);
+  // Sends - in the same RTP flow, but with payload type "fecPayloadType" - RFC 5109 FEC packets that protect each row
+  // (of "numColumns" consecutive packets) and - if "numRows" > 1 - each column of a "numColumns"x"numRows" matrix of
+  // packets.  (See "ULPFEC.hh".)  This must be called before the sink starts playing.  Returns False (and sets the
+  // result message) if the parameters are invalid.
+  // The receiver must know the FEC payload type; see "fecSDPLines()", and "RTPSource::enableFECRecovery()".
+
+  /// @brief 返回FEC包的payload type；未启用FEC时返回0
+  unsigned char fecPayloadType() const;
+
+  /// @brief 返回描述FEC包的SDP行（"a=rtpmap:<pt> ulpfec/<freq>"）；未启用FEC时返回空字符串。返回值需要delete[]
+  char *fecSDPLines() const;
+  // (The FEC payload type must also be added to the SDP "m=" line's format list.)
+
+  /// @brief 用SRTP加密并认证发送的RTP包（srtpContext不由本对象拥有；NULL表示不使用SRTP）
+  virtual Boolean setSRTPContext(SRTPCryptographicContext *srtpContext);
+  // This must be called before the sink starts playing (because some sinks make their packets smaller, to leave room
+  // for the SRTP authentication tag).  The sink's "RTCPInstance" should be given the same context.
+
   // later need a means of changing the SSRC if there's a collision #####
   /// @brief 返回RTP数据包的同步信源标识符（SSRC），用于唯一标识发送RTP数据包的源
   u_int32_t SSRC() const { return fSSRC; }
@@ -152,6 +183,7 @@ protected:
   // used by RTCP:
   friend class RTCPInstance;
   friend class RTPTransmissionStats;
+  friend class RTPRateController;
 
   /// @brief 将tv转换为RTP时间戳
   u_int32_t convertToRTPTimestamp(struct timeval tv);
@@ -174,6 +206,13 @@ protected:
   u_int32_t fCurrentTimestamp;                // 表示当前的RTP时间戳。时间戳是RTP数据包中用于同步和定时的重要字段。
   u_int16_t fSeqNo;                           // 表示当前的RTP序列号。序列号是RTP数据包中用于标识数据包顺序的字段。每发送一个RTP数据包，该序列号会递增。
 
+  // Congestion control (see "RTPRateController"):
+  RTPRateController *fRateController;
+  u_int8_t fTransportCCExtensionId; // if nonzero, each packet has a RTP header extension with a transport-wide sequence number
+  u_int16_t fTransportCCSeqNo;
+
+  ULPFECEncoder *fFECEncoder; // 若非NULL，则为发送的RTP包生成FEC包（见"enableFEC()"）
+
 private:
   // redefined virtual functions:
   virtual Boolean isRTPSink() const;
@@ -224,7 +263,7 @@ public:
   // 与SR报文时间的差值（Diff SR-RR Time）：指示接收者与发送者的SR报文时间戳之间的差值，用于计算接收者的延迟和抖动。
   // 通过RR报文，发送者可以了解到接收者的接收情况和网络传输状况，以便进行调整和优化媒体传输过程，从而提供更好的实时传输质量。RR报文是实时多媒体通信中重要的反馈机制，帮助保证数据传输的稳定和可靠性。
   // The following is called whenever a RTCP RR packet is received:
-  void noteIncomingRR(u_int32_t SSRC, struct sockaddr_in const &lastFromAddress,
+  void noteIncomingRR(u_int32_t SSRC, struct sockaddr_storage const &lastFromAddress,
                       unsigned lossStats, unsigned lastPacketNumReceived,
                       unsigned jitter, unsigned lastSRTime, unsigned diffSR_RRTime);
 
@@ -262,7 +301,7 @@ public:
   u_int32_t SSRC() const { return fSSRC; }
 
   /// @brief 返回上次接收到RTP数据包的地址信息
-  struct sockaddr_in const &lastFromAddress() const { return fLastFromAddress; }
+  struct sockaddr_storage const &lastFromAddress() const { return fLastFromAddress; }
 
   /// @brief 返回上次接收到RTP数据包的地址信息
   unsigned lastPacketNumReceived() const { return fLastPacketNumReceived; }
@@ -316,7 +355,7 @@ private:
   RTPTransmissionStats(RTPSink &rtpSink, u_int32_t SSRC);
   virtual ~RTPTransmissionStats();
 
-  void noteIncomingRR(struct sockaddr_in const &lastFromAddress,
+  void noteIncomingRR(struct sockaddr_storage const &lastFromAddress,
                       unsigned lossStats, unsigned lastPacketNumReceived,
                       unsigned jitter,
                       unsigned lastSRTime, unsigned diffSR_RRTime);
@@ -324,7 +363,7 @@ private:
 private:
   RTPSink &fOurRTPSink;                                 // 对应的RTPSink对象的引用
   u_int32_t fSSRC;                                      // 统计信息对应的SSRC标识符
-  struct sockaddr_in fLastFromAddress;                  // 上次接收到RTP数据包的地址信息
+  struct sockaddr_storage fLastFromAddress;                 // 上次接收到RTP数据包的地址信息
   unsigned fLastPacketNumReceived;                      // 上次接收到的RTP数据包序列号
   u_int8_t fPacketLossRatio;                            // 丢包率，以8位定点数表示
   unsigned fTotNumPacketsLost;                          // 自创建以来丢失的总数据包数量
@@ -29,6 +29,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 
 class RTPReceptionStatsDB; // forward
+class ULPFECDecoder; // forward
 
 class RTPSource: public FramedSource {
 public:
@@ -66,11 +67,24 @@ public:
   Boolean& enableRTCPReports() { return fEnableRTCPReports; }
   Boolean const& enableRTCPReports() const { return fEnableRTCPReports; }
 
+  Boolean enableFECRecovery(unsigned char fecPayloadType);
+      // Uses the RFC 5109 FEC packets that arrive - in the same RTP flow - with payload type "fecPayloadType" to recover
+      // lost packets (see "ULPFEC.hh").  (Only "MultiFramedRTPSource"s do this.)  Returns False if "fecPayloadType" is bad.
+      // Note: Recovered packets count as received in our RTCP "RR"s.  Also, if the sender uses column FEC, a lost packet
+      // may be recovered only after the rest of its column has arrived, so the packet reordering threshold time (see
+      // "setPacketReorderingThresholdTime()") should be at least the time that it takes to send that many packets.
+  ULPFECDecoder* fecDecoder() const { return fFECDecoder; } // NULL if FEC recovery has not been enabled
+
   void setStreamSocket(int sockNum, unsigned char streamChannelId) {
     // hack to allow sending RTP over TCP (RFC 2236, section 10.12)
     fRTPInterface.setStreamSocket(sockNum, streamChannelId);
   }
 
+  void setSRTPContext(SRTPCryptographicContext* srtpContext) {
+    fRTPInterface.setSRTPContext(srtpContext);
+  }
+      // Authenticates and decrypts our incoming RTP packets using SRTP.  ("srtpContext" is not owned by us.)
+
   void setAuxilliaryReadHandler(AuxHandlerFunc* handlerFunc,
                                 void* handlerClientData) {
     fRTPInterface.setAuxilliaryReadHandler(handlerFunc,
@@ -98,6 +112,7 @@ protected:
   Boolean fCurPacketHasBeenSynchronizedUsingRTCP;
   u_int32_t fLastReceivedSSRC;
   class RTCPInstance* fRTCPInstanceForMultiplexedRTCPPackets;
+  ULPFECDecoder* fFECDecoder;
 
 private:
   // redefined virtual functions:
@@ -27,6 +27,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _NET_ADDRESS_HH
 #include "NetAddress.hh"
 #endif
+#ifndef _HOST_NAME_RESOLVER_HH
+#include "HostNameResolver.hh"
+#endif
 #ifndef _DIGEST_AUTHENTICATION_HH
 #include "DigestAuthentication.hh"
 #endif
@@ -174,7 +177,13 @@ public:
   static Boolean parseRTSPURL(UsageEnvironment& env, char const* url,
 			      char*& username, char*& password, NetAddress& address, portNumBits& portNum, char const** urlSuffix = NULL);
       // Parses "url" as "rtsp://[<username>[:<password>]@]<server-address-or-name>[:<port>][/<stream-name>]"
+      // (or as the same, beginning with "rtsps://" - for RTSP-over-TLS - in which case the default port is 322)
       // (Note that the returned "username" and "password" are either NULL, or heap-allocated strings that the caller must later delete[].)
+      // (Note also that this looks up the server's address - which blocks - if the URL contains a host name.)
+  static Boolean parseRTSPURL(UsageEnvironment& env, char const* url,
+			      char*& username, char*& password, char*& hostName, portNumBits& portNum, char const** urlSuffix = NULL);
+      // The same, except that this returns the server's address or name - as a heap-allocated string (that the caller must
+      // later delete[]) - rather than looking it up.
 
   void setUserAgentString(char const* userAgentName);
       // sets an alternative string to be used in RTSP "User-Agent:" headers
@@ -183,6 +192,11 @@ public:
       // call this if you don't want the server to request 'Basic' authentication
       // (which would cause the client to send usernames and passwords over the net).
 
+  void setTLSServerVerification(Boolean verify) { fVerifyTLSServer = verify; }
+      // By default, a "rtsps://" server's certificate must be trusted (by the system's default CA certificates), and be
+      // for the host name (or address) in the URL.  Call this with "verify" False to skip this check (e.g., for a
+      // server with a self-signed certificate) - but note that the connection is then open to impersonation.
+
   unsigned sessionTimeoutParameter() const { return fSessionTimeoutParameter; }
 
   char const* url() const { return fBaseURL; }
@@ -272,6 +286,9 @@ private:
   void resetTCPSockets();
   void resetResponseBuffer();
   int openConnection(); // result values: -1: failure; 0: pending; 1: success
+  int openConnection1(); // used to implement "openConnection()", once we know "fServerAddress"
+  static void hostNameLookupHandler(void* clientData, NetAddressList const& addresses);
+  void hostNameLookupHandler1(NetAddressList const& addresses);
   char* createAuthenticatorString(char const* cmd, char const* url);
   char* createBlocksizeString(Boolean streamUsingTCP);
   void handleRequestError(RequestRecord* request);
@@ -285,7 +302,7 @@ private:
   Boolean parseSpeedParam(char const* paramStr, float& speed);
   Boolean parseRTPInfoParams(char const*& paramStr, u_int16_t& seqNum, u_int32_t& timestamp);
   Boolean handleSETUPResponse(MediaSubsession& subsession, char const* sessionParamsStr, char const* transportParamsStr,
-			      Boolean streamUsingTCP);
+			      char const* keyMgmtParamsStr, Boolean streamUsingTCP);
   Boolean handlePLAYResponse(MediaSession* session, MediaSubsession* subsession,
                              char const* scaleParamsStr, const char* speedParamsStr,
 			     char const* rangeParamsStr, char const* rtpInfoParamsStr);
@@ -316,6 +333,13 @@ private:
   void incomingDataHandler1();
   void handleResponseBytes(int newBytesRead);
 
+  // Support for RTSP-over-TLS ("rtsps://" URLs):
+  static Boolean isRTSPSURL(char const* url);
+  Boolean startTLS();
+  static void tlsHandshakeCompletionHandler(void* instance, Boolean success);
+  void tlsHandshakeCompletionHandler1(Boolean success);
+  int sendToServer(char const* data, unsigned dataSize); // returns -1 on failure
+
 public:
   u_int16_t desiredMaxIncomingPacketSize;
     // If set to a value >0, then a "Blocksize:" header with this value (minus an allowance for
@@ -326,7 +350,7 @@ protected:
   unsigned fCSeq; // sequence number, used in consecutive requests
   Authenticator fCurrentAuthenticator;
   Boolean fAllowBasicAuthentication;
-  netAddressBits fServerAddress;
+  struct sockaddr_storage fServerAddress; // (IPv4 or IPv6)
 
 private:
   portNumBits fTunnelOverHTTPPortNum;
@@ -345,6 +369,13 @@ private:
   char fSessionCookie[33];
   unsigned fSessionCookieCounter;
   Boolean fHTTPTunnelingConnectionIsPending;
+
+  // Support for RTSP-over-TLS:
+  portNumBits fServerPortNum; // the port that we connected to (identifies the server's TLS session, for resumption)
+  TLSState* fTLSState; // non-NULL iff we're connected to a "rtsps://" server (or doing the handshake)
+  Boolean fVerifyTLSServer; // by default, True
+
+  unsigned fHostNameLookupId; // nonzero iff we're looking up the server's address (before connecting to it)
 };
 
 
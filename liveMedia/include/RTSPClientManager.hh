@@ -0,0 +1,98 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A manager for receiving a large number of RTSP streams (e.g., from cameras).  Each stream is given to one of
+// several 'worker' threads (each running its own event loop), which uses a "RTSPClient" to "DESCRIBE", "SETUP" and
+// "PLAY" it - pipelining its "SETUP"s and "PLAY" - and then feeds each of its tracks into a "MediaSink" supplied by the
+// application.  Streams that fail (or end, or stop delivering data) are restarted, with exponential backoff.
+// C++ header
+
+#ifndef _RTSP_CLIENT_MANAGER_HH
+#define _RTSP_CLIENT_MANAGER_HH
+
+#ifndef _RTSP_CLIENT_HH
+#include "RTSPClient.hh"
+#endif
+
+#include <atomic>
+
+class RTSPClientManagerWorker; // forward
+
+class RTSPClientManager: public Medium {
+public:
+  typedef UsageEnvironment* (WorkerEnvironmentCreationFunc)();
+      // Creates a new "UsageEnvironment", with its own "TaskScheduler" - e.g.,
+      //     return BasicUsageEnvironment::createNew(*BasicTaskScheduler::createNew());
+  typedef MediaSink* (CreateSinkFunc)(UsageEnvironment& env, unsigned streamId, char const* rtspURL,
+				      MediaSubsession& subsession, void* clientData);
+      // Called - from within the stream's worker thread (whose environment is "env") - each time that a track
+      // ("subsession") of a stream has been "SETUP".  It should return a new "MediaSink" (which we'll start playing
+      // from the track's source, and close when the stream is stopped or restarted), or NULL to ignore the track.
+
+  static RTSPClientManager* createNew(UsageEnvironment& env, unsigned numWorkers,
+				      WorkerEnvironmentCreationFunc* environmentCreationFunc,
+				      CreateSinkFunc* createSinkFunc, void* sinkClientData,
+				      unsigned maxConnectingStreamsPerWorker = 20,
+				      Boolean streamUsingTCP = False,
+				      unsigned dataTimeoutSeconds = 10,
+				      int verbosityLevel = 0);
+      // If "numWorkers" is 0, then streams are handled by "env"'s own event loop (and "environmentCreationFunc" is not
+      // used); in this case, "addStream()" and "removeStream()" must also be called from "env"'s thread.
+      // At most "maxConnectingStreamsPerWorker" streams (in each worker) are between starting to connect, and
+      // getting a response to their "PLAY"; others wait their turn.
+      // A playing stream that receives no RTP packets for "dataTimeoutSeconds" (if > 0) is restarted.
+
+  // These functions may be called from any thread (unless "numWorkers" was 0):
+  unsigned addStream(char const* rtspURL, char const* username = NULL, char const* password = NULL);
+      // Returns an id (> 0) for the stream, to be used in "removeStream()".  Streams are divided among the
+      // workers in turn.  (The stream is started asynchronously, so the result does not indicate success.)
+  void removeStream(unsigned streamId);
+
+  unsigned numWorkers() const { return fNumWorkers; }
+  unsigned numStreams() const { return fNumStreams.load(std::memory_order_relaxed); }
+  unsigned numStreamsPlaying() const { return fNumStreamsPlaying.load(std::memory_order_relaxed); }
+  unsigned numStreamRestarts() const { return fNumStreamRestarts.load(std::memory_order_relaxed); }
+
+protected:
+  RTSPClientManager(UsageEnvironment& env, unsigned numWorkers, CreateSinkFunc* createSinkFunc, void* sinkClientData,
+		    unsigned maxConnectingStreamsPerWorker, Boolean streamUsingTCP, unsigned dataTimeoutSeconds,
+		    int verbosityLevel);
+      // called only by createNew();
+  virtual ~RTSPClientManager();
+      // Stops each worker (closing its streams, and - if it's a separate thread - its environment)
+
+private:
+  friend class RTSPClientManagerWorker;
+  friend class ManagedStream;
+  Boolean startWorkers(WorkerEnvironmentCreationFunc* environmentCreationFunc);
+
+private:
+  unsigned fNumWorkers; // the number of worker threads; 0 means: use our own environment
+  RTSPClientManagerWorker** fWorkers; // (there's always at least one)
+
+  CreateSinkFunc* fCreateSinkFunc;
+  void* fSinkClientData;
+  unsigned fMaxConnectingStreamsPerWorker;
+  Boolean fStreamUsingTCP;
+  unsigned fDataTimeoutSeconds;
+  int fVerbosityLevel;
+
+  std::atomic<unsigned> fNextStreamId;
+  std::atomic<unsigned> fNumStreams, fNumStreamsPlaying, fNumStreamRestarts;
+};
+
+#endif
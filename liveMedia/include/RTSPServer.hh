@@ -89,7 +89,7 @@ public:
   char *rtspURL(ServerMediaSession const *serverMediaSession, int clientSocket = -1) const;
 
   // like "rtspURL()", except that it returns just the common prefix used by
-  // each session's "rtsp://" URL.
+  // each session's "rtsp://" URL.  (If "clientSocket" is using TLS, then the prefix is "rtsps://", with our TLS port.)
   // This string is dynamically allocated; caller should delete[]
   char *rtspURLPrefix(int clientSocket = -1) const;
 
@@ -103,6 +103,14 @@ public:
     fAllowStreamingRTPOverTCP = False;
   }
 
+  /// @brief 允许在未使用TLS的连接上下发SRTP密钥（默认不允许）
+  void allowSRTPKeysWithoutTLS(Boolean allow = True)
+  {
+    fAllowSRTPKeysWithoutTLS = allow;
+  }
+  // By default, a "DESCRIBE" or "SETUP" of a stream that uses SRTP is refused (with "403 Forbidden") unless the
+  // connection uses TLS, because the response would contain the (plaintext) SRTP master key.
+
   /// @brief 通过http传输，设置通过HTTP的隧道(RTSP-over-HTTP隧道)
   /// @param httpPort http端口
   /// @return success true, failed false
@@ -138,11 +146,11 @@ protected:
   // used to implement "RTSPClientConnection::handleCmd_REGISTER()"
 
   virtual UserAuthenticationDatabase *getAuthenticationDatabaseForCommand(char const *cmdName);
-  virtual Boolean specialClientAccessCheck(int clientSocket, struct sockaddr_in &clientAddr,
+  virtual Boolean specialClientAccessCheck(int clientSocket, struct sockaddr_storage &clientAddr,
                                            char const *urlSuffix);
   // a hook that allows subclassed servers to do server-specific access checking
   // on each client (e.g., based on client IP address), without using digest authentication.
-  virtual Boolean specialClientUserAccessCheck(int clientSocket, struct sockaddr_in &clientAddr,
+  virtual Boolean specialClientUserAccessCheck(int clientSocket, struct sockaddr_storage &clientAddr,
                                                char const *urlSuffix, char const *username);
   // another hook that allows subclassed servers to do server-specific access checking
   // - this time after normal digest authentication has already taken place (and would otherwise allow access).
@@ -182,7 +190,7 @@ public: // should be protected, but some old compilers complain otherwise
     virtual void handleRequestBytes(int newBytesRead);
 
   protected:
-    RTSPClientConnection(RTSPServer &ourServer, int clientSocket, struct sockaddr_in clientAddr);
+    RTSPClientConnection(RTSPServer &ourServer, int clientSocket, struct sockaddr_storage const &clientAddr);
     virtual ~RTSPClientConnection();
 
     friend class RTSPServer;
@@ -227,7 +235,25 @@ public: // should be protected, but some old compilers complain otherwise
 
   protected:
     void resetRequestBuffer();
+    virtual Boolean requestBufferMayBeReallocated() const;
+    virtual void requestBufferWasReallocated(unsigned char *oldBuffer);
     void closeSocketsRTSP();
+
+    // Sending responses.  Any part of a response that can't be sent immediately (because the client's socket isn't
+    // writable) is queued, and sent later, in order.  (While this happens, we don't read further requests.)
+    void sendResponse(); // sends (or queues) the contents of "fResponseBuffer"
+    void sendResponseNow();
+        // Sends all of "fResponseBuffer" now, blocking (with a timeout) if necessary.  Used before other data (e.g., a
+        // HTTP response body) is written directly to our output socket.
+    int sendToClient(u_int8_t const *data, unsigned dataSize);
+        // Sends on our output socket (using TLS, if our connection uses it).  Returns the number of bytes sent, 0 if the
+        // socket isn't writable now, or -1 if the connection has failed.
+    Boolean enqueueOutput(u_int8_t const *data, unsigned dataSize);
+    static void outputSocketWritableHandler(void *instance, int /*mask*/);
+    void sendQueuedOutput();
+    void finishSendingQueuedOutput(); // sends any queued output now, blocking (with a timeout) if necessary
+    void updateOutputSocketHandling();
+    Boolean haveQueuedOutput() const { return fOutputQueueHead < fOutputQueueTail; }
     static void handleAlternativeRequestByte(void *, u_int8_t requestByte);
     void handleAlternativeRequestByte1(u_int8_t requestByte);
     Boolean authenticationOK(char const *cmdName, char const *urlSuffix, char const *fullRequestStr);
@@ -236,6 +262,8 @@ public: // should be protected, but some old compilers complain otherwise
     static void continueHandlingREGISTER(ParamsForREGISTER *params);
     virtual void continueHandlingREGISTER1(ParamsForREGISTER *params);
 
+    Boolean maySendSRTPKeys() const; // True iff we use TLS, or our server allows SRTP keys without it
+
     // Shortcuts for setting up a RTSP response (prior to sending it):
     void setRTSPResponse(char const *responseStr);
     void setRTSPResponse(char const *responseStr, u_int32_t sessionId);
@@ -252,6 +280,8 @@ public: // should be protected, but some old compilers complain otherwise
     Authenticator fCurrentAuthenticator; // 用于执行访问控制的身份验证器
     char *fOurSessionCookie;             // used for optional RTSP-over-HTTP tunneling 可选的用于RTSP-over-HTTP隧道的会话Cookie
     unsigned fBase64RemainderCount;      // used for optional RTSP-over-HTTP tunneling (possible values: 0,1,2,3) 选的用于RTSP-over-HTTP隧道的Base64编码剩余字符数。
+    u_int8_t *fOutputQueue;              // response data that we have not yet been able to send
+    unsigned fOutputQueueSize, fOutputQueueHead, fOutputQueueTail;
   };
 
   // The state of an individual client session (using one or more sequential TCP connections) handled by a RTSP server:
@@ -309,7 +339,7 @@ public: // should be protected, but some old compilers complain otherwise
 protected: // redefined virtual functions
   // If you subclass "RTSPClientConnection", then you must also redefine this virtual function in order
   // to create new objects of your subclass:
-  virtual ClientConnection *createNewClientConnection(int clientSocket, struct sockaddr_in clientAddr);
+  virtual ClientConnection *createNewClientConnection(int clientSocket, struct sockaddr_storage const &clientAddr);
 
 protected:
   // If you subclass "RTSPClientSession", then you must also redefine this virtual function in order
@@ -339,6 +369,7 @@ private:
   unsigned fRegisterOrDeregisterRequestCounter;
   UserAuthenticationDatabase *fAuthDB;
   Boolean fAllowStreamingRTPOverTCP; // 是否允许通过tcp流式传输rtp  by default, True
+  Boolean fAllowSRTPKeysWithoutTLS;  // 是否允许在非TLS连接上下发SRTP密钥  by default, False
 };
 
 ////////// A subclass of "RTSPServer" that implements the "REGISTER" command to set up proxying on the specified URL //////////
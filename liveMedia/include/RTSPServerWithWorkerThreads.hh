@@ -0,0 +1,98 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A RTSP server whose streams are divided among several 'worker' threads, each running its own event loop
+// (with its own "UsageEnvironment", and its own - non-listening - "RTSPServer").  This server accepts each
+// incoming connection, looks at the URL in its first request, and hands the connection to the worker thread
+// that owns that stream.  From then on, the connection is handled entirely by that worker thread.
+// (If the first request is an "OPTIONS" that names no stream, this server answers it, and looks at the next request.)
+// C++ header
+
+#ifndef _RTSP_SERVER_WITH_WORKER_THREADS_HH
+#define _RTSP_SERVER_WITH_WORKER_THREADS_HH
+
+#ifndef _RTSP_SERVER_HH
+#include "RTSPServer.hh"
+#endif
+
+#include <mutex>
+
+class RTSPServerWorkerThread; // forward
+
+class RTSPServerWithWorkerThreads: public RTSPServer {
+public:
+  typedef UsageEnvironment* (WorkerEnvironmentCreationFunc)();
+      // Creates a new "UsageEnvironment", with its own "TaskScheduler" - e.g.,
+      //     return BasicUsageEnvironment::createNew(*BasicTaskScheduler::createNew());
+  typedef void (WorkerSetupFunc)(RTSPServerWithWorkerThreads& ourServer, unsigned workerNum,
+				 RTSPServer& workerServer, void* clientData);
+      // Called - from within each worker thread, before it handles any connections - to create the worker's
+      // streams.  It should add each "ServerMediaSession" to "workerServer" (whose environment is the worker's
+      // environment), and then call "ourServer.assignStream()" to have connections for it sent to this worker.
+
+  static RTSPServerWithWorkerThreads* createNew(UsageEnvironment& env, Port ourPort, unsigned numWorkers,
+						WorkerEnvironmentCreationFunc* environmentCreationFunc,
+						WorkerSetupFunc* setupFunc, void* setupClientData,
+						UserAuthenticationDatabase* authDatabase = NULL,
+						unsigned reclamationSeconds = 65);
+      // Starts "numWorkers" worker threads, and returns only after each of them has run "setupFunc".
+      // Connections for streams that haven't been assigned to a worker (including our own
+      // "ServerMediaSession"s, if any) are handled by us, in "env"'s event loop.
+      // Note: Each connection is routed just once - by its first request that names a stream (or by its first
+      // request other than "OPTIONS", if that names no stream).  So a client must use a separate connection for
+      // each stream that's owned by a different thread.
+
+  // These functions may be called from any thread:
+  void assignStream(char const* streamName, unsigned workerNum);
+  void unassignStream(char const* streamName);
+
+  unsigned numWorkers() const { return fNumWorkers; }
+  unsigned numConnectionsHandedOff(unsigned workerNum) const;
+
+protected:
+  RTSPServerWithWorkerThreads(UsageEnvironment& env, int ourSocket, Port ourPort, unsigned numWorkers,
+			      UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds);
+      // called only by createNew();
+  virtual ~RTSPServerWithWorkerThreads();
+      // Stops each worker thread (closing its connections, streams and environment)
+
+protected: // redefined virtual functions
+  virtual ClientConnection* createNewClientConnection(int clientSocket, struct sockaddr_storage const& clientAddr);
+
+private:
+  friend class PendingConnection;
+  friend class RTSPServerWorkerThread;
+  Boolean startWorkers(WorkerEnvironmentCreationFunc* environmentCreationFunc,
+		       WorkerSetupFunc* setupFunc, void* setupClientData,
+		       UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds);
+  void dispatchConnection(int clientSocket, struct sockaddr_storage const& clientAddr, char const* requestLine);
+  int lookupWorker(char const* requestLine);
+      // Returns the number of the worker thread that owns the stream named in "requestLine", or -1 if none
+  static char* streamNameInRequestLine(char const* requestLine);
+      // Returns a new[]-allocated string (or NULL, if "requestLine" contains no URL)
+  static Boolean namesNoStream(char const* requestLine); // e.g., "OPTIONS * RTSP/1.0"
+
+private:
+  unsigned fNumWorkers;
+  RTSPServerWorkerThread** fWorkers;
+  HashTable* fPendingConnections; // connections whose first request line we haven't yet seen
+
+  std::mutex fStreamTableLock;
+  HashTable* fStreamTable; // maps stream names to (1 + worker number); protected by "fStreamTableLock"
+};
+
+#endif
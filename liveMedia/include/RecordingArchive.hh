@@ -0,0 +1,102 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// The files that describe a segmented recording (as written by "RollingRecordingSink"): the list of segments,
+// and each segment's key frame index.
+// C++ header
+
+#ifndef _RECORDING_ARCHIVE_HH
+#define _RECORDING_ARCHIVE_HH
+
+#ifndef _USAGE_ENVIRONMENT_HH
+#include "UsageEnvironment.hh"
+#endif
+
+u_int64_t timevalToMicroseconds(struct timeval const& tv);
+struct timeval microsecondsToTimeval(u_int64_t usecs);
+
+class RecordingSegment {
+public:
+  RecordingSegment(char const* fileName, struct timeval const& startTime);
+  virtual ~RecordingSegment();
+
+  char* indexFileName() const; // "<segment file name>.idx"; the result must be "delete[]"d by the caller
+
+  char* fFileName;
+  struct timeval fStartTime, fEndTime; // the presentation times of the segment's first and last frames
+  u_int64_t fSize;
+};
+
+// The position of each key frame within a segment.  When a segment ends, this is written to the segment's
+// ".idx" file, as a sequence of 16-byte records: the key frame's presentation time (in microseconds), then
+// its offset within the segment file (both 64-bit, big-endian).
+class SegmentKeyFrameIndex {
+public:
+  SegmentKeyFrameIndex();
+  virtual ~SegmentKeyFrameIndex();
+
+  static SegmentKeyFrameIndex* createFromFile(char const* fileName); // returns NULL if the file can't be read
+  Boolean writeToFile(UsageEnvironment& env, char const* fileName) const;
+
+  void addEntry(u_int64_t time, u_int64_t offset);
+  unsigned numEntries() const { return fNumEntries; }
+  u_int64_t time(unsigned i) const { return fTimes[i]; }
+  u_int64_t offset(unsigned i) const { return fOffsets[i]; }
+
+  int lookup(u_int64_t time) const;
+      // Returns the last entry at (or before) "time" - or 0, if there's none.  Returns -1 iff we have no entries.
+
+private:
+  u_int64_t* fTimes;
+  u_int64_t* fOffsets;
+  unsigned fNumEntries, fMaxNumEntries;
+};
+
+// The list of segments (oldest first).  This is kept in a text file, with one line per segment:
+//     <start time> <end time> <size> <file name>
+// with times written as "<seconds>.<microseconds>".
+class RecordingSegmentList {
+public:
+  RecordingSegmentList();
+  virtual ~RecordingSegmentList();
+
+  Boolean readFromFile(char const* fileName);
+      // Replaces our current contents with the segments listed in "fileName" (omitting those whose file no longer
+      // exists).  Returns False if "fileName" can't be read.
+  Boolean writeToFile(UsageEnvironment& env, char const* fileName, RecordingSegment const* extraSegment = NULL) const;
+      // Replaces "fileName" (atomically) with a list of our segments (plus "extraSegment", if not NULL)
+
+  void addSegment(RecordingSegment* segment); // at the end; we take ownership of "segment"
+  RecordingSegment* removeOldestSegment(); // the caller takes ownership of the result
+  void removeAllSegments();
+
+  unsigned numSegments() const { return fNumSegments; }
+  RecordingSegment* segment(unsigned i) const { return fSegments[i]; }
+  u_int64_t totalSize() const { return fTotalSize; }
+
+  int lookup(u_int64_t time) const;
+      // Returns the last segment that starts at (or before) "time" - or 0, if there's none.
+      // Returns -1 iff we have no segments.
+  int lookupByStartTime(u_int64_t startTime) const; // returns -1 if no segment starts at exactly this time
+
+private:
+  RecordingSegment** fSegments;
+  unsigned fNumSegments, fMaxNumSegments;
+  u_int64_t fTotalSize;
+};
+
+#endif
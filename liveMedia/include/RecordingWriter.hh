@@ -0,0 +1,146 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A write-behind output engine for recording files: data is collected into large buffers, which are then
+// written - by a background thread - without blocking the event loop.
+// C++ header
+
+#ifndef _RECORDING_WRITER_HH
+#define _RECORDING_WRITER_HH
+
+#ifndef _MEDIA_HH
+#include "Media.hh"
+#endif
+
+#include <stdio.h>
+#include <atomic>
+
+class RecordingWriterParameters {
+public:
+  RecordingWriterParameters(); // sets the default values shown below
+
+  unsigned bufferSize; // default: 256 KBytes
+      // the size of each write buffer; data is normally written in pieces of this size
+  unsigned maxNumBuffers; // default: 4
+      // the number of buffers (per file) that may be waiting to be written.  If all of them are in use (because
+      // the disk can't keep up), then "hasFreeBuffer()" returns False.  (More data may still be added - using extra
+      // buffers - but callers should instead wait, using "notifyWhenBufferIsFree()".)  We never block the event loop.
+  unsigned flushIntervalMS; // default: 1000
+      // partly-filled buffers are written after (at most) this delay.  If 0, then each frame is written
+      // as soon as it's complete (this is always the case for output that's not a regular file - e.g., a pipe).
+  unsigned syncIntervalMS; // default: 0
+      // if non-zero, the written data is also committed to the disk (using "fdatasync()") at most this often
+  Boolean syncOnClose; // default: False
+      // if True, the written data is committed to the disk (using "fdatasync()") when the file is closed
+  Boolean useDirectIO; // default: False
+      // if True (and supported), bypasses the OS's page cache ("O_DIRECT"); this also requires that
+      // "bufferSize" be a multiple of RECORDING_WRITER_DIRECT_IO_ALIGNMENT
+  unsigned preallocationSize; // default: 0
+      // if non-zero (and supported), disk space is reserved (using "fallocate()") in pieces of this size,
+      // ahead of the data being written.  (The file's reported size is unaffected.)
+};
+
+#define RECORDING_WRITER_DIRECT_IO_ALIGNMENT 4096
+
+struct RecordingBuffer; // forward
+class RecordingWriterThread; // forward
+
+// The writes are done by a background thread that's shared by all of the files (in all event loops) on the same
+// device.  (Output that's not a regular file - e.g., a pipe - gets a thread of its own.)  So a slow disk delays only
+// the recordings that are on it.
+class RecordingWriter: public Medium {
+public:
+  static RecordingWriter* createNew(UsageEnvironment& env, FILE* fid,
+				    RecordingWriterParameters const& params = RecordingWriterParameters());
+      // Data will be written to "fid", starting at its current position.  (Any data already buffered by "fid"
+      // is flushed first.)  "fid" remains owned by the caller, which must not write to it (or close it) until
+      // after "finish()" has been called.
+
+  Boolean addData(unsigned char const* data, unsigned dataSize);
+  Boolean endOfFrame();
+      // Called after each complete frame has been added; writes the data now, if "flushIntervalMS" is 0
+  Boolean flush();
+      // Starts writing all data that's been added so far (without waiting for this to complete)
+  Boolean finish();
+      // Writes all data that's been added so far, and waits for this (and for any other writes) to complete.
+      // No more data may be added afterwards.  (This is also done - implicitly - by our destructor.)
+  // Each of the above functions returns False iff a write (now or earlier) has failed.
+
+  Boolean hasFreeBuffer();
+      // Returns False if all of our buffers are still waiting to be written (i.e., the disk isn't keeping up with us).
+      // A sink should then stop asking for new frames until "notifyWhenBufferIsFree()" calls it back.
+  void notifyWhenBufferIsFree(TaskFunc* handler, void* clientData);
+      // Arranges for "handler(clientData)" to be called - once - from the event loop, after one of our buffers has
+      // been written (or soon, if one is already free)
+
+  Boolean hasFailed() const { return fErrorCode.load(std::memory_order_acquire) != 0; }
+  u_int64_t numBytesAdded() const { return fNumBytesAdded; }
+  u_int64_t numBytesWritten() const { return fNumBytesWritten.load(std::memory_order_relaxed); }
+
+protected:
+  RecordingWriter(UsageEnvironment& env, int fd, Boolean isRegularFile, u_int64_t deviceId, Boolean useDirectIO,
+		  u_int64_t initialFileOffset, RecordingWriterParameters const& params);
+      // called only by createNew()
+  virtual ~RecordingWriter();
+
+private:
+  friend class RecordingWriterThread;
+
+  RecordingBuffer* getFreeBuffer(); // allocates a new buffer if none is free (never blocks)
+  void submitCurrentBuffer(Boolean isFinal);
+  Boolean checkForFailure();
+  static void flushTimerHandler(void* clientData);
+  static void bufferIsFreeHandler(void* clientData);
+  static void finishAllWriters(); // called (via "atexit()") if the program exits without closing its writers
+
+  // These functions are called only from the background thread:
+  void writeBuffer(RecordingBuffer* buffer);
+  Boolean writeAll(unsigned char const* data, unsigned dataSize);
+
+private:
+  int fFD;
+  RecordingWriter* fNextWriter; // in the list of all writers (used by "finishAllWriters()")
+  RecordingWriterThread* fWriterThread;
+  RecordingWriterParameters fParams;
+  Boolean fUseDirectIO;
+  Boolean fIsFinished;
+  RecordingBuffer* fCurrentBuffer; // the buffer that's currently being filled (or NULL)
+  TaskToken fFlushTimerTask;
+  u_int64_t fNumBytesAdded;
+  EventTriggerId fBufferIsFreeTrigger;
+  TaskFunc* fBufferIsFreeHandler;
+  void* fBufferIsFreeClientData;
+
+  // Accessed only while holding the background thread's lock:
+  Boolean fWantsBufferIsFreeNotification;
+  RecordingBuffer* fFreeBuffers;
+  unsigned fNumBuffers; // the number of buffers that we've allocated (whether free, or in use); normally
+      // at most "fParams.maxNumBuffers", but extra buffers (freed once written) are used if data is added anyway
+  unsigned fNumPendingBuffers; // the number of buffers that have been submitted, but not yet written
+
+  // Accessed only by the background thread:
+  u_int64_t fFileOffset;
+  u_int64_t fPreallocatedEnd;
+  Boolean fDirectIOIsActive;
+  struct timeval fTimeOfLastSync;
+  Boolean fNeedToSync;
+
+  std::atomic<int> fErrorCode; // "errno" from the first write that failed (or 0)
+  std::atomic<u_int64_t> fNumBytesWritten;
+};
+
+#endif
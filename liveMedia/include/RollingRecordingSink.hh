@@ -0,0 +1,141 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A sink that records a stream into a sequence of segment files - each starting at a key frame - with an
+// index (from wall-clock time to file+offset), and that deletes old segments according to a retention policy.
+// C++ header
+
+#ifndef _ROLLING_RECORDING_SINK_HH
+#define _ROLLING_RECORDING_SINK_HH
+
+#ifndef _MEDIA_SINK_HH
+#include "MediaSink.hh"
+#endif
+#ifndef _RECORDING_WRITER_HH
+#include "RecordingWriter.hh"
+#endif
+#ifndef _RECORDING_ARCHIVE_HH
+#include "RecordingArchive.hh"
+#endif
+
+class RollingRecordingParameters {
+public:
+  RollingRecordingParameters(); // sets the default values shown below
+
+  unsigned segmentDurationSeconds; // default: 60
+  u_int64_t maxSegmentSize; // default: 0 (no limit)
+      // A new segment is started at the first key frame after either of these limits has been reached.
+      // (Segments therefore may be somewhat longer - or larger - than these limits.)
+  unsigned retentionSeconds; // default: 0 (no limit)
+      // Segments that ended more than this long before the end of the most recent segment are deleted
+  u_int64_t maxTotalSize; // default: 0 (no limit)
+      // The oldest segments are deleted, if needed, to keep the total size of all (complete) segments
+      // within this limit
+  RecordingWriterParameters writeParameters; // how each segment file is written (see "RecordingWriter.hh")
+};
+
+class RollingRecordingSink: public MediaSink {
+public:
+  static RollingRecordingSink* createNew(UsageEnvironment& env, char const* fileNamePrefix,
+					 char const* fileNameSuffix = "",
+					 RollingRecordingParameters const& params = RollingRecordingParameters(),
+					 unsigned bufferSize = 100000,
+					 int hNumber = 0,
+					 char const* sPropParameterSetsStr1 = NULL,
+					 char const* sPropParameterSetsStr2 = NULL,
+					 char const* sPropParameterSetsStr3 = NULL);
+  // Each segment file is named "<fileNamePrefix><YYYYMMDD-HHMMSS-mmm><fileNameSuffix>", using the (UTC)
+  //   presentation time of its first frame.  The list of segments is kept in the file "<fileNamePrefix>index"
+  //   (which is reread - so that the retention policy continues to apply - if recording is restarted).
+  //   Each segment's key frame index is written to "<segment file name>.idx" when the segment ends.
+  // "hNumber" is 264 (for a H.264 video stream), 265 (for a H.265 video stream), or 0 (for any other
+  //   stream, in which every frame is treated as a key frame).  For H.264 and H.265, each NAL unit is written
+  //   with a 'start code' in front, and each segment begins with the NAL units from the
+  //   "sPropParameterSetsStr"s (if any), so that it can be decoded on its own.
+  // "bufferSize" should be at least as large as the largest expected input frame.
+
+  Boolean findKeyFrame(struct timeval const& wallClockTime,
+		       char*& resultFileName, u_int64_t& resultFileOffset,
+		       struct timeval& resultPresentationTime);
+  // Finds the most recent key frame at (or before) "wallClockTime", returning the name of the segment file
+  // that contains it (a string that the caller must "delete[]"), and its position within that file.
+  // (If "wallClockTime" is before the start of the earliest segment, then the earliest key frame is found.)
+  // Returns False if nothing has been recorded yet.
+
+  unsigned numSegments() const; // the number of complete segments, plus the current one (if any)
+  u_int64_t totalSize() const; // ditto, in bytes
+
+protected:
+  RollingRecordingSink(UsageEnvironment& env, char const* fileNamePrefix, char const* fileNameSuffix,
+		       RollingRecordingParameters const& params, unsigned bufferSize, int hNumber,
+		       char const* sPropParameterSetsStr1,
+		       char const* sPropParameterSetsStr2,
+		       char const* sPropParameterSetsStr3);
+      // called only by createNew()
+  virtual ~RollingRecordingSink();
+
+protected: // redefined virtual functions:
+  virtual Boolean continuePlaying();
+
+private:
+  static void writerHasFreeBuffer(void* clientData);
+  static void afterGettingFrame(void* clientData, unsigned frameSize,
+				unsigned numTruncatedBytes,
+				struct timeval presentationTime,
+				unsigned durationInMicroseconds);
+  void afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes,
+			 struct timeval presentationTime);
+
+  void classifyFrame(unsigned frameSize, Boolean& isKeyFrame, Boolean& isKeyFramePrefix) const;
+  Boolean segmentIsFull(struct timeval const& presentationTime) const;
+  Boolean startNewSegment(struct timeval const& presentationTime);
+  void endCurrentSegment();
+  Boolean writeData(unsigned char const* data, unsigned dataSize);
+  void holdData(unsigned char const* data, unsigned dataSize);
+
+  void deleteOldestSegment();
+  void applyRetentionPolicy();
+  void writeSegmentList();
+  RecordingSegment* segmentContaining(struct timeval const& wallClockTime) const;
+
+private:
+  char* fFileNamePrefix;
+  char* fFileNameSuffix;
+  char* fSegmentListFileName;
+  RollingRecordingParameters fParams;
+  int fHNumber;
+  char* fSPropParameterSetsStr[3];
+  unsigned char* fBuffer;
+  unsigned fBufferSize;
+
+  // Key frame prefix NAL units (e.g., SPS, PPS, SEI) are held back until we know whether they're followed
+  // by a key frame (and thus belong at the start of a new segment):
+  unsigned char* fHeldData;
+  unsigned fHeldDataSize, fHeldDataMaxSize;
+  struct timeval fHeldDataPresentationTime;
+  struct timeval fLastKeyFramePresentationTime; // used to recognize later slices of the same key frame
+
+  // The current segment:
+  FILE* fOutFid;
+  RecordingWriter* fWriter;
+  RecordingSegment* fCurrentSegment;
+  SegmentKeyFrameIndex* fCurrentIndex;
+
+  RecordingSegmentList fSegments; // complete segments, oldest first
+};
+
+#endif
@@ -0,0 +1,122 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// The SRTP 'cryptographic context' (RFC 3711, RFC 7714): Encrypts and authenticates - in place - outgoing RTP and
+// RTCP packets, and authenticates and decrypts incoming ones.
+// C++ header
+
+#ifndef _SRTP_CRYPTOGRAPHIC_CONTEXT_HH
+#define _SRTP_CRYPTOGRAPHIC_CONTEXT_HH
+
+#ifndef _MIKEY_HH
+#include "MIKEY.hh"
+#endif
+#ifndef _HASH_TABLE_HH
+#include "HashTable.hh"
+#endif
+
+// The most that SRTP adds to the end of a (RTP or RTCP) packet.  (For SRTCP with AES-GCM, this is a 16-byte
+// authentication tag, plus the 4-byte SRTCP index.)  Any buffer whose packet is to be protected in place must have
+// (at least) this much room after the packet.
+#define SRTP_MAX_TRAILER_SIZE 20
+
+// The crypto itself is done by OpenSSL (which uses the CPU's AES and carry-less multiply instructions - e.g., AES-NI
+// and PCLMULQDQ on x86 - where available).  If this code was compiled with "NO_OPENSSL" defined, "createNew()"
+// always fails.
+//
+// Note: An incoming SSRC's 'rollover counter' is assumed to start at 0, unless "setIncomingROC()" says otherwise.  (A
+// receiver that joins a stream after its RTP sequence number has wrapped around needs this; "RTSPServer" sends each
+// client its stream's current rollover counter - in a MIKEY message - in its "SETUP" response.)
+
+class SRTPCryptographicContext {
+public:
+  static Boolean isSupported();
+  static SRTPCryptographicContext* createNew(MIKEYState const& mikeyState);
+      // Returns NULL if SRTP is not supported (or the crypto library failed)
+  virtual ~SRTPCryptographicContext();
+
+  unsigned srtpTrailerSize() const { return fProfile == MIKEYState::AEAD_AES_128_GCM ? 16 : 10; }
+      // The number of bytes that protection adds to each RTP packet
+
+  // Each of these functions processes the packet in place, and returns False if it fails (e.g., because an incoming
+  // packet is malformed, fails authentication, or is a replay).  An outgoing packet's buffer must have room for
+  // "SRTP_MAX_TRAILER_SIZE" more bytes:
+  Boolean processOutgoingSRTPPacket(u_int8_t* buffer, unsigned inPacketSize, unsigned& outPacketSize);
+  Boolean processIncomingSRTPPacket(u_int8_t* buffer, unsigned inPacketSize, unsigned& outPacketSize);
+  Boolean processOutgoingSRTCPPacket(u_int8_t* buffer, unsigned inPacketSize, unsigned& outPacketSize);
+  Boolean processIncomingSRTCPPacket(u_int8_t* buffer, unsigned inPacketSize, unsigned& outPacketSize);
+
+  u_int32_t outgoingROC(u_int32_t ssrc, u_int16_t nextSeqNum) const;
+      // Returns the rollover counter that the next outgoing SRTP packet from "ssrc" - with sequence number "nextSeqNum" -
+      // will use
+  void setIncomingROC(u_int32_t ssrc, u_int32_t roc);
+      // Sets the rollover counter of the first SRTP packet that we'll receive from "ssrc" (e.g., from a MIKEY message)
+
+  unsigned numAuthenticationFailures() const { return fNumAuthenticationFailures; }
+  unsigned numReplayedPackets() const { return fNumReplayedPackets; }
+
+protected:
+  SRTPCryptographicContext(MIKEYState const& mikeyState); // called only by "createNew()"
+
+private:
+  // Per-SSRC state:
+  class SSRCState {
+  public:
+    SSRCState();
+
+    // Outgoing:
+    u_int32_t roc;
+    u_int16_t lastSeqNum;
+    Boolean haveSentSRTP;
+    u_int32_t nextSRTCPIndex;
+
+    // Incoming (with a 64-packet replay window, in which bit i is set if index "highest - i" has been received):
+    u_int64_t highestSRTPIndex, srtpReplayWindow;
+    Boolean haveReceivedSRTP;
+    u_int32_t initialROC; // assumed for the first SRTP packet
+    u_int32_t highestSRTCPIndex;
+    u_int64_t srtcpReplayWindow;
+    Boolean haveReceivedSRTCP;
+  };
+  static SSRCState* lookupSSRCState(HashTable* table, u_int32_t ssrc, Boolean createIfNotFound);
+  static Boolean isReplay(u_int64_t index, u_int64_t highestIndex, u_int64_t replayWindow);
+  static void noteReceivedIndex(u_int64_t index, u_int64_t& highestIndex, u_int64_t& replayWindow);
+
+  Boolean deriveKeys(MIKEYState const& mikeyState);
+  Boolean computeAuthenticationTag(Boolean forSRTCP, u_int8_t const* data, unsigned dataSize,
+				   u_int8_t const* roc, u_int8_t* resultTag);
+  Boolean aesGCM(Boolean forSRTCP, Boolean encrypt, u_int8_t const* iv, u_int8_t const* aad1, unsigned aad1Size,
+		 u_int8_t const* aad2, unsigned aad2Size, u_int8_t* data, unsigned dataSize, u_int8_t* tag);
+  void computeIV(Boolean forSRTCP, u_int32_t ssrc, u_int64_t index, u_int8_t* iv);
+
+private:
+  MIKEYState::SRTPProfile fProfile;
+  Boolean fEncryptSRTP, fEncryptSRTCP;
+  u_int8_t fSRTPSessionSalt[14], fSRTCPSessionSalt[14];
+  // The (OpenSSL) cipher contexts - one for each direction, for each of SRTP and SRTCP - and HMAC contexts:
+  void* fSRTPEncryptCtx;
+  void* fSRTPDecryptCtx;
+  void* fSRTCPEncryptCtx;
+  void* fSRTCPDecryptCtx;
+  void* fSRTPAuthCtx;
+  void* fSRTCPAuthCtx;
+  HashTable* fOutgoingSSRCs;
+  HashTable* fIncomingSSRCs;
+  unsigned fNumAuthenticationFailures, fNumReplayedPackets;
+};
+
+#endif
@@ -59,8 +59,9 @@ public:
                               ServerMediaSession *&resultSession);
 
   /// @brief 遍历该ServerMediaSession中的所有ServerMediaSubSession生成sdp信息
+  /// @param addressFamily 客户端的地址族(AF_INET或AF_INET6)，决定SDP中"o="和"c="行使用IP4还是IP6
   /// @return 返回一个字符串，里面包含sdp信息
-  char *generateSDPDescription(); // based on the entire session
+  char *generateSDPDescription(int addressFamily = AF_INET); // based on the entire session
                                   // Note: The caller is responsible for freeing the returned string
 
   /// @brief 返回会话流名字，同样也是资源路径
@@ -165,21 +166,22 @@ public:
   char const *trackId();
 
   /// @brief 生成该源的sdp，纯虚函数具体实现在子类OnDemandServerMediaSubsesion
-  virtual char const *sdpLines() = 0;
+  /// @param addressFamily 客户端的地址族(AF_INET或AF_INET6)
+  virtual char const *sdpLines(int addressFamily) = 0;
   /// @brief 获取流参数，纯虚函数，具体实现在子类OnDemandServerMediaSubsesion
-  virtual void getStreamParameters(unsigned clientSessionId,           // in
-                                   netAddressBits clientAddress,       // in
-                                   Port const &clientRTPPort,          // in
-                                   Port const &clientRTCPPort,         // in
-                                   int tcpSocketNum,                   // in (-1 means use UDP, not TCP)
-                                   unsigned char rtpChannelId,         // in (used if TCP)
-                                   unsigned char rtcpChannelId,        // in (used if TCP)
-                                   netAddressBits &destinationAddress, // in out
-                                   u_int8_t &destinationTTL,           // in out
-                                   Boolean &isMulticast,               // out
-                                   Port &serverRTPPort,                // out
-                                   Port &serverRTCPPort,               // out
-                                   void *&streamToken                  // out
+  virtual void getStreamParameters(unsigned clientSessionId,                     // in
+                                   struct sockaddr_storage const &clientAddress, // in
+                                   Port const &clientRTPPort,                    // in
+                                   Port const &clientRTCPPort,                   // in
+                                   int tcpSocketNum,                             // in (-1 means use UDP, not TCP)
+                                   unsigned char rtpChannelId,                   // in (used if TCP)
+                                   unsigned char rtcpChannelId,                  // in (used if TCP)
+                                   struct sockaddr_storage &destinationAddress,  // in out (null means use "clientAddress")
+                                   u_int8_t &destinationTTL,                     // in out
+                                   Boolean &isMulticast,                         // out
+                                   Port &serverRTPPort,                          // out
+                                   Port &serverRTCPPort,                         // out
+                                   void *&streamToken                            // out
                                    ) = 0;
 
   /// @brief 开始播放，具体实现在子类
@@ -219,6 +221,12 @@ public:
 
   virtual FramedSource *getStreamSource(void *streamToken);
 
+  virtual Boolean usesSRTP() const; // True iff our SDP description offers SRTP keys (by default: False)
+  virtual u_int8_t *getMIKEYMessage(void *streamToken, unsigned &messageSize);
+  // Returns a MIKEY message (to be delete[]d by the caller) with the SRTP keys for "streamToken"'s stream - including
+  // the stream's SSRC and current 'rollover counter' (which a client that joins a shared stream late needs) - or NULL,
+  // if the stream doesn't use SRTP.
+
   // Returns pointers to the "RTPSink" and "RTCPInstance" objects for "streamToken".
   // (This can be useful if you want to get the associated 'Groupsock' objects, for example.)
   // You must not delete these objects, or start/stop playing them; instead, that is done
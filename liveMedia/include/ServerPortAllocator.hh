@@ -0,0 +1,61 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A process-wide pool of server (RTP,RTCP) port number pairs, from which "OnDemandServerMediaSubsession"s take the
+// port numbers for each new stream - in O(1) time, rather than by trying to bind successive port numbers.
+// C++ header
+
+#ifndef _SERVER_PORT_ALLOCATOR_HH
+#define _SERVER_PORT_ALLOCATOR_HH
+
+#ifndef _NET_ADDRESS_HH
+#include "NetAddress.hh"
+#endif
+
+// Each pair is an even port number (for RTP), and the next (odd) port number (for RTCP).  Free pairs are kept in a
+// FIFO queue, so that a pair that has just been released is not reused until all other free pairs have been.
+// Unlike most "liveMedia" objects, the pool is shared by all threads (and "UsageEnvironment"s), so it does its own
+// locking.
+// The default range of port numbers (inclusive).  ("OnDemandServerMediaSubsession"'s default "initialPortNum" is 6970.)
+#define SERVER_PORT_ALLOCATOR_DEFAULT_FIRST_PORT_NUM 6970
+#define SERVER_PORT_ALLOCATOR_DEFAULT_LAST_PORT_NUM 65535
+
+class ServerPortAllocator {
+public:
+  static Boolean setPortRange(portNumBits firstPortNum, portNumBits lastPortNum);
+      // Sets the range of port numbers (inclusive) that will be allocated.  ("firstPortNum" is rounded up to be
+      // even.)  This should be called before any streams are set up; it fails if any port pairs are currently
+      // allocated.  If it's never called, the range is SERVER_PORT_ALLOCATOR_DEFAULT_FIRST_PORT_NUM through
+      // SERVER_PORT_ALLOCATOR_DEFAULT_LAST_PORT_NUM.
+  static void getPortRange(portNumBits& firstPortNum, portNumBits& lastPortNum);
+  static Boolean isInPortRange(portNumBits portNum);
+      // An "OnDemandServerMediaSubsession" takes its port numbers from the pool only if its "initialPortNum" is in the
+      // range; if not, it tries successive port numbers, beginning with "initialPortNum" (as it did before the pool).
+
+  static Boolean allocatePortPair(portNumBits& rtpPortNum);
+      // Removes a pair from the pool, returning its (even) RTP port number (in host byte order) in "rtpPortNum".
+      // Returns False iff the pool is empty.
+      // Note that the port numbers are not known to be free; if they can't be bound (because some other program is
+      // using them), the caller should release the pair, and try again.
+  static void releasePortPair(portNumBits rtpPortNum);
+      // Returns a pair (previously allocated) to the pool
+
+  static unsigned numFreePortPairs();
+  static unsigned numAllocatedPortPairs();
+};
+
+#endif
@@ -38,6 +38,9 @@ public:
     //   "StreamReplicator" object by calling "Medium::close()" on it - but you must do so only when "numReplicas()" returns 0.
 
   FramedSource* createStreamReplica();
+    // If replicas are asked (e.g., by a "RTPRateController") to change their bitrate, we ask our input source for the
+    // highest bitrate that any replica wants.  To deliver less than this to particular replicas, put a filter that drops
+    // frames (e.g., a "H264or5VideoLayerDropper") after each replica.
 
   unsigned numReplicas() const { return fNumReplicas; }
 
@@ -57,6 +60,7 @@ private:
   void getNextFrame(StreamReplica* replica);
   void deactivateStreamReplica(StreamReplica* replica);
   void removeStreamReplica(StreamReplica* replica);
+  void noteTargetBitrates();
 
 private:
   static void afterGettingFrame(void* clientData, unsigned frameSize,
@@ -80,5 +84,8 @@ private:
   StreamReplica* fMasterReplica; // the first replica that requests each frame.  We use its buffer when copying to the others.
   StreamReplica* fReplicasAwaitingCurrentFrame; // other than the 'master' replica
   StreamReplica* fReplicasAwaitingNextFrame; // replicas that have already received the current frame, and have asked for the next
+
+  StreamReplica* fAllReplicas;
+  unsigned fTargetBitrate; // the (maximum) target bitrate that we last passed on to our input source; 0 if none
 };
 #endif
@@ -0,0 +1,121 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// The TLS state of a TCP connection, used to implement RTSP-over-TLS ("rtsps://"), on both the server and client side
+// C++ header
+
+#ifndef _TLS_STATE_HH
+#define _TLS_STATE_HH
+
+#ifndef _USAGE_ENVIRONMENT_HH
+#include "UsageEnvironment.hh"
+#endif
+#ifndef _NET_ADDRESS_HH
+#include "NetAddress.hh"
+#endif
+
+// The default port number for "rtsps://" URLs:
+#define RTSPS_DEFAULT_PORT_NUM 322
+
+// The TLS itself is done by OpenSSL.  If this code was compiled with "NO_OPENSSL" defined, "createNew...()" always fail.
+
+// A server's certificate and private key, and the TLS settings (including the key that encrypts its session tickets)
+// that are shared by all of its connections:
+class TLSServerContext {
+public:
+  static TLSServerContext* createNew(UsageEnvironment& env, char const* certFileName, char const* privateKeyFileName);
+      // "certFileName" is a PEM file containing the server's certificate (optionally followed by its chain).
+      // Returns NULL (after setting "resultMsg") if the files can't be read, or don't match.
+  virtual ~TLSServerContext();
+
+protected:
+  TLSServerContext(void* sslCtx); // called only by "createNew()"
+
+private:
+  friend class TLSState;
+  void* fSSLCtx; // an OpenSSL "SSL_CTX*"
+};
+
+// The TLS state of a (non-blocking) TCP connection.  Each such object is registered - by socket number - with its
+// environment, so that code that reads or writes the socket (e.g., "RTPInterface", for RTP/RTCP-over-TCP) can find it
+// using "lookup()".  The object does not own the socket; its owner must delete it before closing the socket.
+class TLSState {
+public:
+  static Boolean isSupported();
+
+  static TLSState* createNewForServer(UsageEnvironment& env, int socketNum, TLSServerContext& context);
+  static TLSState* createNewForClient(UsageEnvironment& env, int socketNum,
+				      char const* serverName, portNumBits serverPortNum, Boolean verifyServer = True);
+      // "serverName" is the server's host name (or address), as it appears in its URL.  Unless "verifyServer" is False,
+      // the handshake fails if the server's certificate isn't trusted (by the system's default CA certificates), or
+      // isn't for "serverName".
+      // If we've previously connected to this server (name and port), then the handshake will try to resume that session
+      // (using the session ticket that the server gave us), which avoids most of the handshake's public-key crypto.
+  virtual ~TLSState();
+
+  static TLSState* lookup(UsageEnvironment& env, int socketNum);
+      // Returns the TLS state that's registered for "socketNum", or NULL if the socket isn't using TLS
+
+  typedef void (HandshakeCompletionFunc)(void* clientData, Boolean success);
+  void startHandshake(HandshakeCompletionFunc* completionFunc, void* clientData);
+      // Performs the handshake - from the event loop - using background handling on our socket.  Once it's done, the
+      // socket's background handling is turned off, and "completionFunc" is called (always from the event loop, never
+      // from within this function).  If "success" is False, the caller should delete us (and close the socket).
+
+  // These each return the number of (unencrypted) bytes read or written, 0 if the operation would block, or -1 if the
+  // connection has failed or been closed.  "read()" reads as much as it can (up to "bufferSize" bytes).  If "write()"
+  // returns 0, it must be called again later with (at least) the same data:
+  int read(u_int8_t* buffer, unsigned bufferSize);
+  int write(u_int8_t const* data, unsigned dataSize);
+
+  Boolean hasBufferedData() const;
+      // True iff we've already read - from the socket - data that hasn't yet been returned by "read()".  ("select()"
+      // doesn't tell us about such data.)
+  void continueReadingIfBuffered(TaskScheduler::BackgroundHandlerProc* handlerProc, void* clientData);
+      // If "hasBufferedData()", arranges for "handlerProc" to be called (from the event loop) to read it.  (This call
+      // is cancelled if we get deleted first.)
+
+  Boolean sessionWasResumed() const;
+  int socketNum() const { return fSocketNum; }
+
+  static void forgetClientSessions(UsageEnvironment& env);
+      // Discards the TLS sessions that clients have saved (for later resumption) in this environment
+
+protected:
+  TLSState(UsageEnvironment& env, int socketNum, void* ssl, Boolean isServer); // called only by "createNew...()"
+
+private:
+  static void handshakeHandler(void* instance, int mask);
+  void continueHandshake();
+  void completeHandshake(Boolean success);
+  static void pendingReadHandler(void* instance);
+
+private:
+  friend class TLSTables;
+  UsageEnvironment& fEnv;
+  int fSocketNum;
+  void* fSSL; // an OpenSSL "SSL*"
+  Boolean fIsServer;
+  char* fSessionCacheKey; // client only: identifies the server, for saving our session
+  HandshakeCompletionFunc* fHandshakeCompletionFunc;
+  void* fHandshakeCompletionClientData;
+  TaskToken fPendingReadTask;
+  TaskScheduler::BackgroundHandlerProc* fPendingReadHandlerProc;
+  void* fPendingReadClientData;
+};
+
+#endif
@@ -0,0 +1,133 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// A 'FramedSource' that delivers frames that are pushed into it - from one or more other threads (e.g., encoder
+// or capture threads) - through a bounded, lock-free queue.
+// C++ header
+
+#ifndef _THREADED_FRAME_QUEUE_SOURCE_HH
+#define _THREADED_FRAME_QUEUE_SOURCE_HH
+
+#ifndef _FRAMED_SOURCE_HH
+#include "FramedSource.hh"
+#endif
+
+#include <atomic>
+
+// A reference-counted frame, that can be pushed into one or more "ThreadedFrameQueueSource"s.
+// Unlike most other "liveMedia" objects, it may be used from any thread.
+class QueuedFrame {
+public:
+  static QueuedFrame* createNew(unsigned maxSize);
+      // The new frame has a reference count of 1 (owned by the caller)
+
+  void addReference() { fReferenceCount.fetch_add(1, std::memory_order_relaxed); }
+  void release(); // deletes the frame when the last reference is released
+  unsigned referenceCount() const { return fReferenceCount.load(std::memory_order_acquire); }
+      // A producer can reuse a frame (rather than allocating a new one) once this is back to 1
+
+  unsigned char* data() const { return fData; }
+  unsigned maxSize() const { return fMaxSize; }
+
+  unsigned frameSize;
+  struct timeval presentationTime; // if {0,0}, then the time of delivery is used instead
+  unsigned durationInMicroseconds;
+
+private:
+  QueuedFrame(unsigned maxSize);
+  ~QueuedFrame();
+
+private:
+  friend class ThreadedFrameQueueSource;
+  std::atomic<unsigned> fReferenceCount;
+  unsigned char* fData;
+  unsigned fMaxSize;
+  struct timeval fTimeQueued; // used to measure queueing latency
+};
+
+class ThreadedFrameQueueSource: public FramedSource {
+public:
+  enum OverflowPolicy {
+    DROP_NEW_FRAMES,   // "pushFrame()" fails (and the new frame is dropped) while the queue is full
+    DROP_QUEUED_FRAMES // as above, but the next delivery also discards all but the most recently queued frame,
+                       // so that the receiver catches up with the producer
+  };
+
+  static ThreadedFrameQueueSource* createNew(UsageEnvironment& env, unsigned queueSize = 64,
+					     OverflowPolicy overflowPolicy = DROP_NEW_FRAMES);
+      // "queueSize" (the maximum number of queued frames) is rounded up to a power of 2.
+      // Returns NULL if no 'event trigger' could be created for the new source.
+
+  // The following two functions - unlike other "liveMedia" functions - may be called from any thread
+  // (including several threads at once).  They never block:
+  Boolean pushFrame(QueuedFrame* frame);
+      // Queues "frame" (adding a reference to it) for delivery.  Returns False iff the queue was full.
+  Boolean pushFrame(unsigned char const* data, unsigned frameSize,
+		    struct timeval presentationTime, unsigned durationInMicroseconds = 0);
+      // As above, but copies the data into a new "QueuedFrame"
+
+  // Statistics, describing frames that have passed through the queue:
+  unsigned numFramesQueued() const { return fNumFramesQueued.load(std::memory_order_relaxed); }
+  unsigned numFramesDropped() const { return fNumFramesDropped.load(std::memory_order_relaxed); }
+  unsigned numFramesDelivered() const { return fNumFramesDelivered; }
+  unsigned averageLatencyInMicroseconds() const; // from "pushFrame()" until delivery
+  unsigned maxLatencyInMicroseconds() const { return fMaxLatencyInMicroseconds; }
+  void resetLatencyStats();
+
+protected:
+  ThreadedFrameQueueSource(UsageEnvironment& env, EventTriggerId eventTriggerId,
+			   unsigned queueSize, OverflowPolicy overflowPolicy);
+      // called only by createNew(), or by subclass constructors
+  virtual ~ThreadedFrameQueueSource();
+
+private:
+  // redefined virtual functions:
+  virtual void doGetNextFrame();
+
+private:
+  Boolean enqueue(QueuedFrame* frame);
+  QueuedFrame* dequeue();
+
+  static void deliverFrame0(void* clientData);
+  void deliverFrame();
+
+private:
+  EventTriggerId fEventTriggerId;
+  OverflowPolicy fOverflowPolicy;
+
+  // The queue itself: a bounded array of 'cells', each tagged with a sequence number (which
+  // tells producers and the consumer whether the cell is ready to be written or read):
+  struct Cell {
+    std::atomic<unsigned> sequence;
+    QueuedFrame* frame;
+  };
+  Cell* fCells;
+  unsigned fQueueMask; // the queue size - 1
+  std::atomic<unsigned> fEnqueuePosition; // shared by all producers
+  unsigned fDequeuePosition; // used only by the consumer (i.e., our event loop)
+
+  std::atomic<bool> fHaveOverflowed;
+  std::atomic<bool> fWakeupIsPending; // avoids calling "triggerEvent()" for every queued frame
+
+  std::atomic<unsigned> fNumFramesQueued, fNumFramesDropped;
+  unsigned fNumFramesDelivered;
+  unsigned fNumLatencyMeasurements;
+  u_int64_t fTotalLatencyInMicroseconds;
+  unsigned fMaxLatencyInMicroseconds;
+};
+
+#endif
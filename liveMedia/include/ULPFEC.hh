@@ -0,0 +1,157 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2019 Live Networks, Inc.  All rights reserved.
+// XOR-based forward error correction for RTP (RFC 5109 'ULP FEC'), with row/column protection
+// C++ header
+
+#ifndef _ULP_FEC_HH
+#define _ULP_FEC_HH
+
+#ifndef _BOOLEAN_HH
+#include "Boolean.hh"
+#endif
+#ifndef _NET_COMMON_H
+#include "NetCommon.h"
+#endif
+
+// The media packets are thought of as being laid out - in order of sequence number - in a matrix of "numColumns" (L)
+// columns and "numRows" (D) rows.  A 'row' FEC packet protects each row (of L consecutive packets), and - if D > 1 -
+// a 'column' FEC packet protects each column (of D packets, each L apart).  Any one lost packet in a row or column can
+// be recovered; with both row and column FEC, the receiver can also recover many patterns of multiple losses (including
+// any burst of up to L consecutive losses).
+// The FEC packets are RFC 5109 FEC packets (using only protection level 0, which protects the whole packet).  They're
+// sent in the same RTP flow as the media packets, but with a different payload type (and their own SSRC and sequence
+// numbers).  Because a RFC 5109 mask covers at most 48 packets, L must be <= 48, and - for column FEC - (D-1)*L < 48.
+
+#define ULPFEC_MAX_MASK_BITS 48
+
+// XORs "numBytes" bytes of "from" into "to" (using SIMD instructions, where available).  (On x86, with GCC or Clang,
+// AVX2 is used if the CPU supports it, even if the library wasn't built with "-mavx2".)
+void ulpfecXOR(u_int8_t* to, u_int8_t const* from, unsigned numBytes);
+
+class ULPFECEncoder {
+public:
+  static Boolean parametersAreValid(unsigned numColumns, unsigned numRows, Boolean rowFEC);
+
+  ULPFECEncoder(unsigned char fecPayloadType, unsigned numColumns, unsigned numRows = 1, Boolean rowFEC = True);
+      // Check the parameters first, using "parametersAreValid()"
+  virtual ~ULPFECEncoder();
+
+  static unsigned const maxOverheadSize = 12/*RTP hdr*/ + 10/*FEC hdr*/ + 8/*FEC level 0 hdr, with long mask*/;
+      // A FEC packet is at most this much bigger than the largest media packet that it protects
+
+  void noteMediaPacket(u_int8_t const* packet, unsigned packetSize);
+      // Called for each (complete) RTP packet that's sent, in order
+
+  u_int8_t const* nextFECPacket(unsigned& resultPacketSize);
+      // Returns the next FEC packet that's ready to be sent (or NULL if none).  Call this (repeatedly, until it returns
+      // NULL) after each call to "noteMediaPacket()".  The result remains valid until the next call.  (It has the spare
+      // bytes before and after it that "RTPInterface::sendPacketInPlace()" needs.)
+
+  unsigned char fecPayloadType() const { return fFECPayloadType; }
+  unsigned numColumns() const { return fNumColumns; }
+  unsigned numRows() const { return fNumRows; }
+  unsigned numFECPacketsGenerated() const { return fNumFECPacketsGenerated; }
+
+private:
+  struct Accumulator {
+    u_int8_t bits[8]; // the XOR of each protected packet's first 8 bytes, and 16-bit payload length
+    u_int8_t* payload; // the XOR of each protected packet's payload (the bytes after its 12-byte RTP header)
+    unsigned payloadSize, payloadCapacity;
+    u_int16_t snBase;
+    u_int64_t mask; // bit (47-i) means 'protects packet snBase+i', as in the RFC 5109 mask
+    u_int32_t timestamp; // the RTP timestamp of the most recently protected packet
+    Boolean isReady;
+  };
+  void resetAccumulator(Accumulator& acc);
+  void addToAccumulator(Accumulator& acc, u_int8_t const* packet, unsigned packetSize);
+  void startNewMatrix();
+
+private:
+  unsigned char fFECPayloadType;
+  unsigned fNumColumns, fNumRows;
+  Boolean fRowFEC;
+  u_int32_t fSSRC;
+  u_int16_t fSeqNo;
+  Boolean fHaveNextMediaSeqNum;
+  u_int16_t fNextMediaSeqNum;
+  unsigned fPositionInMatrix; // the index (row*L + column) of the next media packet
+  Accumulator fRowAccumulator;
+  Accumulator* fColumnAccumulators; // an array of "numColumns"; only if numRows > 1
+  u_int8_t* fPacketBuf;
+  unsigned fPacketBufSize;
+  unsigned fNumFECPacketsGenerated;
+};
+
+class ULPFECDecoder {
+public:
+  ULPFECDecoder(unsigned char fecPayloadType);
+  virtual ~ULPFECDecoder();
+
+  unsigned char fecPayloadType() const { return fFECPayloadType; }
+
+  void noteMediaPacket(u_int8_t const* packet, unsigned packetSize);
+      // Called for each (complete) media RTP packet that's received.  (Don't call it for recovered packets.)
+  void noteFECPacket(u_int8_t const* packet, unsigned packetSize);
+      // Called for each RTP packet that's received with our FEC payload type
+
+  u_int8_t const* nextRecoveredPacket(unsigned& resultPacketSize);
+      // Returns the next (complete) media RTP packet that has been recovered (or NULL if none).  Call this (repeatedly,
+      // until it returns NULL) after each call to "noteMediaPacket()" or "noteFECPacket()".  The result remains valid
+      // until the next call to any of these functions.
+
+  unsigned numFECPacketsReceived() const { return fNumFECPacketsReceived; }
+  unsigned numPacketsRecovered() const { return fNumPacketsRecovered; }
+
+private:
+  enum { HISTORY_SIZE = 256, MAX_PENDING_FEC_PACKETS = 64, MAX_RECOVERED_QUEUE_SIZE = 64 };
+  struct StoredPacket {
+    u_int8_t* data;
+    unsigned size, capacity;
+    u_int16_t seqNum;
+    Boolean isValid;
+  };
+  struct PendingFECPacket {
+    u_int8_t* data; // the FEC packet, from its FEC header onwards
+    unsigned size, capacity;
+    u_int16_t snBase;
+    u_int64_t mask;
+    Boolean isValid;
+  };
+
+  static void storeInto(u_int8_t*& data, unsigned& size, unsigned& capacity, u_int8_t const* packet, unsigned packetSize);
+  StoredPacket* lookupMediaPacket(u_int16_t seqNum);
+  void storeMediaPacket(u_int8_t const* packet, unsigned packetSize);
+  void tryRecovery();
+  Boolean recover(PendingFECPacket& fecPacket, u_int16_t missingSeqNum);
+
+private:
+  unsigned char fFECPayloadType;
+  StoredPacket fHistory[HISTORY_SIZE]; // the recently received (or recovered) media packets, indexed by seq num
+  PendingFECPacket fPending[MAX_PENDING_FEC_PACKETS];
+  unsigned fNumPending;
+  Boolean fHaveHighestSeqNum;
+  u_int16_t fHighestSeqNum; // of the media packets that we've seen
+  u_int32_t fMediaSSRC;
+  u_int16_t fRecoveredQueue[MAX_RECOVERED_QUEUE_SIZE]; // the seq nums of recovered packets, not yet returned
+  unsigned fRecoveredQueueHead, fRecoveredQueueSize;
+  u_int8_t* fRecoveryBuf;
+  unsigned fRecoveryBufSize;
+  unsigned fNumFECPacketsReceived, fNumPacketsRecovered;
+};
+
+#endif
@@ -102,9 +102,23 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "AudioInputDevice.hh"
 #include "WAVAudioFileSource.hh"
 #include "StreamReplicator.hh"
+#include "H264or5VideoLayerDropper.hh"
+#include "ThreadedFrameQueueSource.hh"
+#include "PoolAllocator.hh"
+#include "ServerPortAllocator.hh"
+#include "RTPRateController.hh"
+#include "ULPFEC.hh"
+#include "MIKEY.hh"
+#include "SRTPCryptographicContext.hh"
+#include "TLSState.hh"
+#include "RecordingWriter.hh"
+#include "RecordingArchive.hh"
+#include "RollingRecordingSink.hh"
 #include "RTSPRegisterSender.hh"
 #include "RTSPServerSupportingHTTPStreaming.hh"
+#include "RTSPServerWithWorkerThreads.hh"
 #include "RTSPClient.hh"
+#include "RTSPClientManager.hh"
 #include "SIPClient.hh"
 #include "QuickTimeFileSink.hh"
 #include "QuickTimeGenericRTPSource.hh"
@@ -113,6 +127,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MPEG4VideoFileServerMediaSubsession.hh"
 #include "H264VideoFileServerMediaSubsession.hh"
 #include "H265VideoFileServerMediaSubsession.hh"
+#include "ArchiveServerMediaSubsession.hh"
 #include "WAVAudioFileServerMediaSubsession.hh"
 #include "AMRAudioFileServerMediaSubsession.hh"
 #include "AMRAudioFileSource.hh"
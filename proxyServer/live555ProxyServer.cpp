@@ -35,9 +35,48 @@ char* password = NULL;
 Boolean proxyREGISTERRequests = False;
 char* usernameForREGISTER = NULL;
 char* passwordForREGISTER = NULL;
+unsigned numWorkerThreads = 0;
+unsigned backEndIdleTimeoutSeconds = 0; // 0 means: stay connected to each back-end server
+
+// The "rtsp://" URLs (from the command line) of the streams to be proxied:
+char** proxiedStreamURLs;
+int numProxiedStreams;
+
+static void makeStreamName(char* streamName, int streamNum) {
+  if (numProxiedStreams == 1) {
+    sprintf(streamName, "%s", "proxyStream"); // there's just one stream; give it this name
+  } else {
+    sprintf(streamName, "proxyStream-%d", streamNum); // there's more than one stream; distinguish them by name
+  }
+}
+
+static UsageEnvironment* createWorkerEnvironment() {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  return BasicUsageEnvironment::createNew(*scheduler);
+}
+
+static void setUpWorkerStreams(RTSPServerWithWorkerThreads& ourServer, unsigned workerNum,
+			       RTSPServer& workerServer, void* /*clientData*/) {
+  // Each worker thread proxies every "numWorkerThreads"th stream:
+  for (int i = 1 + workerNum; i <= numProxiedStreams; i += numWorkerThreads) {
+    char streamName[30];
+    makeStreamName(streamName, i);
+
+    ServerMediaSession* sms
+      = ProxyServerMediaSession::createNew(workerServer.envir(), &workerServer,
+					   proxiedStreamURLs[i-1], streamName,
+					   username, password, tunnelOverHTTPPortNum, verbosityLevel,
+					   -1, NULL, backEndIdleTimeoutSeconds);
+    workerServer.addServerMediaSession(sms);
+    ourServer.assignStream(streamName, workerNum);
+  }
+}
 
 static RTSPServer* createRTSPServer(Port port) {
-  if (proxyREGISTERRequests) {
+  if (numWorkerThreads > 0) {
+    return RTSPServerWithWorkerThreads::createNew(*env, port, numWorkerThreads,
+						  createWorkerEnvironment, setUpWorkerStreams, NULL, authDB);
+  } else if (proxyREGISTERRequests) {
     return RTSPServerWithREGISTERProxying::createNew(*env, port, authDB, authDBForREGISTER, 65, streamRTPOverTCP, verbosityLevel, username, password);
   } else {
     return RTSPServer::createNew(*env, port, authDB);
@@ -51,6 +90,8 @@ void usage() {
        << " [-p <rtspServer-port>]"
        << " [-u <username> <password>]"
        << " [-R] [-U <username-for-REGISTER> <password-for-REGISTER>]"
+       << " [-w <number-of-worker-threads>]"
+       << " [-i <back-end-idle-timeout-seconds>]"
        << " <rtsp-url-1> ... <rtsp-url-n>\n";
   exit(1);
 }
@@ -151,6 +192,28 @@ int main(int argc, char** argv) {
       break;
     }
 
+    case 'w': { // divide the proxied streams among this many threads (each with its own event loop)
+      if (argc > 2 && sscanf(argv[2], "%u", &numWorkerThreads) == 1 && numWorkerThreads > 0) {
+	++argv; --argc;
+	break;
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage();
+      break;
+    }
+
+    case 'i': { // connect to each back-end server only 'on demand', closing the connection after this many idle seconds
+      if (argc > 2 && sscanf(argv[2], "%u", &backEndIdleTimeoutSeconds) == 1 && backEndIdleTimeoutSeconds > 0) {
+	++argv; --argc;
+	break;
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage();
+      break;
+    }
+
     default: {
       usage();
       break;
@@ -165,11 +228,18 @@ int main(int argc, char** argv) {
   for (i = 1; i < argc; ++i) {
     if (strncmp(argv[i], "rtsp://", 7) != 0) usage();
   }
+  proxiedStreamURLs = &argv[1];
+  numProxiedStreams = argc - 1;
+
   // Do some additional checking for invalid command-line argument combinations:
   if (authDBForREGISTER != NULL && !proxyREGISTERRequests) {
     *env << "The '-U <username> <password>' option can be used only with -R\n";
     usage();
   }
+  if (numWorkerThreads > 0 && proxyREGISTERRequests) {
+    *env << "The -w and -R options cannot both be used!\n";
+    usage();
+  }
   if (streamRTPOverTCP) {
     if (tunnelOverHTTPPortNum > 0) {
       *env << "The -t and -T options cannot both be used!\n";
@@ -209,25 +279,29 @@ int main(int argc, char** argv) {
     exit(1);
   }
 
-  // Create a proxy for each "rtsp://" URL specified on the command line:
-  for (i = 1; i < argc; ++i) {
-    char const* proxiedStreamURL = argv[i];
+  // Create a proxy for each "rtsp://" URL specified on the command line.
+  // (If we're using worker threads, then they've already done this.)
+  for (i = 1; i <= numProxiedStreams; ++i) {
+    char const* proxiedStreamURL = proxiedStreamURLs[i-1];
     char streamName[30];
-    if (argc == 2) {
-      sprintf(streamName, "%s", "proxyStream"); // there's just one stream; give it this name
-    } else {
-      sprintf(streamName, "proxyStream-%d", i); // there's more than one stream; distinguish them by name
+    makeStreamName(streamName, i);
+
+    if (numWorkerThreads == 0) {
+      ServerMediaSession* sms
+	= ProxyServerMediaSession::createNew(*env, rtspServer,
+					     proxiedStreamURL, streamName,
+					     username, password, tunnelOverHTTPPortNum, verbosityLevel,
+					     -1, NULL, backEndIdleTimeoutSeconds);
+      rtspServer->addServerMediaSession(sms);
     }
-    ServerMediaSession* sms
-      = ProxyServerMediaSession::createNew(*env, rtspServer,
-					   proxiedStreamURL, streamName,
-					   username, password, tunnelOverHTTPPortNum, verbosityLevel);
-    rtspServer->addServerMediaSession(sms);
 
-    char* proxyStreamURL = rtspServer->rtspURL(sms);
+    char* proxyStreamURLPrefix = rtspServer->rtspURLPrefix();
     *env << "RTSP stream, proxying the stream \"" << proxiedStreamURL << "\"\n";
-    *env << "\tPlay this stream using the URL: " << proxyStreamURL << "\n";
-    delete[] proxyStreamURL;
+    *env << "\tPlay this stream using the URL: " << proxyStreamURLPrefix << streamName << "\n";
+    delete[] proxyStreamURLPrefix;
+  }
+  if (numWorkerThreads > 0) {
+    *env << "(These streams are divided among " << numWorkerThreads << " worker threads)\n";
   }
 
   if (proxyREGISTERRequests) {
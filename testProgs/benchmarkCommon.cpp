@@ -0,0 +1,105 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2019, Live Networks, Inc.  All rights reserved
+// A common framework, used for the benchmark (and self-checking test) applications
+// Implementation
+
+#include "benchmarkCommon.hh"
+
+UsageEnvironment* env;
+char const* progName;
+
+static char const* ourCountName;
+static char const* ourOtherArgs;
+
+void setUpBenchmark(int& argc, char**& argv, char const* countName, unsigned& count, char const* otherArgs) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  progName = argv[0];
+  ourCountName = countName;
+  ourOtherArgs = otherArgs;
+  while (argc > 2 && argv[1][0] == '-') {
+    if (argv[1][1] == 'n' && argv[1][2] == '\0' && sscanf(argv[2], "%u", &count) == 1 && count > 0) {
+    } else {
+      benchmarkUsage();
+    }
+    argv += 2; argc -= 2;
+  }
+}
+
+void benchmarkUsage() {
+  *env << "Usage: " << progName << " [-n <" << ourCountName << ">]";
+  if (ourOtherArgs[0] != '\0') *env << " " << ourOtherArgs;
+  *env << "\n";
+  exit(1);
+}
+
+void tearDownBenchmark() {
+  TaskScheduler* scheduler = &env->taskScheduler();
+  env->reclaim(); env = NULL;
+  delete scheduler;
+}
+
+double secondsSince(struct timeval const& startTime) {
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  return (timeNow.tv_sec - startTime.tv_sec) + (timeNow.tv_usec - startTime.tv_usec)/1000000.0;
+}
+
+void printDouble(double value) {
+  char buf[30];
+  sprintf(buf, "%.2f", value);
+  *env << buf;
+}
+
+void setRTPHeader(u_int8_t* packet, u_int8_t payloadType, Boolean markerBit,
+		  u_int16_t seqNum, u_int32_t timestamp, u_int32_t ssrc) {
+  packet[0] = 0x80; packet[1] = payloadType | (markerBit ? 0x80 : 0);
+  packet[2] = seqNum>>8; packet[3] = (u_int8_t)seqNum;
+  packet[4] = timestamp>>24; packet[5] = timestamp>>16; packet[6] = timestamp>>8; packet[7] = (u_int8_t)timestamp;
+  packet[8] = ssrc>>24; packet[9] = ssrc>>16; packet[10] = ssrc>>8; packet[11] = (u_int8_t)ssrc;
+}
+
+static unsigned numChecks = 0, numFailures = 0;
+
+void check(Boolean condition, char const* description, char const* param) {
+  ++numChecks;
+  if (!condition) {
+    ++numFailures;
+    *env << "FAILED: " << description << " (" << param << ")\n";
+  }
+}
+
+void check(Boolean condition, char const* description, unsigned param) {
+  char paramStr[20];
+  sprintf(paramStr, "%u", param);
+  check(condition, description, paramStr);
+}
+
+int reportChecks() {
+  *env << numChecks << " checks; " << numFailures << " failed\n";
+  return numFailures == 0 ? 0 : 1;
+}
+
+portNumBits serverPortNum(RTSPServer& server) {
+  // Get it from the server's URL prefix ("rtsp://<address>:<port>/"):
+  char* urlPrefix = server.rtspURLPrefix();
+  char const* portNumStr = strrchr(urlPrefix, ':');
+  portNumBits const portNum = portNumStr == NULL ? 554 : (portNumBits)atoi(portNumStr + 1);
+  delete[] urlPrefix;
+  return portNum;
+}
@@ -0,0 +1,48 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2019, Live Networks, Inc.  All rights reserved
+// A common framework, used for the benchmark (and self-checking test) applications
+// Interfaces
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+
+extern UsageEnvironment* env;
+extern char const* progName;
+
+extern void setUpBenchmark(int& argc, char**& argv, char const* countName, unsigned& count,
+			   char const* otherArgs = "");
+  // Creates "env", then removes any "-n <countName>" options (which set "count") from the front of the command line.
+  // "otherArgs" describes the remaining arguments, for the usage message.
+extern void benchmarkUsage(); // prints a usage message, then exits
+extern void tearDownBenchmark();
+
+extern double secondsSince(struct timeval const& startTime);
+extern void printDouble(double value); // to "*env", with 2 decimal places
+
+extern void setRTPHeader(u_int8_t* packet, u_int8_t payloadType, Boolean markerBit,
+			 u_int16_t seqNum, u_int32_t timestamp, u_int32_t ssrc);
+  // Fills in the 12-byte header of a RTP packet (with no CSRCs or extension)
+
+// For the self-checking tests:
+extern void check(Boolean condition, char const* description, char const* param = "");
+extern void check(Boolean condition, char const* description, unsigned param);
+  // Counts a check; if "condition" is False, also counts - and reports - a failure
+extern int reportChecks(); // prints the number of checks and failures; returns the program's exit status
+
+extern portNumBits serverPortNum(RTSPServer& server);
+  // Returns the port number of a server that was created with port number 0 (i.e., with one chosen by the OS)
@@ -42,6 +42,7 @@ void continueAfterPLAY(RTSPClient* client, int resultCode, char* resultString);
 void continueAfterTEARDOWN(RTSPClient* client, int resultCode, char* resultString);
 
 void createOutputFiles(char const* periodicFilenameSuffix);
+MediaSink* createRollingRecordingSink(MediaSubsession* subsession, char const* outFileName);
 void createPeriodicOutputFiles();
 void setupStreams();
 void closeMediaSinks();
@@ -72,6 +73,7 @@ TaskToken periodicFileOutputTask = NULL;
 Boolean createReceivers = True;
 Boolean outputQuickTimeFile = False;
 Boolean generateMP4Format = False;
+unsigned mp4FragmentDurationMS = 0;
 QuickTimeFileSink* qtOut = NULL;
 Boolean outputAVIFile = False;
 AVIFileSink* aviOut = NULL;
@@ -123,6 +125,8 @@ unsigned qosMeasurementIntervalMS = 0; // 0 means: Don't output QOS data
 char* userAgent = NULL;
 unsigned fileOutputInterval = 0; // seconds
 unsigned fileOutputSecondsSoFar = 0; // seconds
+unsigned rollingSegmentDurationSeconds = 0; // 0 means: Don't record into segment files
+unsigned rollingRetentionSeconds = 0; // 0 means: Keep all segment files
 Boolean createHandlerServerForREGISTERCommand = False;
 portNumBits handlerServerForREGISTERCommandPortNum = 0;
 HandlerServerForREGISTERCommand* handlerServerForREGISTERCommand;
@@ -134,14 +138,14 @@ struct timeval startTime;
 
 void usage() {
   *env << "Usage: " << progName
-       << " [-p <startPortNum>] [-r|-q|-4|-i] [-a|-v] [-V] [-d <duration>] [-D <max-inter-packet-gap-time> [-c] [-S <offset>] [-n] [-O]"
+       << " [-p <startPortNum>] [-r|-q|-4|-j <mp4-fragment-duration-ms>|-i] [-a|-v] [-V] [-d <duration>] [-D <max-inter-packet-gap-time> [-c] [-S <offset>] [-n] [-O]"
 	   << (controlConnectionUsesTCP ? " [-t|-T <http-port>]" : "")
        << " [-u <username> <password>"
 	   << (allowProxyServers ? " [<proxy-server> [<proxy-server-port>]]" : "")
        << "]" << (supportCodecSelection ? " [-A <audio-codec-rtp-payload-format-code>|-M <mime-subtype-name>]" : "")
        << " [-s <initial-seek-time>]|[-U <absolute-seek-time>] [-E <absolute-seek-end-time>] [-z <scale>] [-g user-agent]"
        << " [-k <username-for-REGISTER> <password-for-REGISTER>]"
-       << " [-P <interval-in-seconds>] [-K]"
+       << " [-P <interval-in-seconds>] [-K] [-x <segment-duration-seconds> [-X <retention-seconds>]]"
        << " [-w <width> -h <height>] [-f <frames-per-second>] [-y] [-H] [-Q [<measurement-interval>]] [-F <filename-prefix>] [-b <file-sink-buffer-size>] [-B <input-socket-buffer-size>] [-I <input-interface-ip-address>] [-m] [<url>|-R [<port-num>]] (or " << progName << " -o [-V] <url>)\n";
   shutdown();
 }
@@ -201,13 +205,23 @@ int main(int argc, char** argv) {
       break;
     }
 
+    case 'j': { // output a fragmented 'mp4'-format file, with fragments of the specified duration (in ms)
+      if (sscanf(argv[2], "%u", &mp4FragmentDurationMS) != 1 || mp4FragmentDurationMS == 0) {
+	usage();
+      }
+      outputQuickTimeFile = True;
+      generateMP4Format = True;
+      ++argv; --argc;
+      break;
+    }
+
     case 'i': { // output an AVI file (to stdout)
       outputAVIFile = True;
       break;
     }
 
     case 'I': { // specify input interface...
-      NetAddressList addresses(argv[2]);
+      NetAddressList addresses(argv[2], AF_INET); // "ReceivingInterfaceAddr" is IPv4
       if (addresses.numAddresses() == 0) {
 	*env << "Failed to find network address for \"" << argv[2] << "\"";
 	break;
@@ -276,6 +290,22 @@ int main(int argc, char** argv) {
       break;
     }
 
+    case 'x': { // record each stream into a sequence of segment files, each of (about) this duration
+      if (sscanf(argv[2], "%u", &rollingSegmentDurationSeconds) != 1 || rollingSegmentDurationSeconds == 0) {
+	usage();
+      }
+      ++argv; --argc;
+      break;
+    }
+
+    case 'X': { // delete segment files once they're older than this
+      if (sscanf(argv[2], "%u", &rollingRetentionSeconds) != 1) {
+	usage();
+      }
+      ++argv; --argc;
+      break;
+    }
+
     case 'm': { // output multiple files - one for each frame
       oneFilePerFrame = True;
       break;
@@ -829,7 +859,8 @@ void createOutputFiles(char const* periodicFilenameSuffix) {
 					   packetLossCompensate,
 					   syncStreams,
 					   generateHintTracks,
-					   generateMP4Format);
+					   generateMP4Format,
+					   mp4FragmentDurationMS);
       if (qtOut == NULL) {
 	*env << "Failed to create a \"QuickTimeFileSink\" for outputting to \""
 	     << outFileName << "\": " << env->getResultMsg() << "\n";
@@ -863,7 +894,7 @@ void createOutputFiles(char const* periodicFilenameSuffix) {
       if (subsession->readSource() == NULL) continue; // was not initiated
       
       // Create an output file for each desired stream:
-      if (singleMedium == NULL || periodicFilenameSuffix[0] != '\0') {
+      if (singleMedium == NULL || periodicFilenameSuffix[0] != '\0' || rollingSegmentDurationSeconds > 0) {
 	// Output file name is
 	//     "<filename-prefix><medium_name>-<codec_name>-<counter><periodicFilenameSuffix>"
 	static unsigned streamCounter = 0;
@@ -877,46 +908,51 @@ void createOutputFiles(char const* periodicFilenameSuffix) {
       }
 
       FileSink* fileSink = NULL;
-      Boolean createOggFileSink = False; // by default
-      if (strcmp(subsession->mediumName(), "video") == 0) {
-	if (strcmp(subsession->codecName(), "H264") == 0) {
-	  // For H.264 video stream, we use a special sink that adds 'start codes',
-	  // and (at the start) the SPS and PPS NAL units:
-	  fileSink = H264VideoFileSink::createNew(*env, outFileName,
-						  subsession->fmtp_spropparametersets(),
-						  fileSinkBufferSize, oneFilePerFrame);
-	} else if (strcmp(subsession->codecName(), "H265") == 0) {
-	  // For H.265 video stream, we use a special sink that adds 'start codes',
-	  // and (at the start) the VPS, SPS, and PPS NAL units:
-	  fileSink = H265VideoFileSink::createNew(*env, outFileName,
-						  subsession->fmtp_spropvps(),
-						  subsession->fmtp_spropsps(),
-						  subsession->fmtp_sproppps(),
-						  fileSinkBufferSize, oneFilePerFrame);
-	} else if (strcmp(subsession->codecName(), "THEORA") == 0) {
-	  createOggFileSink = True;
+      if (rollingSegmentDurationSeconds > 0) {
+	// Record into a sequence of segment files, each starting at a key frame:
+	subsession->sink = createRollingRecordingSink(subsession, outFileName);
+      } else {
+	Boolean createOggFileSink = False; // by default
+	if (strcmp(subsession->mediumName(), "video") == 0) {
+	  if (strcmp(subsession->codecName(), "H264") == 0) {
+	    // For H.264 video stream, we use a special sink that adds 'start codes',
+	    // and (at the start) the SPS and PPS NAL units:
+	    fileSink = H264VideoFileSink::createNew(*env, outFileName,
+						    subsession->fmtp_spropparametersets(),
+						    fileSinkBufferSize, oneFilePerFrame);
+	  } else if (strcmp(subsession->codecName(), "H265") == 0) {
+	    // For H.265 video stream, we use a special sink that adds 'start codes',
+	    // and (at the start) the VPS, SPS, and PPS NAL units:
+	    fileSink = H265VideoFileSink::createNew(*env, outFileName,
+						    subsession->fmtp_spropvps(),
+						    subsession->fmtp_spropsps(),
+						    subsession->fmtp_sproppps(),
+						    fileSinkBufferSize, oneFilePerFrame);
+	  } else if (strcmp(subsession->codecName(), "THEORA") == 0) {
+	    createOggFileSink = True;
+	  }
+	} else if (strcmp(subsession->mediumName(), "audio") == 0) {
+	  if (strcmp(subsession->codecName(), "AMR") == 0 ||
+	      strcmp(subsession->codecName(), "AMR-WB") == 0) {
+	    // For AMR audio streams, we use a special sink that inserts AMR frame hdrs:
+	    fileSink = AMRAudioFileSink::createNew(*env, outFileName,
+						   fileSinkBufferSize, oneFilePerFrame);
+	  } else if (strcmp(subsession->codecName(), "VORBIS") == 0 ||
+		     strcmp(subsession->codecName(), "OPUS") == 0) {
+	    createOggFileSink = True;
+	  }
 	}
-      } else if (strcmp(subsession->mediumName(), "audio") == 0) {
-	if (strcmp(subsession->codecName(), "AMR") == 0 ||
-	    strcmp(subsession->codecName(), "AMR-WB") == 0) {
-	  // For AMR audio streams, we use a special sink that inserts AMR frame hdrs:
-	  fileSink = AMRAudioFileSink::createNew(*env, outFileName,
-						 fileSinkBufferSize, oneFilePerFrame);
-	} else if (strcmp(subsession->codecName(), "VORBIS") == 0 ||
-		   strcmp(subsession->codecName(), "OPUS") == 0) {
-	  createOggFileSink = True;
+	if (createOggFileSink) {
+	  fileSink = OggFileSink
+	    ::createNew(*env, outFileName,
+			subsession->rtpTimestampFrequency(), subsession->fmtp_config());
+	} else if (fileSink == NULL) {
+	  // Normal case:
+	  fileSink = FileSink::createNew(*env, outFileName,
+					 fileSinkBufferSize, oneFilePerFrame);
 	}
+	subsession->sink = fileSink;
       }
-      if (createOggFileSink) {
-	fileSink = OggFileSink
-	  ::createNew(*env, outFileName,
-		      subsession->rtpTimestampFrequency(), subsession->fmtp_config());
-      } else if (fileSink == NULL) {
-	// Normal case:
-	fileSink = FileSink::createNew(*env, outFileName,
-				       fileSinkBufferSize, oneFilePerFrame);
-      }
-      subsession->sink = fileSink;
 
       if (subsession->sink == NULL) {
 	*env << "Failed to create FileSink for \"" << outFileName
@@ -930,7 +966,8 @@ void createOutputFiles(char const* periodicFilenameSuffix) {
 	       << "\" subsession to \"" << outFileName << "\"\n";
 	}
 	
-	if (strcmp(subsession->mediumName(), "video") == 0 &&
+	if (fileSink != NULL &&
+	    strcmp(subsession->mediumName(), "video") == 0 &&
 	    strcmp(subsession->codecName(), "MP4V-ES") == 0 &&
 	    subsession->fmtp_config() != NULL) {
 	  // For MPEG-4 video RTP streams, the 'config' information
@@ -962,6 +999,33 @@ void createOutputFiles(char const* periodicFilenameSuffix) {
   }
 }
 
+MediaSink* createRollingRecordingSink(MediaSubsession* subsession, char const* outFileName) {
+  // Segment file names are "<outFileName>-<start-time>" (with a suffix for H.264 and H.265 video):
+  char segmentFileNamePrefix[1000];
+  snprintf(segmentFileNamePrefix, sizeof segmentFileNamePrefix, "%s-", outFileName);
+
+  RollingRecordingParameters params;
+  params.segmentDurationSeconds = rollingSegmentDurationSeconds;
+  params.retentionSeconds = rollingRetentionSeconds;
+
+  if (strcmp(subsession->mediumName(), "video") == 0) {
+    if (strcmp(subsession->codecName(), "H264") == 0) {
+      return RollingRecordingSink::createNew(*env, segmentFileNamePrefix, ".264", params,
+					     fileSinkBufferSize, 264,
+					     subsession->fmtp_spropparametersets());
+    } else if (strcmp(subsession->codecName(), "H265") == 0) {
+      return RollingRecordingSink::createNew(*env, segmentFileNamePrefix, ".265", params,
+					     fileSinkBufferSize, 265,
+					     subsession->fmtp_spropvps(),
+					     subsession->fmtp_spropsps(),
+					     subsession->fmtp_sproppps());
+    }
+  }
+
+  // Otherwise, each frame may begin a new segment:
+  return RollingRecordingSink::createNew(*env, segmentFileNamePrefix, "", params, fileSinkBufferSize);
+}
+
 void createPeriodicOutputFiles() {
   // Create a filename suffix that notes the time interval that's being recorded:
   char periodicFileNameSuffix[100];
@@ -64,7 +64,7 @@ void getSDPDescription(RTSPClient::responseHandler* afterFunc) {
   extern char* proxyServerName;
   if (proxyServerName != NULL) {
     // Tell the SIP client about the proxy:
-    NetAddressList addresses(proxyServerName);
+    NetAddressList addresses(proxyServerName, AF_INET);
     if (addresses.numAddresses() == 0) {
       ourSIPClient->envir() << "Failed to find network address for \"" << proxyServerName << "\"\n";
     } else {
@@ -46,7 +46,7 @@ int main(int argc, char** argv) {
   // synchronously, in a loop, so we don't need to set up an asynchronous
   // event handler like we do in most of the other test programs.)
   unsigned packetSize;
-  struct sockaddr_in fromAddress;
+  struct sockaddr_storage fromAddress;
   while (inputGroupsock.handleRead(packet, maxPacketSize,
 				   packetSize, fromAddress)) {
     printf("\n[packet from %s (%d bytes)]\n", AddressString(fromAddress).val(), packetSize);
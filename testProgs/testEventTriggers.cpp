@@ -0,0 +1,187 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2019, Live Networks, Inc.  All rights reserved
+// A stress test for event triggers ("TaskScheduler::triggerEvent()"), called from many threads at once:
+// - Each thread owns some of the triggers.  In each round, it fires each of its triggers, then waits until the event
+//   loop has handled them all.  A trigger that's never handled (a 'lost wakeup') makes its thread time out.
+// - Then, every thread fires the same few (shared) triggers, many times each.  Each trigger must be handled
+//   (at least once) after the last time that it was fired.
+// The program exits with status 1 if any trigger was not delivered.
+// main program
+
+#include "benchmarkCommon.hh"
+#include <atomic>
+#include <thread>
+
+unsigned numTriggers = 2000; // default; can be changed with "-n"
+unsigned const numThreads = 50;
+unsigned const numRounds = 200;
+unsigned const numSharedTriggers = 16;
+unsigned const numSharedFiringsPerThread = 20000;
+double const timeoutSeconds = 10.0;
+
+struct TriggerRecord {
+  EventTriggerId id;
+  std::atomic<unsigned> numFirings; // incremented - by the firing thread - just before each "triggerEvent()"
+  std::atomic<unsigned> numFiringsHandled; // the value of "numFirings" that the handler last saw
+  std::atomic<unsigned> numHandlerCalls;
+};
+
+TriggerRecord* triggers;
+TriggerRecord* sharedTriggers;
+std::atomic<unsigned> numThreadsTimedOut(0);
+std::atomic<unsigned> numThreadsRunning(0);
+EventTriggerId allThreadsDoneTrigger;
+char volatile doneFlag;
+
+static void handleTrigger(void* clientData) {
+  TriggerRecord* trigger = (TriggerRecord*)clientData;
+  trigger->numFiringsHandled = trigger->numFirings.load();
+  ++trigger->numHandlerCalls;
+}
+
+static void handleAllThreadsDone(void* /*clientData*/) {
+  doneFlag = 1;
+}
+
+static void noteThreadDone() {
+  if (--numThreadsRunning == 0) env->taskScheduler().triggerEvent(allThreadsDoneTrigger, NULL);
+}
+
+static void fire(TriggerRecord& trigger) {
+  ++trigger.numFirings;
+  env->taskScheduler().triggerEvent(trigger.id, &trigger);
+}
+
+static Boolean hasBeenHandled(TriggerRecord& trigger) {
+  return trigger.numFiringsHandled.load() == trigger.numFirings.load();
+}
+
+struct timeval checkStartTime;
+
+static void checkSharedTriggers(void* /*clientData*/) {
+  Boolean allHandled = True;
+  for (unsigned i = 0; i < numSharedTriggers; ++i) {
+    if (!hasBeenHandled(sharedTriggers[i])) allHandled = False;
+  }
+  if (allHandled || secondsSince(checkStartTime) > timeoutSeconds) {
+    doneFlag = 1;
+  } else {
+    env->taskScheduler().scheduleDelayedTask(1000, checkSharedTriggers, NULL);
+  }
+}
+
+static void ownedTriggersThread(unsigned threadIndex) {
+  for (unsigned round = 0; round < numRounds; ++round) {
+    for (unsigned t = threadIndex; t < numTriggers; t += numThreads) fire(triggers[t]);
+
+    struct timeval startTime;
+    gettimeofday(&startTime, NULL);
+    for (unsigned t = threadIndex; t < numTriggers; t += numThreads) {
+      while (!hasBeenHandled(triggers[t])) {
+	if (secondsSince(startTime) > timeoutSeconds) {
+	  ++numThreadsTimedOut;
+	  noteThreadDone();
+	  return; // give up on this thread's triggers
+	}
+	std::this_thread::yield();
+      }
+    }
+  }
+  noteThreadDone();
+}
+
+static void sharedTriggersThread(unsigned threadIndex) {
+  for (unsigned i = 0; i < numSharedFiringsPerThread; ++i) fire(sharedTriggers[(threadIndex + i)%numSharedTriggers]);
+  noteThreadDone();
+}
+
+// Runs "numThreads" threads (each running "threadFunc"), while the event loop handles their triggers:
+static double runThreads(void (*threadFunc)(unsigned)) {
+  struct timeval startTime;
+  gettimeofday(&startTime, NULL);
+  numThreadsRunning = numThreads;
+  std::thread* threads = new std::thread[numThreads];
+  for (unsigned i = 0; i < numThreads; ++i) threads[i] = std::thread(threadFunc, i);
+
+  doneFlag = 0;
+  env->taskScheduler().doEventLoop(&doneFlag);
+  for (unsigned i = 0; i < numThreads; ++i) threads[i].join();
+  delete[] threads;
+  return secondsSince(startTime);
+}
+
+static Boolean createTriggers(TriggerRecord* records, unsigned num) {
+  for (unsigned i = 0; i < num; ++i) {
+    records[i].id = env->taskScheduler().createEventTrigger(handleTrigger);
+    if (records[i].id == 0) {
+      *env << "Failed to create trigger #" << i << "\n";
+      return False;
+    }
+    records[i].numFirings = records[i].numFiringsHandled = records[i].numHandlerCalls = 0;
+  }
+  return True;
+}
+
+static void reportHandlerCalls(TriggerRecord* records, unsigned num, double numFirings, double elapsedSeconds) {
+  double numHandlerCalls = 0;
+  for (unsigned i = 0; i < num; ++i) numHandlerCalls += records[i].numHandlerCalls;
+  *env << (unsigned)numFirings << " firings, " << (unsigned)numHandlerCalls << " handler calls in ";
+  printDouble(elapsedSeconds);
+  *env << " seconds (" << (unsigned)(numFirings/elapsedSeconds) << " firings/second)";
+}
+
+int main(int argc, char** argv) {
+  setUpBenchmark(argc, argv, "number-of-triggers", numTriggers);
+  if (argc != 1) benchmarkUsage();
+
+  triggers = new TriggerRecord[numTriggers];
+  sharedTriggers = new TriggerRecord[numSharedTriggers];
+  allThreadsDoneTrigger = env->taskScheduler().createEventTrigger(handleAllThreadsDone);
+  if (allThreadsDoneTrigger == 0 || !createTriggers(triggers, numTriggers)
+      || !createTriggers(sharedTriggers, numSharedTriggers)) {
+    exit(1);
+  }
+
+  // Owned triggers:
+  double elapsedSeconds = runThreads(ownedTriggersThread);
+  *env << numTriggers << " triggers, " << numThreads << " threads, " << numRounds << " rounds:\t";
+  reportHandlerCalls(triggers, numTriggers, (double)numTriggers*numRounds, elapsedSeconds);
+  *env << "; " << numThreadsTimedOut.load() << " threads timed out\n";
+
+  // Shared triggers:
+  elapsedSeconds = runThreads(sharedTriggersThread);
+  *env << numSharedTriggers << " shared triggers, " << numThreads << " threads:\t";
+  reportHandlerCalls(sharedTriggers, numSharedTriggers, (double)numThreads*numSharedFiringsPerThread, elapsedSeconds);
+  // Some of the triggers might not have been handled yet, so let the event loop run until they have (or we time out):
+  gettimeofday(&checkStartTime, NULL);
+  doneFlag = 0;
+  checkSharedTriggers(NULL);
+  env->taskScheduler().doEventLoop(&doneFlag);
+  unsigned numUnhandled = 0;
+  for (unsigned i = 0; i < numSharedTriggers; ++i) {
+    if (!hasBeenHandled(sharedTriggers[i])) ++numUnhandled;
+  }
+  *env << "; " << numUnhandled << " not handled after their last firing\n";
+
+  for (unsigned i = 0; i < numTriggers; ++i) env->taskScheduler().deleteEventTrigger(triggers[i].id);
+  for (unsigned i = 0; i < numSharedTriggers; ++i) env->taskScheduler().deleteEventTrigger(sharedTriggers[i].id);
+  env->taskScheduler().deleteEventTrigger(allThreadsDoneTrigger);
+  delete[] triggers; delete[] sharedTriggers;
+  tearDownBenchmark();
+
+  return numThreadsTimedOut > 0 || numUnhandled > 0 ? 1 : 0;
+}
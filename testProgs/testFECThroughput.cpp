@@ -0,0 +1,222 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2019, Live Networks, Inc.  All rights reserved
+// A benchmark for the RFC 5109 FEC implementation (see "ULPFEC.hh"):
+// - The XOR kernel ("ulpfecXOR()") is compared with a simple byte-by-byte loop.
+// - "ULPFECEncoder" is run over synthetic RTP packets, for several row/column matrix sizes.
+// - The FEC packets are then given - along with the media packets that survive simulated (random, or burst) packet
+//   loss - to "ULPFECDecoder", and each recovered packet is checked against the original.
+// main program
+
+#include "benchmarkCommon.hh"
+
+unsigned numPackets = 100000; // default; can be changed with "-n"
+
+////////// The XOR kernel //////////
+
+static void byteLoopXOR(u_int8_t* to, u_int8_t const* from, unsigned numBytes) {
+  for (unsigned i = 0; i < numBytes; ++i) to[i] ^= from[i];
+}
+
+static double xorThroughput(void (*xorFunc)(u_int8_t*, u_int8_t const*, unsigned), unsigned bufferSize) {
+  u_int8_t* to = new u_int8_t[bufferSize];
+  u_int8_t* from = new u_int8_t[bufferSize + 1];
+  for (unsigned i = 0; i < bufferSize; ++i) { to[i] = (u_int8_t)i; from[i] = (u_int8_t)(i*7); }
+
+  unsigned const numIterations = 2000000000/bufferSize;
+  struct timeval startTime;
+  gettimeofday(&startTime, NULL);
+  for (unsigned i = 0; i < numIterations; ++i) {
+    (*xorFunc)(to, &from[i&1], bufferSize); // alternate the alignment of "from"
+  }
+  double elapsedSeconds = secondsSince(startTime);
+
+  // Make sure that the result is used (so the compiler doesn't optimize the loop away):
+  unsigned checksum = 0;
+  for (unsigned i = 0; i < bufferSize; ++i) checksum += to[i];
+  if (checksum == 0xFFFFFFFF) *env << " ";
+  delete[] to; delete[] from;
+
+  return ((double)numIterations*bufferSize)/elapsedSeconds/1e9; // GBytes/second
+}
+
+static void benchmarkXOR() {
+  unsigned const bufferSizes[] = { 64, 200, 1400, 8192 };
+  for (unsigned i = 0; i < sizeof bufferSizes/sizeof bufferSizes[0]; ++i) {
+    double byteLoop = xorThroughput(byteLoopXOR, bufferSizes[i]);
+    double kernel = xorThroughput(ulpfecXOR, bufferSizes[i]);
+    *env << "XOR " << bufferSizes[i] << " bytes:\tbyte loop ";
+    printDouble(byteLoop);
+    *env << " GB/s; ulpfecXOR() ";
+    printDouble(kernel);
+    *env << " GB/s (";
+    printDouble(kernel/byteLoop);
+    *env << "x)\n";
+  }
+}
+
+////////// Synthetic RTP packets //////////
+
+u_int8_t** packets = NULL;
+unsigned* packetSizes = NULL;
+u_int16_t const firstSeqNum = 65000; // so that the sequence numbers wrap around
+
+static void makePackets() {
+  packets = new u_int8_t*[numPackets];
+  packetSizes = new unsigned[numPackets];
+  u_int32_t const ssrc = our_random32();
+  for (unsigned i = 0; i < numPackets; ++i) {
+    unsigned size = 12 + 100 + our_random()%1300;
+    u_int8_t* packet = packets[i] = new u_int8_t[size];
+    packetSizes[i] = size;
+
+    // (Each 'frame' is 10 packets; the marker bit is set on its last one:)
+    setRTPHeader(packet, 96, i%10 == 9, (u_int16_t)(firstSeqNum + i), (i/10)*3000, ssrc);
+    for (unsigned j = 12; j < size; ++j) packet[j] = (u_int8_t)our_random();
+  }
+}
+
+////////// Encoding and decoding //////////
+
+struct FECPacket {
+  u_int8_t* data;
+  unsigned size;
+  unsigned afterMediaPacket; // the index of the media packet that was sent just before this
+};
+
+static unsigned encode(unsigned numColumns, unsigned numRows, FECPacket*& fecPackets) {
+  ULPFECEncoder encoder(127, numColumns, numRows);
+  unsigned maxNumFECPackets = numPackets + numPackets/numColumns + 1;
+  fecPackets = new FECPacket[maxNumFECPackets];
+  unsigned numFECPackets = 0;
+  double numFECBytes = 0, numMediaBytes = 0;
+
+  struct timeval startTime;
+  gettimeofday(&startTime, NULL);
+  for (unsigned i = 0; i < numPackets; ++i) {
+    encoder.noteMediaPacket(packets[i], packetSizes[i]);
+    numMediaBytes += packetSizes[i];
+
+    unsigned fecPacketSize;
+    u_int8_t const* fecPacket;
+    while ((fecPacket = encoder.nextFECPacket(fecPacketSize)) != NULL) {
+      FECPacket& p = fecPackets[numFECPackets++];
+      p.data = new u_int8_t[fecPacketSize];
+      memcpy(p.data, fecPacket, fecPacketSize);
+      p.size = fecPacketSize;
+      p.afterMediaPacket = i;
+      numFECBytes += fecPacketSize;
+    }
+  }
+  double elapsedSeconds = secondsSince(startTime);
+
+  *env << "L=" << numColumns << " D=" << numRows << ":\tencoded " << numPackets << " packets in ";
+  printDouble(elapsedSeconds*1000);
+  *env << " ms (" << (unsigned)(numPackets/elapsedSeconds) << " packets/second, ";
+  printDouble(numMediaBytes*8/elapsedSeconds/1e9);
+  *env << " Gbits/second); " << numFECPackets << " FEC packets, overhead ";
+  printDouble(100.0*numFECBytes/numMediaBytes);
+  *env << "%\n";
+  return numFECPackets;
+}
+
+// Loss models: Each returns True if packet number "i" (of the combined media+FEC packet stream) is to be lost.
+static Boolean randomLoss(unsigned /*i*/, unsigned percentage) {
+  return our_random()%100 < percentage;
+}
+
+static Boolean burstLoss(unsigned i, unsigned burstLength) {
+  return i%100 < burstLength; // lose "burstLength" consecutive packets out of every 100
+}
+
+static void decode(unsigned numColumns, unsigned numRows, FECPacket* fecPackets, unsigned numFECPackets,
+		   char const* lossDescription, Boolean (*lossFunc)(unsigned, unsigned), unsigned lossParam) {
+  ULPFECDecoder decoder(127);
+  Boolean* received = new Boolean[numPackets];
+  for (unsigned i = 0; i < numPackets; ++i) received[i] = False;
+  unsigned numLost = 0, numRecovered = 0, numBad = 0, streamIndex = 0;
+
+  struct timeval startTime;
+  gettimeofday(&startTime, NULL);
+  unsigned f = 0;
+  for (unsigned i = 0; i < numPackets; ++i) {
+    // Send media packet "i", followed by any FEC packets that were generated after it:
+    if ((*lossFunc)(streamIndex++, lossParam)) {
+      ++numLost;
+    } else {
+      received[i] = True;
+      decoder.noteMediaPacket(packets[i], packetSizes[i]);
+    }
+    for (; f < numFECPackets && fecPackets[f].afterMediaPacket == i; ++f) {
+      if (!(*lossFunc)(streamIndex++, lossParam)) decoder.noteFECPacket(fecPackets[f].data, fecPackets[f].size);
+    }
+
+    unsigned recoveredPacketSize;
+    u_int8_t const* recoveredPacket;
+    while ((recoveredPacket = decoder.nextRecoveredPacket(recoveredPacketSize)) != NULL) {
+      // Check the recovered packet against the original:
+      // (Sequence numbers wrap around, so find the packet's index relative to packet "i":)
+      u_int16_t seqNum = (recoveredPacket[2]<<8)|recoveredPacket[3];
+      unsigned index = i - (u_int16_t)(firstSeqNum + i - seqNum);
+      if (index >= numPackets || received[index] || recoveredPacketSize != packetSizes[index]
+	  || memcmp(recoveredPacket, packets[index], recoveredPacketSize) != 0) {
+	++numBad;
+      } else {
+	received[index] = True;
+	++numRecovered;
+      }
+    }
+  }
+  double elapsedSeconds = secondsSince(startTime);
+
+  *env << "L=" << numColumns << " D=" << numRows << ", " << lossDescription << " " << lossParam << ":\tlost "
+       << numLost << " media packets; recovered " << numRecovered << " (residual loss ";
+  printDouble(100.0*(numLost - numRecovered)/numPackets);
+  *env << "%) in ";
+  printDouble(elapsedSeconds*1000);
+  *env << " ms";
+  if (numBad > 0) *env << "; ERROR: " << numBad << " recovered packets were incorrect!";
+  *env << "\n";
+  delete[] received;
+}
+
+int main(int argc, char** argv) {
+  setUpBenchmark(argc, argv, "number-of-packets", numPackets);
+  if (argc != 1) benchmarkUsage();
+
+  benchmarkXOR();
+
+  makePackets();
+  unsigned const matrixSizes[][2] = { { 10, 1 }, { 5, 5 }, { 8, 6 }, { 12, 4 } };
+  for (unsigned m = 0; m < sizeof matrixSizes/sizeof matrixSizes[0]; ++m) {
+    unsigned numColumns = matrixSizes[m][0], numRows = matrixSizes[m][1];
+    FECPacket* fecPackets;
+    unsigned numFECPackets = encode(numColumns, numRows, fecPackets);
+
+    decode(numColumns, numRows, fecPackets, numFECPackets, "random loss %", randomLoss, 1);
+    decode(numColumns, numRows, fecPackets, numFECPackets, "random loss %", randomLoss, 5);
+    decode(numColumns, numRows, fecPackets, numFECPackets, "burst length", burstLoss, numColumns);
+
+    for (unsigned f = 0; f < numFECPackets; ++f) delete[] fecPackets[f].data;
+    delete[] fecPackets;
+  }
+
+  for (unsigned i = 0; i < numPackets; ++i) delete[] packets[i];
+  delete[] packets; delete[] packetSizes;
+
+  tearDownBenchmark();
+  return 0;
+}
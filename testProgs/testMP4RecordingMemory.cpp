@@ -0,0 +1,175 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2019, Live Networks, Inc.  All rights reserved
+// A benchmark of the memory and CPU used by "QuickTimeFileSink" for long (simulated) recordings:
+// A 25 frames/second H.264 video track, plus a 48 kHz AAC audio track, is recorded - as fast as possible, from
+// synthetic frames - first as a 'fragmented' MP4 file (with 2-second fragments), then as a regular MP4 file (whose
+// metadata is kept in memory until the end).  For each, we report the CPU time, and the process's peak memory use.
+// (Because the peak can only grow, the fragmented recording - which should use much less memory - is done first.)
+// main program
+
+#include "benchmarkCommon.hh"
+#include <sys/resource.h>
+
+unsigned numHours = 24; // default; can be changed with "-n"
+char const* outputFileName = "/dev/null";
+
+unsigned const videoFPS = 25;
+double const audioFramesPerSecond = 48000/1024.0;
+
+// A source that ignores its (RTP) input, and instead delivers synthetic frames, with increasing presentation times,
+// until "numFramesLeft" (shared by all tracks) reaches 0:
+class SyntheticFrameSource: public FramedFilter {
+public:
+  static SyntheticFrameSource* createNew(UsageEnvironment& env, FramedSource* inputSource, Boolean isVideo) {
+    return new SyntheticFrameSource(env, inputSource, isVideo);
+  }
+
+  static u_int64_t numFramesLeft;
+
+private:
+  SyntheticFrameSource(UsageEnvironment& env, FramedSource* inputSource, Boolean isVideo)
+    : FramedFilter(env, inputSource), fIsVideo(isVideo), fFrameNum(0) {
+    fNextPresentationTime.tv_sec = 1000000; fNextPresentationTime.tv_usec = 0;
+  }
+
+  virtual void doGetNextFrame() {
+    if (numFramesLeft == 0) {
+      handleClosure();
+      return;
+    }
+    --numFramesLeft;
+    ++fFrameNum;
+
+    unsigned frameSize = fIsVideo ? 100 + (fFrameNum*37)%400 : 30 + fFrameNum%5;
+    if (frameSize > fMaxSize) frameSize = fMaxSize;
+    memset(fTo, 0x41, frameSize);
+    if (fIsVideo) fTo[0] = fFrameNum%50 == 1 ? 0x65/*IDR slice*/ : 0x41/*non-IDR slice*/;
+    fFrameSize = frameSize;
+    fNumTruncatedBytes = 0;
+
+    fPresentationTime = fNextPresentationTime;
+    fNextPresentationTime.tv_usec += fIsVideo ? 1000000/videoFPS : (unsigned)(1000000/audioFramesPerSecond);
+    if (fNextPresentationTime.tv_usec >= 1000000) {
+      ++fNextPresentationTime.tv_sec;
+      fNextPresentationTime.tv_usec -= 1000000;
+    }
+
+    // Deliver the frame via the event loop (rather than recursively):
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)FramedSource::afterGetting, this);
+  }
+
+  virtual void doStopGettingFrames() {
+    FramedSource::doStopGettingFrames(); // (our input source was never started)
+  }
+
+private:
+  Boolean fIsVideo;
+  unsigned fFrameNum;
+  struct timeval fNextPresentationTime;
+};
+
+u_int64_t SyntheticFrameSource::numFramesLeft = 0;
+
+char const* sdpDescription =
+  "v=0\r\n"
+  "o=- 1 1 IN IP4 127.0.0.1\r\n"
+  "s=Simulated recording\r\n"
+  "t=0 0\r\n"
+  "m=video 0 RTP/AVP 96\r\n"
+  "c=IN IP4 127.0.0.1\r\n"
+  "a=rtpmap:96 H264/90000\r\n"
+  "a=fmtp:96 packetization-mode=1;sprop-parameter-sets=Z0IAKeKQFAe2AtwEBAaQeJEV,aM48gA==\r\n"
+  "a=framerate:25\r\n"
+  "m=audio 0 RTP/AVP 97\r\n"
+  "c=IN IP4 127.0.0.1\r\n"
+  "a=rtpmap:97 MPEG4-GENERIC/48000/2\r\n"
+  "a=fmtp:97 streamtype=5;profile-level-id=15;mode=AAC-hbr;sizelength=13;indexlength=3;indexdeltalength=3;config=1190\r\n";
+
+char volatile doneFlag;
+
+static void afterRecording(void* /*clientData*/) {
+  doneFlag = 1;
+}
+
+static double cpuSeconds() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec/1000000.0 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec/1000000.0;
+}
+
+static long peakMemoryKBytes() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss; // (in kBytes, on Linux)
+}
+
+static void record(unsigned fragmentDurationMS) {
+  MediaSession* session = MediaSession::createNew(*env, sdpDescription);
+  if (session == NULL) {
+    *env << "Failed to create a MediaSession: " << env->getResultMsg() << "\n";
+    exit(1);
+  }
+  MediaSubsessionIterator iter(*session);
+  MediaSubsession* subsession;
+  while ((subsession = iter.next()) != NULL) {
+    if (!subsession->initiate()) {
+      *env << "Failed to initiate the \"" << subsession->mediumName() << "\" subsession: " << env->getResultMsg() << "\n";
+      exit(1);
+    }
+    Boolean isVideo = strcmp(subsession->mediumName(), "video") == 0;
+    subsession->addFilter(SyntheticFrameSource::createNew(*env, subsession->readSource(), isVideo));
+  }
+
+  SyntheticFrameSource::numFramesLeft = (u_int64_t)(numHours*3600*(videoFPS + audioFramesPerSecond));
+  u_int64_t const numFrames = SyntheticFrameSource::numFramesLeft;
+  double startCPUSeconds = cpuSeconds();
+  QuickTimeFileSink* sink = QuickTimeFileSink::createNew(*env, *session, outputFileName, 20000, 240, 180, videoFPS,
+							 False, False, False, True, fragmentDurationMS);
+  if (sink == NULL) {
+    *env << "Failed to create a QuickTimeFileSink: " << env->getResultMsg() << "\n";
+    exit(1);
+  }
+  doneFlag = 0;
+  sink->startPlaying(afterRecording, NULL);
+  env->taskScheduler().doEventLoop(&doneFlag);
+  long peakKBytes = peakMemoryKBytes(); // before the sink writes its metadata, and is closed
+  Medium::close(sink);
+  double elapsedCPUSeconds = cpuSeconds() - startCPUSeconds;
+
+  if (fragmentDurationMS > 0) {
+    *env << "fragmented MP4 (" << fragmentDurationMS << " ms fragments):";
+  } else {
+    *env << "regular MP4:";
+  }
+  *env << "\t" << numHours << " hours, " << (unsigned)numFrames << " frames: CPU ";
+  printDouble(elapsedCPUSeconds);
+  *env << " seconds; peak memory " << (unsigned)(peakKBytes/1024) << " MBytes\n";
+
+  Medium::close(session);
+}
+
+int main(int argc, char** argv) {
+  setUpBenchmark(argc, argv, "number-of-hours", numHours, "[<output-file-name>]");
+  if (argc > 2) benchmarkUsage();
+  if (argc == 2) outputFileName = argv[1]; // (but note that the same file is written twice)
+
+  record(2000);
+  record(0);
+
+  tearDownBenchmark();
+  return 0;
+}
@@ -121,6 +121,21 @@ int main(int argc, char** argv) {
     announceStream(rtspServer, sms, streamName, inputFileName);
   }
 
+  // A H.264 video archive (recorded - e.g., using "openRTSP -x <segment-duration> -F archive- <url>" - as a
+  // sequence of segment files, each beginning "archive-video-H264-1-"):
+  {
+    char const* streamName = "h264ArchiveTest";
+    char const* fileNamePrefix = "archive-video-H264-1-";
+    ServerMediaSession* sms
+      = ServerMediaSession::createNew(*env, streamName, streamName,
+				      descriptionString);
+    sms->addSubsession(ArchiveServerMediaSubsession
+		       ::createNew(*env, fileNamePrefix, 264));
+    rtspServer->addServerMediaSession(sms);
+
+    announceStream(rtspServer, sms, streamName, fileNamePrefix);
+  }
+
   // A MPEG-1 or 2 audio+video program stream:
   {
     char const* streamName = "mpeg1or2AudioVideoTest";
@@ -0,0 +1,321 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2019, Live Networks, Inc.  All rights reserved
+// A self-checking test of a "ProxyServerMediaSession" that connects to its back-end server only 'on demand'
+// (i.e., with a "backEndIdleTimeoutSeconds" parameter).  A back-end server (streaming synthetic audio), a proxy
+// server, and the proxy's front-end clients all run in this process.  The back-end server counts the requests and
+// connections that it gets.  We check that:
+// - after the proxy's initial "DESCRIBE", its back-end connection is closed once it has been idle for the timeout;
+// - a front-end client can still "DESCRIBE", "SETUP" and "PLAY" the stream - getting data - without another
+//   back-end "DESCRIBE";
+// - once the last front-end client has left, the back-end session is torn down, and its connection closed, after
+//   the timeout;
+// - a front-end "DESCRIBE" on its own reopens the back-end connection, which is then closed again after the timeout;
+// - a later front-end client again gets data (with a new back-end "SETUP", but still no new "DESCRIBE").
+// The program exits with status 1 if any check failed.
+// main program
+
+#include "benchmarkCommon.hh"
+
+unsigned idleTimeoutSeconds = 1; // default; can be changed with "-n"
+
+////////// The back-end server //////////
+
+// A source of (silent) 8 kHz u-law audio, in 20 ms frames:
+class SilenceSource: public FramedSource {
+public:
+  static SilenceSource* createNew(UsageEnvironment& env) { return new SilenceSource(env); }
+
+private:
+  SilenceSource(UsageEnvironment& env) : FramedSource(env) {}
+
+  virtual void doGetNextFrame() {
+    fFrameSize = fMaxSize < 160 ? fMaxSize : 160;
+    memset(fTo, 0xFF, fFrameSize);
+    gettimeofday(&fPresentationTime, NULL);
+    fDurationInMicroseconds = 20000;
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)FramedSource::afterGetting, this);
+  }
+};
+
+class SilenceSubsession: public OnDemandServerMediaSubsession {
+public:
+  static SilenceSubsession* createNew(UsageEnvironment& env) { return new SilenceSubsession(env); }
+
+private:
+  SilenceSubsession(UsageEnvironment& env) : OnDemandServerMediaSubsession(env, True/*reuseFirstSource*/) {}
+
+  virtual FramedSource* createNewStreamSource(unsigned /*clientSessionId*/, unsigned& estBitrate) {
+    estBitrate = 64; // kbps
+    return SilenceSource::createNew(envir());
+  }
+  virtual RTPSink* createNewRTPSink(Groupsock* rtpGroupsock, unsigned char /*rtpPayloadTypeIfDynamic*/,
+				    FramedSource* /*inputSource*/) {
+    return SimpleRTPSink::createNew(envir(), rtpGroupsock, 0, 8000, "audio", "PCMU", 1);
+  }
+};
+
+// Counts of what the back-end server has seen:
+unsigned numBackEndConnections = 0, numBackEndSessions = 0; // currently open
+unsigned numBackEndDESCRIBEs = 0, numBackEndSETUPs = 0, numBackEndPLAYs = 0, numBackEndTEARDOWNs = 0;
+
+class CountingRTSPServer: public RTSPServer {
+public:
+  static CountingRTSPServer* createNew(UsageEnvironment& env) {
+    Port ourPort(0); // chosen by the OS
+    int ourSocket = setUpOurSocket(env, ourPort);
+    if (ourSocket == -1) return NULL;
+    return new CountingRTSPServer(env, ourSocket, ourPort);
+  }
+
+private:
+  CountingRTSPServer(UsageEnvironment& env, int ourSocket, Port ourPort)
+    : RTSPServer(env, ourSocket, ourPort, NULL, 65) {
+  }
+
+  class CountingConnection: public RTSPClientConnection {
+  public:
+    CountingConnection(RTSPServer& ourServer, int clientSocket, struct sockaddr_storage const& clientAddr)
+      : RTSPClientConnection(ourServer, clientSocket, clientAddr) {
+      ++numBackEndConnections;
+    }
+    virtual ~CountingConnection() {
+      --numBackEndConnections;
+    }
+
+  private:
+    virtual void handleCmd_DESCRIBE(char const* urlPreSuffix, char const* urlSuffix, char const* fullRequestStr) {
+      ++numBackEndDESCRIBEs;
+      RTSPClientConnection::handleCmd_DESCRIBE(urlPreSuffix, urlSuffix, fullRequestStr);
+    }
+  };
+
+  class CountingSession: public RTSPClientSession {
+  public:
+    CountingSession(RTSPServer& ourServer, u_int32_t sessionId)
+      : RTSPClientSession(ourServer, sessionId) {
+      ++numBackEndSessions;
+    }
+    virtual ~CountingSession() {
+      --numBackEndSessions;
+    }
+
+  private:
+    virtual void handleCmd_SETUP(RTSPClientConnection* ourClientConnection,
+				 char const* urlPreSuffix, char const* urlSuffix, char const* fullRequestStr) {
+      ++numBackEndSETUPs;
+      RTSPClientSession::handleCmd_SETUP(ourClientConnection, urlPreSuffix, urlSuffix, fullRequestStr);
+    }
+    virtual void handleCmd_PLAY(RTSPClientConnection* ourClientConnection,
+				ServerMediaSubsession* subsession, char const* fullRequestStr) {
+      ++numBackEndPLAYs;
+      RTSPClientSession::handleCmd_PLAY(ourClientConnection, subsession, fullRequestStr);
+    }
+    virtual void handleCmd_TEARDOWN(RTSPClientConnection* ourClientConnection, ServerMediaSubsession* subsession) {
+      ++numBackEndTEARDOWNs;
+      RTSPClientSession::handleCmd_TEARDOWN(ourClientConnection, subsession); // note: this deletes us
+    }
+  };
+
+  virtual ClientConnection* createNewClientConnection(int clientSocket, struct sockaddr_storage const& clientAddr) {
+    return new CountingConnection(*this, clientSocket, clientAddr);
+  }
+  virtual ClientSession* createNewClientSession(u_int32_t sessionId) {
+    return new CountingSession(*this, sessionId);
+  }
+};
+
+////////// The front-end clients //////////
+
+// A sink that just counts the bytes that it gets:
+class CountingSink: public MediaSink {
+public:
+  static CountingSink* createNew(UsageEnvironment& env) { return new CountingSink(env); }
+
+  unsigned numBytesReceived() const { return fNumBytesReceived; }
+
+private:
+  CountingSink(UsageEnvironment& env) : MediaSink(env), fNumBytesReceived(0) {}
+
+  virtual Boolean continuePlaying() {
+    if (fSource == NULL) return False;
+    fSource->getNextFrame(fBuffer, sizeof fBuffer, afterGettingFrame, this, onSourceClosure, this);
+    return True;
+  }
+
+  static void afterGettingFrame(void* clientData, unsigned frameSize, unsigned /*numTruncatedBytes*/,
+				struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+    CountingSink* sink = (CountingSink*)clientData;
+    sink->fNumBytesReceived += frameSize;
+    sink->continuePlaying();
+  }
+
+private:
+  u_int8_t fBuffer[10000];
+  unsigned fNumBytesReceived;
+};
+
+// A client that "DESCRIBE"s - and then optionally "SETUP"s and "PLAY"s - the proxied stream:
+class FrontEndClient: public RTSPClient {
+public:
+  static FrontEndClient* createNew(UsageEnvironment& env, char const* url, Boolean play) {
+    return new FrontEndClient(env, url, play);
+  }
+
+  Boolean describeSucceeded() const { return fSession != NULL; }
+  Boolean isPlaying() const { return fIsPlaying; }
+  unsigned numBytesReceived() const { return fSink == NULL ? 0 : fSink->numBytesReceived(); }
+
+  void stop() { // sends "TEARDOWN" (if we're playing), then deletes us
+    if (fIsPlaying) sendTeardownCommand(*fSession, NULL);
+    Medium::close(this);
+  }
+
+private:
+  FrontEndClient(UsageEnvironment& env, char const* url, Boolean play)
+    : RTSPClient(env, url, 0, progName, 0, -1),
+      fPlay(play), fSession(NULL), fSubsession(NULL), fSink(NULL), fIsPlaying(False) {
+    sendDescribeCommand(continueAfterDESCRIBE);
+  }
+  virtual ~FrontEndClient() {
+    Medium::close(fSink);
+    Medium::close(fSession);
+  }
+
+  static void continueAfterDESCRIBE(RTSPClient* rtspClient, int resultCode, char* resultString) {
+    FrontEndClient* client = (FrontEndClient*)rtspClient;
+    if (resultCode == 0) {
+      client->fSession = MediaSession::createNew(client->envir(), resultString);
+      MediaSubsessionIterator iter(*client->fSession);
+      client->fSubsession = iter.next();
+      if (client->fPlay && client->fSubsession != NULL && client->fSubsession->initiate()) {
+	client->sendSetupCommand(*client->fSubsession, continueAfterSETUP);
+      }
+    }
+    delete[] resultString;
+  }
+
+  static void continueAfterSETUP(RTSPClient* rtspClient, int resultCode, char* resultString) {
+    FrontEndClient* client = (FrontEndClient*)rtspClient;
+    if (resultCode == 0) {
+      client->fSink = CountingSink::createNew(client->envir());
+      client->fSink->startPlaying(*client->fSubsession->readSource(), NULL, NULL);
+      client->sendPlayCommand(*client->fSession, continueAfterPLAY);
+    }
+    delete[] resultString;
+  }
+
+  static void continueAfterPLAY(RTSPClient* rtspClient, int resultCode, char* resultString) {
+    if (resultCode == 0) ((FrontEndClient*)rtspClient)->fIsPlaying = True;
+    delete[] resultString;
+  }
+
+private:
+  Boolean fPlay;
+  MediaSession* fSession;
+  MediaSubsession* fSubsession;
+  CountingSink* fSink;
+  Boolean fIsPlaying;
+};
+
+////////// main //////////
+
+char volatile doneFlag;
+
+static void setDoneFlag(void* /*clientData*/) {
+  doneFlag = 1;
+}
+
+static void runFor(double seconds) {
+  doneFlag = 0;
+  env->taskScheduler().scheduleDelayedTask((int64_t)(seconds*1000000), setDoneFlag, NULL);
+  env->taskScheduler().doEventLoop(&doneFlag);
+}
+
+static void checkBackEnd(char const* when, unsigned connections, unsigned sessions,
+			 unsigned DESCRIBEs, unsigned SETUPs, unsigned PLAYs, unsigned TEARDOWNs) {
+  check(numBackEndConnections == connections && numBackEndSessions == sessions && numBackEndDESCRIBEs == DESCRIBEs
+	&& numBackEndSETUPs == SETUPs && numBackEndPLAYs == PLAYs && numBackEndTEARDOWNs == TEARDOWNs,
+	"the back-end server's state was wrong", when);
+  *env << when << ":\tback-end connections: " << numBackEndConnections << ", sessions: " << numBackEndSessions
+       << "; DESCRIBEs: " << numBackEndDESCRIBEs << ", SETUPs: " << numBackEndSETUPs
+       << ", PLAYs: " << numBackEndPLAYs << ", TEARDOWNs: " << numBackEndTEARDOWNs << "\n";
+}
+
+// Plays the stream (from a new front-end client) for a second, and checks that we got data:
+static void playFrontEndClient(char const* url, char const* when, unsigned numSETUPsSoFar) {
+  FrontEndClient* client = FrontEndClient::createNew(*env, url, True);
+  runFor(1.0);
+  check(client->isPlaying() && client->numBytesReceived() > 0, "a front-end client didn't get data", when);
+  *env << when << ":\tfront-end client got " << client->numBytesReceived() << " bytes\n";
+  checkBackEnd(when, 1, 1, 1, numSETUPsSoFar + 1, numSETUPsSoFar + 1, numSETUPsSoFar);
+  client->stop();
+}
+
+int main(int argc, char** argv) {
+  setUpBenchmark(argc, argv, "back-end-idle-timeout-seconds", idleTimeoutSeconds);
+  if (argc != 1) benchmarkUsage();
+  double const idleWaitSeconds = idleTimeoutSeconds + 1.0;
+
+  CountingRTSPServer* backEndServer = CountingRTSPServer::createNew(*env);
+  RTSPServer* proxyServer = RTSPServer::createNew(*env, Port(0));
+  if (backEndServer == NULL || proxyServer == NULL) {
+    *env << "Failed to create a server: " << env->getResultMsg() << "\n";
+    exit(1);
+  }
+  ServerMediaSession* sms = ServerMediaSession::createNew(*env, "silence");
+  sms->addSubsession(SilenceSubsession::createNew(*env));
+  backEndServer->addServerMediaSession(sms);
+
+  char backEndURL[100], proxyURL[100];
+  sprintf(backEndURL, "rtsp://127.0.0.1:%u/silence", serverPortNum(*backEndServer));
+  sprintf(proxyURL, "rtsp://127.0.0.1:%u/proxied", serverPortNum(*proxyServer));
+  proxyServer->addServerMediaSession(ProxyServerMediaSession::createNew(*env, proxyServer, backEndURL, "proxied",
+									NULL, NULL, 0, 0, -1, NULL,
+									idleTimeoutSeconds));
+
+  // The proxy "DESCRIBE"s the back-end stream at once, then - with no front-end clients - closes the connection:
+  runFor(0.5);
+  checkBackEnd("after startup", 1, 0, 1, 0, 0, 0);
+  runFor(idleWaitSeconds);
+  checkBackEnd("idle", 0, 0, 1, 0, 0, 0);
+
+  // A front-end client can play the stream (without the proxy "DESCRIBE"ing it again):
+  playFrontEndClient(proxyURL, "client #1", 0);
+  runFor(idleWaitSeconds);
+  checkBackEnd("idle", 0, 0, 1, 1, 1, 1);
+
+  // A front-end "DESCRIBE" (on its own) reopens the connection, which is then closed again:
+  FrontEndClient* client = FrontEndClient::createNew(*env, proxyURL, False);
+  runFor(0.5);
+  check(client->describeSucceeded(), "a front-end DESCRIBE failed");
+  checkBackEnd("DESCRIBE only", 1, 0, 1, 1, 1, 1);
+  client->stop();
+  runFor(idleWaitSeconds);
+  checkBackEnd("idle", 0, 0, 1, 1, 1, 1);
+
+  // Another front-end client can play the stream again:
+  playFrontEndClient(proxyURL, "client #2", 1);
+  runFor(idleWaitSeconds);
+  checkBackEnd("idle", 0, 0, 1, 2, 2, 2);
+
+  Medium::close(proxyServer);
+  Medium::close(backEndServer);
+
+  int result = reportChecks();
+  tearDownBenchmark();
+  return result;
+}
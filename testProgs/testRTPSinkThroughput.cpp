@@ -0,0 +1,226 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2019, Live Networks, Inc.  All rights reserved
+// A benchmark that measures how many RTP packets per second a "H264VideoRTPSink" can send (in a single thread).
+// The H.264 Elementary Stream file is read into memory first, and its NAL units are then delivered as fast as the
+// sink asks for them (i.e., without real-time delays), so that we measure just packetization and sending.
+// The packets are sent to a local UDP port (which we don't read).
+// The benchmark is run first with each packet sent from its own scheduled task (as before), and then with up to
+// "MultiFramedRTPSink::maxPacketsSentPerIteration" packets sent in a loop.
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+
+UsageEnvironment* env;
+char const* progName;
+
+// Default values of command-line parameters:
+unsigned numRepetitions = 20;
+unsigned maxPacketsSentPerIteration = MultiFramedRTPSink::maxPacketsSentPerIteration;
+
+// The NAL units of the input file (in memory):
+unsigned numNALUnits = 0;
+u_int8_t** nalUnits = NULL;
+unsigned* nalUnitSizes = NULL;
+
+// A source that delivers the NAL units (repeatedly) as discrete frames, with no delay:
+class InMemoryNALUnitSource: public FramedSource {
+public:
+  static InMemoryNALUnitSource* createNew(UsageEnvironment& env, unsigned numRepetitions) {
+    return new InMemoryNALUnitSource(env, numRepetitions);
+  }
+
+private:
+  InMemoryNALUnitSource(UsageEnvironment& env, unsigned numRepetitions)
+    : FramedSource(env), fNumRepetitionsLeft(numRepetitions), fNextNALUnit(0) {
+    gettimeofday(&fPresentationTime, NULL);
+  }
+
+  virtual void doGetNextFrame() {
+    if (fNextNALUnit == numNALUnits) {
+      fNextNALUnit = 0;
+      if (--fNumRepetitionsLeft == 0) {
+	handleClosure();
+	return;
+      }
+    }
+
+    u_int8_t* nalUnit = nalUnits[fNextNALUnit];
+    unsigned nalUnitSize = nalUnitSizes[fNextNALUnit];
+    ++fNextNALUnit;
+    if (nalUnitSize > fMaxSize) {
+      fNumTruncatedBytes = nalUnitSize - fMaxSize;
+      nalUnitSize = fMaxSize;
+    } else {
+      fNumTruncatedBytes = 0;
+    }
+    memmove(fTo, nalUnit, nalUnitSize);
+    fFrameSize = nalUnitSize;
+    fDurationInMicroseconds = 0;
+
+    // Each (VCL) slice gets a new presentation time (approximating one per access unit):
+    u_int8_t nalUnitType = nalUnit[0]&0x1F;
+    if (nalUnitType == 1 || nalUnitType == 5) {
+      fPresentationTime.tv_usec += 40000;
+      if (fPresentationTime.tv_usec >= 1000000) {
+	++fPresentationTime.tv_sec;
+	fPresentationTime.tv_usec -= 1000000;
+      }
+    }
+
+    FramedSource::afterGetting(this);
+  }
+
+private:
+  unsigned fNumRepetitionsLeft;
+  unsigned fNextNALUnit;
+};
+
+// A "H264VideoRTPSink" that lets us read its packet and byte counts:
+class CountingH264VideoRTPSink: public H264VideoRTPSink {
+public:
+  static CountingH264VideoRTPSink* createNew(UsageEnvironment& env, Groupsock* RTPgs, unsigned char rtpPayloadFormat) {
+    return new CountingH264VideoRTPSink(env, RTPgs, rtpPayloadFormat);
+  }
+
+  unsigned numPacketsSent() const { return packetCount(); }
+  unsigned numPayloadBytesSent() const { return octetCount(); }
+
+private:
+  CountingH264VideoRTPSink(UsageEnvironment& env, Groupsock* RTPgs, unsigned char rtpPayloadFormat)
+    : H264VideoRTPSink(env, RTPgs, rtpPayloadFormat) {}
+};
+
+static void usage() {
+  *env << "Usage: " << progName << " [-r <number-of-repetitions>] [-b <max-packets-sent-per-iteration>] <h264-file>\n";
+  exit(1);
+}
+
+static Boolean readNALUnits(char const* fileName) {
+  FILE* fid = fopen(fileName, "rb");
+  if (fid == NULL) return False;
+  fseek(fid, 0, SEEK_END);
+  long fileSize = ftell(fid);
+  fseek(fid, 0, SEEK_SET);
+  if (fileSize <= 0) { fclose(fid); return False; }
+
+  u_int8_t* data = new u_int8_t[fileSize];
+  if (fread(data, 1, fileSize, fid) != (size_t)fileSize) { fclose(fid); return False; }
+  fclose(fid);
+
+  // Split the data at 'start codes' (0x000001, or 0x00000001):
+  unsigned maxNumNALUnits = fileSize/3 + 1;
+  nalUnits = new u_int8_t*[maxNumNALUnits];
+  nalUnitSizes = new unsigned[maxNumNALUnits];
+  long nalUnitStart = -1;
+  for (long i = 0; i + 3 <= fileSize; ++i) {
+    if (data[i] == 0 && data[i+1] == 0 && data[i+2] == 1) {
+      if (nalUnitStart >= 0) {
+	long end = i;
+	if (end > nalUnitStart && data[end-1] == 0) --end; // 4-byte start code
+	nalUnits[numNALUnits] = &data[nalUnitStart];
+	nalUnitSizes[numNALUnits++] = (unsigned)(end - nalUnitStart);
+      }
+      nalUnitStart = i + 3;
+      i += 2;
+    }
+  }
+  if (nalUnitStart >= 0 && nalUnitStart < fileSize) {
+    nalUnits[numNALUnits] = &data[nalUnitStart];
+    nalUnitSizes[numNALUnits++] = (unsigned)(fileSize - nalUnitStart);
+  }
+  return numNALUnits > 0;
+}
+
+char volatile doneFlag;
+
+static void afterPlaying(void* /*clientData*/) {
+  doneFlag = 1;
+}
+
+// Sends the file "numRepetitions" times, and returns the number of packets per second:
+static double runBenchmark(unsigned maxPacketsPerIteration, Groupsock& rtpGroupsock) {
+  MultiFramedRTPSink::maxPacketsSentPerIteration = maxPacketsPerIteration;
+
+  CountingH264VideoRTPSink* sink = CountingH264VideoRTPSink::createNew(*env, &rtpGroupsock, 96);
+  FramedSource* source
+    = H264VideoStreamDiscreteFramer::createNew(*env, InMemoryNALUnitSource::createNew(*env, numRepetitions));
+
+  struct timeval startTime, endTime;
+  gettimeofday(&startTime, NULL);
+  doneFlag = 0;
+  sink->startPlaying(*source, afterPlaying, NULL);
+  env->taskScheduler().doEventLoop(&doneFlag);
+  gettimeofday(&endTime, NULL);
+
+  double elapsedSeconds = (endTime.tv_sec - startTime.tv_sec) + (endTime.tv_usec - startTime.tv_usec)/1000000.0;
+  unsigned numPackets = sink->numPacketsSent();
+  double numMBits = sink->numPayloadBytesSent()*8/1000000.0;
+  Medium::close(sink);
+  Medium::close(source);
+
+  double packetsPerSecond = numPackets/elapsedSeconds;
+  *env << "max packets per iteration " << maxPacketsPerIteration << ":\t" << numPackets << " packets in "
+       << elapsedSeconds << " seconds: " << (unsigned)packetsPerSecond << " packets/second ("
+       << (unsigned)(numMBits/elapsedSeconds) << " Mbits/second of payload)\n";
+  return packetsPerSecond;
+}
+
+int main(int argc, char** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  progName = argv[0];
+  while (argc > 2 && argv[1][0] == '-') {
+    if (argv[1][1] == 'r' && sscanf(argv[2], "%u", &numRepetitions) == 1 && numRepetitions > 0) {
+    } else if (argv[1][1] == 'b' && sscanf(argv[2], "%u", &maxPacketsSentPerIteration) == 1
+	       && maxPacketsSentPerIteration > 0) {
+    } else {
+      usage();
+    }
+    argv += 2; argc -= 2;
+  }
+  if (argc != 2) usage();
+
+  if (!readNALUnits(argv[1])) {
+    *env << "Unable to read H.264 NAL units from \"" << argv[1] << "\"\n";
+    exit(1);
+  }
+  OutPacketBuffer::maxSize = 2000000;
+
+  // Send to a local port, on which we have a socket that we don't read (so the kernel discards the packets):
+  struct in_addr localAddress;
+  localAddress.s_addr = our_inet_addr("127.0.0.1");
+  Groupsock receivingGroupsock(*env, localAddress, Port(0), 255);
+  Port receivingPort(0);
+  getSourcePort(*env, receivingGroupsock.socketNum(), receivingPort);
+  Groupsock rtpGroupsock(*env, localAddress, Port(0), 255);
+  rtpGroupsock.changeDestinationParameters(localAddress, receivingPort, 255);
+
+  *env << "Sending " << numNALUnits << " NAL units, " << numRepetitions << " times...\n";
+  double baseline = runBenchmark(1, rtpGroupsock);
+  double result = runBenchmark(maxPacketsSentPerIteration, rtpGroupsock);
+  char speedup[20];
+  sprintf(speedup, "%.2f", result/baseline);
+  *env << "Speedup: " << speedup << "x\n";
+
+  env->reclaim(); env = NULL;
+  delete scheduler;
+  return 0;
+}
@@ -0,0 +1,210 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2019, Live Networks, Inc.  All rights reserved
+// A test program that uses a "RTSPClientManager" to receive many RTSP streams at once.
+// By default, the streams come from several local "RTSPServer"s - standing in for cameras - that each stream the same
+// H.264 Elementary Stream file.  (Alternatively, "rtsp://" URLs can be given, and their streams are received instead.)
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include <atomic>
+
+UsageEnvironment* env;
+char const* progName;
+
+// Default values of command-line parameters:
+unsigned numWorkers = 4;
+unsigned numServers = 4;
+unsigned numStreams = 100;
+unsigned durationSeconds = 30;
+unsigned maxConnectingStreamsPerWorker = 20;
+Boolean streamUsingTCP = False;
+int verbosityLevel = 0;
+
+portNumBits const firstServerPortNum = 18554;
+
+// Totals over all streams (updated by the "RTSPClientManager"s worker threads):
+std::atomic<unsigned> numFramesReceived(0);
+std::atomic<unsigned> numKBytesReceived(0);
+
+// A sink that just counts the frames (and bytes) that it receives:
+class CountingSink: public MediaSink {
+public:
+  static CountingSink* createNew(UsageEnvironment& env) { return new CountingSink(env); }
+
+private:
+  CountingSink(UsageEnvironment& env) : MediaSink(env), fBytesNotYetCounted(0) {}
+  virtual ~CountingSink() {}
+
+  static void afterGettingFrame(void* clientData, unsigned frameSize, unsigned /*numTruncatedBytes*/,
+				struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+    CountingSink* sink = (CountingSink*)clientData;
+    numFramesReceived.fetch_add(1, std::memory_order_relaxed);
+    sink->fBytesNotYetCounted += frameSize;
+    if (sink->fBytesNotYetCounted >= 1024) {
+      numKBytesReceived.fetch_add(sink->fBytesNotYetCounted/1024, std::memory_order_relaxed);
+      sink->fBytesNotYetCounted %= 1024;
+    }
+    sink->continuePlaying();
+  }
+
+  virtual Boolean continuePlaying() {
+    if (fSource == NULL) return False;
+    fSource->getNextFrame(fBuffer, sizeof fBuffer, afterGettingFrame, this, onSourceClosure, this);
+    return True;
+  }
+
+private:
+  unsigned fBytesNotYetCounted;
+  unsigned char fBuffer[100000];
+};
+
+static UsageEnvironment* createWorkerEnvironment() {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  return BasicUsageEnvironment::createNew(*scheduler);
+}
+
+static MediaSink* createSink(UsageEnvironment& env, unsigned /*streamId*/, char const* /*rtspURL*/,
+			     MediaSubsession& /*subsession*/, void* /*clientData*/) {
+  return CountingSink::createNew(env);
+}
+
+static void usage() {
+  *env << "Usage: " << progName
+       << " [-w <number-of-worker-threads>] [-s <number-of-servers>] [-n <number-of-streams>]"
+       << " [-d <duration-in-seconds>] [-c <max-connecting-streams-per-worker>] [-t] [-v]"
+       << " <h264-file> | <rtsp-url-1> ... <rtsp-url-n>\n";
+  exit(1);
+}
+
+static void getUnsignedArg(char**& argv, int& argc, unsigned& result, unsigned minValue) {
+  if (argc < 3 || sscanf(argv[2], "%u", &result) != 1 || result < minValue) usage();
+  ++argv; --argc;
+}
+
+// Called each second, to report progress:
+RTSPClientManager* manager;
+unsigned secondsElapsed = 0;
+unsigned maxNumStreamsPlaying = 0;
+unsigned lastNumFramesReceived = 0, lastNumKBytesReceived = 0;
+char volatile stopEventLoop = 0;
+
+static void reportProgress(void* /*clientData*/) {
+  ++secondsElapsed;
+
+  unsigned numPlaying = manager->numStreamsPlaying();
+  if (numPlaying > maxNumStreamsPlaying) maxNumStreamsPlaying = numPlaying;
+  unsigned frames = numFramesReceived.load(std::memory_order_relaxed);
+  unsigned kBytes = numKBytesReceived.load(std::memory_order_relaxed);
+  *env << secondsElapsed << "s: " << numPlaying << "/" << manager->numStreams() << " streams playing; "
+       << manager->numStreamRestarts() << " restarts; "
+       << frames - lastNumFramesReceived << " frames/s; " << kBytes - lastNumKBytesReceived << " kBytes/s\n";
+  lastNumFramesReceived = frames; lastNumKBytesReceived = kBytes;
+
+  if (secondsElapsed >= durationSeconds) {
+    stopEventLoop = 1;
+  } else {
+    env->taskScheduler().scheduleDelayedTask(1000000, reportProgress, NULL);
+  }
+}
+
+int main(int argc, char** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  progName = argv[0];
+  while (argc > 1 && argv[1][0] == '-') {
+    switch (argv[1][1]) {
+      case 'w': getUnsignedArg(argv, argc, numWorkers, 0); break;
+      case 's': getUnsignedArg(argv, argc, numServers, 1); break;
+      case 'n': getUnsignedArg(argv, argc, numStreams, 1); break;
+      case 'd': getUnsignedArg(argv, argc, durationSeconds, 1); break;
+      case 'c': getUnsignedArg(argv, argc, maxConnectingStreamsPerWorker, 1); break;
+      case 't': streamUsingTCP = True; break;
+      case 'v': verbosityLevel = 1; break;
+      default: usage();
+    }
+    ++argv; --argc;
+  }
+  if (argc < 2) usage();
+
+  // Increase the maximum size of video frames that our servers can send:
+  OutPacketBuffer::maxSize = 300000;
+
+  // Set up the (local) servers, and the URLs of the streams that we'll receive from them - or use the given URLs:
+  char const** streamURLs;
+  unsigned numStreamURLs;
+  RTSPServer** servers = new RTSPServer*[numServers];
+  unsigned i;
+  for (i = 0; i < numServers; ++i) servers[i] = NULL;
+  if (strncmp(argv[1], "rtsp://", 7) == 0) {
+    streamURLs = (char const**)&argv[1];
+    numStreamURLs = argc - 1;
+    numServers = 0;
+  } else {
+    char const* inputFileName = argv[1];
+    streamURLs = new char const*[numServers];
+    numStreamURLs = numServers;
+    for (i = 0; i < numServers; ++i) {
+      servers[i] = RTSPServer::createNew(*env, firstServerPortNum + i);
+      if (servers[i] == NULL) {
+	*env << "Failed to create RTSP server: " << env->getResultMsg() << "\n";
+	exit(1);
+      }
+      ServerMediaSession* sms = ServerMediaSession::createNew(*env, "camera", "camera", progName);
+      sms->addSubsession(H264VideoFileServerMediaSubsession::createNew(*env, inputFileName, True/*reuseFirstSource*/));
+      servers[i]->addServerMediaSession(sms);
+
+      // Name every other server by host name (rather than address), so that its streams' host names get looked up:
+      char* url = new char[100];
+      sprintf(url, "rtsp://%s:%u/camera", (i%2 == 0) ? "127.0.0.1" : "localhost", firstServerPortNum + i);
+      streamURLs[i] = url;
+    }
+  }
+
+  // Create the manager, and give it the streams:
+  manager = RTSPClientManager::createNew(*env, numWorkers, createWorkerEnvironment, createSink, NULL,
+					  maxConnectingStreamsPerWorker, streamUsingTCP, 10, verbosityLevel);
+  if (manager == NULL) {
+    *env << "Failed to create the RTSP client manager: " << env->getResultMsg() << "\n";
+    exit(1);
+  }
+  for (i = 0; i < numStreams; ++i) manager->addStream(streamURLs[i%numStreamURLs]);
+  *env << "Receiving " << numStreams << " streams (from " << numStreamURLs << " URLs), using "
+       << numWorkers << " worker threads, for " << durationSeconds << " seconds...\n";
+
+  env->taskScheduler().scheduleDelayedTask(1000000, reportProgress, NULL);
+  env->taskScheduler().doEventLoop(&stopEventLoop);
+
+  // Clean up:
+  Medium::close(manager);
+  for (i = 0; i < numServers; ++i) {
+    Medium::close(servers[i]);
+    delete[] (char*)streamURLs[i];
+  }
+  delete[] servers;
+  if (numServers > 0) delete[] streamURLs;
+
+  Boolean success = maxNumStreamsPlaying == numStreams;
+  *env << (success ? "All " : "Not all ") << numStreams << " streams played ("
+       << numFramesReceived.load() << " frames, " << numKBytesReceived.load() << " kBytes received)\n";
+
+  env->reclaim(); env = NULL;
+  delete scheduler;
+  return success ? 0 : 1;
+}
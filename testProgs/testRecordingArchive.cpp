@@ -0,0 +1,573 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2019, Live Networks, Inc.  All rights reserved
+// A self-checking test of "RollingRecordingSink" (and the archive that it writes), and of seeking within that
+// archive using "ArchiveServerMediaSubsession".
+// A synthetic H.264 stream (25 frames/second, with a key frame - preceded by SPS and PPS NAL units - every second)
+// is recorded - as fast as possible - into 10-second segments, keeping 30 seconds.  Each slice carries its frame
+// number, so the archive's contents can be checked exactly.  The recording is done twice (continuing the same
+// stream), to check that the second recorder picks up - and applies its retention policy to - the first's segments.
+// We check that:
+// - each segment begins with the stream's parameter sets, then a key frame; and no frame was lost, or duplicated,
+//   at a segment boundary;
+// - segments are rotated at the first key frame after 10 seconds;
+// - each segment's key frame index (".idx" file) lists exactly the segment's key frames, at their correct offsets,
+//   and "findKeyFrame()" finds the correct key frame;
+// - segments (and their ".idx" files) older than the retention period - but no others - have been deleted.
+// Then, reading the archive's stream source directly (without RTP), we check that:
+// - seeking (by NPT or by 'absolute' time) starts at the last key frame at (or before) the requested time - which
+//   is reported back - and that playback then continues - across segment boundaries - to the requested end time;
+// - with "Scale:" between 0 and 1, every frame is sent (with longer durations); otherwise, only key frames are
+//   sent, at most 10 per second of playing time, and in reverse for a negative "Scale:".
+// The program exits with status 1 if any check failed.
+// main program
+
+#include "benchmarkCommon.hh"
+#include "H264VideoRTPSource.hh" // for "parseSPropParameterSets()"
+#include "ArchiveServerMediaSubsession.hh"
+#include <dirent.h>
+#include <time.h> // for "strftime()" and "gmtime()"
+
+unsigned numSecondsPerRun = 60; // default; can be changed with "-n"
+unsigned const framesPerSecond = 25;
+unsigned const framesPerKeyFrame = 25;
+unsigned const segmentDurationSeconds = 10;
+unsigned const retentionSeconds = 30;
+u_int64_t const startTime = (u_int64_t)1577836800*1000000; // 2020-01-01 00:00:00 UTC, in microseconds
+char const* sPropParameterSets = "Z0IAKeKQFAe2AtwEBAaQeJEV,aM48gA==";
+
+static u_int64_t frameTime(unsigned frameNum) {
+  return startTime + (u_int64_t)frameNum*1000000/framesPerSecond;
+}
+
+// The frame number is stored in 4 bytes with the high bit set (so that it can't look like a 'start code'):
+static void putFrameNum(u_int8_t* p, unsigned frameNum) {
+  for (unsigned i = 0; i < 4; ++i) p[i] = 0x80|((frameNum>>(7*(3-i)))&0x7F);
+}
+
+static unsigned getFrameNum(u_int8_t const* p) {
+  unsigned frameNum = 0;
+  for (unsigned i = 0; i < 4; ++i) frameNum = (frameNum<<7)|(p[i]&0x7F);
+  return frameNum;
+}
+
+// A source of H.264 NAL units: for each key frame, a SPS, a PPS, and an IDR slice; otherwise, a non-IDR slice:
+class SyntheticH264Source: public FramedSource {
+public:
+  static SyntheticH264Source* createNew(UsageEnvironment& env, unsigned firstFrameNum, unsigned numFrames) {
+    return new SyntheticH264Source(env, firstFrameNum, numFrames);
+  }
+
+private:
+  SyntheticH264Source(UsageEnvironment& env, unsigned firstFrameNum, unsigned numFrames)
+    : FramedSource(env), fFrameNum(firstFrameNum), fEndFrameNum(firstFrameNum + numFrames), fNextNALInFrame(0) {
+    fSPropRecords = parseSPropParameterSets(sPropParameterSets, fNumSPropRecords);
+  }
+  virtual ~SyntheticH264Source() {
+    delete[] fSPropRecords;
+  }
+
+  virtual void doGetNextFrame() {
+    if (fFrameNum >= fEndFrameNum) {
+      handleClosure();
+      return;
+    }
+
+    Boolean isKeyFrame = fFrameNum%framesPerKeyFrame == 0;
+    if (isKeyFrame && fNextNALInFrame < fNumSPropRecords) {
+      SPropRecord const& record = fSPropRecords[fNextNALInFrame++];
+      fFrameSize = record.sPropLength;
+      memmove(fTo, record.sPropBytes, fFrameSize);
+    } else {
+      fFrameSize = 100 + (fFrameNum*37)%400;
+      memset(fTo, 0x55, fFrameSize);
+      fTo[0] = isKeyFrame ? 0x65/*IDR slice*/ : 0x41/*non-IDR slice*/;
+      putFrameNum(&fTo[1], fFrameNum);
+      fNextNALInFrame = 0;
+    }
+    fPresentationTime = microsecondsToTimeval(frameTime(fFrameNum));
+    if (fNextNALInFrame == 0) ++fFrameNum;
+
+    // Deliver the NAL unit via the event loop (rather than recursively):
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)FramedSource::afterGetting, this);
+  }
+
+private:
+  unsigned fFrameNum, fEndFrameNum, fNextNALInFrame;
+  SPropRecord* fSPropRecords;
+  unsigned fNumSPropRecords;
+};
+
+// A NAL unit, as found in a segment file:
+struct NALUnit {
+  u_int64_t offset; // of its 'start code'
+  u_int8_t type;
+  unsigned frameNum; // if a slice
+};
+
+// Reads "fileName", returning its NAL units (which the caller must "delete[]"):
+static NALUnit* readNALUnits(char const* fileName, unsigned& numNALUnits,
+			     u_int8_t*& data, unsigned& dataSize) {
+  numNALUnits = 0;
+  data = NULL; dataSize = 0;
+  FILE* fid = fopen(fileName, "rb");
+  if (fid == NULL) return NULL;
+  fseek(fid, 0, SEEK_END);
+  dataSize = (unsigned)ftell(fid);
+  fseek(fid, 0, SEEK_SET);
+  data = new u_int8_t[dataSize];
+  dataSize = (unsigned)fread(data, 1, dataSize, fid);
+  fclose(fid);
+
+  NALUnit* nalUnits = new NALUnit[dataSize/5 + 1];
+  for (unsigned i = 0; i + 4 < dataSize; ++i) {
+    if (data[i] != 0 || data[i+1] != 0 || data[i+2] != 0 || data[i+3] != 1) continue;
+
+    NALUnit& nal = nalUnits[numNALUnits++];
+    nal.offset = i;
+    nal.type = data[i+4]&0x1F;
+    nal.frameNum = (nal.type == 1 || nal.type == 5) && i + 9 <= dataSize ? getFrameNum(&data[i+5]) : ~0;
+  }
+  return nalUnits;
+}
+
+char volatile doneFlag;
+
+static void afterRecording(void* /*clientData*/) {
+  doneFlag = 1;
+}
+
+// The result of a "findKeyFrame()" call.  (Its offset is checked only after the recorder has been closed, because
+// until then, the end of the current segment might not yet have been written to the file.)
+struct KeyFrameLookup {
+  unsigned frameNum; // the key frame that we expect
+  char* fileName;
+  u_int64_t offset;
+};
+
+static Boolean findKeyFrame(RollingRecordingSink* sink, u_int64_t time, unsigned oldestFrameNum,
+			    KeyFrameLookup& lookup) {
+  lookup.frameNum = (unsigned)((time - startTime)*framesPerSecond/1000000);
+  lookup.frameNum -= lookup.frameNum%framesPerKeyFrame;
+  if (lookup.frameNum < oldestFrameNum) lookup.frameNum = oldestFrameNum;
+
+  struct timeval resultTime;
+  if (!sink->findKeyFrame(microsecondsToTimeval(time), lookup.fileName, lookup.offset, resultTime)) {
+    check(False, "findKeyFrame() failed", lookup.frameNum);
+    return False;
+  }
+  check(timevalToMicroseconds(resultTime) == frameTime(lookup.frameNum), "findKeyFrame() found the wrong time",
+	lookup.frameNum);
+  return True;
+}
+
+static void checkKeyFrameOffset(KeyFrameLookup const& lookup, unsigned oldestFrameNum) {
+  // The segment might since have been deleted (when the recorder was closed), if it's now too old:
+  if (lookup.frameNum < oldestFrameNum) {
+    FILE* fid = fopen(lookup.fileName, "rb");
+    check(fid == NULL, "a segment file remains after its segment was deleted", lookup.frameNum);
+    if (fid != NULL) fclose(fid);
+    return;
+  }
+
+  // Otherwise, the offset should be that of the key frame's SPS, followed by its PPS and IDR slice:
+  unsigned numNALUnits, dataSize; u_int8_t* data;
+  NALUnit* nalUnits = readNALUnits(lookup.fileName, numNALUnits, data, dataSize);
+  unsigned i;
+  for (i = 0; i < numNALUnits && nalUnits[i].offset != lookup.offset; ++i) {}
+  check(i + 2 < numNALUnits && nalUnits[i].type == 7 && nalUnits[i+2].type == 5
+	&& nalUnits[i+2].frameNum == lookup.frameNum, "findKeyFrame() found the wrong offset", lookup.frameNum);
+  delete[] nalUnits; delete[] data;
+}
+
+static unsigned oldestListedFrameNum(char const* fileNamePrefix) {
+  char* segmentListFileName = new char[strlen(fileNamePrefix) + 5 + 1];
+  sprintf(segmentListFileName, "%sindex", fileNamePrefix);
+  RecordingSegmentList segments;
+  segments.readFromFile(segmentListFileName);
+  delete[] segmentListFileName;
+  if (segments.numSegments() == 0) return 0;
+  return (unsigned)((timevalToMicroseconds(segments.segment(0)->fStartTime) - startTime)*framesPerSecond/1000000);
+}
+
+static void record(char const* fileNamePrefix, unsigned firstFrameNum, unsigned numFrames) {
+  RollingRecordingParameters params;
+  params.segmentDurationSeconds = segmentDurationSeconds;
+  params.retentionSeconds = retentionSeconds;
+  RollingRecordingSink* sink
+    = RollingRecordingSink::createNew(*env, fileNamePrefix, ".264", params, 100000, 264, sPropParameterSets);
+  FramedSource* source = SyntheticH264Source::createNew(*env, firstFrameNum, numFrames);
+  doneFlag = 0;
+  sink->startPlaying(*source, afterRecording, NULL);
+  env->taskScheduler().doEventLoop(&doneFlag);
+
+  // Look up key frames - in both complete segments and the current one - before closing the recorder.
+  // (Times before the oldest segment that's still kept should find that segment's first key frame.)
+  unsigned const oldestFrameNum = oldestListedFrameNum(fileNamePrefix);
+  unsigned const numLookups = numFrames/97 + 1;
+  KeyFrameLookup* lookups = new KeyFrameLookup[numLookups];
+  unsigned numFound = 0;
+  for (unsigned i = 0; i < numLookups; ++i) {
+    if (findKeyFrame(sink, frameTime(firstFrameNum + i*97) + 1000, oldestFrameNum, lookups[numFound])) ++numFound;
+  }
+  Medium::close(sink);
+  Medium::close(source);
+
+  unsigned const newOldestFrameNum = oldestListedFrameNum(fileNamePrefix);
+  for (unsigned i = 0; i < numFound; ++i) {
+    checkKeyFrameOffset(lookups[i], newOldestFrameNum);
+    delete[] lookups[i].fileName;
+  }
+  delete[] lookups;
+}
+
+static unsigned countFiles(char const* dirName) {
+  unsigned numFiles = 0;
+  DIR* dir = opendir(dirName);
+  if (dir == NULL) return 0;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) ++numFiles;
+  }
+  closedir(dir);
+  return numFiles;
+}
+
+static void removeFiles(char const* dirName) {
+  DIR* dir = opendir(dirName);
+  if (dir == NULL) return;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+    char* fileName = new char[strlen(dirName) + 1 + strlen(entry->d_name) + 1];
+    sprintf(fileName, "%s/%s", dirName, entry->d_name);
+    remove(fileName);
+    delete[] fileName;
+  }
+  closedir(dir);
+}
+
+// Checks the archive after a recording that ended with frame "endFrameNum"; returns the number of segments kept,
+// and the first frame that's kept:
+static unsigned checkArchive(char const* dirName, char const* fileNamePrefix, unsigned endFrameNum,
+			     unsigned& numSegments) {
+  char* segmentListFileName = new char[strlen(fileNamePrefix) + 5 + 1];
+  sprintf(segmentListFileName, "%sindex", fileNamePrefix);
+  RecordingSegmentList segments;
+  check(segments.readFromFile(segmentListFileName), "the segment list can't be read");
+  delete[] segmentListFileName;
+  numSegments = segments.numSegments();
+  check(numSegments > 0, "there are no segments");
+  if (numSegments == 0) return 0;
+
+  // Each segment has a ".idx" file, and there's nothing else (other than the segment list):
+  check(countFiles(dirName) == 2*numSegments + 1, "deleted segments' files remain", countFiles(dirName));
+
+  // Retention: The oldest segment that we kept must end within "retentionSeconds" of the newest one's end:
+  u_int64_t newestEndTime = timevalToMicroseconds(segments.segment(numSegments-1)->fEndTime);
+  check(numSegments == 1
+	|| timevalToMicroseconds(segments.segment(0)->fEndTime) + (u_int64_t)retentionSeconds*1000000 >= newestEndTime,
+	"a segment was kept beyond the retention period", numSegments);
+
+  unsigned nextFrameNum = ~0, firstFrameNum = 0;
+  for (unsigned s = 0; s < numSegments; ++s) {
+    RecordingSegment const* segment = segments.segment(s);
+    unsigned numNALUnits, dataSize; u_int8_t* data;
+    NALUnit* nalUnits = readNALUnits(segment->fFileName, numNALUnits, data, dataSize);
+    check(numNALUnits > 4, "a segment is empty", s);
+    if (numNALUnits <= 4) { delete[] nalUnits; delete[] data; continue; }
+
+    // The segment begins with the 'sprop' parameter sets, then the key frame's own SPS, PPS, and IDR slice:
+    check(nalUnits[0].type == 7 && nalUnits[1].type == 8 && nalUnits[2].type == 7 && nalUnits[3].type == 8
+	  && nalUnits[4].type == 5, "a segment doesn't begin with parameter sets, then a key frame", s);
+    unsigned segmentFirstFrameNum = nalUnits[4].frameNum;
+    check(timevalToMicroseconds(segment->fStartTime) == frameTime(segmentFirstFrameNum),
+	  "a segment's start time is wrong", s);
+    if (s == 0) {
+      firstFrameNum = segmentFirstFrameNum;
+      // The segment before this one (if any) must have been deleted because it was too old:
+      check(firstFrameNum == 0 || frameTime(firstFrameNum - 1) + (u_int64_t)retentionSeconds*1000000 < newestEndTime,
+	    "a segment was deleted before the end of the retention period", firstFrameNum);
+    } else {
+      check(segmentFirstFrameNum == nextFrameNum, "frames were lost (or duplicated) at a segment boundary",
+	    segmentFirstFrameNum);
+    }
+
+    // The slices must be consecutive, with key frames every "framesPerKeyFrame" frames, and the key frame index
+    // must list each key frame's time, and the offset of its SPS:
+    char* indexFileName = segment->indexFileName();
+    SegmentKeyFrameIndex* index = SegmentKeyFrameIndex::createFromFile(indexFileName);
+    delete[] indexFileName;
+    check(index != NULL, "a segment's key frame index can't be read", s);
+    nextFrameNum = segmentFirstFrameNum;
+    unsigned numKeyFrames = 0;
+    for (unsigned i = 2; i < numNALUnits; ++i) {
+      NALUnit const& nal = nalUnits[i];
+      if (nal.type != 1 && nal.type != 5) continue;
+      check(nal.frameNum == nextFrameNum, "a frame is missing from a segment", nextFrameNum);
+      check((nal.type == 5) == (nal.frameNum%framesPerKeyFrame == 0), "a frame has the wrong type", nal.frameNum);
+      nextFrameNum = nal.frameNum + 1;
+      if (nal.type != 5) continue;
+
+      if (index != NULL) {
+	check(numKeyFrames < index->numEntries() && index->time(numKeyFrames) == frameTime(nal.frameNum)
+	      && index->offset(numKeyFrames) == nalUnits[i-2].offset, "a key frame index entry is wrong", nal.frameNum);
+      }
+      ++numKeyFrames;
+    }
+    check(index == NULL || index->numEntries() == numKeyFrames, "a key frame index has extra entries", s);
+    delete index;
+    check(timevalToMicroseconds(segment->fEndTime) == frameTime(nextFrameNum - 1), "a segment's end time is wrong", s);
+
+    // Rotation: Each segment (except the last) should end just before the first key frame after
+    // "segmentDurationSeconds" - unless its recording ended first:
+    if (s < numSegments - 1) {
+      unsigned expectedNextFrameNum = segmentFirstFrameNum + segmentDurationSeconds*framesPerSecond;
+      expectedNextFrameNum += (framesPerKeyFrame - expectedNextFrameNum%framesPerKeyFrame)%framesPerKeyFrame;
+      check(nextFrameNum == expectedNextFrameNum
+	    || (nextFrameNum < expectedNextFrameNum && nextFrameNum%(numSecondsPerRun*framesPerSecond) == 0),
+	    "a segment wasn't rotated at the right key frame", s);
+    }
+    delete[] nalUnits; delete[] data;
+  }
+  check(nextFrameNum == endFrameNum, "the last frames are missing", nextFrameNum);
+  return firstFrameNum;
+}
+
+////////// Seeking //////////
+
+// A NAL unit, as delivered by the archive's stream source:
+struct DeliveredNALUnit {
+  u_int8_t type;
+  unsigned frameNum; // if a slice
+  unsigned durationInMicroseconds;
+};
+
+static DeliveredNALUnit deliveredNALUnit;
+static u_int8_t nalBuffer[100000];
+
+static void afterGettingNALUnit(void* /*clientData*/, unsigned frameSize, unsigned /*numTruncatedBytes*/,
+				struct timeval /*presentationTime*/, unsigned durationInMicroseconds) {
+  deliveredNALUnit.type = frameSize > 0 ? nalBuffer[0]&0x1F : 0;
+  deliveredNALUnit.frameNum
+    = (deliveredNALUnit.type == 1 || deliveredNALUnit.type == 5) && frameSize >= 5 ? getFrameNum(&nalBuffer[1]) : ~0;
+  deliveredNALUnit.durationInMicroseconds = durationInMicroseconds;
+  doneFlag = 1;
+}
+
+static void onSourceClosure(void* /*clientData*/) {
+  deliveredNALUnit.type = 0; // shows that the stream has ended
+  doneFlag = 1;
+}
+
+// Gets the next NAL unit from "source"; returns False at the end of the stream:
+static Boolean getNALUnit(FramedSource* source) {
+  doneFlag = 0;
+  source->getNextFrame(nalBuffer, sizeof nalBuffer, afterGettingNALUnit, NULL, onSourceClosure, NULL);
+  env->taskScheduler().doEventLoop(&doneFlag);
+  return deliveredNALUnit.type != 0;
+}
+
+// Gets the next slice from "source"; returns False at the end of the stream:
+static Boolean getSlice(FramedSource* source) {
+  while (getNALUnit(source)) {
+    if (deliveredNALUnit.type == 1 || deliveredNALUnit.type == 5) return True;
+  }
+  return False;
+}
+
+static void formatAbsoluteTime(u_int64_t time, char* buf) {
+  time_t tt = (time_t)(time/1000000);
+  unsigned len = (unsigned)strftime(buf, 30, "%Y%m%dT%H%M%S", gmtime(&tt));
+  sprintf(&buf[len], ".%03uZ", (unsigned)((time%1000000)/1000));
+}
+
+static unsigned frameNumAt(u_int64_t time) { // the frame at (or before) "time"
+  return (unsigned)((time - startTime)*framesPerSecond/1000000);
+}
+
+static unsigned keyFrameNumAt(u_int64_t time, unsigned oldestFrameNum, unsigned endFrameNum) {
+  // The last key frame at (or before) "time", within the archive:
+  unsigned frameNum = time < frameTime(oldestFrameNum) ? oldestFrameNum : frameNumAt(time);
+  if (frameNum >= endFrameNum) frameNum = endFrameNum - 1;
+  return frameNum - frameNum%framesPerKeyFrame;
+}
+
+// Plays the archive from "startTime" to (just before the first key frame at or after) "endTime" (0 means: to the end),
+// at "scale", checking the frames that we get:
+static void checkPlayback(ServerMediaSubsession* subsession/*used the same way as by "RTSPServer"*/, unsigned oldestFrameNum, unsigned endFrameNum,
+			  Boolean useNPT, u_int64_t startTime, u_int64_t endTime, float scale) {
+  static unsigned clientSessionId = 0;
+  ++clientSessionId;
+  struct sockaddr_storage clientAddress;
+  memset(&clientAddress, 0, sizeof clientAddress);
+  clientAddress.ss_family = AF_INET;
+  ((struct sockaddr_in&)clientAddress).sin_addr.s_addr = htonl(0x7F000001);
+  struct sockaddr_storage destinationAddress = clientAddress;
+  u_int8_t destinationTTL = 255;
+  Boolean isMulticast;
+  Port serverRTPPort(0), serverRTCPPort(0);
+  void* streamToken;
+  // (Because the client RTP port is 0, no RTP sink is created, so we can read the stream source directly.)
+  subsession->getStreamParameters(clientSessionId, clientAddress, Port(0), Port(0), -1, 0, 0,
+				  destinationAddress, destinationTTL, isMulticast, serverRTPPort, serverRTCPPort,
+				  streamToken);
+  FramedSource* source = subsession->getStreamSource(streamToken);
+  check(source != NULL, "the archive has no stream source", clientSessionId);
+  if (source == NULL) return;
+
+  // As in "RTSPServer", set the scale, then seek:
+  subsession->setStreamScale(clientSessionId, streamToken, scale);
+  unsigned const expectedFrameNum = keyFrameNumAt(startTime, oldestFrameNum, endFrameNum);
+  u_int64_t const archiveStartTime = frameTime(oldestFrameNum);
+  if (useNPT) {
+    double seekNPT = startTime > archiveStartTime ? (startTime - archiveStartTime)/1000000.0 : 0.0;
+    double streamDuration = endTime == 0 ? 0.0 : (endTime - startTime)/1000000.0;
+    u_int64_t numBytes;
+    subsession->seekStream(clientSessionId, streamToken, seekNPT, streamDuration, numBytes);
+    check(seekNPT == (frameTime(expectedFrameNum) - archiveStartTime)/1000000.0,
+	  "seeking (by NPT) reported the wrong time", expectedFrameNum);
+  } else {
+    char* absStart = new char[40];
+    formatAbsoluteTime(startTime, absStart);
+    char* absEnd = NULL;
+    if (endTime != 0) {
+      absEnd = new char[40];
+      formatAbsoluteTime(endTime, absEnd);
+    }
+    subsession->seekStream(clientSessionId, streamToken, absStart, absEnd);
+    char expectedAbsStart[40];
+    formatAbsoluteTime(frameTime(expectedFrameNum), expectedAbsStart);
+    // (The archive omits ".000" from whole seconds.)
+    char* fraction = strstr(expectedAbsStart, ".000Z");
+    if (fraction != NULL) strcpy(fraction, "Z");
+    check(absStart != NULL && strcmp(absStart, expectedAbsStart) == 0,
+	  "seeking (by absolute time) reported the wrong time", expectedFrameNum);
+    delete[] absStart; delete[] absEnd;
+  }
+
+  // Playing starts with the key frame's SPS and PPS:
+  Boolean haveSPS = getNALUnit(source) && deliveredNALUnit.type == 7;
+  Boolean havePPS = getNALUnit(source) && deliveredNALUnit.type == 8;
+  check(haveSPS && havePPS, "playing didn't start with parameter sets", expectedFrameNum);
+
+  Boolean const keyFramesOnly = scale < 0.0f || scale > 1.0f;
+  unsigned nextFrameNum = expectedFrameNum;
+  unsigned lastFrameNum = ~0;
+  unsigned numFrames = 0;
+  while (getSlice(source)) {
+    DeliveredNALUnit const& nal = deliveredNALUnit;
+    check(nal.frameNum == nextFrameNum, "playing delivered the wrong frame", nextFrameNum);
+    if (!keyFramesOnly) {
+      check(nal.durationInMicroseconds == (unsigned)(1000000/framesPerSecond/scale), "a frame has the wrong duration",
+	    nal.frameNum);
+    }
+    lastFrameNum = nal.frameNum;
+    ++numFrames;
+
+    // The next frame that we expect:
+    if (!keyFramesOnly) {
+      nextFrameNum = nal.frameNum + 1;
+    } else {
+      // the first key frame that's at least 1/10 second of playing time away:
+      unsigned step = (unsigned)((scale < 0.0f ? -scale : scale)*framesPerSecond/10);
+      step += (framesPerKeyFrame - step%framesPerKeyFrame)%framesPerKeyFrame;
+      if (step == 0) step = framesPerKeyFrame;
+      // (or - when playing in reverse - the first key frame of the archive, if we'd go past it):
+      if (scale > 0.0f) {
+	nextFrameNum = nal.frameNum + step;
+      } else {
+	nextFrameNum = nal.frameNum >= oldestFrameNum + step ? nal.frameNum - step
+	  : nal.frameNum > oldestFrameNum ? oldestFrameNum : ~0;
+      }
+    }
+  }
+
+  // Check where playing ended:
+  Boolean endedCorrectly;
+  if (keyFramesOnly) {
+    // at the end (or - in reverse - the start) of the archive:
+    endedCorrectly = nextFrameNum == ~0U || nextFrameNum >= endFrameNum;
+  } else if (endTime == 0) {
+    endedCorrectly = lastFrameNum == endFrameNum - 1;
+  } else {
+    // just before the first key frame at (or after) "endTime":
+    unsigned endKeyFrameNum = frameNumAt(endTime - 1) + 1;
+    endKeyFrameNum += (framesPerKeyFrame - endKeyFrameNum%framesPerKeyFrame)%framesPerKeyFrame;
+    endedCorrectly = lastFrameNum == endKeyFrameNum - 1;
+  }
+  check(numFrames > 0 && endedCorrectly, "playing ended at the wrong frame", lastFrameNum);
+
+  subsession->deleteStream(clientSessionId, streamToken);
+}
+
+static void checkSeeking(char const* fileNamePrefix, unsigned oldestFrameNum, unsigned endFrameNum) {
+  ArchiveServerMediaSubsession* subsession = ArchiveServerMediaSubsession::createNew(*env, fileNamePrefix, 264);
+  u_int64_t const midTime = frameTime((oldestFrameNum + endFrameNum)/2 + 13) + 1000; // (not at a key frame)
+
+  // Seeking by NPT, or absolute time, then playing to the end (across segment boundaries), or for 3 seconds:
+  checkPlayback(subsession, oldestFrameNum, endFrameNum, True, midTime, 0, 1.0f);
+  checkPlayback(subsession, oldestFrameNum, endFrameNum, False, midTime, 0, 1.0f);
+  checkPlayback(subsession, oldestFrameNum, endFrameNum, True, midTime, midTime + 3000000, 1.0f);
+  checkPlayback(subsession, oldestFrameNum, endFrameNum, False, midTime, midTime + 3000000, 1.0f);
+
+  // Seeking to before the start of the archive, or after its end:
+  checkPlayback(subsession, oldestFrameNum, endFrameNum, False, startTime, 0, 1.0f);
+  checkPlayback(subsession, oldestFrameNum, endFrameNum, False, frameTime(endFrameNum + 100), 0, 1.0f);
+
+  // Slow motion, fast forward, and reverse play:
+  checkPlayback(subsession, oldestFrameNum, endFrameNum, True, midTime, midTime + 3000000, 0.5f);
+  checkPlayback(subsession, oldestFrameNum, endFrameNum, True, midTime, 0, 4.0f);
+  checkPlayback(subsession, oldestFrameNum, endFrameNum, True, midTime, 0, 20.0f);
+  checkPlayback(subsession, oldestFrameNum, endFrameNum, True, midTime, 0, -2.0f);
+  checkPlayback(subsession, oldestFrameNum, endFrameNum, True, midTime, 0, -20.0f);
+
+  Medium::close(subsession);
+}
+
+int main(int argc, char** argv) {
+  setUpBenchmark(argc, argv, "number-of-seconds-per-recording", numSecondsPerRun);
+  if (argc != 1) benchmarkUsage();
+
+  char dirName[] = "/tmp/testRecordingArchiveXXXXXX";
+  if (mkdtemp(dirName) == NULL) {
+    *env << "Failed to create a temporary directory\n";
+    exit(1);
+  }
+  char* fileNamePrefix = new char[strlen(dirName) + 10];
+  sprintf(fileNamePrefix, "%s/archive-", dirName);
+
+  unsigned const numFramesPerRun = numSecondsPerRun*framesPerSecond;
+  unsigned oldestFrameNum = 0;
+  for (unsigned run = 0; run < 2; ++run) {
+    unsigned firstFrameNum = run*numFramesPerRun;
+    record(fileNamePrefix, firstFrameNum, numFramesPerRun);
+    unsigned numSegments;
+    oldestFrameNum = checkArchive(dirName, fileNamePrefix, firstFrameNum + numFramesPerRun, numSegments);
+    *env << "Recording #" << run+1 << ": " << numSecondsPerRun << " seconds; " << numSegments
+	 << " segments kept, starting at " << oldestFrameNum/framesPerSecond << " seconds\n";
+  }
+
+  checkSeeking(fileNamePrefix, oldestFrameNum, 2*numFramesPerRun);
+
+  removeFiles(dirName);
+  rmdir(dirName);
+  delete[] fileNamePrefix;
+
+  int result = reportChecks();
+  tearDownBenchmark();
+  return result;
+}
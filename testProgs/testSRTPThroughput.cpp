@@ -0,0 +1,216 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2019, Live Networks, Inc.  All rights reserved
+// A benchmark for SRTP/SRTCP (see "SRTPCryptographicContext.hh"):
+// - Each SRTP profile's in-place protection (and, at the receiver, unprotection) of synthetic RTP packets is timed,
+//   and each unprotected packet is checked against the original.  (The receiver gets its keys by parsing the
+//   sender's MIKEY message, as a RTSP client would.)  Tampered-with and replayed packets must be rejected.
+// - "RTPInterface::sendPacket()" (over UDP, to a local port) is then timed with, and without, SRTP, to show the
+//   overhead - in packets/second - that SRTP adds to sending.
+// main program
+
+#include "benchmarkCommon.hh"
+
+unsigned numPackets = 200000; // default; can be changed with "-n"
+
+static char const* profileName(MIKEYState::SRTPProfile profile, Boolean encrypt) {
+  if (profile == MIKEYState::AEAD_AES_128_GCM) return "AEAD_AES_128_GCM";
+  return encrypt ? "AES_CM_128_HMAC_SHA1_80" : "AES_CM_128_HMAC_SHA1_80 (auth only)";
+}
+
+////////// Synthetic RTP packets //////////
+
+u_int32_t const ssrc = 0x12345678;
+u_int16_t const firstSeqNum = 65000; // so that the sequence numbers (and so the SRTP 'rollover counter') wrap around
+
+// Builds RTP packet number "i" (with a "packetSize"-byte payload that's the same for every packet) in "buffer":
+static unsigned makePacket(u_int8_t* buffer, unsigned i, unsigned payloadSize) {
+  setRTPHeader(buffer, 96, False, (u_int16_t)(firstSeqNum + i), (i/10)*3000, ssrc);
+  for (unsigned j = 0; j < payloadSize; ++j) buffer[12+j] = (u_int8_t)(j*7);
+  return 12 + payloadSize;
+}
+
+// Creates a pair of cryptographic contexts (sender and receiver) that share a (new, random) master key:
+static Boolean createContexts(MIKEYState::SRTPProfile profile, Boolean encrypt,
+			      SRTPCryptographicContext*& sender, SRTPCryptographicContext*& receiver) {
+  MIKEYState* senderMIKEY = MIKEYState::createNew(profile, encrypt, encrypt);
+  char* keyMgmtLine = senderMIKEY->keyMgmtSDPLine();
+  MIKEYState* receiverMIKEY = MIKEYState::createNewFromKeyMgmtAttribute(&keyMgmtLine[11]); // skip "a=key-mgmt:"
+  delete[] keyMgmtLine;
+  if (receiverMIKEY == NULL) {
+    *env << "ERROR: Failed to parse our own MIKEY message: " << env->getResultMsg() << "\n";
+    delete senderMIKEY;
+    return False;
+  }
+
+  sender = SRTPCryptographicContext::createNew(*senderMIKEY);
+  receiver = SRTPCryptographicContext::createNew(*receiverMIKEY);
+  delete senderMIKEY; delete receiverMIKEY;
+  return sender != NULL && receiver != NULL;
+}
+
+////////// Protection and unprotection //////////
+
+static void benchmarkCrypto(MIKEYState::SRTPProfile profile, Boolean encrypt, unsigned payloadSize) {
+  SRTPCryptographicContext* sender;
+  SRTPCryptographicContext* receiver;
+  if (!createContexts(profile, encrypt, sender, receiver)) {
+    *env << "ERROR: Failed to create the SRTP cryptographic contexts\n";
+    return;
+  }
+
+  // Process the packets in batches, so that each packet can be protected, then unprotected, in the same buffer:
+  unsigned const batchSize = 1024;
+  unsigned const bufferSize = 12 + payloadSize + SRTP_MAX_TRAILER_SIZE;
+  u_int8_t* batch = new u_int8_t[batchSize*bufferSize];
+  unsigned* sizes = new unsigned[batchSize];
+  u_int8_t* original = new u_int8_t[bufferSize];
+  double protectSeconds = 0.0, unprotectSeconds = 0.0;
+  unsigned numBad = 0;
+
+  for (unsigned first = 0; first < numPackets; first += batchSize) {
+    unsigned n = numPackets - first < batchSize ? numPackets - first : batchSize;
+    for (unsigned j = 0; j < n; ++j) sizes[j] = makePacket(&batch[j*bufferSize], first + j, payloadSize);
+
+    struct timeval startTime;
+    gettimeofday(&startTime, NULL);
+    for (unsigned j = 0; j < n; ++j) {
+      if (!sender->processOutgoingSRTPPacket(&batch[j*bufferSize], sizes[j], sizes[j])) ++numBad;
+    }
+    protectSeconds += secondsSince(startTime);
+
+    gettimeofday(&startTime, NULL);
+    for (unsigned j = 0; j < n; ++j) {
+      if (!receiver->processIncomingSRTPPacket(&batch[j*bufferSize], sizes[j], sizes[j])) ++numBad;
+    }
+    unprotectSeconds += secondsSince(startTime);
+
+    for (unsigned j = 0; j < n; ++j) {
+      unsigned originalSize = makePacket(original, first + j, payloadSize);
+      if (sizes[j] != originalSize || memcmp(&batch[j*bufferSize], original, originalSize) != 0) ++numBad;
+    }
+  }
+
+  // A tampered-with packet, and a replayed packet, must both be rejected:
+  u_int8_t* packet = &batch[0];
+  u_int8_t* copy = &batch[bufferSize];
+  unsigned protectedSize = makePacket(packet, numPackets, payloadSize), size;
+  sender->processOutgoingSRTPPacket(packet, protectedSize, protectedSize);
+  memcpy(copy, packet, protectedSize);
+  copy[protectedSize/2] ^= 0x01;
+  if (receiver->processIncomingSRTPPacket(copy, protectedSize, size)) ++numBad; // tampered with
+  memcpy(copy, packet, protectedSize);
+  if (!receiver->processIncomingSRTPPacket(copy, protectedSize, size)) ++numBad; // the original is OK...
+  if (receiver->processIncomingSRTPPacket(packet, protectedSize, size)) ++numBad; // ...but not if it's replayed
+
+  // Also check a SRTCP round trip (of a 'receiver report'):
+  u_int8_t rtcp[8 + 24 + SRTP_MAX_TRAILER_SIZE];
+  rtcp[0] = 0x81; rtcp[1] = 201; rtcp[2] = 0; rtcp[3] = 7;
+  for (unsigned j = 4; j < 32; ++j) rtcp[j] = (u_int8_t)j;
+  u_int8_t rtcpOriginal[32];
+  memcpy(rtcpOriginal, rtcp, 32);
+  unsigned rtcpSize;
+  if (!sender->processOutgoingSRTCPPacket(rtcp, 32, rtcpSize)
+      || !receiver->processIncomingSRTCPPacket(rtcp, rtcpSize, rtcpSize)
+      || rtcpSize != 32 || memcmp(rtcp, rtcpOriginal, 32) != 0) {
+    ++numBad;
+  }
+
+  *env << profileName(profile, encrypt) << ", " << payloadSize << "-byte payloads:\tprotect "
+       << (unsigned)(numPackets/protectSeconds) << " packets/second (";
+  printDouble(protectSeconds*1e9/numPackets);
+  *env << " ns/packet); unprotect " << (unsigned)(numPackets/unprotectSeconds) << " packets/second (";
+  printDouble(unprotectSeconds*1e9/numPackets);
+  *env << " ns/packet)";
+  if (numBad > 0) *env << "; ERROR: " << numBad << " packets were processed incorrectly!";
+  *env << "\n";
+
+  delete[] batch; delete[] sizes; delete[] original;
+  delete sender; delete receiver;
+}
+
+////////// Sending //////////
+
+static double sendThroughput(Groupsock* gs, SRTPCryptographicContext* srtpContext, unsigned payloadSize) {
+  BasicUDPSink* owner = BasicUDPSink::createNew(*env, gs); // (an arbitrary "Medium", for the "RTPInterface")
+  RTPInterface* rtpInterface = new RTPInterface(owner, gs);
+  rtpInterface->setSRTPContext(srtpContext);
+
+  u_int8_t* buffer = new u_int8_t[12 + payloadSize];
+  struct timeval startTime;
+  gettimeofday(&startTime, NULL);
+  for (unsigned i = 0; i < numPackets; ++i) {
+    unsigned size = makePacket(buffer, i, payloadSize); // (each with a new sequence number)
+    rtpInterface->sendPacket(buffer, size);
+  }
+  double elapsedSeconds = secondsSince(startTime);
+
+  delete[] buffer;
+  delete rtpInterface;
+  Medium::close(owner);
+  return numPackets/elapsedSeconds;
+}
+
+static void benchmarkSend(unsigned payloadSize) {
+  // Send to a local port (on which we don't read, so the packets are eventually dropped):
+  Port const port(6666);
+  struct in_addr localhost;
+  localhost.s_addr = our_inet_addr("127.0.0.1");
+  int receivingSocket = setupDatagramSocket(*env, port);
+  Groupsock gs(*env, localhost, port, 255);
+
+  double plaintext = sendThroughput(&gs, NULL, payloadSize);
+  *env << "sendPacket(), " << payloadSize << "-byte payloads:\tplaintext " << (unsigned)plaintext << " packets/second";
+
+  MIKEYState::SRTPProfile const profiles[] = { MIKEYState::AES_CM_128_HMAC_SHA1_80, MIKEYState::AEAD_AES_128_GCM };
+  for (unsigned p = 0; p < sizeof profiles/sizeof profiles[0]; ++p) {
+    SRTPCryptographicContext* sender;
+    SRTPCryptographicContext* receiver;
+    if (!createContexts(profiles[p], True, sender, receiver)) continue;
+
+    double protectedRate = sendThroughput(&gs, sender, payloadSize);
+    *env << "; " << profileName(profiles[p], True) << " " << (unsigned)protectedRate << " (overhead ";
+    printDouble(100.0*(plaintext - protectedRate)/plaintext);
+    *env << "%)";
+    delete sender; delete receiver;
+  }
+  *env << "\n";
+
+  closeSocket(receivingSocket);
+}
+
+int main(int argc, char** argv) {
+  setUpBenchmark(argc, argv, "number-of-packets", numPackets);
+  if (argc != 1) benchmarkUsage();
+
+  if (!SRTPCryptographicContext::isSupported()) {
+    *env << "SRTP is not supported by this build (it was compiled with \"NO_OPENSSL\")\n";
+    exit(1);
+  }
+
+  unsigned const payloadSizes[] = { 160, 1200 };
+  for (unsigned s = 0; s < sizeof payloadSizes/sizeof payloadSizes[0]; ++s) {
+    benchmarkCrypto(MIKEYState::AES_CM_128_HMAC_SHA1_80, True, payloadSizes[s]);
+    benchmarkCrypto(MIKEYState::AES_CM_128_HMAC_SHA1_80, False, payloadSizes[s]);
+    benchmarkCrypto(MIKEYState::AEAD_AES_128_GCM, True, payloadSizes[s]);
+  }
+  for (unsigned s = 0; s < sizeof payloadSizes/sizeof payloadSizes[0]; ++s) {
+    benchmarkSend(payloadSizes[s]);
+  }
+
+  tearDownBenchmark();
+  return 0;
+}
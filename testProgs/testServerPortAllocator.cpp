@@ -0,0 +1,228 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2019, Live Networks, Inc.  All rights reserved
+// A self-checking test of the "ServerPortAllocator" pool of server port pairs, and of how
+// "OnDemandServerMediaSubsession" uses it.  We check that:
+// - the default range is used if no range is set, and a range's first port number is rounded up to be even;
+// - pairs are allocated in FIFO order (so a just-released pair is reused last), and only while the pool has any;
+// - releasing a pair that isn't allocated (twice, or a port number that isn't one of the pool's) has no effect;
+// - the range can't be changed while any pair is allocated;
+// - (over many random allocations and releases) a pair is never allocated twice at once;
+// - a "OnDemandServerMediaSubsession" takes its ports from the pool, skips a pair whose port is already in use
+//   (by another socket), and - once the pool is exhausted - takes ports from just above the pool's range;
+// - deleting those streams returns their pairs to the pool.
+// The program exits with status 1 if any check failed.
+// main program
+
+#include "benchmarkCommon.hh"
+
+unsigned numRandomCycles = 100000; // default; can be changed with "-n"
+
+static void checkAllocationOrder() {
+  portNumBits firstPortNum, lastPortNum;
+  ServerPortAllocator::getPortRange(firstPortNum, lastPortNum);
+  check(firstPortNum == SERVER_PORT_ALLOCATOR_DEFAULT_FIRST_PORT_NUM && lastPortNum == SERVER_PORT_ALLOCATOR_DEFAULT_LAST_PORT_NUM,
+	"the default range wasn't used");
+
+  check(ServerPortAllocator::setPortRange(7001, 7010), "setPortRange() failed");
+  ServerPortAllocator::getPortRange(firstPortNum, lastPortNum);
+  check(firstPortNum == 7002 && lastPortNum == 7010, "the range's first port number wasn't rounded up to be even");
+  check(!ServerPortAllocator::isInPortRange(7000) && ServerPortAllocator::isInPortRange(7002)
+	&& ServerPortAllocator::isInPortRange(7010) && !ServerPortAllocator::isInPortRange(7011),
+	"isInPortRange() was wrong");
+  check(ServerPortAllocator::numFreePortPairs() == 4, "the pool has the wrong number of pairs",
+	ServerPortAllocator::numFreePortPairs());
+
+  // The pairs come out in order:
+  portNumBits rtpPortNum;
+  unsigned i;
+  for (i = 0; i < 4; ++i) {
+    Boolean allocated = ServerPortAllocator::allocatePortPair(rtpPortNum);
+    check(allocated && rtpPortNum == 7002 + 2*i, "a pair was allocated out of order", rtpPortNum);
+  }
+  check(!ServerPortAllocator::allocatePortPair(rtpPortNum), "a pair was allocated from an empty pool");
+  check(!ServerPortAllocator::setPortRange(8000, 8010), "the range was changed while pairs were allocated");
+
+  // Released pairs go to the back of the queue; bad releases have no effect:
+  ServerPortAllocator::releasePortPair(7006);
+  ServerPortAllocator::releasePortPair(7002);
+  ServerPortAllocator::releasePortPair(7006); // not allocated now
+  ServerPortAllocator::releasePortPair(7005); // odd
+  ServerPortAllocator::releasePortPair(7000); // below the range
+  ServerPortAllocator::releasePortPair(7012); // above the range
+  check(ServerPortAllocator::numFreePortPairs() == 2 && ServerPortAllocator::numAllocatedPortPairs() == 2,
+	"a bad release changed the pool");
+  check(ServerPortAllocator::allocatePortPair(rtpPortNum) && rtpPortNum == 7006, "pairs weren't reused in FIFO order",
+	rtpPortNum);
+  check(ServerPortAllocator::allocatePortPair(rtpPortNum) && rtpPortNum == 7002, "pairs weren't reused in FIFO order",
+	rtpPortNum);
+
+  for (i = 0; i < 4; ++i) ServerPortAllocator::releasePortPair(7002 + 2*i);
+  check(ServerPortAllocator::numFreePortPairs() == 4, "not all pairs were returned to the pool");
+}
+
+static void checkRandomAllocations() {
+  unsigned const numPairs = 50;
+  portNumBits const firstPortNum = 20000;
+  check(ServerPortAllocator::setPortRange(firstPortNum, firstPortNum + 2*numPairs - 1), "setPortRange() failed");
+
+  Boolean isAllocated[numPairs];
+  unsigned numAllocated = 0, numDuplicates = 0, numOutOfRange = 0;
+  unsigned i;
+  for (i = 0; i < numPairs; ++i) isAllocated[i] = False;
+
+  for (unsigned c = 0; c < numRandomCycles; ++c) {
+    if (our_random()%2 == 0) {
+      portNumBits rtpPortNum;
+      if (ServerPortAllocator::allocatePortPair(rtpPortNum)) {
+	unsigned index = (rtpPortNum - firstPortNum)/2;
+	if (rtpPortNum < firstPortNum || (rtpPortNum&1) != 0 || index >= numPairs) {
+	  ++numOutOfRange;
+	} else if (isAllocated[index]) {
+	  ++numDuplicates;
+	} else {
+	  isAllocated[index] = True;
+	  ++numAllocated;
+	}
+      } else if (numAllocated < numPairs) {
+	++numDuplicates; // the pool said it was empty, but it wasn't
+      }
+    } else {
+      unsigned index = our_random()%numPairs;
+      ServerPortAllocator::releasePortPair(firstPortNum + 2*index); // (has no effect if the pair isn't allocated)
+      if (isAllocated[index]) {
+	isAllocated[index] = False;
+	--numAllocated;
+      }
+    }
+  }
+  check(numOutOfRange == 0, "pairs were allocated outside the range", numOutOfRange);
+  check(numDuplicates == 0, "the pool's state disagreed with ours", numDuplicates);
+  check(ServerPortAllocator::numAllocatedPortPairs() == numAllocated, "the pool miscounted its allocated pairs",
+	ServerPortAllocator::numAllocatedPortPairs());
+
+  for (i = 0; i < numPairs; ++i) ServerPortAllocator::releasePortPair(firstPortNum + 2*i);
+  check(ServerPortAllocator::numAllocatedPortPairs() == 0, "not all pairs were returned to the pool");
+}
+
+// A subsession whose streams are never started; we only set them up (to get their server ports), then delete them:
+class IdleSource: public FramedSource {
+public:
+  IdleSource(UsageEnvironment& env) : FramedSource(env) {}
+
+private:
+  virtual void doGetNextFrame() {}
+};
+
+class PortCheckingSubsession: public OnDemandServerMediaSubsession {
+public:
+  PortCheckingSubsession(UsageEnvironment& env, portNumBits initialPortNum)
+    : OnDemandServerMediaSubsession(env, False/*reuseFirstSource*/, initialPortNum) {}
+
+  portNumBits setUpStream(unsigned clientSessionId, void*& streamToken) {
+    struct sockaddr_storage clientAddr;
+    memset(&clientAddr, 0, sizeof clientAddr);
+    clientAddr.ss_family = AF_INET;
+    ((struct sockaddr_in&)clientAddr).sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    struct sockaddr_storage destinationAddr;
+    memset(&destinationAddr, 0, sizeof destinationAddr);
+    u_int8_t destinationTTL = 255;
+    Boolean isMulticast;
+    Port serverRTPPort(0), serverRTCPPort(0);
+    getStreamParameters(clientSessionId, clientAddr, Port(9000), Port(9001), -1, 0, 0,
+			destinationAddr, destinationTTL, isMulticast, serverRTPPort, serverRTCPPort, streamToken);
+    check(ntohs(serverRTCPPort.num()) == ntohs(serverRTPPort.num()) + 1, "the RTCP port didn't follow the RTP port");
+    return ntohs(serverRTPPort.num());
+  }
+  void deleteStream(unsigned clientSessionId, void*& streamToken) {
+    OnDemandServerMediaSubsession::deleteStream(clientSessionId, streamToken);
+  }
+
+private:
+  virtual FramedSource* createNewStreamSource(unsigned /*clientSessionId*/, unsigned& estBitrate) {
+    estBitrate = 64; // kbps
+    return new IdleSource(envir());
+  }
+  virtual RTPSink* createNewRTPSink(Groupsock* rtpGroupsock, unsigned char /*rtpPayloadTypeIfDynamic*/,
+				    FramedSource* /*inputSource*/) {
+    return SimpleRTPSink::createNew(envir(), rtpGroupsock, 0, 8000, "audio", "PCMU", 1);
+  }
+};
+
+static Boolean portsAreFree(portNumBits firstPortNum, unsigned numPorts) {
+  NoReuse dummy(*env);
+  for (unsigned i = 0; i < numPorts; ++i) {
+    int sock = setupDatagramSocket(*env, Port(firstPortNum + i));
+    if (sock < 0) return False;
+    closeSocket(sock);
+  }
+  return True;
+}
+
+static void checkSubsessionPorts() {
+  // Find 5 pairs of free port numbers: 4 for the pool, and 1 above it:
+  unsigned const numPoolPairs = 4;
+  portNumBits firstPortNum;
+  for (firstPortNum = 40000; firstPortNum < 60000; firstPortNum += 100) {
+    if (portsAreFree(firstPortNum, 2*(numPoolPairs + 1))) break;
+  }
+  check(firstPortNum < 60000, "couldn't find enough free ports");
+  portNumBits const lastPoolPortNum = firstPortNum + 2*numPoolPairs - 1;
+  check(ServerPortAllocator::setPortRange(firstPortNum, lastPoolPortNum), "setPortRange() failed");
+
+  // Some other socket is using the second pair's RTP port:
+  int blockingSocket;
+  {
+    NoReuse dummy(*env);
+    blockingSocket = setupDatagramSocket(*env, Port(firstPortNum + 2));
+  }
+
+  PortCheckingSubsession* subsession = new PortCheckingSubsession(*env, firstPortNum);
+  unsigned const numStreams = numPoolPairs + 1;
+  void* streamTokens[numStreams];
+  portNumBits rtpPortNums[numStreams];
+  unsigned i;
+  for (i = 0; i < numStreams; ++i) rtpPortNums[i] = subsession->setUpStream(i + 1, streamTokens[i]);
+
+  // The streams got each pair from the pool - except the blocked one - and then the pair just above the pool:
+  check(rtpPortNums[0] == firstPortNum, "the 1st stream didn't get the pool's 1st pair", rtpPortNums[0]);
+  check(rtpPortNums[1] == firstPortNum + 4, "the 2nd stream didn't skip the blocked pair", rtpPortNums[1]);
+  check(rtpPortNums[2] == firstPortNum + 6, "the 3rd stream didn't get the pool's 4th pair", rtpPortNums[2]);
+  check(rtpPortNums[3] == lastPoolPortNum + 1, "the 4th stream didn't get the pair just above the pool", rtpPortNums[3]);
+  check(rtpPortNums[4] == lastPoolPortNum + 3, "the 5th stream didn't get the next pair above the pool", rtpPortNums[4]);
+  check(ServerPortAllocator::numAllocatedPortPairs() == 3, "the wrong number of pairs were allocated",
+	ServerPortAllocator::numAllocatedPortPairs());
+
+  for (i = 0; i < numStreams; ++i) subsession->deleteStream(i + 1, streamTokens[i]);
+  check(ServerPortAllocator::numAllocatedPortPairs() == 0, "deleting the streams didn't return their pairs to the pool",
+	ServerPortAllocator::numAllocatedPortPairs());
+
+  Medium::close(subsession);
+  if (blockingSocket >= 0) closeSocket(blockingSocket);
+}
+
+int main(int argc, char** argv) {
+  setUpBenchmark(argc, argv, "number-of-random-cycles", numRandomCycles);
+  if (argc != 1) benchmarkUsage();
+
+  checkAllocationOrder();
+  checkRandomAllocations();
+  checkSubsessionPorts();
+
+  int result = reportChecks();
+  tearDownBenchmark();
+  return result;
+}
@@ -0,0 +1,228 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2019, Live Networks, Inc.  All rights reserved
+// A benchmark for scanning a (multi-program) Transport Stream, in packets/second:
+// - "MPEG2TransportStreamFramer" (which checks each packet's sync byte, and looks for PCRs), delivering chunks of
+//   7 packets (as for RTP), and of 256 packets (as for high-bitrate ingest);
+// - the same, but with the framer's PID filter passing through just one of the programs;
+// - "MPEG2TransportStreamDemux"'s parser, on packets whose PIDs it doesn't know (because there's no PAT).
+// The synthetic input stream (in memory) has 8 programs, with one PID each.  Each PID carries a PCR every 40 packets.
+// Each case is run 9 times, and the median rate is reported, along with the slowest and fastest rates.  (A single run,
+// or the best of a few, is too noisy to compare small differences - e.g., in the 7-packet case, which is dominated
+// by per-chunk event loop and copying costs.)
+// main program
+
+#include "benchmarkCommon.hh"
+
+unsigned numPackets = 2000000; // default; can be changed with "-n"
+
+////////// The synthetic Transport Stream //////////
+
+unsigned const numPrograms = 8;
+u_int16_t const firstPID = 0x100;
+unsigned const numPatternPackets = 2000; // the stream repeats this many packets (so the PCRs jump back each time)
+u_int8_t* pattern = NULL;
+
+static void makePattern() {
+  pattern = new u_int8_t[numPatternPackets*TRANSPORT_PACKET_SIZE];
+  double const packetDuration = TRANSPORT_PACKET_SIZE*8/100e6; // at 100 Mbits/second
+  unsigned continuityCounter[numPrograms], numPacketsInPID[numPrograms];
+  for (unsigned p = 0; p < numPrograms; ++p) continuityCounter[p] = numPacketsInPID[p] = 0;
+
+  for (unsigned i = 0; i < numPatternPackets; ++i) {
+    u_int8_t* pkt = &pattern[i*TRANSPORT_PACKET_SIZE];
+    unsigned p = our_random()%numPrograms;
+    u_int16_t pid = firstPID + p;
+    pkt[0] = 0x47; pkt[1] = pid>>8; pkt[2] = (u_int8_t)pid;
+    unsigned payloadStart = 4;
+    if (numPacketsInPID[p]++%40 == 0) {
+      // Include a PCR, in an adaptation field:
+      u_int64_t pcrBase = (u_int64_t)(i*packetDuration*90000);
+      pkt[3] = 0x30 | continuityCounter[p];
+      pkt[4] = 7; pkt[5] = 0x10;
+      pkt[6] = (u_int8_t)(pcrBase>>25); pkt[7] = (u_int8_t)(pcrBase>>17);
+      pkt[8] = (u_int8_t)(pcrBase>>9); pkt[9] = (u_int8_t)(pcrBase>>1);
+      pkt[10] = ((pcrBase&1)<<7) | 0x7E; pkt[11] = 0;
+      payloadStart = 12;
+    } else {
+      pkt[3] = 0x10 | continuityCounter[p];
+    }
+    continuityCounter[p] = (continuityCounter[p] + 1)&0x0F;
+    for (unsigned j = payloadStart; j < TRANSPORT_PACKET_SIZE; ++j) pkt[j] = (u_int8_t)our_random();
+  }
+}
+
+// A source that delivers "numPackets" packets of the pattern (repeatedly), as much as is asked for at a time:
+class InMemoryTSSource: public FramedSource {
+public:
+  static InMemoryTSSource* createNew(UsageEnvironment& env) {
+    return new InMemoryTSSource(env);
+  }
+
+private:
+  InMemoryTSSource(UsageEnvironment& env)
+    : FramedSource(env), fNumBytesLeft((u_int64_t)numPackets*TRANSPORT_PACKET_SIZE), fNextPatternByte(0) {
+  }
+
+  virtual void doGetNextFrame() {
+    if (fNumBytesLeft == 0) {
+      handleClosure();
+      return;
+    }
+
+    // (Our client - e.g., a "StreamParser" - might ask for less than a whole packet.)
+    unsigned const patternSize = numPatternPackets*TRANSPORT_PACKET_SIZE;
+    fFrameSize = fMaxSize;
+    if (fFrameSize > fNumBytesLeft) fFrameSize = (unsigned)fNumBytesLeft;
+    if (fFrameSize > patternSize - fNextPatternByte) fFrameSize = patternSize - fNextPatternByte;
+    memcpy(fTo, &pattern[fNextPatternByte], fFrameSize);
+    fNumTruncatedBytes = 0;
+    gettimeofday(&fPresentationTime, NULL);
+    fNumBytesLeft -= fFrameSize;
+    fNextPatternByte = (fNextPatternByte + fFrameSize)%patternSize;
+
+    // Deliver the data via the event loop (rather than recursively):
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)FramedSource::afterGetting, this);
+  }
+
+private:
+  u_int64_t fNumBytesLeft;
+  unsigned fNextPatternByte;
+};
+
+// A sink that reads (and discards) chunks of a fixed number of Transport Stream packets:
+class DiscardingSink: public MediaSink {
+public:
+  static DiscardingSink* createNew(UsageEnvironment& env, unsigned chunkNumPackets) {
+    return new DiscardingSink(env, chunkNumPackets);
+  }
+
+  unsigned numPacketsReceived() const { return fNumPacketsReceived; }
+
+private:
+  DiscardingSink(UsageEnvironment& env, unsigned chunkNumPackets)
+    : MediaSink(env), fBufferSize(chunkNumPackets*TRANSPORT_PACKET_SIZE), fNumPacketsReceived(0) {
+    fBuffer = new u_int8_t[fBufferSize];
+  }
+  virtual ~DiscardingSink() {
+    delete[] fBuffer;
+  }
+
+  static void afterGettingFrame(void* clientData, unsigned frameSize, unsigned /*numTruncatedBytes*/,
+				struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+    DiscardingSink* sink = (DiscardingSink*)clientData;
+    sink->fNumPacketsReceived += frameSize/TRANSPORT_PACKET_SIZE;
+    sink->continuePlaying();
+  }
+
+  virtual Boolean continuePlaying() {
+    if (fSource == NULL) return False;
+    fSource->getNextFrame(fBuffer, fBufferSize, afterGettingFrame, this, onSourceClosure, this);
+    return True;
+  }
+
+private:
+  u_int8_t* fBuffer;
+  unsigned fBufferSize;
+  unsigned fNumPacketsReceived;
+};
+
+////////// Benchmarks //////////
+
+char volatile doneFlag;
+
+static void afterPlaying(void* /*clientData*/) {
+  doneFlag = 1;
+}
+
+unsigned const numRuns = 9;
+
+static void reportRate(char const* description, double* elapsedSeconds/*numRuns values; sorted by us*/) {
+  for (unsigned i = 1; i < numRuns; ++i) { // insertion sort
+    double seconds = elapsedSeconds[i];
+    unsigned j;
+    for (j = i; j > 0 && elapsedSeconds[j-1] > seconds; --j) elapsedSeconds[j] = elapsedSeconds[j-1];
+    elapsedSeconds[j] = seconds;
+  }
+  double const medianSeconds = elapsedSeconds[numRuns/2];
+
+  *env << description << ":\t" << (unsigned)(numPackets/medianSeconds) << " packets/second (";
+  printDouble(numPackets*TRANSPORT_PACKET_SIZE*8/medianSeconds/1e9);
+  *env << " Gbits/second; runs ranged from " << (unsigned)(numPackets/elapsedSeconds[numRuns-1])
+       << " to " << (unsigned)(numPackets/elapsedSeconds[0]) << " packets/second)";
+}
+
+static void benchmarkFramer(unsigned chunkNumPackets, Boolean filterOneProgram) {
+  double elapsedSeconds[numRuns];
+  unsigned numPacketsPassedThrough = 0;
+  for (unsigned r = 0; r < numRuns; ++r) {
+    InMemoryTSSource* source = InMemoryTSSource::createNew(*env);
+    MPEG2TransportStreamFramer* framer = MPEG2TransportStreamFramer::createNew(*env, source);
+    if (filterOneProgram) framer->addPIDToFilter(firstPID);
+    DiscardingSink* sink = DiscardingSink::createNew(*env, chunkNumPackets);
+
+    struct timeval startTime;
+    gettimeofday(&startTime, NULL);
+    doneFlag = 0;
+    sink->startPlaying(*framer, afterPlaying, NULL);
+    env->taskScheduler().doEventLoop(&doneFlag);
+    elapsedSeconds[r] = secondsSince(startTime);
+    numPacketsPassedThrough = sink->numPacketsReceived();
+
+    Medium::close(sink);
+    Medium::close(framer); // also closes "source"
+  }
+
+  char description[100];
+  sprintf(description, "framer, %u-packet chunks%s", chunkNumPackets, filterOneProgram ? ", 1 of 8 PIDs" : "");
+  reportRate(description, elapsedSeconds);
+  *env << "; " << numPacketsPassedThrough << " packets passed through\n";
+}
+
+static void benchmarkDemux() {
+  double elapsedSeconds[numRuns];
+  for (unsigned r = 0; r < numRuns; ++r) {
+    InMemoryTSSource* source = InMemoryTSSource::createNew(*env);
+
+    struct timeval startTime;
+    gettimeofday(&startTime, NULL);
+    doneFlag = 0;
+    MPEG2TransportStreamDemux::createNew(*env, source, afterPlaying, NULL); // (deletes itself at the end)
+    env->taskScheduler().doEventLoop(&doneFlag);
+    elapsedSeconds[r] = secondsSince(startTime);
+
+    Medium::close(source);
+  }
+
+  reportRate("demux parser, unknown PIDs", elapsedSeconds);
+  *env << "\n";
+}
+
+int main(int argc, char** argv) {
+  setUpBenchmark(argc, argv, "number-of-packets", numPackets);
+  if (argc != 1) benchmarkUsage();
+
+  makePattern();
+  benchmarkFramer(7, False);
+  benchmarkFramer(256, False);
+  benchmarkFramer(7, True);
+  benchmarkFramer(256, True);
+  benchmarkDemux();
+
+  delete[] pattern;
+  tearDownBenchmark();
+  return 0;
+}
@@ -0,0 +1,428 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2019, Live Networks, Inc.  All rights reserved
+// A self-checking test of "RTSPServerWithWorkerThreads": Several worker threads each create some streams (that
+// exist only in that worker's own "RTSPServer"), and many RTSP clients - some of them tunneling over HTTP - then
+// request (at once) each stream's SDP description.  We check that:
+// - each request gets the right description, generated by the thread that created the stream, i.e., that its
+//   connection was handed to the worker thread that owns the stream (for HTTP tunneling, both the "GET" and the
+//   "POST" connection);
+// - each worker was handed exactly the expected number of connections;
+// - a client that begins with an "OPTIONS" request that names no stream gets its response (from the front-end
+//   server), and then - on the same connection - gets its stream's description from the worker that owns it;
+// - requests for streams that no worker owns (including after "unassignStream()") are handled by the front-end
+//   server itself.
+// The program exits with status 1 if any check failed.
+// main program
+
+#include "benchmarkCommon.hh"
+#include <atomic>
+#include <thread>
+
+unsigned numClientsPerStream = 4; // default; can be changed with "-n"
+unsigned const numWorkers = 4;
+unsigned const numStreamsPerWorker = 3;
+unsigned const timeoutSeconds = 10;
+
+std::atomic<unsigned> numWrongThreads(0);
+
+// A subsession that just describes itself (from the thread that created it):
+class ThreadCheckingSubsession: public ServerMediaSubsession {
+public:
+  static ThreadCheckingSubsession* createNew(UsageEnvironment& env) {
+    return new ThreadCheckingSubsession(env);
+  }
+
+private:
+  ThreadCheckingSubsession(UsageEnvironment& env)
+    : ServerMediaSubsession(env), fThreadId(std::this_thread::get_id()), fSDPLines(NULL) {
+  }
+  virtual ~ThreadCheckingSubsession() {
+    delete[] fSDPLines;
+  }
+
+  virtual char const* sdpLines(int /*addressFamily*/) {
+    if (std::this_thread::get_id() != fThreadId) ++numWrongThreads;
+
+    if (fSDPLines == NULL) {
+      char const* const sdpFmt =
+	"m=video 0 RTP/AVP 96\r\n"
+	"c=IN IP4 0.0.0.0\r\n"
+	"a=rtpmap:96 H264/90000\r\n"
+	"a=control:%s\r\n";
+      fSDPLines = new char[strlen(sdpFmt) + strlen(trackId())];
+      sprintf(fSDPLines, sdpFmt, trackId());
+    }
+    return fSDPLines;
+  }
+
+  // We never get as far as "SETUP" or "PLAY":
+  virtual void getStreamParameters(unsigned /*clientSessionId*/, struct sockaddr_storage const& /*clientAddress*/,
+				   Port const& /*clientRTPPort*/, Port const& /*clientRTCPPort*/,
+				   int /*tcpSocketNum*/, unsigned char /*rtpChannelId*/, unsigned char /*rtcpChannelId*/,
+				   struct sockaddr_storage& /*destinationAddress*/, u_int8_t& /*destinationTTL*/,
+				   Boolean& /*isMulticast*/, Port& serverRTPPort, Port& serverRTCPPort,
+				   void*& streamToken) {
+    serverRTPPort = serverRTCPPort = 0;
+    streamToken = NULL;
+  }
+  virtual void startStream(unsigned /*clientSessionId*/, void* /*streamToken*/,
+			   TaskFunc* /*rtcpRRHandler*/, void* /*rtcpRRHandlerClientData*/,
+			   unsigned short& /*rtpSeqNum*/, unsigned& /*rtpTimestamp*/,
+			   ServerRequestAlternativeByteHandler* /*serverRequestAlternativeByteHandler*/,
+			   void* /*serverRequestAlternativeByteHandlerClientData*/) {
+  }
+  virtual void getRTPSinkandRTCP(void* /*streamToken*/, RTPSink const*& rtpSink, RTCPInstance const*& rtcp) {
+    rtpSink = NULL; rtcp = NULL;
+  }
+
+private:
+  std::thread::id fThreadId;
+  char* fSDPLines;
+};
+
+static ServerMediaSession* createStream(UsageEnvironment& env, char const* streamName, char const* description) {
+  ServerMediaSession* sms = ServerMediaSession::createNew(env, streamName, NULL, description);
+  sms->addSubsession(ThreadCheckingSubsession::createNew(env));
+  return sms;
+}
+
+static UsageEnvironment* createWorkerEnvironment() {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  return BasicUsageEnvironment::createNew(*scheduler);
+}
+
+static void makeStreamName(char* streamName, unsigned workerNum, unsigned streamNum) {
+  sprintf(streamName, "stream-%u-%u", workerNum, streamNum);
+}
+
+static void setUpWorkerStreams(RTSPServerWithWorkerThreads& ourServer, unsigned workerNum,
+			       RTSPServer& workerServer, void* /*clientData*/) {
+  // Each stream's SDP description names its worker:
+  char description[30];
+  sprintf(description, "worker %u", workerNum);
+  for (unsigned i = 0; i < numStreamsPerWorker; ++i) {
+    char streamName[30];
+    makeStreamName(streamName, workerNum, i);
+    workerServer.addServerMediaSession(createStream(workerServer.envir(), streamName, description));
+    ourServer.assignStream(streamName, workerNum);
+  }
+}
+
+// A "DESCRIBE" request, and the SDP description (or error) that we expect back:
+class DescribeRequest {
+public:
+  DescribeRequest(portNumBits serverPortNum, char const* streamName, Boolean tunnelOverHTTP,
+		  char const* expectedDescription/*NULL means: expect an error*/)
+    : fStreamName(strDup(streamName)), fExpectedDescription(strDup(expectedDescription)), fIsDone(False) {
+    char url[100];
+    sprintf(url, "rtsp://127.0.0.1:%u/%s", serverPortNum, streamName);
+    fClient = RTSPClient::createNew(*env, url, 0, progName, tunnelOverHTTP ? serverPortNum : 0);
+    fClient->sendDescribeCommand(responseHandler);
+    requests->Add((char const*)fClient, this);
+    ++numPendingRequests;
+  }
+  virtual ~DescribeRequest() {
+    if (!fIsDone) {
+      check(False, "no response to DESCRIBE", fStreamName);
+      requests->Remove((char const*)fClient);
+    }
+    Medium::close(fClient);
+    delete[] fExpectedDescription; delete[] fStreamName;
+  }
+
+  static HashTable* requests; // maps "RTSPClient"s to their "DescribeRequest"s
+  static unsigned numPendingRequests;
+
+private:
+  static void responseHandler(RTSPClient* rtspClient, int resultCode, char* resultString) {
+    DescribeRequest* request = (DescribeRequest*)requests->Lookup((char const*)rtspClient);
+    if (request != NULL) request->handleResponse(resultCode, resultString);
+    delete[] resultString;
+  }
+
+  void handleResponse(int resultCode, char const* resultString) {
+    if (fExpectedDescription == NULL) {
+      check(resultCode != 0, "DESCRIBE of an unassigned stream succeeded", fStreamName);
+    } else {
+      check(resultCode == 0, "DESCRIBE failed", fStreamName);
+      check(resultCode == 0 && strstr(resultString, fExpectedDescription) != NULL,
+	    "DESCRIBE was handled by the wrong worker", fStreamName);
+    }
+    fIsDone = True;
+    requests->Remove((char const*)fClient);
+    if (--numPendingRequests == 0) doneFlag = 1;
+  }
+
+public:
+  static char volatile doneFlag;
+
+private:
+  RTSPClient* fClient;
+  char* fStreamName;
+  char* fExpectedDescription;
+  Boolean fIsDone;
+};
+
+HashTable* DescribeRequest::requests = NULL;
+unsigned DescribeRequest::numPendingRequests = 0;
+char volatile DescribeRequest::doneFlag;
+
+static void timeoutHandler(void* /*clientData*/) {
+  DescribeRequest::doneFlag = 1;
+}
+
+// Runs "numRequests" requests (which have already been sent) to completion (or until we time out):
+static void runRequests(DescribeRequest** requests, unsigned numRequests) {
+  DescribeRequest::doneFlag = 0;
+  TaskToken timeoutTask = env->taskScheduler().scheduleDelayedTask(timeoutSeconds*1000000, timeoutHandler, NULL);
+  env->taskScheduler().doEventLoop(&DescribeRequest::doneFlag);
+  env->taskScheduler().unscheduleDelayedTask(timeoutTask);
+
+  for (unsigned i = 0; i < numRequests; ++i) delete requests[i];
+  DescribeRequest::numPendingRequests = 0;
+}
+
+// A client that begins with an "OPTIONS" request that names no stream, and then - on the same connection - sends
+// a "DESCRIBE" for a stream.  (It uses blocking socket I/O, so it runs in its own thread, while our event loop runs
+// the front-end server.  It only records the responses; "main()" checks them later.)
+class OptionsFirstClient {
+public:
+  OptionsFirstClient(portNumBits serverPortNum, char const* optionsURL, char const* streamName,
+		     Boolean pipelineRequests)
+    : fServerPortNum(serverPortNum), fOptionsURL(optionsURL), fStreamName(streamName),
+      fPipelineRequests(pipelineRequests), fNumBytesReceived(0) {
+    fOptionsResponse[0] = fDescribeResponse[0] = '\0';
+  }
+
+  void run() {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock >= 0) {
+      struct timeval timeout;
+      timeout.tv_sec = timeoutSeconds; timeout.tv_usec = 0;
+      setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (char const*)&timeout, sizeof timeout);
+
+      struct sockaddr_in serverAddr;
+      memset(&serverAddr, 0, sizeof serverAddr);
+      serverAddr.sin_family = AF_INET;
+      serverAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      serverAddr.sin_port = htons(fServerPortNum);
+      if (connect(sock, (struct sockaddr*)&serverAddr, sizeof serverAddr) == 0) {
+	char optionsRequest[200], describeRequest[200];
+	sprintf(optionsRequest, "OPTIONS %s RTSP/1.0\r\nCSeq: 1\r\nUser-Agent: %s\r\n\r\n", fOptionsURL, progName);
+	sprintf(describeRequest, "DESCRIBE rtsp://127.0.0.1:%u/%s RTSP/1.0\r\nCSeq: 2\r\nAccept: application/sdp\r\n\r\n",
+		fServerPortNum, fStreamName);
+	if (fPipelineRequests) {
+	  // Send both requests at once, before reading either response:
+	  char bothRequests[400];
+	  sprintf(bothRequests, "%s%s", optionsRequest, describeRequest);
+	  sendAll(sock, bothRequests);
+	  readResponse(sock, fOptionsResponse);
+	} else {
+	  sendAll(sock, optionsRequest);
+	  readResponse(sock, fOptionsResponse);
+	  sendAll(sock, describeRequest);
+	}
+	readResponse(sock, fDescribeResponse);
+      }
+      closeSocket(sock);
+    }
+    ++numDone;
+  }
+
+  char const* optionsURL() const { return fOptionsURL; }
+  char const* optionsResponse() const { return fOptionsResponse; }
+  char const* describeResponse() const { return fDescribeResponse; }
+
+  static std::atomic<unsigned> numDone;
+  static unsigned numToWaitFor;
+  static void checkIfDone(void* /*clientData*/) {
+    if (numDone == numToWaitFor) {
+      DescribeRequest::doneFlag = 1;
+    } else {
+      env->taskScheduler().scheduleDelayedTask(10000, checkIfDone, NULL);
+    }
+  }
+
+private:
+  static void sendAll(int sock, char const* str) {
+    if (send(sock, str, strlen(str), 0) != (int)strlen(str)) {} // if this fails, we'll see no response
+  }
+
+  void readResponse(int sock, char* response) {
+    // Read (into "fBuf") until it contains a complete response (including its body, if any), then move that to
+    // "response", leaving any following data in "fBuf":
+    while (1) {
+      fBuf[fNumBytesReceived] = '\0';
+      char const* headerEnd = strstr(fBuf, "\r\n\r\n");
+      if (headerEnd != NULL) {
+	unsigned responseSize = (unsigned)(headerEnd + 4 - fBuf);
+	char const* contentLength = strstr(fBuf, "Content-Length: ");
+	if (contentLength != NULL && contentLength < headerEnd) responseSize += atoi(&contentLength[16]);
+	if (fNumBytesReceived >= responseSize) {
+	  memcpy(response, fBuf, responseSize);
+	  response[responseSize] = '\0';
+	  fNumBytesReceived -= responseSize;
+	  memmove(fBuf, &fBuf[responseSize], fNumBytesReceived);
+	  return;
+	}
+      }
+      if (fNumBytesReceived >= sizeof fBuf - 1) return; // too big
+      int bytesRead = recv(sock, &fBuf[fNumBytesReceived], sizeof fBuf - 1 - fNumBytesReceived, 0);
+      if (bytesRead <= 0) return; // closed, or timed out
+      fNumBytesReceived += bytesRead;
+    }
+  }
+
+private:
+  portNumBits fServerPortNum;
+  char const* fOptionsURL;
+  char const* fStreamName;
+  Boolean fPipelineRequests;
+  char fBuf[4000];
+  unsigned fNumBytesReceived;
+  char fOptionsResponse[sizeof fBuf];
+  char fDescribeResponse[sizeof fBuf];
+};
+
+std::atomic<unsigned> OptionsFirstClient::numDone(0);
+unsigned OptionsFirstClient::numToWaitFor = 0;
+
+static void runOptionsFirstClient(OptionsFirstClient* client) {
+  client->run();
+}
+
+static void checkOptionsFirstClients(RTSPServerWithWorkerThreads& server, portNumBits serverPortNum) {
+  char serverURL[100];
+  sprintf(serverURL, "rtsp://127.0.0.1:%u/", serverPortNum);
+  unsigned const workerNum = 1;
+  char streamName[30];
+  makeStreamName(streamName, workerNum, 0);
+  char description[30];
+  sprintf(description, "worker %u", workerNum);
+
+  unsigned const numClients = 3;
+  OptionsFirstClient* clients[numClients];
+  clients[0] = new OptionsFirstClient(serverPortNum, "*", streamName, False);
+  clients[1] = new OptionsFirstClient(serverPortNum, serverURL, streamName, False);
+  clients[2] = new OptionsFirstClient(serverPortNum, "*", streamName, True);
+
+  unsigned numConnectionsBefore = server.numConnectionsHandedOff(workerNum);
+  std::thread* threads[numClients];
+  unsigned i;
+  for (i = 0; i < numClients; ++i) threads[i] = new std::thread(runOptionsFirstClient, clients[i]);
+
+  // Run our event loop (which handles the "OPTIONS" requests) until each client is done (the clients themselves
+  // time out if they get no response):
+  DescribeRequest::doneFlag = 0;
+  OptionsFirstClient::numToWaitFor = numClients;
+  OptionsFirstClient::checkIfDone(NULL);
+  env->taskScheduler().doEventLoop(&DescribeRequest::doneFlag);
+
+  for (i = 0; i < numClients; ++i) {
+    threads[i]->join();
+    delete threads[i];
+
+    char const* optionsResponse = clients[i]->optionsResponse();
+    char const* describeResponse = clients[i]->describeResponse();
+    check(strncmp(optionsResponse, "RTSP/1.0 200 OK\r\n", 17) == 0 && strstr(optionsResponse, "CSeq: 1\r\n") != NULL
+	  && strstr(optionsResponse, "Public: ") != NULL,
+	  "bad response to an OPTIONS that names no stream", clients[i]->optionsURL());
+    check(strncmp(describeResponse, "RTSP/1.0 200 OK\r\n", 17) == 0 && strstr(describeResponse, "CSeq: 2\r\n") != NULL,
+	  "DESCRIBE (after OPTIONS) failed", clients[i]->optionsURL());
+    check(strstr(describeResponse, description) != NULL,
+	  "DESCRIBE (after OPTIONS) was handled by the wrong worker", clients[i]->optionsURL());
+    delete clients[i];
+  }
+  check(server.numConnectionsHandedOff(workerNum) == numConnectionsBefore + numClients,
+	"an OPTIONS-first connection wasn't handed to its stream's worker");
+}
+
+int main(int argc, char** argv) {
+  setUpBenchmark(argc, argv, "number-of-clients-per-stream", numClientsPerStream);
+  if (argc != 1) benchmarkUsage();
+  DescribeRequest::requests = HashTable::create(ONE_WORD_HASH_KEYS);
+
+  RTSPServerWithWorkerThreads* server
+    = RTSPServerWithWorkerThreads::createNew(*env, Port(0), numWorkers, createWorkerEnvironment, setUpWorkerStreams,
+					     NULL);
+  if (server == NULL) {
+    *env << "Failed to create the server: " << env->getResultMsg() << "\n";
+    exit(1);
+  }
+  portNumBits const ourPortNum = serverPortNum(*server);
+  // The front-end server also has a stream of its own:
+  server->addServerMediaSession(createStream(*env, "frontEndStream", "front end"));
+
+  // Every client of every stream sends its request at once.  Every other client tunnels over HTTP (which
+  // uses two connections - for "GET" and "POST" - that must both be handed to the same worker):
+  unsigned const numRequests = numWorkers*numStreamsPerWorker*numClientsPerStream + 2;
+  DescribeRequest** requests = new DescribeRequest*[numRequests];
+  unsigned numConnectionsPerStream = 0;
+  unsigned n = 0;
+  for (unsigned k = 0; k < numClientsPerStream; ++k) {
+    Boolean tunnelOverHTTP = k%2 == 1;
+    numConnectionsPerStream += tunnelOverHTTP ? 2 : 1;
+    for (unsigned w = 0; w < numWorkers; ++w) {
+      char description[30];
+      sprintf(description, "worker %u", w);
+      for (unsigned i = 0; i < numStreamsPerWorker; ++i) {
+	char streamName[30];
+	makeStreamName(streamName, w, i);
+	requests[n++] = new DescribeRequest(ourPortNum, streamName, tunnelOverHTTP, description);
+      }
+    }
+  }
+  requests[n++] = new DescribeRequest(ourPortNum, "frontEndStream", False, "front end");
+  requests[n++] = new DescribeRequest(ourPortNum, "noSuchStream", False, NULL);
+  struct timeval startTime;
+  gettimeofday(&startTime, NULL);
+  runRequests(requests, n);
+  double elapsedSeconds = secondsSince(startTime);
+
+  for (unsigned w = 0; w < numWorkers; ++w) {
+    char workerName[30];
+    sprintf(workerName, "worker %u: %u connections", w, server->numConnectionsHandedOff(w));
+    check(server->numConnectionsHandedOff(w) == numStreamsPerWorker*numConnectionsPerStream,
+	  "a worker was handed the wrong number of connections", workerName);
+  }
+  check(numWrongThreads == 0, "a stream was described by a thread other than the one that created it");
+  *env << n << " DESCRIBE requests (to " << numWorkers << " workers) in ";
+  printDouble(elapsedSeconds);
+  *env << " seconds\n";
+
+  // Clients that begin with an "OPTIONS" request that names no stream are still handed to the right worker:
+  checkOptionsFirstClients(*server, ourPortNum);
+
+  // Once a stream has been unassigned, the front-end server handles its requests (and doesn't know the stream):
+  char streamName[30];
+  makeStreamName(streamName, 0, 0);
+  server->unassignStream(streamName);
+  unsigned numConnectionsBefore = server->numConnectionsHandedOff(0);
+  n = 0;
+  requests[n++] = new DescribeRequest(ourPortNum, streamName, False, NULL);
+  runRequests(requests, n);
+  check(server->numConnectionsHandedOff(0) == numConnectionsBefore,
+	"a connection for an unassigned stream was handed to a worker", streamName);
+
+  delete[] requests;
+  Medium::close(server);
+  delete DescribeRequest::requests;
+
+  int result = reportChecks();
+  tearDownBenchmark();
+  return result;
+}